@@ -0,0 +1,1116 @@
+//
+// Compression
+//
+lbfn u16 QuantizeAnimationTime(f32 Time, f32 MaxTimestamp)
+{
+    f32 t = Clamp(Ratio0(Time, MaxTimestamp), 0.0f, 1.0f);
+    u16 Result = (u16)Round(t * 65535.0f);
+    return(Result);
+}
+
+lbfn animation_key EncodeRotationKey(v4 Q)
+{
+    constexpr f32 Bound = 0.70710678f;
+
+    Q = Normalize(Q);
+    u32 LargestIndex = 0;
+    for (u32 Index = 1; Index < 4; Index++)
+    {
+        if (Abs(Q.E[Index]) > Abs(Q.E[LargestIndex]))
+        {
+            LargestIndex = Index;
+        }
+    }
+
+    // NOTE(boti): q and -q are the same rotation, so the sign of the dropped component can always be made positive
+    if (Q.E[LargestIndex] < 0.0f)
+    {
+        Q = -Q;
+    }
+
+    animation_key Result = {};
+    u32 ValueIndex = 0;
+    for (u32 Index = 0; Index < 4; Index++)
+    {
+        if (Index == LargestIndex) continue;
+        f32 Value = Clamp((Q.E[Index] + Bound) / (2.0f * Bound), 0.0f, 1.0f);
+        Result.Values[ValueIndex++] = (u16)Round(Value * 32767.0f);
+    }
+    Result.Values[0] |= (u16)((LargestIndex & 1) << 15);
+    Result.Values[1] |= (u16)((LargestIndex >> 1) << 15);
+    return(Result);
+}
+
+lbfn animation_key EncodeVectorKey(const animation_curve* Curve, v3 V)
+{
+    animation_key Result = {};
+    for (u32 Index = 0; Index < 3; Index++)
+    {
+        f32 Value = Clamp(Ratio0(V.E[Index] - Curve->Min.E[Index], Curve->Extent.E[Index]), 0.0f, 1.0f);
+        Result.Values[Index] = (u16)Round(Value * 65535.0f);
+    }
+    return(Result);
+}
+
+lbfn u32 CompressAnimationCurve(animation_channel Channel, u32 SourceCount, const f32* SourceTimes, v4* SourceValues, 
+                                f32 MaxTimestamp, animation_curve* Curve, animation_key* Keys, animation_key* Scratch)
+{
+    Assert(SourceCount > 0);
+
+    f32 Tolerance = 0.0f;
+    switch (Channel)
+    {
+        // NOTE(boti): For unit quaternions |q0 - q1| ~= angle / 2
+        case AnimationChannel_Rotation: Tolerance = 0.5f * animation::RotationTolerance; break;
+        case AnimationChannel_Position: Tolerance = animation::PositionTolerance; break;
+        case AnimationChannel_Scale:    Tolerance = animation::ScaleTolerance; break;
+        InvalidDefaultCase;
+    }
+
+    if (Channel == AnimationChannel_Rotation)
+    {
+        // NOTE(boti): Make the source continuous so that the error is measured along the short arc,
+        // the same way the sampler interpolates
+        SourceValues[0] = Normalize(SourceValues[0]);
+        for (u32 Index = 1; Index < SourceCount; Index++)
+        {
+            SourceValues[Index] = Normalize(SourceValues[Index]);
+            if (Dot(SourceValues[Index], SourceValues[Index - 1]) < 0.0f)
+            {
+                SourceValues[Index] = -SourceValues[Index];
+            }
+        }
+    }
+    else
+    {
+        v3 Min = SourceValues[0].XYZ;
+        v3 Max = SourceValues[0].XYZ;
+        for (u32 Index = 1; Index < SourceCount; Index++)
+        {
+            Min = ::Min(Min, SourceValues[Index].XYZ);
+            Max = ::Max(Max, SourceValues[Index].XYZ);
+        }
+        Curve->Min = Min;
+        Curve->Extent = Max - Min;
+
+        // NOTE(boti): The tolerance can't be tighter than the quantization step of the curve
+        f32 MaxExtent = ::Max(::Max(Curve->Extent.X, Curve->Extent.Y), Curve->Extent.Z);
+        Tolerance = ::Max(Tolerance, MaxExtent * (1.0f / 65535.0f));
+    }
+
+    for (u32 Index = 0; Index < SourceCount; Index++)
+    {
+        if (Channel == AnimationChannel_Rotation)
+        {
+            Scratch[Index] = EncodeRotationKey(SourceValues[Index]);
+        }
+        else
+        {
+            Scratch[Index] = EncodeVectorKey(Curve, SourceValues[Index].XYZ);
+        }
+        Scratch[Index].Time = QuantizeAnimationTime(SourceTimes[Index], MaxTimestamp);
+    }
+
+    // NOTE(boti): The error is always measured between the decoded (quantized) keys and the source, 
+    // so the tolerance bounds the quantization error too
+    auto Decode = [Channel, Curve](const animation_key* Key) -> v4
+    {
+        v4 Result;
+        if (Channel == AnimationChannel_Rotation)
+        {
+            Result = DecodeRotationKey(Key);
+        }
+        else
+        {
+            v3 V = DecodeVectorKey(Curve, Key);
+            Result = { V.X, V.Y, V.Z, 0.0f };
+        }
+        return(Result);
+    };
+    auto IsWithinTolerance = [Channel, Tolerance](v4 A, v4 B) -> b32
+    {
+        b32 Result;
+        if (Channel == AnimationChannel_Rotation)
+        {
+            v4 D0 = A - B;
+            v4 D1 = A + B;
+            Result = Min(Dot(D0, D0), Dot(D1, D1)) <= Tolerance*Tolerance;
+        }
+        else
+        {
+            Result = 
+                (Abs(A.X - B.X) <= Tolerance) &&
+                (Abs(A.Y - B.Y) <= Tolerance) &&
+                (Abs(A.Z - B.Z) <= Tolerance);
+        }
+        return(Result);
+    };
+
+    u32 Result = 0;
+
+    // NOTE(boti): Constant curves collapse to a single key
+    b32 IsConstant = true;
+    {
+        v4 Value = Decode(Scratch + 0);
+        for (u32 Index = 1; Index < SourceCount; Index++)
+        {
+            if (!IsWithinTolerance(Value, SourceValues[Index]))
+            {
+                IsConstant = false;
+                break;
+            }
+        }
+    }
+
+    if (IsConstant)
+    {
+        Keys[Result++] = Scratch[0];
+    }
+    else
+    {
+        // NOTE(boti): Greedy reduction: extend the current segment for as long as 
+        // every source key it skips can be reconstructed from its endpoints
+        Keys[Result++] = Scratch[0];
+        u32 Anchor = 0;
+        for (u32 Candidate = 2; Candidate < SourceCount; Candidate++)
+        {
+            v4 A = Decode(Scratch + Anchor);
+            v4 B = Decode(Scratch + Candidate);
+            f32 SegmentLength = (f32)(Scratch[Candidate].Time - Scratch[Anchor].Time);
+
+            b32 CanSkip = true;
+            for (u32 Index = Anchor + 1; Index < Candidate; Index++)
+            {
+                // NOTE(boti): Interpolate with the quantized key times, the same way the sampler will
+                f32 KeyTime = 65535.0f * Clamp(Ratio0(SourceTimes[Index], MaxTimestamp), 0.0f, 1.0f);
+                f32 t = Clamp(Ratio0(KeyTime - Scratch[Anchor].Time, SegmentLength), 0.0f, 1.0f);
+                v4 Value = (Channel == AnimationChannel_Rotation) ? QLerp(A, B, t) : Lerp(A, B, t);
+                if (!IsWithinTolerance(Value, SourceValues[Index]))
+                {
+                    CanSkip = false;
+                    break;
+                }
+            }
+
+            if (!CanSkip)
+            {
+                Anchor = Candidate - 1;
+                Keys[Result++] = Scratch[Anchor];
+            }
+        }
+        Keys[Result++] = Scratch[SourceCount - 1];
+    }
+
+    return(Result);
+}
+
+//
+// Sampling
+//
+internal u32 FindAnimationKey(const animation_key* Keys, u32 KeyCount, f32 KeyTime)
+{
+    // NOTE(boti): Last key at or before KeyTime, or the first key if there isn't one
+    u32 Result = 0;
+    u32 MinIndex = 1;
+    u32 MaxIndex = KeyCount;
+    while (MinIndex < MaxIndex)
+    {
+        u32 Index = (MinIndex + MaxIndex) / 2;
+        if (Keys[Index].Time <= KeyTime)
+        {
+            Result = Index;
+            MinIndex = Index + 1;
+        }
+        else
+        {
+            MaxIndex = Index;
+        }
+    }
+    return(Result);
+}
+
+internal u32 AdvanceAnimationCursor(const animation_key* Keys, u32 KeyCount, u32 Cursor, f32 KeyTime)
+{
+    // NOTE(boti): The cursor may be stale (e.g. it was used with a different animation), 
+    // it only has to be in range for this to return the correct key
+    u32 Result = Min(Cursor, KeyCount - 1);
+    if (Keys[Result].Time > KeyTime)
+    {
+        // NOTE(boti): Playback went backwards (looped or scrubbed)
+        Result = FindAnimationKey(Keys, KeyCount, KeyTime);
+    }
+    else
+    {
+        while ((Result + 1 < KeyCount) && (Keys[Result + 1].Time <= KeyTime))
+        {
+            Result++;
+        }
+    }
+    return(Result);
+}
+
+internal void 
+DecodeRotationKeys8(__m256i V0, __m256i V1, __m256i V2, __m256 Q[4])
+{
+    constexpr f32 Bound = 0.70710678f;
+    __m256i ValueMask = _mm256_set1_epi32(0x7FFF);
+    __m256 Scale = _mm256_set1_ps(1.0f / 32767.0f);
+    __m256 Range = _mm256_set1_ps(2.0f * Bound);
+    __m256 Bias = _mm256_set1_ps(Bound);
+
+    __m256 a = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(V0, ValueMask)), Scale), Range), Bias);
+    __m256 b = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(V1, ValueMask)), Scale), Range), Bias);
+    __m256 c = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(V2, ValueMask)), Scale), Range), Bias);
+    __m256 LengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)), _mm256_mul_ps(c, c));
+    __m256 Largest = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), LengthSq), _mm256_setzero_ps()));
+
+    __m256i LargestIndex = _mm256_or_si256(_mm256_srli_epi32(V0, 15), _mm256_slli_epi32(_mm256_srli_epi32(V1, 15), 1));
+    __m256 Is0 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(LargestIndex, _mm256_set1_epi32(0)));
+    __m256 Is1 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(LargestIndex, _mm256_set1_epi32(1)));
+    __m256 Is2 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(LargestIndex, _mm256_set1_epi32(2)));
+    __m256 Is3 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(LargestIndex, _mm256_set1_epi32(3)));
+
+    // NOTE(boti): Put the largest component back in its place, see DecodeRotationKey()
+    Q[0] = _mm256_blendv_ps(a, Largest, Is0);
+    Q[1] = _mm256_blendv_ps(_mm256_blendv_ps(b, a, Is0), Largest, Is1);
+    Q[2] = _mm256_blendv_ps(_mm256_blendv_ps(c, b, _mm256_or_ps(Is0, Is1)), Largest, Is2);
+    Q[3] = _mm256_blendv_ps(c, Largest, Is3);
+}
+
+internal void 
+MultiplyQuaternions8(const __m256 A[4], const __m256 B[4], __m256 Out[4])
+{
+    // NOTE(boti): Same as QMul, Out may alias A or B
+    __m256 X = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(A[3], B[0]), _mm256_mul_ps(B[3], A[0])), _mm256_mul_ps(A[1], B[2])), _mm256_mul_ps(A[2], B[1]));
+    __m256 Y = _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(A[3], B[1]), _mm256_mul_ps(A[0], B[2])), _mm256_mul_ps(A[1], B[3])), _mm256_mul_ps(A[2], B[0]));
+    __m256 Z = _mm256_add_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(A[3], B[2]), _mm256_mul_ps(A[0], B[1])), _mm256_mul_ps(A[1], B[0])), _mm256_mul_ps(A[2], B[3]));
+    __m256 W = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(A[3], B[3]), _mm256_mul_ps(A[0], B[0])), _mm256_mul_ps(A[1], B[1])), _mm256_mul_ps(A[2], B[2]));
+    Out[0] = X;
+    Out[1] = Y;
+    Out[2] = Z;
+    Out[3] = W;
+}
+
+internal __m256 GetJointLaneMask(const joint_mask* Mask, u32 BaseJoint)
+{
+    __m256 Result;
+    if (Mask)
+    {
+        // NOTE(boti): BaseJoint is always a multiple of 8, so the bits never straddle two u64s
+        u32 Bits = (u32)(Mask->Bits[BaseJoint / 64] >> (BaseJoint % 64)) & 0xFFu;
+        __m256i LaneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        Result = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((s32)Bits), LaneBits), LaneBits));
+    }
+    else
+    {
+        Result = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    }
+    return(Result);
+}
+
+// NOTE(boti): SSE version of A * B
+internal m4 MultiplyM4(const m4& A, const m4& B)
+{
+    __m128 AX = _mm_loadu_ps(A.X.E);
+    __m128 AY = _mm_loadu_ps(A.Y.E);
+    __m128 AZ = _mm_loadu_ps(A.Z.E);
+    __m128 AP = _mm_loadu_ps(A.P.E);
+
+    m4 Result;
+    for (u32 Column = 0; Column < 4; Column++)
+    {
+        __m128 BC = _mm_loadu_ps(B.C[Column].E);
+        __m128 C = _mm_mul_ps(AX, _mm_shuffle_ps(BC, BC, _MM_SHUFFLE(0, 0, 0, 0)));
+        C = _mm_add_ps(C, _mm_mul_ps(AY, _mm_shuffle_ps(BC, BC, _MM_SHUFFLE(1, 1, 1, 1))));
+        C = _mm_add_ps(C, _mm_mul_ps(AZ, _mm_shuffle_ps(BC, BC, _MM_SHUFFLE(2, 2, 2, 2))));
+        C = _mm_add_ps(C, _mm_mul_ps(AP, _mm_shuffle_ps(BC, BC, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(Result.C[Column].E, C);
+    }
+    return(Result);
+}
+
+
+lbfn void SampleAnimation(skin* Skin, animation* Animation, f32 Time, b32 IsAdditive, u16* Cursors, joint_pose* Pose)
+{
+    u32 AnimatedJointCount = Min(Skin->JointCount, Animation->JointCount);
+    f32 KeyTime = 65535.0f * Clamp(Ratio0(Time, Animation->MaxTimestamp), 0.0f, 1.0f);
+
+    for (u32 BaseJoint = 0; BaseJoint < Skin->JointCount; BaseJoint += 8)
+    {
+        for (u32 Channel = 0; Channel < AnimationChannel_Count; Channel++)
+        {
+            // NOTE(boti): Lanes map directly to joints, lanes without a curve keep the bind pose
+            alignas(32) u32 LaneMask[8];
+            alignas(32) u32 Values0[3][8];
+            alignas(32) u32 Values1[3][8];
+            alignas(32) u32 ReferenceValues[3][8];
+            alignas(32) f32 BlendFactors[8];
+            alignas(32) f32 Mins[3][8];
+            alignas(32) f32 Extents[3][8];
+            for (u32 Lane = 0; Lane < 8; Lane++)
+            {
+                u32 JointIndex = BaseJoint + Lane;
+                animation_curve* Curve = nullptr;
+                if (JointIndex < AnimatedJointCount)
+                {
+                    Curve = GetAnimationCurve(Animation, JointIndex, (animation_channel)Channel);
+                }
+
+                if (Curve && Curve->KeyCount)
+                {
+                    const animation_key* Keys = Animation->Keys + Curve->FirstKey;
+                    u32 KeyIndex;
+                    if (Cursors)
+                    {
+                        u16* Cursor = Cursors + (JointIndex * AnimationChannel_Count + Channel);
+                        KeyIndex = AdvanceAnimationCursor(Keys, Curve->KeyCount, *Cursor, KeyTime);
+                        *Cursor = (u16)Min(KeyIndex, 0xFFFFu);
+                    }
+                    else
+                    {
+                        KeyIndex = FindAnimationKey(Keys, Curve->KeyCount, KeyTime);
+                    }
+                    u32 NextKeyIndex = Min(KeyIndex + 1, Curve->KeyCount - 1);
+                    const animation_key* Key0 = Keys + KeyIndex;
+                    const animation_key* Key1 = Keys + NextKeyIndex;
+
+                    LaneMask[Lane] = 0xFFFFFFFFu;
+                    BlendFactors[Lane] = Clamp(Ratio0(KeyTime - Key0->Time, (f32)(Key1->Time - Key0->Time)), 0.0f, 1.0f);
+                    for (u32 Component = 0; Component < 3; Component++)
+                    {
+                        Values0[Component][Lane] = Key0->Values[Component];
+                        Values1[Component][Lane] = Key1->Values[Component];
+                        ReferenceValues[Component][Lane] = Keys[0].Values[Component];
+                        Mins[Component][Lane] = Curve->Min.E[Component];
+                        Extents[Component][Lane] = Curve->Extent.E[Component];
+                    }
+                }
+                else
+                {
+                    LaneMask[Lane] = 0;
+                    BlendFactors[Lane] = 0.0f;
+                    for (u32 Component = 0; Component < 3; Component++)
+                    {
+                        Values0[Component][Lane] = 0;
+                        Values1[Component][Lane] = 0;
+                        ReferenceValues[Component][Lane] = 0;
+                        Mins[Component][Lane] = 0.0f;
+                        Extents[Component][Lane] = 0.0f;
+                    }
+                }
+            }
+
+            __m256 Mask = _mm256_load_ps((f32*)LaneMask);
+            __m256 t = _mm256_load_ps(BlendFactors);
+            if (Channel == AnimationChannel_Rotation)
+            {
+                __m256 Q0[4], Q1[4];
+                DecodeRotationKeys8(_mm256_load_si256((__m256i*)Values0[0]),
+                                    _mm256_load_si256((__m256i*)Values0[1]),
+                                    _mm256_load_si256((__m256i*)Values0[2]), Q0);
+                DecodeRotationKeys8(_mm256_load_si256((__m256i*)Values1[0]),
+                                    _mm256_load_si256((__m256i*)Values1[1]),
+                                    _mm256_load_si256((__m256i*)Values1[2]), Q1);
+
+                // NOTE(boti): Normalized lerp along the short arc, same as QLerp
+                __m256 Dot = _mm256_setzero_ps();
+                for (u32 Component = 0; Component < 4; Component++)
+                {
+                    Dot = _mm256_add_ps(Dot, _mm256_mul_ps(Q0[Component], Q1[Component]));
+                }
+                __m256 Sign = _mm256_and_ps(Dot, _mm256_set1_ps(-0.0f));
+
+                __m256 Q[4];
+                __m256 LengthSq = _mm256_setzero_ps();
+                for (u32 Component = 0; Component < 4; Component++)
+                {
+                    __m256 B = _mm256_xor_ps(Q1[Component], Sign);
+                    Q[Component] = _mm256_add_ps(Q0[Component], _mm256_mul_ps(t, _mm256_sub_ps(B, Q0[Component])));
+                    LengthSq = _mm256_add_ps(LengthSq, _mm256_mul_ps(Q[Component], Q[Component]));
+                }
+                __m256 InvLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(LengthSq));
+                for (u32 Component = 0; Component < 4; Component++)
+                {
+                    Q[Component] = _mm256_mul_ps(Q[Component], InvLength);
+                }
+
+                if (IsAdditive)
+                {
+                    // NOTE(boti): Delta = conjugate(Reference) * Q
+                    __m256 R[4];
+                    DecodeRotationKeys8(_mm256_load_si256((__m256i*)ReferenceValues[0]),
+                                        _mm256_load_si256((__m256i*)ReferenceValues[1]),
+                                        _mm256_load_si256((__m256i*)ReferenceValues[2]), R);
+                    for (u32 Component = 0; Component < 3; Component++)
+                    {
+                        R[Component] = _mm256_xor_ps(R[Component], _mm256_set1_ps(-0.0f));
+                    }
+                    MultiplyQuaternions8(R, Q, Q);
+                }
+
+                for (u32 Component = 0; Component < 4; Component++)
+                {
+                    __m256 Default;
+                    if (IsAdditive)
+                    {
+                        Default = (Component == 3) ? _mm256_set1_ps(1.0f) : _mm256_setzero_ps();
+                    }
+                    else
+                    {
+                        Default = _mm256_load_ps(Skin->BindPose.Rotation[Component] + BaseJoint);
+                    }
+                    __m256 Value = _mm256_blendv_ps(Default, Q[Component], Mask);
+                    _mm256_store_ps(Pose->Rotation[Component] + BaseJoint, Value);
+                }
+            }
+            else
+            {
+                const f32 (*Bind)[R_MaxJointCount] = (Channel == AnimationChannel_Position) ? Skin->BindPose.Position : Skin->BindPose.Scale;
+                f32 (*Dst)[R_MaxJointCount] = (Channel == AnimationChannel_Position) ? Pose->Position : Pose->Scale;
+
+                __m256 Scale = _mm256_set1_ps(1.0f / 65535.0f);
+                for (u32 Component = 0; Component < 3; Component++)
+                {
+                    __m256 Min = _mm256_load_ps(Mins[Component]);
+                    __m256 Extent = _mm256_load_ps(Extents[Component]);
+                    __m256 V0 = _mm256_cvtepi32_ps(_mm256_load_si256((__m256i*)Values0[Component]));
+                    __m256 V1 = _mm256_cvtepi32_ps(_mm256_load_si256((__m256i*)Values1[Component]));
+                    V0 = _mm256_add_ps(Min, _mm256_mul_ps(Extent, _mm256_mul_ps(V0, Scale)));
+                    V1 = _mm256_add_ps(Min, _mm256_mul_ps(Extent, _mm256_mul_ps(V1, Scale)));
+                    __m256 V = _mm256_add_ps(V0, _mm256_mul_ps(t, _mm256_sub_ps(V1, V0)));
+
+                    __m256 Default;
+                    if (IsAdditive)
+                    {
+                        // NOTE(boti): Positions are offset, scales are multiplied by the delta
+                        __m256 Reference = _mm256_cvtepi32_ps(_mm256_load_si256((__m256i*)ReferenceValues[Component]));
+                        Reference = _mm256_add_ps(Min, _mm256_mul_ps(Extent, _mm256_mul_ps(Reference, Scale)));
+                        if (Channel == AnimationChannel_Position)
+                        {
+                            V = _mm256_sub_ps(V, Reference);
+                            Default = _mm256_setzero_ps();
+                        }
+                        else
+                        {
+                            Default = _mm256_set1_ps(1.0f);
+                            V = _mm256_div_ps(V, _mm256_blendv_ps(Default, Reference, Mask));
+                        }
+                    }
+                    else
+                    {
+                        Default = _mm256_load_ps(Bind[Component] + BaseJoint);
+                    }
+                    V = _mm256_blendv_ps(Default, V, Mask);
+                    _mm256_store_ps(Dst[Component] + BaseJoint, V);
+                }
+            }
+        }
+    }
+}
+
+lbfn void GetLocalJointTransforms(const joint_pose* Pose, u32 JointCount, m4* Transforms)
+{
+    for (u32 BaseJoint = 0; BaseJoint < JointCount; BaseJoint += 8)
+    {
+        __m256 x = _mm256_load_ps(Pose->Rotation[0] + BaseJoint);
+        __m256 y = _mm256_load_ps(Pose->Rotation[1] + BaseJoint);
+        __m256 z = _mm256_load_ps(Pose->Rotation[2] + BaseJoint);
+        __m256 w = _mm256_load_ps(Pose->Rotation[3] + BaseJoint);
+        __m256 One = _mm256_set1_ps(1.0f);
+        __m256 Two = _mm256_set1_ps(2.0f);
+
+        __m256 x2 = _mm256_mul_ps(x, x);
+        __m256 y2 = _mm256_mul_ps(y, y);
+        __m256 z2 = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y);
+        __m256 xz = _mm256_mul_ps(x, z);
+        __m256 wx = _mm256_mul_ps(x, w);
+        __m256 yz = _mm256_mul_ps(y, z);
+        __m256 wy = _mm256_mul_ps(y, w);
+        __m256 wz = _mm256_mul_ps(z, w);
+
+        __m256 Sx = _mm256_load_ps(Pose->Scale[0] + BaseJoint);
+        __m256 Sy = _mm256_load_ps(Pose->Scale[1] + BaseJoint);
+        __m256 Sz = _mm256_load_ps(Pose->Scale[2] + BaseJoint);
+
+        // NOTE(boti): Same as TRSToM4, the columns of the rotation matrix get scaled
+        alignas(32) f32 Out[12][8];
+        _mm256_store_ps(Out[0], _mm256_mul_ps(Sx, _mm256_sub_ps(One, _mm256_mul_ps(Two, _mm256_add_ps(y2, z2)))));
+        _mm256_store_ps(Out[1], _mm256_mul_ps(Sx, _mm256_mul_ps(Two, _mm256_add_ps(xy, wz))));
+        _mm256_store_ps(Out[2], _mm256_mul_ps(Sx, _mm256_mul_ps(Two, _mm256_sub_ps(xz, wy))));
+        _mm256_store_ps(Out[3], _mm256_mul_ps(Sy, _mm256_mul_ps(Two, _mm256_sub_ps(xy, wz))));
+        _mm256_store_ps(Out[4], _mm256_mul_ps(Sy, _mm256_sub_ps(One, _mm256_mul_ps(Two, _mm256_add_ps(x2, z2)))));
+        _mm256_store_ps(Out[5], _mm256_mul_ps(Sy, _mm256_mul_ps(Two, _mm256_add_ps(yz, wx))));
+        _mm256_store_ps(Out[6], _mm256_mul_ps(Sz, _mm256_mul_ps(Two, _mm256_add_ps(xz, wy))));
+        _mm256_store_ps(Out[7], _mm256_mul_ps(Sz, _mm256_mul_ps(Two, _mm256_sub_ps(yz, wx))));
+        _mm256_store_ps(Out[8], _mm256_mul_ps(Sz, _mm256_sub_ps(One, _mm256_mul_ps(Two, _mm256_add_ps(x2, y2)))));
+        _mm256_store_ps(Out[9], _mm256_load_ps(Pose->Position[0] + BaseJoint));
+        _mm256_store_ps(Out[10], _mm256_load_ps(Pose->Position[1] + BaseJoint));
+        _mm256_store_ps(Out[11], _mm256_load_ps(Pose->Position[2] + BaseJoint));
+
+        u32 Count = Min(8u, JointCount - BaseJoint);
+        for (u32 Lane = 0; Lane < Count; Lane++)
+        {
+            m4* Transform = Transforms + BaseJoint + Lane;
+            Transform->X = { Out[0][Lane], Out[1][Lane], Out[2][Lane], 0.0f };
+            Transform->Y = { Out[3][Lane], Out[4][Lane], Out[5][Lane], 0.0f };
+            Transform->Z = { Out[6][Lane], Out[7][Lane], Out[8][Lane], 0.0f };
+            Transform->P = { Out[9][Lane], Out[10][Lane], Out[11][Lane], 1.0f };
+        }
+    }
+}
+
+
+lbfn void GetModelJointTransforms(skin* Skin, const m4* LocalTransforms, u32 FirstJoint, m4* ModelTransforms)
+{
+    // NOTE(boti): Parents always precede their children, so the joints before FirstJoint can't be affected
+    for (u32 JointIndex = FirstJoint; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        u32 ParentIndex = Skin->JointParents[JointIndex];
+        if (ParentIndex != JointIndex)
+        {
+            ModelTransforms[JointIndex] = MultiplyM4(ModelTransforms[ParentIndex], LocalTransforms[JointIndex]);
+        }
+        else
+        {
+            ModelTransforms[JointIndex] = LocalTransforms[JointIndex];
+        }
+    }
+}
+
+//
+// Blending
+//
+
+lbfn void BlendPose(joint_pose* Dst, const joint_pose* Src, u32 JointCount, f32 Weight, const joint_mask* Mask)
+{
+    if (Weight <= 0.0f)
+    {
+        return;
+    }
+
+    for (u32 BaseJoint = 0; BaseJoint < JointCount; BaseJoint += 8)
+    {
+        __m256 t = _mm256_and_ps(GetJointLaneMask(Mask, BaseJoint), _mm256_set1_ps(Weight));
+
+        // NOTE(boti): Normalized lerp along the short arc, same as QLerp
+        __m256 A[4], B[4];
+        __m256 Dot = _mm256_setzero_ps();
+        for (u32 Component = 0; Component < 4; Component++)
+        {
+            A[Component] = _mm256_load_ps(Dst->Rotation[Component] + BaseJoint);
+            B[Component] = _mm256_load_ps(Src->Rotation[Component] + BaseJoint);
+            Dot = _mm256_add_ps(Dot, _mm256_mul_ps(A[Component], B[Component]));
+        }
+        __m256 Sign = _mm256_and_ps(Dot, _mm256_set1_ps(-0.0f));
+
+        __m256 LengthSq = _mm256_setzero_ps();
+        for (u32 Component = 0; Component < 4; Component++)
+        {
+            A[Component] = _mm256_add_ps(A[Component], _mm256_mul_ps(t, _mm256_sub_ps(_mm256_xor_ps(B[Component], Sign), A[Component])));
+            LengthSq = _mm256_add_ps(LengthSq, _mm256_mul_ps(A[Component], A[Component]));
+        }
+        __m256 InvLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(LengthSq));
+        for (u32 Component = 0; Component < 4; Component++)
+        {
+            _mm256_store_ps(Dst->Rotation[Component] + BaseJoint, _mm256_mul_ps(A[Component], InvLength));
+        }
+
+        for (u32 Component = 0; Component < 3; Component++)
+        {
+            __m256 P0 = _mm256_load_ps(Dst->Position[Component] + BaseJoint);
+            __m256 P1 = _mm256_load_ps(Src->Position[Component] + BaseJoint);
+            _mm256_store_ps(Dst->Position[Component] + BaseJoint, _mm256_add_ps(P0, _mm256_mul_ps(t, _mm256_sub_ps(P1, P0))));
+
+            __m256 S0 = _mm256_load_ps(Dst->Scale[Component] + BaseJoint);
+            __m256 S1 = _mm256_load_ps(Src->Scale[Component] + BaseJoint);
+            _mm256_store_ps(Dst->Scale[Component] + BaseJoint, _mm256_add_ps(S0, _mm256_mul_ps(t, _mm256_sub_ps(S1, S0))));
+        }
+    }
+}
+
+lbfn void AddPose(joint_pose* Dst, const joint_pose* Delta, u32 JointCount, f32 Weight, const joint_mask* Mask)
+{
+    if (Weight <= 0.0f)
+    {
+        return;
+    }
+
+    __m256 One = _mm256_set1_ps(1.0f);
+    for (u32 BaseJoint = 0; BaseJoint < JointCount; BaseJoint += 8)
+    {
+        __m256 t = _mm256_and_ps(GetJointLaneMask(Mask, BaseJoint), _mm256_set1_ps(Weight));
+
+        // NOTE(boti): The delta rotation gets scaled by nlerping it from the identity (along the short arc),
+        // then it's applied on the local side: Dst = Dst * Delta
+        __m256 D[4];
+        __m256 Sign = _mm256_and_ps(_mm256_load_ps(Delta->Rotation[3] + BaseJoint), _mm256_set1_ps(-0.0f));
+        __m256 LengthSq = _mm256_setzero_ps();
+        for (u32 Component = 0; Component < 4; Component++)
+        {
+            __m256 Identity = (Component == 3) ? One : _mm256_setzero_ps();
+            __m256 Value = _mm256_xor_ps(_mm256_load_ps(Delta->Rotation[Component] + BaseJoint), Sign);
+            D[Component] = _mm256_add_ps(Identity, _mm256_mul_ps(t, _mm256_sub_ps(Value, Identity)));
+            LengthSq = _mm256_add_ps(LengthSq, _mm256_mul_ps(D[Component], D[Component]));
+        }
+        __m256 InvLength = _mm256_div_ps(One, _mm256_sqrt_ps(LengthSq));
+
+        __m256 Q[4];
+        for (u32 Component = 0; Component < 4; Component++)
+        {
+            D[Component] = _mm256_mul_ps(D[Component], InvLength);
+            Q[Component] = _mm256_load_ps(Dst->Rotation[Component] + BaseJoint);
+        }
+        MultiplyQuaternions8(Q, D, Q);
+        for (u32 Component = 0; Component < 4; Component++)
+        {
+            _mm256_store_ps(Dst->Rotation[Component] + BaseJoint, Q[Component]);
+        }
+
+        for (u32 Component = 0; Component < 3; Component++)
+        {
+            __m256 P = _mm256_load_ps(Dst->Position[Component] + BaseJoint);
+            __m256 dP = _mm256_load_ps(Delta->Position[Component] + BaseJoint);
+            _mm256_store_ps(Dst->Position[Component] + BaseJoint, _mm256_add_ps(P, _mm256_mul_ps(t, dP)));
+
+            __m256 S = _mm256_load_ps(Dst->Scale[Component] + BaseJoint);
+            __m256 dS = _mm256_load_ps(Delta->Scale[Component] + BaseJoint);
+            __m256 Factor = _mm256_add_ps(One, _mm256_mul_ps(t, _mm256_sub_ps(dS, One)));
+            _mm256_store_ps(Dst->Scale[Component] + BaseJoint, _mm256_mul_ps(S, Factor));
+        }
+    }
+}
+
+//
+// IK
+//
+
+// NOTE(boti): Rotates the joint (and its subtree) around its own origin by a model-space rotation
+internal void RotateJoint(skin* Skin, u32 JointIndex, v4 Rotation, m4* LocalTransforms, m4* ModelTransforms)
+{
+    m4 Model = ModelTransforms[JointIndex];
+    m4 RotatedModel = MultiplyM4(QuaternionToM4(Rotation), Model);
+    RotatedModel.P = Model.P;
+
+    u32 ParentIndex = Skin->JointParents[JointIndex];
+    if (ParentIndex != JointIndex)
+    {
+        LocalTransforms[JointIndex] = MultiplyM4(AffineInverse(ModelTransforms[ParentIndex]), RotatedModel);
+    }
+    else
+    {
+        LocalTransforms[JointIndex] = RotatedModel;
+    }
+    GetModelJointTransforms(Skin, LocalTransforms, JointIndex, ModelTransforms);
+}
+
+internal f32 AngleBetween(v3 A, v3 B)
+{
+    f32 Result = ACos(Clamp(Dot(NOZ(A), NOZ(B)), -1.0f, +1.0f));
+    return(Result);
+}
+
+lbfn void SolveTwoBoneIK(skin* Skin, const ik_chain* Chain, v3 Target, f32 Weight, m4* LocalTransforms, m4* ModelTransforms)
+{
+    Assert(Chain->RootJoint < Chain->MiddleJoint && Chain->MiddleJoint < Chain->EndJoint);
+    Assert(Chain->EndJoint < Skin->JointCount);
+
+    v3 A = ModelTransforms[Chain->RootJoint].P.XYZ;
+    v3 B = ModelTransforms[Chain->MiddleJoint].P.XYZ;
+    v3 C = ModelTransforms[Chain->EndJoint].P.XYZ;
+
+    v3 AB = B - A;
+    v3 BC = C - B;
+    v3 AC = C - A;
+    v3 AT = Target - A;
+    f32 LengthAB = VectorLength(AB);
+    f32 LengthBC = VectorLength(BC);
+    if (LengthAB < 1e-6f || LengthBC < 1e-6f)
+    {
+        return;
+    }
+
+    // NOTE(boti): The target distance is clamped so that the chain never fully extends/folds (the bend plane would be undefined)
+    constexpr f32 Epsilon = 1e-4f;
+    f32 LengthAT = Clamp(VectorLength(AT), Abs(LengthAB - LengthBC) + Epsilon, LengthAB + LengthBC - Epsilon);
+
+    // NOTE(boti): Current and desired interior angles at the root and middle joints (law of cosines)
+    f32 CurrentAngleA = AngleBetween(AC, AB);
+    f32 CurrentAngleB = AngleBetween(A - B, BC);
+    f32 TargetAngleA = ACos(Clamp((LengthBC*LengthBC - LengthAB*LengthAB - LengthAT*LengthAT) / (-2.0f * LengthAB * LengthAT), -1.0f, +1.0f));
+    f32 TargetAngleB = ACos(Clamp((LengthAT*LengthAT - LengthAB*LengthAB - LengthBC*LengthBC) / (-2.0f * LengthAB * LengthBC), -1.0f, +1.0f));
+
+    // NOTE(boti): Keep the current bend plane, unless the chain is straight
+    v3 BendAxis = NOZ(Cross(AC, AB));
+    if (Dot(BendAxis, BendAxis) == 0.0f)
+    {
+        BendAxis = NOZ(Cross(AC, Chain->BendHint));
+    }
+    v3 SwingAxis = NOZ(Cross(AC, AT));
+    f32 SwingAngle = AngleBetween(AC, AT);
+    if (Dot(SwingAxis, SwingAxis) == 0.0f)
+    {
+        // NOTE(boti): The target is on the line of the chain (or right at the root), so the swing axis is undefined.
+        // A zero axis would make the rotation non-unit and scale the chain, only a target behind the root needs a half turn.
+        SwingAxis = BendAxis;
+        SwingAngle = (Dot(AC, AT) < 0.0f) ? Pi : 0.0f;
+    }
+
+    v4 Identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+    v4 MiddleRotation = QuatFromAxisAngle(BendAxis, TargetAngleB - CurrentAngleB);
+    v4 RootRotation = QMul(QuatFromAxisAngle(SwingAxis, SwingAngle),
+                           QuatFromAxisAngle(BendAxis, TargetAngleA - CurrentAngleA));
+    if (Weight < 1.0f)
+    {
+        MiddleRotation = QLerp(Identity, MiddleRotation, Weight);
+        RootRotation = QLerp(Identity, RootRotation, Weight);
+    }
+
+    // NOTE(boti): Both rotations are relative to the original model-space pose,
+    // the middle joint is rotated first so that the root rotation carries it along
+    RotateJoint(Skin, Chain->MiddleJoint, MiddleRotation, LocalTransforms, ModelTransforms);
+    RotateJoint(Skin, Chain->RootJoint, RootRotation, LocalTransforms, ModelTransforms);
+}
+
+//
+// Animator
+//
+
+lbfn void InitAnimator(animator* Animator, u32 SkinID)
+{
+    memset(Animator, 0, sizeof(*Animator));
+    Animator->SkinID = SkinID;
+    Animator->IsPlaying = false;
+}
+
+lbfn void PlayAnimation(animator* Animator, u32 AnimationID, f32 FadeTime)
+{
+    if (Animator->BaseLayerCount == Animator->MaxBaseLayerCount)
+    {
+        // NOTE(boti): Drop the oldest layer, this pops if we're cross-fading too often
+        for (u32 LayerIndex = 1; LayerIndex < Animator->BaseLayerCount; LayerIndex++)
+        {
+            Animator->BaseLayers[LayerIndex - 1] = Animator->BaseLayers[LayerIndex];
+        }
+        Animator->BaseLayerCount--;
+    }
+
+    b32 IsInstant = (Animator->BaseLayerCount == 0) || (FadeTime <= 0.0f);
+
+    animation_layer* Layer = Animator->BaseLayers + Animator->BaseLayerCount++;
+    memset(Layer, 0, sizeof(*Layer));
+    Layer->AnimationID = AnimationID;
+    Layer->Weight = IsInstant ? 1.0f : 0.0f;
+    Layer->TargetWeight = 1.0f;
+    Layer->FadeRate = IsInstant ? 0.0f : 1.0f / FadeTime;
+    Layer->Time = 0.0f;
+}
+
+lbfn animation_layer* GetCurrentBaseLayer(animator* Animator)
+{
+    animation_layer* Result = nullptr;
+    if (Animator->BaseLayerCount)
+    {
+        Result = Animator->BaseLayers + (Animator->BaseLayerCount - 1);
+    }
+    return(Result);
+}
+
+lbfn u32 AddAnimationLayer(animator* Animator, u32 AnimationID, animation_layer_mode Mode, f32 Weight, const joint_mask* Mask)
+{
+    u32 Result = U32_MAX;
+    if (Animator->LayerCount < Animator->MaxLayerCount)
+    {
+        Result = Animator->LayerCount++;
+        animation_layer* Layer = Animator->Layers + Result;
+        memset(Layer, 0, sizeof(*Layer));
+        Layer->AnimationID = AnimationID;
+        Layer->Mode = Mode;
+        if (Mask)
+        {
+            Layer->Mask = *Mask;
+        }
+        else
+        {
+            memset(&Layer->Mask, 0xFF, sizeof(Layer->Mask));
+        }
+        Layer->Weight = Weight;
+        Layer->TargetWeight = Weight;
+        Layer->FadeRate = 0.0f;
+        Layer->Time = 0.0f;
+    }
+    return(Result);
+}
+
+lbfn void SetAnimationLayerWeight(animator* Animator, u32 LayerIndex, f32 Weight, f32 FadeTime)
+{
+    Assert(LayerIndex < Animator->LayerCount);
+    animation_layer* Layer = Animator->Layers + LayerIndex;
+    Layer->TargetWeight = Weight;
+    Layer->FadeRate = (FadeTime > 0.0f) ? Abs(Weight - Layer->Weight) / FadeTime : 0.0f;
+}
+
+internal void UpdateAnimationLayer(animation_layer* Layer, assets* Assets, b32 IsPlaying, f32 dt)
+{
+    Assert(Layer->AnimationID < Assets->AnimationCount);
+    animation* Animation = Assets->Animations + Layer->AnimationID;
+    if (IsPlaying)
+    {
+        Layer->Time = Modulo0(Layer->Time + dt, Animation->MaxTimestamp);
+    }
+
+    if (Layer->FadeRate > 0.0f)
+    {
+        f32 Step = Layer->FadeRate * dt;
+        if (Layer->Weight < Layer->TargetWeight)
+        {
+            Layer->Weight = Min(Layer->Weight + Step, Layer->TargetWeight);
+        }
+        else
+        {
+            Layer->Weight = Max(Layer->Weight - Step, Layer->TargetWeight);
+        }
+    }
+    else
+    {
+        Layer->Weight = Layer->TargetWeight;
+    }
+}
+
+lbfn void UpdateAnimator(animator* Animator, assets* Assets, f32 dt)
+{
+    for (u32 LayerIndex = 0; LayerIndex < Animator->BaseLayerCount; LayerIndex++)
+    {
+        UpdateAnimationLayer(Animator->BaseLayers + LayerIndex, Assets, Animator->IsPlaying, dt);
+    }
+    for (u32 LayerIndex = 0; LayerIndex < Animator->LayerCount; LayerIndex++)
+    {
+        UpdateAnimationLayer(Animator->Layers + LayerIndex, Assets, Animator->IsPlaying, dt);
+    }
+
+    // NOTE(boti): Layers below a fully faded-in base layer don't contribute anything
+    for (u32 LayerIndex = Animator->BaseLayerCount; LayerIndex > 1; LayerIndex--)
+    {
+        u32 FirstLayer = LayerIndex - 1;
+        if (Animator->BaseLayers[FirstLayer].Weight >= 1.0f)
+        {
+            for (u32 Index = FirstLayer; Index < Animator->BaseLayerCount; Index++)
+            {
+                Animator->BaseLayers[Index - FirstLayer] = Animator->BaseLayers[Index];
+            }
+            Animator->BaseLayerCount -= FirstLayer;
+            break;
+        }
+    }
+}
+
+lbfn void EvaluateAnimator(animator* Animator, assets* Assets)
+{
+    Assert(Animator->SkinID < Assets->SkinCount);
+    Assert(Animator->Pose.Transforms);
+    skin* Skin = Assets->Skins + Animator->SkinID;
+    Assert(Animator->Pose.JointCount == Skin->JointCount);
+
+    joint_pose Pose;
+    joint_pose Sample;
+
+    // NOTE(boti): Only the base layers starting at the topmost fully weighted one need to be sampled
+    u32 FirstBaseLayer = 0;
+    for (u32 LayerIndex = Animator->BaseLayerCount; LayerIndex > 0; LayerIndex--)
+    {
+        if (Animator->BaseLayers[LayerIndex - 1].Weight >= 1.0f)
+        {
+            FirstBaseLayer = LayerIndex - 1;
+            break;
+        }
+    }
+
+    if ((FirstBaseLayer < Animator->BaseLayerCount) && (Animator->BaseLayers[FirstBaseLayer].Weight >= 1.0f))
+    {
+        animation_layer* Layer = Animator->BaseLayers + FirstBaseLayer++;
+        SampleAnimation(Skin, Assets->Animations + Layer->AnimationID, Layer->Time, false, Layer->Cursors, &Pose);
+    }
+    else
+    {
+        Pose = Skin->BindPose;
+    }
+
+    for (u32 LayerIndex = FirstBaseLayer; LayerIndex < Animator->BaseLayerCount; LayerIndex++)
+    {
+        animation_layer* Layer = Animator->BaseLayers + LayerIndex;
+        if (Layer->Weight > 0.0f)
+        {
+            SampleAnimation(Skin, Assets->Animations + Layer->AnimationID, Layer->Time, false, Layer->Cursors, &Sample);
+            BlendPose(&Pose, &Sample, Skin->JointCount, Layer->Weight, nullptr);
+        }
+    }
+
+    for (u32 LayerIndex = 0; LayerIndex < Animator->LayerCount; LayerIndex++)
+    {
+        animation_layer* Layer = Animator->Layers + LayerIndex;
+        if (Layer->Weight > 0.0f)
+        {
+            b32 IsAdditive = (Layer->Mode == AnimationLayer_Additive);
+            SampleAnimation(Skin, Assets->Animations + Layer->AnimationID, Layer->Time, IsAdditive, Layer->Cursors, &Sample);
+            if (IsAdditive)
+            {
+                AddPose(&Pose, &Sample, Skin->JointCount, Layer->Weight, &Layer->Mask);
+            }
+            else
+            {
+                BlendPose(&Pose, &Sample, Skin->JointCount, Layer->Weight, &Layer->Mask);
+            }
+        }
+    }
+
+    m4 LocalTransforms[R_MaxJointCount];
+    m4 ModelTransforms[R_MaxJointCount];
+    GetLocalJointTransforms(&Pose, Skin->JointCount, LocalTransforms);
+    GetModelJointTransforms(Skin, LocalTransforms, 0, ModelTransforms);
+
+    for (u32 ChainIndex = 0; ChainIndex < Skin->IKChainCount; ChainIndex++)
+    {
+        if (Animator->IKWeights[ChainIndex] > 0.0f)
+        {
+            SolveTwoBoneIK(Skin, Skin->IKChains + ChainIndex, Animator->IKTargets[ChainIndex], Animator->IKWeights[ChainIndex], 
+                           LocalTransforms, ModelTransforms);
+        }
+    }
+
+    // NOTE(boti): This _cannot_ be folded into the model transform propagation, because the parent transforms must not contain
+    // the inverse bind transform when propagating the transforms down the hierarchy
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        Animator->Pose.Transforms[JointIndex] = MultiplyM4(ModelTransforms[JointIndex], Skin->InverseBindMatrices[JointIndex]);
+    }
+}
+
+// NOTE(boti): Animators that only play a single, fully weighted base layer (without overlays or IK) 
+// evaluate to the same pose when playing the same animation at the same time
+internal b32 GetSharedPoseKey(animator* Animator, u32* AnimationID, f32* Time)
+{
+    b32 Result = false;
+    if ((Animator->BaseLayerCount == 1) && (Animator->BaseLayers[0].Weight >= 1.0f))
+    {
+        Result = true;
+        for (u32 LayerIndex = 0; LayerIndex < Animator->LayerCount; LayerIndex++)
+        {
+            if (Animator->Layers[LayerIndex].Weight > 0.0f)
+            {
+                Result = false;
+            }
+        }
+        for (u32 ChainIndex = 0; ChainIndex < skin::MaxIKChainCount; ChainIndex++)
+        {
+            if (Animator->IKWeights[ChainIndex] > 0.0f)
+            {
+                Result = false;
+            }
+        }
+
+        *AnimationID = Animator->BaseLayers[0].AnimationID;
+        *Time = Animator->BaseLayers[0].Time;
+    }
+    return(Result);
+}
+
+internal void 
+EvaluateAnimatorsJob(thread_context* ThreadContext, void* Params)
+{
+    TimedFunctionMT(Platform.Profiler, ThreadContext->ThreadID);
+
+    animator_job* Job = (animator_job*)Params;
+    for (u32 AnimatorIndex = 0; AnimatorIndex < Job->AnimatorCount; AnimatorIndex++)
+    {
+        EvaluateAnimator(Job->Animators[AnimatorIndex], Job->Assets);
+    }
+}
+
+lbfn void EvaluateAnimators(assets* Assets, render_frame* Frame, u32 AnimatorCount, animator** Animators, 
+                            thread_context* ThreadContext, memory_arena* Arena)
+{
+    TimedFunction(Platform.Profiler);
+
+    memory_arena_checkpoint Checkpoint = ArenaCheckpoint(Arena);
+
+    // NOTE(boti): Open-addressed table of the shareable poses, the entries are indices into UniqueAnimators + 1
+    u32 TableSize = 1;
+    while (TableSize < 2 * AnimatorCount)
+    {
+        TableSize <<= 1;
+    }
+    u32* Table = PushArray(Arena, MemPush_Clear, u32, TableSize);
+
+    u32 UniqueAnimatorCount = 0;
+    animator** UniqueAnimators = PushArray(Arena, 0, animator*, AnimatorCount);
+    for (u32 AnimatorIndex = 0; AnimatorIndex < AnimatorCount; AnimatorIndex++)
+    {
+        animator* Animator = Animators[AnimatorIndex];
+        Assert(Animator->SkinID < Assets->SkinCount);
+        skin* Skin = Assets->Skins + Animator->SkinID;
+
+        u32 AnimationID;
+        f32 Time;
+        u32* Slot = nullptr;
+        if (GetSharedPoseKey(Animator, &AnimationID, &Time))
+        {
+            u32 TimeBits;
+            memcpy(&TimeBits, &Time, sizeof(TimeBits));
+            u32 Hash = (Animator->SkinID * 0x9E3779B1u) ^ (AnimationID * 0x85EBCA77u) ^ (TimeBits * 0xC2B2AE3Du);
+            for (u32 Probe = 0; Probe < TableSize; Probe++)
+            {
+                u32* Candidate = Table + ((Hash + Probe) & (TableSize - 1));
+                if (*Candidate == 0)
+                {
+                    Slot = Candidate;
+                    break;
+                }
+
+                animator* Other = UniqueAnimators[*Candidate - 1];
+                u32 OtherAnimationID;
+                f32 OtherTime;
+                GetSharedPoseKey(Other, &OtherAnimationID, &OtherTime);
+                if ((Other->SkinID == Animator->SkinID) && (OtherAnimationID == AnimationID) && (OtherTime == Time))
+                {
+                    Animator->Pose = Other->Pose;
+                    Animator = nullptr;
+                    break;
+                }
+            }
+        }
+
+        if (Animator)
+        {
+            Animator->Pose = AllocatePose(Frame, Skin->JointCount);
+            if (Animator->Pose.Transforms)
+            {
+                UniqueAnimators[UniqueAnimatorCount++] = Animator;
+                if (Slot)
+                {
+                    *Slot = UniqueAnimatorCount;
+                }
+            }
+            else
+            {
+                UnhandledError("Out of BAR memory for animation poses");
+            }
+        }
+    }
+
+    constexpr u32 AnimatorsPerJob = 8;
+    u32 JobCount = CeilDiv(UniqueAnimatorCount, AnimatorsPerJob);
+    animator_job* Jobs = PushArray(Arena, 0, animator_job, JobCount);
+    for (u32 JobIndex = 0; JobIndex < JobCount; JobIndex++)
+    {
+        animator_job* Job = Jobs + JobIndex;
+        u32 FirstAnimator = JobIndex * AnimatorsPerJob;
+        Job->Assets = Assets;
+        Job->Animators = UniqueAnimators + FirstAnimator;
+        Job->AnimatorCount = Min(AnimatorsPerJob, UniqueAnimatorCount - FirstAnimator);
+        Platform.AddWorkEntry(Platform.Queue, EvaluateAnimatorsJob, Job);
+    }
+
+    // NOTE(boti): The calling thread helps out with the evaluation too
+    Platform.CompleteAllWork(Platform.Queue, ThreadContext);
+    RestoreArena(Arena, Checkpoint);
+}
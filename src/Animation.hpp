@@ -0,0 +1,150 @@
+//
+// Compression
+//
+
+lbfn u16 QuantizeAnimationTime(f32 Time, f32 MaxTimestamp);
+// NOTE(boti): q and -q encode to the same key, see animation_key for the layout
+lbfn animation_key EncodeRotationKey(v4 Q);
+lbfn animation_key EncodeVectorKey(const animation_curve* Curve, v3 V);
+// NOTE(boti): Quantizes the source keys and drops the ones that can be reconstructed (within tolerance)
+// by interpolating their neighbors, returns the number of keys written to Keys.
+// SourceValues gets modified, Scratch must be able to hold SourceCount keys.
+lbfn u32 CompressAnimationCurve(animation_channel Channel, u32 SourceCount, const f32* SourceTimes, v4* SourceValues,
+                                f32 MaxTimestamp, animation_curve* Curve, animation_key* Keys, animation_key* Scratch);
+
+//
+// Sampling
+//
+
+// NOTE(boti): Samples the local pose of the skin at Time, joints without curves in the animation get their bind pose.
+// Additive samples are relative to the first key of each curve (joints without curves get the identity transform).
+// Cursors (one per curve, optional) cache the last sampled keys, they don't need to be reset when switching animations.
+lbfn void SampleAnimation(skin* Skin, animation* Animation, f32 Time, b32 IsAdditive, u16* Cursors, joint_pose* Pose);
+// NOTE(boti): Converts the pose to parent-relative matrices (8 joints at a time)
+lbfn void GetLocalJointTransforms(const joint_pose* Pose, u32 JointCount, m4* Transforms);
+// NOTE(boti): Propagates the parent-relative transforms down the hierarchy, starting at FirstJoint
+lbfn void GetModelJointTransforms(skin* Skin, const m4* LocalTransforms, u32 FirstJoint, m4* ModelTransforms);
+
+//
+// Blending
+//
+
+inline joint_mask MakeJointMask(skin* Skin, u32 RootJoint);
+
+// NOTE(boti): Dst = nlerp(Dst, Src, Weight) for the joints in the mask, a null mask means all joints
+lbfn void BlendPose(joint_pose* Dst, const joint_pose* Src, u32 JointCount, f32 Weight, const joint_mask* Mask);
+// NOTE(boti): Applies an additive sample on top of Dst
+lbfn void AddPose(joint_pose* Dst, const joint_pose* Delta, u32 JointCount, f32 Weight, const joint_mask* Mask);
+
+//
+// IK
+//
+
+// NOTE(boti): Rotates the root and middle joints of the chain so that the end joint reaches Target (in model space),
+// keeping the current bend plane of the chain. The model transforms are updated to match.
+lbfn void SolveTwoBoneIK(skin* Skin, const ik_chain* Chain, v3 Target, f32 Weight, m4* LocalTransforms, m4* ModelTransforms);
+
+//
+// Animator
+//
+enum animation_layer_mode : u32
+{
+    // NOTE(boti): Replaces the pose below the layer (for the joints in the mask)
+    AnimationLayer_Override = 0,
+    // NOTE(boti): Gets added on top of the pose below the layer (for the joints in the mask),
+    // the animation is sampled relative to its first frame
+    AnimationLayer_Additive,
+};
+
+struct animation_layer
+{
+    u32 AnimationID;
+    animation_layer_mode Mode; // NOTE(boti): Ignored for base layers
+    joint_mask Mask; // NOTE(boti): Ignored for base layers
+    f32 Weight;
+    f32 TargetWeight;
+    f32 FadeRate; // NOTE(boti): Weight change per second when approaching the target weight, 0 means instant
+    f32 Time;
+    u16 Cursors[R_MaxJointCount * AnimationChannel_Count];
+};
+
+struct animator
+{
+    // NOTE(boti): Base layers are full-body animations that PlayAnimation() cross-fades between,
+    // the newest one is at the top of the stack. The older ones get removed once the top fully faded in.
+    static constexpr u32 MaxBaseLayerCount = 3;
+    // NOTE(boti): Overlay layers are evaluated in order on top of the base layers, 
+    // they're never removed so their indices stay valid
+    static constexpr u32 MaxLayerCount = 4;
+
+    u32 SkinID;
+    b32 IsPlaying;
+    u32 BaseLayerCount;
+    animation_layer BaseLayers[MaxBaseLayerCount];
+    u32 LayerCount;
+    animation_layer Layers[MaxLayerCount];
+
+    // NOTE(boti): Model-space targets for the IK chains of the skin, chains with 0 weight are skipped
+    v3 IKTargets[skin::MaxIKChainCount];
+    f32 IKWeights[skin::MaxIKChainCount];
+
+    // NOTE(boti): Skinning transforms (model-space transform * inverse bind matrix) written by EvaluateAnimator(),
+    // the memory is provided by the caller. Only valid for the current frame.
+    renderer_pose Pose;
+};
+
+lbfn void InitAnimator(animator* Animator, u32 SkinID);
+// NOTE(boti): Cross-fades from the current base layers to the new animation
+lbfn void PlayAnimation(animator* Animator, u32 AnimationID, f32 FadeTime);
+// NOTE(boti): Returns the topmost base layer, or nullptr if nothing has been played yet
+lbfn animation_layer* GetCurrentBaseLayer(animator* Animator);
+// NOTE(boti): Returns the index of the new layer, or U32_MAX if the animator is full. A null mask means all joints.
+lbfn u32 AddAnimationLayer(animator* Animator, u32 AnimationID, animation_layer_mode Mode, f32 Weight, const joint_mask* Mask);
+lbfn void SetAnimationLayerWeight(animator* Animator, u32 LayerIndex, f32 Weight, f32 FadeTime);
+// NOTE(boti): Advances the playback and the fades
+lbfn void UpdateAnimator(animator* Animator, assets* Assets, f32 dt);
+// NOTE(boti): Writes Animator->Pose, safe to call from worker threads
+lbfn void EvaluateAnimator(animator* Animator, assets* Assets);
+
+struct animator_job
+{
+    assets* Assets;
+    animator** Animators;
+    u32 AnimatorCount;
+
+    u32 Padding[11];
+};
+static_assert(sizeof(animator_job) % 64 == 0);
+
+// NOTE(boti): Allocates the poses in the BAR buffer of the frame, then evaluates the animators on the work queue 
+// and waits for them to finish. Animators that would evaluate to the same pose share a single one.
+lbfn void EvaluateAnimators(assets* Assets, render_frame* Frame, u32 AnimatorCount, animator** Animators, 
+                            thread_context* ThreadContext, memory_arena* Arena);
+
+//
+// Implementation
+//
+
+inline joint_mask MakeJointMask(skin* Skin, u32 RootJoint)
+{
+    joint_mask Result = {};
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        // NOTE(boti): Parents always precede their children, so it's enough to check the direct parent
+        u32 ParentIndex = Skin->JointParents[JointIndex];
+        u32 ParentArrayIndex, ParentBitIndex;
+        b32 IsInSubtree = (JointIndex == RootJoint);
+        if (!IsInSubtree && (ParentIndex != JointIndex) &&
+            JointMaskIndexFromJointIndex(ParentIndex, &ParentArrayIndex, &ParentBitIndex))
+        {
+            IsInSubtree = (Result.Bits[ParentArrayIndex] >> ParentBitIndex) & 1;
+        }
+
+        u32 ArrayIndex, BitIndex;
+        if (IsInSubtree && JointMaskIndexFromJointIndex(JointIndex, &ArrayIndex, &BitIndex))
+        {
+            Result.Bits[ArrayIndex] |= (1llu << BitIndex);
+        }
+    }
+    return(Result);
+}
@@ -20,6 +20,8 @@ lbfn b32 InitializeAssets(assets* Assets, render_frame* Frame, memory_arena* Scr
         Queue->RingBufferMemory = (u8*)PushSize_(&Assets->Arena, 0, Queue->RingBufferSize, KiB(4));
     }
 
+    InitAssetTextureIndex(&Assets->RendererTextureIndex);
+
     // Default textures
     {
         // NOTE(boti): We want the the null texture to be some sensible default
@@ -36,7 +38,7 @@ lbfn b32 InitializeAssets(assets* Assets, render_frame* Frame, memory_arena* Scr
             };
             Assets->WhitenessID = Assets->TextureCount++;
             texture* Whiteness = Assets->Textures + Assets->WhitenessID;
-            Whiteness->RendererID = Platform.AllocateTexture(Frame->Renderer, TextureFlag_PersistentMemory, &Info, {});
+            Whiteness->RendererID = AllocateAssetTexture(Assets, Frame, Assets->WhitenessID, TextureFlag_PersistentMemory, &Info, {});
 
             u32 Texel = 0xFFFFFFFFu;
             TransferTexture(Frame, Whiteness->RendererID, Info, AllTextureSubresourceRange(), &Texel);
@@ -54,7 +56,7 @@ lbfn b32 InitializeAssets(assets* Assets, render_frame* Frame, memory_arena* Scr
 
             Assets->HalfGrayID = Assets->TextureCount++;
             texture* HalfGray = Assets->Textures + Assets->HalfGrayID;
-            HalfGray->RendererID = Platform.AllocateTexture(Frame->Renderer, TextureFlag_PersistentMemory, &Info, {});
+            HalfGray->RendererID = AllocateAssetTexture(Assets, Frame, Assets->HalfGrayID, TextureFlag_PersistentMemory, &Info, {});
 
             u32 Texel = 0x80808080u;
             TransferTexture(Frame, HalfGray->RendererID, Info, AllTextureSubresourceRange(), &Texel);
@@ -72,27 +74,19 @@ lbfn b32 InitializeAssets(assets* Assets, render_frame* Frame, memory_arena* Scr
     {
         skin* NullSkin = Assets->Skins + Assets->SkinCount++;
         NullSkin->JointCount = 0;
+        NullSkin->IKChainCount = 0;
     }
 
     // Null animation
     {
         animation* NullAnimation = Assets->Animations + Assets->AnimationCount++;
         NullAnimation->SkinID = 0;
-        NullAnimation->KeyFrameCount = 1;
+        NullAnimation->JointCount = 0;
         NullAnimation->MinTimestamp = 0.0f;
         NullAnimation->MaxTimestamp = 0.0f;
-        NullAnimation->KeyFrameTimestamps = PushArray(&Assets->Arena, 0, f32, 1);
-        NullAnimation->KeyFrameTimestamps[0] = 0.0f;
-        NullAnimation->KeyFrames = PushArray(&Assets->Arena, 0, animation_key_frame, 1);
-        for (u32 JointIndex = 0; JointIndex < R_MaxJointCount; JointIndex++)
-        {
-            NullAnimation->KeyFrames[0].JointTransforms[JointIndex] = 
-            {
-                .Rotation = { 0.0f, 0.0f, 0.0f, 1.0f },
-                .Position = { 0.0f, 0.0f, 0.0f},
-                .Scale = { 1.0f, 1.0f, 1.0f },
-            };
-        }
+        NullAnimation->KeyCount = 0;
+        NullAnimation->Curves = nullptr;
+        NullAnimation->Keys = nullptr;
         NullAnimation->ActiveJoints = {};
     }
 
@@ -100,7 +94,7 @@ lbfn b32 InitializeAssets(assets* Assets, render_frame* Frame, memory_arena* Scr
     {
         Assets->ParticleArrayID = Assets->TextureCount++;
         texture* ParticleArray = Assets->Textures + Assets->ParticleArrayID;
-        ParticleArray->RendererID = Platform.AllocateTexture(Frame->Renderer, TextureFlag_PersistentMemory, nullptr, {});
+        ParticleArray->RendererID = AllocateAssetTexture(Assets, Frame, Assets->ParticleArrayID, TextureFlag_PersistentMemory, nullptr, {});
 
         memory_arena_checkpoint Checkpoint = ArenaCheckpoint(Scratch);
 
@@ -158,166 +152,351 @@ lbfn b32 InitializeAssets(assets* Assets, render_frame* Frame, memory_arena* Scr
     return(Result);
 }
 
-lbfn void ProcessTextureRequests(assets* Assets, render_frame* Frame)
+lbfn renderer_texture_id AllocateAssetTexture(assets* Assets, render_frame* Frame, u32 TextureIndex, 
+                                             texture_flags Flags, const texture_info* Info, renderer_texture_id Placeholder)
 {
-    // Collect textures loaded this frame
-    u64 IOCompletion = Platform.GetIOCompletion(Platform.IOQueue);
+    renderer_texture_id Result = Platform.AllocateTexture(Frame->Renderer, Flags, Info, Placeholder);
+    if (IsValid(Result))
+    {
+        SetAssetTextureIndex(&Assets->RendererTextureIndex, Result, TextureIndex);
+    }
+    return(Result);
+}
 
-    struct processed_texture
+lbfn void LoadTextureMetadata(assets* Assets, u32 Count, const u32* TextureIndices)
+{
+    texture_metadata_queue* Queue = &Assets->MetadataQueue;
+    for (u32 Index = 0; Index < Count; Index++)
     {
-        texture* Texture;
-        dds_file* File;
-    };
-    u32 ProcessedTextureCount = 0;
-    processed_texture ProcessedTextures[texture_load_queue::MaxEntryCount];
+        texture* Texture = Assets->Textures + TextureIndices[Index];
+        if (Texture->File.IsValid && (Texture->File.ByteCount >= sizeof(dds_file)) &&
+            (Queue->WriteAt - Queue->ReadAt < Queue->MaxEntryCount))
+        {
+            u32 EntryIndex = Queue->WriteAt++ % Queue->MaxEntryCount;
+            Queue->TextureIndices[EntryIndex] = TextureIndices[Index];
+            Queue->Headers[EntryIndex] = {};
+            Queue->IOCompletions[EntryIndex] = Platform.PushIORequest(Platform.IOQueue, Texture->File, 0, sizeof(dds_file), Queue->Headers + EntryIndex);
+            Texture->IsMetadataPending = true;
+        }
+    }
+}
 
+lbfn void ProcessTextureRequests(assets* Assets, render_frame* Frame)
+{
     texture_load_queue* Queue = &Assets->LoadQueue;
-    for (; Queue->ReadAt < Queue->WriteAt; Queue->ReadAt++)
+    u64 IOCompletion = Platform.GetIOCompletion(Platform.IOQueue);
+
+    // Fill in the metadata of the textures whose header reads have completed
     {
-        u32 Index = Queue->ReadAt % Queue->MaxEntryCount;
-        texture_load_entry* Entry = Queue->Entries + Index;
-        if (Entry->IOCompletion < IOCompletion)
+        texture_metadata_queue* MetadataQueue = &Assets->MetadataQueue;
+        for (; MetadataQueue->ReadAt < MetadataQueue->WriteAt; MetadataQueue->ReadAt++)
         {
-            Queue->RingBufferReadAt = Entry->RingBufferOffset + Entry->Texture->File.ByteCount;
-            umm Offset = Entry->RingBufferOffset % Queue->RingBufferSize;
-            ProcessedTextures[ProcessedTextureCount++] =
+            u32 EntryIndex = MetadataQueue->ReadAt % MetadataQueue->MaxEntryCount;
+            if (MetadataQueue->IOCompletions[EntryIndex] >= IOCompletion)
             {
-                .Texture = Entry->Texture,
-                .File = (dds_file*)OffsetPtr(Queue->RingBufferMemory, Offset),
-            };
+                break;
+            }
 
-            Entry->Texture->HasIORequest = false;
+            texture* Texture = Assets->Textures + MetadataQueue->TextureIndices[EntryIndex];
+            dds_file* Header = MetadataQueue->Headers + EntryIndex;
+            if (Header->Magic == DDSMagic)
+            {
+                Texture->Info =
+                {
+                    .Extent = { Header->Header.Width, Header->Header.Height, 1 },
+                    .MipCount = Header->Header.MipMapCount,
+                    .ArrayCount = Header->DX10Header.ArrayCount,
+                    .Format = DXGIFormatTable[Header->DX10Header.Format],
+                    .Swizzle = *(texture_swizzle*)&Header->Header.Swizzle,
+                };
+                Texture->DataOffset = sizeof(dds_file);
+            }
+            Texture->IsMetadataPending = false;
         }
-        else
+    }
+
+    // NOTE(boti): Requests in priority order (highest first)
+    u32 RequestCount = Frame->TextureRequestCount;
+    u32* RequestOrder = PushArray(Frame->Arena, 0, u32, RequestCount);
+    {
+        u32* Keys = PushArray(Frame->Arena, 0, u32, RequestCount);
+        u32* TempKeys = PushArray(Frame->Arena, 0, u32, RequestCount);
+        u32* TempValues = PushArray(Frame->Arena, 0, u32, RequestCount);
+        for (u32 RequestIndex = 0; RequestIndex < RequestCount; RequestIndex++)
         {
-            break;
+            Keys[RequestIndex] = U32_MAX - Frame->TextureRequests[RequestIndex].Priority;
+            RequestOrder[RequestIndex] = RequestIndex;
         }
+        RadixSort32(RequestCount, Keys, RequestOrder, TempKeys, TempValues);
     }
 
-    // NOTE(boti): We collect the textures to upload separately, 
-    // because we only want to start writing to the ring buffer, once we uploaded everyone for this frame
-    u32 TexturesToLoadCount = 0;
-    texture** TexturesToLoad = PushArray(Frame->Arena, 0, texture*, Frame->TextureRequestCount);
-    for (u32 RequestIndex = 0; RequestIndex < Frame->TextureRequestCount; RequestIndex++)
+    // Collect textures loaded since the last frame
+    u32 LoadedCount = 0;
+    texture_load_entry* LoadedEntries[texture_load_queue::MaxEntryCount];
+    b32 IsLoadedEntryRequested[texture_load_queue::MaxEntryCount] = {};
+    for (u32 At = Queue->ReadAt; At < Queue->WriteAt; At++)
     {
-        texture_request* Request = Frame->TextureRequests + RequestIndex;
-
-        processed_texture* Target = nullptr;
-        for (u32 TextureIndex = 0; TextureIndex < ProcessedTextureCount; TextureIndex++)
+        texture_load_entry* Entry = Queue->Entries + (At % Queue->MaxEntryCount);
+        if (Entry->State == TextureLoad_Pending)
         {
-            processed_texture* Candidate = ProcessedTextures + TextureIndex;
-            if (Candidate->Texture->RendererID.Value == Request->TextureID.Value)
+            if (Entry->IOCompletion < IOCompletion)
+            {
+                // NOTE(boti): Textures without metadata get loaded whole, the info comes from the header in that case
+                if (Entry->FileOffset == 0)
+                {
+                    dds_file* File = (dds_file*)OffsetPtr(Queue->RingBufferMemory, Entry->RingBufferOffset % Queue->RingBufferSize);
+                    Assert(File->Magic == DDSMagic);
+
+                    Entry->Texture->Info =
+                    {
+                        .Extent = { File->Header.Width, File->Header.Height, 1 },
+                        .MipCount = File->Header.MipMapCount,
+                        .ArrayCount = File->DX10Header.ArrayCount,
+                        .Format = DXGIFormatTable[File->DX10Header.Format],
+                        .Swizzle = *(texture_swizzle*)&File->Header.Swizzle,
+                    };
+                    Entry->Texture->DataOffset = sizeof(dds_file);
+                    Entry->BaseMip = 0;
+                }
+                Entry->State = TextureLoad_Loaded;
+                Entry->UnrequestedFrameCount = 0;
+            }
+            else
             {
-                Target = Candidate;
                 break;
             }
         }
 
-        if (Target)
+        if (Entry->State == TextureLoad_Loaded)
         {
-            Assert(Target->File->Magic == DDSMagic);
-
-            texture* Texture = Target->Texture;
+            LoadedEntries[LoadedCount++] = Entry;
+        }
+    }
 
-            // NOTE(boti): We fill the texture info here, because we don't yet have an asset DB
-            // where we can fill the infos at load time
-            Texture->Info =
+    // Upload the loaded textures that are still requested
+    {
+        counter UploadStart = Platform.GetCounter();
+        b32 IsUploadBudgetExhausted = false;
+        for (u32 OrderIndex = 0; OrderIndex < RequestCount; OrderIndex++)
+        {
+            texture_request* Request = Frame->TextureRequests + RequestOrder[OrderIndex];
+            texture* RequestedTexture = GetTextureFromRendererID(Assets, Request->TextureID);
+            if (!RequestedTexture || !RequestedTexture->HasIORequest)
             {
-                .Extent = { Target->File->Header.Width, Target->File->Header.Height, 1 },
-                .MipCount = Target->File->Header.MipMapCount,
-                .ArrayCount = Target->File->DX10Header.ArrayCount,
-                .Format = DXGIFormatTable[Target->File->DX10Header.Format],
-                .Swizzle = *(texture_swizzle*)&Target->File->Header.Swizzle,
-            };
+                continue;
+            }
 
-            texture_subresource_range Subresource = SubresourceFromMipMask(Request->MipMask, Texture->Info);
-            if (Subresource.MipCount)
+            for (u32 LoadedIndex = 0; LoadedIndex < LoadedCount; LoadedIndex++)
             {
-                if (Subresource.BaseArray != 0 || Subresource.ArrayCount != U32_MAX)
+                texture_load_entry* Entry = LoadedEntries[LoadedIndex];
+                texture* Texture = Entry->Texture;
+                if (Texture == RequestedTexture)
                 {
-                    UnimplementedCodePath;
-                }
+                    IsLoadedEntryRequested[LoadedIndex] = true;
+                    Entry->UnrequestedFrameCount = 0;
 
-                umm Offset = GetPackedTexture2DMipOffset(&Texture->Info, Subresource.BaseMip);
+                    // NOTE(boti): Once a texture doesn't fit into the budget, the lower priority ones wait for the next frame,
+                    // so that smaller uploads can't keep delaying larger but more important ones
+                    if (!IsUploadBudgetExhausted)
+                    {
+                        texture_subresource_range Subresource = SubresourceFromMipMask(Request->MipMask, Texture->Info);
+                        if (Subresource.MipCount)
+                        {
+                            if (Subresource.BaseArray != 0 || Subresource.ArrayCount != U32_MAX)
+                            {
+                                UnimplementedCodePath;
+                            }
 
-                v3u EffectiveExtent =
-                {
-                    Max(Texture->Info.Extent.X >> Subresource.BaseMip, 1u),
-                    Max(Texture->Info.Extent.Y >> Subresource.BaseMip, 1u),
-                    Max(Texture->Info.Extent.Z >> Subresource.BaseMip, 1u),
-                };
-                texture_info CopyInfo =
-                {
-                    .Extent = EffectiveExtent,
-                    .MipCount = Min(GetMaxMipCount(EffectiveExtent.X, EffectiveExtent.Y), Subresource.MipCount),
-                    .ArrayCount = Texture->Info.ArrayCount,
-                    .Format = Texture->Info.Format,
-                    .Swizzle = Texture->Info.Swizzle,
-                };
-                TransferTexture(Frame, Texture->RendererID, CopyInfo, AllTextureSubresourceRange(), OffsetPtr(Target->File->Data, Offset));
+                            // NOTE(boti): The request might have changed since the load was issued,
+                            // mips more detailed than what was loaded have to wait for another load
+                            u32 BaseMip = Max(Subresource.BaseMip, Entry->BaseMip);
+
+                            // NOTE(boti): When the whole chain doesn't fit into the budget, the less detailed mips get uploaded first,
+                            // down to the least detailed mip that's missing (anything less would be a no-op),
+                            // the entry stays loaded and the rest of the mips follow in later frames.
+                            u32 LeastDetailedRequestedMip = Request->MipMask & (0u - Request->MipMask);
+                            u32 MaxBaseMip = Max(SubresourceFromMipMask(LeastDetailedRequestedMip, Texture->Info).BaseMip, BaseMip);
+                            format_info ByteRate = FormatInfoTable[Texture->Info.Format];
+                            umm ByteCount = 0;
+                            for (;;)
+                            {
+                                u32 Width = Max(Texture->Info.Extent.X >> BaseMip, 1u);
+                                u32 Height = Max(Texture->Info.Extent.Y >> BaseMip, 1u);
+                                u32 MipCount = Min(GetMaxMipCount(Width, Height), Texture->Info.MipCount - BaseMip);
+                                ByteCount = GetMipChainSize(Width, Height, MipCount, Texture->Info.ArrayCount, ByteRate);
+                                if ((BaseMip >= MaxBaseMip) || CanUpload(Frame, ByteCount))
+                                {
+                                    break;
+                                }
+                                BaseMip++;
+                            }
+
+                            if (CanUpload(Frame, ByteCount))
+                            {
+                                umm Offset = GetPackedTexture2DMipOffset(&Texture->Info, BaseMip) - GetPackedTexture2DMipOffset(&Texture->Info, Entry->BaseMip);
+                                if (Entry->FileOffset == 0)
+                                {
+                                    Offset += Texture->DataOffset;
+                                }
+                                void* Data = OffsetPtr(Queue->RingBufferMemory, (Entry->RingBufferOffset % Queue->RingBufferSize) + Offset);
+
+                                v3u EffectiveExtent =
+                                {
+                                    Max(Texture->Info.Extent.X >> BaseMip, 1u),
+                                    Max(Texture->Info.Extent.Y >> BaseMip, 1u),
+                                    Max(Texture->Info.Extent.Z >> BaseMip, 1u),
+                                };
+                                texture_info CopyInfo =
+                                {
+                                    .Extent = EffectiveExtent,
+                                    .MipCount = Min(GetMaxMipCount(EffectiveExtent.X, EffectiveExtent.Y), Texture->Info.MipCount - BaseMip),
+                                    .ArrayCount = Texture->Info.ArrayCount,
+                                    .Format = Texture->Info.Format,
+                                    .Swizzle = Texture->Info.Swizzle,
+                                };
+
+                                if (TransferTexture(Frame, Texture->RendererID, CopyInfo, AllTextureSubresourceRange(), Data))
+                                {
+                                    if (BaseMip == Max(Subresource.BaseMip, Entry->BaseMip))
+                                    {
+                                        Entry->State = TextureLoad_Done;
+                                    }
+                                }
+                                else
+                                {
+                                    IsUploadBudgetExhausted = true;
+                                }
+
+                                // NOTE(boti): The copies into the staging buffer are budgeted by time too, in case they're slow (e.g. the pages are cold)
+                                if (Platform.ElapsedSeconds(UploadStart, Platform.GetCounter()) >= Queue->MaxUploadTimePerFrame)
+                                {
+                                    IsUploadBudgetExhausted = true;
+                                }
+                            }
+                            else
+                            {
+                                IsUploadBudgetExhausted = true;
+                            }
+                        }
+                        else
+                        {
+                            Entry->State = TextureLoad_Done;
+                        }
+                    }
+                    break;
+                }
             }
         }
-        else
+
+        // NOTE(boti): Drop the loaded textures that haven't been requested in a while
+        for (u32 LoadedIndex = 0; LoadedIndex < LoadedCount; LoadedIndex++)
         {
-            texture* Texture = nullptr;
-            for (u32 TextureIndex = 0; TextureIndex < Assets->TextureCount; TextureIndex++)
+            texture_load_entry* Entry = LoadedEntries[LoadedIndex];
+            if (!IsLoadedEntryRequested[LoadedIndex] && (++Entry->UnrequestedFrameCount > Queue->MaxUnrequestedFrameCount))
             {
-                texture* Candidate = Assets->Textures + TextureIndex;
-                if (Candidate->RendererID.Value == Request->TextureID.Value)
-                {
-                    Texture = Candidate;
-                    break;
-                }
+                Entry->State = TextureLoad_Done;
             }
 
-            if (Texture && !Texture->HasIORequest && Texture->File.IsValid)
+            if (Entry->State == TextureLoad_Done)
             {
-                if (Texture->Info.Format == Format_Undefined)
-                {
-                    TexturesToLoad[TexturesToLoadCount++] = Texture;
-                }
-                else
-                {
-                    // NOTE(boti): Only issue an IO request if the requested mip level actually exists for that texture
-                    texture_subresource_range Subresource = SubresourceFromMipMask(Request->MipMask, Texture->Info);
-                    if (Subresource.MipCount)
-                    {
-                        TexturesToLoad[TexturesToLoadCount++] = Texture;
-                    }
-                }
+                Entry->Texture->HasIORequest = false;
             }
         }
     }
 
-    // Add new IO requests (if we have enough space to hold them)
-    for (u32 TextureIndex = 0; TextureIndex < TexturesToLoadCount; TextureIndex++)
+    // Free the ring buffer memory of the finished loads
+    for (; Queue->ReadAt < Queue->WriteAt; Queue->ReadAt++)
     {
-        texture* Texture = TexturesToLoad[TextureIndex];
+        texture_load_entry* Entry = Queue->Entries + (Queue->ReadAt % Queue->MaxEntryCount);
+        if (Entry->State != TextureLoad_Done)
+        {
+            break;
+        }
+        Queue->RingBufferReadAt = Entry->RingBufferOffset + Entry->ByteCount;
+    }
 
-        umm DstOffset = GetRingBufferOffset(Queue->RingBufferSize, Queue->RingBufferWriteAt, Texture->File.ByteCount, alignof(dds_file));
-        umm DstEnd = DstOffset + Texture->File.ByteCount;
-        if (DstEnd - Queue->RingBufferReadAt < Queue->RingBufferSize)
+    // NOTE(boti): Backpressure from the uploads, no new loads are started while too much data is waiting to be uploaded
+    umm PendingByteCount = 0;
+    for (u32 EntryIndex = Queue->ReadAt; EntryIndex < Queue->WriteAt; EntryIndex++)
+    {
+        texture_load_entry* Entry = Queue->Entries + (EntryIndex % Queue->MaxEntryCount);
+        if (Entry->State != TextureLoad_Done)
         {
-            if (Queue->WriteAt - Queue->ReadAt < Queue->MaxEntryCount)
-            {
-                texture_load_entry* Entry = Queue->Entries + (Queue->WriteAt++ % Queue->MaxEntryCount);
-                Queue->RingBufferWriteAt = DstEnd;
+            PendingByteCount += Entry->ByteCount;
+        }
+    }
+
+    // Add new IO requests (if we have enough space to hold them)
+    umm IOByteCount = 0;
+    for (u32 OrderIndex = 0; OrderIndex < RequestCount; OrderIndex++)
+    {
+        if (PendingByteCount >= Queue->MaxPendingByteCount)
+        {
+            break;
+        }
 
-                void* Dst = OffsetPtr(Queue->RingBufferMemory, DstOffset % Queue->RingBufferSize);
-                Texture->HasIORequest= true;
+        texture_request* Request = Frame->TextureRequests + RequestOrder[OrderIndex];
 
-                Entry->Texture = Texture;
-                Entry->RingBufferOffset = DstOffset;
-                Entry->IOCompletion = Platform.PushIORequest(Platform.IOQueue, Texture->File, 0, Texture->File.ByteCount, Dst);
+        texture* Texture = GetTextureFromRendererID(Assets, Request->TextureID);
+        if (Texture && !Texture->HasIORequest && !Texture->IsMetadataPending && Texture->File.IsValid)
+        {
+            // NOTE(boti): Only the requested mips (and the ones below them) get read if we have the metadata,
+            // otherwise the whole file
+            b32 ShouldLoad = false;
+            umm FileOffset = 0;
+            u32 BaseMip = 0;
+            if (Texture->Info.Format == Format_Undefined)
+            {
+                ShouldLoad = true;
             }
             else
             {
-                break;
+                // NOTE(boti): Only issue an IO request if the requested mip level actually exists for that texture
+                texture_subresource_range Subresource = SubresourceFromMipMask(Request->MipMask, Texture->Info);
+                if (Subresource.MipCount)
+                {
+                    ShouldLoad = true;
+                    BaseMip = Subresource.BaseMip;
+                    FileOffset = Texture->DataOffset + GetPackedTexture2DMipOffset(&Texture->Info, BaseMip);
+                    Assert(FileOffset < Texture->File.ByteCount);
+                }
+            }
+
+            if (ShouldLoad)
+            {
+                umm ByteCount = Texture->File.ByteCount - FileOffset;
+                if (IOByteCount && (IOByteCount + ByteCount > Queue->MaxIOBytesPerFrame))
+                {
+                    break;
+                }
+
+                umm DstOffset = GetRingBufferOffset(Queue->RingBufferSize, Queue->RingBufferWriteAt, ByteCount, alignof(dds_file));
+                umm DstEnd = DstOffset + ByteCount;
+                if ((DstEnd - Queue->RingBufferReadAt < Queue->RingBufferSize) && 
+                    (Queue->WriteAt - Queue->ReadAt < Queue->MaxEntryCount))
+                {
+                    texture_load_entry* Entry = Queue->Entries + (Queue->WriteAt++ % Queue->MaxEntryCount);
+                    Queue->RingBufferWriteAt = DstEnd;
+
+                    void* Dst = OffsetPtr(Queue->RingBufferMemory, DstOffset % Queue->RingBufferSize);
+                    Texture->HasIORequest = true;
+
+                    Entry->Texture = Texture;
+                    Entry->RingBufferOffset = DstOffset;
+                    Entry->ByteCount = ByteCount;
+                    Entry->FileOffset = FileOffset;
+                    Entry->BaseMip = BaseMip;
+                    Entry->State = TextureLoad_Pending;
+                    Entry->UnrequestedFrameCount = 0;
+                    Entry->IOCompletion = Platform.PushIORequest(Platform.IOQueue, Texture->File, FileOffset, ByteCount, Dst);
+                    IOByteCount += ByteCount;
+                    PendingByteCount += ByteCount;
+                }
+                else
+                {
+                    break;
+                }
             }
-        }
-        else
-        {
-            break;
         }
     }
 }
@@ -386,7 +565,7 @@ lbfn void LoadDebugFont(memory_arena* Arena, assets* Assets, render_frame* Frame
 
             Assets->DefaultFontTextureID = Assets->TextureCount++;
             texture* DefaultFontTexture = Assets->Textures + Assets->DefaultFontTextureID;
-            DefaultFontTexture->RendererID = Platform.AllocateTexture(Frame->Renderer, TextureFlag_PersistentMemory, nullptr, {});
+            DefaultFontTexture->RendererID = AllocateAssetTexture(Assets, Frame, Assets->DefaultFontTextureID, TextureFlag_PersistentMemory, nullptr, {});
 
             texture_info Info = 
             {
@@ -415,6 +594,8 @@ lbfn texture_set DEBUGLoadTextureSet(assets* Assets, render_frame* Frame, textur
 {
     texture_set Result = {};
 
+    u32 LoadedTextureCount = 0;
+    u32 LoadedTextureIndices[TextureType_Count];
     for (u32 Type = 0; Type < TextureType_Count; Type++)
     {
         texture_set_entry* Entry = Entries + Type;
@@ -428,7 +609,7 @@ lbfn texture_set DEBUGLoadTextureSet(assets* Assets, render_frame* Frame, textur
                 Result.IDs[Type] = TextureID;
                 texture* Texture = Assets->Textures + TextureID;
                 renderer_texture_id PlaceholderID = Assets->Textures[Assets->DefaultTextures[Type]].RendererID;
-                Texture->RendererID = Platform.AllocateTexture(Frame->Renderer, TextureFlag_None, nullptr, PlaceholderID);
+                Texture->RendererID = AllocateAssetTexture(Assets, Frame, TextureID, TextureFlag_None, nullptr, PlaceholderID);
 
                 filepath Path;
                 MakeFilepathFromZ(&Path, Entry->Path);
@@ -439,6 +620,7 @@ lbfn texture_set DEBUGLoadTextureSet(assets* Assets, render_frame* Frame, textur
                 OverwriteExtension(&CachePath, ".dds");
                 
                 Texture->File = Platform.OpenFile(CachePath.Path);
+                LoadedTextureIndices[LoadedTextureCount++] = TextureID;
             }
             else
             {
@@ -447,6 +629,8 @@ lbfn texture_set DEBUGLoadTextureSet(assets* Assets, render_frame* Frame, textur
         }
     }
 
+    LoadTextureMetadata(Assets, LoadedTextureCount, LoadedTextureIndices);
+
     return(Result);
 }
 
@@ -651,6 +835,8 @@ internal void DEBUGLoadTestScene(
         }
     }
 
+    u32 LoadedTextureCount = 0;
+    u32* LoadedTextureIndices = PushArray(Scratch, 0, u32, GLTF.ImageCount);
     for (u32 ImageIndex = 0; ImageIndex < GLTF.ImageCount; ImageIndex++)
     {
         loaded_gltf_image* Image = ImageTable + ImageIndex;
@@ -664,7 +850,7 @@ internal void DEBUGLoadTestScene(
         {
             renderer_texture_id Placeholder = Assets->Textures[Assets->DefaultTextures[Image->Type]].RendererID;
             texture* Asset = Assets->Textures + Image->AssetID;
-            Asset->RendererID = Platform.AllocateTexture(Frame->Renderer, TextureFlag_None, nullptr, Placeholder);
+            Asset->RendererID = AllocateAssetTexture(Assets, Frame, Image->AssetID, TextureFlag_None, nullptr, Placeholder);
 
             filepath AssetPath = Filepath;
             if (OverwriteNameAndExtension(&AssetPath, GLTFImage->URI))
@@ -678,9 +864,11 @@ internal void DEBUGLoadTestScene(
                 OverwriteExtension(&CachePath, ".dds");
 
                 Asset->File = Platform.OpenFile(CachePath.Path);
+                LoadedTextureIndices[LoadedTextureCount++] = Image->AssetID;
             }
         }
     }
+    LoadTextureMetadata(Assets, LoadedTextureCount, LoadedTextureIndices);
 
     for (u32 MeshIndex = 0; MeshIndex < GLTF.MeshCount; MeshIndex++)
     {
@@ -1043,16 +1231,17 @@ internal void DEBUGLoadTestScene(
                         
                     if (Node->IsTRS)
                     {
-                        SkinAsset->BindPose[JointIndex] = 
+                        trs_transform BindTransform = 
                         {
                             .Rotation = Node->Rotation,
                             .Position = Node->Translation,
                             .Scale = Node->Scale,
                         };
+                        SetJointTransform(&SkinAsset->BindPose, JointIndex, BindTransform);
                     }
                     else
                     {
-                        SkinAsset->BindPose[JointIndex] = M4ToTRS(Node->Transform);
+                        SetJointTransform(&SkinAsset->BindPose, JointIndex, M4ToTRS(Node->Transform));
                     }
 
                     // Build the joint hierarchy
@@ -1077,6 +1266,18 @@ internal void DEBUGLoadTestScene(
                         }
                     }
                 }
+
+                SkinAsset->IKChainCount = 0;
+                if (SkinAsset->Type == Armature_Mixamo)
+                {
+                    static_assert(MixamoIK_Count <= skin::MaxIKChainCount);
+                    // NOTE(boti): Mixamo characters face +Z, knees bend forward, elbows bend backward
+                    SkinAsset->IKChains[MixamoIK_RightLeg] = { Mixamo_RightHip, Mixamo_RightKnee, Mixamo_RightFoot, { 0.0f, 0.0f, +1.0f } };
+                    SkinAsset->IKChains[MixamoIK_LeftLeg] = { Mixamo_LeftHip, Mixamo_LeftKnee, Mixamo_LeftFoot, { 0.0f, 0.0f, +1.0f } };
+                    SkinAsset->IKChains[MixamoIK_RightArm] = { Mixamo_RightArm, Mixamo_RightForeArm, Mixamo_RightHand, { 0.0f, 0.0f, -1.0f } };
+                    SkinAsset->IKChains[MixamoIK_LeftArm] = { Mixamo_LeftArm, Mixamo_LeftForeArm, Mixamo_LeftHand, { 0.0f, 0.0f, -1.0f } };
+                    SkinAsset->IKChainCount = MixamoIK_Count;
+                }
             }
             else
             {
@@ -1124,9 +1325,9 @@ internal void DEBUGLoadTestScene(
         }
         gltf_skin* Skin = GLTF.Skins + SkinIndex;
 
-        // NOTE(boti): We start the count at 1 because even if the animation doesn't have an explicit 0t
-        // key frame, we'll want to add that
-        u32 MaxKeyFrameCount = 1;
+        f32 MinTimestamp = F32_MAX_NORMAL;
+        f32 MaxTimestamp = 0.0f;
+        u32 MaxSourceKeyCount = 0;
         for (u32 SamplerIndex = 0; SamplerIndex < Animation->SamplerCount; SamplerIndex++)
         {
             gltf_animation_sampler* Sampler = Animation->Samplers + SamplerIndex;
@@ -1136,78 +1337,35 @@ internal void DEBUGLoadTestScene(
 
             Verify((TimestampAccessor->ComponentType == GLTF_FLOAT) && (TimestampAccessor->Type == GLTF_SCALAR));
 
-            MaxKeyFrameCount += TimestampAccessor->Count;
+            MinTimestamp = Min(MinTimestamp, TimestampAccessor->Min.EE[0]);
+            MaxTimestamp = Max(MaxTimestamp, TimestampAccessor->Max.EE[0]);
+            MaxSourceKeyCount = Max(MaxSourceKeyCount, TimestampAccessor->Count);
         }
 
-        f32* KeyFrameTimestamps = PushArray(Scratch, 0, f32, MaxKeyFrameCount);
-        u32 KeyFrameCount = 1;
-        KeyFrameTimestamps[0] = 0.0f;
-        for (u32 SamplerIndex = 0; SamplerIndex < Animation->SamplerCount; SamplerIndex++)
+        u32 MaxKeyCount = 0;
+        for (u32 ChannelIndex = 0; ChannelIndex < Animation->ChannelCount; ChannelIndex++)
         {
-            gltf_animation_sampler* Sampler = Animation->Samplers + SamplerIndex;
-            gltf_accessor* TimestampAccessor = GLTF.Accessors + Sampler->InputAccessorIndex;
-            gltf_buffer_view* View = GLTF.BufferViews + TimestampAccessor->BufferView;
-            buffer* Buffer = Buffers + View->BufferIndex;
-
-            u32 Stride = View->Stride;
-            if (Stride == 0)
-            {
-                Stride = GLTFGetDefaultStride(TimestampAccessor);
-            }
-
-            void* At = OffsetPtr(Buffer->Data, View->Offset + TimestampAccessor->ByteOffset);
-            u32 Count = TimestampAccessor->Count;
-            while (Count--)
-            {
-                f32 Timestamp = *(f32*)At;
-                Assert(Timestamp >= 0.0f);
-                At = OffsetPtr(At, Stride);
-                
-                b32 AlreadyExists = false;
-                for (u32 KeyFrameIndex = 0; KeyFrameIndex < KeyFrameCount; KeyFrameIndex++)
-                {
-                    if (Timestamp == KeyFrameTimestamps[KeyFrameIndex])
-                    {
-                        AlreadyExists = true;
-                        break;
-                    }
-                    else if (Timestamp < KeyFrameTimestamps[KeyFrameIndex])
-                    {
-                        for (u32 It = KeyFrameCount; It > KeyFrameIndex; It--)
-                        {
-                            KeyFrameTimestamps[It] = KeyFrameTimestamps[It - 1];
-                        }
-                        KeyFrameTimestamps[KeyFrameIndex] = Timestamp;
-                        KeyFrameCount++;
-                    }
-                }
-
-                if (!AlreadyExists)
-                {
-                    KeyFrameTimestamps[KeyFrameCount++] = Timestamp;
-                }
-            }
+            gltf_animation_sampler* Sampler = Animation->Samplers + Animation->Channels[ChannelIndex].SamplerIndex;
+            MaxKeyCount += GLTF.Accessors[Sampler->InputAccessorIndex].Count;
         }
 
         if (Assets->AnimationCount < Assets->MaxAnimationCount)
         {
             animation* AnimationAsset = Assets->Animations + Assets->AnimationCount++;
             AnimationAsset->SkinID              = BaseSkinIndex + SkinIndex;
-            AnimationAsset->KeyFrameCount       = KeyFrameCount;
-            AnimationAsset->KeyFrameTimestamps  = PushArray(&Assets->Arena, 0, f32, KeyFrameCount);
-            AnimationAsset->KeyFrames           = PushArray(&Assets->Arena, 0, animation_key_frame, KeyFrameCount);
-            memcpy(AnimationAsset->KeyFrameTimestamps, KeyFrameTimestamps, KeyFrameCount * sizeof(f32));
-
+            AnimationAsset->JointCount          = Skin->JointCount;
+            AnimationAsset->MinTimestamp        = MinTimestamp;
+            AnimationAsset->MaxTimestamp        = MaxTimestamp;
+            AnimationAsset->Curves              = PushArray(&Assets->Arena, MemPush_Clear, animation_curve, Skin->JointCount * AnimationChannel_Count);
             memset(&AnimationAsset->ActiveJoints, 0x00, sizeof(AnimationAsset->ActiveJoints));
-            skin* SkinAsset = Assets->Skins + AnimationAsset->SkinID;
-            for (u32 KeyFrameIndex = 0; KeyFrameIndex < KeyFrameCount; KeyFrameIndex++)
-            {
-                animation_key_frame* KeyFrame = AnimationAsset->KeyFrames + KeyFrameIndex;
-                for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
-                {
-                    KeyFrame->JointTransforms[JointIndex] = SkinAsset->BindPose[JointIndex];
-                }
-            }
+
+            // NOTE(boti): The curves get compressed into scratch memory first, 
+            // only the keys that survive the reduction are copied to the asset arena
+            u32 KeyCount = 0;
+            animation_key* Keys = PushArray(Scratch, 0, animation_key, MaxKeyCount);
+            f32* SourceTimes = PushArray(Scratch, 0, f32, MaxSourceKeyCount);
+            v4* SourceValues = PushArray(Scratch, 0, v4, MaxSourceKeyCount);
+            animation_key* SourceKeys = PushArray(Scratch, 0, animation_key, MaxSourceKeyCount);
 
             for (u32 ChannelIndex = 0; ChannelIndex < Animation->ChannelCount; ChannelIndex++)
             {
@@ -1224,7 +1382,7 @@ internal void DEBUGLoadTestScene(
                         u32 ArrayIndex, BitIndex;
                         if (JointMaskIndexFromJointIndex(JointIndex, &ArrayIndex, &BitIndex))
                         {
-                            AnimationAsset->ActiveJoints.Bits[ArrayIndex] |= (1 << BitIndex);
+                            AnimationAsset->ActiveJoints.Bits[ArrayIndex] |= (1llu << BitIndex);
                         }
                         else
                         {
@@ -1240,8 +1398,6 @@ internal void DEBUGLoadTestScene(
                     gltf_accessor* TimestampAccessor = GLTF.Accessors + Sampler->InputAccessorIndex;
                     gltf_accessor* TransformAccessor = GLTF.Accessors + Sampler->OutputAccessorIndex;
                     Verify(TransformAccessor->ComponentType == GLTF_FLOAT);
-                    AnimationAsset->MinTimestamp = TimestampAccessor->Min.EE[0];
-                    AnimationAsset->MaxTimestamp = TimestampAccessor->Max.EE[0];
 
                     gltf_buffer_view* TimestampView = GLTF.BufferViews + TimestampAccessor->BufferView;
                     buffer* TimestampBuffer = Buffers + TimestampView->BufferIndex;
@@ -1263,16 +1419,23 @@ internal void DEBUGLoadTestScene(
 
                     Verify(TimestampAccessor->Count > 0);
                     Verify(TimestampAccessor->Count == TransformAccessor->Count);
+                    animation_channel ChannelType = AnimationChannel_Count;
                     switch (Channel->Target.Path)
                     {
                         case GLTF_Rotation:
                         {
                             Verify(TransformAccessor->Type == GLTF_VEC4);
+                            ChannelType = AnimationChannel_Rotation;
                         } break;
-                        case GLTF_Scale:
                         case GLTF_Translation:
                         {
                             Verify(TransformAccessor->Type == GLTF_VEC3);
+                            ChannelType = AnimationChannel_Position;
+                        } break;
+                        case GLTF_Scale:
+                        {
+                            Verify(TransformAccessor->Type == GLTF_VEC3);
+                            ChannelType = AnimationChannel_Scale;
                         } break;
                         default:
                         {
@@ -1280,88 +1443,38 @@ internal void DEBUGLoadTestScene(
                         } break;
                     }
 
-                    // NOTE(boti): The initial transform of a joint is _always_ going to be the first element in the accessor,
-                    // _regardless_ of whether the t=0 keyframe exists or not, because the transform is required
-                    // to be clamped to the first one available by the glTF spec
+                    u32 SourceCount = TimestampAccessor->Count;
+                    for (u32 SourceIndex = 0; SourceIndex < SourceCount; SourceIndex++)
                     {
-                        trs_transform* Transform = AnimationAsset->KeyFrames[0].JointTransforms + JointIndex;
-                        switch (Channel->Target.Path)
+                        SourceTimes[SourceIndex] = *(f32*)SamplerTimestampAt;
+                        if (ChannelType == AnimationChannel_Rotation)
                         {
-                            case GLTF_Rotation:     Transform->Rotation = *(v4*)SamplerTransformAt; break;
-                            case GLTF_Translation:  Transform->Position = *(v3*)SamplerTransformAt; break;
-                            case GLTF_Scale:        Transform->Scale    = *(v3*)SamplerTransformAt; break;
-                            default:
-                            {
-                                UnimplementedCodePath;
-                            } break;
-                        }
-                    }
-
-                    for (u32 KeyFrameIndex = 1; KeyFrameIndex < KeyFrameCount; KeyFrameIndex++)
-                    {
-                        f32 Timestamp = *(f32*)SamplerTimestampAt;
-                        f32 CurrentTime = AnimationAsset->KeyFrameTimestamps[KeyFrameIndex];
-                        while (Timestamp < CurrentTime)
-                        {
-                            SamplerTimestampAt = OffsetPtr(SamplerTimestampAt, TimestampStride);
-                            SamplerTransformAt = OffsetPtr(SamplerTransformAt, TransformStride);
-                            Timestamp = *(f32*)SamplerTimestampAt;
-                        }
-
-                        trs_transform* Transform = AnimationAsset->KeyFrames[KeyFrameIndex].JointTransforms + JointIndex;
-                        if (CurrentTime < Timestamp)
-                        {
-                            f32 PrevTime = AnimationAsset->KeyFrameTimestamps[KeyFrameIndex - 1];
-                            f32 DeltaTime = Timestamp - PrevTime;
-                            f32 BlendFactor = (CurrentTime - PrevTime) / DeltaTime;
-
-                            trs_transform* PrevTransform = AnimationAsset->KeyFrames[KeyFrameIndex - 1].JointTransforms + JointIndex;
-                            switch (Channel->Target.Path)
-                            {
-                                case GLTF_Rotation:
-                                {
-                                    v4 Rotation = *(v4*)SamplerTransformAt;
-                                    Transform->Rotation = Normalize(Lerp(PrevTransform->Rotation, Rotation, BlendFactor));
-                                } break;
-                                case GLTF_Translation:
-                                {
-                                    v3 Translation = *(v3*)SamplerTransformAt;
-                                    Transform->Position = Lerp(PrevTransform->Position, Translation, BlendFactor);
-                                } break;
-                                case GLTF_Scale:
-                                {
-                                    v3 Scale = *(v3*)SamplerTransformAt;
-                                    Transform->Scale = Lerp(PrevTransform->Scale, Scale, BlendFactor);
-                                } break;
-                                InvalidDefaultCase;
-                            }
+                            SourceValues[SourceIndex] = *(v4*)SamplerTransformAt;
                         }
                         else
                         {
-                            switch (Channel->Target.Path)
-                            {
-                                case GLTF_Rotation:
-                                {
-                                    Transform->Rotation = *(v4*)SamplerTransformAt;
-                                } break;
-                                case GLTF_Translation:
-                                {
-                                    Transform->Position = *(v3*)SamplerTransformAt;
-                                } break;
-                                case GLTF_Scale:
-                                {
-                                    Transform->Scale = *(v3*)SamplerTransformAt;
-                                } break;
-                                InvalidDefaultCase;
-                            }
+                            v3 Value = *(v3*)SamplerTransformAt;
+                            SourceValues[SourceIndex] = { Value.X, Value.Y, Value.Z, 0.0f };
                         }
+                        SamplerTimestampAt = OffsetPtr(SamplerTimestampAt, TimestampStride);
+                        SamplerTransformAt = OffsetPtr(SamplerTransformAt, TransformStride);
                     }
+
+                    animation_curve* Curve = GetAnimationCurve(AnimationAsset, JointIndex, ChannelType);
+                    Curve->FirstKey = KeyCount;
+                    Curve->KeyCount = CompressAnimationCurve(ChannelType, SourceCount, SourceTimes, SourceValues, MaxTimestamp,
+                                                             Curve, Keys + KeyCount, SourceKeys);
+                    KeyCount += Curve->KeyCount;
                 }
                 else
                 {
                     UnhandledError("glTF animation contains targets that don't belong to a single skin");
                 }
             }
+
+            AnimationAsset->KeyCount = KeyCount;
+            AnimationAsset->Keys = PushArray(&Assets->Arena, 0, animation_key, KeyCount);
+            memcpy(AnimationAsset->Keys, Keys, KeyCount * sizeof(animation_key));
         }
         else
         {
@@ -1439,14 +1552,18 @@ internal void DEBUGLoadTestScene(
                             .MeshID = Model->Meshes[MeshIndex],
                         };
                     }
+                    Entity->IsPieceDataDirty = true;
 
                     if (Node->SkinIndex != U32_MAX)
                     {
-                        Entity->Flags |= EntityFlag_Skin;
-                        Entity->SkinID = BaseSkinIndex + Node->SkinIndex;
-                        Entity->CurrentAnimationID = 0;
-                        Entity->DoAnimation = false;
-                        Entity->AnimationCounter = 0.0f;
+                        if (MakeAnimator(World, BaseSkinIndex + Node->SkinIndex, &Entity->AnimatorID))
+                        {
+                            Entity->Flags |= EntityFlag_Skin;
+                        }
+                        else
+                        {
+                            UnhandledError("Out of animator pool memory");
+                        }
                     }
                     Entity->LightEmission = {};
                 }
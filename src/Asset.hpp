@@ -30,21 +30,72 @@ enum armature_type : u32
     Armature_Mixamo,
 };
 
+// NOTE(boti): Parent-relative joint transforms in SoA layout, so that they can be processed 8 joints at a time
+struct joint_pose
+{
+    alignas(32) f32 Rotation[4][R_MaxJointCount];
+    alignas(32) f32 Position[3][R_MaxJointCount];
+    alignas(32) f32 Scale[3][R_MaxJointCount];
+};
+static_assert(R_MaxJointCount % 8 == 0);
+
+inline trs_transform GetJointTransform(const joint_pose* Pose, u32 JointIndex);
+inline void SetJointTransform(joint_pose* Pose, u32 JointIndex, trs_transform Transform);
+
 // TODO(boti): Rename skin to armature
 // NOTE(boti): Skin joints must not precede their parents in the array
+// NOTE(boti): Two-bone chain (e.g. hip-knee-foot), the bend hint is a model-space direction 
+// the middle joint should bend towards when the chain is fully extended in the animation
+struct ik_chain
+{
+    u32 RootJoint;
+    u32 MiddleJoint;
+    u32 EndJoint;
+    v3 BendHint;
+};
+
 struct skin
 {
+    static constexpr u32 MaxIKChainCount = 4;
+
     armature_type Type;
     u32 JointCount;
     m4 InverseBindMatrices[R_MaxJointCount];
     // NOTE(boti): The bind-pose transforms are all parent-relative and not global
-    trs_transform BindPose[R_MaxJointCount];
+    joint_pose BindPose;
     u32 JointParents[R_MaxJointCount];
+
+    u32 IKChainCount;
+    ik_chain IKChains[MaxIKChainCount];
+};
+
+enum animation_channel : u32
+{
+    AnimationChannel_Rotation = 0,
+    AnimationChannel_Position,
+    AnimationChannel_Scale,
+
+    AnimationChannel_Count,
+};
+
+// NOTE(boti): Key times are 16-bit unorms over [0, MaxTimestamp].
+// Rotations are smallest-three quaternions: the 3 smallest components in 15 bits each, 
+// with the index of the dropped (largest) component in the MSBs of the first two values.
+// Positions and scales are 16-bit unorms inside the bounding box of the curve.
+struct animation_key
+{
+    u16 Time;
+    u16 Values[3];
 };
 
-struct animation_key_frame
+// NOTE(boti): Sparse per-channel curve, sampling outside the key range clamps to the first/last key.
+// Channels without keys keep the bind pose.
+struct animation_curve
 {
-    trs_transform JointTransforms[R_MaxJointCount];
+    u32 KeyCount;
+    u32 FirstKey;
+    v3 Min;
+    v3 Extent;
 };
 
 struct joint_mask
@@ -56,17 +107,29 @@ inline b32 JointMaskIndexFromJointIndex(u32 JointIndex, u32* ArrayIndex, u32* Bi
 
 struct animation
 {
+    // NOTE(boti): Max. error allowed when dropping keys at import,
+    // the rotation tolerance is the (approximate) angle in radians
+    static constexpr f32 RotationTolerance = 1e-3f;
+    static constexpr f32 PositionTolerance = 1e-3f;
+    static constexpr f32 ScaleTolerance = 1e-3f;
+
     u32 SkinID;
-    u32 KeyFrameCount;
+    u32 JointCount;
     f32 MinTimestamp;
     f32 MaxTimestamp;
-    f32* KeyFrameTimestamps;
-    animation_key_frame* KeyFrames;
+    u32 KeyCount;
+    animation_curve* Curves; // NOTE(boti): JointCount * AnimationChannel_Count curves, see GetAnimationCurve()
+    animation_key* Keys;
 
     joint_mask ActiveJoints;
 };
 
 inline b32 IsJointActive(animation* Animation, u32 JointIndex);
+inline animation_curve* GetAnimationCurve(animation* Animation, u32 JointIndex, animation_channel Channel);
+
+inline f32 DecodeAnimationTime(animation* Animation, u16 Time);
+inline v4 DecodeRotationKey(const animation_key* Key);
+inline v3 DecodeVectorKey(const animation_curve* Curve, const animation_key* Key);
 
 enum mixamo_joint : u32
 {
@@ -148,82 +211,100 @@ internal const char* MixamoJointNames[Mixamo_Count] =
 {
     [Mixamo_Torso]              = "mixamorig:Hips",
     [Mixamo_Spine]              = "mixamorig:Spine",
-    [Mixamo_LeftHip]            = "mixamorig:LeftUpLeg",
-    [Mixamo_RightHip]           = "mixamorig:RightUpLeg",
     [Mixamo_Spine1]             = "mixamorig:Spine1",
-    [Mixamo_LeftKnee]           = "mixamorig:LeftLeg",
-    [Mixamo_RightKnee]          = "mixamorig:RightLeg",
     [Mixamo_Spine2]             = "mixamorig:Spine2",
-    [Mixamo_LeftFoot]           = "mixamorig:LeftFoot",
-    [Mixamo_RightFoot]          = "mixamorig:RightFoot",
     [Mixamo_Neck]               = "mixamorig:Neck",
-    [Mixamo_LeftShoulder]       = "mixamorig:LeftShoulder",
-    [Mixamo_RightShoulder]      = "mixamorig:RightShoulder",
-    [Mixamo_LeftToeBase]        = "mixamorig:LeftToeBase",
-    [Mixamo_RightToeBase]       = "mixamorig:RightToeBase",
     [Mixamo_Head]               = "mixamorig:Head",
-    [Mixamo_LeftArm]            = "mixamorig:LeftArm",
-    [Mixamo_RightArm]           = "mixamorig:RightArm",
-    [Mixamo_LeftToeEnd]         = "mixamorig:LeftToe_End",
-    [Mixamo_RightToeEnd]        = "mixamorig:RightToe_End",
     [Mixamo_HeadTop]            = "mixamorig:HeadTop_End",
     [Mixamo_LeftEye]            = "mixamorig:LeftEye",
     [Mixamo_RightEye]           = "mixamorig:RightEye",
+    [Mixamo_LeftShoulder]       = "mixamorig:LeftShoulder",
+    [Mixamo_LeftArm]            = "mixamorig:LeftArm",
     [Mixamo_LeftForeArm]        = "mixamorig:LeftForeArm",
-    [Mixamo_RightForeArm]       = "mixamorig:RightForeArm",
     [Mixamo_LeftHand]           = "mixamorig:LeftHand",
-    [Mixamo_RightHand]          = "mixamorig:RightHand",
     [Mixamo_LeftHandThumb1]     = "mixamorig:LeftHandThumb1",
-    [Mixamo_LeftHandIndex1]     = "mixamorig:LeftHandIndex1",
-    [Mixamo_LeftHandMiddle1]    = "mixamorig:LeftHandMiddle1",
-    [Mixamo_LeftHandRing1]      = "mixamorig:LeftHandRing1",
-    [Mixamo_LeftHandPinky1]     = "mixamorig:LeftHandPinky1",
-    [Mixamo_RightHandThumb1]    = "mixamorig:RightHandThumb1",
-    [Mixamo_RightHandIndex1]    = "mixamorig:RightHandIndex1",
-    [Mixamo_RightHandMiddle1]   = "mixamorig:RightHandMiddle1",
-    [Mixamo_RightHandRing1]     = "mixamorig:RightHandRing1",
-    [Mixamo_RightHandPinky1]    = "mixamorig:RightHandPinky1",
     [Mixamo_LeftHandThumb2]     = "mixamorig:LeftHandThumb2",
-    [Mixamo_LeftHandIndex2]     = "mixamorig:LeftHandIndex2",
-    [Mixamo_LeftHandMiddle2]    = "mixamorig:LeftHandMiddle2",
-    [Mixamo_LeftHandRing2]      = "mixamorig:LeftHandRing2",
-    [Mixamo_LeftHandPinky2]     = "mixamorig:LeftHandPinky2",
-    [Mixamo_RightHandThumb2]    = "mixamorig:RightHandThumb2",
-    [Mixamo_RightHandIndex2]    = "mixamorig:RightHandIndex2",
-    [Mixamo_RightHandMiddle2]   = "mixamorig:RightHandMiddle2",
-    [Mixamo_RightHandRing2]     = "mixamorig:RightHandRing2",
-    [Mixamo_RightHandPinky2]    = "mixamorig:RightHandPinky2",
     [Mixamo_LeftHandThumb3]     = "mixamorig:LeftHandThumb3",
-    [Mixamo_LeftHandIndex3]     = "mixamorig:LeftHandIndex3",
-    [Mixamo_LeftHandMiddle3]    = "mixamorig:LeftHandMiddle3",
-    [Mixamo_LeftHandRing3]      = "mixamorig:LeftHandRing3",
-    [Mixamo_LeftHandPinky3]     = "mixamorig:LeftHandPinky3",
-    [Mixamo_RightHandThumb3]    = "mixamorig:RightHandThumb3",
-    [Mixamo_RightHandIndex3]    = "mixamorig:RightHandIndex3",
-    [Mixamo_RightHandMiddle3]   = "mixamorig:RightHandMiddle3",
-    [Mixamo_RightHandRing3]     = "mixamorig:RightHandRing3",
-    [Mixamo_RightHandPinky3]    = "mixamorig:RightHandPinky3",
     [Mixamo_LeftHandThumb4]     = "mixamorig:LeftHandThumb4",
+    [Mixamo_LeftHandIndex1]     = "mixamorig:LeftHandIndex1",
+    [Mixamo_LeftHandIndex2]     = "mixamorig:LeftHandIndex2",
+    [Mixamo_LeftHandIndex3]     = "mixamorig:LeftHandIndex3",
     [Mixamo_LeftHandIndex4]     = "mixamorig:LeftHandIndex4",
+    [Mixamo_LeftHandMiddle1]    = "mixamorig:LeftHandMiddle1",
+    [Mixamo_LeftHandMiddle2]    = "mixamorig:LeftHandMiddle2",
+    [Mixamo_LeftHandMiddle3]    = "mixamorig:LeftHandMiddle3",
     [Mixamo_LeftHandMiddle4]    = "mixamorig:LeftHandMiddle4",
+    [Mixamo_LeftHandRing1]      = "mixamorig:LeftHandRing1",
+    [Mixamo_LeftHandRing2]      = "mixamorig:LeftHandRing2",
+    [Mixamo_LeftHandRing3]      = "mixamorig:LeftHandRing3",
     [Mixamo_LeftHandRing4]      = "mixamorig:LeftHandRing4",
+    [Mixamo_LeftHandPinky1]     = "mixamorig:LeftHandPinky1",
+    [Mixamo_LeftHandPinky2]     = "mixamorig:LeftHandPinky2",
+    [Mixamo_LeftHandPinky3]     = "mixamorig:LeftHandPinky3",
     [Mixamo_LeftHandPinky4]     = "mixamorig:LeftHandPinky4",
+    [Mixamo_RightShoulder]      = "mixamorig:RightShoulder",
+    [Mixamo_RightArm]           = "mixamorig:RightArm",
+    [Mixamo_RightForeArm]       = "mixamorig:RightForeArm",
+    [Mixamo_RightHand]          = "mixamorig:RightHand",
+    [Mixamo_RightHandThumb1]    = "mixamorig:RightHandThumb1",
+    [Mixamo_RightHandThumb2]    = "mixamorig:RightHandThumb2",
+    [Mixamo_RightHandThumb3]    = "mixamorig:RightHandThumb3",
     [Mixamo_RightHandThumb4]    = "mixamorig:RightHandThumb4",
+    [Mixamo_RightHandIndex1]    = "mixamorig:RightHandIndex1",
+    [Mixamo_RightHandIndex2]    = "mixamorig:RightHandIndex2",
+    [Mixamo_RightHandIndex3]    = "mixamorig:RightHandIndex3",
     [Mixamo_RightHandIndex4]    = "mixamorig:RightHandIndex4",
+    [Mixamo_RightHandMiddle1]   = "mixamorig:RightHandMiddle1",
+    [Mixamo_RightHandMiddle2]   = "mixamorig:RightHandMiddle2",
+    [Mixamo_RightHandMiddle3]   = "mixamorig:RightHandMiddle3",
     [Mixamo_RightHandMiddle4]   = "mixamorig:RightHandMiddle4",
+    [Mixamo_RightHandRing1]     = "mixamorig:RightHandRing1",
+    [Mixamo_RightHandRing2]     = "mixamorig:RightHandRing2",
+    [Mixamo_RightHandRing3]     = "mixamorig:RightHandRing3",
     [Mixamo_RightHandRing4]     = "mixamorig:RightHandRing4",
+    [Mixamo_RightHandPinky1]    = "mixamorig:RightHandPinky1",
+    [Mixamo_RightHandPinky2]    = "mixamorig:RightHandPinky2",
+    [Mixamo_RightHandPinky3]    = "mixamorig:RightHandPinky3",
     [Mixamo_RightHandPinky4]    = "mixamorig:RightHandPinky4",
+    [Mixamo_LeftHip]            = "mixamorig:LeftUpLeg",
+    [Mixamo_LeftKnee]           = "mixamorig:LeftLeg",
+    [Mixamo_LeftFoot]           = "mixamorig:LeftFoot",
+    [Mixamo_LeftToeBase]        = "mixamorig:LeftToeBase",
+    [Mixamo_LeftToeEnd]         = "mixamorig:LeftToe_End",
+    [Mixamo_RightHip]           = "mixamorig:RightUpLeg",
+    [Mixamo_RightKnee]          = "mixamorig:RightLeg",
+    [Mixamo_RightFoot]          = "mixamorig:RightFoot",
+    [Mixamo_RightToeBase]       = "mixamorig:RightToeBase",
+    [Mixamo_RightToeEnd]        = "mixamorig:RightToe_End",
+};
+
+// NOTE(boti): IK chains set up for Mixamo skins at import
+enum mixamo_ik_chain : u32
+{
+    MixamoIK_RightLeg = 0,
+    MixamoIK_LeftLeg,
+    MixamoIK_RightArm,
+    MixamoIK_LeftArm,
+
+    MixamoIK_Count,
 };
 
 //
 // Texture
 //
 
+// NOTE(boti): The metadata (Info and DataOffset) is read from the file header after the texture gets registered
+// (see LoadTextureMetadata), so that only the requested mips have to be read when streaming.
+// The header reads are asynchronous, the texture doesn't get streamed until its metadata has arrived.
+// The offsets of the individual mips follow from the info (see GetPackedTexture2DMipOffset).
+// If the header couldn't be read, the format stays undefined and the first load reads the whole file.
 struct texture
 {
     renderer_texture_id RendererID;
     b32 HasIORequest;
+    b32 IsMetadataPending;
     texture_info Info;
+    u32 DataOffset; // NOTE(boti): File offset of the most detailed mip
     platform_file File;
 };
 
@@ -244,15 +325,47 @@ enum texture_type : u32
     TextureType_Count,
 };
 
+enum texture_load_state : u32
+{
+    TextureLoad_Pending = 0,    // NOTE(boti): Waiting for the IO to finish
+    TextureLoad_Loaded,         // NOTE(boti): File contents are in the ring buffer, waiting to be uploaded
+    TextureLoad_Done,           // NOTE(boti): Uploaded or dropped, the ring buffer memory can be reused
+};
+
 struct texture_load_entry
 {
     texture* Texture;
     u64 IOCompletion;
     umm RingBufferOffset;
+    umm ByteCount;
+    umm FileOffset;     // NOTE(boti): 0 if the whole file (including the header) is loaded
+    u32 BaseMip;        // NOTE(boti): Most detailed mip that was loaded
+    texture_load_state State;
+    u32 UnrequestedFrameCount; // NOTE(boti): Frames spent loaded without the texture being requested
 };
 
+// NOTE(boti): Texture requests get serviced in priority order (see texture_request), 
+// both when issuing the IO and when uploading the loaded textures.
+// The requests are regenerated from the mip feedback every frame, so the priorities are always up to date,
+// and a request that's no longer in the feedback is effectively cancelled:
+// - a texture that's not loading yet simply won't get an IO request,
+// - a loaded texture is kept around for a few frames (in case the request comes back) and then dropped.
+// A texture only ever has a single load in flight, the upload uses whatever mips are requested when it's ready,
+// so new requests for a texture that's already loading get merged into the existing load.
+//
+// The loads are freed from the ring buffer in order, so a loaded texture that's waiting to be uploaded
+// can hold up the reuse of the memory behind it.
+//
+// The uploads are throttled by the renderer's upload budget (see CanUpload()) and by the time spent copying.
+// A texture that doesn't fit gets its less detailed mips uploaded first, and stays loaded until the rest follow.
+// New loads aren't started while MaxPendingByteCount is waiting to be uploaded (or still loading).
 struct texture_load_queue
 {
+    static constexpr umm MaxIOBytesPerFrame = MiB(64);
+    static constexpr umm MaxPendingByteCount = MiB(128);
+    static constexpr f32 MaxUploadTimePerFrame = 2.0e-3f; // NOTE(boti): In seconds
+    static constexpr u32 MaxUnrequestedFrameCount = 8;
+
     umm RingBufferSize;
     umm RingBufferReadAt;
     umm RingBufferWriteAt;
@@ -264,6 +377,19 @@ struct texture_load_queue
     texture_load_entry Entries[MaxEntryCount];
 };
 
+// NOTE(boti): Header reads issued by LoadTextureMetadata, in IO order.
+// The completed ones get processed at the beginning of ProcessTextureRequests.
+// Textures that don't fit in the queue don't get metadata, and fall back to loading the whole file.
+struct texture_metadata_queue
+{
+    static constexpr u32 MaxEntryCount = 4096;
+    u32 ReadAt;
+    u32 WriteAt;
+    u32 TextureIndices[MaxEntryCount];
+    u64 IOCompletions[MaxEntryCount];
+    dds_file Headers[MaxEntryCount];
+};
+
 inline umm GetRingBufferOffset(umm BufferSize, umm CurrentBufferOffset, umm PayloadSize, umm Alignment = 0)
 {
     umm Result = Alignment ? Align(CurrentBufferOffset, Alignment) : CurrentBufferOffset;
@@ -343,6 +469,7 @@ struct assets
 {
     memory_arena Arena;
     texture_load_queue LoadQueue;
+    texture_metadata_queue MetadataQueue;
 
     u32 WhitenessID;
     u32 HalfGrayID;
@@ -372,6 +499,7 @@ struct assets
     u32 AnimationCount;
 
     texture Textures[MaxTextureCount];
+    asset_texture_index RendererTextureIndex; // NOTE(boti): Maintained by AllocateAssetTexture
     mesh Meshes[MaxMeshCount];
     model Models[MaxModelCount];
     material Materials[MaxMaterialCount];
@@ -381,6 +509,14 @@ struct assets
 
 inline mesh* GetDefaultMesh(assets* Assets, u32 Mesh);
 
+// NOTE(boti): Allocates the renderer texture of an asset texture and records the ID in the reverse index
+lbfn renderer_texture_id AllocateAssetTexture(assets* Assets, render_frame* Frame, u32 TextureIndex, 
+                                             texture_flags Flags, const texture_info* Info, renderer_texture_id Placeholder);
+// NOTE(boti): Returns nullptr if the renderer texture doesn't belong to an asset texture
+inline texture* GetTextureFromRendererID(assets* Assets, renderer_texture_id ID);
+// NOTE(boti): Issues the header reads of the textures, their metadata gets filled in by ProcessTextureRequests once the reads complete
+lbfn void LoadTextureMetadata(assets* Assets, u32 Count, const u32* TextureIndices);
+
 struct texture_set
 {
     u32 IDs[TextureType_Count];
@@ -516,6 +652,17 @@ inline mesh* GetDefaultMesh(assets* Assets, u32 Mesh)
     return(Result);
 }
 
+inline texture* GetTextureFromRendererID(assets* Assets, renderer_texture_id ID)
+{
+    texture* Result = nullptr;
+    u32 TextureIndex = GetAssetTextureIndex(&Assets->RendererTextureIndex, ID, Assets->TextureCount);
+    if (TextureIndex != U32_MAX)
+    {
+        Result = Assets->Textures + TextureIndex;
+    }
+    return(Result);
+}
+
 inline m4 TRSToM4(trs_transform Transform)
 {
     m4 Result;
@@ -588,6 +735,36 @@ inline trs_transform M4ToTRS(m4 M)
     return(Result);
 }
 
+inline trs_transform GetJointTransform(const joint_pose* Pose, u32 JointIndex)
+{
+    Assert(JointIndex < R_MaxJointCount);
+    trs_transform Result = 
+    {
+        .Rotation = 
+        { 
+            Pose->Rotation[0][JointIndex], Pose->Rotation[1][JointIndex], 
+            Pose->Rotation[2][JointIndex], Pose->Rotation[3][JointIndex],
+        },
+        .Position = { Pose->Position[0][JointIndex], Pose->Position[1][JointIndex], Pose->Position[2][JointIndex] },
+        .Scale = { Pose->Scale[0][JointIndex], Pose->Scale[1][JointIndex], Pose->Scale[2][JointIndex] },
+    };
+    return(Result);
+}
+
+inline void SetJointTransform(joint_pose* Pose, u32 JointIndex, trs_transform Transform)
+{
+    Assert(JointIndex < R_MaxJointCount);
+    for (u32 Component = 0; Component < 4; Component++)
+    {
+        Pose->Rotation[Component][JointIndex] = Transform.Rotation.E[Component];
+    }
+    for (u32 Component = 0; Component < 3; Component++)
+    {
+        Pose->Position[Component][JointIndex] = Transform.Position.E[Component];
+        Pose->Scale[Component][JointIndex] = Transform.Scale.E[Component];
+    }
+}
+
 inline b32 JointMaskIndexFromJointIndex(u32 JointIndex, u32* ArrayIndex, u32* BitIndex)
 {
     b32 Result = false;
@@ -610,4 +787,49 @@ inline b32 IsJointActive(animation* Animation, u32 JointIndex)
         Result = (Animation->ActiveJoints.Bits[ArrayIndex] & Mask) != 0;
     }
     return(Result);
-}
\ No newline at end of file
+}
+
+inline animation_curve* GetAnimationCurve(animation* Animation, u32 JointIndex, animation_channel Channel)
+{
+    Assert(JointIndex < Animation->JointCount);
+    animation_curve* Result = Animation->Curves + (JointIndex * AnimationChannel_Count + Channel);
+    return(Result);
+}
+
+inline f32 DecodeAnimationTime(animation* Animation, u16 Time)
+{
+    f32 Result = Animation->MaxTimestamp * (Time * (1.0f / 65535.0f));
+    return(Result);
+}
+
+inline v4 DecodeRotationKey(const animation_key* Key)
+{
+    constexpr f32 Bound = 0.70710678f;
+    f32 a = ((Key->Values[0] & 0x7FFF) * (1.0f / 32767.0f)) * (2.0f * Bound) - Bound;
+    f32 b = ((Key->Values[1] & 0x7FFF) * (1.0f / 32767.0f)) * (2.0f * Bound) - Bound;
+    f32 c = ((Key->Values[2] & 0x7FFF) * (1.0f / 32767.0f)) * (2.0f * Bound) - Bound;
+    f32 Largest = Sqrt(Max(1.0f - (a*a + b*b + c*c), 0.0f));
+
+    u32 LargestIndex = (Key->Values[0] >> 15) | ((Key->Values[1] >> 15) << 1);
+    v4 Result = {};
+    switch (LargestIndex)
+    {
+        case 0: Result = { Largest, a, b, c }; break;
+        case 1: Result = { a, Largest, b, c }; break;
+        case 2: Result = { a, b, Largest, c }; break;
+        case 3: Result = { a, b, c, Largest }; break;
+        InvalidDefaultCase;
+    }
+    return(Result);
+}
+
+inline v3 DecodeVectorKey(const animation_curve* Curve, const animation_key* Key)
+{
+    v3 Result = 
+    {
+        Curve->Min.X + Curve->Extent.X * (Key->Values[0] * (1.0f / 65535.0f)),
+        Curve->Min.Y + Curve->Extent.Y * (Key->Values[1] * (1.0f / 65535.0f)),
+        Curve->Min.Z + Curve->Extent.Z * (Key->Values[2] * (1.0f / 65535.0f)),
+    };
+    return(Result);
+}
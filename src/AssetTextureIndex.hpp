@@ -0,0 +1,46 @@
+#pragma once
+
+// NOTE(boti): Index of the asset texture for each renderer texture ID,
+// so that the texture requests coming from the renderer can be serviced without searching the asset textures.
+// Renderer textures that aren't owned by the assets map to U32_MAX.
+struct asset_texture_index
+{
+    u32 TextureIndexFromRendererID[R_MaxTextureCount];
+};
+
+inline void InitAssetTextureIndex(asset_texture_index* Index);
+inline void SetAssetTextureIndex(asset_texture_index* Index, renderer_texture_id ID, u32 TextureIndex);
+// NOTE(boti): Returns U32_MAX if the renderer texture doesn't belong to one of the first TextureCount asset textures
+inline u32 GetAssetTextureIndex(asset_texture_index* Index, renderer_texture_id ID, u32 TextureCount);
+
+//
+// Implementation
+//
+
+inline void InitAssetTextureIndex(asset_texture_index* Index)
+{
+    for (u32 RendererID = 0; RendererID < R_MaxTextureCount; RendererID++)
+    {
+        Index->TextureIndexFromRendererID[RendererID] = U32_MAX;
+    }
+}
+
+inline void SetAssetTextureIndex(asset_texture_index* Index, renderer_texture_id ID, u32 TextureIndex)
+{
+    Assert(ID.Value < R_MaxTextureCount);
+    Index->TextureIndexFromRendererID[ID.Value] = TextureIndex;
+}
+
+inline u32 GetAssetTextureIndex(asset_texture_index* Index, renderer_texture_id ID, u32 TextureCount)
+{
+    u32 Result = U32_MAX;
+    if (ID.Value < R_MaxTextureCount)
+    {
+        u32 TextureIndex = Index->TextureIndexFromRendererID[ID.Value];
+        if (TextureIndex < TextureCount)
+        {
+            Result = TextureIndex;
+        }
+    }
+    return(Result);
+}
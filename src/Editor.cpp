@@ -186,6 +186,9 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
             render_stat_mem_entry* Entry = Stats->MemoryEntries + Index;
             TextGUI(&Context, TextSize, "%s memory: %llu/%llu MB", Entry->Name, Entry->UsedSize >> 20, Entry->AllocationSize >> 20);
         }
+        TextGUI(&Context, TextSize, "TextureCache fragmentation: %.2f (%llu free ranges)", 
+                Stats->TextureCacheFragmentation, Stats->TextureCacheFreeRangeCount);
+        TextGUI(&Context, TextSize, "Uploads: %llu/%llu MB", Stats->UploadByteCount >> 20, R_MaxUploadBytesPerFrame >> 20);
     }
     else if (Editor->SelectedMenuID == RenderMenuID)
     {
@@ -328,39 +331,44 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
         entity_id SelectedEntityID = { 0 };
 
         f32 tMax = 1e7f;
-        for (entity_iterator It = MakeEntityIterator(World); IsValid(It); It = Next(It))
+
+        memory_arena_checkpoint Checkpoint = ArenaCheckpoint(&Game->TransientArena);
+        bvh_query_result Candidates = QueryBVHRay(&World->BVH, Ray, tMax, &Game->TransientArena);
+        for (u32 CandidateIndex = 0; CandidateIndex < Candidates.Count; CandidateIndex++)
         {
-            m4 Transform = It.Entity->Transform;
+            bvh_node* Leaf = World->BVH.Nodes + Candidates.ProxyIDs[CandidateIndex];
+            entity* Entity = GetEntity(World, Leaf->EntityID);
+            m4 Transform = Entity->Transform;
 
-            if (HasFlag(It.Entity->Flags, EntityFlag_Mesh))
+            if (HasFlag(Entity->Flags, EntityFlag_Mesh))
             {
-                for (u32 PieceIndex = 0; PieceIndex < It.Entity->PieceCount; PieceIndex++)
+                Assert(Leaf->PieceIndex < Entity->PieceCount);
+                entity_piece* Piece = Entity->Pieces + Leaf->PieceIndex;
+                mesh* Mesh = Assets->Meshes + Piece->MeshID;
+                mmbox Box = Mesh->BoundingBox;
+                v3 BoxP = 0.5f * (Box.Min + Box.Max);
+                v3 HalfExtent = 0.5f * (Box.Max - Box.Min);
+                Transform.P.XYZ += Piece->OffsetP;
+
+                f32 t = 0.0f;
+                if (IntersectRayBox(Ray, BoxP, HalfExtent, Transform, tMax, &t))
                 {
-                    mesh* Mesh = Assets->Meshes + It.Entity->Pieces[PieceIndex].MeshID;
-                    mmbox Box = Mesh->BoundingBox;
-                    v3 BoxP = 0.5f * (Box.Min + Box.Max);
-                    v3 HalfExtent = 0.5f * (Box.Max - Box.Min);
-        
-                    // TODO(boti): Apply piece offset to transform
-                    f32 t = 0.0f;
-                    if (IntersectRayBox(Ray, BoxP, HalfExtent, Transform, tMax, &t))
-                    {
-                        SelectedEntityID = It.ID;
-                        tMax = t;
-                    }
+                    SelectedEntityID = Leaf->EntityID;
+                    tMax = t;
                 }
             }
-            else if (HasFlag(It.Entity->Flags, EntityFlag_LightSource))
+            else if (HasFlag(Entity->Flags, EntityFlag_LightSource))
             {
                 v3 HalfExtent = v3{ World->LightProxyScale, World->LightProxyScale, World->LightProxyScale };
                 f32 t = 0.0f;
                 if (IntersectRayBox(Ray, v3{ 0.0f, 0.0f, 0.0f }, HalfExtent, Transform, tMax, &t))
                 {
-                    SelectedEntityID = It.ID;
+                    SelectedEntityID = Leaf->EntityID;
                     tMax = t;
                 }
             }
         }
+        RestoreArena(&Game->TransientArena, Checkpoint);
         Editor->SelectedEntityID = SelectedEntityID;
     }
 
@@ -374,9 +382,11 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
 
         if (HasFlag(Entity->Flags, EntityFlag_Skin))
         {
+            constexpr f32 AnimationFadeTime = 0.25f;
+            animator* Animator = GetAnimator(World, Entity->AnimatorID);
             if (WasPressed(IO->Keys[SC_P]))
             {
-                Entity->DoAnimation = !Entity->DoAnimation;
+                Animator->IsPlaying = !Animator->IsPlaying;
             }
 
             // Gather the animations for the entity's skin
@@ -385,7 +395,7 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
             for (u32 AnimationIndex = 0; AnimationIndex < Assets->AnimationCount; AnimationIndex++)
             {
                 animation* Animation = Assets->Animations + AnimationIndex;
-                if (Animation->SkinID == Entity->SkinID)
+                if (Animation->SkinID == Animator->SkinID)
                 {
                     AnimationIDs[AnimationCount++] = AnimationIndex;
                     if (AnimationCount == CountOf(AnimationIDs))
@@ -397,8 +407,7 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
 
             if (WasPressed(IO->Keys[SC_0]))
             {
-                Entity->CurrentAnimationID = 0;
-                Entity->AnimationCounter = 0.0f;
+                PlayAnimation(Animator, 0, AnimationFadeTime);
             }
 
             for (u32 Scancode = SC_1; Scancode <= SC_9; Scancode++)
@@ -406,8 +415,7 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
                 if (WasPressed(IO->Keys[Scancode]))
                 {
                     u32 Index = Scancode - SC_1;
-                    Entity->CurrentAnimationID = AnimationIDs[Index];
-                    Entity->AnimationCounter = 0.0f;
+                    PlayAnimation(Animator, AnimationIDs[Index], AnimationFadeTime);
                 }
             }
 
@@ -425,18 +433,28 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
             PushRect(Frame, { MinX - OutlineSize, MinY}, { MinX + OutlineSize, MaxY }, {}, {}, PackRGBA8(0xFF, 0xFF, 0xFF));
             PushRect(Frame, { MaxX - OutlineSize, MinY}, { MaxX + OutlineSize, MaxY }, {}, {}, PackRGBA8(0xFF, 0xFF, 0xFF));
             
-            animation* Animation = Game->Assets->Animations + Entity->CurrentAnimationID;
-            f32 MaxTimestamp = Animation->KeyFrameTimestamps[Animation->KeyFrameCount - 1];
+            // NOTE(boti): The timeline shows the animation that's being faded in (or is already fully playing)
+            animation_layer* Layer = GetCurrentBaseLayer(Animator);
+            animation* Animation = Game->Assets->Animations + (Layer ? Layer->AnimationID : 0);
+            f32 MaxTimestamp = Animation->MaxTimestamp;
             f32 ExtentX = (MaxX - MinX);
-            f32 PlayX = MinX + ExtentX * Entity->AnimationCounter / MaxTimestamp;
+            f32 PlayX = MinX + ExtentX * Ratio0(Layer ? Layer->Time : 0.0f, MaxTimestamp);
             f32 IndicatorSize = 5.0f;
             PushRect(Frame, { PlayX - IndicatorSize, MinY }, { PlayX + IndicatorSize, MaxY }, {}, {}, PackRGBA8(0xFF, 0xFF, 0xFF));
             
-            for (u32 KeyFrameIndex = 0; KeyFrameIndex < Animation->KeyFrameCount; KeyFrameIndex++)
+            // NOTE(boti): Curves have their own keys now, we only show the keys of the root joint
+            if (Animation->JointCount)
             {
-                f32 Timestamp = Animation->KeyFrameTimestamps[KeyFrameIndex];
-                f32 X = MinX + ExtentX * (Timestamp / MaxTimestamp);
-                PushRect(Frame, { X - 0.5f, MinY }, { X + 0.5f, MaxY }, {}, {}, PackRGBA8(0xFF, 0xFF, 0x00));
+                for (u32 Channel = 0; Channel < AnimationChannel_Count; Channel++)
+                {
+                    animation_curve* Curve = GetAnimationCurve(Animation, 0, (animation_channel)Channel);
+                    for (u32 KeyIndex = 0; KeyIndex < Curve->KeyCount; KeyIndex++)
+                    {
+                        f32 Timestamp = DecodeAnimationTime(Animation, Animation->Keys[Curve->FirstKey + KeyIndex].Time);
+                        f32 X = MinX + ExtentX * Ratio0(Timestamp, MaxTimestamp);
+                        PushRect(Frame, { X - 0.5f, MinY }, { X + 0.5f, MaxY }, {}, {}, PackRGBA8(0xFF, 0xFF, 0x00));
+                    }
+                }
             }
             
             if (PointRectOverlap(IO->Mouse.P, { { MinX, MinY}, { MaxX, MaxY } }))
@@ -450,7 +468,10 @@ lbfn void UpdateEditor(game_state* Game, game_io* IO, render_frame* Frame)
             
             if (Context.ActiveID == PlaybackID)
             {
-                Entity->AnimationCounter = Clamp(MaxTimestamp * (IO->Mouse.P.X - MinX) / ExtentX, 0.0f, MaxTimestamp);
+                if (Layer)
+                {
+                    Layer->Time = Clamp(MaxTimestamp * (IO->Mouse.P.X - MinX) / ExtentX, 0.0f, MaxTimestamp);
+                }
                 if (Context.MouseLeft.bIsDown == false)
                 {
                     Context.ActiveID = 0;
@@ -4,6 +4,7 @@
 
 #include "Font.cpp"
 #include "Asset.cpp"
+#include "Animation.cpp"
 #include "World.cpp"
 #include "Editor.cpp"
 #include "profiler.cpp"
@@ -126,7 +127,7 @@ void Game_UpdateAndRender(thread_context* ThreadContext, game_memory* Memory, ga
 
     ProcessTextureRequests(GameState->Assets, RenderFrame);
 
-    UpdateAndRenderWorld(GameState->World, GameState->Assets, RenderFrame, GameIO, 
+    UpdateAndRenderWorld(GameState->World, GameState->Assets, RenderFrame, ThreadContext, GameIO, 
                          &GameState->TransientArena, GameState->Editor.DebugFlags);
     Platform.EndRenderFrame(RenderFrame, ThreadContext);
 
@@ -26,8 +26,16 @@ enum debug_flag : debug_flags
     DebugFlag_DrawJoints,
 };
 
+struct ray
+{
+    v3 P;
+    v3 V;
+};
+
 #include "Font.hpp"
+#include "AssetTextureIndex.hpp"
 #include "Asset.hpp"
+#include "Animation.hpp"
 #include "World.hpp"
 #include "Editor.hpp"
 
@@ -63,12 +71,6 @@ struct game_state
     f32 PerfDataLog[MaxPerfDataCount];
 };
 
-struct ray
-{
-    v3 P;
-    v3 V;
-};
-
 static bool IntersectRayBox(ray Ray, v3 P, v3 HalfExtent, m4 Transform, f32 tMax, f32* tOut);
 
 static bool IntersectRayBox(ray Ray, v3 P, v3 HalfExtent, m4 Transform, f32 tMax, f32* tOut)
@@ -24,7 +24,8 @@
 #error Unknown compiler
 #endif
 
-#if !LB_COMPILER_CLANGCL
+// NOTE(boti): Clang and GCC are only used to build the headless tests (see tests/Makefile)
+#if !(LB_COMPILER_CLANGCL || LB_COMPILER_CLANG || LB_COMPILER_GCC)
 #error Unsupported compiler
 #endif
 
@@ -46,6 +47,7 @@
 #include <cfloat>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 
 typedef uintptr_t umm;
 typedef intptr_t smm;
@@ -481,6 +483,13 @@ struct mmbox
     v3 Max;
 };
 
+inline mmbox Union(mmbox A, mmbox B);
+inline b32 Contains(mmbox Outer, mmbox Inner);
+inline b32 Intersects(mmbox A, mmbox B);
+inline f32 SurfaceArea(mmbox Box);
+// NOTE(boti): Returns the world space AABB that encloses the transformed box
+inline mmbox TransformBox(const m4& M, mmbox Box);
+
 inline v4 QMul(v4 A, v4 B);
 inline m4 QuaternionToM4(v4 Q);
 inline v4 QuatFromAxisAngle(v3 Axis, f32 Angle);
@@ -1088,6 +1097,51 @@ inline bool PointRectOverlap(v2 P, mmrect2 Rect)
     return(Result);
 }
 
+inline mmbox Union(mmbox A, mmbox B)
+{
+    mmbox Result = { Min(A.Min, B.Min), Max(A.Max, B.Max) };
+    return(Result);
+}
+
+inline b32 Contains(mmbox Outer, mmbox Inner)
+{
+    b32 Result = 
+        (Outer.Min.X <= Inner.Min.X) && (Inner.Max.X <= Outer.Max.X) &&
+        (Outer.Min.Y <= Inner.Min.Y) && (Inner.Max.Y <= Outer.Max.Y) &&
+        (Outer.Min.Z <= Inner.Min.Z) && (Inner.Max.Z <= Outer.Max.Z);
+    return(Result);
+}
+
+inline b32 Intersects(mmbox A, mmbox B)
+{
+    b32 Result = 
+        (A.Min.X <= B.Max.X) && (B.Min.X <= A.Max.X) &&
+        (A.Min.Y <= B.Max.Y) && (B.Min.Y <= A.Max.Y) &&
+        (A.Min.Z <= B.Max.Z) && (B.Min.Z <= A.Max.Z);
+    return(Result);
+}
+
+inline f32 SurfaceArea(mmbox Box)
+{
+    v3 d = Box.Max - Box.Min;
+    f32 Result = 2.0f * (d.X*d.Y + d.Y*d.Z + d.Z*d.X);
+    return(Result);
+}
+
+inline mmbox TransformBox(const m4& M, mmbox Box)
+{
+    v3 CenterP = TransformPoint(M, 0.5f * (Box.Min + Box.Max));
+    v3 HalfExtent = 0.5f * (Box.Max - Box.Min);
+    v3 EffectiveHalfExtent = 
+    {
+        Abs(M.X.X) * HalfExtent.X + Abs(M.Y.X) * HalfExtent.Y + Abs(M.Z.X) * HalfExtent.Z,
+        Abs(M.X.Y) * HalfExtent.X + Abs(M.Y.Y) * HalfExtent.Y + Abs(M.Z.Y) * HalfExtent.Z,
+        Abs(M.X.Z) * HalfExtent.X + Abs(M.Y.Z) * HalfExtent.Y + Abs(M.Z.Z) * HalfExtent.Z,
+    };
+    mmbox Result = { CenterP - EffectiveHalfExtent, CenterP + EffectiveHalfExtent };
+    return(Result);
+}
+
 inline v4 QMul(v4 A, v4 B)
 {
     v4 Result;
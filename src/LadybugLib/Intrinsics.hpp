@@ -1,12 +1,14 @@
 #pragma once
 
-// TODO(boti): make this file cross-compiler compatible
+#include "Core.hpp"
 
+#if LB_COMPILER_CLANGCL || LB_COMPILER_MSVC
 #include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 #include <immintrin.h>
 
-#include "Core.hpp"
-
 #if DEVELOPER
 #define LB_INLINE inline
 #else
@@ -115,7 +117,11 @@ LB_INLINE void EndianFlip(void* Dst, const void* Src, u32 ByteCount)
 
 LB_INLINE u32 TrailingZeroCount(u32 Value)
 {
+#if LB_COMPILER_CLANGCL || LB_COMPILER_MSVC
     u32 Result = (u32)_mm_tzcnt_32(Value);
+#else
+    u32 Result = (u32)__tzcnt_u32(Value);
+#endif
     return(Result);
 }
 
@@ -132,6 +138,8 @@ LB_INLINE u32 FindLeastSignificantSetBit(u32 Value)
     return(Result);
 }
 
+// NOTE(boti): unsigned long is 64 bits outside of Windows, so the GCC/Clang versions go through the builtins instead
+#if LB_COMPILER_CLANGCL || LB_COMPILER_MSVC
 LB_INLINE u8 BitScanForward(u32* Result, u32 Value)
 {
     return _BitScanForward((unsigned long*)Result, Value);
@@ -161,6 +169,59 @@ LB_INLINE b32 BitTestAndComplement(u32* Value, u32 Bit)
 {
     return (b32)_bittestandcomplement((long*)Value, (long)Bit);
 }
+#else
+LB_INLINE u8 BitScanForward(u32* Result, u32 Value)
+{
+    u8 Found = (Value != 0);
+    if (Found)
+    {
+        *Result = (u32)__builtin_ctz(Value);
+    }
+    return(Found);
+}
+
+LB_INLINE u8 BitScanReverse(u32* Result, u32 Value)
+{
+    u8 Found = (Value != 0);
+    if (Found)
+    {
+        *Result = 31u - (u32)__builtin_clz(Value);
+    }
+    return(Found);
+}
+
+LB_INLINE u8 BitScanForward(u32* Result, u64 Value)
+{
+    u8 Found = (Value != 0);
+    if (Found)
+    {
+        *Result = (u32)__builtin_ctzll(Value);
+    }
+    return(Found);
+}
+
+LB_INLINE u8 BitScanReverse(u32* Result, u64 Value)
+{
+    u8 Found = (Value != 0);
+    if (Found)
+    {
+        *Result = 63u - (u32)__builtin_clzll(Value);
+    }
+    return(Found);
+}
+
+LB_INLINE b32 BitTest(u32 Value, u32 Bit)
+{
+    return (b32)((Value >> Bit) & 1u);
+}
+
+LB_INLINE b32 BitTestAndComplement(u32* Value, u32 Bit)
+{
+    b32 Result = (b32)((*Value >> Bit) & 1u);
+    *Value ^= (1u << Bit);
+    return(Result);
+}
+#endif
 
 LB_INLINE u32 SetBitsBelowHighInclusive(u32 Value)
 {
@@ -200,6 +261,7 @@ LB_INLINE u64 AtomicLoad(const u64* Value)
     return *(const volatile u64*)Value;
 }
 
+#if LB_COMPILER_CLANGCL || LB_COMPILER_MSVC
 LB_INLINE u32 AtomicLoadAndIncrement(volatile u32* Value)
 {
     u32 Result = (u32)(_InterlockedIncrement((long*)Value) - 1);
@@ -216,4 +278,23 @@ LB_INLINE u32 AtomicExchange(volatile u32* Address, u32 Value)
 {
     u32 Result = (u32)_InterlockedExchange((volatile long*)Address, (long)Value);
     return(Result);
-}
\ No newline at end of file
+}
+#else
+LB_INLINE u32 AtomicLoadAndIncrement(volatile u32* Value)
+{
+    u32 Result = __atomic_fetch_add(Value, 1u, __ATOMIC_SEQ_CST);
+    return(Result);
+}
+
+LB_INLINE u64 AtomicLoadAndIncrement(volatile u64* Value)
+{
+    u64 Result = __atomic_fetch_add(Value, 1llu, __ATOMIC_SEQ_CST);
+    return(Result);
+}
+
+LB_INLINE u32 AtomicExchange(volatile u32* Address, u32 Value)
+{
+    u32 Result = __atomic_exchange_n(Address, Value, __ATOMIC_SEQ_CST);
+    return(Result);
+}
+#endif
\ No newline at end of file
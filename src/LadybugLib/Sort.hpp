@@ -0,0 +1,242 @@
+#pragma once
+
+#include "Core.hpp"
+
+// NOTE(boti): Maps floats to u32s so that the integer order matches the float order (NaNs aside)
+inline u32 FloatToSortKey(f32 Value);
+
+// NOTE(boti): Stable LSD radix sort on 32-bit keys, with the values carried along.
+// The temp arrays must be able to hold Count elements, the sorted result always ends up in Keys/Values.
+inline void RadixSort32(u32 Count, u32* Keys, u32* Values, u32* TempKeys, u32* TempValues);
+// NOTE(boti): Same as RadixSort32, with 64-bit keys
+inline void RadixSort64(u32 Count, u64* Keys, u32* Values, u64* TempKeys, u32* TempValues);
+
+// NOTE(boti): Chunked version of RadixSort64 for sorting on multiple threads.
+// The keys are split into ChunkCount contiguous chunks, each pass has a count and a scatter phase
+// in which the chunks can be processed in parallel:
+//
+//  radix_sort64 Sort = BeginRadixSort64(...);
+//  for (u32 Pass = 0; Pass < radix_sort64::PassCount; Pass++)
+//  {
+//      CountRadixSortChunk(&Sort, Chunk) for each chunk
+//      if (PrefixRadixSortPass(&Sort))
+//      {
+//          ScatterRadixSortChunk(&Sort, Chunk) for each chunk
+//      }
+//      EndRadixSortPass(&Sort);
+//  }
+//  EndRadixSort64(&Sort);
+struct radix_sort64
+{
+    static constexpr u32 DigitBitCount = 8;
+    static constexpr u32 DigitCount = 1u << DigitBitCount;
+    static constexpr u32 PassCount = 64 / DigitBitCount;
+
+    u32 Count;
+    u32 ChunkCount;
+    u32 ChunkSize;
+    u32 Pass;
+    b32 DidScatter;
+
+    u64* Keys;
+    u32* Values;
+    u64* SrcKeys;
+    u32* SrcValues;
+    u64* DstKeys;
+    u32* DstValues;
+
+    // NOTE(boti): Digit counts of each chunk, turned into the scatter offsets by PrefixRadixSortPass()
+    u32 (*ChunkOffsets)[DigitCount];
+};
+
+// NOTE(boti): ChunkOffsets must have room for ChunkCount histograms
+inline radix_sort64 BeginRadixSort64(u32 Count, u64* Keys, u32* Values, u64* TempKeys, u32* TempValues, 
+                                     u32 ChunkCount, u32 (*ChunkOffsets)[radix_sort64::DigitCount]);
+inline void CountRadixSortChunk(radix_sort64* Sort, u32 ChunkIndex);
+// NOTE(boti): Returns false if the pass wouldn't change the order (i.e. every key has the same digit)
+inline b32 PrefixRadixSortPass(radix_sort64* Sort);
+inline void ScatterRadixSortChunk(radix_sort64* Sort, u32 ChunkIndex);
+inline void EndRadixSortPass(radix_sort64* Sort);
+inline void EndRadixSort64(radix_sort64* Sort);
+
+//
+// Implementation
+//
+
+inline u32 FloatToSortKey(f32 Value)
+{
+    u32 Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+    u32 Mask = (Bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+    u32 Result = Bits ^ Mask;
+    return(Result);
+}
+
+inline void RadixSort32(u32 Count, u32* Keys, u32* Values, u32* TempKeys, u32* TempValues)
+{
+    constexpr u32 DigitBitCount = 8;
+    constexpr u32 DigitCount = 1u << DigitBitCount;
+    constexpr u32 PassCount = 32 / DigitBitCount;
+
+    // NOTE(boti): All of the histograms are built in a single pass over the keys
+    u32 Histograms[PassCount][DigitCount] = {};
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        u32 Key = Keys[Index];
+        for (u32 Pass = 0; Pass < PassCount; Pass++)
+        {
+            Histograms[Pass][(Key >> (Pass * DigitBitCount)) & (DigitCount - 1)]++;
+        }
+    }
+
+    u32* SrcKeys = Keys;
+    u32* SrcValues = Values;
+    u32* DstKeys = TempKeys;
+    u32* DstValues = TempValues;
+    for (u32 Pass = 0; Pass < PassCount; Pass++)
+    {
+        u32* Histogram = Histograms[Pass];
+        u32 Shift = Pass * DigitBitCount;
+
+        // NOTE(boti): Passes where every key has the same digit wouldn't change the order
+        if ((Count == 0) || (Histogram[(SrcKeys[0] >> Shift) & (DigitCount - 1)] == Count))
+        {
+            continue;
+        }
+
+        u32 Offset = 0;
+        for (u32 Digit = 0; Digit < DigitCount; Digit++)
+        {
+            u32 BucketSize = Histogram[Digit];
+            Histogram[Digit] = Offset;
+            Offset += BucketSize;
+        }
+
+        for (u32 Index = 0; Index < Count; Index++)
+        {
+            u32 Key = SrcKeys[Index];
+            u32 Dst = Histogram[(Key >> Shift) & (DigitCount - 1)]++;
+            DstKeys[Dst] = Key;
+            DstValues[Dst] = SrcValues[Index];
+        }
+
+        u32* Temp;
+        Temp = SrcKeys; SrcKeys = DstKeys; DstKeys = Temp;
+        Temp = SrcValues; SrcValues = DstValues; DstValues = Temp;
+    }
+
+    if (SrcKeys != Keys)
+    {
+        memcpy(Keys, SrcKeys, Count * sizeof(u32));
+        memcpy(Values, SrcValues, Count * sizeof(u32));
+    }
+}
+
+inline void RadixSort64(u32 Count, u64* Keys, u32* Values, u64* TempKeys, u32* TempValues)
+{
+    u32 ChunkOffsets[1][radix_sort64::DigitCount];
+    radix_sort64 Sort = BeginRadixSort64(Count, Keys, Values, TempKeys, TempValues, 1, ChunkOffsets);
+    for (u32 Pass = 0; Pass < radix_sort64::PassCount; Pass++)
+    {
+        CountRadixSortChunk(&Sort, 0);
+        if (PrefixRadixSortPass(&Sort))
+        {
+            ScatterRadixSortChunk(&Sort, 0);
+        }
+        EndRadixSortPass(&Sort);
+    }
+    EndRadixSort64(&Sort);
+}
+
+inline radix_sort64 BeginRadixSort64(u32 Count, u64* Keys, u32* Values, u64* TempKeys, u32* TempValues, 
+                                     u32 ChunkCount, u32 (*ChunkOffsets)[radix_sort64::DigitCount])
+{
+    Assert(ChunkCount > 0);
+
+    radix_sort64 Result = {};
+    Result.Count = Count;
+    Result.ChunkCount = ChunkCount;
+    Result.ChunkSize = CeilDiv(Count, ChunkCount);
+    Result.Pass = 0;
+    Result.Keys = Keys;
+    Result.Values = Values;
+    Result.SrcKeys = Keys;
+    Result.SrcValues = Values;
+    Result.DstKeys = TempKeys;
+    Result.DstValues = TempValues;
+    Result.ChunkOffsets = ChunkOffsets;
+    return(Result);
+}
+
+inline void CountRadixSortChunk(radix_sort64* Sort, u32 ChunkIndex)
+{
+    u32* Histogram = Sort->ChunkOffsets[ChunkIndex];
+    memset(Histogram, 0, sizeof(Sort->ChunkOffsets[ChunkIndex]));
+
+    u32 Shift = Sort->Pass * radix_sort64::DigitBitCount;
+    u32 Begin = Min(ChunkIndex * Sort->ChunkSize, Sort->Count);
+    u32 End = Min(Begin + Sort->ChunkSize, Sort->Count);
+    for (u32 Index = Begin; Index < End; Index++)
+    {
+        Histogram[(Sort->SrcKeys[Index] >> Shift) & (radix_sort64::DigitCount - 1)]++;
+    }
+}
+
+inline b32 PrefixRadixSortPass(radix_sort64* Sort)
+{
+    // NOTE(boti): Buckets are laid out digit-major, and chunk order within a bucket keeps the sort stable
+    b32 Result = true;
+    u32 Offset = 0;
+    for (u32 Digit = 0; Digit < radix_sort64::DigitCount; Digit++)
+    {
+        u32 BucketBegin = Offset;
+        for (u32 ChunkIndex = 0; ChunkIndex < Sort->ChunkCount; ChunkIndex++)
+        {
+            u32 ChunkDigitCount = Sort->ChunkOffsets[ChunkIndex][Digit];
+            Sort->ChunkOffsets[ChunkIndex][Digit] = Offset;
+            Offset += ChunkDigitCount;
+        }
+
+        if ((Offset - BucketBegin) == Sort->Count)
+        {
+            Result = false;
+        }
+    }
+    Sort->DidScatter = Result;
+    return(Result);
+}
+
+inline void ScatterRadixSortChunk(radix_sort64* Sort, u32 ChunkIndex)
+{
+    u32* Offsets = Sort->ChunkOffsets[ChunkIndex];
+    u32 Shift = Sort->Pass * radix_sort64::DigitBitCount;
+    u32 Begin = Min(ChunkIndex * Sort->ChunkSize, Sort->Count);
+    u32 End = Min(Begin + Sort->ChunkSize, Sort->Count);
+    for (u32 Index = Begin; Index < End; Index++)
+    {
+        u64 Key = Sort->SrcKeys[Index];
+        u32 Dst = Offsets[(Key >> Shift) & (radix_sort64::DigitCount - 1)]++;
+        Sort->DstKeys[Dst] = Key;
+        Sort->DstValues[Dst] = Sort->SrcValues[Index];
+    }
+}
+
+inline void EndRadixSortPass(radix_sort64* Sort)
+{
+    if (Sort->DidScatter)
+    {
+        u64* TempKeys = Sort->SrcKeys; Sort->SrcKeys = Sort->DstKeys; Sort->DstKeys = TempKeys;
+        u32* TempValues = Sort->SrcValues; Sort->SrcValues = Sort->DstValues; Sort->DstValues = TempValues;
+    }
+    Sort->DidScatter = false;
+    Sort->Pass++;
+}
+
+inline void EndRadixSort64(radix_sort64* Sort)
+{
+    if (Sort->SrcKeys != Sort->Keys)
+    {
+        memcpy(Sort->Keys, Sort->SrcKeys, Sort->Count * sizeof(u64));
+        memcpy(Sort->Values, Sort->SrcValues, Sort->Count * sizeof(u32));
+    }
+}
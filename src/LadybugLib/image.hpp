@@ -522,6 +522,7 @@ internal format_info FormatInfoTable[Format_Count] =
     [Format_D24X8]              = { 4, 1, 2, FormatFlag_None },
     [Format_D32]                = { 4, 1, 1, FormatFlag_None },
     [Format_S8]                 = { 1, 1, 1, FormatFlag_None },
+    [Format_D16S8]              = { 4, 1, 2, FormatFlag_None }, // NOTE(boti): Padded to 32-bits, same as D24S8
     [Format_D24S8]              = { 4, 1, 2, FormatFlag_None },
     [Format_D32S8]              = { 8, 1, 2, FormatFlag_None },
 
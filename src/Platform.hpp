@@ -53,6 +53,9 @@ struct platform_api
     profiler* Profiler;
 
     work_queue* Queue;
+    // NOTE(boti): Long-running work that may span several frames, it must never be completed with CompleteAllWork.
+    // The jobs need to signal their own completion
+    work_queue* BackgroundQueue;
     io_queue*   IOQueue;
 
     //
@@ -76,6 +79,7 @@ struct platform_api
     create_renderer*    CreateRenderer;
     allocate_geometry*  AllocateGeometry;
     allocate_texture*   AllocateTexture;
+    allocate_instance*  AllocateInstance;
     begin_render_frame* BeginRenderFrame;
     end_render_frame*   EndRenderFrame;
 };
@@ -29,7 +29,7 @@ internal bool CreateGeometryMemory(geometry_memory* Memory, geometry_buffer_type
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = nullptr,
         .flags = 0,
-        .size = Memory->GPUBlockSize,
+        .size = geometry_allocator::GPUBlockSize,
         .usage = Usage,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 0,
@@ -42,9 +42,7 @@ internal bool CreateGeometryMemory(geometry_memory* Memory, geometry_buffer_type
     if (BitScanForward(&MemoryTypeIndex, MemoryTypes))
     {
         Memory->MemoryTypeIndex = MemoryTypeIndex;
-        Memory->Stride = Stride;
-        DList_Initialize(&Memory->FreeBlocks, Next, Prev);
-        DList_Initialize(&Memory->UsedBlocks, Next, Prev);
+        Memory->Allocator.Stride = Stride;
     
         Result = true;
     }
@@ -69,21 +67,7 @@ internal bool CreateGeometryBuffer(u64 MaxBlockCount, memory_arena* Arena, geome
         geometry_buffer_block* BlockPool = PushArray(Arena, 0, geometry_buffer_block, MaxBlockCount);
         if (BlockPool)
         {
-            for (u64 i = 0; i < MaxBlockCount; i++)
-            {
-                BlockPool[i].Count = 0;
-                BlockPool[i].Offset = 0;
-                if (i < MaxBlockCount - 1)
-                {
-                    BlockPool[i + 0].Next = BlockPool + (i + 1);
-                    BlockPool[i + 1].Prev = BlockPool + (i + 0);
-                }
-                else
-                {
-                    BlockPool[i].Next = BlockPool + 0;
-                    BlockPool[0].Prev = BlockPool + i;
-                }
-            }
+            BlockPool = InitGeometryBlockPool(BlockPool, MaxBlockCount);
 
             GeometryBuffer->MaxBlockCount = MaxBlockCount;
             GeometryBuffer->BlockPool = BlockPool;
@@ -93,11 +77,13 @@ internal bool CreateGeometryBuffer(u64 MaxBlockCount, memory_arena* Arena, geome
     return Result;
 }
 
+// NOTE(boti): Creates the next GPU allocation and adds its space to the allocator
 internal bool AllocateGPUBlocks(geometry_memory* Memory, geometry_buffer_block*& BlockPool)
 {
     bool Result = false;
 
-    if (Memory->AllocationCount < Memory->MaxGPUAllocationCount)
+    geometry_allocator* Allocator = &Memory->Allocator;
+    if (Allocator->AllocationCount < Allocator->MaxGPUAllocationCount)
     {
         VkBuffer Buffer = VK_NULL_HANDLE;
         VkResult ErrorCode = vkCreateBuffer(VK.Device, &Memory->BlockCreateInfo, nullptr, &Buffer);
@@ -114,7 +100,7 @@ internal bool AllocateGPUBlocks(geometry_memory* Memory, geometry_buffer_block*&
             {
                 .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
                 .pNext = &AllocFlags,
-                .allocationSize = Memory->GPUBlockSize,
+                .allocationSize = Allocator->GPUBlockSize,
                 .memoryTypeIndex = Memory->MemoryTypeIndex,
             };
             VkDeviceMemory DeviceMemory = VK_NULL_HANDLE;
@@ -124,28 +110,17 @@ internal bool AllocateGPUBlocks(geometry_memory* Memory, geometry_buffer_block*&
                 ErrorCode = vkBindBufferMemory(VK.Device, Buffer, DeviceMemory, 0);
                 if (ErrorCode == VK_SUCCESS)
                 {
-                    u32 Index = Memory->AllocationCount++;
-                    Memory->MemoryBlocks[Index] = DeviceMemory;
-                    Memory->MemoryAddresses[Index] = GetBufferDeviceAddress(VK.Device, Buffer);
-                    Memory->Buffers[Index] = Buffer;
-
-                    DeviceMemory = VK_NULL_HANDLE;
-                    Buffer = VK_NULL_HANDLE;
-
-                    geometry_buffer_block* FreeBlock = BlockPool;
-                    BlockPool = BlockPool->Next;
-                    BlockPool->Prev = FreeBlock->Prev;
-                    BlockPool->Prev->Next = BlockPool;
-
-                    Memory->FreeBlocks.Next = Memory->FreeBlocks.Prev = FreeBlock;
-                    FreeBlock->Prev = FreeBlock->Next = &Memory->FreeBlocks;
-
-                    FreeBlock->Count = Memory->GPUBlockSize / Memory->Stride;
-                    // HACK(boti): We should just go back to using byte offsets/counts
-                    FreeBlock->Offset = (u32)CeilDiv(((umm)Index * Memory->GPUBlockSize), (umm)Memory->Stride);
-                    Memory->MaxCount += Memory->GPUBlockSize / Memory->Stride;
-
-                    Result = true;
+                    u32 Index = Allocator->AllocationCount;
+                    if (AddGeometryAllocatorBlock(Allocator, BlockPool))
+                    {
+                        Memory->MemoryBlocks[Index] = DeviceMemory;
+                        Memory->MemoryAddresses[Index] = GetBufferDeviceAddress(VK.Device, Buffer);
+                        Memory->Buffers[Index] = Buffer;
+
+                        DeviceMemory = VK_NULL_HANDLE;
+                        Buffer = VK_NULL_HANDLE;
+                        Result = true;
+                    }
                 }
 
                 vkFreeMemory(VK.Device, DeviceMemory, nullptr);
@@ -169,68 +144,23 @@ internal bool AllocateGPUBlocks(geometry_memory* Memory, geometry_buffer_block*&
     return Result;
 }
 
-internal geometry_buffer_block* FindCandidateBlock(geometry_memory* Memory, u32 Count)
-{
-    geometry_buffer_block* Result = nullptr;
-
-    for (geometry_buffer_block* Candidate = Memory->FreeBlocks.Next;
-         Candidate != &Memory->FreeBlocks;
-         Candidate = Candidate->Next)
-    {
-        if (Count <= Candidate->Count)
-        {
-            Result = Candidate;
-            break;
-        }
-    }
-    return Result;
-}
-
 internal geometry_buffer_block* AllocateSubBuffer(geometry_memory* Memory, u32 Count, geometry_buffer_block*& BlockPool)
 {
     geometry_buffer_block* Result = nullptr;
 
-    while (Memory->MaxCount - Memory->CountInUse < Count)
+    geometry_buffer_block* FreeBlock = FindFreeBlock(&Memory->Allocator, Count);
+    while (!FreeBlock)
     {
         if (!AllocateGPUBlocks(Memory, BlockPool))
         {
             UnhandledError("Out of geometry memory");
             return Result;
         }
+        FreeBlock = FindFreeBlock(&Memory->Allocator, Count);
     }
 
-    geometry_buffer_block* FreeBlock = FindCandidateBlock(Memory, Count);
-    if (FreeBlock)
-    {
-        DList_Remove(FreeBlock, Next, Prev);
-
-        if (FreeBlock->Count > Count)
-        {
-            geometry_buffer_block* NextFreeBlock = BlockPool->Next; 
-            if (NextFreeBlock)
-            {
-                DList_Remove(NextFreeBlock, Next, Prev);
-                NextFreeBlock->Count = FreeBlock->Count - Count;
-                NextFreeBlock->Offset = FreeBlock->Offset + Count;
-                FreeBlock->Count = Count;
-                DList_InsertFront(&Memory->FreeBlocks, NextFreeBlock, Next, Prev);
-
-                Assert(((FreeBlock->Offset + FreeBlock->Count) <= NextFreeBlock->Offset) || 
-                       ((NextFreeBlock->Offset + NextFreeBlock->Count) <= FreeBlock->Offset));
-            }
-            else
-            {
-                UnhandledError("Out of geometry buffer block pool");
-            }
-        }
-
-        DList_InsertFront(&Memory->UsedBlocks, FreeBlock, Next, Prev);
-        Memory->CountInUse += FreeBlock->Count;
-        Memory->BlocksInUse++;
-
-        Result = FreeBlock;
-    }
-    else
+    Result = AllocateFromFreeBlock(&Memory->Allocator, FreeBlock, Count, BlockPool);
+    if (!Result)
     {
         UnhandledError("Failed to allocate vertex buffer block");
     }
@@ -242,58 +172,101 @@ internal geometry_buffer_allocation AllocateVertexBuffer(geometry_buffer* GB, u3
 {
     geometry_buffer_allocation Result = {};
 
+    // NOTE(boti): Either count may be 0, so that index data can be shared between vertex-only allocations
     if (VertexCount)
     {
         Result.VertexBlock = AllocateSubBuffer(&GB->VertexMemory, VertexCount, GB->BlockPool); 
+    }
 
-        if (IndexCount)
-        {
-            Result.IndexBlock = AllocateSubBuffer(&GB->IndexMemory, IndexCount, GB->BlockPool);
-        }
+    if (IndexCount)
+    {
+        Result.IndexBlock = AllocateSubBuffer(&GB->IndexMemory, IndexCount, GB->BlockPool);
     }
 
     return Result;
 }
 
-internal void DeallocateVertexBuffer(geometry_buffer* GB, geometry_buffer_allocation Allocation)
+internal void DeallocateVertexBuffer(geometry_buffer* GB, geometry_buffer_allocation Allocation, u32 FrameID)
 {
+    Assert(FrameID < R_MaxFramesInFlight);
     if (Allocation.VertexBlock)
     {
-        DList_Remove(Allocation.VertexBlock, Next, Prev);
-        DList_InsertFront(&GB->VertexMemory.FreeBlocks, Allocation.VertexBlock, Next, Prev);
-        GB->VertexMemory.CountInUse -= Allocation.VertexBlock->Count;
-        GB->VertexMemory.BlocksInUse--;
+        PushPendingFree(&GB->VertexMemory.Allocator, Allocation.VertexBlock, FrameID);
     }
 
     if (Allocation.IndexBlock)
     {
-        DList_Remove(Allocation.IndexBlock, Next, Prev);
-        DList_InsertFront(&GB->IndexMemory.FreeBlocks, Allocation.IndexBlock, Next, Prev);
-        GB->IndexMemory.CountInUse -= Allocation.IndexBlock->Count;
-        GB->IndexMemory.BlocksInUse--;
+        PushPendingFree(&GB->IndexMemory.Allocator, Allocation.IndexBlock, FrameID);
     }
 }
 
-internal b32 VerifyMemoryIntegrity(geometry_memory* Memory)
+internal void ReleasePendingGeometry(geometry_buffer* GB, u32 FrameID)
 {
-    b32 Result = true;
+    ReleasePendingBlocks(&GB->VertexMemory.Allocator, FrameID, GB->BlockPool);
+    ReleasePendingBlocks(&GB->IndexMemory.Allocator, FrameID, GB->BlockPool);
+}
 
-    for (geometry_buffer_block* Block = Memory->UsedBlocks.Next; Block != &Memory->UsedBlocks; Block = Block->Next)
+internal b32 DefragmentGeometryMemory(geometry_memory* Memory, geometry_buffer* GB, u32 FrameID, VkCommandBuffer CmdBuffer)
+{
+    geometry_move Moves[geometry_allocator::DefragMaxVisitCount];
+    u32 MoveCount = DefragmentGeometryAllocator(&Memory->Allocator, GB->DefragGeneration, FrameID, GB->BlockPool, Moves);
+
+    b32 Result = (MoveCount > 0);
+    if (Result)
     {
-        for (geometry_buffer_block* Comparand = Block->Next; Comparand != &Memory->UsedBlocks; Comparand = Comparand->Next)
+        // NOTE(boti): The uploads recorded earlier in the command buffer may have written the blocks being moved
+        VkMemoryBarrier2 Barrier = 
         {
-            b32 Check = ((Block->Offset + Block->Count) <= Comparand->Offset) || ((Comparand->Offset + Comparand->Count) <= Block->Offset);
-            Result &= Check;
-            Verify(Check);
-        }
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .pNext = nullptr,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+            .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT|VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        };
+        VkDependencyInfo Dependency = 
+        {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .pNext = nullptr,
+            .dependencyFlags = 0,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &Barrier,
+        };
+        vkCmdPipelineBarrier2(CmdBuffer, &Dependency);
     }
+
+    for (u32 MoveIndex = 0; MoveIndex < MoveCount; MoveIndex++)
+    {
+        geometry_move* Move = Moves + MoveIndex;
+        VkBufferCopy Copy = 
+        {
+            .srcOffset = Move->SrcByteOffset % geometry_allocator::GPUBlockSize,
+            .dstOffset = Move->DstByteOffset % geometry_allocator::GPUBlockSize,
+            .size = Move->ByteCount,
+        };
+        vkCmdCopyBuffer(CmdBuffer, 
+                        Memory->Buffers[Move->SrcByteOffset / geometry_allocator::GPUBlockSize], 
+                        Memory->Buffers[Move->DstByteOffset / geometry_allocator::GPUBlockSize], 
+                        1, &Copy);
+    }
+    return(Result);
+}
+
+internal b32 DefragmentGeometryBuffer(geometry_buffer* GB, u32 FrameID, VkCommandBuffer CmdBuffer)
+{
+    Assert(FrameID < R_MaxFramesInFlight);
+
+    GB->DefragGeneration++;
+    b32 Result = false;
+    Result |= DefragmentGeometryMemory(&GB->VertexMemory, GB, FrameID, CmdBuffer);
+    Result |= DefragmentGeometryMemory(&GB->IndexMemory, GB, FrameID, CmdBuffer);
     return(Result);
 }
 
 internal b32 VerifyGeometryIntegrity(geometry_buffer* GeometryBuffer)
 {
     b32 Result = true;
-    Result &= VerifyMemoryIntegrity(&GeometryBuffer->VertexMemory);
-    Result &= VerifyMemoryIntegrity(&GeometryBuffer->IndexMemory);
+    Result &= VerifyMemoryIntegrity(&GeometryBuffer->VertexMemory.Allocator);
+    Result &= VerifyMemoryIntegrity(&GeometryBuffer->IndexMemory.Allocator);
     return(Result);
 }
\ No newline at end of file
@@ -1,30 +1,22 @@
+// NOTE(boti): GPU side of the vertex/index memory, the allocations inside it are managed by geometry_allocator
+// (see GeometryAllocator.hpp). Each GPU allocation is a separate buffer of geometry_allocator::GPUBlockSize bytes.
 struct geometry_memory
 {
-    static constexpr u32 MaxGPUAllocationCount = 8;
-    static constexpr u64 GPUBlockSize = MiB(256);
+    geometry_allocator Allocator;
 
     u32 MemoryTypeIndex;
-    u32 AllocationCount;
-
-    u32 MaxCount;
-    u32 CountInUse;
-    u32 Stride;
-
-    u64 BlocksInUse;
-    geometry_buffer_block FreeBlocks;
-    geometry_buffer_block UsedBlocks;
-
     VkBufferCreateInfo BlockCreateInfo;
 
-    VkDeviceMemory MemoryBlocks[MaxGPUAllocationCount];
-    VkDeviceAddress MemoryAddresses[MaxGPUAllocationCount];
-    VkBuffer Buffers[MaxGPUAllocationCount];
+    VkDeviceMemory MemoryBlocks[geometry_allocator::MaxGPUAllocationCount];
+    VkDeviceAddress MemoryAddresses[geometry_allocator::MaxGPUAllocationCount];
+    VkBuffer Buffers[geometry_allocator::MaxGPUAllocationCount];
 };
 
 struct geometry_buffer
 {
     u64 MaxBlockCount;
-    geometry_buffer_block* BlockPool;
+    geometry_buffer_block* BlockPool; // NOTE(boti): Unused block descriptors, linked through Next
+    u32 DefragGeneration;
 
     geometry_memory VertexMemory;
     geometry_memory IndexMemory;
@@ -32,17 +24,25 @@ struct geometry_buffer
 
 internal bool CreateGeometryBuffer(u64 MaxBlockCount, memory_arena* Arena, geometry_buffer* Buffer);
 internal geometry_buffer_allocation AllocateVertexBuffer(geometry_buffer* GB, u32 VertexCount, u32 IndexCount);
-internal void DeallocateVertexBuffer(geometry_buffer* GB, geometry_buffer_allocation Allocation);
+// NOTE(boti): FrameID is the last frame that can reference the geometry
+internal void DeallocateVertexBuffer(geometry_buffer* GB, geometry_buffer_allocation Allocation, u32 FrameID);
+// NOTE(boti): Returns the blocks freed in the frame to the allocator, must be called once the frame has finished on the GPU
+internal void ReleasePendingGeometry(geometry_buffer* GB, u32 FrameID);
+// NOTE(boti): Records the copies of an incremental defragmentation pass into CmdBuffer,
+// returns true if anything was moved (in which case the blocks have MoveGeneration == GB->DefragGeneration).
+// Copies read the geometry written by earlier transfer commands, the copied geometry is only visible to later stages
+// after a barrier (COPY -> vertex/index reads).
+internal b32 DefragmentGeometryBuffer(geometry_buffer* GB, u32 FrameID, VkCommandBuffer CmdBuffer);
 inline VkDeviceAddress GetDeviceAddress(geometry_memory* Memory, umm ByteOffset);
 
 internal b32 VerifyGeometryIntegrity(geometry_buffer* GeometryBuffer);
 
 inline VkDeviceAddress GetDeviceAddress(geometry_memory* Memory, umm ByteOffset)
 {
-    u32 BlockIndex = (u32)(ByteOffset / Memory->GPUBlockSize);
-    u32 BlockOffset = (u32)(ByteOffset % Memory->GPUBlockSize);
+    u32 BlockIndex = (u32)(ByteOffset / geometry_allocator::GPUBlockSize);
+    u32 BlockOffset = (u32)(ByteOffset % geometry_allocator::GPUBlockSize);
 
-    Assert(BlockIndex < Memory->AllocationCount);
+    Assert(BlockIndex < Memory->Allocator.AllocationCount);
     VkDeviceAddress Result = Memory->MemoryAddresses[BlockIndex] + BlockOffset;
     return(Result);
-}
\ No newline at end of file
+}
@@ -0,0 +1,448 @@
+internal geometry_buffer_block* GetBlockDescriptor(geometry_buffer_block*& BlockPool)
+{
+    geometry_buffer_block* Result = BlockPool;
+    if (Result)
+    {
+        BlockPool = Result->Next;
+        *Result = {};
+    }
+    else
+    {
+        UnhandledError("Out of geometry buffer block pool");
+    }
+    return(Result);
+}
+
+internal void ReleaseBlockDescriptor(geometry_buffer_block*& BlockPool, geometry_buffer_block* Block)
+{
+    *Block = {};
+    Block->Next = BlockPool;
+    BlockPool = Block;
+}
+
+internal geometry_buffer_block* InitGeometryBlockPool(geometry_buffer_block* Blocks, u64 BlockCount)
+{
+    for (u64 i = 0; i < BlockCount; i++)
+    {
+        Blocks[i] = {};
+        Blocks[i].Next = (i < BlockCount - 1) ? Blocks + (i + 1) : nullptr;
+    }
+    geometry_buffer_block* Result = (BlockCount > 0) ? Blocks : nullptr;
+    return(Result);
+}
+
+internal u32 GetGPUBlockIndex(geometry_allocator* Allocator, u32 Offset)
+{
+    u32 Result = (u32)(((umm)Offset * Allocator->Stride) / Allocator->GPUBlockSize);
+    return(Result);
+}
+
+// NOTE(boti): First element that starts inside the GPU allocation
+// HACK(boti): We should just go back to using byte offsets/counts
+internal u32 GetGPUBlockFirstOffset(geometry_allocator* Allocator, u32 GPUBlockIndex)
+{
+    umm ByteOffset = (umm)GPUBlockIndex * Allocator->GPUBlockSize;
+    u32 Result = (u32)((ByteOffset + Allocator->Stride - 1) / Allocator->Stride);
+    return(Result);
+}
+
+// NOTE(boti): Number of elements that fit entirely inside the GPU allocation,
+// when the stride doesn't divide the block size this can differ by 1 between allocations
+internal u32 GetGPUBlockElementCount(geometry_allocator* Allocator, u32 GPUBlockIndex)
+{
+    umm EndByteOffset = (umm)(GPUBlockIndex + 1) * Allocator->GPUBlockSize;
+    u32 Result = (u32)(EndByteOffset / Allocator->Stride) - GetGPUBlockFirstOffset(Allocator, GPUBlockIndex);
+    return(Result);
+}
+
+// NOTE(boti): Rounds down, i.e. every block in the list is at least the size of the list's lower bound
+internal void GetGeometrySizeClass(u32 Count, u32* FL, u32* SL)
+{
+    Assert(Count > 0);
+    if (Count < geometry_allocator::SLCount)
+    {
+        *FL = 0;
+        *SL = Count;
+    }
+    else
+    {
+        u32 MSB;
+        BitScanReverse(&MSB, Count);
+        *FL = MSB - geometry_allocator::SLBitCount + 1;
+        *SL = (Count >> (MSB - geometry_allocator::SLBitCount)) - geometry_allocator::SLCount;
+    }
+}
+
+internal void InsertFreeBlock(geometry_allocator* Allocator, geometry_buffer_block* Block)
+{
+    u32 FL, SL;
+    GetGeometrySizeClass(Block->Count, &FL, &SL);
+
+    Block->State = GeometryBlock_Free;
+    Block->Prev = nullptr;
+    Block->Next = Allocator->FreeLists[FL][SL];
+    if (Block->Next)
+    {
+        Block->Next->Prev = Block;
+    }
+    Allocator->FreeLists[FL][SL] = Block;
+    Allocator->FLBitmap |= (1u << FL);
+    Allocator->SLBitmaps[FL] |= (1u << SL);
+}
+
+internal void RemoveFreeBlock(geometry_allocator* Allocator, geometry_buffer_block* Block)
+{
+    Assert(Block->State == GeometryBlock_Free);
+
+    u32 FL, SL;
+    GetGeometrySizeClass(Block->Count, &FL, &SL);
+
+    if (Block->Prev)
+    {
+        Block->Prev->Next = Block->Next;
+    }
+    else
+    {
+        Assert(Allocator->FreeLists[FL][SL] == Block);
+        Allocator->FreeLists[FL][SL] = Block->Next;
+        if (!Allocator->FreeLists[FL][SL])
+        {
+            Allocator->SLBitmaps[FL] &= ~(1u << SL);
+            if (!Allocator->SLBitmaps[FL])
+            {
+                Allocator->FLBitmap &= ~(1u << FL);
+            }
+        }
+    }
+
+    if (Block->Next)
+    {
+        Block->Next->Prev = Block->Prev;
+    }
+    Block->Next = Block->Prev = nullptr;
+}
+
+internal geometry_buffer_block* FindFreeBlock(geometry_allocator* Allocator, u32 Count)
+{
+    geometry_buffer_block* Result = nullptr;
+
+    // NOTE(boti): Round the size up to the next list boundary, so that any block in the list found is large enough
+    u32 SearchCount = Count;
+    if (Count >= geometry_allocator::SLCount)
+    {
+        u32 MSB;
+        BitScanReverse(&MSB, Count);
+        u64 RoundedCount = (u64)Count + (1u << (MSB - geometry_allocator::SLBitCount)) - 1;
+        SearchCount = (u32)Min(RoundedCount, (u64)U32_MAX);
+    }
+
+    u32 FL, SL;
+    GetGeometrySizeClass(SearchCount, &FL, &SL);
+
+    u32 SLMask = Allocator->SLBitmaps[FL] & (U32_MAX << SL);
+    if (!SLMask)
+    {
+        // NOTE(boti): Any block in a larger size class is large enough
+        u32 FLMask = Allocator->FLBitmap & (U32_MAX << (FL + 1));
+        if (BitScanForward(&FL, FLMask))
+        {
+            SLMask = Allocator->SLBitmaps[FL];
+        }
+    }
+
+    if (BitScanForward(&SL, SLMask))
+    {
+        Result = Allocator->FreeLists[FL][SL];
+        Assert(Result && (Result->Count >= Count));
+    }
+    return(Result);
+}
+
+internal b32 AddGeometryAllocatorBlock(geometry_allocator* Allocator, geometry_buffer_block*& BlockPool)
+{
+    b32 Result = false;
+    Assert(Allocator->AllocationCount < Allocator->MaxGPUAllocationCount);
+
+    geometry_buffer_block* FreeBlock = GetBlockDescriptor(BlockPool);
+    if (FreeBlock)
+    {
+        u32 Index = Allocator->AllocationCount++;
+        FreeBlock->Count = GetGPUBlockElementCount(Allocator, Index);
+        FreeBlock->Offset = GetGPUBlockFirstOffset(Allocator, Index);
+        Allocator->MaxCount += FreeBlock->Count;
+        Allocator->FirstBlocks[Index] = FreeBlock;
+        InsertFreeBlock(Allocator, FreeBlock);
+        Result = true;
+    }
+    return(Result);
+}
+
+internal geometry_buffer_block* AllocateFromFreeBlock(geometry_allocator* Allocator, geometry_buffer_block* FreeBlock, u32 Count,
+                                                      geometry_buffer_block*& BlockPool)
+{
+    geometry_buffer_block* Result = nullptr;
+
+    RemoveFreeBlock(Allocator, FreeBlock);
+    if (FreeBlock->Count > Count)
+    {
+        geometry_buffer_block* Remainder = GetBlockDescriptor(BlockPool);
+        if (Remainder)
+        {
+            Remainder->Count = FreeBlock->Count - Count;
+            Remainder->Offset = FreeBlock->Offset + Count;
+            Remainder->PrevPhysical = FreeBlock;
+            Remainder->NextPhysical = FreeBlock->NextPhysical;
+            if (Remainder->NextPhysical)
+            {
+                Remainder->NextPhysical->PrevPhysical = Remainder;
+            }
+            FreeBlock->NextPhysical = Remainder;
+            FreeBlock->Count = Count;
+            InsertFreeBlock(Allocator, Remainder);
+        }
+    }
+
+    if (FreeBlock->Count == Count)
+    {
+        FreeBlock->State = GeometryBlock_Allocated;
+        Allocator->CountInUse += FreeBlock->Count;
+        Allocator->BlocksInUse++;
+        Result = FreeBlock;
+    }
+    else
+    {
+        InsertFreeBlock(Allocator, FreeBlock);
+    }
+    return(Result);
+}
+
+// NOTE(boti): Merges the block with its free neighbors and puts it on the free lists
+internal void FreeSubBuffer(geometry_allocator* Allocator, geometry_buffer_block* Block, geometry_buffer_block*& BlockPool)
+{
+    geometry_buffer_block* Prev = Block->PrevPhysical;
+    if (Prev && (Prev->State == GeometryBlock_Free))
+    {
+        RemoveFreeBlock(Allocator, Prev);
+        Prev->Count += Block->Count;
+        Prev->NextPhysical = Block->NextPhysical;
+        if (Prev->NextPhysical)
+        {
+            Prev->NextPhysical->PrevPhysical = Prev;
+        }
+        if (Allocator->DefragCursor == Block)
+        {
+            Allocator->DefragCursor = Prev;
+        }
+        ReleaseBlockDescriptor(BlockPool, Block);
+        Block = Prev;
+    }
+
+    geometry_buffer_block* Next = Block->NextPhysical;
+    if (Next && (Next->State == GeometryBlock_Free))
+    {
+        RemoveFreeBlock(Allocator, Next);
+        Block->Count += Next->Count;
+        Block->NextPhysical = Next->NextPhysical;
+        if (Block->NextPhysical)
+        {
+            Block->NextPhysical->PrevPhysical = Block;
+        }
+        if (Allocator->DefragCursor == Next)
+        {
+            Allocator->DefragCursor = Block;
+        }
+        ReleaseBlockDescriptor(BlockPool, Next);
+    }
+
+    InsertFreeBlock(Allocator, Block);
+}
+
+internal void PushPendingFree(geometry_allocator* Allocator, geometry_buffer_block* Block, u32 FrameID)
+{
+    Assert(Block->State == GeometryBlock_Allocated);
+    Block->State = GeometryBlock_PendingFree;
+    Block->Next = Allocator->PendingFrees[FrameID];
+    Allocator->PendingFrees[FrameID] = Block;
+    Allocator->CountInUse -= Block->Count;
+    Allocator->BlocksInUse--;
+}
+
+internal void ReleasePendingBlocks(geometry_allocator* Allocator, u32 FrameID, geometry_buffer_block*& BlockPool)
+{
+    Assert(FrameID < R_MaxFramesInFlight);
+    geometry_buffer_block* Block = Allocator->PendingFrees[FrameID];
+    while (Block)
+    {
+        geometry_buffer_block* Next = Block->Next;
+        FreeSubBuffer(Allocator, Block, BlockPool);
+        Block = Next;
+    }
+    Allocator->PendingFrees[FrameID] = nullptr;
+}
+
+// NOTE(boti): Exchanges the places of two (equally sized) blocks in the physical chains
+internal void SwapPhysicalBlocks(geometry_allocator* Allocator, geometry_buffer_block* A, geometry_buffer_block* B)
+{
+    Assert(A->Count == B->Count);
+
+    geometry_buffer_block* APrev = (A->PrevPhysical == B) ? A : A->PrevPhysical;
+    geometry_buffer_block* ANext = (A->NextPhysical == B) ? A : A->NextPhysical;
+    geometry_buffer_block* BPrev = (B->PrevPhysical == A) ? B : B->PrevPhysical;
+    geometry_buffer_block* BNext = (B->NextPhysical == A) ? B : B->NextPhysical;
+
+    A->PrevPhysical = BPrev;
+    A->NextPhysical = BNext;
+    B->PrevPhysical = APrev;
+    B->NextPhysical = ANext;
+
+    u32 Offset = A->Offset;
+    A->Offset = B->Offset;
+    B->Offset = Offset;
+
+    geometry_buffer_block* Blocks[] = { A, B };
+    for (u32 Index = 0; Index < CountOf(Blocks); Index++)
+    {
+        geometry_buffer_block* Block = Blocks[Index];
+        if (Block->PrevPhysical)
+        {
+            Block->PrevPhysical->NextPhysical = Block;
+        }
+        else
+        {
+            Allocator->FirstBlocks[GetGPUBlockIndex(Allocator, Block->Offset)] = Block;
+        }
+
+        if (Block->NextPhysical)
+        {
+            Block->NextPhysical->PrevPhysical = Block;
+        }
+    }
+}
+
+internal u32 DefragmentGeometryAllocator(geometry_allocator* Allocator, u32 DefragGeneration, u32 FrameID,
+                                         geometry_buffer_block*& BlockPool, geometry_move* Moves)
+{
+    u32 Result = 0;
+    if (Allocator->AllocationCount == 0)
+    {
+        return(Result);
+    }
+
+    umm MovedByteCount = 0;
+    for (u32 VisitIndex = 0; 
+         (VisitIndex < Allocator->DefragMaxVisitCount) && (MovedByteCount < Allocator->DefragByteBudget);
+         VisitIndex++)
+    {
+        geometry_buffer_block* Block = Allocator->DefragCursor ? Allocator->DefragCursor : Allocator->FirstBlocks[0];
+
+        // NOTE(boti): Advance the cursor before anything gets moved, wrapping around to the first GPU allocation
+        geometry_buffer_block* NextCursor = Block->NextPhysical;
+        if (!NextCursor)
+        {
+            u32 GPUBlockIndex = GetGPUBlockIndex(Allocator, Block->Offset) + 1;
+            NextCursor = Allocator->FirstBlocks[(GPUBlockIndex < Allocator->AllocationCount) ? GPUBlockIndex : 0];
+        }
+        Allocator->DefragCursor = NextCursor;
+
+        // NOTE(boti): Only blocks next to a hole are worth moving, that's what merges the free space
+        b32 IsNextToHole = 
+            (Block->PrevPhysical && (Block->PrevPhysical->State == GeometryBlock_Free)) ||
+            (Block->NextPhysical && (Block->NextPhysical->State == GeometryBlock_Free));
+        if ((Block->State != GeometryBlock_Allocated) || !IsNextToHole)
+        {
+            continue;
+        }
+
+        // NOTE(boti): Blocks only ever move towards lower addresses, so the passes converge
+        geometry_buffer_block* FreeBlock = FindFreeBlock(Allocator, Block->Count);
+        if (!FreeBlock || (FreeBlock->Offset > Block->Offset))
+        {
+            continue;
+        }
+
+        geometry_buffer_block* Target = AllocateFromFreeBlock(Allocator, FreeBlock, Block->Count, BlockPool);
+        if (!Target)
+        {
+            break;
+        }
+
+        umm ByteCount = (umm)Block->Count * Allocator->Stride;
+        Moves[Result++] = 
+        {
+            .SrcByteOffset = (umm)Block->Offset * Allocator->Stride,
+            .DstByteOffset = (umm)Target->Offset * Allocator->Stride,
+            .ByteCount = ByteCount,
+        };
+        MovedByteCount += ByteCount;
+
+        // NOTE(boti): The allocation keeps its block, which now describes the new place,
+        // and the old place has to wait for the frames in flight before it can be reused
+        SwapPhysicalBlocks(Allocator, Block, Target);
+        Block->MoveGeneration = DefragGeneration;
+        PushPendingFree(Allocator, Target, FrameID);
+    }
+    return(Result);
+}
+
+internal b32 VerifyMemoryIntegrity(geometry_allocator* Allocator)
+{
+    b32 Result = true;
+
+    // NOTE(boti): The physical chains have to tile the GPU allocations without gaps,
+    // and there can't be 2 neighboring free blocks (they should've been merged)
+    u32 FreeBlockCount = 0;
+    for (u32 GPUBlockIndex = 0; GPUBlockIndex < Allocator->AllocationCount; GPUBlockIndex++)
+    {
+        geometry_buffer_block* First = Allocator->FirstBlocks[GPUBlockIndex];
+        u32 ExpectedOffset = GetGPUBlockFirstOffset(Allocator, GPUBlockIndex);
+        u32 TotalCount = 0;
+        for (geometry_buffer_block* Block = First; Block; Block = Block->NextPhysical)
+        {
+            b32 Check = (Block->Offset == ExpectedOffset) && (Block->State != GeometryBlock_Unused) && (Block->Count > 0);
+            if (Block->NextPhysical)
+            {
+                Check &= (Block->NextPhysical->PrevPhysical == Block);
+                Check &= !((Block->State == GeometryBlock_Free) && (Block->NextPhysical->State == GeometryBlock_Free));
+            }
+            Result &= Check;
+            Verify(Check);
+
+            FreeBlockCount += (Block->State == GeometryBlock_Free);
+            ExpectedOffset += Block->Count;
+            TotalCount += Block->Count;
+        }
+
+        b32 Check = (First->PrevPhysical == nullptr) && (TotalCount == GetGPUBlockElementCount(Allocator, GPUBlockIndex));
+        Result &= Check;
+        Verify(Check);
+    }
+
+    // NOTE(boti): Every free block has to be on the list of its size class
+    u32 ListedBlockCount = 0;
+    for (u32 FL = 0; FL < Allocator->FLCount; FL++)
+    {
+        for (u32 SL = 0; SL < Allocator->SLCount; SL++)
+        {
+            b32 IsListEmpty = (Allocator->FreeLists[FL][SL] == nullptr);
+            b32 Check = (IsListEmpty == !(Allocator->SLBitmaps[FL] & (1u << SL)));
+            for (geometry_buffer_block* Block = Allocator->FreeLists[FL][SL]; Block; Block = Block->Next)
+            {
+                u32 BlockFL, BlockSL;
+                GetGeometrySizeClass(Block->Count, &BlockFL, &BlockSL);
+                Check &= (Block->State == GeometryBlock_Free) && (BlockFL == FL) && (BlockSL == SL);
+                ListedBlockCount++;
+            }
+            Result &= Check;
+            Verify(Check);
+        }
+
+        b32 Check = (!Allocator->SLBitmaps[FL] == !(Allocator->FLBitmap & (1u << FL)));
+        Result &= Check;
+        Verify(Check);
+    }
+
+    b32 Check = (ListedBlockCount == FreeBlockCount);
+    Result &= Check;
+    Verify(Check);
+    return(Result);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// NOTE(boti): Vertex/index memory is managed by a two-level segregated fit (TLSF) allocator.
+//
+// Free blocks are bucketed by size: the first level is the power of 2 size class,
+// the second level splits each class into SLCount linear ranges, and a bitmap on each level tracks the non-empty lists,
+// so that both allocation and freeing are O(1). Freed blocks are merged with their free neighbors immediately.
+//
+// Freed blocks aren't reused until the frames in flight that could still reference them have finished (see PendingFrees).
+// Defragmentation moves a few allocated blocks per frame from next to holes into free space at lower addresses,
+// the block descriptors stay the same, so only the cached references (retained instances) need to be patched.
+//
+// This is only the bookkeeping, offsets and counts are in elements (Stride bytes each),
+// the GPU allocations backing it live in geometry_memory (see Geometry.hpp).
+struct geometry_allocator
+{
+    static constexpr u32 MaxGPUAllocationCount = 8;
+    static constexpr u64 GPUBlockSize = MiB(256);
+
+    static constexpr u32 SLBitCount = 4;
+    static constexpr u32 SLCount = 1u << SLBitCount;
+    static constexpr u32 FLCount = 32 - SLBitCount + 1;
+
+    static constexpr umm DefragByteBudget = MiB(4); // NOTE(boti): Per frame
+    static constexpr u32 DefragMaxVisitCount = 256; // NOTE(boti): Blocks looked at per frame
+
+    u32 AllocationCount;
+
+    u32 MaxCount;
+    u32 CountInUse;
+    u32 Stride;
+
+    u64 BlocksInUse;
+
+    u32 FLBitmap;
+    u32 SLBitmaps[FLCount];
+    geometry_buffer_block* FreeLists[FLCount][SLCount];
+
+    // NOTE(boti): Start of the physical block chain of each GPU allocation
+    geometry_buffer_block* FirstBlocks[MaxGPUAllocationCount];
+    // NOTE(boti): Blocks that become free once the frame with the same ID has finished on the GPU
+    geometry_buffer_block* PendingFrees[R_MaxFramesInFlight];
+    // NOTE(boti): Where the next defragmentation pass continues from
+    geometry_buffer_block* DefragCursor;
+};
+
+// NOTE(boti): A relocation done by the defragmentation, the data has to be copied on the GPU
+struct geometry_move
+{
+    umm SrcByteOffset;
+    umm DstByteOffset;
+    umm ByteCount;
+};
+
+// NOTE(boti): Links the descriptors into a pool, returns the head of the pool
+internal geometry_buffer_block* InitGeometryBlockPool(geometry_buffer_block* Blocks, u64 BlockCount);
+
+// NOTE(boti): Adds the free space of a new GPU allocation (the next one after the existing ones)
+internal b32 AddGeometryAllocatorBlock(geometry_allocator* Allocator, geometry_buffer_block*& BlockPool);
+// NOTE(boti): Returns a free block that's at least Count large (without removing it from its list)
+internal geometry_buffer_block* FindFreeBlock(geometry_allocator* Allocator, u32 Count);
+// NOTE(boti): Takes Count elements from the front of the free block, the rest stays free
+internal geometry_buffer_block* AllocateFromFreeBlock(geometry_allocator* Allocator, geometry_buffer_block* FreeBlock, u32 Count,
+                                                      geometry_buffer_block*& BlockPool);
+// NOTE(boti): The block becomes free once ReleasePendingBlocks() gets called with the same FrameID
+internal void PushPendingFree(geometry_allocator* Allocator, geometry_buffer_block* Block, u32 FrameID);
+internal void ReleasePendingBlocks(geometry_allocator* Allocator, u32 FrameID, geometry_buffer_block*& BlockPool);
+// NOTE(boti): Incremental defragmentation pass, the moved blocks get MoveGeneration = DefragGeneration,
+// and the places they were moved from are freed with FrameID.
+// Moves needs room for DefragMaxVisitCount entries, returns the number of moves.
+internal u32 DefragmentGeometryAllocator(geometry_allocator* Allocator, u32 DefragGeneration, u32 FrameID,
+                                         geometry_buffer_block*& BlockPool, geometry_move* Moves);
+
+internal b32 VerifyMemoryIntegrity(geometry_allocator* Allocator);
@@ -118,10 +118,9 @@ const descriptor_set_layout_info SetLayoutInfos[Set_Count] =
             [Binding_Static_PointShadows] =
             {
                 .Binding = Binding_Static_PointShadows,
-                .Type = Descriptor_ImageSampler,
-                .DescriptorCount = R_MaxShadowCount,
+                .Type = Descriptor_SampledImage,
+                .DescriptorCount = 1,
                 .Stages = ShaderStage_All,
-                .Flags = DescriptorFlag_PartiallyBound,
             },
 
             // Mip feedback
@@ -4,6 +4,7 @@
 #include <LadybugLib/Intrinsics.hpp>
 #include <LadybugLib/String.hpp>
 #include <LadybugLib/image.hpp>
+#include <LadybugLib/Sort.hpp>
 
 // HACK(boti): These are part of the high-level rendering API,
 // but we need them in ShaderInterop so they're defined here at the top for now
@@ -40,12 +41,24 @@ constexpr u32 R_MaxFramesInFlight = 2u;
 
 constexpr u64 R_RenderTargetMemorySize      = MiB(512);
 constexpr u64 R_TextureMemorySize           = MiB(512);
-constexpr u64 R_ShadowMapMemorySize         = MiB(256);
+// NOTE(boti): Streamed texture mips get evicted (least recently used first) when they use more memory than this
+constexpr u64 R_TextureResidencyBudget      = MiB(448);
+// NOTE(boti): Cascades (sampled + 2 static layers each) and the sampled + static point shadow atlases (~118MiB)
+constexpr u64 R_ShadowMapMemorySize         = MiB(160);
 constexpr u32 R_MaxShadowCascadeCount       = 4;
 constexpr u32 R_ShadowResolution            = 1536; //2048u; // TODO(boti): Rename, this only applies to the cascades
-constexpr u32 R_PointShadowResolution       = 256u;
+// NOTE(boti): Point shadow faces get a tile in the atlas sized by their projected size (see ShadowAtlas.hpp)
+constexpr u32 R_PointShadowAtlasResolution  = 4096u;
+constexpr u32 R_PointShadowMinResolution    = 64u;
+constexpr u32 R_PointShadowMaxResolution    = 1024u;
+// NOTE(boti): Frames a face has to be requested at a much smaller size before its tile gets shrunk
+constexpr u32 R_PointShadowShrinkDelay      = 60u;
 constexpr u64 R_VertexBufferMaxBlockCount   = (1llu << 18);
 constexpr u32 R_MaxJointCount               = 256u;
+constexpr u32 R_MaxRetainedInstanceCount    = (1u << 16);
+// NOTE(boti): Streamed uploads (texture mips, terrain chunks) are throttled to this many staging bytes per frame (see CanUpload()),
+// the uploads done at load time aren't
+constexpr umm R_MaxUploadBytesPerFrame      = MiB(32);
 
 constexpr f32 R_MaxLOD = 1000.0f;
 
@@ -66,10 +79,14 @@ union frustum
 };
 
 inline frustum GetClipSpaceFrustum();
+// NOTE(boti): World-space frustum of an infinite reverse-Z perspective camera (the far plane is degenerate)
+inline frustum GetCameraFrustum(m4 ViewTransform, f32 FocalLength, f32 AspectRatio, f32 NearZ);
 
 inline b32 IntersectFrustumBox(const frustum* Frustum, mmbox Box);
 inline b32 IntersectFrustumBox(const frustum* Frustum, mmbox Box, m4 Transform);
 inline b32 IntersectFrustumSphere(const frustum* Frustum, v3 P, f32 r);
+// NOTE(boti): Conservative, only rejects the hull if all of its points are outside a single plane
+inline b32 IntersectFrustumConvexHull(const frustum* Frustum, u32 PointCount, const v3* Points);
 
 //
 // Render API
@@ -77,6 +94,14 @@ inline b32 IntersectFrustumSphere(const frustum* Frustum, v3 P, f32 r);
 
 inline bool IsValid(renderer_texture_id ID) { return ID.Value != 0; }
 
+// NOTE(boti): Handle to an instance that's persistent on the renderer side (see AllocateInstance)
+struct renderer_instance_id
+{
+    u32 Value;
+};
+
+inline bool IsValid(renderer_instance_id ID) { return ID.Value != 0; }
+
 inline f32 GetLuminance(v3 RGB);
 inline v3 SetLuminance(v3 RGB, f32 Luminance);
 
@@ -92,6 +117,7 @@ struct texture_request
 {
     renderer_texture_id TextureID;
     u32 MipMask;
+    u32 Priority; // NOTE(boti): Higher is more important
 };
 
 // Shading mode for the primary opaque pass
@@ -130,13 +156,28 @@ struct render_config
     static constexpr f32 DefaultBloomStrength = 0.04f;
 };
 
+enum geometry_block_state : u32
+{
+    GeometryBlock_Unused = 0,   // NOTE(boti): Descriptor is in the pool
+    GeometryBlock_Free,
+    GeometryBlock_Allocated,
+    GeometryBlock_PendingFree,  // NOTE(boti): Freed (or moved out of), but the frames in flight can still reference it
+};
+
+// NOTE(boti): Allocations keep pointing to the same block even if defragmentation moves the geometry,
+// so Count/Offset should be read when the geometry is used and not cached.
 struct geometry_buffer_block
 {
     u32 Count;
     u32 Offset;
 
-    geometry_buffer_block* Next;
+    geometry_block_state State;
+    u32 MoveGeneration; // NOTE(boti): geometry_buffer::DefragGeneration of the last relocation
+
+    geometry_buffer_block* Next; // NOTE(boti): Free/pending list or descriptor pool link
     geometry_buffer_block* Prev;
+    geometry_buffer_block* PrevPhysical; // NOTE(boti): Neighboring blocks inside the same GPU allocation
+    geometry_buffer_block* NextPhysical;
 };
 
 struct geometry_buffer_allocation
@@ -171,12 +212,16 @@ struct render_particle
 struct particle_batch
 {
     u32 Count;
+    u32 MaxCount;
     billboard_mode Mode;
+    umm BARBufferAt; // NOTE(boti): render_particle[MaxCount]
 };
 
 struct draw_batch_2d
 {
     u32 VertexCount;
+    umm BARBufferAt; // NOTE(boti): vertex_2d[], BARBufferSize bytes
+    umm BARBufferSize;
 };
 
 typedef flags32 draw_flags;
@@ -195,6 +240,17 @@ struct draw_command
     renderer_material Material;
     m4 Transform;
     geometry_buffer_allocation Geometry;
+    umm PoseBARBufferAt; // NOTE(boti): Only valid for Draw_Skinned, the command doesn't own the pose
+};
+
+struct update_instance_cmd
+{
+    renderer_instance_id ID;
+    draw_group Group;
+    mmbox BoundingBox;
+    renderer_material Material;
+    m4 Transform;
+    geometry_buffer_allocation Geometry;
 };
 
 struct draw_widget3d_cmd
@@ -234,37 +290,11 @@ struct transfer_op
     };
 };
 
-enum render_command_type : u32
+struct transfer_command
 {
-    RenderCommand_NOP = 0,
-
-    RenderCommand_Transfer,
-    RenderCommand_Light,
-    RenderCommand_Draw,
-    RenderCommand_ParticleBatch,
-    RenderCommand_Widget3D,
-    RenderCommand_Batch2D,
-
-    RenderCommand_Count,
-};
-
-struct render_command
-{
-    render_command_type Type;
-    umm BARBufferAt;
-    umm BARBufferSize;
+    transfer_op Op;
     umm StagingBufferAt;
     umm StagingBufferSize;
-
-    union
-    {
-        transfer_op         Transfer;
-        light               Light;
-        draw_command        Draw;
-        particle_batch      ParticleBatch;
-        draw_widget3d_cmd   Widget3D;
-        draw_batch_2d       Batch2D;
-    };
 };
 
 struct staging_buffer
@@ -294,6 +324,11 @@ struct render_stats
 
     f32 FrameTime;
 
+    f32 TextureCacheFragmentation;
+    umm TextureCacheFreeRangeCount;
+
+    umm UploadByteCount;
+
     static constexpr u32 MaxMemoryEntryCount = 1024u;
     u32 MemoryEntryCount;
     render_stat_mem_entry MemoryEntries[MaxMemoryEntryCount];
@@ -376,16 +411,42 @@ struct render_frame
     void* BARBufferBase;
 
     staging_buffer StagingBuffer;
-
-    // Limits
-    static constexpr u32 MaxCommandCount    = (1u << 17);
-
-    u32             CommandCount;
-    render_command* Commands;
-    render_command* LastBatch2D;
+    umm UploadByteCount; // NOTE(boti): Staging bytes used by TransferTexture/TransferGeometry in this frame
+
+    // Command streams
+    // NOTE(boti): Each command type has its own tightly packed array, 
+    // the backend processes the streams one at a time (in submission order within a stream).
+    // Instance frees are processed after the updates, which is fine because IDs only get recycled by the backend.
+    static constexpr u32 MaxTransferCount       = (1u << 14);
+    static constexpr u32 MaxDrawCount           = (1u << 17);
+    static constexpr u32 MaxInstanceUpdateCount = (1u << 16);
+    static constexpr u32 MaxInstanceFreeCount   = (1u << 16);
+    static constexpr u32 MaxGeometryFreeCount   = (1u << 10);
+    static constexpr u32 MaxLightCount          = R_MaxLightCount;
+    static constexpr u32 MaxParticleBatchCount  = (1u << 12);
+    static constexpr u32 MaxWidget3DCount       = (1u << 12);
+    static constexpr u32 MaxBatch2DCount        = (1u << 10);
+
+    u32                     TransferCount;
+    transfer_command*       Transfers;
+    u32                     DrawCount;
+    draw_command*           Draws;
+    u32                     InstanceUpdateCount;
+    update_instance_cmd*    InstanceUpdates;
+    u32                     InstanceFreeCount;
+    renderer_instance_id*   InstanceFrees;
+    u32                     GeometryFreeCount;
+    geometry_buffer_allocation* GeometryFrees;
+    u32                     LightCount;
+    light*                  Lights;
+    u32                     ParticleBatchCount;
+    particle_batch*         ParticleBatches;
+    u32                     Widget3DCount;
+    draw_widget3d_cmd*      Widget3Ds;
+    u32                     Batch2DCount;
+    draw_batch_2d*          Batch2Ds;
 
     u32             DrawGroupDrawCounts[DrawGroup_Count];
-    u32             LightCount;
     u32             ShadowCount;
 
     // TODO(boti): Remove these from the API (should be backend only)
@@ -401,12 +462,18 @@ struct thread_context;
  * Such a name can't be used as a placeholder until it has been uploaded with some data (after a frame boundary).
  */ 
 #define Signature_AllocateTexture(name)     renderer_texture_id         name(renderer* Renderer, texture_flags Flags, const texture_info* Info, renderer_texture_id Placeholder)
+/* NOTE(boti): Retained instances live on the renderer side across frames,
+ * the game only needs to call UpdateInstance when something about the instance changes.
+ * Returns an invalid ID when the retained scene is full.
+ */
+#define Signature_AllocateInstance(name)    renderer_instance_id        name(renderer* Renderer)
 #define Signature_BeginRenderFrame(name)    render_frame*               name(renderer* Renderer, thread_context* ThreadContext, memory_arena* Arena, v2u RenderExtent)
 #define Signature_EndRenderFrame(name)      void                        name(render_frame* Frame, thread_context* ThreadContext)
 
 typedef Signature_CreateRenderer(create_renderer);
 typedef Signature_AllocateGeometry(allocate_geometry);
 typedef Signature_AllocateTexture(allocate_texture);
+typedef Signature_AllocateInstance(allocate_instance);
 typedef Signature_BeginRenderFrame(begin_render_frame);
 typedef Signature_EndRenderFrame(end_render_frame);
 
@@ -423,6 +490,14 @@ TransferTexture(render_frame* Frame, renderer_texture_id ID,
 inline b32 TransferGeometry(render_frame* Frame, geometry_buffer_allocation Allocation,
                             const void* VertexData, const void* IndexData);
 
+// NOTE(boti): Upload bytes left in the frame before going over R_MaxUploadBytesPerFrame (or running out of staging memory)
+inline umm GetUploadBudget(render_frame* Frame);
+// NOTE(boti): Whether a streamed upload of ByteCount bytes should go through in this frame, 
+// callers are expected to keep the data around and try again in a later frame when it doesn't.
+// The first upload of the frame is always allowed (as long as it fits into the staging buffer),
+// otherwise uploads larger than the budget would never go through.
+inline b32 CanUpload(render_frame* Frame, umm ByteCount);
+
 inline b32 
 DrawMesh(render_frame* Frame,
          draw_group Group,
@@ -432,6 +507,41 @@ DrawMesh(render_frame* Frame,
          renderer_material Material,
          u32 JointCount, m4* Pose);
 
+// NOTE(boti): Skinning transforms allocated directly in the BAR buffer of the frame.
+// They can be written from any thread (but only written, the memory is write-combined),
+// and any number of skinned draws within the frame can reference the same pose.
+struct renderer_pose
+{
+    umm BARBufferAt;
+    u32 JointCount;
+    m4* Transforms; // NOTE(boti): nullptr if the allocation failed
+};
+
+inline renderer_pose AllocatePose(render_frame* Frame, u32 JointCount);
+
+inline b32 
+DrawSkinnedMesh(render_frame* Frame,
+                draw_group Group,
+                geometry_buffer_allocation Allocation,
+                m4 Transform,
+                mmbox BoundingBox,
+                renderer_material Material,
+                renderer_pose Pose);
+
+inline b32 
+UpdateInstance(render_frame* Frame,
+               renderer_instance_id ID,
+               draw_group Group,
+               geometry_buffer_allocation Allocation,
+               m4 Transform,
+               mmbox BoundingBox,
+               renderer_material Material);
+inline b32 FreeInstance(render_frame* Frame, renderer_instance_id ID);
+
+// NOTE(boti): The allocation must not be referenced by any command of this frame,
+// the memory only gets reused once the frames in flight that might still read it are done
+inline b32 FreeGeometry(render_frame* Frame, geometry_buffer_allocation Allocation);
+
 inline b32
 DrawWidget3D(render_frame* Frame,
              geometry_buffer_allocation Allocation,
@@ -440,19 +550,19 @@ inline b32 AddLight(render_frame* Frame, v3 P, v3 E, light_flags Flags);
 
 inline b32 DrawTriangleList2D(render_frame* Frame, u32 VertexCount, vertex_2d* VertexArray);
 
-inline render_command*
+inline particle_batch*
 MakeParticleBatch(render_frame* Frame, u32 MaxParticleCount);
 
-inline render_command*
-PushParticle(render_frame* Frame, render_command* Batch, render_particle Particle);
+inline particle_batch*
+PushParticle(render_frame* Frame, particle_batch* Batch, render_particle Particle);
 
 //
 // Internal public interface
 //
-inline render_command*
-PushCommand_(render_frame* Frame, render_command_type Type, 
-             umm BARAlignment, umm BARUsage,
-             umm StagingAlignment, umm StagingUsage);
+
+// NOTE(boti): Returns false (without allocating anything) if there's not enough space left
+inline b32 PushBAR_(render_frame* Frame, umm Alignment, umm ByteCount, umm* At);
+inline b32 PushStaging_(render_frame* Frame, umm Alignment, umm ByteCount, umm* At);
 
 //
 // Helpers
@@ -598,31 +708,32 @@ inline texture_subresource_range SubresourceFromMipMask(u32 Mask, texture_info I
     return(Result);
 }
 
-inline render_command*
-PushCommand_(render_frame* Frame, render_command_type Type, 
-             umm BARAlignment, umm BARUsage,
-             umm StagingAlignment, umm StagingUsage)
+inline b32 PushBAR_(render_frame* Frame, umm Alignment, umm ByteCount, umm* At)
 {
-    render_command* Command = nullptr;
+    b32 Result = false;
 
-    umm AlignedBAR = BARAlignment ? Align(Frame->BARBufferAt, BARAlignment) : Frame->BARBufferAt;
-    umm AlignedStaging = StagingAlignment ? Align(Frame->StagingBuffer.At, StagingAlignment) : Frame->StagingBuffer.At;
-    if ((Frame->CommandCount < Frame->MaxCommandCount) && 
-        (AlignedBAR + BARUsage <= Frame->BARBufferSize) &&
-        (AlignedStaging + StagingUsage <= Frame->StagingBuffer.Size))
+    umm AlignedAt = Alignment ? Align(Frame->BARBufferAt, Alignment) : Frame->BARBufferAt;
+    if (AlignedAt + ByteCount <= Frame->BARBufferSize)
     {
-        Command = Frame->Commands + Frame->CommandCount++;
-        memset(Command, 0, sizeof(*Command));
-        Command->Type = Type;
+        Frame->BARBufferAt = AlignedAt + ByteCount;
+        *At = AlignedAt;
+        Result = true;
+    }
+    return(Result);
+}
 
-        Command->BARBufferAt        = AlignedBAR;
-        Command->BARBufferSize      = BARUsage;
-        Frame->BARBufferAt          = AlignedBAR + BARUsage;
-        Command->StagingBufferAt    = AlignedStaging;
-        Command->StagingBufferSize  = StagingUsage;
-        Frame->StagingBuffer.At     = AlignedStaging + StagingUsage;
+inline b32 PushStaging_(render_frame* Frame, umm Alignment, umm ByteCount, umm* At)
+{
+    b32 Result = false;
+
+    umm AlignedAt = Alignment ? Align(Frame->StagingBuffer.At, Alignment) : Frame->StagingBuffer.At;
+    if (AlignedAt + ByteCount <= Frame->StagingBuffer.Size)
+    {
+        Frame->StagingBuffer.At = AlignedAt + ByteCount;
+        *At = AlignedAt;
+        Result = true;
     }
-    return(Command);
+    return(Result);
 }
 
 inline b32 
@@ -634,14 +745,18 @@ TransferTexture(render_frame* Frame, renderer_texture_id ID,
 
     format_info ByteRate = FormatInfoTable[Info.Format];
     umm TotalSize = GetMipChainSize(Info.Extent.X, Info.Extent.Y, Info.MipCount, Info.ArrayCount, ByteRate);
-    render_command* Command = PushCommand_(Frame, RenderCommand_Transfer, 0, 0, 64, TotalSize);
-    if (Command)
+    umm StagingAt = 0;
+    if ((Frame->TransferCount < Frame->MaxTransferCount) && PushStaging_(Frame, 64, TotalSize, &StagingAt))
     {
-        Command->Transfer.Type = TransferOp_Texture;
-        Command->Transfer.Texture.TargetID = ID;
-        Command->Transfer.Texture.Info = Info;
-        Command->Transfer.Texture.SubresourceRange = Range;
-        memcpy(OffsetPtr(Frame->StagingBuffer.Base, Command->StagingBufferAt), Data, TotalSize);
+        transfer_command* Command = Frame->Transfers + Frame->TransferCount++;
+        Command->Op.Type = TransferOp_Texture;
+        Command->Op.Texture.TargetID = ID;
+        Command->Op.Texture.Info = Info;
+        Command->Op.Texture.SubresourceRange = Range;
+        Command->StagingBufferAt = StagingAt;
+        Command->StagingBufferSize = TotalSize;
+        memcpy(OffsetPtr(Frame->StagingBuffer.Base, StagingAt), Data, TotalSize);
+        Frame->UploadByteCount += TotalSize;
     }
     else
     {
@@ -657,16 +772,27 @@ inline b32 TransferGeometry(render_frame* Frame, geometry_buffer_allocation Allo
 {
     b32 Result = true;
 
-    umm VertexSize = (umm)Allocation.VertexBlock->Count * sizeof(vertex);
-    umm IndexSize = (umm)Allocation.IndexBlock->Count * sizeof(vert_index);
+    // NOTE(boti): Either part of the allocation may be missing (e.g. vertex-only allocations that share an index block)
+    umm VertexSize = Allocation.VertexBlock ? (umm)Allocation.VertexBlock->Count * sizeof(vertex) : 0;
+    umm IndexSize = Allocation.IndexBlock ? (umm)Allocation.IndexBlock->Count * sizeof(vert_index) : 0;
     umm TotalSize = VertexSize + IndexSize;
-    render_command* Command = PushCommand_(Frame, RenderCommand_Transfer, 0, 0, 16, TotalSize);
-    if (Command)
+    umm StagingAt = 0;
+    if ((Frame->TransferCount < Frame->MaxTransferCount) && PushStaging_(Frame, 16, TotalSize, &StagingAt))
     {
-        Command->Transfer.Type = TransferOp_Geometry;
-        Command->Transfer.Geometry.Dest = Allocation;
-        memcpy(OffsetPtr(Frame->StagingBuffer.Base, Command->StagingBufferAt), VertexData, VertexSize);
-        memcpy(OffsetPtr(Frame->StagingBuffer.Base, Command->StagingBufferAt + VertexSize), IndexData, IndexSize);
+        transfer_command* Command = Frame->Transfers + Frame->TransferCount++;
+        Command->Op.Type = TransferOp_Geometry;
+        Command->Op.Geometry.Dest = Allocation;
+        Command->StagingBufferAt = StagingAt;
+        Command->StagingBufferSize = TotalSize;
+        if (VertexSize)
+        {
+            memcpy(OffsetPtr(Frame->StagingBuffer.Base, StagingAt), VertexData, VertexSize);
+        }
+        if (IndexSize)
+        {
+            memcpy(OffsetPtr(Frame->StagingBuffer.Base, StagingAt + VertexSize), IndexData, IndexSize);
+        }
+        Frame->UploadByteCount += TotalSize;
     }
     else
     {
@@ -677,6 +803,36 @@ inline b32 TransferGeometry(render_frame* Frame, geometry_buffer_allocation Allo
     return(Result);
 }
 
+inline umm GetUploadBudget(render_frame* Frame)
+{
+    umm Result = 0;
+    if (Frame->UploadByteCount < R_MaxUploadBytesPerFrame)
+    {
+        Result = R_MaxUploadBytesPerFrame - Frame->UploadByteCount;
+    }
+
+    // NOTE(boti): Leave room for the worst case alignment of the upload
+    umm StagingAt = Align(Frame->StagingBuffer.At, 64);
+    umm StagingBytesLeft = (StagingAt < Frame->StagingBuffer.Size) ? Frame->StagingBuffer.Size - StagingAt : 0;
+    Result = Min(Result, StagingBytesLeft);
+    return(Result);
+}
+
+inline b32 CanUpload(render_frame* Frame, umm ByteCount)
+{
+    b32 Result = false;
+    if (ByteCount <= GetUploadBudget(Frame))
+    {
+        Result = true;
+    }
+    else if (Frame->UploadByteCount == 0)
+    {
+        umm StagingAt = Align(Frame->StagingBuffer.At, 64);
+        Result = (StagingAt + ByteCount <= Frame->StagingBuffer.Size);
+    }
+    return(Result);
+}
+
 inline b32 
 DrawMesh(render_frame* Frame,
          draw_group Group,
@@ -691,21 +847,24 @@ DrawMesh(render_frame* Frame,
     b32 IsSkinned = JointCount != 0;
     umm PoseByteCount = JointCount * sizeof(m4);
 
-    render_command* Command = PushCommand_(Frame, RenderCommand_Draw, IsSkinned ? sizeof(m4) : 0, PoseByteCount, 0, 0);
-    if (Command)
+    umm PoseAt = 0;
+    if ((Frame->DrawCount < Frame->MaxDrawCount) && (!IsSkinned || PushBAR_(Frame, sizeof(m4), PoseByteCount, &PoseAt)))
     {
-        Command->Draw.Group = Group;
+        draw_command* Command = Frame->Draws + Frame->DrawCount++;
+        Command->Group = Group;
+        Command->Flags = Draw_None;
         if (IsSkinned)
         {
-            Command->Draw.Flags |= Draw_Skinned;
-            memcpy(OffsetPtr(Frame->BARBufferBase, Command->BARBufferAt), Pose, PoseByteCount);
+            Command->Flags |= Draw_Skinned;
+            memcpy(OffsetPtr(Frame->BARBufferBase, PoseAt), Pose, PoseByteCount);
         }
-        Command->Draw.BoundingBox = BoundingBox;
-        Command->Draw.Material = Material;
-        Command->Draw.Transform = Transform;
-        Command->Draw.Geometry = Allocation;
+        Command->BoundingBox = BoundingBox;
+        Command->Material = Material;
+        Command->Transform = Transform;
+        Command->Geometry = Allocation;
+        Command->PoseBARBufferAt = PoseAt;
 
-        Frame->DrawGroupDrawCounts[Command->Draw.Group]++;
+        Frame->DrawGroupDrawCounts[Group]++;
     }
     else
     {
@@ -714,18 +873,69 @@ DrawMesh(render_frame* Frame,
     return(Result);
 }
 
+inline renderer_pose AllocatePose(render_frame* Frame, u32 JointCount)
+{
+    renderer_pose Result = {};
+
+    umm ByteCount = JointCount * sizeof(m4);
+    umm At = 0;
+    if (PushBAR_(Frame, sizeof(m4), ByteCount, &At))
+    {
+        Result.BARBufferAt = At;
+        Result.JointCount = JointCount;
+        Result.Transforms = (m4*)OffsetPtr(Frame->BARBufferBase, At);
+    }
+    return(Result);
+}
+
 inline b32 
-DrawWidget3D(render_frame* Frame,
-             geometry_buffer_allocation Allocation,
-             m4 Transform, rgba8 Color)
+DrawSkinnedMesh(render_frame* Frame,
+                draw_group Group,
+                geometry_buffer_allocation Allocation,
+                m4 Transform,
+                mmbox BoundingBox,
+                renderer_material Material,
+                renderer_pose Pose)
+{
+    b32 Result = false;
+
+    if (Pose.Transforms && (Frame->DrawCount < Frame->MaxDrawCount))
+    {
+        draw_command* Command = Frame->Draws + Frame->DrawCount++;
+        Command->Group = Group;
+        Command->Flags = Draw_Skinned;
+        Command->BoundingBox = BoundingBox;
+        Command->Material = Material;
+        Command->Transform = Transform;
+        Command->Geometry = Allocation;
+        Command->PoseBARBufferAt = Pose.BARBufferAt;
+
+        Frame->DrawGroupDrawCounts[Group]++;
+        Result = true;
+    }
+    return(Result);
+}
+
+inline b32 
+UpdateInstance(render_frame* Frame,
+               renderer_instance_id ID,
+               draw_group Group,
+               geometry_buffer_allocation Allocation,
+               m4 Transform,
+               mmbox BoundingBox,
+               renderer_material Material)
 {
     b32 Result = true;
-    render_command* Command = PushCommand_(Frame, RenderCommand_Widget3D, 0, 0, 0, 0);
-    if (Command)
+
+    if (Frame->InstanceUpdateCount < Frame->MaxInstanceUpdateCount)
     {
-        Command->Widget3D.Geometry = Allocation;
-        Command->Widget3D.Transform = Transform;
-        Command->Widget3D.Color = Color;
+        update_instance_cmd* Command = Frame->InstanceUpdates + Frame->InstanceUpdateCount++;
+        Command->ID = ID;
+        Command->Group = Group;
+        Command->BoundingBox = BoundingBox;
+        Command->Material = Material;
+        Command->Transform = Transform;
+        Command->Geometry = Allocation;
     }
     else
     {
@@ -734,19 +944,28 @@ DrawWidget3D(render_frame* Frame,
     return(Result);
 }
 
-inline b32 AddLight(render_frame* Frame, v3 P, v3 E, light_flags Flags)
+inline b32 FreeInstance(render_frame* Frame, renderer_instance_id ID)
 {
-    b32 Result = false;
+    b32 Result = true;
 
-    render_command* Command = PushCommand_(Frame, RenderCommand_Light, 0, 0, 0, 0);
-    if (Command)
+    if (Frame->InstanceFreeCount < Frame->MaxInstanceFreeCount)
     {
-        Command->Light.P = P;
-        Command->Light.ShadowIndex = (Flags & LightFlag_ShadowCaster) ? Frame->ShadowCount++ : 0xFFFFFFFFu;
-        Command->Light.E = E;
-        Command->Light.Flags = Flags;
+        Frame->InstanceFrees[Frame->InstanceFreeCount++] = ID;
+    }
+    else
+    {
+        Result = false;
+    }
+    return(Result);
+}
 
-        Frame->LightCount++;
+inline b32 FreeGeometry(render_frame* Frame, geometry_buffer_allocation Allocation)
+{
+    b32 Result = true;
+
+    if (Frame->GeometryFreeCount < Frame->MaxGeometryFreeCount)
+    {
+        Frame->GeometryFrees[Frame->GeometryFreeCount++] = Allocation;
     }
     else
     {
@@ -755,6 +974,42 @@ inline b32 AddLight(render_frame* Frame, v3 P, v3 E, light_flags Flags)
     return(Result);
 }
 
+inline b32 
+DrawWidget3D(render_frame* Frame,
+             geometry_buffer_allocation Allocation,
+             m4 Transform, rgba8 Color)
+{
+    b32 Result = true;
+    if (Frame->Widget3DCount < Frame->MaxWidget3DCount)
+    {
+        draw_widget3d_cmd* Command = Frame->Widget3Ds + Frame->Widget3DCount++;
+        Command->Geometry = Allocation;
+        Command->Transform = Transform;
+        Command->Color = Color;
+    }
+    else
+    {
+        Result = false;
+    }
+    return(Result);
+}
+
+inline b32 AddLight(render_frame* Frame, v3 P, v3 E, light_flags Flags)
+{
+    b32 Result = false;
+
+    if (Frame->LightCount < Frame->MaxLightCount)
+    {
+        light* Light = Frame->Lights + Frame->LightCount++;
+        Light->P = P;
+        Light->ShadowIndex = (Flags & LightFlag_ShadowCaster) ? Frame->ShadowCount++ : 0xFFFFFFFFu;
+        Light->E = E;
+        Light->Flags = Flags;
+        Result = true;
+    }
+    return(Result);
+}
+
 inline b32 DrawTriangleList2D(render_frame* Frame, u32 VertexCount, vertex_2d* VertexArray)
 {
     b32 Result = true;
@@ -763,89 +1018,106 @@ inline b32 DrawTriangleList2D(render_frame* Frame, u32 VertexCount, vertex_2d* V
 
     umm ByteCount = VertexCount * sizeof(vertex_2d);
 
-    render_command* Command = Frame->LastBatch2D;
-    if (Command)
+    draw_batch_2d* Batch = Frame->Batch2DCount ? Frame->Batch2Ds + (Frame->Batch2DCount - 1) : nullptr;
+    if (Batch)
     {
-        Assert(Command->Type == RenderCommand_Batch2D);
-
-        umm BytesUsed = Command->Batch2D.VertexCount * sizeof(vertex_2d);
-        if (BytesUsed + ByteCount > Command->BARBufferSize)
+        umm BytesUsed = Batch->VertexCount * sizeof(vertex_2d);
+        if (BytesUsed + ByteCount > Batch->BARBufferSize)
         {
             // NOTE(boti): Try stretching to the last batch
-            if (Frame->BARBufferAt == Command->BARBufferAt + Command->BARBufferSize)
+            if (Frame->BARBufferAt == Batch->BARBufferAt + Batch->BARBufferSize)
             {
                 umm NewBARSize = Align(ByteCount + BytesUsed, BatchBlockByteCount);
-                if (Command->BARBufferAt + NewBARSize <= Frame->BARBufferSize)
+                if (Batch->BARBufferAt + NewBARSize <= Frame->BARBufferSize)
                 {
-                    Command->BARBufferSize = NewBARSize;
-                    Frame->BARBufferAt = Command->BARBufferAt + NewBARSize;
+                    Batch->BARBufferSize = NewBARSize;
+                    Frame->BARBufferAt = Batch->BARBufferAt + NewBARSize;
                 }
                 else
                 {
-                    Command = nullptr;
+                    Batch = nullptr;
                 }
             }
             else
             {
-                Command = PushCommand_(Frame, RenderCommand_Batch2D, 16, Align(ByteCount, BatchBlockByteCount), 0, 0);
+                Batch = nullptr;
             }
         }
     }
-    else
+
+    if (!Batch)
     {
-        Command = PushCommand_(Frame, RenderCommand_Batch2D, 16, Align(ByteCount, BatchBlockByteCount), 0, 0);
+        umm BatchByteCount = Align(ByteCount, BatchBlockByteCount);
+        umm BatchAt = 0;
+        if ((Frame->Batch2DCount < Frame->MaxBatch2DCount) && PushBAR_(Frame, 16, BatchByteCount, &BatchAt))
+        {
+            Batch = Frame->Batch2Ds + Frame->Batch2DCount++;
+            Batch->VertexCount = 0;
+            Batch->BARBufferAt = BatchAt;
+            Batch->BARBufferSize = BatchByteCount;
+        }
     }
 
-    if (Command)
+    if (Batch)
     {
-        umm BytesUsed = Command->Batch2D.VertexCount * sizeof(vertex_2d);
-        memcpy(OffsetPtr(Frame->BARBufferBase, Command->BARBufferAt + BytesUsed), VertexArray, ByteCount);
-        Command->Batch2D.VertexCount += VertexCount;
+        umm BytesUsed = Batch->VertexCount * sizeof(vertex_2d);
+        memcpy(OffsetPtr(Frame->BARBufferBase, Batch->BARBufferAt + BytesUsed), VertexArray, ByteCount);
+        Batch->VertexCount += VertexCount;
 
-        Assert(Command->Batch2D.VertexCount * sizeof(vertex_2d) <= Command->BARBufferSize);
+        Assert(Batch->VertexCount * sizeof(vertex_2d) <= Batch->BARBufferSize);
     }
     else
     {
         Result = false;
     }
     
-    Frame->LastBatch2D = Command;
     return(Result);
 }
 
-inline render_command*
+inline particle_batch*
 MakeParticleBatch(render_frame* Frame, u32 MinParticleCount)
 {
+    particle_batch* Result = nullptr;
+
     constexpr umm MinBatchByteCount = KiB(16);
     umm ByteCount = Align(Max(MinBatchByteCount, MinParticleCount * sizeof(render_particle)), MinBatchByteCount);
 
-    render_command* Command = PushCommand_(Frame, RenderCommand_ParticleBatch, 16, ByteCount, 0, 0);
-    return(Command);
+    umm BatchAt = 0;
+    if ((Frame->ParticleBatchCount < Frame->MaxParticleBatchCount) && PushBAR_(Frame, 16, ByteCount, &BatchAt))
+    {
+        Result = Frame->ParticleBatches + Frame->ParticleBatchCount++;
+        Result->Count = 0;
+        Result->MaxCount = (u32)(ByteCount / sizeof(render_particle));
+        Result->Mode = Billboard_ViewAligned;
+        Result->BARBufferAt = BatchAt;
+    }
+    return(Result);
 }
 
-inline render_command*
-PushParticle(render_frame* Frame, render_command* Batch, render_particle Particle)
+inline particle_batch*
+PushParticle(render_frame* Frame, particle_batch* Batch, render_particle Particle)
 {
-    render_command* Command = Batch;
+    particle_batch* Result = Batch;
 
-    if (Command)
+    if (Result)
     {
-        Assert(Command->Type == RenderCommand_ParticleBatch);
-
-        if ((Command->ParticleBatch.Count + 1) * sizeof(render_particle) >= Command->BARBufferSize)
+        if (Result->Count >= Result->MaxCount)
         {
-            Command = MakeParticleBatch(Frame, 1);
+            Result = MakeParticleBatch(Frame, 1);
+            if (Result)
+            {
+                Result->Mode = Batch->Mode;
+            }
         }
 
-        if (Command)
+        if (Result)
         {
-            Command->ParticleBatch.Mode = Batch->ParticleBatch.Mode;
-            memcpy(OffsetPtr(Frame->BARBufferBase, Command->BARBufferAt + Command->ParticleBatch.Count * sizeof(Particle)), &Particle, sizeof(Particle));
-            Command->ParticleBatch.Count++;
+            memcpy(OffsetPtr(Frame->BARBufferBase, Result->BARBufferAt + Result->Count * sizeof(Particle)), &Particle, sizeof(Particle));
+            Result->Count++;
         }
     }
 
-    return(Command);
+    return(Result);
 }
 
 inline frustum GetClipSpaceFrustum()
@@ -862,6 +1134,30 @@ inline frustum GetClipSpaceFrustum()
     return(Result);
 }
 
+inline frustum GetCameraFrustum(m4 ViewTransform, f32 FocalLength, f32 AspectRatio, f32 NearZ)
+{
+    f32 n = NearZ;
+    f32 s = AspectRatio;
+    f32 g = FocalLength;
+
+    f32 g2 = g*g;
+    f32 mx = 1.0f / Sqrt(g2 + s*s);
+    f32 my = 1.0f / Sqrt(g2 + 1.0f);
+    f32 gmx = g*mx;
+    f32 gmy = g*my;
+    f32 smx = s*mx;
+    frustum Result = 
+    {
+        .Left   = v4{ -gmx, 0.0f, smx, 0.0f } * ViewTransform,
+        .Right  = v4{ +gmx, 0.0f, smx, 0.0f } * ViewTransform,
+        .Top    = v4{ 0.0f, -gmy,  my, 0.0f } * ViewTransform,
+        .Bottom = v4{ 0.0f, +gmy,  my, 0.0f } * ViewTransform,
+        .Near   = v4{ 0.0f, 0.0f, +1.0f, -n } * ViewTransform,
+        .Far    = v4{ 0.0f, 0.0f,  0.0f, 0.0f } * ViewTransform,
+    };
+    return(Result);
+}
+
 inline b32 IntersectFrustumBox(const frustum* Frustum, mmbox Box)
 {
     b32 Result = true;
@@ -927,6 +1223,32 @@ inline b32 IntersectFrustumSphere(const frustum* Frustum, v3 Center, f32 r)
     return(Result);
 }
 
+inline b32 IntersectFrustumConvexHull(const frustum* Frustum, u32 PointCount, const v3* Points)
+{
+    b32 Result = true;
+    for (u32 PlaneIndex = 0; PlaneIndex < 6; PlaneIndex++)
+    {
+        v4 Plane = Frustum->Planes[PlaneIndex];
+        b32 AllOutside = true;
+        for (u32 PointIndex = 0; PointIndex < PointCount; PointIndex++)
+        {
+            v3 P = Points[PointIndex];
+            if (Dot(Plane, v4{ P.X, P.Y, P.Z, 1.0f }) >= 0.0f)
+            {
+                AllOutside = false;
+                break;
+            }
+        }
+
+        if (AllOutside)
+        {
+            Result = false;
+            break;
+        }
+    }
+    return(Result);
+}
+
 inline b32 IntersectFrustumFrustum(const frustum* A, const frustum* B)
 {
     b32 Result = true;
@@ -0,0 +1,138 @@
+internal u32 GetShadowAtlasLevel(u32 Node)
+{
+    u32 Result = 0;
+    u32 LevelEnd = 1;
+    u32 LevelNodeCount = 1;
+    while (Node >= LevelEnd)
+    {
+        LevelNodeCount *= 4;
+        LevelEnd += LevelNodeCount;
+        Result++;
+    }
+    return(Result);
+}
+
+internal u32 AllocateShadowAtlasNode(shadow_atlas* Atlas, u32 Node, u32 Level, u32 TargetLevel)
+{
+    u32 Result = shadow_atlas::InvalidNode;
+    shadow_atlas_node_state State = Atlas->NodeStates[Node];
+    if (Level == TargetLevel)
+    {
+        if (State == AtlasNode_Free)
+        {
+            Atlas->NodeStates[Node] = AtlasNode_Allocated;
+            Result = Node;
+        }
+    }
+    else if (State == AtlasNode_Split)
+    {
+        // NOTE(boti): Already split children are tried first, so that the free quadrants stay whole for larger tiles
+        for (u32 Pass = 0; (Pass < 2) && (Result == shadow_atlas::InvalidNode); Pass++)
+        {
+            shadow_atlas_node_state PassState = (Pass == 0) ? AtlasNode_Split : AtlasNode_Free;
+            for (u32 Child = 4*Node + 1; Child <= 4*Node + 4; Child++)
+            {
+                if (Atlas->NodeStates[Child] == PassState)
+                {
+                    Result = AllocateShadowAtlasNode(Atlas, Child, Level + 1, TargetLevel);
+                    if (Result != shadow_atlas::InvalidNode)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    else if (State == AtlasNode_Free)
+    {
+        // NOTE(boti): The children of a free node are always free
+        Atlas->NodeStates[Node] = AtlasNode_Split;
+        Result = AllocateShadowAtlasNode(Atlas, 4*Node + 1, Level + 1, TargetLevel);
+    }
+    return(Result);
+}
+
+internal u32 AllocateShadowAtlasTile(shadow_atlas* Atlas, u32 Size)
+{
+    u32 Result = shadow_atlas::InvalidNode;
+
+    u32 TargetLevel = 0;
+    while ((TargetLevel < shadow_atlas::LevelCount) && ((shadow_atlas::Resolution >> TargetLevel) > Size))
+    {
+        TargetLevel++;
+    }
+
+    if ((TargetLevel > 0) && (TargetLevel < shadow_atlas::LevelCount) && ((shadow_atlas::Resolution >> TargetLevel) == Size))
+    {
+        Result = AllocateShadowAtlasNode(Atlas, 0, 0, TargetLevel);
+        if (Result != shadow_atlas::InvalidNode)
+        {
+            Atlas->AllocatedTexelCount += Size * Size;
+        }
+    }
+    else
+    {
+        InvalidCodePath;
+    }
+    return(Result);
+}
+
+internal void FreeShadowAtlasTile(shadow_atlas* Atlas, u32 Node)
+{
+    Assert((Node != shadow_atlas::InvalidNode) && (Node < shadow_atlas::NodeCount));
+    Assert(Atlas->NodeStates[Node] == AtlasNode_Allocated);
+
+    u32 Size = shadow_atlas::Resolution >> GetShadowAtlasLevel(Node);
+    Atlas->AllocatedTexelCount -= Size * Size;
+
+    Atlas->NodeStates[Node] = AtlasNode_Free;
+    while (Node != 0)
+    {
+        u32 Parent = (Node - 1) / 4;
+        b32 AreSiblingsFree = true;
+        for (u32 Child = 4*Parent + 1; Child <= 4*Parent + 4; Child++)
+        {
+            AreSiblingsFree &= (Atlas->NodeStates[Child] == AtlasNode_Free);
+        }
+
+        if (!AreSiblingsFree)
+        {
+            break;
+        }
+        Atlas->NodeStates[Parent] = AtlasNode_Free;
+        Node = Parent;
+    }
+}
+
+internal shadow_atlas_tile GetShadowAtlasTile(u32 Node)
+{
+    Assert(Node < shadow_atlas::NodeCount);
+
+    shadow_atlas_tile Result = {};
+    Result.Size = shadow_atlas::Resolution >> GetShadowAtlasLevel(Node);
+
+    u32 ChildSize = Result.Size;
+    while (Node != 0)
+    {
+        u32 Child = (Node - 1) % 4;
+        Result.X += (Child & 1) * ChildSize;
+        Result.Y += (Child >> 1) * ChildSize;
+        ChildSize *= 2;
+        Node = (Node - 1) / 4;
+    }
+    return(Result);
+}
+
+internal u32 GetPointShadowFaceSize(f32 ProjectedRadius)
+{
+    constexpr f32 TexelsPerPixel = 0.5f;
+
+    // NOTE(boti): A face covers a 90 degree FOV from the light, which roughly maps to the projected diameter
+    f32 DesiredSize = TexelsPerPixel * 2.0f * ProjectedRadius;
+    u32 Result = R_PointShadowMinResolution;
+    while ((Result < R_PointShadowMaxResolution) && ((f32)(2 * Result) <= DesiredSize))
+    {
+        Result *= 2;
+    }
+    return(Result);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// NOTE(boti): Quadtree allocator for the point shadow atlas.
+//
+// Tiles are power-of-2 squares between R_PointShadowMinResolution and R_PointShadowMaxResolution.
+// The nodes of the tree are stored implicitly (the children of node N are 4N+1..4N+4, in row-major order),
+// a node is either free, split into 4 children, or allocated as a whole.
+// Freed nodes get merged back into their parents once all 4 siblings are free.
+
+enum shadow_atlas_node_state : u8
+{
+    AtlasNode_Free = 0,
+    AtlasNode_Split,
+    AtlasNode_Allocated,
+};
+
+struct shadow_atlas
+{
+    static constexpr u32 Resolution = R_PointShadowAtlasResolution;
+    static constexpr u32 MinTileSize = R_PointShadowMinResolution;
+    static constexpr u32 LevelCount = 7;
+    static constexpr u32 NodeCount = ((1u << (2 * LevelCount)) - 1) / 3;
+    // NOTE(boti): The root is never handed out as a tile, so it can double as the invalid node
+    static constexpr u32 InvalidNode = 0;
+
+    static_assert((Resolution >> (LevelCount - 1)) == MinTileSize);
+    static_assert(R_PointShadowMaxResolution < Resolution);
+
+    u32 AllocatedTexelCount;
+    shadow_atlas_node_state NodeStates[NodeCount];
+};
+
+struct shadow_atlas_tile
+{
+    u32 X, Y;
+    u32 Size;
+};
+
+// NOTE(boti): Returns InvalidNode if there's no free tile of the requested size
+internal u32 AllocateShadowAtlasTile(shadow_atlas* Atlas, u32 Size);
+internal void FreeShadowAtlasTile(shadow_atlas* Atlas, u32 Node);
+internal shadow_atlas_tile GetShadowAtlasTile(u32 Node);
+
+// NOTE(boti): Face size for the given projected radius of the light (in pixels), 
+// ~1 shadow texel per 2 pixels, rounded down to a power of 2 and clamped to the allowed tile sizes
+internal u32 GetPointShadowFaceSize(f32 ProjectedRadius);
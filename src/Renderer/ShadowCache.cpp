@@ -0,0 +1,489 @@
+internal void BeginPointShadowCacheFrame(point_shadow_cache* Cache)
+{
+    Cache->FrameIndex++;
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        Cache->IsAcquired[Slot] = false;
+    }
+}
+
+internal u32 AcquirePointShadow(point_shadow_cache* Cache, v3 P, f32 Radius)
+{
+    constexpr f32 Epsilon = 1e-4f;
+
+    u32 Result = U32_MAX;
+    u32 LRUSlot = U32_MAX;
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        if (Cache->IsAcquired[Slot])
+        {
+            continue;
+        }
+
+        point_shadow_cache_entry* Entry = Cache->Entries + Slot;
+        v3 dP = Entry->P - P;
+        // NOTE(boti): Entries of the same light are reused even when their static part isn't valid,
+        // that just gets rebuilt in place (keeping the slot's tiles) instead of taking over another slot
+        if ((Dot(dP, dP) <= Epsilon*Epsilon) && (Abs(Entry->Radius - Radius) <= Epsilon))
+        {
+            Result = Slot;
+            break;
+        }
+
+        if ((LRUSlot == U32_MAX) || (Entry->LastUsedFrame < Cache->Entries[LRUSlot].LastUsedFrame))
+        {
+            LRUSlot = Slot;
+        }
+    }
+
+    if ((Result == U32_MAX) && (LRUSlot != U32_MAX))
+    {
+        Result = LRUSlot;
+
+        point_shadow_cache_entry* Entry = Cache->Entries + Result;
+        Entry->P = P;
+        Entry->Radius = Radius;
+        Entry->IsStaticValid = false;
+        for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+        {
+            Entry->ShrinkFrameCounts[Face] = 0;
+        }
+    }
+
+    if (Result != U32_MAX)
+    {
+        Cache->IsAcquired[Result] = true;
+        Cache->Entries[Result].LastUsedFrame = Cache->FrameIndex;
+    }
+    return(Result);
+}
+
+internal void FreePointShadowTiles(point_shadow_cache* Cache, point_shadow_cache_entry* Entry)
+{
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        if (Entry->AtlasNodes[Face] != shadow_atlas::InvalidNode)
+        {
+            FreeShadowAtlasTile(&Cache->Atlas, Entry->AtlasNodes[Face]);
+            Entry->AtlasNodes[Face] = shadow_atlas::InvalidNode;
+        }
+        Entry->ShrinkFrameCounts[Face] = 0;
+    }
+    Entry->IsStaticValid = false;
+}
+
+// NOTE(boti): Frees the tiles of the least recently used slot that isn't in use this frame, returns false if there was none
+internal b32 EvictPointShadowTiles(point_shadow_cache* Cache)
+{
+    u32 EvictedSlot = U32_MAX;
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        point_shadow_cache_entry* Entry = Cache->Entries + Slot;
+        b32 HasTiles = false;
+        for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+        {
+            HasTiles |= (Entry->AtlasNodes[Face] != shadow_atlas::InvalidNode);
+        }
+
+        if (!Cache->IsAcquired[Slot] && HasTiles &&
+            ((EvictedSlot == U32_MAX) || (Entry->LastUsedFrame < Cache->Entries[EvictedSlot].LastUsedFrame)))
+        {
+            EvictedSlot = Slot;
+        }
+    }
+
+    b32 Result = false;
+    if (EvictedSlot != U32_MAX)
+    {
+        FreePointShadowTiles(Cache, Cache->Entries + EvictedSlot);
+        Result = true;
+    }
+    return(Result);
+}
+
+internal b32 AllocatePointShadowTiles(point_shadow_cache* Cache, u32 Slot, const u32* FaceSizes)
+{
+    Assert((Slot < R_MaxShadowCount) && Cache->IsAcquired[Slot]);
+    point_shadow_cache_entry* Entry = Cache->Entries + Slot;
+    shadow_atlas* Atlas = &Cache->Atlas;
+
+    b32 Result = true;
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        u32 Size = FaceSizes[Face];
+        u32 Node = Entry->AtlasNodes[Face];
+        if (Node != shadow_atlas::InvalidNode)
+        {
+            u32 CurrentSize = GetShadowAtlasTile(Node).Size;
+            b32 ShouldGrow = (2 * CurrentSize < Size);
+            b32 ShouldShrink = (CurrentSize > 2 * Size);
+            Entry->ShrinkFrameCounts[Face] = ShouldShrink ? Entry->ShrinkFrameCounts[Face] + 1 : 0;
+            if (ShouldGrow || (ShouldShrink && (Entry->ShrinkFrameCounts[Face] >= R_PointShadowShrinkDelay)))
+            {
+                // NOTE(boti): Keep the current tile if there's no room for the new one
+                u32 NewNode = AllocateShadowAtlasTile(Atlas, Size);
+                while ((NewNode == shadow_atlas::InvalidNode) && EvictPointShadowTiles(Cache))
+                {
+                    NewNode = AllocateShadowAtlasTile(Atlas, Size);
+                }
+
+                if (NewNode != shadow_atlas::InvalidNode)
+                {
+                    FreeShadowAtlasTile(Atlas, Node);
+                    Entry->AtlasNodes[Face] = NewNode;
+                    Entry->ShrinkFrameCounts[Face] = 0;
+                    Entry->IsStaticValid = false;
+                }
+            }
+        }
+        else
+        {
+            // NOTE(boti): Evict first, downsize only when there's nothing left to evict
+            for (;;)
+            {
+                Node = AllocateShadowAtlasTile(Atlas, Size);
+                if (Node != shadow_atlas::InvalidNode)
+                {
+                    break;
+                }
+
+                if (!EvictPointShadowTiles(Cache))
+                {
+                    if (Size <= R_PointShadowMinResolution)
+                    {
+                        break;
+                    }
+                    Size /= 2;
+                }
+            }
+
+            Entry->AtlasNodes[Face] = Node;
+            Entry->ShrinkFrameCounts[Face] = 0;
+            Entry->IsStaticValid = false;
+            if (Node == shadow_atlas::InvalidNode)
+            {
+                Result = false;
+                break;
+            }
+        }
+    }
+
+    if (!Result)
+    {
+        FreePointShadowTiles(Cache, Entry);
+        Cache->IsAcquired[Slot] = false;
+    }
+    return(Result);
+}
+
+internal void InvalidatePointShadows(point_shadow_cache* Cache, mmbox Box)
+{
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        point_shadow_cache_entry* Entry = Cache->Entries + Slot;
+        if (Entry->IsStaticValid)
+        {
+            // NOTE(boti): Sphere-box distance
+            v3 ClosestP =
+            {
+                Clamp(Entry->P.X, Box.Min.X, Box.Max.X),
+                Clamp(Entry->P.Y, Box.Min.Y, Box.Max.Y),
+                Clamp(Entry->P.Z, Box.Min.Z, Box.Max.Z),
+            };
+            v3 dP = ClosestP - Entry->P;
+            if (Dot(dP, dP) <= Entry->Radius * Entry->Radius)
+            {
+                Entry->IsStaticValid = false;
+            }
+        }
+    }
+}
+
+internal void InvalidateAllPointShadows(point_shadow_cache* Cache)
+{
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        Cache->Entries[Slot].IsStaticValid = false;
+    }
+}
+
+internal b32 UpdatePointShadow(point_shadow_cache* Cache, u32 Slot, b32 IsStaticRebuilt, b32 HasDynamicCasters)
+{
+    Assert(Slot < R_MaxShadowCount);
+    point_shadow_cache_entry* Entry = Cache->Entries + Slot;
+
+    b32 Result = IsStaticRebuilt || HasDynamicCasters || Entry->HasDynamicOverlay;
+    if (IsStaticRebuilt)
+    {
+        Entry->IsStaticValid = true;
+    }
+    if (Result)
+    {
+        Entry->HasDynamicOverlay = HasDynamicCasters;
+    }
+    return(Result);
+}
+
+internal f32 GetCascadeTexelSize(f32 Extent)
+{
+    f32 Result = Extent / (f32)R_ShadowResolution;
+    return(Result);
+}
+
+internal f32 GetCascadeDepthStep(f32 Extent)
+{
+    f32 Result = Extent * cascade_placement::DepthStepFactor;
+    return(Result);
+}
+
+internal f32 GetCascadeDepthRange(f32 Extent)
+{
+    f32 Result = Extent * cascade_placement::DepthRangeFactor;
+    return(Result);
+}
+
+internal cascade_placement PlaceCascade(v3 SliceMin, v3 SliceMax, f32 SliceScale)
+{
+    cascade_placement Result = {};
+    Result.Extent = Ceil(SliceScale * (1.0f + 2.0f * cascade_placement::GuardBand));
+
+    f32 TexelSize = GetCascadeTexelSize(Result.Extent);
+    f32 DepthStep = GetCascadeDepthStep(Result.Extent);
+    f32 DepthRange = GetCascadeDepthRange(Result.Extent);
+
+    // NOTE(boti): The slice gets centered in the depth range too (before snapping), 
+    // which leaves some room on both sides for the camera to move/rotate
+    v3 Center = 0.5f * (SliceMin + SliceMax);
+    Result.TexelX = (s32)Floor(Center.X / TexelSize);
+    Result.TexelY = (s32)Floor(Center.Y / TexelSize);
+    Result.DepthSlice = (s32)Floor((Center.Z - 0.5f * DepthRange) / DepthStep);
+    return(Result);
+}
+
+internal v3 GetCascadeP(cascade_placement Placement)
+{
+    f32 TexelSize = GetCascadeTexelSize(Placement.Extent);
+    f32 DepthStep = GetCascadeDepthStep(Placement.Extent);
+    v3 Result = 
+    {
+        (f32)Placement.TexelX * TexelSize,
+        (f32)Placement.TexelY * TexelSize,
+        (f32)Placement.DepthSlice * DepthStep,
+    };
+    return(Result);
+}
+
+internal m4 GetCascadeProjection(cascade_placement Placement)
+{
+    v3 P = GetCascadeP(Placement);
+    f32 Scale = 2.0f / Placement.Extent;
+    f32 DepthScale = 1.0f / GetCascadeDepthRange(Placement.Extent);
+    m4 Result = M4(Scale, 0.0f, 0.0f, -Scale * P.X,
+                   0.0f, Scale, 0.0f, -Scale * P.Y,
+                   0.0f, 0.0f, DepthScale, -DepthScale * P.Z,
+                   0.0f, 0.0f, 0.0f, 1.0f);
+    return(Result);
+}
+
+internal b32 DoesCascadeCover(cascade_placement Placement, v3 SliceMin, v3 SliceMax)
+{
+    v3 P = GetCascadeP(Placement);
+    f32 HalfExtent = 0.5f * Placement.Extent;
+    f32 DepthRange = GetCascadeDepthRange(Placement.Extent);
+
+    b32 Result = 
+        (SliceMin.X >= P.X - HalfExtent) && (SliceMax.X <= P.X + HalfExtent) &&
+        (SliceMin.Y >= P.Y - HalfExtent) && (SliceMax.Y <= P.Y + HalfExtent) &&
+        (SliceMin.Z >= P.Z) && (SliceMax.Z <= P.Z + DepthRange);
+    return(Result);
+}
+
+internal b32 IsCascadeScheduled(u64 FrameIndex, u32 CascadeIndex)
+{
+    constexpr u32 Periods[R_MaxShadowCascadeCount] = { 1, 2, 4, 4 };
+    constexpr u32 Phases[R_MaxShadowCascadeCount] = { 0, 1, 0, 2 };
+
+    Assert(CascadeIndex < R_MaxShadowCascadeCount);
+    b32 Result = ((FrameIndex + Phases[CascadeIndex]) % Periods[CascadeIndex]) == 0;
+    return(Result);
+}
+
+internal b32 GetCascadeScroll(cascade_placement Old, cascade_placement New, cascade_shadow_update* Update)
+{
+    constexpr s32 Resolution = (s32)R_ShadowResolution;
+
+    b32 Result = false;
+    s32 dX = New.TexelX - Old.TexelX;
+    s32 dY = New.TexelY - Old.TexelY;
+    // NOTE(boti): Depth values are only preserved if the depth range stays the same
+    if ((Old.Extent == New.Extent) && (Old.DepthSlice == New.DepthSlice) &&
+        (dX > -Resolution) && (dX < Resolution) &&
+        (dY > -Resolution) && (dY < Resolution))
+    {
+        Result = true;
+        Update->ScrollX = dX;
+        Update->ScrollY = dY;
+        Update->StripCount = 0;
+
+        // NOTE(boti): The strips overlap in the corner, which is fine since both of them get cleared and fully rendered
+        if (dX != 0)
+        {
+            u32 Width = (u32)(dX > 0 ? dX : -dX);
+            Update->Strips[Update->StripCount++] = 
+            {
+                .X = (dX > 0) ? R_ShadowResolution - Width : 0,
+                .Y = 0,
+                .Width = Width,
+                .Height = R_ShadowResolution,
+            };
+        }
+        if (dY != 0)
+        {
+            u32 Height = (u32)(dY > 0 ? dY : -dY);
+            Update->Strips[Update->StripCount++] = 
+            {
+                .X = 0,
+                .Y = (dY > 0) ? R_ShadowResolution - Height : 0,
+                .Width = R_ShadowResolution,
+                .Height = Height,
+            };
+        }
+    }
+    return(Result);
+}
+
+internal cascade_scroll_copy GetCascadeScrollCopy(const cascade_shadow_update* Update)
+{
+    Assert(Update->IsScrolled);
+    s32 ScrollX = Update->ScrollX;
+    s32 ScrollY = Update->ScrollY;
+    cascade_scroll_copy Result = 
+    {
+        .SrcX = (u32)Max(ScrollX, 0),
+        .SrcY = (u32)Max(ScrollY, 0),
+        .DstX = (u32)Max(-ScrollX, 0),
+        .DstY = (u32)Max(-ScrollY, 0),
+        .Width = R_ShadowResolution - (u32)(ScrollX > 0 ? ScrollX : -ScrollX),
+        .Height = R_ShadowResolution - (u32)(ScrollY > 0 ? ScrollY : -ScrollY),
+    };
+    return(Result);
+}
+
+internal void BeginCascadeShadowCacheFrame(cascade_shadow_cache* Cache, m4 SunView)
+{
+    Cache->FrameIndex++;
+
+    // NOTE(boti): The cascades are all sampled relative to cascade 0, so they have to share the sun basis
+    if (memcmp(&Cache->SunView, &SunView, sizeof(SunView)) != 0)
+    {
+        Cache->SunView = SunView;
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            Cache->Entries[CascadeIndex].IsValid = false;
+            Cache->Entries[CascadeIndex].IsStaticValid = false;
+        }
+    }
+}
+
+internal cascade_shadow_update ScheduleCascadeShadow(cascade_shadow_cache* Cache, u32 CascadeIndex, 
+                                                     v3 SliceMin, v3 SliceMax, f32 SliceScale, 
+                                                     cascade_placement* Placement)
+{
+    Assert(CascadeIndex < R_MaxShadowCascadeCount);
+    cascade_shadow_cache_entry* Entry = Cache->Entries + CascadeIndex;
+
+    cascade_shadow_update Result = {};
+    Result.IsScheduled = 
+        !Entry->IsValid ||
+        IsCascadeScheduled(Cache->FrameIndex, CascadeIndex) ||
+        !DoesCascadeCover(Entry->Placement, SliceMin, SliceMax);
+    Result.SrcStaticLayer = Entry->StaticLayer;
+    Result.DstStaticLayer = Entry->StaticLayer;
+
+    if (Result.IsScheduled)
+    {
+        cascade_placement NewPlacement = PlaceCascade(SliceMin, SliceMax, SliceScale);
+        b32 IsSamePlacement = 
+            (NewPlacement.TexelX == Entry->Placement.TexelX) &&
+            (NewPlacement.TexelY == Entry->Placement.TexelY) &&
+            (NewPlacement.DepthSlice == Entry->Placement.DepthSlice) &&
+            (NewPlacement.Extent == Entry->Placement.Extent);
+
+        if (!Entry->IsStaticValid)
+        {
+            Result.IsStaticRebuilt = true;
+        }
+        else if (IsSamePlacement)
+        {
+            // NOTE(boti): The static layer can be used as is
+        }
+        else if (GetCascadeScroll(Entry->Placement, NewPlacement, &Result))
+        {
+            // NOTE(boti): Scrolling can't be done in place, so it ping-pongs between the 2 static layers
+            Result.IsScrolled = true;
+            Result.DstStaticLayer = Entry->StaticLayer ^ 1;
+        }
+        else
+        {
+            Result.IsStaticRebuilt = true;
+        }
+
+        Entry->Placement = NewPlacement;
+        Entry->StaticLayer = Result.DstStaticLayer;
+        Entry->IsValid = true;
+        Entry->IsStaticValid = true;
+    }
+
+    *Placement = Entry->Placement;
+    return(Result);
+}
+
+internal void InvalidateCascadeShadows(cascade_shadow_cache* Cache, mmbox Box)
+{
+    mmbox SunBox = TransformBox(Cache->SunView, Box);
+    for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+    {
+        cascade_shadow_cache_entry* Entry = Cache->Entries + CascadeIndex;
+        if (Entry->IsStaticValid)
+        {
+            v3 P = GetCascadeP(Entry->Placement);
+            f32 HalfExtent = 0.5f * Entry->Placement.Extent;
+            f32 DepthRange = GetCascadeDepthRange(Entry->Placement.Extent);
+
+            // NOTE(boti): Casters in front of the near plane still get rendered (with depth clamping),
+            // so only the far plane matters in Z
+            if ((SunBox.Min.X <= P.X + HalfExtent) && (SunBox.Max.X >= P.X - HalfExtent) &&
+                (SunBox.Min.Y <= P.Y + HalfExtent) && (SunBox.Max.Y >= P.Y - HalfExtent) &&
+                (SunBox.Min.Z <= P.Z + DepthRange))
+            {
+                Entry->IsStaticValid = false;
+            }
+        }
+    }
+}
+
+internal void InvalidateAllCascadeShadows(cascade_shadow_cache* Cache)
+{
+    for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+    {
+        Cache->Entries[CascadeIndex].IsStaticValid = false;
+    }
+}
+
+internal b32 UpdateCascadeShadow(cascade_shadow_cache* Cache, u32 CascadeIndex, 
+                                 const cascade_shadow_update* Update, b32 HasDynamicCasters)
+{
+    Assert(CascadeIndex < R_MaxShadowCascadeCount);
+    cascade_shadow_cache_entry* Entry = Cache->Entries + CascadeIndex;
+
+    b32 Result = false;
+    if (Update->IsScheduled)
+    {
+        Result = Update->IsStaticRebuilt || Update->IsScrolled || HasDynamicCasters || Entry->HasDynamicOverlay;
+        if (Result)
+        {
+            Entry->HasDynamicOverlay = HasDynamicCasters;
+        }
+    }
+    return(Result);
+}
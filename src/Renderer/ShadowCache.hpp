@@ -0,0 +1,154 @@
+#pragma once
+
+// NOTE(boti): CPU-side bookkeeping of the cached point shadow maps.
+//
+// Each shadow map slot has a static layer (retained instances only) that stays valid for as long as
+// the light doesn't move and no retained caster changes inside its radius.
+// The sampled shadow map is the static layer with the dynamic (immediate) casters rendered on top,
+// it only needs to be updated when there are dynamic casters in range, or when there were some the last time.
+//
+// Lights don't have persistent IDs, they're matched to slots by their position and radius.
+//
+// The faces of the slots live in the shadow atlas (the static layers in a static atlas with the same layout),
+// the tiles stay with the slot until they get resized or evicted.
+
+struct point_shadow_cache_entry
+{
+    v3 P;
+    f32 Radius;
+    u64 LastUsedFrame;
+    b32 IsStaticValid;
+    b32 HasDynamicOverlay; // NOTE(boti): The sampled map differs from the static layer
+    u32 AtlasNodes[CubeLayer_Count]; // NOTE(boti): shadow_atlas::InvalidNode if the face doesn't have a tile
+    u32 ShrinkFrameCounts[CubeLayer_Count]; // NOTE(boti): Consecutive frames the face was requested at a much smaller size than its tile
+};
+
+struct point_shadow_cache
+{
+    u64 FrameIndex;
+    b32 IsAcquired[R_MaxShadowCount]; // NOTE(boti): Slots already handed out in the current frame
+    point_shadow_cache_entry Entries[R_MaxShadowCount];
+    shadow_atlas Atlas;
+};
+
+internal void BeginPointShadowCacheFrame(point_shadow_cache* Cache);
+// NOTE(boti): Returns the slot for the light, which is either a cached slot for the same light,
+// or the least recently used one (in which case the static layer gets invalidated).
+// Returns U32_MAX if all the slots have already been acquired this frame.
+internal u32 AcquirePointShadow(point_shadow_cache* Cache, v3 P, f32 Radius);
+// NOTE(boti): Makes sure that the faces of an acquired slot have tiles close to the requested sizes 
+// (within a factor of 2, so that lights near a size boundary don't keep getting reallocated).
+// Faces grow right away, but only shrink after being requested at the smaller size for R_PointShadowShrinkDelay frames,
+// so that faces that briefly leave the view (or lights that briefly move away) keep their tiles and static layer.
+// When the atlas is full, the tiles of the least recently used lights that weren't acquired this frame get evicted,
+// and then the new faces get downsized. Resizing a face only happens if a tile of the requested size is available.
+// Returns false and releases the slot if even the smallest tiles don't fit.
+// Changing any of the tiles invalidates the static layer.
+internal b32 AllocatePointShadowTiles(point_shadow_cache* Cache, u32 Slot, const u32* FaceSizes);
+// NOTE(boti): Invalidates the static layer of the lights that the (world-space) box is in range of
+internal void InvalidatePointShadows(point_shadow_cache* Cache, mmbox Box);
+internal void InvalidateAllPointShadows(point_shadow_cache* Cache);
+
+// NOTE(boti): Returns whether the sampled map needs to be rebuilt from the static layer
+// (plus the dynamic overlay) and updates the bookkeeping as if it was.
+internal b32 UpdatePointShadow(point_shadow_cache* Cache, u32 Slot, b32 IsStaticRebuilt, b32 HasDynamicCasters);
+
+// NOTE(boti): CPU-side bookkeeping of the cached sun shadow cascades.
+//
+// Cascades are placed on a fixed sun-space grid: the center is snapped to whole texels, 
+// and the depth range (which is wider than the frustum slice) is snapped to 1/8th of the cascade extent.
+// This means that a cascade that moved on the grid can keep its static layer by scrolling it,
+// i.e. copying the still overlapping part and only rendering the static casters in the exposed strips.
+//
+// The cascades are padded by a guard band, so that the far cascades only need to be re-placed every few frames
+// (see IsCascadeScheduled()), and only get updated out of schedule when the camera leaves the guard band.
+// Dynamic casters in the far cascades get updated at the same rate.
+
+struct cascade_placement
+{
+    static constexpr f32 GuardBand = 0.125f; // NOTE(boti): Relative to the size of the frustum slice, on each side
+    static constexpr f32 DepthStepFactor = 1.0f / 8.0f;
+    static constexpr f32 DepthRangeFactor = 1.5f;
+
+    s32 TexelX, TexelY; // NOTE(boti): Center of the cascade in texels
+    s32 DepthSlice;     // NOTE(boti): Near plane of the cascade in depth steps
+    f32 Extent;         // NOTE(boti): Sun-space width/height of the cascade
+};
+
+struct cascade_strip
+{
+    u32 X, Y;
+    u32 Width, Height;
+};
+
+// NOTE(boti): Texel (x, y) of the new placement is texel (x + ScrollX, y + ScrollY) of the old one
+struct cascade_scroll_copy
+{
+    u32 SrcX, SrcY;
+    u32 DstX, DstY;
+    u32 Width, Height;
+};
+
+struct cascade_shadow_cache_entry
+{
+    cascade_placement Placement;
+    u32 StaticLayer;        // NOTE(boti): Which one of the 2 static layers of the cascade is current
+    b32 IsValid;            // NOTE(boti): The sampled cascade has been rendered at Placement
+    b32 IsStaticValid;
+    b32 HasDynamicOverlay;  // NOTE(boti): The sampled cascade differs from the static layer
+};
+
+struct cascade_shadow_cache
+{
+    u64 FrameIndex;
+    m4 SunView; // NOTE(boti): Sun basis the cascades were rendered with
+    cascade_shadow_cache_entry Entries[R_MaxShadowCascadeCount];
+};
+
+// NOTE(boti): What needs to be rendered for a cascade in the current frame
+struct cascade_shadow_update
+{
+    b32 IsScheduled;        // NOTE(boti): The cascade gets re-placed, which needs the draw lists
+    b32 IsStaticRebuilt;    // NOTE(boti): The whole static layer gets rendered
+    b32 IsScrolled;         // NOTE(boti): The static layer gets copied from the previous one, shifted by the scroll amount
+    u32 SrcStaticLayer;
+    u32 DstStaticLayer;
+    s32 ScrollX, ScrollY;   // NOTE(boti): New - old placement in texels
+    u32 StripCount;         // NOTE(boti): Regions of the static layer that need to be rendered when scrolling
+    cascade_strip Strips[2];
+};
+
+internal f32 GetCascadeTexelSize(f32 Extent);
+internal f32 GetCascadeDepthStep(f32 Extent);
+internal f32 GetCascadeDepthRange(f32 Extent);
+// NOTE(boti): Places the cascade for the sun-space bounds of the frustum slice, 
+// SliceScale is the (rotation invariant) size of the slice
+internal cascade_placement PlaceCascade(v3 SliceMin, v3 SliceMax, f32 SliceScale);
+// NOTE(boti): Sun-space position of the cascade, the near plane is at Z, XY is the center
+internal v3 GetCascadeP(cascade_placement Placement);
+// NOTE(boti): Sun-space to clip-space transform of the cascade (the sun basis is applied on top of this),
+// with the standard [0, R_ShadowResolution] viewport this maps sun-space +X/+Y to increasing texel X/Y
+internal m4 GetCascadeProjection(cascade_placement Placement);
+internal b32 DoesCascadeCover(cascade_placement Placement, v3 SliceMin, v3 SliceMax);
+// NOTE(boti): Cascade 0 gets updated every frame, cascade 1 every other frame,
+// the rest of them every 4th frame, staggered so that at most 2 cascades get updated per frame
+internal b32 IsCascadeScheduled(u64 FrameIndex, u32 CascadeIndex);
+// NOTE(boti): Scrolls the static layer from Old to New, returns false if the placements don't overlap
+internal b32 GetCascadeScroll(cascade_placement Old, cascade_placement New, cascade_shadow_update* Update);
+// NOTE(boti): The part of the old static layer that's still inside the new placement,
+// this is everything outside of the strips
+internal cascade_scroll_copy GetCascadeScrollCopy(const cascade_shadow_update* Update);
+
+// NOTE(boti): Invalidates everything if the sun direction changed
+internal void BeginCascadeShadowCacheFrame(cascade_shadow_cache* Cache, m4 SunView);
+// NOTE(boti): Decides what to do with the cascade this frame, Placement is updated to the one that should be sampled
+internal cascade_shadow_update ScheduleCascadeShadow(cascade_shadow_cache* Cache, u32 CascadeIndex, 
+                                                     v3 SliceMin, v3 SliceMax, f32 SliceScale, 
+                                                     cascade_placement* Placement);
+// NOTE(boti): Invalidates the static layer of the cascades that the (world-space) box overlaps
+internal void InvalidateCascadeShadows(cascade_shadow_cache* Cache, mmbox Box);
+internal void InvalidateAllCascadeShadows(cascade_shadow_cache* Cache);
+// NOTE(boti): Returns whether the sampled cascade needs to be rebuilt from the static layer 
+// (plus the dynamic overlay) and updates the bookkeeping as if it was.
+internal b32 UpdateCascadeShadow(cascade_shadow_cache* Cache, u32 CascadeIndex, 
+                                 const cascade_shadow_update* Update, b32 HasDynamicCasters);
@@ -0,0 +1,258 @@
+// NOTE(boti): Returns the first page in [PageIndex, EndPage) that has the requested usage, or EndPage if there's none
+internal umm
+FindNextPage(texture_cache* Cache, umm PageIndex, umm EndPage, b32 IsUsed)
+{
+    while (PageIndex < EndPage)
+    {
+        umm WordIndex = PageIndex / 64;
+        u64 Word = IsUsed ? Cache->PageUsage[WordIndex] : ~Cache->PageUsage[WordIndex];
+        Word &= U64_MAX << (PageIndex % 64);
+
+        u32 Bit;
+        if (BitScanForward(&Bit, Word))
+        {
+            PageIndex = WordIndex * 64 + Bit;
+            break;
+        }
+        PageIndex = (WordIndex + 1) * 64;
+    }
+
+    umm Result = Min(PageIndex, EndPage);
+    return(Result);
+}
+
+internal void
+UpdatePageRegion(texture_cache* Cache, umm RegionIndex)
+{
+    umm BeginPage = RegionIndex * texture_cache::RegionPageCount;
+    umm EndPage = BeginPage + texture_cache::RegionPageCount;
+
+    texture_page_region Region = {};
+    for (umm RunBegin = FindNextPage(Cache, BeginPage, EndPage, false); RunBegin < EndPage; )
+    {
+        umm RunEnd = FindNextPage(Cache, RunBegin, EndPage, true);
+        u16 RunLength = (u16)(RunEnd - RunBegin);
+
+        Region.FreeCount += RunLength;
+        Region.MaxFreeRun = Max(Region.MaxFreeRun, RunLength);
+        Region.FreeRunCount++;
+        if (RunBegin == BeginPage) Region.LeadingFreeCount = RunLength;
+        if (RunEnd == EndPage) Region.TrailingFreeCount = RunLength;
+
+        RunBegin = FindNextPage(Cache, RunEnd, EndPage, false);
+    }
+    Cache->Regions[RegionIndex] = Region;
+}
+
+internal void
+UpdateFreeRangeStats(texture_cache* Cache)
+{
+    umm LargestFreeRange = 0;
+    umm FreeRangeCount = 0;
+    umm Carry = 0; // NOTE(boti): Free run that reaches the start of the current region
+    for (umm RegionIndex = 0; RegionIndex < Cache->RegionCount; RegionIndex++)
+    {
+        texture_page_region* Region = Cache->Regions + RegionIndex;
+        FreeRangeCount += Region->FreeRunCount;
+        if (Carry && Region->LeadingFreeCount)
+        {
+            FreeRangeCount--;
+        }
+
+        if (Region->FreeCount == texture_cache::RegionPageCount)
+        {
+            Carry += texture_cache::RegionPageCount;
+        }
+        else
+        {
+            LargestFreeRange = Max(LargestFreeRange, Carry + Region->LeadingFreeCount);
+            LargestFreeRange = Max(LargestFreeRange, (umm)Region->MaxFreeRun);
+            Carry = Region->TrailingFreeCount;
+        }
+    }
+    LargestFreeRange = Max(LargestFreeRange, Carry);
+
+    Cache->LargestFreeRange = LargestFreeRange;
+    Cache->FreeRangeCount = FreeRangeCount;
+}
+
+internal void
+InitTextureCache(texture_cache* Cache, memory_arena* Arena, umm PageCount, umm BudgetPageCount)
+{
+    Cache->PageCount = PageCount;
+    Cache->RegionCount = CeilDiv(Cache->PageCount, texture_cache::RegionPageCount);
+    Cache->PageUsage = PushArray(Arena, MemPush_Clear, u64, Cache->RegionCount * texture_cache::RegionWordCount);
+    Cache->Regions = PushArray(Arena, MemPush_Clear, texture_page_region, Cache->RegionCount);
+
+    // NOTE(boti): Mark the padding at the end of the last region as used, so that it never gets allocated
+    for (umm PageIndex = Cache->PageCount; PageIndex < Cache->RegionCount * texture_cache::RegionPageCount; PageIndex++)
+    {
+        Cache->PageUsage[PageIndex / 64] |= 1llu << (PageIndex % 64);
+    }
+    for (umm RegionIndex = 0; RegionIndex < Cache->RegionCount; RegionIndex++)
+    {
+        UpdatePageRegion(Cache, RegionIndex);
+    }
+    UpdateFreeRangeStats(Cache);
+
+    Cache->UsedPageCount = 0;
+    Cache->BudgetPageCount = Min(BudgetPageCount, Cache->PageCount);
+    Cache->LowWaterPageCount = Cache->BudgetPageCount - Cache->BudgetPageCount / 16;
+}
+
+internal umm 
+FindFreePageRange(texture_cache* Cache, umm PageCount)
+{
+    umm Result = U64_MAX;
+
+    // NOTE(boti): Failing is the common case when the cache is full, so that has to be fast too
+    if (PageCount && PageCount <= Cache->LargestFreeRange)
+    {
+        umm Carry = 0; // NOTE(boti): Free run that reaches the start of the current region
+        for (umm RegionIndex = 0; RegionIndex < Cache->RegionCount; RegionIndex++)
+        {
+            texture_page_region* Region = Cache->Regions + RegionIndex;
+            umm BeginPage = RegionIndex * texture_cache::RegionPageCount;
+            umm EndPage = BeginPage + texture_cache::RegionPageCount;
+
+            if (Carry + Region->LeadingFreeCount >= PageCount)
+            {
+                Result = BeginPage - Carry;
+                break;
+            }
+
+            if (Region->MaxFreeRun >= PageCount)
+            {
+                for (umm RunBegin = FindNextPage(Cache, BeginPage, EndPage, false); RunBegin < EndPage; )
+                {
+                    umm RunEnd = FindNextPage(Cache, RunBegin, EndPage, true);
+                    if (RunEnd - RunBegin >= PageCount)
+                    {
+                        Result = RunBegin;
+                        break;
+                    }
+                    RunBegin = FindNextPage(Cache, RunEnd, EndPage, false);
+                }
+                Assert(Result != U64_MAX);
+                break;
+            }
+
+            Carry = (Region->FreeCount == texture_cache::RegionPageCount) ? Carry + texture_cache::RegionPageCount : Region->TrailingFreeCount;
+        }
+    }
+    return(Result);
+}
+
+internal void
+SetPageUsage(texture_cache* Cache, umm FirstPage, umm PageCount, b32 IsUsed)
+{
+    Assert(FirstPage + PageCount <= Cache->PageCount);
+
+    umm EndPage = FirstPage + PageCount;
+    for (umm PageIndex = FirstPage; PageIndex < EndPage; )
+    {
+        umm WordIndex = PageIndex / 64;
+        umm BitIndex = PageIndex % 64;
+        umm BitCount = Min(64 - BitIndex, EndPage - PageIndex);
+        u64 Mask = (BitCount == 64 ? U64_MAX : ((1llu << BitCount) - 1)) << BitIndex;
+        if (IsUsed)
+        {
+            Assert((Cache->PageUsage[WordIndex] & Mask) == 0);
+            Cache->PageUsage[WordIndex] |= Mask;
+        }
+        else
+        {
+            Assert((Cache->PageUsage[WordIndex] & Mask) == Mask);
+            Cache->PageUsage[WordIndex] &= ~Mask;
+        }
+        PageIndex += BitCount;
+    }
+
+    if (PageCount)
+    {
+        umm FirstRegion = FirstPage / texture_cache::RegionPageCount;
+        umm LastRegion = (EndPage - 1) / texture_cache::RegionPageCount;
+        for (umm RegionIndex = FirstRegion; RegionIndex <= LastRegion; RegionIndex++)
+        {
+            UpdatePageRegion(Cache, RegionIndex);
+        }
+        UpdateFreeRangeStats(Cache);
+    }
+}
+
+internal void
+MarkPagesAsUsed(texture_cache* Cache, umm FirstPage, umm PageCount)
+{
+    Cache->UsedPageCount += PageCount;
+    SetPageUsage(Cache, FirstPage, PageCount, true);
+}
+
+internal void
+MarkPagesAsFree(texture_cache* Cache, umm FirstPage, umm PageCount)
+{
+    Cache->UsedPageCount -= PageCount;
+    SetPageUsage(Cache, FirstPage, PageCount, false);
+}
+
+internal f32
+GetTextureCacheFragmentation(texture_cache* Cache)
+{
+    f32 Result = 0.0f;
+    umm FreePageCount = Cache->PageCount - Cache->UsedPageCount;
+    if (FreePageCount)
+    {
+        Result = 1.0f - (f32)Cache->LargestFreeRange / (f32)FreePageCount;
+    }
+    return(Result);
+}
+
+internal void
+PushPendingPageFree(texture_cache* Cache, u32 FrameID, umm FirstPage, umm PageCount)
+{
+    if (PageCount)
+    {
+        if (Cache->PendingFreeCounts[FrameID] < Cache->MaxPendingFreeCount)
+        {
+            Cache->PendingFrees[FrameID][Cache->PendingFreeCounts[FrameID]++] = { FirstPage, PageCount };
+            Cache->PendingFreePageCount += PageCount;
+        }
+        else
+        {
+            UnhandledError("Out of pending texture page frees");
+        }
+    }
+}
+
+internal void
+ReleasePendingTexturePages(texture_cache* Cache, u32 FrameID)
+{
+    for (u32 Index = 0; Index < Cache->PendingFreeCounts[FrameID]; Index++)
+    {
+        texture_page_range* Range = Cache->PendingFrees[FrameID] + Index;
+        MarkPagesAsFree(Cache, Range->PageIndex, Range->PageCount);
+        Cache->PendingFreePageCount -= Range->PageCount;
+    }
+    Cache->PendingFreeCounts[FrameID] = 0;
+}
+
+internal umm
+GetResidentPageCount(texture_cache* Cache)
+{
+    umm Result = Cache->UsedPageCount - Cache->PendingFreePageCount;
+    return(Result);
+}
+
+internal b32
+UpdateTextureBudget(texture_cache* Cache)
+{
+    umm ResidentPageCount = GetResidentPageCount(Cache);
+    if (ResidentPageCount > Cache->BudgetPageCount)
+    {
+        Cache->IsOverBudget = true;
+    }
+    else if (ResidentPageCount <= Cache->LowWaterPageCount)
+    {
+        Cache->IsOverBudget = false;
+    }
+    return(Cache->IsOverBudget);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+constexpr umm TexturePageSize       = KiB(64);
+constexpr umm SmallTexturePageSize  = KiB(4);
+
+// NOTE(boti): Free runs of a region of the page bitmap, used to skip the regions that can't fit an allocation
+struct texture_page_region
+{
+    u16 FreeCount;
+    u16 LeadingFreeCount;   // NOTE(boti): Free pages at the start of the region
+    u16 TrailingFreeCount;  // NOTE(boti): Free pages at the end of the region
+    u16 MaxFreeRun;
+    u16 FreeRunCount;
+};
+
+struct texture_page_range
+{
+    umm PageIndex;
+    umm PageCount;
+};
+
+// NOTE(boti): The cache is allocated first-fit from a page bitmap (1 = used),
+// which is searched a 64-bit word at a time, with per-region summaries of the free runs.
+// Pages past PageCount (up to the end of the last region) are always marked as used.
+//
+// The pages of replaced images stay in use until the frames in flight that could still sample them have finished.
+// The residency budget only applies to the rest of the used pages: mips start getting evicted above the budget,
+// and keep getting evicted until the resident pages get below the low water mark.
+//
+// This is only the bookkeeping, the memory backing the pages is owned by the texture_manager (see TextureManager.hpp).
+struct texture_cache
+{
+    static constexpr umm RegionWordCount = 8;
+    static constexpr umm RegionPageCount = 64 * RegionWordCount;
+    static constexpr u32 MaxPendingFreeCount = 4096; // NOTE(boti): Per frame
+
+    umm UsedPageCount;
+
+    // NOTE(boti): Fragmentation stats, updated whenever the page usage changes
+    umm LargestFreeRange;
+    umm FreeRangeCount;
+
+    umm SmallPageOffset;
+    umm PageOffset;
+
+    umm SmallPageCount;
+    u64* SmallPageUsage;
+
+    umm PageCount;
+    u64* PageUsage;
+
+    umm RegionCount;
+    texture_page_region* Regions;
+
+    umm BudgetPageCount;
+    umm LowWaterPageCount;
+    b32 IsOverBudget;
+
+    // NOTE(boti): Freed once the frame with the same ID has finished on the GPU
+    umm PendingFreePageCount;
+    u32 PendingFreeCounts[R_MaxFramesInFlight];
+    texture_page_range PendingFrees[R_MaxFramesInFlight][MaxPendingFreeCount];
+};
+
+// NOTE(boti): All of the pages start out free, the budget is clamped to the page count
+internal void
+InitTextureCache(texture_cache* Cache, memory_arena* Arena, umm PageCount, umm BudgetPageCount);
+
+// NOTE(boti): Returns U64_MAX if there's no free range that's at least PageCount long
+internal umm
+FindFreePageRange(texture_cache* Cache, umm PageCount);
+
+internal void
+MarkPagesAsUsed(texture_cache* Cache, umm FirstPage, umm PageCount);
+
+internal void
+MarkPagesAsFree(texture_cache* Cache, umm FirstPage, umm PageCount);
+
+// NOTE(boti): 0 when all of the free pages are in a single range, approaches 1 as they get scattered
+internal f32
+GetTextureCacheFragmentation(texture_cache* Cache);
+
+// NOTE(boti): The pages become free once the frame has finished on the GPU (see ReleasePendingTexturePages)
+internal void
+PushPendingPageFree(texture_cache* Cache, u32 FrameID, umm FirstPage, umm PageCount);
+
+internal void
+ReleasePendingTexturePages(texture_cache* Cache, u32 FrameID);
+
+// NOTE(boti): Pages that aren't waiting to be freed
+internal umm
+GetResidentPageCount(texture_cache* Cache);
+
+// NOTE(boti): Updates the over budget state of the cache (with hysteresis), returns true if mips should be evicted
+internal b32
+UpdateTextureBudget(texture_cache* Cache);
@@ -7,7 +7,7 @@ WriteDescriptorDirect(texture_manager* Manager, u32 SrcIndex, u32 DstIndex)
     VkDescriptorImageInfo DescriptorImage = 
     {
         .sampler = VK_NULL_HANDLE,
-        .imageView = Manager->Textures[SrcIndex].ViewHandle,
+        .imageView = Manager->Images[SrcIndex].ViewHandle,
         .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
     };
     VkDescriptorGetInfoEXT DescriptorInfo = 
@@ -21,76 +21,8 @@ WriteDescriptorDirect(texture_manager* Manager, u32 SrcIndex, u32 DstIndex)
     vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Manager->DescriptorMapping, DescriptorOffset));
 }
 
-// TODO(boti): rewrite cache usage with bit ops
-
-internal umm 
-FindFreePageRange(texture_cache* Cache, umm PageCount)
-{
-    umm Result = U64_MAX;
-
-    umm FoundPageCount = 0;
-    umm CandidatePage = 0;
-    for (umm PageIndex = 0; PageIndex < Cache->PageCount; PageIndex++)
-    {
-        umm PageGroupIndex = PageIndex / 64;
-        umm InGroupIndex = PageIndex % 64;
-        u64 Mask = 1llu << InGroupIndex;
-        if ((Cache->PageUsage[PageGroupIndex] & Mask) == 0)
-        {
-            FoundPageCount++;
-            if (FoundPageCount == PageCount)
-            {
-                Result = CandidatePage;
-                break;
-            }
-        }
-        else
-        {
-            FoundPageCount = 0;
-            CandidatePage = PageIndex + 1;
-        }
-    }
-    return(Result);
-}
-
-internal void
-MarkPagesAsUsed(texture_cache* Cache, umm FirstPage, umm PageCount)
-{
-    Cache->UsedPageCount += PageCount;
-    umm PageGroupIndex = FirstPage / 64;
-    umm InGroupIndex = FirstPage % 64;
-    for (umm PageIndex = 0; PageIndex < PageCount; PageIndex++)
-    {
-        Assert((Cache->PageUsage[PageGroupIndex] & (1llu << InGroupIndex)) == 0);
-        Cache->PageUsage[PageGroupIndex] |= (1llu << InGroupIndex);
-        if (++InGroupIndex == 64)
-        {
-            InGroupIndex = 0;
-            PageGroupIndex++;
-        }
-    }
-}
-
-internal void
-MarkPagesAsFree(texture_cache* Cache, umm FirstPage, umm PageCount)
-{
-    Cache->UsedPageCount -= PageCount;
-    umm PageGroupIndex = FirstPage / 64;
-    umm InGroupIndex = FirstPage % 64;
-    for (umm PageIndex = 0; PageIndex < PageCount; PageIndex++)
-    {
-        Assert((Cache->PageUsage[PageGroupIndex] & (1llu << InGroupIndex)) != 0);
-        Cache->PageUsage[PageGroupIndex] &= ~(1llu << InGroupIndex);
-        if (++InGroupIndex == 64)
-        {
-            InGroupIndex = 0;
-            PageGroupIndex++;
-        }
-    }
-}
-
 internal b32
-AllocateImage(texture_cache* Cache, VkImage Image, umm* OutPageIndex, umm* OutPageCount)
+AllocateImage(texture_manager* Manager, VkImage Image, umm* OutPageIndex, umm* OutPageCount)
 {
     b32 Result = false;
 
@@ -99,12 +31,12 @@ AllocateImage(texture_cache* Cache, VkImage Image, umm* OutPageIndex, umm* OutPa
     Assert(MemoryRequirements.alignment <= TexturePageSize);
     
     umm PageCount = CeilDiv(MemoryRequirements.size, TexturePageSize);
-    umm PageIndex = FindFreePageRange(Cache, PageCount);
+    umm PageIndex = FindFreePageRange(&Manager->Cache, PageCount);
     if (PageIndex != U64_MAX)
     {
-        if (vkBindImageMemory(VK.Device, Image, Cache->Memory, PageIndex * TexturePageSize) == VK_SUCCESS)
+        if (vkBindImageMemory(VK.Device, Image, Manager->CacheMemory, PageIndex * TexturePageSize) == VK_SUCCESS)
         {
-            MarkPagesAsUsed(Cache, PageIndex, PageCount);
+            MarkPagesAsUsed(&Manager->Cache, PageIndex, PageCount);
             if (OutPageIndex) *OutPageIndex = PageIndex;
             if (OutPageCount) *OutPageCount = PageCount;
             Result = true;
@@ -118,7 +50,7 @@ AllocateImage(texture_cache* Cache, VkImage Image, umm* OutPageIndex, umm* OutPa
     return(Result);
 }
 
-internal bool CreateTextureManager(texture_manager* Manager, memory_arena* Arena, u64 MemorySize, u32 MemoryTypes, VkDescriptorSetLayout* SetLayouts)
+internal bool CreateTextureManager(texture_manager* Manager, memory_arena* Arena, u64 MemorySize, u64 BudgetSize, u32 MemoryTypes, VkDescriptorSetLayout* SetLayouts)
 {
     VkResult Result = VK_SUCCESS;
 
@@ -166,12 +98,12 @@ internal bool CreateTextureManager(texture_manager* Manager, memory_arena* Arena
                 .allocationSize = MemorySize,
                 .memoryTypeIndex = MemoryTypeIndex,
             };
-            Result = vkAllocateMemory(VK.Device, &AllocInfo, nullptr, &Manager->Cache.Memory);
+            Result = vkAllocateMemory(VK.Device, &AllocInfo, nullptr, &Manager->CacheMemory);
             if (Result == VK_SUCCESS)
             {
-                Manager->Cache.MemorySize = MemorySize;
-                Manager->Cache.MemoryTypeIndex = MemoryTypeIndex;
-                SetObjectName(VK.Device, Manager->Cache.Memory, "TextureCache");
+                Manager->CacheMemorySize = MemorySize;
+                Manager->CacheMemoryTypeIndex = MemoryTypeIndex;
+                SetObjectName(VK.Device, Manager->CacheMemory, "TextureCache");
             }
             else
             {
@@ -179,13 +111,9 @@ internal bool CreateTextureManager(texture_manager* Manager, memory_arena* Arena
             }
             
         }
-        Manager->Cache.PageCount = CeilDiv(MemorySize, TexturePageSize);
-        umm PageUsageCount = CeilDiv(Manager->Cache.PageCount, 64);
-        Manager->Cache.PageUsage = PushArray(Arena, MemPush_Clear, u64, PageUsageCount);
+        InitTextureCache(&Manager->Cache, Arena, CeilDiv(MemorySize, TexturePageSize), BudgetSize / TexturePageSize);
 
-        Manager->Cache.UsedPageCount = 0;
-
-        if (Manager->DescriptorArena.Memory && Manager->PersistentArena.Memory && Manager->Cache.Memory)
+        if (Manager->DescriptorArena.Memory && Manager->PersistentArena.Memory && Manager->CacheMemory)
         {
             if (PushBuffer(&Manager->DescriptorArena, DescriptorBufferSize,
                            VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT|VK_BUFFER_USAGE_TRANSFER_DST_BIT|VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
@@ -253,10 +181,9 @@ internal bool CreateTextureManager(texture_manager* Manager, memory_arena* Arena
                 Result = vkCreateImageView(VK.Device, &ViewInfo, nullptr, &NullView);
                 if (Result == VK_SUCCESS)
                 {
+                    Manager->Images[Manager->TextureCount] = { NullImage, NullView };
                     Manager->Textures[Manager->TextureCount++] =
                     {
-                        .ImageHandle = NullImage,
-                        .ViewHandle = NullView,
                         .Flags = TextureFlag_PersistentMemory,
                         .PlaceholderID = {},
                         .Info = TextureInfo,
@@ -287,6 +214,16 @@ internal renderer_texture* GetTexture(texture_manager* Manager, renderer_texture
     return(Result);
 }
 
+internal renderer_texture_image* GetTextureImage(texture_manager* Manager, renderer_texture_id ID)
+{
+    renderer_texture_image* Result = nullptr;
+    if (ID.Value < Manager->TextureCount)
+    {
+        Result = Manager->Images + ID.Value;
+    }
+    return(Result);
+}
+
 internal renderer_texture_id 
 AllocateNextID(texture_manager* Manager, texture_flags Flags)
 {
@@ -305,11 +242,12 @@ AllocateTexture(texture_manager* Manager, texture_flags Flags, const texture_inf
     if (IsValid(Result))
     {
         renderer_texture* Texture = GetTexture(Manager, Result);
-        Assert(Texture);
-        Assert(Texture->ImageHandle == VK_NULL_HANDLE);
-        Assert(Texture->ViewHandle == VK_NULL_HANDLE);
+        renderer_texture_image* TextureImage = GetTextureImage(Manager, Result);
+        Assert(Texture && TextureImage);
+        Assert(TextureImage->ImageHandle == VK_NULL_HANDLE);
+        Assert(TextureImage->ViewHandle == VK_NULL_HANDLE);
 
-        Texture->PlaceholderID;
+        Texture->PlaceholderID = Placeholder;
         Texture->Flags = Flags;
         Texture->Info = {};
         if (Info)
@@ -338,6 +276,7 @@ AllocateTexture(texture_manager* Manager, renderer_texture_id ID, texture_info I
     if (IsValid(ID))
     {
         renderer_texture* Texture = GetTexture(Manager, ID);
+        renderer_texture_image* TextureImage = GetTextureImage(Manager, ID);
 
         VkImageCreateInfo ImageInfo = 
         {
@@ -370,7 +309,7 @@ AllocateTexture(texture_manager* Manager, renderer_texture_id ID, texture_info I
             }
             else
             {
-                PushResult = AllocateImage(&Manager->Cache, Image, &PageIndex, &PageCount);
+                PushResult = AllocateImage(Manager, Image, &PageIndex, &PageCount);
             }
             
             if (PushResult)
@@ -397,9 +336,8 @@ AllocateTexture(texture_manager* Manager, renderer_texture_id ID, texture_info I
                 VkImageView View = VK_NULL_HANDLE;
                 if (vkCreateImageView(VK.Device, &ViewInfo, nullptr, &View) == VK_SUCCESS)
                 {
-                    MarkPagesAsFree(&Manager->Cache, Texture->PageIndex, Texture->PageCount);
-                    Texture->ImageHandle = Image;
-                    Texture->ViewHandle = View;
+                    TextureImage->ImageHandle = Image;
+                    TextureImage->ViewHandle = View;
                     Texture->PageIndex = PageIndex;
                     Texture->PageCount = PageCount;
                     Result = true;
@@ -425,4 +363,4 @@ AllocateTexture(texture_manager* Manager, renderer_texture_id ID, texture_info I
     }
 
     return(Result);
-}
\ No newline at end of file
+}
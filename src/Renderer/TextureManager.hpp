@@ -39,59 +39,24 @@ Mip exclusive (requires sparse binding/residency):
 */
 #endif
 
-constexpr umm TexturePageSize       = KiB(64);
-constexpr umm SmallTexturePageSize  = KiB(4);
-
-struct renderer_texture
-{
-    VkImage             ImageHandle;
-    VkImageView         ViewHandle;
-    texture_flags       Flags;
-    renderer_texture_id PlaceholderID;
-    texture_info        Info;
-
-    u32 MipResidencyMask;
-    u32 LastMipAccess;
-
-    umm PageIndex;
-    umm PageCount;
-};
-
-struct texture_cache
+struct renderer_texture_image
 {
-    VkDeviceMemory Memory;
-    umm MemorySize;
-    u32 MemoryTypeIndex;
-    umm UsedPageCount;
-
-    umm SmallPageOffset;
-    umm PageOffset;
-
-    umm SmallPageCount;
-    u64* SmallPageUsage;
-
-    umm PageCount;
-    u64* PageUsage;
+    VkImage     ImageHandle;
+    VkImageView ViewHandle;
 };
 
-internal umm 
-FindFreePageRange(texture_cache* Cache, umm PageCount);
-
-internal void
-MarkPagesAsUsed(texture_cache* Cache, umm FirstPage, umm PageCount);
-
-internal void
-MarkPagesAsFree(texture_cache* Cache, umm FirstPage, umm PageCount);
-
-internal b32
-AllocateImage(texture_cache* Cache, VkImage Image);
-
 struct texture_manager
 {
+    static constexpr u32 MaxEvictionCountPerFrame = 32;
+
     VkDescriptorSetLayout DescriptorSetLayout;
 
     gpu_memory_arena    PersistentArena;
+
     texture_cache       Cache;
+    VkDeviceMemory      CacheMemory;
+    umm                 CacheMemorySize;
+    u32                 CacheMemoryTypeIndex;
 
     gpu_memory_arena    DescriptorArena;
     VkBuffer            DescriptorBuffer;
@@ -101,18 +66,32 @@ struct texture_manager
 
     u32                 TextureCount;
     renderer_texture    Textures[R_MaxTextureCount];
+    renderer_texture_image Images[R_MaxTextureCount];
+
+    // NOTE(boti): Textures with a non-zero LastMipAccess, these have to be visited by the feedback processing
+    // even when they weren't sampled, everything else can be skipped unless it shows up in the feedback
+    u64                 SampledTextureBits[R_MaxTextureCount / 64];
 };
 
 // TODO(boti): Rework this API, it's horrible
 
 internal bool 
-CreateTextureManager(texture_manager* Manager, memory_arena* Arena, u64 MemorySize, u32 MemoryTypes, VkDescriptorSetLayout* SetLayouts);
+CreateTextureManager(texture_manager* Manager, memory_arena* Arena, u64 MemorySize, u64 BudgetSize, u32 MemoryTypes, VkDescriptorSetLayout* SetLayouts);
 
 internal renderer_texture* 
 GetTexture(texture_manager* Manager, renderer_texture_id ID);
 
+internal renderer_texture_image*
+GetTextureImage(texture_manager* Manager, renderer_texture_id ID);
+
+// NOTE(boti): Binds the image to a free range of the cache, returns false if there's no room for it
+internal b32
+AllocateImage(texture_manager* Manager, VkImage Image, umm* OutPageIndex, umm* OutPageCount);
+
 internal renderer_texture_id
 AllocateTexture(texture_manager* Manager, texture_flags Flags, const texture_info* Info, renderer_texture_id Placeholder);
 
+// NOTE(boti): The image and the pages of the previous allocation (if any) are not freed,
+// they have to be retired by the caller once the frames in flight have finished with them
 internal b32
-AllocateTexture(texture_manager* Manager, renderer_texture_id ID, texture_info Info);
\ No newline at end of file
+AllocateTexture(texture_manager* Manager, renderer_texture_id ID, texture_info Info);
@@ -0,0 +1,139 @@
+internal void
+UpdateTextureAccess(renderer_texture* Texture, u32 MipFeedback, u32 FrameIndex)
+{
+    Texture->LastMipAccess = MipFeedback;
+
+    u32 HighestResidentMip, HighestSampledMip;
+    if (BitScanReverse(&HighestResidentMip, Texture->MipResidencyMask) && 
+        BitScanReverse(&HighestSampledMip, MipFeedback) &&
+        HighestSampledMip >= HighestResidentMip)
+    {
+        Texture->LastUsedFrame = FrameIndex;
+    }
+}
+
+internal u32
+ProcessMipFeedback(renderer_texture* Textures, u64* SampledTextureBits, const u32* MipFeedbacks, u32 FeedbackCount, u32 FrameIndex, 
+                   u32* OutTextureIndices, u32* OutMips)
+{
+    u32 Result = 0;
+
+    u32 BlockCount = CeilDiv(FeedbackCount, 64u);
+    for (u32 BlockIndex = 0; BlockIndex < BlockCount; BlockIndex++)
+    {
+        u32 BaseIndex = 64 * BlockIndex;
+        u32 EntryCount = Min(FeedbackCount - BaseIndex, 64u);
+
+        // NOTE(boti): Bit mask of the non-zero feedback entries in the block
+        u64 SampledBits = 0;
+        const u32* Feedback = MipFeedbacks + BaseIndex;
+        __m128i Zero = _mm_setzero_si128();
+        for (u32 Index = 0; Index < EntryCount; Index += 4)
+        {
+            if (EntryCount - Index >= 4)
+            {
+                __m128i Value = _mm_loadu_si128((const __m128i*)(Feedback + Index));
+                u32 ZeroMask = (u32)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(Value, Zero)));
+                SampledBits |= (u64)(~ZeroMask & 0xFu) << Index;
+            }
+            else
+            {
+                for (u32 TailIndex = Index; TailIndex < EntryCount; TailIndex++)
+                {
+                    SampledBits |= (u64)(Feedback[TailIndex] != 0) << TailIndex;
+                }
+            }
+        }
+
+        u64 EntryMask = (EntryCount == 64) ? U64_MAX : ((1llu << EntryCount) - 1);
+        u64 VisitBits = SampledBits | (SampledTextureBits[BlockIndex] & EntryMask);
+        SampledTextureBits[BlockIndex] &= ~EntryMask;
+
+        u32 Bit;
+        while (BitScanForward(&Bit, VisitBits))
+        {
+            VisitBits &= VisitBits - 1;
+
+            u32 TextureIndex = BaseIndex + Bit;
+            renderer_texture* Texture = Textures + TextureIndex;
+            if (!(Texture->Flags & TextureFlag_PersistentMemory))
+            {
+                u32 MipFeedback = Feedback[Bit];
+                UpdateTextureAccess(Texture, MipFeedback, FrameIndex);
+                if (MipFeedback)
+                {
+                    SampledTextureBits[BlockIndex] |= 1llu << Bit;
+
+                    OutTextureIndices[Result] = TextureIndex;
+                    OutMips[Result] = MipFeedback;
+                    Result++;
+                }
+            }
+        }
+    }
+
+    return(Result);
+}
+
+internal u32
+GetMipsToEvict(renderer_texture* Texture)
+{
+    u32 KeptMips = renderer_texture::AlwaysResidentMips | SetBitsBelowHighInclusive(Texture->LastMipAccess);
+    u32 Result = Texture->MipResidencyMask & (~KeptMips);
+    return(Result);
+}
+
+internal u32
+GetTextureEvictionCandidates(renderer_texture* Textures, u32 TextureCount, u32 FrameIndex, memory_arena* Arena, u32** OutIndices)
+{
+    u32 Count = 0;
+    u64* Keys = PushArray(Arena, 0, u64, TextureCount);
+    u32* Indices = PushArray(Arena, 0, u32, TextureCount);
+    for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+    {
+        renderer_texture* Texture = Textures + TextureIndex;
+        u32 Age = FrameIndex - Texture->LastUsedFrame;
+
+        // NOTE(boti): Evicting from array textures is not implemented
+        if (!(Texture->Flags & TextureFlag_PersistentMemory) && 
+            (Texture->PageCount != 0) &&
+            (Texture->Info.ArrayCount == 1) &&
+            (Age >= renderer_texture::MinEvictionAge) &&
+            GetMipsToEvict(Texture))
+        {
+            u32 PageCount = (u32)Min(Texture->PageCount, (umm)U32_MAX);
+            Keys[Count] = ((u64)(U32_MAX - Age) << 32) | (U32_MAX - PageCount);
+            Indices[Count] = TextureIndex;
+            Count++;
+        }
+    }
+
+    u64* TempKeys = PushArray(Arena, 0, u64, Count);
+    u32* TempIndices = PushArray(Arena, 0, u32, Count);
+    RadixSort64(Count, Keys, Indices, TempKeys, TempIndices);
+
+    *OutIndices = Indices;
+    return(Count);
+}
+
+internal u32
+GetTextureRequestPriority(u32 SampledMips, u32 ResidentMips)
+{
+    u32 Result = 0;
+
+    // NOTE(boti): The missing mip count is how much blurrier the texture is than it should be,
+    // and the highest sampled mip stands in for the screen-space size (textures that are close or large get sampled at higher mips).
+    // Textures with nothing resident (i.e. the placeholder is shown) are missing all of their mips, so those come first.
+    u32 HighestSampledMip;
+    if (BitScanReverse(&HighestSampledMip, SampledMips))
+    {
+        u32 MissingMipCount = HighestSampledMip + 1;
+        u32 HighestResidentMip;
+        if (BitScanReverse(&HighestResidentMip, ResidentMips))
+        {
+            MissingMipCount = (HighestSampledMip > HighestResidentMip) ? HighestSampledMip - HighestResidentMip : 0;
+        }
+        Result = (MissingMipCount << 8) | HighestSampledMip;
+    }
+    return(Result);
+}
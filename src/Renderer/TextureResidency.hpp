@@ -0,0 +1,51 @@
+#pragma once
+
+// NOTE(boti): The streaming state of a texture, the Vulkan objects are kept separately by the texture_manager (see TextureManager.hpp).
+// Textures in the cache have a non-zero PageCount while they have an image,
+// persistent textures live in their own arena and never have pages.
+struct renderer_texture
+{
+    // NOTE(boti): Mips that are never evicted (up to 128x128)
+    static constexpr u32 AlwaysResidentMips = 0xFFu;
+    // NOTE(boti): Highest resident mips that have been sampled in the last MinEvictionAge frames are never evicted
+    static constexpr u32 MinEvictionAge = 64;
+
+    texture_flags       Flags;
+    renderer_texture_id PlaceholderID;
+    texture_info        Info;
+
+    u32 MipResidencyMask;
+    u32 LastMipAccess;
+    u32 LastUsedFrame; // NOTE(boti): Last frame the highest resident mip was sampled in
+
+    umm PageIndex;
+    umm PageCount;
+};
+
+// NOTE(boti): Updates the access info of the texture from the mip feedback of the frame
+internal void
+UpdateTextureAccess(renderer_texture* Texture, u32 MipFeedback, u32 FrameIndex);
+
+// NOTE(boti): Updates the access info of the textures from the mip feedback of a frame,
+// and returns the (non-persistent) textures that were sampled along with their feedback.
+// SampledTextureBits has a bit for each texture with a non-zero LastMipAccess, those have to be visited even when they weren't sampled.
+// Only the textures that were sampled in this frame or the previous one get visited,
+// the rest of the feedback is skipped 4 entries at a time (64 at a time when none of them were sampled before).
+// The out arrays must be able to hold FeedbackCount elements.
+internal u32
+ProcessMipFeedback(renderer_texture* Textures, u64* SampledTextureBits, const u32* MipFeedbacks, u32 FeedbackCount, u32 FrameIndex, 
+                   u32* OutTextureIndices, u32* OutMips);
+
+// NOTE(boti): Mips of the texture that aren't needed by the last feedback
+internal u32
+GetMipsToEvict(renderer_texture* Texture);
+
+// NOTE(boti): Returns the textures that have evictable mips that weren't sampled in the last MinEvictionAge frames,
+// sorted by how long ago they were last sampled (least recently used first, larger ones first within the same frame)
+internal u32
+GetTextureEvictionCandidates(renderer_texture* Textures, u32 TextureCount, u32 FrameIndex, memory_arena* Arena, u32** OutIndices);
+
+// NOTE(boti): Streaming priority of a texture, primarily based on how many mip levels are missing 
+// compared to what was sampled, and then on the highest sampled mip
+internal u32
+GetTextureRequestPriority(u32 SampledMips, u32 ResidentMips);
@@ -6,9 +6,14 @@ platform_api Platform;
 #include "profiler.cpp"
 
 #include "RenderDevice.cpp"
+#include "GeometryAllocator.cpp"
 #include "Geometry.cpp"
 #include "RenderTarget.cpp"
+#include "TextureCache.cpp"
+#include "TextureResidency.cpp"
 #include "TextureManager.cpp"
+#include "ShadowAtlas.cpp"
+#include "ShadowCache.cpp"
 #include "Pipelines.cpp"
 #include "rhi_vulkan.cpp"
 
@@ -909,7 +914,7 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
         u32 DeviceMemoryIndex = 0;
         u8 ScanResult = BitScanForward(&DeviceMemoryIndex, VK.GPUMemTypes);
         Assert(ScanResult);
-        Renderer->DeviceArena = CreateGPUArena(MiB(128), DeviceMemoryIndex, 0);
+        Renderer->DeviceArena = CreateGPUArena(MiB(224), DeviceMemoryIndex, 0);
 
         gpu_memory_arena* GpuArena = &Renderer->DeviceArena;
         
@@ -937,6 +942,31 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
         }
         Renderer->PerFrameBufferAddress = GetBufferDeviceAddress(VK.Device, Renderer->PerFrameBuffer);
         SetObjectName(VK.Device, Renderer->PerFrameBuffer, "PerFrameBuffer");
+
+        for (u32 FrameIndex = 0; FrameIndex < R_MaxFramesInFlight; FrameIndex++)
+        {
+            PushResult = PushBuffer(GpuArena, Renderer->MaxInstanceCount * sizeof(instance_data),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    &Renderer->InstanceBuffers[FrameIndex]);
+            if (!PushResult)
+            {
+                ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to push Instance buffer");
+            }
+            Renderer->InstanceBufferAddresses[FrameIndex] = GetBufferDeviceAddress(VK.Device, Renderer->InstanceBuffers[FrameIndex]);
+            SetObjectName(VK.Device, Renderer->InstanceBuffers[FrameIndex], "InstanceBuffer");
+
+            PushResult = PushBuffer(GpuArena, Renderer->MaxInstanceCount * sizeof(VkDrawIndexedIndirectCommand),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT|VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    &Renderer->DrawDataBuffers[FrameIndex]);
+            if (!PushResult)
+            {
+                ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to push DrawData buffer");
+            }
+            Renderer->DrawDataBufferAddresses[FrameIndex] = GetBufferDeviceAddress(VK.Device, Renderer->DrawDataBuffers[FrameIndex]);
+            SetObjectName(VK.Device, Renderer->DrawDataBuffers[FrameIndex], "DrawDataBuffer");
+        }
+
+        Renderer->RetainedScene.NextInstanceIndex = 1;
     }
 
     // Shadow storage
@@ -982,7 +1012,7 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
                     .arrayLayers = R_MaxShadowCascadeCount,
                     .samples = VK_SAMPLE_COUNT_1_BIT,
                     .tiling = VK_IMAGE_TILING_OPTIMAL,
-                    .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT|VK_IMAGE_USAGE_SAMPLED_BIT,
+                    .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT|VK_IMAGE_USAGE_SAMPLED_BIT|VK_IMAGE_USAGE_TRANSFER_DST_BIT,
                     .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
                     .queueFamilyIndexCount = 0,
                     .pQueueFamilyIndices = nullptr,
@@ -1046,65 +1076,90 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
                     ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to push shadow cascade image");
                 }
 
-                // Point shadow maps
-                for (u32 ShadowMapIndex = 0; ShadowMapIndex < R_MaxShadowCount; ShadowMapIndex++)
+                // NOTE(boti): The static layers get rendered to, copied from (into the sampled cascades), 
+                // and copied into when scrolling
+                VkImageCreateInfo CascadeStaticImageInfo = CascadeImageInfo;
+                CascadeStaticImageInfo.arrayLayers = 2 * R_MaxShadowCascadeCount;
+                CascadeStaticImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT|VK_IMAGE_USAGE_TRANSFER_SRC_BIT|VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                Result.ErrorCode = vkCreateImage(VK.Device, &CascadeStaticImageInfo, nullptr, &Renderer->CascadeStaticMap);
+                ReturnOnFailure("Failed to create static shadow cascade image");
+
+                PushResult = PushImage(&Renderer->ShadowArena, Renderer->CascadeStaticMap);
+                if (PushResult)
+                {
+                    for (u32 Layer = 0; Layer < 2 * R_MaxShadowCascadeCount; Layer++)
+                    {
+                        VkImageViewCreateInfo StaticViewInfo = 
+                        {
+                            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                            .pNext = nullptr,
+                            .flags = 0,
+                            .image = Renderer->CascadeStaticMap,
+                            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                            .format = FormatTable[RenderTargetFormatTable[RTFormat_Shadow]],
+                            .components = { VK_COMPONENT_SWIZZLE_IDENTITY },
+                            .subresourceRange = 
+                            {
+                                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                                .baseMipLevel = 0,
+                                .levelCount = 1,
+                                .baseArrayLayer = Layer,
+                                .layerCount = 1,
+                            },
+                        };
+                        Result.ErrorCode = vkCreateImageView(VK.Device, &StaticViewInfo, nullptr, &Renderer->CascadeStaticViews[Layer]);
+                        ReturnOnFailure("Failed to create static shadow cascade layer view");
+                    }
+                }
+                else
                 {
-                    point_shadow_map* ShadowMap = Renderer->PointShadowMaps + ShadowMapIndex;
+                    ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to push static shadow cascade image");
+                }
 
-                    VkImageCreateInfo ImageInfo = 
+                // Point shadow atlas
+                {
+                    // NOTE(boti): The faces of all point shadows are tiles in a single atlas, see shadow_atlas
+                    VkImageCreateInfo AtlasImageInfo = 
                     {
                         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
                         .pNext = nullptr,
-                        .flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
+                        .flags = 0,
                         .imageType = VK_IMAGE_TYPE_2D,
                         .format = FormatTable[RenderTargetFormatTable[RTFormat_Shadow]],
-                        .extent = { R_PointShadowResolution, R_PointShadowResolution, 1 },
+                        .extent = { R_PointShadowAtlasResolution, R_PointShadowAtlasResolution, 1 },
                         .mipLevels = 1,
-                        .arrayLayers = 6,
+                        .arrayLayers = 1,
                         .samples = VK_SAMPLE_COUNT_1_BIT,
                         .tiling = VK_IMAGE_TILING_OPTIMAL,
-                        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT|VK_IMAGE_USAGE_SAMPLED_BIT,
+                        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT|VK_IMAGE_USAGE_SAMPLED_BIT|VK_IMAGE_USAGE_TRANSFER_DST_BIT,
                         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
                         .queueFamilyIndexCount = 0,
                         .pQueueFamilyIndices = nullptr,
                         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
                     };
 
-                    Result.ErrorCode = vkCreateImage(VK.Device, &ImageInfo, nullptr, &ShadowMap->Image);
-                    ReturnOnFailure("Failed to create shadow image");
+                    Result.ErrorCode = vkCreateImage(VK.Device, &AtlasImageInfo, nullptr, &Renderer->PointShadowAtlas);
+                    ReturnOnFailure("Failed to create point shadow atlas");
 
-                    PushResult = PushImage(&Renderer->ShadowArena, ShadowMap->Image);
-                    if (PushResult)
-                    {
-                        VkImageViewCreateInfo ViewInfo = 
-                        {
-                            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-                            .pNext = nullptr,
-                            .flags = 0,
-                            .image = ShadowMap->Image,
-                            .viewType = VK_IMAGE_VIEW_TYPE_CUBE,
-                            .format = FormatTable[RenderTargetFormatTable[RTFormat_Shadow]],
-                            .components = { VK_COMPONENT_SWIZZLE_IDENTITY },
-                            .subresourceRange = 
-                            {
-                                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-                                .baseMipLevel = 0,
-                                .levelCount = 1,
-                                .baseArrayLayer = 0,
-                                .layerCount = 6,
-                            },
-                        };
-                        Result.ErrorCode = vkCreateImageView(VK.Device, &ViewInfo, nullptr, &ShadowMap->CubeView);
-                        ReturnOnFailure("Failed to create shadow image view");
+                    // NOTE(boti): The static atlas has the same layout, it only gets rendered to and copied from
+                    VkImageCreateInfo StaticAtlasImageInfo = AtlasImageInfo;
+                    StaticAtlasImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT|VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                    Result.ErrorCode = vkCreateImage(VK.Device, &StaticAtlasImageInfo, nullptr, &Renderer->PointShadowStaticAtlas);
+                    ReturnOnFailure("Failed to create static point shadow atlas");
 
-                        for (u32 LayerIndex = 0; LayerIndex < 6; LayerIndex++)
+                    VkImage AtlasImages[] = { Renderer->PointShadowAtlas, Renderer->PointShadowStaticAtlas };
+                    VkImageView* AtlasViews[] = { &Renderer->PointShadowAtlasView, &Renderer->PointShadowStaticAtlasView };
+                    for (u32 AtlasIndex = 0; AtlasIndex < CountOf(AtlasImages); AtlasIndex++)
+                    {
+                        PushResult = PushImage(&Renderer->ShadowArena, AtlasImages[AtlasIndex]);
+                        if (PushResult)
                         {
-                            VkImageViewCreateInfo LayerViewInfo = 
+                            VkImageViewCreateInfo ViewInfo = 
                             {
                                 .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
                                 .pNext = nullptr,
                                 .flags = 0,
-                                .image = ShadowMap->Image,
+                                .image = AtlasImages[AtlasIndex],
                                 .viewType = VK_IMAGE_VIEW_TYPE_2D,
                                 .format = FormatTable[RenderTargetFormatTable[RTFormat_Shadow]],
                                 .components = { VK_COMPONENT_SWIZZLE_IDENTITY },
@@ -1113,17 +1168,17 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
                                     .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
                                     .baseMipLevel = 0,
                                     .levelCount = 1,
-                                    .baseArrayLayer = LayerIndex,
+                                    .baseArrayLayer = 0,
                                     .layerCount = 1,
                                 },
                             };
-                            Result.ErrorCode = vkCreateImageView(VK.Device, &LayerViewInfo, nullptr, &ShadowMap->LayerViews[LayerIndex]);
-                            ReturnOnFailure("Failed to create shadow image layer view");
+                            Result.ErrorCode = vkCreateImageView(VK.Device, &ViewInfo, nullptr, AtlasViews[AtlasIndex]);
+                            ReturnOnFailure("Failed to create point shadow atlas view");
+                        }
+                        else
+                        {
+                            ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to push point shadow atlas");
                         }
-                    }
-                    else
-                    {
-                        ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to push shadow image");
                     }
                 }
             }
@@ -1313,8 +1368,8 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
                 .Type = Descriptor_SampledImage,
                 .Binding = Binding_Static_PointShadows,
                 .BaseIndex = 0,
-                .Count = R_MaxShadowCount,
-                .Images = {}, // NOTE(boti): Filled after this array def.
+                .Count = 1,
+                .Images = { { Renderer->PointShadowAtlasView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } },
             },
             {
                 .Type = Descriptor_SampledImage,
@@ -1332,19 +1387,6 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
             },
         };
 
-        for (u32 WriteIndex = 0; WriteIndex < CountOf(Writes); WriteIndex++)
-        {
-            descriptor_write* Write = Writes + WriteIndex;
-            if (Write->Binding == Binding_Static_PointShadows)
-            {
-                for (u32 ShadowIndex = 0; ShadowIndex < R_MaxShadowCount; ShadowIndex++)
-                {
-                    Write->Images[ShadowIndex].View = Renderer->PointShadowMaps[ShadowIndex].CubeView;
-                    Write->Images[ShadowIndex].Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                }
-            }
-        }
-
         UpdateDescriptorBuffer(CountOf(Writes), Writes, Renderer->SetLayouts[Set_Static], Renderer->StaticResourceDescriptorMapping);
     }
 
@@ -1530,7 +1572,7 @@ extern "C" Signature_CreateRenderer(CreateRenderer)
     // Texture Manager
     // TODO(boti): remove this
     Renderer->TextureManager.DescriptorSetLayout = Renderer->SetLayouts[Set_Bindless];
-    if (!CreateTextureManager(&Renderer->TextureManager, Arena, R_TextureMemorySize, VK.GPUMemTypes, Renderer->SetLayouts))
+    if (!CreateTextureManager(&Renderer->TextureManager, Arena, R_TextureMemorySize, R_TextureResidencyBudget, VK.GPUMemTypes, Renderer->SetLayouts))
     {
         ReturnWithFailure(VK_ERROR_UNKNOWN, "Failed to create texture manager");
     }
@@ -2125,6 +2167,264 @@ extern "C" Signature_AllocateGeometry(AllocateGeometry)
     return(Result);
 }
 
+internal void
+MarkInstanceDirty(retained_scene* Scene, u32 InstanceIndex)
+{
+    for (u32 FrameIndex = 0; FrameIndex < R_MaxFramesInFlight; FrameIndex++)
+    {
+        if (!Scene->IsDirty[FrameIndex][InstanceIndex])
+        {
+            Scene->IsDirty[FrameIndex][InstanceIndex] = true;
+            Scene->DirtyLists[FrameIndex][Scene->DirtyCounts[FrameIndex]++] = InstanceIndex;
+        }
+    }
+}
+
+internal void
+RemoveFromGroup(retained_scene* Scene, u32 InstanceIndex)
+{
+    u32 Slot = Scene->GroupSlots[InstanceIndex];
+    if (Slot != Scene->InvalidIndex)
+    {
+        draw_group Group = Scene->Groups[InstanceIndex];
+        u32 LastInstanceIndex = Scene->GroupInstances[Group][--Scene->GroupInstanceCounts[Group]];
+        Scene->GroupInstances[Group][Slot] = LastInstanceIndex;
+        Scene->GroupSlots[LastInstanceIndex] = Slot;
+        Scene->GroupSlots[InstanceIndex] = Scene->InvalidIndex;
+    }
+}
+
+internal void
+UpdateRetainedInstance(renderer* Renderer, const update_instance_cmd* Update)
+{
+    retained_scene* Scene = &Renderer->RetainedScene;
+    u32 InstanceIndex = Update->ID.Value;
+    Assert(IsValid(Update->ID) && InstanceIndex < Scene->NextInstanceIndex);
+
+    // NOTE(boti): Retained instances are the static shadow casters, both the old and the new bounds have to invalidate
+    if (Scene->GroupSlots[InstanceIndex] != Scene->InvalidIndex)
+    {
+        mmbox OldBox = TransformBox(Scene->Transforms[InstanceIndex], Scene->BoundingBoxes[InstanceIndex]);
+        InvalidatePointShadows(&Renderer->PointShadowCache, OldBox);
+        InvalidateCascadeShadows(&Renderer->CascadeShadowCache, OldBox);
+    }
+    mmbox NewBox = TransformBox(Update->Transform, Update->BoundingBox);
+    InvalidatePointShadows(&Renderer->PointShadowCache, NewBox);
+    InvalidateCascadeShadows(&Renderer->CascadeShadowCache, NewBox);
+
+    if (Scene->GroupSlots[InstanceIndex] != Scene->InvalidIndex && Scene->Groups[InstanceIndex] != Update->Group)
+    {
+        RemoveFromGroup(Scene, InstanceIndex);
+    }
+    if (Scene->GroupSlots[InstanceIndex] == Scene->InvalidIndex)
+    {
+        Scene->GroupSlots[InstanceIndex] = Scene->GroupInstanceCounts[Update->Group]++;
+        Scene->GroupInstances[Update->Group][Scene->GroupSlots[InstanceIndex]] = InstanceIndex;
+    }
+    Scene->Groups[InstanceIndex] = Update->Group;
+
+    umm VertexByteOffset = Update->Geometry.VertexBlock->Offset * sizeof(vertex);
+    Scene->Geometries[InstanceIndex] = Update->Geometry;
+    Scene->BoundingBoxes[InstanceIndex] = Update->BoundingBox;
+    Scene->Transforms[InstanceIndex] = Update->Transform;
+    Scene->Instances[InstanceIndex] = 
+    {
+        .Transform = Update->Transform,
+        .VertexBufferAddress = GetDeviceAddress(&Renderer->GeometryBuffer.VertexMemory, VertexByteOffset),
+        .Material = Update->Material,
+    };
+    Scene->IndirectCommands[InstanceIndex] = 
+    {
+        .indexCount = Update->Geometry.IndexBlock->Count,
+        .instanceCount = 1,
+        .firstIndex = Update->Geometry.IndexBlock->Offset,
+        .vertexOffset = 0,
+        .firstInstance = InstanceIndex,
+    };
+
+    MarkInstanceDirty(Scene, InstanceIndex);
+}
+
+internal void
+FreeRetainedInstance(renderer* Renderer, renderer_instance_id ID)
+{
+    retained_scene* Scene = &Renderer->RetainedScene;
+    Assert(IsValid(ID) && ID.Value < Scene->NextInstanceIndex);
+
+    if (Scene->GroupSlots[ID.Value] != Scene->InvalidIndex)
+    {
+        mmbox Box = TransformBox(Scene->Transforms[ID.Value], Scene->BoundingBoxes[ID.Value]);
+        InvalidatePointShadows(&Renderer->PointShadowCache, Box);
+        InvalidateCascadeShadows(&Renderer->CascadeShadowCache, Box);
+    }
+    RemoveFromGroup(Scene, ID.Value);
+    Scene->FreeList[Scene->FreeCount++] = ID.Value;
+}
+
+extern "C" Signature_AllocateInstance(AllocateInstance)
+{
+    renderer_instance_id Result = {};
+
+    retained_scene* Scene = &Renderer->RetainedScene;
+    if (Scene->FreeCount)
+    {
+        Result.Value = Scene->FreeList[--Scene->FreeCount];
+    }
+    else if (Scene->NextInstanceIndex < Scene->MaxInstanceCount)
+    {
+        Result.Value = Scene->NextInstanceIndex++;
+    }
+
+    if (IsValid(Result))
+    {
+        Scene->GroupSlots[Result.Value] = Scene->InvalidIndex;
+    }
+    return(Result);
+}
+
+//
+// Light visibility
+//
+
+// NOTE(boti): Approximate projected radius of the light's sphere of influence,
+// lights that contain the camera get the maximum value
+internal f32 GetLightScreenInfluence(v3 CameraP, f32 FocalLength, v3 LightP, f32 Radius)
+{
+    f32 Distance = VectorLength(LightP - CameraP);
+    f32 Result = FocalLength * Radius / Max(Distance, Radius);
+    return(Result);
+}
+
+// NOTE(boti): Returns a bitmask of the cube faces (CubeLayer_*) whose shadow map can get sampled from inside the frustum.
+// The part of the light's sphere that a face covers is bounded by the face's pyramid (apex at the light, base at Radius),
+// a face can only be skipped if that pyramid is outside the frustum.
+internal u32 GetVisibleCubeFaceMask(const frustum* Frustum, v3 LightP, f32 Radius)
+{
+    u32 Result = 0;
+    for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+    {
+        m3 M = GlobalCubeFaceBases[LayerIndex];
+        v3 Center = LightP + Radius * M.Z;
+        v3 X = Radius * M.X;
+        v3 Y = Radius * M.Y;
+        v3 Points[5] = 
+        {
+            LightP,
+            Center - X - Y,
+            Center + X - Y,
+            Center - X + Y,
+            Center + X + Y,
+        };
+        if (IntersectFrustumConvexHull(Frustum, CountOf(Points), Points))
+        {
+            Result |= (1u << LayerIndex);
+        }
+    }
+    return(Result);
+}
+
+//
+// Draw sorting
+//
+
+// NOTE(boti): Key layout (MSB to LSB):
+//  - 2 bits draw group, the indirect draws have to stay ordered by group (and the group also determines the pipeline)
+//  - 30 bits material (albedo texture ID), opaque groups only. Materials are bindless, but grouping them keeps the texture accesses coherent
+//  - 32 bits view depth, front-to-back for the opaque groups (early-Z), back-to-front for transparent (blending)
+internal u64 MakeDrawSortKey(draw_group Group, const renderer_material* Material, f32 Depth)
+{
+    static_assert(DrawGroup_Count <= 4);
+    static_assert(R_MaxTextureCount <= (1u << 30));
+
+    u64 Result = (u64)Group << 62;
+    if (Group == DrawGroup_Transparent)
+    {
+        Result |= (u64)(~FloatToSortKey(Depth));
+    }
+    else
+    {
+        Result |= (u64)(Material->AlbedoID.Value & ((1u << 30) - 1)) << 32;
+        Result |= (u64)FloatToSortKey(Depth);
+    }
+    return(Result);
+}
+
+struct radix_sort_job
+{
+    radix_sort64* Sort;
+    u32 ChunkIndex;
+    b32 IsScatter;
+
+    u32 Padding[12];
+};
+static_assert(sizeof(radix_sort_job) % 64 == 0);
+
+internal void 
+RadixSortChunk(thread_context* ThreadContext, void* Params)
+{
+    TimedFunctionMT(Platform.Profiler, ThreadContext->ThreadID);
+
+    radix_sort_job* Job = (radix_sort_job*)Params;
+    if (Job->IsScatter)
+    {
+        ScatterRadixSortChunk(Job->Sort, Job->ChunkIndex);
+    }
+    else
+    {
+        CountRadixSortChunk(Job->Sort, Job->ChunkIndex);
+    }
+}
+
+// NOTE(boti): Sorts on the work queue, small arrays are sorted on the calling thread
+internal void 
+ParallelRadixSort64(u32 Count, u64* Keys, u32* Values, thread_context* ThreadContext, memory_arena* Arena)
+{
+    TimedFunction(Platform.Profiler);
+
+    constexpr u32 MinChunkSize = 1u << 15;
+    constexpr u32 MaxChunkCount = 64;
+
+    memory_arena_checkpoint Checkpoint = ArenaCheckpoint(Arena);
+    u64* TempKeys = PushArray(Arena, 0, u64, Count);
+    u32* TempValues = PushArray(Arena, 0, u32, Count);
+
+    u32 ChunkCount = Min(Max(Count / MinChunkSize, 1u), MaxChunkCount);
+    if (ChunkCount == 1)
+    {
+        RadixSort64(Count, Keys, Values, TempKeys, TempValues);
+    }
+    else
+    {
+        u32 (*ChunkOffsets)[radix_sort64::DigitCount] = 
+            (u32 (*)[radix_sort64::DigitCount])PushSize_(Arena, 0, ChunkCount * sizeof(*ChunkOffsets), alignof(u32));
+        radix_sort_job* Jobs = PushArray(Arena, 0, radix_sort_job, ChunkCount);
+        radix_sort64 Sort = BeginRadixSort64(Count, Keys, Values, TempKeys, TempValues, ChunkCount, ChunkOffsets);
+        for (u32 Pass = 0; Pass < radix_sort64::PassCount; Pass++)
+        {
+            for (u32 ChunkIndex = 0; ChunkIndex < ChunkCount; ChunkIndex++)
+            {
+                Jobs[ChunkIndex] = { .Sort = &Sort, .ChunkIndex = ChunkIndex, .IsScatter = false };
+                Platform.AddWorkEntry(Platform.Queue, RadixSortChunk, Jobs + ChunkIndex);
+            }
+            Platform.CompleteAllWork(Platform.Queue, ThreadContext);
+
+            if (PrefixRadixSortPass(&Sort))
+            {
+                for (u32 ChunkIndex = 0; ChunkIndex < ChunkCount; ChunkIndex++)
+                {
+                    Jobs[ChunkIndex].IsScatter = true;
+                    Platform.AddWorkEntry(Platform.Queue, RadixSortChunk, Jobs + ChunkIndex);
+                }
+                Platform.CompleteAllWork(Platform.Queue, ThreadContext);
+            }
+            EndRadixSortPass(&Sort);
+        }
+        EndRadixSort64(&Sort);
+    }
+
+    RestoreArena(Arena, Checkpoint);
+}
+
 extern "C" Signature_BeginRenderFrame(BeginRenderFrame)
 {
     TimedFunction(Platform.Profiler);
@@ -2146,20 +2446,35 @@ extern "C" Signature_BeginRenderFrame(BeginRenderFrame)
     // Reset buffers
     {
         Frame->StagingBuffer.At = 0;
+        Frame->UploadByteCount = 0;
 
         Frame->BARBufferSize = Renderer->BARBufferSize;
         Frame->BARBufferAt = 0;
         Frame->BARBufferBase = Renderer->BARBufferMappings[FrameID];
 
-        Frame->CommandCount = 0;
-        Frame->Commands = PushArray(Arena, 0, render_command, Frame->MaxCommandCount);
+        Frame->TransferCount = 0;
+        Frame->Transfers = PushArray(Arena, 0, transfer_command, Frame->MaxTransferCount);
+        Frame->DrawCount = 0;
+        Frame->Draws = PushArray(Arena, 0, draw_command, Frame->MaxDrawCount);
+        Frame->InstanceUpdateCount = 0;
+        Frame->InstanceUpdates = PushArray(Arena, 0, update_instance_cmd, Frame->MaxInstanceUpdateCount);
+        Frame->InstanceFreeCount = 0;
+        Frame->InstanceFrees = PushArray(Arena, 0, renderer_instance_id, Frame->MaxInstanceFreeCount);
+        Frame->GeometryFreeCount = 0;
+        Frame->GeometryFrees = PushArray(Arena, 0, geometry_buffer_allocation, Frame->MaxGeometryFreeCount);
+        Frame->LightCount = 0;
+        Frame->Lights = PushArray(Arena, 0, light, Frame->MaxLightCount);
+        Frame->ParticleBatchCount = 0;
+        Frame->ParticleBatches = PushArray(Arena, 0, particle_batch, Frame->MaxParticleBatchCount);
+        Frame->Widget3DCount = 0;
+        Frame->Widget3Ds = PushArray(Arena, 0, draw_widget3d_cmd, Frame->MaxWidget3DCount);
+        Frame->Batch2DCount = 0;
+        Frame->Batch2Ds = PushArray(Arena, 0, draw_batch_2d, Frame->MaxBatch2DCount);
         for (u32 GroupIndex = 0; GroupIndex < DrawGroup_Count; GroupIndex++)
         {
             Frame->DrawGroupDrawCounts[GroupIndex] = 0;
         }
-        Frame->LastBatch2D = nullptr;
 
-        Frame->LightCount = 0;
         Frame->ShadowCount = 0;
         
         Frame->UniformData = Renderer->PerFrameUniformBufferMappings[FrameID];
@@ -2184,6 +2499,8 @@ extern "C" Signature_BeginRenderFrame(BeginRenderFrame)
         vkResetCommandPool(VK.Device, Renderer->ComputeCmdPools[FrameID], 0);
     }
     ProcessDeletionEntries(&Renderer->DeletionQueue, FrameID);
+    ReleasePendingGeometry(&Renderer->GeometryBuffer, FrameID);
+    ReleasePendingTexturePages(&Renderer->TextureManager.Cache, FrameID);
 
     // Perf readback
     {
@@ -2222,32 +2539,20 @@ extern "C" Signature_BeginRenderFrame(BeginRenderFrame)
 
         texture_manager* Manager = &Renderer->TextureManager;
         
-        u32 SampledTextureCount = 0;
-        u32* SampledTextureMips = PushArray(Frame->Arena, 0, u32, Manager->TextureCount);
-        u32* SampledTextureIndices = PushArray(Frame->Arena, 0, u32, Manager->TextureCount);
+        // NOTE(boti): Only the feedback of the textures that existed when the frame was recorded gets read back
+        u32 FeedbackCount = Renderer->MipReadbackCounts[FrameID];
+        u32* SampledTextureMips = PushArray(Frame->Arena, 0, u32, FeedbackCount);
+        u32* SampledTextureIndices = PushArray(Frame->Arena, 0, u32, FeedbackCount);
 
         u32* MipFeedbacks = (u32*)Renderer->MipReadbackMappings[FrameID];
-        for (u32 TextureIndex = 0; TextureIndex < R_MaxTextureCount; TextureIndex++)
-        {
-            if (TextureIndex >= Manager->TextureCount)
-            {
-                break;
-            }
-
-            u32 MipFeedback = MipFeedbacks[TextureIndex];
-            renderer_texture* Texture = Manager->Textures + TextureIndex;
-            if (!(Texture->Flags & TextureFlag_PersistentMemory))
-            {
-                Texture->LastMipAccess = MipFeedback;
-                if (MipFeedback)
-                {
-                    u32 Index = SampledTextureCount++;
-                    SampledTextureMips[Index] = MipFeedbacks[TextureIndex];
-                    SampledTextureIndices[Index] = TextureIndex;
-                }
-            }
-        }
+        Assert(FeedbackCount <= Manager->TextureCount);
+        u32 SampledTextureCount = ProcessMipFeedback(Manager->Textures, Manager->SampledTextureBits, MipFeedbacks, FeedbackCount, 
+                                                     (u32)Renderer->CurrentFrameID, SampledTextureIndices, SampledTextureMips);
         
+        // NOTE(boti): Only the low resolution mips get streamed in while over budget,
+        // the rest are requested again once eviction has made room for them
+        b32 IsOverBudget = GetResidentPageCount(&Manager->Cache) > Manager->Cache.BudgetPageCount;
+
         Frame->TextureRequestCount = 0;
         Frame->TextureRequests = PushArray(Frame->Arena, 0, texture_request, SampledTextureCount);
         for (u32 RequestCandidateIndex = 0; RequestCandidateIndex < SampledTextureCount; RequestCandidateIndex++)
@@ -2260,9 +2565,18 @@ extern "C" Signature_BeginRenderFrame(BeginRenderFrame)
             u32 CurrentMips = Manager->Textures[TextureIndex].MipResidencyMask;
             // NOTE(boti): Only request mips that are not present
             u32 RequestedMips = SampledMips & (~CurrentMips);
+            if (IsOverBudget)
+            {
+                RequestedMips &= renderer_texture::AlwaysResidentMips;
+            }
             if (RequestedMips)
             {
-                Frame->TextureRequests[Frame->TextureRequestCount++] = { { TextureIndex }, RequestedMips };
+                Frame->TextureRequests[Frame->TextureRequestCount++] = 
+                {
+                    .TextureID = { TextureIndex },
+                    .MipMask = RequestedMips,
+                    .Priority = GetTextureRequestPriority(SampledMips, CurrentMips),
+                };
             }
         }
     }
@@ -2279,6 +2593,9 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
     {
         vkDeviceWaitIdle(Renderer->Vulkan.Device);
         CreatePipelines(Renderer, Frame->Arena);
+        // NOTE(boti): The shadow shaders might've changed
+        InvalidateAllPointShadows(&Renderer->PointShadowCache);
+        InvalidateAllCascadeShadows(&Renderer->CascadeShadowCache);
     }
 
     // Acquire image
@@ -2425,21 +2742,7 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
             0.0f,  0.0f,     1.0f / (-f*n*r), 1.0f / n);
         #endif
 
-        f32 g2 = g*g;
-        f32 mx = 1.0f / Sqrt(g2 + s*s);
-        f32 my = 1.0f / Sqrt(g2 + 1.0f);
-        f32 gmx = g*mx;
-        f32 gmy = g*my;
-        f32 smx = s*mx;
-        Frame->CameraFrustum = 
-        {
-            .Left   = v4{ -gmx, 0.0f, smx, 0.0f } * Frame->ViewTransform,
-            .Right  = v4{ +gmx, 0.0f, smx, 0.0f } * Frame->ViewTransform,
-            .Top    = v4{ 0.0f, -gmy,  my, 0.0f } * Frame->ViewTransform,
-            .Bottom = v4{ 0.0f, +gmy,  my, 0.0f } * Frame->ViewTransform,
-            .Near   = v4{ 0.0f, 0.0f, +1.0f, -n } * Frame->ViewTransform,
-            .Far    = v4{ 0.0f, 0.0f,  0.0f, 0.0f } * Frame->ViewTransform,
-        };
+        Frame->CameraFrustum = GetCameraFrustum(Frame->ViewTransform, g, s, n);
 
         Frame->Uniforms.CameraTransform = Frame->CameraTransform;
         Frame->Uniforms.ViewTransform = Frame->ViewTransform;
@@ -2475,7 +2778,7 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
             .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = Renderer->TextureManager.Textures[0].ImageHandle,
+            .image = Renderer->TextureManager.Images[0].ImageHandle,
             .subresourceRange =
             {
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -2503,7 +2806,7 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
             .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = Renderer->TextureManager.Textures[0].ImageHandle,
+            .image = Renderer->TextureManager.Images[0].ImageHandle,
             .subresourceRange =
             {
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -2518,236 +2821,166 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
     }
 
     //
-    // Discard unused mip levels
+    // Evict mips
     //
-    // TODO(boti): Build an actual LRU and only discard mips when we can't fit new ones anymore
-    umm PageUsageLimit = Renderer->TextureManager.Cache.PageCount - (Renderer->TextureManager.Cache.PageCount / 8);
-    if (Renderer->TextureManager.Cache.UsedPageCount > PageUsageLimit)
+    if (UpdateTextureBudget(&Renderer->TextureManager.Cache))
     {
-        TimedBlock(Platform.Profiler, "Mip discard");
+        TimedBlock(Platform.Profiler, "Mip eviction");
 
         texture_manager* Manager = &Renderer->TextureManager;
-        for (u32 TextureIndex = 0; TextureIndex < Manager->TextureCount; TextureIndex++)
+        u32* Candidates = nullptr;
+        u32 CandidateCount = GetTextureEvictionCandidates(Manager->Textures, Manager->TextureCount, (u32)Renderer->CurrentFrameID, Frame->Arena, &Candidates);
+        u32 EvictionCount = 0;
+        for (u32 CandidateIndex = 0; CandidateIndex < CandidateCount; CandidateIndex++)
         {
-            renderer_texture* Texture = Manager->Textures + TextureIndex;
-            if (!(Texture->Flags & TextureFlag_PersistentMemory) && Texture->MipResidencyMask)
+            if (!Manager->Cache.IsOverBudget ||
+                (EvictionCount == Manager->MaxEvictionCountPerFrame) ||
+                (Manager->Cache.PendingFreeCounts[Frame->FrameID] == Manager->Cache.MaxPendingFreeCount))
             {
-                constexpr u32 AlwaysKeptMips = 0xFF;
-                u32 LastMipAccess = SetBitsBelowHighInclusive(Texture->LastMipAccess);
+                break;
+            }
 
-                u32 UsedMips = Texture->MipResidencyMask & (LastMipAccess | AlwaysKeptMips);
-                u32 DiscardMips = (~UsedMips) & Texture->MipResidencyMask;
-                if (DiscardMips)
-                {
-                    // TODO(boti): We have a bunch of these asserts in the codebase, 
-                    // should we just make it a rule that streamed textures can't be arrays?
-                    if (Texture->Info.ArrayCount != 1)
-                    {
-                        UnimplementedCodePath;
-                    }
+            u32 TextureIndex = Candidates[CandidateIndex];
+            renderer_texture* Texture = Manager->Textures + TextureIndex;
+            renderer_texture_image* TextureImage = Manager->Images + TextureIndex;
 
-                    u32 CurrentMipCount = CountSetBits(Texture->MipResidencyMask);
-                    u32 MipCountToDiscard = CountSetBits(DiscardMips);
-                    if (CurrentMipCount == MipCountToDiscard)
+            u32 DiscardMips = GetMipsToEvict(Texture);
+            u32 UsedMips = Texture->MipResidencyMask & (~DiscardMips);
+            if (DiscardMips)
+            {
+                u32 CurrentMipCount = CountSetBits(Texture->MipResidencyMask);
+                u32 MipCountToDiscard = CountSetBits(DiscardMips);
+                if (CurrentMipCount == MipCountToDiscard)
+                {
+                    renderer_texture_image* Placeholder = GetTextureImage(Manager, Texture->PlaceholderID);
+                    umm DescriptorSize = VK.DescriptorBufferProps.sampledImageDescriptorSize;
+                    if ((Frame->StagingBuffer.At + DescriptorSize) <= Frame->StagingBuffer.Size)
                     {
-                        renderer_texture* Placeholder = GetTexture(Manager, Texture->PlaceholderID);
-                        umm DescriptorSize = VK.DescriptorBufferProps.sampledImageDescriptorSize;
-                        if ((Frame->StagingBuffer.At + DescriptorSize) <= Frame->StagingBuffer.Size)
+                        VkDescriptorImageInfo DescriptorImage = 
                         {
-                            VkDescriptorImageInfo DescriptorImage = 
-                            {
-                                .sampler = VK_NULL_HANDLE,
-                                .imageView = Placeholder->ViewHandle,
-                                .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
-                            };
-                            VkDescriptorGetInfoEXT DescriptorInfo = 
-                            {
-                                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
-                                .pNext = nullptr,
-                                .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                                .data = { .pSampledImage = &DescriptorImage },
-                            };
-                            vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At));
-                                
-                            umm DescriptorOffset = Manager->TextureTableOffset + TextureIndex*DescriptorSize;
-                            VkBufferCopy DescriptorCopy = 
-                            {
-                                .srcOffset = Frame->StagingBuffer.At,
-                                .dstOffset = DescriptorOffset,
-                                .size = DescriptorSize,
-                            };
-                            vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->TextureManager.DescriptorBuffer, 1, &DescriptorCopy);
-                                
-                            Frame->StagingBuffer.At += DescriptorSize;
-                                
-                            MarkPagesAsFree(&Manager->Cache, Texture->PageIndex, Texture->PageCount);
-                            Texture->PageIndex = 0;
-                            Texture->PageCount = 0;
-                            Texture->MipResidencyMask = 0;
-                            PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, Texture->ImageHandle);
-                            PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, Texture->ViewHandle);
-                            Texture->ImageHandle = VK_NULL_HANDLE;
-                            Texture->ViewHandle = VK_NULL_HANDLE;
-                        }
-                        else
+                            .sampler = VK_NULL_HANDLE,
+                            .imageView = Placeholder->ViewHandle,
+                            .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+                        };
+                        VkDescriptorGetInfoEXT DescriptorInfo = 
                         {
-                            UnhandledError("Out of staging memory (for texture descriptor)");
-                        }
+                            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+                            .pNext = nullptr,
+                            .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                            .data = { .pSampledImage = &DescriptorImage },
+                        };
+                        vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At));
+                            
+                        umm DescriptorOffset = Manager->TextureTableOffset + TextureIndex*DescriptorSize;
+                        VkBufferCopy DescriptorCopy = 
+                        {
+                            .srcOffset = Frame->StagingBuffer.At,
+                            .dstOffset = DescriptorOffset,
+                            .size = DescriptorSize,
+                        };
+                        vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->TextureManager.DescriptorBuffer, 1, &DescriptorCopy);
+                            
+                        Frame->StagingBuffer.At += DescriptorSize;
+                            
+                        PushPendingPageFree(&Manager->Cache, Frame->FrameID, Texture->PageIndex, Texture->PageCount);
+                        Texture->PageIndex = 0;
+                        Texture->PageCount = 0;
+                        Texture->MipResidencyMask = 0;
+                        PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, TextureImage->ImageHandle);
+                        PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, TextureImage->ViewHandle);
+                        TextureImage->ImageHandle = VK_NULL_HANDLE;
+                        TextureImage->ViewHandle = VK_NULL_HANDLE;
+
+                        EvictionCount++;
+                        UpdateTextureBudget(&Manager->Cache);
                     }
                     else
                     {
-                        // NOTE(boti): Because we're always discarding a contiguous range we can just use the bit count to iterate
-                        texture_info Info = 
+                        UnhandledError("Out of staging memory (for texture descriptor)");
+                    }
+                }
+                else
+                {
+                    // NOTE(boti): Because we're always discarding a contiguous range we can just use the bit count to iterate
+                    texture_info Info = 
+                    {
+                        .Extent = 
                         {
-                            .Extent = 
-                            {
-                                Max(Texture->Info.Extent.X >> MipCountToDiscard, 1u),
-                                Max(Texture->Info.Extent.Y >> MipCountToDiscard, 1u),
-                                1,
-                            },
-                            .MipCount = CurrentMipCount - MipCountToDiscard,
-                            .ArrayCount = Texture->Info.ArrayCount,
-                            .Format = Texture->Info.Format,
-                            .Swizzle = Texture->Info.Swizzle,
-                        };
+                            Max(Texture->Info.Extent.X >> MipCountToDiscard, 1u),
+                            Max(Texture->Info.Extent.Y >> MipCountToDiscard, 1u),
+                            1,
+                        },
+                        .MipCount = CurrentMipCount - MipCountToDiscard,
+                        .ArrayCount = Texture->Info.ArrayCount,
+                        .Format = Texture->Info.Format,
+                        .Swizzle = Texture->Info.Swizzle,
+                    };
 
-                        VkImageCreateInfo ImageInfo = TextureInfoToVulkan(Info);
-                        VkImage ImageHandle = VK_NULL_HANDLE;
-                        VkResult ErrorCode = vkCreateImage(VK.Device, &ImageInfo, nullptr, &ImageHandle);
-                        if (ErrorCode == VK_SUCCESS)
+                    VkImageCreateInfo ImageInfo = TextureInfoToVulkan(Info);
+                    VkImage ImageHandle = VK_NULL_HANDLE;
+                    VkResult ErrorCode = vkCreateImage(VK.Device, &ImageInfo, nullptr, &ImageHandle);
+                    if (ErrorCode == VK_SUCCESS)
+                    {
+                        umm PageIndex, PageCount;
+                        if (AllocateImage(Manager, ImageHandle, &PageIndex, &PageCount))
                         {
-                            umm PageIndex, PageCount;
-                            if (AllocateImage(&Manager->Cache, ImageHandle, &PageIndex, &PageCount))
+                            VkImageViewCreateInfo ViewInfo = 
                             {
-                                VkImageViewCreateInfo ViewInfo = 
+                                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                .pNext = nullptr,
+                                .flags = 0,
+                                .image = ImageHandle,
+                                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                .format = ImageInfo.format,
+                                .components = SwizzleToVulkan(Info.Swizzle),
+                                .subresourceRange = 
+                                {
+                                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    .baseMipLevel = 0,
+                                    .levelCount = VK_REMAINING_MIP_LEVELS,
+                                    .baseArrayLayer = 0,
+                                    .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                                },
+                            };
+                            VkImageView ViewHandle = VK_NULL_HANDLE;
+                            ErrorCode = vkCreateImageView(VK.Device, &ViewInfo, nullptr, &ViewHandle);
+                            if (ErrorCode == VK_SUCCESS)
+                            {
+                                VkImageMemoryBarrier2 BeginBarriers[] = 
                                 {
-                                    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-                                    .pNext = nullptr,
-                                    .flags = 0,
-                                    .image = ImageHandle,
-                                    .viewType = VK_IMAGE_VIEW_TYPE_2D,
-                                    .format = ImageInfo.format,
-                                    .components = SwizzleToVulkan(Info.Swizzle),
-                                    .subresourceRange = 
                                     {
-                                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                        .baseMipLevel = 0,
-                                        .levelCount = VK_REMAINING_MIP_LEVELS,
-                                        .baseArrayLayer = 0,
-                                        .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                                    },
-                                };
-                                VkImageView ViewHandle = VK_NULL_HANDLE;
-                                ErrorCode = vkCreateImageView(VK.Device, &ViewInfo, nullptr, &ViewHandle);
-                                if (ErrorCode == VK_SUCCESS)
-                                {
-                                    VkImageMemoryBarrier2 BeginBarriers[] = 
-                                    {
-                                        {
-                                            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                                            .pNext = nullptr,
-                                            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-                                            .srcAccessMask = VK_ACCESS_2_NONE,
-                                            .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
-                                            .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                                            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                                            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                            .image = ImageHandle,
-                                            .subresourceRange = 
-                                            {
-                                                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                                .baseMipLevel = 0,
-                                                .levelCount = VK_REMAINING_MIP_LEVELS,
-                                                .baseArrayLayer = 0,
-                                                .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                                            },
-                                        },
-                                        {
-                                            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                                            .pNext = nullptr,
-                                            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-                                            .srcAccessMask = VK_ACCESS_2_NONE,
-                                            .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
-                                            .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
-                                            .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                            .image = Texture->ImageHandle,
-                                            .subresourceRange = 
-                                            {
-                                                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                                .baseMipLevel = 0,
-                                                .levelCount = VK_REMAINING_MIP_LEVELS,
-                                                .baseArrayLayer = 0,
-                                                .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                                            },
-                                        },
-                                    };
-
-                                    VkDependencyInfo BeginDependency = 
-                                    {
-                                        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
                                         .pNext = nullptr,
-                                        .dependencyFlags = 0,
-                                        .imageMemoryBarrierCount = CountOf(BeginBarriers),
-                                        .pImageMemoryBarriers = BeginBarriers,
-                                    };
-
-                                    vkCmdPipelineBarrier2(UploadCB, &BeginDependency);
-
-                                    constexpr u32 MaxCopyCount = 32;
-                                    VkImageCopy CopyRegions[MaxCopyCount];
-                                    for (u32 DstMipIndex = 0; DstMipIndex < Info.MipCount; DstMipIndex++)
-                                    {
-                                        u32 SrcMipIndex = DstMipIndex + MipCountToDiscard;
-                                        CopyRegions[DstMipIndex] = 
+                                        .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                                        .srcAccessMask = VK_ACCESS_2_NONE,
+                                        .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                        .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                                        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                        .image = ImageHandle,
+                                        .subresourceRange = 
                                         {
-                                            .srcSubresource = 
-                                            {
-                                                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                                .mipLevel = SrcMipIndex,
-                                                .baseArrayLayer = 0,
-                                                .layerCount = 1,
-                                            },
-                                            .srcOffset = { 0, 0, 0 },
-                                            .dstSubresource = 
-                                            {
-                                                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                                .mipLevel = DstMipIndex,
-                                                .baseArrayLayer = 0,
-                                                .layerCount = 1,
-                                            },
-                                            .dstOffset = { 0, 0, 0 },
-                                            .extent = 
-                                            {
-                                                .width = Max(Info.Extent.X >> DstMipIndex, 1u),
-                                                .height = Max(Info.Extent.Y >> DstMipIndex, 1u),
-                                                .depth = 1,
-                                            },
-                                        };
-                                    }
-                                    
-                                    vkCmdCopyImage(UploadCB, 
-                                                   Texture->ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                                   ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                                   Info.MipCount, CopyRegions);
-
-                                    VkImageMemoryBarrier2 EndBarrier = 
+                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                            .baseMipLevel = 0,
+                                            .levelCount = VK_REMAINING_MIP_LEVELS,
+                                            .baseArrayLayer = 0,
+                                            .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                                        },
+                                    },
                                     {
                                         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
                                         .pNext = nullptr,
-                                        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
-                                        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                                        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                                        .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
-                                        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                        .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                                        .srcAccessMask = VK_ACCESS_2_NONE,
+                                        .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                        .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+                                        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                                         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                                         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                        .image = ImageHandle,
+                                        .image = TextureImage->ImageHandle,
                                         .subresourceRange = 
                                         {
                                             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -2756,72 +2989,149 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
                                             .baseArrayLayer = 0,
                                             .layerCount = VK_REMAINING_ARRAY_LAYERS,
                                         },
-                                    };
-                                    PushBeginBarrier(&FrameStages[FrameStage_Prepass], &EndBarrier);
+                                    },
+                                };
 
-                                    // TODO(boti): Deduplicate descriptor creation code
-                                    umm DescriptorSize = VK.DescriptorBufferProps.sampledImageDescriptorSize;
-                                    if ((Frame->StagingBuffer.At + DescriptorSize) <= Frame->StagingBuffer.Size)
+                                VkDependencyInfo BeginDependency = 
+                                {
+                                    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .pNext = nullptr,
+                                    .dependencyFlags = 0,
+                                    .imageMemoryBarrierCount = CountOf(BeginBarriers),
+                                    .pImageMemoryBarriers = BeginBarriers,
+                                };
+
+                                vkCmdPipelineBarrier2(UploadCB, &BeginDependency);
+
+                                constexpr u32 MaxCopyCount = 32;
+                                VkImageCopy CopyRegions[MaxCopyCount];
+                                for (u32 DstMipIndex = 0; DstMipIndex < Info.MipCount; DstMipIndex++)
+                                {
+                                    u32 SrcMipIndex = DstMipIndex + MipCountToDiscard;
+                                    CopyRegions[DstMipIndex] = 
                                     {
-                                        VkDescriptorImageInfo DescriptorImage = 
+                                        .srcSubresource = 
                                         {
-                                            .sampler = VK_NULL_HANDLE,
-                                            .imageView = ViewHandle,
-                                            .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
-                                        };
-                                        VkDescriptorGetInfoEXT DescriptorInfo = 
+                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                            .mipLevel = SrcMipIndex,
+                                            .baseArrayLayer = 0,
+                                            .layerCount = 1,
+                                        },
+                                        .srcOffset = { 0, 0, 0 },
+                                        .dstSubresource = 
                                         {
-                                            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
-                                            .pNext = nullptr,
-                                            .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                                            .data = { .pSampledImage = &DescriptorImage },
-                                        };
-                                        vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At));
-                                
-                                        umm DescriptorOffset = Manager->TextureTableOffset + TextureIndex*DescriptorSize;
-                                        VkBufferCopy DescriptorCopy = 
+                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                            .mipLevel = DstMipIndex,
+                                            .baseArrayLayer = 0,
+                                            .layerCount = 1,
+                                        },
+                                        .dstOffset = { 0, 0, 0 },
+                                        .extent = 
                                         {
-                                            .srcOffset = Frame->StagingBuffer.At,
-                                            .dstOffset = DescriptorOffset,
-                                            .size = DescriptorSize,
-                                        };
-                                        vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->TextureManager.DescriptorBuffer, 1, &DescriptorCopy);
-                                        Frame->StagingBuffer.At += DescriptorSize;
+                                            .width = Max(Info.Extent.X >> DstMipIndex, 1u),
+                                            .height = Max(Info.Extent.Y >> DstMipIndex, 1u),
+                                            .depth = 1,
+                                        },
+                                    };
+                                }
                                 
-                                        MarkPagesAsFree(&Manager->Cache, Texture->PageIndex, Texture->PageCount);
-
-                                        Texture->PageIndex = PageIndex;
-                                        Texture->PageCount = PageCount;
-                                        Texture->MipResidencyMask = UsedMips;
-                                        Texture->Info = Info;
-                                        PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, Texture->ImageHandle);
-                                        PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, Texture->ViewHandle);
-                                        Texture->ImageHandle = ImageHandle;
-                                        Texture->ViewHandle = ViewHandle;
-                                    }
-                                    else
+                                vkCmdCopyImage(UploadCB, 
+                                               TextureImage->ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                               ImageHandle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                               Info.MipCount, CopyRegions);
+
+                                VkImageMemoryBarrier2 EndBarrier = 
+                                {
+                                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                    .pNext = nullptr,
+                                    .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                    .dstStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                    .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+                                    .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                    .image = ImageHandle,
+                                    .subresourceRange = 
+                                    {
+                                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                        .baseMipLevel = 0,
+                                        .levelCount = VK_REMAINING_MIP_LEVELS,
+                                        .baseArrayLayer = 0,
+                                        .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                                    },
+                                };
+                                PushBeginBarrier(&FrameStages[FrameStage_Prepass], &EndBarrier);
+
+                                // TODO(boti): Deduplicate descriptor creation code
+                                umm DescriptorSize = VK.DescriptorBufferProps.sampledImageDescriptorSize;
+                                if ((Frame->StagingBuffer.At + DescriptorSize) <= Frame->StagingBuffer.Size)
+                                {
+                                    VkDescriptorImageInfo DescriptorImage = 
+                                    {
+                                        .sampler = VK_NULL_HANDLE,
+                                        .imageView = ViewHandle,
+                                        .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+                                    };
+                                    VkDescriptorGetInfoEXT DescriptorInfo = 
+                                    {
+                                        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+                                        .pNext = nullptr,
+                                        .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                                        .data = { .pSampledImage = &DescriptorImage },
+                                    };
+                                    vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At));
+                            
+                                    umm DescriptorOffset = Manager->TextureTableOffset + TextureIndex*DescriptorSize;
+                                    VkBufferCopy DescriptorCopy = 
                                     {
-                                        UnhandledError("Out of staging memory (for texture descriptor)");
-                                    }
+                                        .srcOffset = Frame->StagingBuffer.At,
+                                        .dstOffset = DescriptorOffset,
+                                        .size = DescriptorSize,
+                                    };
+                                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->TextureManager.DescriptorBuffer, 1, &DescriptorCopy);
+                                    Frame->StagingBuffer.At += DescriptorSize;
+                            
+                                    PushPendingPageFree(&Manager->Cache, Frame->FrameID, Texture->PageIndex, Texture->PageCount);
+
+                                    Texture->PageIndex = PageIndex;
+                                    Texture->PageCount = PageCount;
+                                    Texture->MipResidencyMask = UsedMips;
+                                    Texture->Info = Info;
+                                    PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, TextureImage->ImageHandle);
+                                    PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, TextureImage->ViewHandle);
+                                    TextureImage->ImageHandle = ImageHandle;
+                                    TextureImage->ViewHandle = ViewHandle;
+                                    // NOTE(boti): The new highest mip is either in the last feedback or always resident,
+                                    // restarting its clock keeps the texture from getting evicted again right away
+                                    Texture->LastUsedFrame = (u32)Renderer->CurrentFrameID;
+
+                                    EvictionCount++;
+                                    UpdateTextureBudget(&Manager->Cache);
                                 }
                                 else
                                 {
-                                    UnhandledError("Failed to create image view when discarding unused mips");
+                                    UnhandledError("Out of staging memory (for texture descriptor)");
                                 }
                             }
                             else
                             {
-                                // TODO(boti): Actual logging
-                                Platform.DebugPrint("Failed to allocate memory when discarding unused mip levels\n");
-                                
+                                UnhandledError("Failed to create image view when discarding unused mips");
                             }
                         }
                         else
                         {
                             // TODO(boti): Actual logging
-                            Platform.DebugPrint("Failed to create image when discarding unused mip levels\n");
+                            Platform.DebugPrint("Failed to allocate memory when discarding unused mip levels\n");
+                            
                         }
                     }
+                    else
+                    {
+                        // TODO(boti): Actual logging
+                        Platform.DebugPrint("Failed to create image when discarding unused mip levels\n");
+                    }
                 }
             }
         }
@@ -2864,19 +3174,38 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
     gpu_buffer_range TileBufferRange = PushPerFrame(TileCountX * TileCountY * sizeof(screen_tile));
     Frame->Uniforms.TileBufferAddress = TileBufferRange.Address;
 
+    // NOTE(boti): Filled by SetupSceneRendering() once the retained instances have been updated,
+    // so that this frame's changes already invalidate the cached cascades
     frustum CascadeFrustums[R_MaxShadowCascadeCount];
-    SetupSceneRendering(Frame, CascadeFrustums);
+    frustum StaticCascadeFrustums[2 * R_MaxShadowCascadeCount];
+    cascade_shadow_update CascadeUpdates[R_MaxShadowCascadeCount];
 
     //
     // Process commands
     //
     draw_list PrimaryDrawList = {};
+    // NOTE(boti): The cascade lists only contain the immediate draws, the static lists (indexed by 2*CascadeIndex + StripIndex)
+    // only the retained ones, and they're only built for the cascades that get updated
     draw_list CascadeDrawLists[R_MaxShadowCascadeCount] = {};
+    draw_list StaticCascadeDrawLists[2 * R_MaxShadowCascadeCount] = {};
+    constexpr u32 StaticCascadeJobBit = 0x80000000u;
+    u32 CascadeJobCount = 0;
+    u32 CascadeJobs[3 * R_MaxShadowCascadeCount];
+    // NOTE(boti): Point shadow draw lists and frustums are indexed by 6*Slot + LayerIndex,
+    // the dynamic lists only contain the immediate draws and the static lists only the retained ones
     draw_list* ShadowDrawLists = PushArray(Frame->Arena, MemPush_Clear, draw_list, 6 * R_MaxShadowCount);
-    u32 DrawListCount = 1 + R_MaxShadowCascadeCount;
+    draw_list* StaticShadowDrawLists = PushArray(Frame->Arena, MemPush_Clear, draw_list, 6 * R_MaxShadowCount);
+    u32 DrawListCount = 1;
 
     u32 ShadowCount = 0;
-    frustum* ShadowFrustums = PushArray(Frame->Arena, 0, frustum, R_MaxShadowCount);
+    u32 ShadowSlots[R_MaxShadowCount];
+    b32 IsShadowStaticRebuilt[R_MaxShadowCount] = {};
+    frustum* ShadowFrustums = PushArray(Frame->Arena, 0, frustum, 6 * R_MaxShadowCount);
+    // NOTE(boti): Faces that get a culling job, the dynamic lists are only built for the faces visible from the camera,
+    // the static ones for all the faces of the lights that need a static rebuild
+    constexpr u32 StaticShadowFaceBit = 0x80000000u;
+    u32 ShadowFaceCount = 0;
+    u32* ShadowFaces = PushArray(Frame->Arena, 0, u32, 12 * R_MaxShadowCount);
 
     VkViewport PrimaryViewport =
     {
@@ -2985,489 +3314,659 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
         }
 
         {
-            TimedBlock(Platform.Profiler, "ProcessRenderCommands");
-            for (u32 CommandIndex = 0; CommandIndex < Frame->CommandCount; CommandIndex++)
+            TimedBlock(Platform.Profiler, "ProcessTransfers");
+            for (u32 TransferIndex = 0; TransferIndex < Frame->TransferCount; TransferIndex++)
             {
-                render_command* Command = Frame->Commands + CommandIndex;
-                switch (Command->Type)
+                transfer_command* Command = Frame->Transfers + TransferIndex;
+                transfer_op* Op = &Command->Op;
+                switch (Op->Type)
                 {
-                    case RenderCommand_Transfer:
+                    case TransferOp_Texture:
                     {
-                        transfer_op* Op = &Command->Transfer;
-                        switch (Op->Type)
+                        if (!IsValid(Op->Texture.TargetID))
                         {
-                            case TransferOp_Texture:
-                            {
-                                if (!IsValid(Op->Texture.TargetID))
-                                {
-                                    break;
-                                }
+                            break;
+                        }
 
-                                texture_info* Info = &Op->Texture.Info;
-                                texture_subresource_range* Range = &Op->Texture.SubresourceRange;
-                                if (Info->Extent.Z > 1)
-                                {
-                                    UnimplementedCodePath;
-                                }
+                        texture_info* Info = &Op->Texture.Info;
+                        texture_subresource_range* Range = &Op->Texture.SubresourceRange;
+                        if (Info->Extent.Z > 1)
+                        {
+                            UnimplementedCodePath;
+                        }
 
-                                format_info ByteRate = FormatInfoTable[Info->Format];
-                                umm TotalSize = GetMipChainSize(Info->Extent.X, Info->Extent.Y, Info->MipCount, Info->ArrayCount, ByteRate);
+                        format_info ByteRate = FormatInfoTable[Info->Format];
+                        umm TotalSize = GetMipChainSize(Info->Extent.X, Info->Extent.Y, Info->MipCount, Info->ArrayCount, ByteRate);
 
-                                u32 CopyCount = Info->MipCount * Info->ArrayCount;
-                                VkBufferImageCopy* Copies = PushArray(Frame->Arena, 0, VkBufferImageCopy, CopyCount);
-                                VkBufferImageCopy* CopyAt = Copies;
+                        u32 CopyCount = Info->MipCount * Info->ArrayCount;
+                        VkBufferImageCopy* Copies = PushArray(Frame->Arena, 0, VkBufferImageCopy, CopyCount);
+                        VkBufferImageCopy* CopyAt = Copies;
 
-                                umm Offset = Command->StagingBufferAt;
-                                for (u32 ArrayIndex = 0; ArrayIndex < Info->ArrayCount; ArrayIndex++)
+                        umm Offset = Command->StagingBufferAt;
+                        for (u32 ArrayIndex = 0; ArrayIndex < Info->ArrayCount; ArrayIndex++)
+                        {
+                            for (u32 MipIndex = 0; MipIndex < Info->MipCount; MipIndex++)
+                            {
+                                v2u Extent = 
                                 {
-                                    for (u32 MipIndex = 0; MipIndex < Info->MipCount; MipIndex++)
-                                    {
-                                        v2u Extent = 
-                                        {
-                                            Max(Info->Extent.X >> MipIndex, 1u),
-                                            Max(Info->Extent.Y >> MipIndex, 1u),
-                                        };
-
-                                        u32 RowLength = 0;
-                                        u32 ImageHeight = 0;
-                                        u64 TexelCount;
-                                        if (ByteRate.Flags & FormatFlag_BlockCompressed)
-                                        {
-                                            RowLength = Align(Extent.X, 4u);
-                                            ImageHeight = Align(Extent.Y, 4u);
-
-                                            TexelCount = (u64)RowLength * ImageHeight;
-                                        }
-                                        else
-                                        {
-                                            TexelCount = Extent.X * Extent.Y;
-                                        }
-                                        u64 MipSize = TexelCount * ByteRate.ByteRateNumerator / ByteRate.ByteRateDenominator;
-
-                                        CopyAt->bufferOffset = Offset,
-                                        CopyAt->bufferRowLength = RowLength,
-                                        CopyAt->bufferImageHeight = ImageHeight,
-                                        CopyAt->imageSubresource = 
-                                        {
-                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                            .mipLevel = MipIndex,
-                                            .baseArrayLayer = ArrayIndex,
-                                            .layerCount = 1,
-                                        },
-                                        CopyAt->imageOffset = { 0, 0, 0 },
-                                        CopyAt->imageExtent = { Extent.X, Extent.Y, 1 },
-
-                                        Offset += MipSize;
-                                        CopyAt++;
-                                    }
-                                }
+                                    Max(Info->Extent.X >> MipIndex, 1u),
+                                    Max(Info->Extent.Y >> MipIndex, 1u),
+                                };
 
-                                b32 IsAllocated = false;
-                                renderer_texture* Texture = GetTexture(&Renderer->TextureManager, Op->Texture.TargetID);
-                                Assert(Texture);
-                                if (Texture->ImageHandle == VK_NULL_HANDLE)
-                                {
-                                    IsAllocated = AllocateTexture(&Renderer->TextureManager, Op->Texture.TargetID, *Info);
-                                }
-                                else if (AreTextureInfosSameFormat(Op->Texture.Info, Texture->Info))
+                                u32 RowLength = 0;
+                                u32 ImageHeight = 0;
+                                u64 TexelCount;
+                                if (ByteRate.Flags & FormatFlag_BlockCompressed)
                                 {
-                                    // NOTE(boti): Nothing to do here, although in the future we might want to allocate memory here
-                                    // (currently that's always already done in this case)
-                                    IsAllocated = true;
+                                    RowLength = Align(Extent.X, 4u);
+                                    ImageHeight = Align(Extent.Y, 4u);
+
+                                    TexelCount = (u64)RowLength * ImageHeight;
                                 }
                                 else
                                 {
-                                    // TODO(boti): Move the deletion entry push to the texture manager
-                                    VkImage OldImageHandle = Texture->ImageHandle;
-                                    VkImageView OldViewHandle = Texture->ViewHandle;
-                                    IsAllocated = AllocateTexture(&Renderer->TextureManager, Op->Texture.TargetID, *Info);
-                                    if (IsAllocated)
-                                    {
-                                        PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, OldImageHandle);
-                                        PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, OldViewHandle);
-                                    }
+                                    TexelCount = Extent.X * Extent.Y;
                                 }
+                                u64 MipSize = TexelCount * ByteRate.ByteRateNumerator / ByteRate.ByteRateDenominator;
 
-                                if (IsAllocated)
+                                CopyAt->bufferOffset = Offset,
+                                CopyAt->bufferRowLength = RowLength,
+                                CopyAt->bufferImageHeight = ImageHeight,
+                                CopyAt->imageSubresource = 
                                 {
-                                    umm DescriptorSize = VK.DescriptorBufferProps.sampledImageDescriptorSize;
-                                    if ((Frame->StagingBuffer.At + DescriptorSize) <= Frame->StagingBuffer.Size)
-                                    {
-                                        VkDescriptorImageInfo DescriptorImage = 
-                                        {
-                                            .sampler = VK_NULL_HANDLE,
-                                            .imageView = Texture->ViewHandle,
-                                            .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
-                                        };
-                                        VkDescriptorGetInfoEXT DescriptorInfo = 
-                                        {
-                                            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
-                                            .pNext = nullptr,
-                                            .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                                            .data = { .pSampledImage = &DescriptorImage },
-                                        };
-                                        vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At));
-                                
-                                        umm DescriptorOffset = Renderer->TextureManager.TextureTableOffset + Op->Texture.TargetID.Value*DescriptorSize; // TODO(boti): standardize this
-                                        VkBufferCopy DescriptorCopy = 
-                                        {
-                                            .srcOffset = Frame->StagingBuffer.At,
-                                            .dstOffset = DescriptorOffset,
-                                            .size = DescriptorSize,
-                                        };
-                                        vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->TextureManager.DescriptorBuffer, 1, &DescriptorCopy);
-                                
-                                        Frame->StagingBuffer.At += DescriptorSize;
-                                
-                                        u32 MipBucket;
-                                        BitScanReverse(&MipBucket, Max(Info->Extent.X, Info->Extent.Y));
-                                        u32 MipMask = (1 << (MipBucket + 1)) - 1;
-                                        Texture->MipResidencyMask = MipMask;
-                                        Texture->Info = Op->Texture.Info;
-                                    }
-                                    else
-                                    {
-                                        UnimplementedCodePath;
-                                    }
-
-                                    VkImageMemoryBarrier2 BeginBarrier = 
-                                    {
-                                        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                                        .pNext = nullptr,
-                                        .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-                                        .srcAccessMask = VK_ACCESS_2_NONE,
-                                        .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
-                                        .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                                        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                                        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                        .image = Texture->ImageHandle,
-                                        .subresourceRange = 
-                                        {
-                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                            .baseMipLevel = 0,
-                                            .levelCount = VK_REMAINING_MIP_LEVELS,
-                                            .baseArrayLayer = 0,
-                                            .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                                        },
-                                    };
-                                    VkDependencyInfo BeginDependency = 
-                                    {
-                                        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-                                        .pNext = nullptr,
-                                        .dependencyFlags = 0,
-                                        .imageMemoryBarrierCount = 1,
-                                        .pImageMemoryBarriers = &BeginBarrier,
-                                    };
-                                    vkCmdPipelineBarrier2(UploadCB, &BeginDependency);
-                                    vkCmdCopyBufferToImage(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Texture->ImageHandle, 
-                                                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                                           CopyCount, Copies);
+                                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    .mipLevel = MipIndex,
+                                    .baseArrayLayer = ArrayIndex,
+                                    .layerCount = 1,
+                                },
+                                CopyAt->imageOffset = { 0, 0, 0 },
+                                CopyAt->imageExtent = { Extent.X, Extent.Y, 1 },
 
-                                    VkImageMemoryBarrier2 EndBarrier = 
-                                    {
-                                        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                                        .pNext = nullptr,
-                                        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
-                                        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                                        .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-                                        .dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
-                                        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                        .image = Texture->ImageHandle,
-                                        .subresourceRange = 
-                                        {
-                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                                            .baseMipLevel = 0,
-                                            .levelCount = VK_REMAINING_MIP_LEVELS,
-                                            .baseArrayLayer = 0,
-                                            .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                                        },
-                                    };
-                                    PushBeginBarrier(&FrameStages[FrameStage_Prepass], &EndBarrier);
-                                }
-                                else
-                                {
-                                    // TODO(boti): Logging
-                                    //UnimplementedCodePath;
-                                }
-                            } break;
+                                Offset += MipSize;
+                                CopyAt++;
+                            }
+                        }
 
-                            case TransferOp_Geometry:
+                        b32 IsAllocated = false;
+                        renderer_texture* Texture = GetTexture(&Renderer->TextureManager, Op->Texture.TargetID);
+                        renderer_texture_image* TextureImage = GetTextureImage(&Renderer->TextureManager, Op->Texture.TargetID);
+                        Assert(Texture && TextureImage);
+                        if (TextureImage->ImageHandle == VK_NULL_HANDLE)
+                        {
+                            IsAllocated = AllocateTexture(&Renderer->TextureManager, Op->Texture.TargetID, *Info);
+                        }
+                        else if (AreTextureInfosSameFormat(Op->Texture.Info, Texture->Info))
+                        {
+                            // NOTE(boti): Nothing to do here, although in the future we might want to allocate memory here
+                            // (currently that's always already done in this case)
+                            IsAllocated = true;
+                        }
+                        else
+                        {
+                            // TODO(boti): Move the deletion entry push to the texture manager
+                            VkImage OldImageHandle = TextureImage->ImageHandle;
+                            VkImageView OldViewHandle = TextureImage->ViewHandle;
+                            umm OldPageIndex = Texture->PageIndex;
+                            umm OldPageCount = Texture->PageCount;
+                            IsAllocated = AllocateTexture(&Renderer->TextureManager, Op->Texture.TargetID, *Info);
+                            if (IsAllocated)
                             {
-                                umm VertexByteCount = Op->Geometry.Dest.VertexBlock->Count * sizeof(vertex);
-                                umm VertexByteOffset = Op->Geometry.Dest.VertexBlock->Offset * sizeof(vertex);
-                                umm IndexByteCount = Op->Geometry.Dest.IndexBlock->Count * sizeof(vert_index);
-                                umm IndexByteOffset = Op->Geometry.Dest.IndexBlock->Offset * sizeof(vert_index);
-
-                                u32 BlockIndex = VertexByteOffset / Renderer->GeometryBuffer.VertexMemory.GPUBlockSize;
-                                VertexByteOffset = VertexByteOffset % Renderer->GeometryBuffer.VertexMemory.GPUBlockSize;
-                                VkBuffer VertexBuffer = Renderer->GeometryBuffer.VertexMemory.Buffers[BlockIndex];
-                                VkBuffer IndexBuffer = Renderer->GeometryBuffer.IndexMemory.Buffers[0];
+                                PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, OldImageHandle);
+                                PushDeletionEntry(&Renderer->DeletionQueue, Frame->FrameID, OldViewHandle);
+                                PushPendingPageFree(&Renderer->TextureManager.Cache, Frame->FrameID, OldPageIndex, OldPageCount);
+                            }
+                        }
 
-                                VkBufferMemoryBarrier2 Barrier = 
+                        if (IsAllocated)
+                        {
+                            umm DescriptorSize = VK.DescriptorBufferProps.sampledImageDescriptorSize;
+                            if ((Frame->StagingBuffer.At + DescriptorSize) <= Frame->StagingBuffer.Size)
+                            {
+                                VkDescriptorImageInfo DescriptorImage = 
                                 {
-                                    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
-                                    .pNext = nullptr,
-                                    .srcStageMask = 0,
-                                    .srcAccessMask = 0,
-                                    .dstStageMask = 0,
-                                    .dstAccessMask = 0,
-                                    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                    .buffer = VK_NULL_HANDLE,
-                                    .offset = 0,
-                                    .size = 0,
+                                    .sampler = VK_NULL_HANDLE,
+                                    .imageView = TextureImage->ViewHandle,
+                                    .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
                                 };
-                                VkDependencyInfo Dependency = 
+                                VkDescriptorGetInfoEXT DescriptorInfo = 
                                 {
-                                    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
                                     .pNext = nullptr,
-                                    .dependencyFlags = 0,
-                                    .bufferMemoryBarrierCount = 1,
-                                    .pBufferMemoryBarriers = &Barrier,
+                                    .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                                    .data = { .pSampledImage = &DescriptorImage },
                                 };
-
-                                if (VertexByteCount)
+                                vkGetDescriptorEXT(VK.Device, &DescriptorInfo, DescriptorSize, OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At));
+                                
+                                umm DescriptorOffset = Renderer->TextureManager.TextureTableOffset + Op->Texture.TargetID.Value*DescriptorSize; // TODO(boti): standardize this
+                                VkBufferCopy DescriptorCopy = 
                                 {
-                                    Barrier.buffer = VertexBuffer;
-                                    Barrier.offset = VertexByteOffset;
-                                    Barrier.size = VertexByteCount;
-
-                                    Barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
-                                    Barrier.srcAccessMask = VK_ACCESS_2_NONE;
-                                    Barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
-                                    Barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-                                    vkCmdPipelineBarrier2(UploadCB, &Dependency);
-
-                                    VkBufferCopy Copy = 
-                                    {
-                                        .srcOffset = Command->StagingBufferAt,
-                                        .dstOffset = VertexByteOffset,
-                                        .size = VertexByteCount,
-                                    };
-                                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], VertexBuffer, 1, &Copy);
-
-                                    Barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
-                                    Barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-                                    Barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-                                    Barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
-                                    PushBeginBarrier(&FrameStages[FrameStage_Skinning], &Barrier);
-                                }
+                                    .srcOffset = Frame->StagingBuffer.At,
+                                    .dstOffset = DescriptorOffset,
+                                    .size = DescriptorSize,
+                                };
+                                vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->TextureManager.DescriptorBuffer, 1, &DescriptorCopy);
+                                
+                                Frame->StagingBuffer.At += DescriptorSize;
+                                
+                                u32 MipBucket;
+                                BitScanReverse(&MipBucket, Max(Info->Extent.X, Info->Extent.Y));
+                                u32 MipMask = (1 << (MipBucket + 1)) - 1;
+                                Texture->MipResidencyMask = MipMask;
+                                Texture->Info = Op->Texture.Info;
+                                // NOTE(boti): The mips were requested because they're being sampled
+                                Texture->LastUsedFrame = (u32)Renderer->CurrentFrameID;
+                            }
+                            else
+                            {
+                                UnimplementedCodePath;
+                            }
 
-                                if (IndexByteCount)
+                            VkImageMemoryBarrier2 BeginBarrier = 
+                            {
+                                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                .pNext = nullptr,
+                                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                                .srcAccessMask = VK_ACCESS_2_NONE,
+                                .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                .image = TextureImage->ImageHandle,
+                                .subresourceRange = 
                                 {
-                                    Barrier.buffer = IndexBuffer;
-                                    Barrier.offset = IndexByteOffset;
-                                    Barrier.size = IndexByteCount;
-
-                                    Barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
-                                    Barrier.srcAccessMask = VK_ACCESS_2_NONE;
-                                    Barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
-                                    Barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-                                    vkCmdPipelineBarrier2(UploadCB, &Dependency);
-                                    VkBufferCopy Copy = 
-                                    {
-                                        .srcOffset = Command->StagingBufferAt + VertexByteCount,
-                                        .dstOffset = IndexByteOffset,
-                                        .size = IndexByteCount,
-                                    };
-                                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], IndexBuffer, 1, &Copy);
+                                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    .baseMipLevel = 0,
+                                    .levelCount = VK_REMAINING_MIP_LEVELS,
+                                    .baseArrayLayer = 0,
+                                    .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                                },
+                            };
+                            VkDependencyInfo BeginDependency = 
+                            {
+                                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                .pNext = nullptr,
+                                .dependencyFlags = 0,
+                                .imageMemoryBarrierCount = 1,
+                                .pImageMemoryBarriers = &BeginBarrier,
+                            };
+                            vkCmdPipelineBarrier2(UploadCB, &BeginDependency);
+                            vkCmdCopyBufferToImage(UploadCB, Renderer->StagingBuffers[Frame->FrameID], TextureImage->ImageHandle, 
+                                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                   CopyCount, Copies);
 
-                                    Barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
-                                    Barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-                                    Barrier.dstStageMask = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-                                    Barrier.dstAccessMask = VK_ACCESS_2_INDEX_READ_BIT|VK_ACCESS_2_SHADER_READ_BIT;
-                                    PushBeginBarrier(&FrameStages[FrameStage_Prepass], &Barrier);
-                                }
-                            } break;
-                            InvalidDefaultCase;
+                            VkImageMemoryBarrier2 EndBarrier = 
+                            {
+                                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                .pNext = nullptr,
+                                .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                                .dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                .image = TextureImage->ImageHandle,
+                                .subresourceRange = 
+                                {
+                                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    .baseMipLevel = 0,
+                                    .levelCount = VK_REMAINING_MIP_LEVELS,
+                                    .baseArrayLayer = 0,
+                                    .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                                },
+                            };
+                            PushBeginBarrier(&FrameStages[FrameStage_Prepass], &EndBarrier);
+                        }
+                        else
+                        {
+                            // TODO(boti): Logging
+                            //UnimplementedCodePath;
                         }
                     } break;
 
-                    case RenderCommand_Light:
+                    case TransferOp_Geometry:
                     {
-                        light* Light = &Command->Light;
-
-                        f32 L = GetLuminance(Light->E);
-                        f32 R = Sqrt(Max(L / R_LuminanceThreshold, 0.0f));
+                        geometry_buffer_block* VertexBlock = Op->Geometry.Dest.VertexBlock;
+                        geometry_buffer_block* IndexBlock = Op->Geometry.Dest.IndexBlock;
+                        umm VertexByteCount = VertexBlock ? VertexBlock->Count * sizeof(vertex) : 0;
+                        umm VertexByteOffset = VertexBlock ? VertexBlock->Offset * sizeof(vertex) : 0;
+                        umm IndexByteCount = IndexBlock ? IndexBlock->Count * sizeof(vert_index) : 0;
+                        umm IndexByteOffset = IndexBlock ? IndexBlock->Offset * sizeof(vert_index) : 0;
+
+                        u32 BlockIndex = VertexByteOffset / geometry_allocator::GPUBlockSize;
+                        VertexByteOffset = VertexByteOffset % geometry_allocator::GPUBlockSize;
+                        VkBuffer VertexBuffer = Renderer->GeometryBuffer.VertexMemory.Buffers[BlockIndex];
+                        VkBuffer IndexBuffer = Renderer->GeometryBuffer.IndexMemory.Buffers[0];
+
+                        VkBufferMemoryBarrier2 Barrier = 
+                        {
+                            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                            .pNext = nullptr,
+                            .srcStageMask = 0,
+                            .srcAccessMask = 0,
+                            .dstStageMask = 0,
+                            .dstAccessMask = 0,
+                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .buffer = VK_NULL_HANDLE,
+                            .offset = 0,
+                            .size = 0,
+                        };
+                        VkDependencyInfo Dependency = 
+                        {
+                            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                            .pNext = nullptr,
+                            .dependencyFlags = 0,
+                            .bufferMemoryBarrierCount = 1,
+                            .pBufferMemoryBarriers = &Barrier,
+                        };
 
-                        if (LightDataAt <= R_MaxLightCount /*&& IntersectFrustumSphere(&Frame->CameraFrustum, Light->P, R)*/)
+                        if (VertexByteCount)
                         {
-                            Frame->Uniforms.LightCount++;
-                            u32 ShadowIndex = 0xFFFFFFFFu;
-                            if ((Light->Flags & LightFlag_ShadowCaster) && ShadowCount <= R_MaxShadowCount)
+                            Barrier.buffer = VertexBuffer;
+                            Barrier.offset = VertexByteOffset;
+                            Barrier.size = VertexByteCount;
+
+                            Barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+                            Barrier.srcAccessMask = VK_ACCESS_2_NONE;
+                            Barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                            Barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+                            vkCmdPipelineBarrier2(UploadCB, &Dependency);
+
+                            VkBufferCopy Copy = 
                             {
-                                ShadowIndex = ShadowCount++;
-                                point_shadow_data* Shadow = Frame->Uniforms.PointShadows + ShadowIndex;
-
-                                f32 n = 0.05f;
-                                f32 f = R + 1e-6f;
-                                f32 r = 1.0f / (f - n);
-                                m4 Projection = M4(1.0f, 0.0f, 0.0f, 0.0f,
-                                                   0.0f, 1.0f, 0.0f, 0.0f,
-                                                   0.0f, 0.0f, f*r, -f*n*r,
-                                                   0.0f, 0.0f, 1.0f, 0.0f);
-                                m4 InverseProjection = M4(1.0f, 0.0f, 0.0f, 0.0f,
-                                                          0.0f, 1.0f, 0.0f, 0.0f,
-                                                          0.0f, 0.0f, 0.0f, 1.0f,
-                                                          0.0f, 0.0f, -1.0f / (f*n*r), 1.0f / n);
-                                Shadow->Near = n;
-                                Shadow->Far = f;
-                                DrawListCount += 6;
-                                for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
-                                {
-                                    m3 M = GlobalCubeFaceBases[LayerIndex];
-                                    m4 InverseView = M4(M.X.X, M.Y.X, M.Z.X, Light->P.X,
-                                                        M.X.Y, M.Y.Y, M.Z.Y, Light->P.Y,
-                                                        M.X.Z, M.Y.Z, M.Z.Z, Light->P.Z,
-                                                        0.0f, 0.0f, 0.0f ,1.0f);
-                                    m4 View = M4(M.X.X, M.X.Y, M.X.Z, -Dot(M.X, Light->P),
-                                                 M.Y.X, M.Y.Y, M.Y.Z, -Dot(M.Y, Light->P),
-                                                 M.Z.X, M.Z.Y, M.Z.Z, -Dot(M.Z, Light->P),
-                                                 0.0f, 0.0f, 0.0f, 1.0f);
-                                    m4 ViewProjection = Projection * View;
-                                    Shadow->ViewProjections[LayerIndex] = ViewProjection;
-
-                                    frustum ClipSpaceFrustum = GetClipSpaceFrustum();
-                                    frustum* Frustum = &ShadowFrustums[6 * ShadowIndex + LayerIndex];
-                                    for (u32 PlaneIndex = 0; PlaneIndex < CountOf(Frustum->Planes); PlaneIndex++)
-                                    {
-                                        // TODO(boti): Try mul w/ ViewProjection after porting
-                                        Frustum->Planes[PlaneIndex] = ClipSpaceFrustum.Planes[PlaneIndex] * Projection * View;
-                                    }
-                                }
-                            }
+                                .srcOffset = Command->StagingBufferAt,
+                                .dstOffset = VertexByteOffset,
+                                .size = VertexByteCount,
+                            };
+                            vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], VertexBuffer, 1, &Copy);
+
+                            Barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                            Barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+                            Barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                            Barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+                            PushBeginBarrier(&FrameStages[FrameStage_Skinning], &Barrier);
+                        }
 
-                            v3 P = TransformPoint(Frame->Uniforms.ViewTransform, Light->P);
-                            LightData[LightDataAt++] =
+                        if (IndexByteCount)
+                        {
+                            Barrier.buffer = IndexBuffer;
+                            Barrier.offset = IndexByteOffset;
+                            Barrier.size = IndexByteCount;
+
+                            Barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+                            Barrier.srcAccessMask = VK_ACCESS_2_NONE;
+                            Barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                            Barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+                            vkCmdPipelineBarrier2(UploadCB, &Dependency);
+                            VkBufferCopy Copy = 
                             {
-                                .P = P,
-                                .ShadowIndex = ShadowIndex,
-                                .E = Light->E,
-                                .Flags = Light->Flags,
+                                .srcOffset = Command->StagingBufferAt + VertexByteCount,
+                                .dstOffset = IndexByteOffset,
+                                .size = IndexByteCount,
                             };
+                            vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], IndexBuffer, 1, &Copy);
+
+                            Barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                            Barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+                            Barrier.dstStageMask = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                            Barrier.dstAccessMask = VK_ACCESS_2_INDEX_READ_BIT|VK_ACCESS_2_SHADER_READ_BIT;
+                            PushBeginBarrier(&FrameStages[FrameStage_Prepass], &Barrier);
                         }
                     } break;
+                    InvalidDefaultCase;
+                }
+            }
+        }
 
-                    case RenderCommand_Draw:
+        {
+            TimedBlock(Platform.Profiler, "DefragmentGeometry");
+            geometry_buffer* GeometryBuffer = &Renderer->GeometryBuffer;
+            if (DefragmentGeometryBuffer(GeometryBuffer, Frame->FrameID, UploadCB))
+            {
+                VkMemoryBarrier2 Barrier = 
+                {
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                    .pNext = nullptr,
+                    .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                    .dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT|VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT|VK_ACCESS_2_INDEX_READ_BIT|VK_ACCESS_2_SHADER_READ_BIT,
+                };
+                PushBeginBarrier(&FrameStages[FrameStage_Skinning], &Barrier);
+
+                // NOTE(boti): The retained instances cache the vertex address and first index of their geometry
+                retained_scene* Scene = &Renderer->RetainedScene;
+                for (u32 Group = 0; Group < DrawGroup_Count; Group++)
+                {
+                    for (u32 Slot = 0; Slot < Scene->GroupInstanceCounts[Group]; Slot++)
                     {
-                        draw_command* Draw = &Command->Draw;
+                        u32 InstanceIndex = Scene->GroupInstances[Group][Slot];
+                        geometry_buffer_allocation* Geometry = Scene->Geometries + InstanceIndex;
+                        if ((Geometry->VertexBlock->MoveGeneration == GeometryBuffer->DefragGeneration) ||
+                            (Geometry->IndexBlock->MoveGeneration == GeometryBuffer->DefragGeneration))
+                        {
+                            umm VertexByteOffset = Geometry->VertexBlock->Offset * sizeof(vertex);
+                            Scene->Instances[InstanceIndex].VertexBufferAddress = GetDeviceAddress(&GeometryBuffer->VertexMemory, VertexByteOffset);
+                            Scene->IndirectCommands[InstanceIndex].firstIndex = Geometry->IndexBlock->Offset;
+                            MarkInstanceDirty(Scene, InstanceIndex);
+                        }
+                    }
+                }
+            }
+        }
 
-                        u32 ID = DrawGroupOffsets[Draw->Group]++;
-                        BoundingBoxes[ID] = Draw->BoundingBox;
-                        Transforms[ID] = Draw->Transform;
+        {
+            TimedBlock(Platform.Profiler, "ProcessLights");
 
-                        umm SourceByteOffset = Draw->Geometry.VertexBlock->Offset * sizeof(vertex);
-                        u64 SourceVertexBufferAddress = GetDeviceAddress(&Renderer->GeometryBuffer.VertexMemory, SourceByteOffset);
-                        u64 DrawVertexBufferAddress = SourceVertexBufferAddress;
+            // NOTE(boti): Shadow casters compete for the shadow maps by their screen-space influence,
+            // the ones that don't get a shadow map are shaded as regular lights
+            u32 ShadowCandidateCount = 0;
+            u32* ShadowCandidateKeys = PushArray(Frame->Arena, 0, u32, 2 * Frame->LightCount);
+            u32* ShadowCandidates = PushArray(Frame->Arena, 0, u32, 2 * Frame->LightCount);
+            u32* CandidateLightIndices = PushArray(Frame->Arena, 0, u32, Frame->LightCount);
+            u32* CandidateDataIndices = PushArray(Frame->Arena, 0, u32, Frame->LightCount);
+            f32* CandidateRadii = PushArray(Frame->Arena, 0, f32, Frame->LightCount);
+            f32* CandidateInfluences = PushArray(Frame->Arena, 0, f32, Frame->LightCount);
 
-                        if (Draw->Flags & Draw_Skinned)
-                        {
-                            u32 VertexCount = Draw->Geometry.VertexBlock->Count;
-                            gpu_buffer_range VertexBufferRange = PushPerFrame(VertexCount * sizeof(vertex), 16);
-                            DrawVertexBufferAddress = VertexBufferRange.Address;
-                        
-                            struct skinning_constants
-                            {
-                                VkDeviceAddress SkinAddress;
-                                VkDeviceAddress SrcAddress;
-                                VkDeviceAddress DstAddress;
-                                u32 VertexCount;
-                            } Push;
-                            Push.SkinAddress = Renderer->BARBufferAddresses[Frame->FrameID] + Command->BARBufferAt;
-                            Push.SrcAddress = SourceVertexBufferAddress;
-                            Push.DstAddress = VertexBufferRange.Address;
-                            Push.VertexCount = VertexCount;
-                            vkCmdPushConstants(SkinningCB, Renderer->Pipelines[Pipeline_Skinning].Layout, VK_SHADER_STAGE_ALL,
-                                               0, sizeof(Push), &Push);
-                            vkCmdDispatch(SkinningCB, CeilDiv(VertexCount, Skin_GroupSizeX), 1, 1);
-
-                            // HACK(boti): We'd either need to generate the bboxes when skinning (which requires GPU culling),
-                            // or have some guarantee that the bbox from the mesh is conservative enough to accomodate
-                            // all animations, neither of which we currently have,
-                            // so instead we massively overestimate the bbox, essentially turning frustum culling off for skinned meshes.
-                            BoundingBoxes[ID] = 
-                            {
-                                .Min = { -1000000.0f, -1000000.0f, -1000000.0f },
-                                .Max = { +1000000.0f, +1000000.0f, +1000000.0f }, 
-                            };
-                        }
+            for (u32 LightIndex = 0; LightIndex < Frame->LightCount; LightIndex++)
+            {
+                light* Light = Frame->Lights + LightIndex;
 
-                        IndirectCommands[ID] = 
-                        {
-                            .indexCount = Draw->Geometry.IndexBlock->Count,
-                            .instanceCount = 1,
-                            .firstIndex = Draw->Geometry.IndexBlock->Offset,
-                            .vertexOffset = 0,
-                            .firstInstance = ID,
-                        };
+                f32 L = GetLuminance(Light->E);
+                f32 R = Sqrt(Max(L / R_LuminanceThreshold, 0.0f));
 
-                        Instances[ID] = 
-                        {
-                            .Transform = Draw->Transform,
-                            .VertexBufferAddress = DrawVertexBufferAddress,
-                            .Material = Draw->Material,
-                        };
-                    } break;
-                    case RenderCommand_ParticleBatch:
+                if (LightDataAt < R_MaxLightCount && IntersectFrustumSphere(&Frame->CameraFrustum, Light->P, R))
+                {
+                    if (Light->Flags & LightFlag_ShadowCaster)
                     {
-                        struct
-                        {
-                            VkDeviceAddress ParticleAddress;
-                            billboard_mode Mode;
-                            renderer_texture_id TextureID;
-                        } Push;
-                        Push.ParticleAddress = Renderer->BARBufferAddresses[Frame->FrameID] + Command->BARBufferAt;
-                        Push.Mode = Command->ParticleBatch.Mode;
-                        Push.TextureID = Frame->ParticleTextureID;
-                        vkCmdPushConstants(ParticleCB, Renderer->Pipelines[Pipeline_Quad].Layout, VK_SHADER_STAGE_ALL, 
-                                           0, sizeof(Push), &Push);
-                        vkCmdDraw(ParticleCB, 6 * Command->ParticleBatch.Count, 1, 0, 0);
-                    } break;
-                    case RenderCommand_Widget3D:
+                        f32 Influence = GetLightScreenInfluence(Frame->CameraTransform.P.XYZ, Frame->CameraFocalLength, Light->P, R);
+
+                        u32 CandidateIndex = ShadowCandidateCount++;
+                        // NOTE(boti): Inverted so that the ascending sort puts the highest influence first
+                        ShadowCandidateKeys[CandidateIndex] = ~FloatToSortKey(Influence);
+                        ShadowCandidates[CandidateIndex] = CandidateIndex;
+                        CandidateLightIndices[CandidateIndex] = LightIndex;
+                        CandidateDataIndices[CandidateIndex] = LightDataAt;
+                        CandidateRadii[CandidateIndex] = R;
+                        CandidateInfluences[CandidateIndex] = Influence;
+                    }
+
+                    Frame->Uniforms.LightCount++;
+                    v3 P = TransformPoint(Frame->Uniforms.ViewTransform, Light->P);
+                    LightData[LightDataAt++] =
                     {
-                        geometry_buffer_allocation* Geometry = &Command->Widget3D.Geometry;
-                        umm VertexByteOffset = Geometry->VertexBlock->Offset * sizeof(vertex);
+                        .P = P,
+                        .ShadowIndex = 0xFFFFFFFFu,
+                        .E = Light->E,
+                        .Flags = Light->Flags,
+                    };
+                }
+            }
 
-                        struct
-                        {
-                            m4 Transform;
-                            u64 VertexBufferAddress;
-                            rgba8 Color;
-                        } Push;
-                        Push.Transform = Command->Widget3D.Transform;
-                        Push.VertexBufferAddress = GetDeviceAddress(&Renderer->GeometryBuffer.VertexMemory, VertexByteOffset);
-                        Push.Color = Command->Widget3D.Color;
-                        vkCmdPushConstants(Widget3DCB, Renderer->Pipelines[Pipeline_Gizmo].Layout, VK_SHADER_STAGE_ALL,
-                                           0, sizeof(Push), &Push);
-                        vkCmdDrawIndexed(Widget3DCB, Geometry->IndexBlock->Count, 1, Geometry->IndexBlock->Offset, 0, 0);
-                    } break;
-                    case RenderCommand_Batch2D:
+            // NOTE(boti): The candidates are always sorted, because the atlas tiles are also handed out by influence
+            RadixSort32(ShadowCandidateCount, ShadowCandidateKeys, ShadowCandidates, 
+                        ShadowCandidateKeys + ShadowCandidateCount, ShadowCandidates + ShadowCandidateCount);
+            ShadowCandidateCount = Min(ShadowCandidateCount, R_MaxShadowCount);
+
+            point_shadow_cache* ShadowCache = &Renderer->PointShadowCache;
+            BeginPointShadowCacheFrame(ShadowCache);
+            for (u32 Index = 0; Index < ShadowCandidateCount; Index++)
+            {
+                u32 CandidateIndex = ShadowCandidates[Index];
+                light* Light = Frame->Lights + CandidateLightIndices[CandidateIndex];
+                f32 R = CandidateRadii[CandidateIndex];
+
+                // NOTE(boti): The shadow index is the slot of the cached shadow map
+                u32 ShadowIndex = AcquirePointShadow(ShadowCache, Light->P, R);
+                Assert(ShadowIndex != U32_MAX);
+
+                // NOTE(boti): Faces that can't be sampled from inside the frustum only get the smallest tiles
+                // (once they've been out of view for a while, see AllocatePointShadowTiles)
+                u32 FaceMask = GetVisibleCubeFaceMask(&Frame->CameraFrustum, Light->P, R);
+                u32 FaceSize = GetPointShadowFaceSize(CandidateInfluences[CandidateIndex] * 0.5f * (f32)Frame->RenderExtent.Y);
+                u32 FaceSizes[CubeLayer_Count];
+                for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+                {
+                    FaceSizes[LayerIndex] = (FaceMask & (1u << LayerIndex)) ? FaceSize : R_PointShadowMinResolution;
+                }
+
+                // NOTE(boti): Lights that don't fit in the atlas are shaded without shadows
+                if (!AllocatePointShadowTiles(ShadowCache, ShadowIndex, FaceSizes))
+                {
+                    continue;
+                }
+
+                point_shadow_cache_entry* Entry = ShadowCache->Entries + ShadowIndex;
+                b32 IsStaticValid = Entry->IsStaticValid;
+                ShadowSlots[ShadowCount++] = ShadowIndex;
+                LightData[CandidateDataIndices[CandidateIndex]].ShadowIndex = ShadowIndex;
+                point_shadow_data* Shadow = Frame->Uniforms.PointShadows + ShadowIndex;
+
+                f32 n = 0.05f;
+                f32 f = R + 1e-6f;
+                f32 r = 1.0f / (f - n);
+                m4 Projection = M4(1.0f, 0.0f, 0.0f, 0.0f,
+                                   0.0f, 1.0f, 0.0f, 0.0f,
+                                   0.0f, 0.0f, f*r, -f*n*r,
+                                   0.0f, 0.0f, 1.0f, 0.0f);
+                Shadow->Near = n;
+                Shadow->Far = f;
+
+                for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+                {
+                    shadow_atlas_tile Tile = GetShadowAtlasTile(Entry->AtlasNodes[LayerIndex]);
+                    Shadow->AtlasRects[LayerIndex] = 
                     {
-                        struct
-                        {
-                            m4 Transform;
-                            u64 VertexBufferAddress;
-                            renderer_texture_id TextureID;
-                        } Push;
-                        Push.Transform = M4(
-                            2.0f / Frame->OutputExtent.X, 0.0f, 0.0f, -1.0f,
-                            0.0f, 2.0f / Frame->OutputExtent.Y, 0.0f, -1.0f,
-                            0.0f, 0.0f, 1.0f, 0.0f,
-                            0.0f, 0.0f, 0.0f, 1.0f);
-                        Push.VertexBufferAddress    = Renderer->BARBufferAddresses[Frame->FrameID] + Command->BARBufferAt;
-                        Push.TextureID              = Frame->ImmediateTextureID;
-                        vkCmdPushConstants(GuiCB, Renderer->Pipelines[Pipeline_UI].Layout, VK_SHADER_STAGE_ALL, 0, sizeof(Push), &Push);
-                        vkCmdDraw(GuiCB, Command->Batch2D.VertexCount, 1, 0, 0);
-                    } break;
-                    InvalidDefaultCase;
+                        (f32)Tile.X / (f32)R_PointShadowAtlasResolution,
+                        (f32)Tile.Y / (f32)R_PointShadowAtlasResolution,
+                        (f32)Tile.Size / (f32)R_PointShadowAtlasResolution,
+                        0.0f,
+                    };
+
+                    m3 M = GlobalCubeFaceBases[LayerIndex];
+                    m4 View = M4(M.X.X, M.X.Y, M.X.Z, -Dot(M.X, Light->P),
+                                 M.Y.X, M.Y.Y, M.Y.Z, -Dot(M.Y, Light->P),
+                                 M.Z.X, M.Z.Y, M.Z.Z, -Dot(M.Z, Light->P),
+                                 0.0f, 0.0f, 0.0f, 1.0f);
+                    m4 ViewProjection = Projection * View;
+                    Shadow->ViewProjections[LayerIndex] = ViewProjection;
+
+                    u32 FaceIndex = 6 * ShadowIndex + LayerIndex;
+                    frustum ClipSpaceFrustum = GetClipSpaceFrustum();
+                    frustum* Frustum = ShadowFrustums + FaceIndex;
+                    for (u32 PlaneIndex = 0; PlaneIndex < CountOf(Frustum->Planes); PlaneIndex++)
+                    {
+                        // TODO(boti): Try mul w/ ViewProjection after porting
+                        Frustum->Planes[PlaneIndex] = ClipSpaceFrustum.Planes[PlaneIndex] * Projection * View;
+                    }
+
+                    if (FaceMask & (1u << LayerIndex))
+                    {
+                        ShadowFaces[ShadowFaceCount++] = FaceIndex;
+                    }
+                    if (!IsStaticValid)
+                    {
+                        ShadowFaces[ShadowFaceCount++] = FaceIndex | StaticShadowFaceBit;
+                    }
+                }
+                IsShadowStaticRebuilt[ShadowIndex] = !IsStaticValid;
+            }
+            DrawListCount += ShadowFaceCount;
+        }
+
+        {
+            TimedBlock(Platform.Profiler, "ProcessDraws");
+            for (u32 DrawIndex = 0; DrawIndex < Frame->DrawCount; DrawIndex++)
+            {
+                draw_command* Draw = Frame->Draws + DrawIndex;
+
+                u32 ID = DrawGroupOffsets[Draw->Group]++;
+                BoundingBoxes[ID] = Draw->BoundingBox;
+                Transforms[ID] = Draw->Transform;
+
+                umm SourceByteOffset = Draw->Geometry.VertexBlock->Offset * sizeof(vertex);
+                u64 SourceVertexBufferAddress = GetDeviceAddress(&Renderer->GeometryBuffer.VertexMemory, SourceByteOffset);
+                u64 DrawVertexBufferAddress = SourceVertexBufferAddress;
+
+                if (Draw->Flags & Draw_Skinned)
+                {
+                    u32 VertexCount = Draw->Geometry.VertexBlock->Count;
+                    gpu_buffer_range VertexBufferRange = PushPerFrame(VertexCount * sizeof(vertex), 16);
+                    DrawVertexBufferAddress = VertexBufferRange.Address;
+                        
+                    struct skinning_constants
+                    {
+                        VkDeviceAddress SkinAddress;
+                        VkDeviceAddress SrcAddress;
+                        VkDeviceAddress DstAddress;
+                        u32 VertexCount;
+                    } Push;
+                    Push.SkinAddress = Renderer->BARBufferAddresses[Frame->FrameID] + Draw->PoseBARBufferAt;
+                    Push.SrcAddress = SourceVertexBufferAddress;
+                    Push.DstAddress = VertexBufferRange.Address;
+                    Push.VertexCount = VertexCount;
+                    vkCmdPushConstants(SkinningCB, Renderer->Pipelines[Pipeline_Skinning].Layout, VK_SHADER_STAGE_ALL,
+                                       0, sizeof(Push), &Push);
+                    vkCmdDispatch(SkinningCB, CeilDiv(VertexCount, Skin_GroupSizeX), 1, 1);
+
+                    // HACK(boti): We'd either need to generate the bboxes when skinning (which requires GPU culling),
+                    // or have some guarantee that the bbox from the mesh is conservative enough to accomodate
+                    // all animations, neither of which we currently have,
+                    // so instead we massively overestimate the bbox, essentially turning frustum culling off for skinned meshes.
+                    BoundingBoxes[ID] = 
+                    {
+                        .Min = { -1000000.0f, -1000000.0f, -1000000.0f },
+                        .Max = { +1000000.0f, +1000000.0f, +1000000.0f }, 
+                    };
+                }
+
+                IndirectCommands[ID] = 
+                {
+                    .indexCount = Draw->Geometry.IndexBlock->Count,
+                    .instanceCount = 1,
+                    .firstIndex = Draw->Geometry.IndexBlock->Offset,
+                    .vertexOffset = 0,
+                    .firstInstance = Renderer->RetainedScene.MaxInstanceCount + ID,
+                };
+
+                Instances[ID] = 
+                {
+                    .Transform = Draw->Transform,
+                    .VertexBufferAddress = DrawVertexBufferAddress,
+                    .Material = Draw->Material,
+                };
+            }
+        }
+
+        {
+            TimedBlock(Platform.Profiler, "ProcessInstances");
+            for (u32 UpdateIndex = 0; UpdateIndex < Frame->InstanceUpdateCount; UpdateIndex++)
+            {
+                UpdateRetainedInstance(Renderer, Frame->InstanceUpdates + UpdateIndex);
+            }
+            for (u32 FreeIndex = 0; FreeIndex < Frame->InstanceFreeCount; FreeIndex++)
+            {
+                FreeRetainedInstance(Renderer, Frame->InstanceFrees[FreeIndex]);
+            }
+            for (u32 FreeIndex = 0; FreeIndex < Frame->GeometryFreeCount; FreeIndex++)
+            {
+                DeallocateVertexBuffer(&Renderer->GeometryBuffer, Frame->GeometryFrees[FreeIndex], Frame->FrameID);
+            }
+        }
+
+        SetupSceneRendering(Frame, CascadeFrustums, StaticCascadeFrustums, CascadeUpdates);
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            cascade_shadow_update* Update = CascadeUpdates + CascadeIndex;
+            if (Update->IsScheduled)
+            {
+                CascadeJobs[CascadeJobCount++] = CascadeIndex;
+                if (Update->IsStaticRebuilt)
+                {
+                    CascadeJobs[CascadeJobCount++] = (2*CascadeIndex) | StaticCascadeJobBit;
+                }
+                else if (Update->IsScrolled)
+                {
+                    for (u32 StripIndex = 0; StripIndex < Update->StripCount; StripIndex++)
+                    {
+                        CascadeJobs[CascadeJobCount++] = (2*CascadeIndex + StripIndex) | StaticCascadeJobBit;
+                    }
                 }
             }
         }
+        DrawListCount += CascadeJobCount;
+
+        {
+            TimedBlock(Platform.Profiler, "ProcessParticleBatches");
+            for (u32 BatchIndex = 0; BatchIndex < Frame->ParticleBatchCount; BatchIndex++)
+            {
+                particle_batch* Batch = Frame->ParticleBatches + BatchIndex;
+
+                struct
+                {
+                    VkDeviceAddress ParticleAddress;
+                    billboard_mode Mode;
+                    renderer_texture_id TextureID;
+                } Push;
+                Push.ParticleAddress = Renderer->BARBufferAddresses[Frame->FrameID] + Batch->BARBufferAt;
+                Push.Mode = Batch->Mode;
+                Push.TextureID = Frame->ParticleTextureID;
+                vkCmdPushConstants(ParticleCB, Renderer->Pipelines[Pipeline_Quad].Layout, VK_SHADER_STAGE_ALL, 
+                                   0, sizeof(Push), &Push);
+                vkCmdDraw(ParticleCB, 6 * Batch->Count, 1, 0, 0);
+            }
+        }
+
+        {
+            TimedBlock(Platform.Profiler, "ProcessWidget3Ds");
+            for (u32 WidgetIndex = 0; WidgetIndex < Frame->Widget3DCount; WidgetIndex++)
+            {
+                draw_widget3d_cmd* Widget = Frame->Widget3Ds + WidgetIndex;
+                geometry_buffer_allocation* Geometry = &Widget->Geometry;
+                umm VertexByteOffset = Geometry->VertexBlock->Offset * sizeof(vertex);
+
+                struct
+                {
+                    m4 Transform;
+                    u64 VertexBufferAddress;
+                    rgba8 Color;
+                } Push;
+                Push.Transform = Widget->Transform;
+                Push.VertexBufferAddress = GetDeviceAddress(&Renderer->GeometryBuffer.VertexMemory, VertexByteOffset);
+                Push.Color = Widget->Color;
+                vkCmdPushConstants(Widget3DCB, Renderer->Pipelines[Pipeline_Gizmo].Layout, VK_SHADER_STAGE_ALL,
+                                   0, sizeof(Push), &Push);
+                vkCmdDrawIndexed(Widget3DCB, Geometry->IndexBlock->Count, 1, Geometry->IndexBlock->Offset, 0, 0);
+            }
+        }
+
+        {
+            TimedBlock(Platform.Profiler, "ProcessBatch2Ds");
+            for (u32 BatchIndex = 0; BatchIndex < Frame->Batch2DCount; BatchIndex++)
+            {
+                draw_batch_2d* Batch = Frame->Batch2Ds + BatchIndex;
+
+                struct
+                {
+                    m4 Transform;
+                    u64 VertexBufferAddress;
+                    renderer_texture_id TextureID;
+                } Push;
+                Push.Transform = M4(
+                    2.0f / Frame->OutputExtent.X, 0.0f, 0.0f, -1.0f,
+                    0.0f, 2.0f / Frame->OutputExtent.Y, 0.0f, -1.0f,
+                    0.0f, 0.0f, 1.0f, 0.0f,
+                    0.0f, 0.0f, 0.0f, 1.0f);
+                Push.VertexBufferAddress    = Renderer->BARBufferAddresses[Frame->FrameID] + Batch->BARBufferAt;
+                Push.TextureID              = Frame->ImmediateTextureID;
+                vkCmdPushConstants(GuiCB, Renderer->Pipelines[Pipeline_UI].Layout, VK_SHADER_STAGE_ALL, 0, sizeof(Push), &Push);
+                vkCmdDraw(GuiCB, Batch->VertexCount, 1, 0, 0);
+            }
+        }
 
         {
             TimedBlock(Platform.Profiler, "Upload");
@@ -3486,53 +3985,111 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
                 vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->PerFrameBuffer, 1, &LightBufferCopy);
             }
 
-            // Upload instance data
-            gpu_buffer_range InstanceBufferRange = PushPerFrame(InstanceCount * sizeof(instance_data));
-            Frame->Uniforms.InstanceBufferAddress = InstanceBufferRange.Address;
-            if (InstanceBufferRange.ByteCount)
-            {
-                Frame->StagingBuffer.At = Align(Frame->StagingBuffer.At, alignof(instance_data));
-                if (Frame->StagingBuffer.At + InstanceBufferRange.ByteCount <= Frame->StagingBuffer.Size)
+            // NOTE(boti): Only the frame that last used this copy of the instance buffers (FrameFinishedCounters[FrameID]) 
+            // could still read it, and that one has finished by now.
+            // The visibility at the consumer stages is handled by the global upload/skinning barrier.
+            VkBuffer InstanceBuffer = Renderer->InstanceBuffers[Frame->FrameID];
+            VkBuffer DrawDataBuffer = Renderer->DrawDataBuffers[Frame->FrameID];
+            Frame->Uniforms.InstanceBufferAddress = Renderer->InstanceBufferAddresses[Frame->FrameID];
+            Frame->Uniforms.DrawBufferAddress = Renderer->DrawDataBufferAddresses[Frame->FrameID];
+
+            // Upload the retained instances that changed since this copy was last used
+            retained_scene* Scene = &Renderer->RetainedScene;
+            u32 DirtyCount = Scene->DirtyCounts[Frame->FrameID];
+            u32* DirtyList = Scene->DirtyLists[Frame->FrameID];
+            b32* IsDirty = Scene->IsDirty[Frame->FrameID];
+            if (DirtyCount)
+            {
+                umm InstanceByteCount = DirtyCount * sizeof(instance_data);
+                umm DrawByteCount = DirtyCount * sizeof(VkDrawIndexedIndirectCommand);
+                umm InstanceStagingAt = Align(Frame->StagingBuffer.At, alignof(instance_data));
+                umm DrawStagingAt = Align(InstanceStagingAt + InstanceByteCount, alignof(VkDrawIndexedIndirectCommand));
+                if (DrawStagingAt + DrawByteCount <= Frame->StagingBuffer.Size)
                 {
-                    memcpy(OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At), Instances, InstanceBufferRange.ByteCount);
-                    VkBufferCopy Copy = 
+                    instance_data* InstanceStaging = (instance_data*)OffsetPtr(Frame->StagingBuffer.Base, InstanceStagingAt);
+                    VkDrawIndexedIndirectCommand* DrawStaging = (VkDrawIndexedIndirectCommand*)OffsetPtr(Frame->StagingBuffer.Base, DrawStagingAt);
+                    Frame->StagingBuffer.At = DrawStagingAt + DrawByteCount;
+
+                    // NOTE(boti): Runs of consecutive instances get merged into a single copy region,
+                    // which is the common case when registering a large number of instances at once
+                    VkBufferCopy* InstanceCopies = PushArray(Frame->Arena, 0, VkBufferCopy, DirtyCount);
+                    VkBufferCopy* DrawCopies = PushArray(Frame->Arena, 0, VkBufferCopy, DirtyCount);
+                    u32 CopyCount = 0;
+                    u32 PrevInstanceIndex = Scene->InvalidIndex;
+                    for (u32 DirtyIndex = 0; DirtyIndex < DirtyCount; DirtyIndex++)
                     {
-                        .srcOffset = Frame->StagingBuffer.At,
-                        .dstOffset = InstanceBufferRange.ByteOffset,
-                        .size = InstanceBufferRange.ByteCount,
-                    };
-                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->PerFrameBuffer, 1, &Copy);
+                        u32 InstanceIndex = DirtyList[DirtyIndex];
+                        IsDirty[InstanceIndex] = false;
+
+                        InstanceStaging[DirtyIndex] = Scene->Instances[InstanceIndex];
+                        DrawStaging[DirtyIndex] = Scene->IndirectCommands[InstanceIndex];
 
-                    Frame->StagingBuffer.At += InstanceBufferRange.ByteCount;
+                        if (CopyCount && (InstanceIndex == PrevInstanceIndex + 1))
+                        {
+                            InstanceCopies[CopyCount - 1].size += sizeof(instance_data);
+                            DrawCopies[CopyCount - 1].size += sizeof(VkDrawIndexedIndirectCommand);
+                        }
+                        else
+                        {
+                            InstanceCopies[CopyCount] = 
+                            {
+                                .srcOffset = InstanceStagingAt + DirtyIndex * sizeof(instance_data),
+                                .dstOffset = InstanceIndex * sizeof(instance_data),
+                                .size = sizeof(instance_data),
+                            };
+                            DrawCopies[CopyCount] = 
+                            {
+                                .srcOffset = DrawStagingAt + DirtyIndex * sizeof(VkDrawIndexedIndirectCommand),
+                                .dstOffset = InstanceIndex * sizeof(VkDrawIndexedIndirectCommand),
+                                .size = sizeof(VkDrawIndexedIndirectCommand),
+                            };
+                            CopyCount++;
+                        }
+                        PrevInstanceIndex = InstanceIndex;
+                    }
+                    Scene->DirtyCounts[Frame->FrameID] = 0;
+
+                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], InstanceBuffer, CopyCount, InstanceCopies);
+                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], DrawDataBuffer, CopyCount, DrawCopies);
                 }
                 else
                 {
-                    UnhandledError("Out of staging memory when uploading instance data");
+                    UnhandledError("Out of staging memory when uploading retained instance data");
                 }
             }
 
-            // Upload (global) draw data
-            gpu_buffer_range GlobalDrawBufferRange = PushPerFrame(InstanceCount * sizeof(VkDrawIndexedIndirectCommand));
-            Frame->Uniforms.DrawBufferAddress = GlobalDrawBufferRange.Address;
-            if (GlobalDrawBufferRange.ByteCount)
+            // Upload immediate instance data
+            if (InstanceCount)
             {
-                Frame->StagingBuffer.At = Align(Frame->StagingBuffer.At, alignof(VkDrawIndexedIndirectCommand));
-                if (Frame->StagingBuffer.At + GlobalDrawBufferRange.ByteCount <= Frame->StagingBuffer.Size)
+                umm InstanceByteCount = InstanceCount * sizeof(instance_data);
+                umm DrawByteCount = InstanceCount * sizeof(VkDrawIndexedIndirectCommand);
+                umm InstanceStagingAt = Align(Frame->StagingBuffer.At, alignof(instance_data));
+                umm DrawStagingAt = Align(InstanceStagingAt + InstanceByteCount, alignof(VkDrawIndexedIndirectCommand));
+                if (DrawStagingAt + DrawByteCount <= Frame->StagingBuffer.Size)
                 {
-                    memcpy(OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At), IndirectCommands, GlobalDrawBufferRange.ByteCount);
-                    VkBufferCopy Copy = 
+                    memcpy(OffsetPtr(Frame->StagingBuffer.Base, InstanceStagingAt), Instances, InstanceByteCount);
+                    memcpy(OffsetPtr(Frame->StagingBuffer.Base, DrawStagingAt), IndirectCommands, DrawByteCount);
+                    Frame->StagingBuffer.At = DrawStagingAt + DrawByteCount;
+
+                    VkBufferCopy InstanceCopy = 
                     {
-                        .srcOffset = Frame->StagingBuffer.At,
-                        .dstOffset = GlobalDrawBufferRange.ByteOffset,
-                        .size = GlobalDrawBufferRange.ByteCount,
+                        .srcOffset = InstanceStagingAt,
+                        .dstOffset = Scene->MaxInstanceCount * sizeof(instance_data),
+                        .size = InstanceByteCount,
                     };
-                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], Renderer->PerFrameBuffer, 1, &Copy);
+                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], InstanceBuffer, 1, &InstanceCopy);
 
-                    Frame->StagingBuffer.At += GlobalDrawBufferRange.ByteCount;
+                    VkBufferCopy DrawCopy = 
+                    {
+                        .srcOffset = DrawStagingAt,
+                        .dstOffset = Scene->MaxInstanceCount * sizeof(VkDrawIndexedIndirectCommand),
+                        .size = DrawByteCount,
+                    };
+                    vkCmdCopyBuffer(UploadCB, Renderer->StagingBuffers[Frame->FrameID], DrawDataBuffer, 1, &DrawCopy);
                 }
                 else
                 {
-                    UnhandledError("Out of staging memory when uploading draw data");
+                    UnhandledError("Out of staging memory when uploading instance data");
                 }
             }
         }
@@ -3545,95 +4102,225 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
             frustum*                        Frustum;
             
             // Scene info
+            retained_scene*                 RetainedScene;
             u32*                            DrawGroupOffsets;
             mmbox*                          BoundingBoxes;
             m4*                             Transforms;
             VkDrawIndexedIndirectCommand*   IndirectCommands;
-            u32                             InstanceCount;
             
+            instance_data*                  Instances;
+            
+            // NOTE(boti): Only set for the primary view, the draws get sorted by MakeDrawSortKey().
+            // The worker writes the unsorted commands to SortCommands, then gathers them into CopyDst after sorting
+            // (unless there are too many of them, in which case the sort happens on the whole work queue afterwards)
+            u64*                            SortKeys;
+            u32*                            SortIndices;
+            VkDrawIndexedIndirectCommand*   SortCommands;
+            v3                              CameraP;
+            v3                              CameraForward;
+
+            // NOTE(boti): Shadow lists only contain either the retained (static) or the immediate (dynamic) instances
+            b32 SkipRetained;
+            b32 SkipImmediate;
+
             // NOTE(boti): Filled by worker
             u32 TotalDrawCount;
+            b32 IsSorted;
 
-            u32 Padding[14];
+            u32 Padding[8];
         };
         static_assert(sizeof(draw_list_work_params) % 64 == 0);
 
+        // NOTE(boti): Above this many draws the primary view gets sorted on the whole work queue
+        constexpr u32 SerialSortThreshold = 1u << 16;
+
         draw_list_work_params* WorkParams = (draw_list_work_params*)PushSize_(Frame->Arena, MemPush_Clear, sizeof(draw_list_work_params) * DrawListCount, 64);
         auto FrustumCullDrawList = [](thread_context* ThreadContext, void* Params_)
         {
             TimedFunctionMT(Platform.Profiler, ThreadContext->ThreadID);
 
             draw_list_work_params* Params = (draw_list_work_params*)Params_;
+            retained_scene* Scene = Params->RetainedScene;
             VkDrawIndexedIndirectCommand* At = Params->CopyDst;
 
-            u32 CurrentGroupIndex = 0;
-            for (u32 InstanceIndex = 0; InstanceIndex < Params->InstanceCount; InstanceIndex++)
+            // NOTE(boti): The output has to be ordered by group, so the retained and immediate instances
+            // get interleaved on a per-group basis
+            b32 DoSort = (Params->SortKeys != nullptr);
+            auto PushDraw = [&](draw_group Group, const VkDrawIndexedIndirectCommand& Command, 
+                                mmbox Box, const m4& Transform, const renderer_material* Material)
+            {
+                if (DoSort)
+                {
+                    v3 CenterP = TransformPoint(Transform, 0.5f * (Box.Min + Box.Max));
+                    f32 Depth = Dot(CenterP - Params->CameraP, Params->CameraForward);
+                    Params->SortKeys[Params->TotalDrawCount] = MakeDrawSortKey(Group, Material, Depth);
+                    Params->SortIndices[Params->TotalDrawCount] = Params->TotalDrawCount;
+                    Params->SortCommands[Params->TotalDrawCount] = Command;
+                }
+                else
+                {
+                    *At++ = Command;
+                }
+                Params->TotalDrawCount++;
+                Params->DrawList->DrawGroupDrawCounts[Group]++;
+            };
+
+            u32 GroupBegin = 0;
+            for (u32 GroupIndex = 0; GroupIndex < DrawGroup_Count; GroupIndex++)
             {
-                while (InstanceIndex >= Params->DrawGroupOffsets[CurrentGroupIndex])
+                u32 RetainedCount = Params->SkipRetained ? 0 : Scene->GroupInstanceCounts[GroupIndex];
+                for (u32 RetainedIndex = 0; RetainedIndex < RetainedCount; RetainedIndex++)
                 {
-                    CurrentGroupIndex++;
+                    u32 InstanceIndex = Scene->GroupInstances[GroupIndex][RetainedIndex];
+
+                    b32 IsVisible = true;
+                    if (Params->Frustum)
+                    {
+                        IsVisible = IntersectFrustumBox(Params->Frustum, Scene->BoundingBoxes[InstanceIndex], Scene->Transforms[InstanceIndex]);
+                    }
+
+                    if (IsVisible)
+                    {
+                        PushDraw(GroupIndex, Scene->IndirectCommands[InstanceIndex], Scene->BoundingBoxes[InstanceIndex], 
+                                 Scene->Transforms[InstanceIndex], &Scene->Instances[InstanceIndex].Material);
+                    }
                 }
 
-                b32 IsVisible = true;
-                if (Params->Frustum)
+                u32 GroupEnd = Params->DrawGroupOffsets[GroupIndex];
+                if (Params->SkipImmediate)
+                {
+                    GroupBegin = GroupEnd;
+                }
+                for (u32 InstanceIndex = GroupBegin; InstanceIndex < GroupEnd; InstanceIndex++)
                 {
-                    IsVisible = IntersectFrustumBox(Params->Frustum, Params->BoundingBoxes[InstanceIndex], Params->Transforms[InstanceIndex]);
+                    b32 IsVisible = true;
+                    if (Params->Frustum)
+                    {
+                        IsVisible = IntersectFrustumBox(Params->Frustum, Params->BoundingBoxes[InstanceIndex], Params->Transforms[InstanceIndex]);
+                    }
+
+                    if (IsVisible)
+                    {
+                        PushDraw(GroupIndex, Params->IndirectCommands[InstanceIndex], Params->BoundingBoxes[InstanceIndex],
+                                 Params->Transforms[InstanceIndex], &Params->Instances[InstanceIndex].Material);
+                    }
                 }
+                GroupBegin = GroupEnd;
+            }
 
-                if (IsVisible)
+            if (DoSort && (Params->TotalDrawCount <= SerialSortThreshold))
+            {
+                u32 Count = Params->TotalDrawCount;
+                // NOTE(boti): The temp arrays are right after the keys/indices, see the allocation below
+                RadixSort64(Count, Params->SortKeys, Params->SortIndices, Params->SortKeys + Count, Params->SortIndices + Count);
+                for (u32 Index = 0; Index < Count; Index++)
                 {
-                    Params->TotalDrawCount++;
-                    Params->DrawList->DrawGroupDrawCounts[CurrentGroupIndex]++;
-                    *At++ = Params->IndirectCommands[InstanceIndex];
+                    At[Index] = Params->SortCommands[Params->SortIndices[Index]];
                 }
+                Params->IsSorted = true;
             }
         };
 
         Frame->StagingBuffer.At = Align(Frame->StagingBuffer.At, alignof(VkDrawIndexedIndirectCommand));
         Assert(Frame->StagingBuffer.At <= Frame->StagingBuffer.Size);
-        umm MaxMemorySizePerDrawList = InstanceCount * sizeof(VkDrawIndexedIndirectCommand);
+        u32 RetainedInstanceCount = 0;
+        for (u32 GroupIndex = 0; GroupIndex < DrawGroup_Count; GroupIndex++)
+        {
+            RetainedInstanceCount += Renderer->RetainedScene.GroupInstanceCounts[GroupIndex];
+        }
         for (u32 DrawListIndex = 0; DrawListIndex < DrawListCount; DrawListIndex++)
         {
             draw_list_work_params* Params = WorkParams + DrawListIndex;
+            Params->RetainedScene       = &Renderer->RetainedScene;
             Params->DrawGroupOffsets    = DrawGroupOffsets;
             Params->BoundingBoxes       = BoundingBoxes;
             Params->Transforms          = Transforms;
             Params->IndirectCommands    = IndirectCommands;
-            Params->InstanceCount       = InstanceCount;
+            Params->Instances           = Instances;
 
             if (DrawListIndex == 0)
             {
                 Params->Frustum = &Frame->CameraFrustum;
                 Params->DrawList = &PrimaryDrawList;
+
+                // NOTE(boti): Keys and indices have room for the temp arrays of the sort too
+                u32 Capacity = RetainedInstanceCount + InstanceCount;
+                Params->SortKeys = PushArray(Frame->Arena, 0, u64, 2 * Capacity);
+                Params->SortIndices = PushArray(Frame->Arena, 0, u32, 2 * Capacity);
+                Params->SortCommands = PushArray(Frame->Arena, 0, VkDrawIndexedIndirectCommand, Capacity);
+                Params->CameraP = Frame->CameraTransform.P.XYZ;
+                Params->CameraForward = Frame->CameraTransform.Z.XYZ;
             }
-            else if ((DrawListIndex - 1) < R_MaxShadowCascadeCount)
+            else if ((DrawListIndex - 1) < CascadeJobCount)
             {
-                u32 Index = DrawListIndex - 1;
-                Params->Frustum = CascadeFrustums + Index;
-                Params->DrawList = CascadeDrawLists + Index;
+                u32 Job = CascadeJobs[DrawListIndex - 1];
+                u32 Index = Job & ~StaticCascadeJobBit;
+                if (Job & StaticCascadeJobBit)
+                {
+                    Params->Frustum = StaticCascadeFrustums + Index;
+                    Params->DrawList = StaticCascadeDrawLists + Index;
+                    Params->SkipImmediate = true;
+                }
+                else
+                {
+                    Params->Frustum = CascadeFrustums + Index;
+                    Params->DrawList = CascadeDrawLists + Index;
+                    Params->SkipRetained = true;
+                }
             }
             else
             {
-                u32 Index = (DrawListIndex - 1 - R_MaxShadowCascadeCount);
+                u32 Face = ShadowFaces[DrawListIndex - 1 - CascadeJobCount];
+                u32 Index = Face & ~StaticShadowFaceBit;
                 Params->Frustum = ShadowFrustums + Index;
-                Params->DrawList = ShadowDrawLists + Index;
+                if (Face & StaticShadowFaceBit)
+                {
+                    Params->DrawList = StaticShadowDrawLists + Index;
+                    Params->SkipImmediate = true;
+                }
+                else
+                {
+                    Params->DrawList = ShadowDrawLists + Index;
+                    Params->SkipRetained = true;
+                }
             }
 
-            if ((Frame->StagingBuffer.At + MaxMemorySizePerDrawList) > Frame->StagingBuffer.Size)
+            // NOTE(boti): Only the primary list can contain both the retained and the immediate instances,
+            // the shadow lists are sized for the half they actually cull
+            u32 MaxDrawCount = 
+                (Params->SkipRetained ? 0 : RetainedInstanceCount) + 
+                (Params->SkipImmediate ? 0 : InstanceCount);
+            umm MaxMemorySize = (umm)MaxDrawCount * sizeof(VkDrawIndexedIndirectCommand);
+            if ((Frame->StagingBuffer.At + MaxMemorySize) > Frame->StagingBuffer.Size)
             {
+                // NOTE(boti): The list stays empty, but the rest of them still get a chance to fit
                 UnimplementedCodePath;
-                break;
+                continue;
             }
 
             Params->CopyDstOffset   = Frame->StagingBuffer.At;
             Params->CopyDst         = (VkDrawIndexedIndirectCommand*)OffsetPtr(Frame->StagingBuffer.Base, Frame->StagingBuffer.At);
-            Frame->StagingBuffer.At += MaxMemorySizePerDrawList;
+            Frame->StagingBuffer.At += MaxMemorySize;
 
             Platform.AddWorkEntry(Platform.Queue, FrustumCullDrawList, Params);
         }
 
         Platform.CompleteAllWork(Platform.Queue, ThreadContext);
 
+        for (u32 DrawListIndex = 0; DrawListIndex < DrawListCount; DrawListIndex++)
+        {
+            draw_list_work_params* Params = WorkParams + DrawListIndex;
+            if (Params->SortKeys && !Params->IsSorted)
+            {
+                ParallelRadixSort64(Params->TotalDrawCount, Params->SortKeys, Params->SortIndices, ThreadContext, Frame->Arena);
+                for (u32 Index = 0; Index < Params->TotalDrawCount; Index++)
+                {
+                    Params->CopyDst[Index] = Params->SortCommands[Params->SortIndices[Index]];
+                }
+                Params->IsSorted = true;
+            }
+        }
+
         for (u32 DrawListIndex = 0; DrawListIndex < DrawListCount; DrawListIndex++)
         {
             draw_list_work_params* Params = WorkParams + DrawListIndex;
@@ -3677,7 +4364,11 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
         };
         PushBeginBarrier(&FrameStages[FrameStage_Upload], &BeginBarrier);
 
-        vkCmdFillBuffer(UploadCB, Renderer->MipFeedbackBuffer, 0, VK_WHOLE_SIZE, 0);
+        // NOTE(boti): Texture IDs past the current count can't be sampled in this frame, so those entries are never written or read back
+        if (Renderer->TextureManager.TextureCount)
+        {
+            vkCmdFillBuffer(UploadCB, Renderer->MipFeedbackBuffer, 0, Renderer->TextureManager.TextureCount * sizeof(u32), 0);
+        }
     }
 
     EndCommandBuffer(UploadCB);
@@ -3701,14 +4392,14 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
                 .Binding = Binding_PerFrame_ParticleTexture,
                 .BaseIndex = 0,
                 .Count = 1,
-                .Images = { { GetTexture(&Renderer->TextureManager, Frame->ParticleTextureID)->ViewHandle, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } },
+                .Images = { { GetTextureImage(&Renderer->TextureManager, Frame->ParticleTextureID)->ViewHandle, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } },
             },
             {
                 .Type = Descriptor_SampledImage,
                 .Binding = Binding_PerFrame_TextureUI,
                 .BaseIndex = 0,
                 .Count = 1,
-                .Images = { { GetTexture(&Renderer->TextureManager, Frame->ImmediateTextureID)->ViewHandle, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } },
+                .Images = { { GetTextureImage(&Renderer->TextureManager, Frame->ImmediateTextureID)->ViewHandle, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } },
             },
         };
         static_assert(CountOf(PerFrameWrites) == Binding_PerFrame_Count);
@@ -4311,35 +5002,79 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
     //
     // Cascaded shadows
     //
+    // NOTE(boti): Only the scheduled cascades get rendered: their static layers are either kept, scrolled or rebuilt,
+    // and the sampled cascades are the static layers with the dynamic casters on top (see ShadowCache.hpp).
+    // The rest of the cascades keep their contents (and layout) from the previous frames.
+    u32 UpdatedCascadeCount = 0;
+    u32 UpdatedCascades[R_MaxShadowCascadeCount];
+    for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+    {
+        draw_list* List = CascadeDrawLists + CascadeIndex;
+        b32 HasDynamicCasters = false;
+        for (u32 Group = 0; Group < DrawGroup_Count; Group++)
+        {
+            HasDynamicCasters |= (List->DrawGroupDrawCounts[Group] != 0);
+        }
+
+        if (UpdateCascadeShadow(&Renderer->CascadeShadowCache, CascadeIndex, CascadeUpdates + CascadeIndex, HasDynamicCasters))
+        {
+            UpdatedCascades[UpdatedCascadeCount++] = CascadeIndex;
+        }
+    }
+
+    BeginFrameStage(ShadowCmd, FrameStage_CascadedShadow, Renderer->PerformanceQueryPools[Frame->FrameID], FrameStages);
     {
-        VkImageMemoryBarrier2 Barrier = 
+        u32 BarrierCount = 0;
+        VkImageMemoryBarrier2 Barriers[2 * R_MaxShadowCascadeCount];
+        auto PushCascadeBarrier = [&](VkImage Image, u32 Layer,
+                                      VkPipelineStageFlags2 SrcStage, VkAccessFlags2 SrcAccess, VkImageLayout OldLayout,
+                                      VkPipelineStageFlags2 DstStage, VkAccessFlags2 DstAccess, VkImageLayout NewLayout)
         {
-            
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-            .pNext = nullptr,
-            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-            .srcAccessMask = VK_ACCESS_2_NONE,
-            .dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
-            .dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = Frame->Renderer->CascadeMap,
-            .subresourceRange = 
+            Assert(BarrierCount < CountOf(Barriers));
+            Barriers[BarrierCount++] = 
             {
-                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = R_MaxShadowCascadeCount,
-            },   
+                .sType                  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .pNext                  = nullptr,
+                .srcStageMask           = SrcStage,
+                .srcAccessMask          = SrcAccess,
+                .dstStageMask           = DstStage,
+                .dstAccessMask          = DstAccess,
+                .oldLayout              = OldLayout,
+                .newLayout              = NewLayout,
+                .srcQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
+                .image                  = Image,
+                .subresourceRange       = 
+                {
+                    .aspectMask         = VK_IMAGE_ASPECT_DEPTH_BIT,
+                    .baseMipLevel       = 0,
+                    .levelCount         = 1,
+                    .baseArrayLayer     = Layer,
+                    .layerCount         = 1,
+                },
+            };
+        };
+        auto FlushCascadeBarriers = [&]()
+        {
+            if (BarrierCount)
+            {
+                VkDependencyInfo Dependency = 
+                {
+                    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                    .pNext = nullptr,
+                    .dependencyFlags = 0,
+                    .imageMemoryBarrierCount = BarrierCount,
+                    .pImageMemoryBarriers = Barriers,
+                };
+                vkCmdPipelineBarrier2(ShadowCmd, &Dependency);
+                BarrierCount = 0;
+            }
         };
-        PushBeginBarrier(&FrameStages[FrameStage_CascadedShadow], &Barrier);
-    }
 
-    BeginFrameStage(ShadowCmd, FrameStage_CascadedShadow, Renderer->PerformanceQueryPools[Frame->FrameID], FrameStages);
-    {
+        constexpr VkPipelineStageFlags2 DepthStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT|VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        constexpr VkAccessFlags2 DepthAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+
+        // NOTE(boti): The viewport isn't flipped, the scroll copies rely on clip-space +Y being texel +Y (see GetCascadeScrollCopy)
         VkViewport ShadowViewport = 
         {
             .x = 0.0f,
@@ -4349,25 +5084,28 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
             .minDepth = 0.0f,
             .maxDepth = 1.0f,
         };
-        VkRect2D ShadowScissor = 
-        {
-            .offset = { 0, 0 },
-            .extent = { R_ShadowResolution, R_ShadowResolution },
-        };
         vkCmdSetViewport(ShadowCmd, 0, 1, &ShadowViewport);
-        vkCmdSetScissor(ShadowCmd, 0, 1, &ShadowScissor);
-        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+
+        // NOTE(boti): Only the region gets cleared/rendered to
+        auto RenderCascade = [&](VkImageView View, VkAttachmentLoadOp LoadOp, cascade_strip Region, m4 ViewProjection, draw_list* List)
         {
+            VkRect2D RenderArea = 
+            {
+                .offset = { (s32)Region.X, (s32)Region.Y },
+                .extent = { Region.Width, Region.Height },
+            };
+            vkCmdSetScissor(ShadowCmd, 0, 1, &RenderArea);
+
             VkRenderingAttachmentInfo DepthAttachment = 
             {
                 .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
                 .pNext = nullptr,
-                .imageView = Frame->Renderer->CascadeViews[CascadeIndex],
+                .imageView = View,
                 .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
                 .resolveMode = VK_RESOLVE_MODE_NONE,
                 .resolveImageView = VK_NULL_HANDLE,
                 .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .loadOp = LoadOp,
                 .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
                 .clearValue = { .depthStencil = { 1.0, 0 } },
             };
@@ -4377,7 +5115,7 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
                 .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
                 .pNext = nullptr,
                 .flags = 0,
-                .renderArea = { { 0, 0 } , { R_ShadowResolution, R_ShadowResolution } },
+                .renderArea = RenderArea,
                 .layerCount = 1,
                 .viewMask = 0,
                 .colorAttachmentCount = 0,
@@ -4388,7 +5126,6 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
             
             vkCmdBeginRendering(ShadowCmd, &RenderingInfo);
 
-            m4 ViewProjection = Frame->Uniforms.CascadeViewProjections[CascadeIndex];
             vkCmdPushConstants(ShadowCmd, Renderer->SystemPipelineLayout,
                                VK_SHADER_STAGE_ALL,
                                0, sizeof(ViewProjection), &ViewProjection);
@@ -4399,185 +5136,439 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
                 [DrawGroup_AlphaTest]   = Pipeline_ShadowCascade_AlphaTest,
                 [DrawGroup_Transparent] = Pipeline_None,
             };
-            DrawList(Frame, ShadowCmd, Pipelines, CascadeDrawLists + CascadeIndex);
+            DrawList(Frame, ShadowCmd, Pipelines, List);
 
             vkCmdEndRendering(ShadowCmd);
+        };
+
+        constexpr cascade_strip FullRegion = { 0, 0, R_ShadowResolution, R_ShadowResolution };
 
-            VkMemoryBarrier Barrier = 
+        // Static layers
+        // NOTE(boti): The previous contents of the layers that get overwritten have only ever been read by copies
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            cascade_shadow_update* Update = CascadeUpdates + CascadeIndex;
+            u32 DstLayer = 2*CascadeIndex + Update->DstStaticLayer;
+            if (Update->IsStaticRebuilt)
             {
-                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-                .pNext = nullptr,
-                .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-                .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_SHADER_READ_BIT,
+                PushCascadeBarrier(Renderer->CascadeStaticMap, DstLayer,
+                                   VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                                   DepthStages, DepthAccess, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            }
+            else if (Update->IsScrolled)
+            {
+                PushCascadeBarrier(Renderer->CascadeStaticMap, DstLayer,
+                                   VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                                   VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            }
+        }
+        FlushCascadeBarriers();
+
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            cascade_shadow_update* Update = CascadeUpdates + CascadeIndex;
+            if (Update->IsScrolled)
+            {
+                cascade_scroll_copy Region = GetCascadeScrollCopy(Update);
+                VkImageCopy Copy = 
+                {
+                    .srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 2*CascadeIndex + Update->SrcStaticLayer, 1 },
+                    .srcOffset = { (s32)Region.SrcX, (s32)Region.SrcY, 0 },
+                    .dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 2*CascadeIndex + Update->DstStaticLayer, 1 },
+                    .dstOffset = { (s32)Region.DstX, (s32)Region.DstY, 0 },
+                    .extent = { Region.Width, Region.Height, 1 },
+                };
+                vkCmdCopyImage(ShadowCmd, 
+                               Renderer->CascadeStaticMap, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               Renderer->CascadeStaticMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1, &Copy);
+
+                PushCascadeBarrier(Renderer->CascadeStaticMap, 2*CascadeIndex + Update->DstStaticLayer,
+                                   VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   DepthStages, DepthAccess, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            }
+        }
+        FlushCascadeBarriers();
+
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            cascade_shadow_update* Update = CascadeUpdates + CascadeIndex;
+            u32 DstLayer = 2*CascadeIndex + Update->DstStaticLayer;
+            m4 ViewProjection = Frame->Uniforms.CascadeViewProjections[CascadeIndex];
+            if (Update->IsStaticRebuilt)
+            {
+                RenderCascade(Renderer->CascadeStaticViews[DstLayer], VK_ATTACHMENT_LOAD_OP_CLEAR, FullRegion,
+                              ViewProjection, StaticCascadeDrawLists + 2*CascadeIndex);
+            }
+            else if (Update->IsScrolled)
+            {
+                for (u32 StripIndex = 0; StripIndex < Update->StripCount; StripIndex++)
+                {
+                    RenderCascade(Renderer->CascadeStaticViews[DstLayer], VK_ATTACHMENT_LOAD_OP_CLEAR, Update->Strips[StripIndex],
+                                  ViewProjection, StaticCascadeDrawLists + (2*CascadeIndex + StripIndex));
+                }
+            }
+
+            // NOTE(boti): The static layers stay in TRANSFER_SRC until they get rebuilt or scrolled into
+            if (Update->IsStaticRebuilt || Update->IsScrolled)
+            {
+                PushCascadeBarrier(Renderer->CascadeStaticMap, DstLayer,
+                                   DepthStages, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                   VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            }
+        }
+
+        // Sampled cascades
+        for (u32 Index = 0; Index < UpdatedCascadeCount; Index++)
+        {
+            PushCascadeBarrier(Renderer->CascadeMap, UpdatedCascades[Index],
+                               VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                               VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        }
+        FlushCascadeBarriers();
+
+        for (u32 Index = 0; Index < UpdatedCascadeCount; Index++)
+        {
+            u32 CascadeIndex = UpdatedCascades[Index];
+            VkImageCopy Copy = 
+            {
+                .srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 2*CascadeIndex + CascadeUpdates[CascadeIndex].DstStaticLayer, 1 },
+                .srcOffset = { 0, 0, 0 },
+                .dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, CascadeIndex, 1 },
+                .dstOffset = { 0, 0, 0 },
+                .extent = { R_ShadowResolution, R_ShadowResolution, 1 },
             };
-            vkCmdPipelineBarrier(ShadowCmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 
-                                 1, &Barrier, 0, nullptr, 0, nullptr);
+            vkCmdCopyImage(ShadowCmd, 
+                           Renderer->CascadeStaticMap, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           Renderer->CascadeMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &Copy);
+
+            PushCascadeBarrier(Renderer->CascadeMap, CascadeIndex,
+                               VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               DepthStages, DepthAccess, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
         }
+        FlushCascadeBarriers();
 
-        VkImageMemoryBarrier2 Barrier =
+        for (u32 Index = 0; Index < UpdatedCascadeCount; Index++)
         {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-            .pNext = nullptr,
-            .srcStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-            .srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-            .dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = Renderer->CascadeMap,
-            .subresourceRange = 
+            u32 CascadeIndex = UpdatedCascades[Index];
+            draw_list* List = CascadeDrawLists + CascadeIndex;
+            b32 IsEmpty = true;
+            for (u32 Group = 0; Group < DrawGroup_Count; Group++)
             {
-                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = R_MaxShadowCascadeCount,
-            },
-        };
-        PushBeginBarrier(&FrameStages[FrameStage_Shading], &Barrier);
+                IsEmpty &= (List->DrawGroupDrawCounts[Group] == 0);
+            }
+
+            if (!IsEmpty)
+            {
+                RenderCascade(Renderer->CascadeViews[CascadeIndex], VK_ATTACHMENT_LOAD_OP_LOAD, FullRegion,
+                              Frame->Uniforms.CascadeViewProjections[CascadeIndex], List);
+            }
+
+            VkImageMemoryBarrier2 Barrier =
+            {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .pNext = nullptr,
+                .srcStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
+                .srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                .dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = Renderer->CascadeMap,
+                .subresourceRange = 
+                {
+                    .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = CascadeIndex,
+                    .layerCount = 1,
+                },
+            };
+            PushBeginBarrier(&FrameStages[FrameStage_Shading], &Barrier);
+        }
     }
     EndFrameStage(ShadowCmd, FrameStage_CascadedShadow, Renderer->PerformanceQueryPools[Frame->FrameID], FrameStages);
 
     //
     // Point shadows
     //
-    for (u32 ShadowIndex = 0; ShadowIndex < ShadowCount; ShadowIndex++)
+    // NOTE(boti): The static layers get rebuilt when they're invalidated, the sampled maps are only updated 
+    // (static layer copy + dynamic casters on top) when there's something dynamic in range now or in the last update
+    u32 UpdatedShadowCount = 0;
+    u32 UpdatedShadowSlots[R_MaxShadowCount];
+    for (u32 Index = 0; Index < ShadowCount; Index++)
     {
-        point_shadow_map* ShadowMap = Renderer->PointShadowMaps + ShadowIndex;
-        VkImageMemoryBarrier2 Barrier = 
+        u32 Slot = ShadowSlots[Index];
+
+        b32 HasDynamicCasters = false;
+        for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
         {
-            .sType                  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-            .pNext                  = nullptr,
-            .srcStageMask           = VK_PIPELINE_STAGE_2_NONE,
-            .srcAccessMask          = VK_ACCESS_2_NONE,
-            .dstStageMask           = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-            .dstAccessMask          = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-            .oldLayout              = VK_IMAGE_LAYOUT_UNDEFINED,
-            .newLayout              = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-            .srcQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
-            .image                  = ShadowMap->Image,
-            .subresourceRange = 
+            draw_list* List = ShadowDrawLists + (6*Slot + LayerIndex);
+            for (u32 Group = 0; Group < DrawGroup_Count; Group++)
             {
-                .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
-                .baseMipLevel   = 0,
-                .levelCount     = 1,
-                .baseArrayLayer = 0,
-                .layerCount     = 6,
-            },
-        };
-        PushBeginBarrier(&FrameStages[FrameStage_Shadows], &Barrier);
+                HasDynamicCasters |= (List->DrawGroupDrawCounts[Group] != 0);
+            }
+        }
+
+        if (UpdatePointShadow(&Renderer->PointShadowCache, Slot, IsShadowStaticRebuilt[Slot], HasDynamicCasters))
+        {
+            UpdatedShadowSlots[UpdatedShadowCount++] = Slot;
+        }
     }
 
     BeginFrameStage(ShadowCmd, FrameStage_Shadows, Renderer->PerformanceQueryPools[Frame->FrameID], FrameStages);
     {
-        VkViewport ShadowViewport = 
-        {
-            .x = 0.0f,
-            .y = 0.0f,
-            .width = (f32)R_PointShadowResolution,
-            .height = (f32)R_PointShadowResolution,
-            .minDepth = 0.0f,
-            .maxDepth = 1.0f,
+        // NOTE(boti): The static atlas rests in TRANSFER_SRC, the sampled atlas in SHADER_READ_ONLY between frames.
+        // Only the tiles of the rebuilt/updated lights get touched, the rest of the atlas contents have to be kept.
+        VkImageSubresourceRange AtlasRange = 
+        {
+            .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
         };
-        VkRect2D ShadowScissor = 
+
+        u32 BarrierCount = 0;
+        VkImageMemoryBarrier2 Barriers[2];
+        auto PushShadowBarrier = [&](VkImage Image, 
+                                     VkPipelineStageFlags2 SrcStage, VkAccessFlags2 SrcAccess, VkImageLayout OldLayout,
+                                     VkPipelineStageFlags2 DstStage, VkAccessFlags2 DstAccess, VkImageLayout NewLayout)
         {
-            .offset = { 0, 0 },
-            .extent = { R_PointShadowResolution, R_PointShadowResolution },
+            Assert(BarrierCount < CountOf(Barriers));
+            Barriers[BarrierCount++] = 
+            {
+                .sType                  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .pNext                  = nullptr,
+                .srcStageMask           = SrcStage,
+                .srcAccessMask          = SrcAccess,
+                .dstStageMask           = DstStage,
+                .dstAccessMask          = DstAccess,
+                .oldLayout              = OldLayout,
+                .newLayout              = NewLayout,
+                .srcQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
+                .image                  = Image,
+                .subresourceRange       = AtlasRange,
+            };
         };
-
-        vkCmdSetViewport(ShadowCmd, 0, 1, &ShadowViewport);
-        vkCmdSetScissor(ShadowCmd, 0, 1, &ShadowScissor);
-        for (u32 ShadowIndex = 0; ShadowIndex < ShadowCount; ShadowIndex++)
+        auto FlushShadowBarriers = [&]()
         {
-            point_shadow_map* ShadowMap = Renderer->PointShadowMaps + ShadowIndex;
-
-            for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+            if (BarrierCount)
             {
-                VkMemoryBarrier Barrier = 
+                VkDependencyInfo Dependency = 
                 {
-                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
                     .pNext = nullptr,
-                    .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-                    .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT|VK_ACCESS_SHADER_READ_BIT,
+                    .dependencyFlags = 0,
+                    .imageMemoryBarrierCount = BarrierCount,
+                    .pImageMemoryBarriers = Barriers,
                 };
-                vkCmdPipelineBarrier(ShadowCmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 
-                                     1, &Barrier, 0, nullptr, 0, nullptr);
+                vkCmdPipelineBarrier2(ShadowCmd, &Dependency);
+                BarrierCount = 0;
+            }
+        };
 
-                VkRenderingAttachmentInfo DepthAttachment = 
-                {
-                    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-                    .pNext = nullptr,
-                    .imageView = ShadowMap->LayerViews[LayerIndex],
-                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-                    .resolveMode = VK_RESOLVE_MODE_NONE,
-                    .resolveImageView = VK_NULL_HANDLE,
-                    .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-                    .clearValue = { .depthStencil = { 1.0f, 0 } },
-                };
-                VkRenderingInfo ShadowRendering = 
-                {
-                    .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-                    .pNext = nullptr,
-                    .flags = 0,
-                    .renderArea = { { 0, 0 }, { R_PointShadowResolution, R_PointShadowResolution } },
-                    .layerCount = 1,
-                    .viewMask = 0,
-                    .colorAttachmentCount = 0,
-                    .pColorAttachments = nullptr,
-                    .pDepthAttachment = &DepthAttachment,
-                    .pStencilAttachment = nullptr,
-                };
-                vkCmdBeginRendering(ShadowCmd, &ShadowRendering);
+        if (!Renderer->IsPointShadowAtlasInitialized)
+        {
+            PushShadowBarrier(Renderer->PointShadowStaticAtlas,
+                              VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            PushShadowBarrier(Renderer->PointShadowAtlas,
+                              VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            FlushShadowBarriers();
+            Renderer->IsPointShadowAtlasInitialized = true;
+        }
+
+        auto RenderShadowFace = [&](VkImageView View, VkAttachmentLoadOp LoadOp, shadow_atlas_tile Tile, 
+                                    m4 ViewProjection, draw_list* List)
+        {
+            // NOTE(boti): The clear only applies to the render area, i.e. the tile of the face
+            VkRect2D TileRect = 
+            {
+                .offset = { (s32)Tile.X, (s32)Tile.Y },
+                .extent = { Tile.Size, Tile.Size },
+            };
+            VkViewport TileViewport = 
+            {
+                .x = (f32)Tile.X,
+                .y = (f32)Tile.Y,
+                .width = (f32)Tile.Size,
+                .height = (f32)Tile.Size,
+                .minDepth = 0.0f,
+                .maxDepth = 1.0f,
+            };
+
+            VkRenderingAttachmentInfo DepthAttachment = 
+            {
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                .pNext = nullptr,
+                .imageView = View,
+                .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                .resolveMode = VK_RESOLVE_MODE_NONE,
+                .resolveImageView = VK_NULL_HANDLE,
+                .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .loadOp = LoadOp,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .clearValue = { .depthStencil = { 1.0f, 0 } },
+            };
+            VkRenderingInfo ShadowRendering = 
+            {
+                .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .renderArea = TileRect,
+                .layerCount = 1,
+                .viewMask = 0,
+                .colorAttachmentCount = 0,
+                .pColorAttachments = nullptr,
+                .pDepthAttachment = &DepthAttachment,
+                .pStencilAttachment = nullptr,
+            };
+            vkCmdBeginRendering(ShadowCmd, &ShadowRendering);
 
-                m4 ViewProjection = Frame->Uniforms.PointShadows[ShadowIndex].ViewProjections[LayerIndex];
-                vkCmdPushConstants(ShadowCmd, Renderer->SystemPipelineLayout, VK_SHADER_STAGE_ALL,
-                                   0, sizeof(ViewProjection), &ViewProjection);
+            vkCmdSetViewport(ShadowCmd, 0, 1, &TileViewport);
+            vkCmdSetScissor(ShadowCmd, 0, 1, &TileRect);
+            vkCmdPushConstants(ShadowCmd, Renderer->SystemPipelineLayout, VK_SHADER_STAGE_ALL,
+                               0, sizeof(ViewProjection), &ViewProjection);
 
-                pipeline Pipelines[DrawGroup_Count] = 
-                {
-                    [DrawGroup_Opaque]      = Pipeline_Shadow,
-                    [DrawGroup_AlphaTest]   = Pipeline_Shadow_AlphaTest,
-                    [DrawGroup_Transparent] = Pipeline_None,
-                };
-                u32 Index = 6*ShadowIndex + LayerIndex;
-                DrawList(Frame, ShadowCmd, Pipelines, ShadowDrawLists + Index);
+            pipeline Pipelines[DrawGroup_Count] = 
+            {
+                [DrawGroup_Opaque]      = Pipeline_Shadow,
+                [DrawGroup_AlphaTest]   = Pipeline_Shadow_AlphaTest,
+                [DrawGroup_Transparent] = Pipeline_None,
+            };
+            DrawList(Frame, ShadowCmd, Pipelines, List);
+
+            vkCmdEndRendering(ShadowCmd);
+        };
+
+        point_shadow_cache* ShadowCache = &Renderer->PointShadowCache;
+
+        // Static atlas
+        b32 IsAnyStaticRebuilt = false;
+        for (u32 Index = 0; Index < ShadowCount; Index++)
+        {
+            IsAnyStaticRebuilt |= IsShadowStaticRebuilt[ShadowSlots[Index]];
+        }
 
-                vkCmdEndRendering(ShadowCmd);
+        if (IsAnyStaticRebuilt)
+        {
+            PushShadowBarrier(Renderer->PointShadowStaticAtlas,
+                              VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT|VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                              VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                              VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            FlushShadowBarriers();
+
+            for (u32 Index = 0; Index < ShadowCount; Index++)
+            {
+                u32 Slot = ShadowSlots[Index];
+                if (IsShadowStaticRebuilt[Slot])
+                {
+                    point_shadow_cache_entry* Entry = ShadowCache->Entries + Slot;
+                    for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+                    {
+                        RenderShadowFace(Renderer->PointShadowStaticAtlasView, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                         GetShadowAtlasTile(Entry->AtlasNodes[LayerIndex]),
+                                         Frame->Uniforms.PointShadows[Slot].ViewProjections[LayerIndex],
+                                         StaticShadowDrawLists + (6*Slot + LayerIndex));
+                    }
+                }
             }
+
+            PushShadowBarrier(Renderer->PointShadowStaticAtlas,
+                              VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT|VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                              VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                              VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
         }
 
-        for (u32 ShadowIndex = 0; ShadowIndex < ShadowCount; ShadowIndex++)
+        // Sampled atlas
+        if (UpdatedShadowCount)
         {
-            point_shadow_map* ShadowMap = Renderer->PointShadowMaps + ShadowIndex;
+            PushShadowBarrier(Renderer->PointShadowAtlas,
+                              VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE, 
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            FlushShadowBarriers();
+
+            // NOTE(boti): The tiles are at the same place in both atlases, so all of the faces can be copied at once
+            u32 CopyCount = 0;
+            VkImageCopy* Copies = PushArray(Frame->Arena, 0, VkImageCopy, CubeLayer_Count * UpdatedShadowCount);
+            for (u32 Index = 0; Index < UpdatedShadowCount; Index++)
+            {
+                point_shadow_cache_entry* Entry = ShadowCache->Entries + UpdatedShadowSlots[Index];
+                for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+                {
+                    shadow_atlas_tile Tile = GetShadowAtlasTile(Entry->AtlasNodes[LayerIndex]);
+                    Copies[CopyCount++] = 
+                    {
+                        .srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 },
+                        .srcOffset = { (s32)Tile.X, (s32)Tile.Y, 0 },
+                        .dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 },
+                        .dstOffset = { (s32)Tile.X, (s32)Tile.Y, 0 },
+                        .extent = { Tile.Size, Tile.Size, 1 },
+                    };
+                }
+            }
+            vkCmdCopyImage(ShadowCmd, 
+                           Renderer->PointShadowStaticAtlas, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           Renderer->PointShadowAtlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           CopyCount, Copies);
+
+            PushShadowBarrier(Renderer->PointShadowAtlas,
+                              VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT|VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                              VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                              VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            FlushShadowBarriers();
+
+            for (u32 Index = 0; Index < UpdatedShadowCount; Index++)
+            {
+                u32 Slot = UpdatedShadowSlots[Index];
+                point_shadow_cache_entry* Entry = ShadowCache->Entries + Slot;
+                for (u32 LayerIndex = 0; LayerIndex < CubeLayer_Count; LayerIndex++)
+                {
+                    // NOTE(boti): Faces that can't be seen from the camera never get dynamic casters
+                    draw_list* List = ShadowDrawLists + (6*Slot + LayerIndex);
+                    b32 IsEmpty = true;
+                    for (u32 Group = 0; Group < DrawGroup_Count; Group++)
+                    {
+                        IsEmpty &= (List->DrawGroupDrawCounts[Group] == 0);
+                    }
+
+                    if (!IsEmpty)
+                    {
+                        RenderShadowFace(Renderer->PointShadowAtlasView, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                         GetShadowAtlasTile(Entry->AtlasNodes[LayerIndex]),
+                                         Frame->Uniforms.PointShadows[Slot].ViewProjections[LayerIndex], List);
+                    }
+                }
+            }
+
             VkImageMemoryBarrier2 Barrier =
             {
                 .sType                  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
                 .pNext                  = nullptr,
                 .srcStageMask           = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
                 .srcAccessMask          = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT|VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-                .dstStageMask           = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                .dstStageMask           = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT|VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
                 .dstAccessMask          = VK_ACCESS_2_SHADER_READ_BIT,
                 .oldLayout              = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
                 .newLayout              = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                 .srcQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
                 .dstQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED,
-                .image                  = ShadowMap->Image,
-                .subresourceRange = 
-                {
-                    .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
-                    .baseMipLevel   = 0,
-                    .levelCount     = 1,
-                    .baseArrayLayer = 0,
-                    .layerCount     = 6,
-                },
+                .image                  = Renderer->PointShadowAtlas,
+                .subresourceRange       = AtlasRange,
             };
             PushBeginBarrier(&FrameStages[FrameStage_Shading], &Barrier);
         }
+        FlushShadowBarriers();
     }
     EndFrameStage(ShadowCmd, FrameStage_Shadows, Renderer->PerformanceQueryPools[Frame->FrameID], FrameStages);
 
@@ -4845,13 +5836,18 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
         };
         vkCmdPipelineBarrier2(RenderCmd, &BeginDependency);
 
-        VkBufferCopy Copy = 
+        u32 FeedbackCount = Renderer->TextureManager.TextureCount;
+        Renderer->MipReadbackCounts[Frame->FrameID] = FeedbackCount;
+        if (FeedbackCount)
         {
-            .srcOffset = 0,
-            .dstOffset = 0,
-            .size = Renderer->MipFeedbackMemorySize,
-        };
-        vkCmdCopyBuffer(RenderCmd, Renderer->MipFeedbackBuffer, Renderer->MipReadbackBuffers[Frame->FrameID], 1, &Copy);
+            VkBufferCopy Copy = 
+            {
+                .srcOffset = 0,
+                .dstOffset = 0,
+                .size = FeedbackCount * sizeof(u32),
+            };
+            vkCmdCopyBuffer(RenderCmd, Renderer->MipFeedbackBuffer, Renderer->MipReadbackBuffers[Frame->FrameID], 1, &Copy);
+        }
     }
 
     //
@@ -5602,14 +6598,20 @@ extern "C" Signature_EndRenderFrame(EndRenderFrame)
         AddEntry("PerFrame", PerFrameBufferAt, Renderer->PerFrameBufferSize);
         AddEntry("MipFeedback", Renderer->TextureManager.TextureCount * sizeof(u32), Renderer->MipFeedbackMemorySize);
         AddEntry("BAR", Frame->BARBufferAt, Frame->BARBufferSize);
+        AddEntry("RetainedInstances", 
+                 Renderer->RetainedScene.NextInstanceIndex * sizeof(instance_data), 
+                 Renderer->RetainedScene.MaxInstanceCount * sizeof(instance_data));
         AddGPUArenaEntry("RenderTarget", &Renderer->RenderTargetHeap.Arena);
         AddEntry("VertexBuffer", 
-                 Renderer->GeometryBuffer.VertexMemory.CountInUse * Renderer->GeometryBuffer.VertexMemory.Stride, 
-                 Renderer->GeometryBuffer.VertexMemory.MaxCount * Renderer->GeometryBuffer.VertexMemory.Stride);
+                 Renderer->GeometryBuffer.VertexMemory.Allocator.CountInUse * Renderer->GeometryBuffer.VertexMemory.Allocator.Stride, 
+                 Renderer->GeometryBuffer.VertexMemory.Allocator.MaxCount * Renderer->GeometryBuffer.VertexMemory.Allocator.Stride);
         AddEntry("IndexBuffer", 
-                 Renderer->GeometryBuffer.IndexMemory.CountInUse * Renderer->GeometryBuffer.IndexMemory.Stride, 
-                 Renderer->GeometryBuffer.IndexMemory.MaxCount * Renderer->GeometryBuffer.IndexMemory.Stride);
-        AddEntry("TextureCache", Renderer->TextureManager.Cache.UsedPageCount * TexturePageSize, Renderer->TextureManager.Cache.MemorySize);
+                 Renderer->GeometryBuffer.IndexMemory.Allocator.CountInUse * Renderer->GeometryBuffer.IndexMemory.Allocator.Stride, 
+                 Renderer->GeometryBuffer.IndexMemory.Allocator.MaxCount * Renderer->GeometryBuffer.IndexMemory.Allocator.Stride);
+        AddEntry("TextureCache", Renderer->TextureManager.Cache.UsedPageCount * TexturePageSize, Renderer->TextureManager.CacheMemorySize);
+        Stats->TextureCacheFragmentation = GetTextureCacheFragmentation(&Renderer->TextureManager.Cache);
+        Stats->TextureCacheFreeRangeCount = Renderer->TextureManager.Cache.FreeRangeCount;
+        Stats->UploadByteCount = Frame->UploadByteCount;
         AddGPUArenaEntry("TexturePersist", &Renderer->TextureManager.PersistentArena);
         AddGPUArenaEntry("Shadow", &Renderer->ShadowArena);
         AddEntry("Staging", Frame->StagingBuffer.At, Frame->StagingBuffer.Size);
@@ -5624,7 +6626,38 @@ extern "C" Signature_AllocateTexture(AllocateTexture)
     return(Result);
 }
 
-internal void SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums)
+// NOTE(boti): Frustum of a texel region of the cascade, for culling the static casters of the scrolled-in strips
+internal frustum GetCascadeStripFrustum(m4 CascadeViewProjection, cascade_strip Strip)
+{
+    f32 MinX = 2.0f * (f32)Strip.X / (f32)R_ShadowResolution - 1.0f;
+    f32 MaxX = 2.0f * (f32)(Strip.X + Strip.Width) / (f32)R_ShadowResolution - 1.0f;
+    f32 MinY = 2.0f * (f32)Strip.Y / (f32)R_ShadowResolution - 1.0f;
+    f32 MaxY = 2.0f * (f32)(Strip.Y + Strip.Height) / (f32)R_ShadowResolution - 1.0f;
+
+    // NOTE(boti): The near plane is disabled, same as for the whole cascade
+    frustum ClipSpaceFrustum = 
+    {
+        .Planes = 
+        {
+            { +1.0f,  0.0f,  0.0f, -MinX },
+            { -1.0f,  0.0f,  0.0f, +MaxX },
+            {  0.0f, +1.0f,  0.0f, -MinY },
+            {  0.0f, -1.0f,  0.0f, +MaxY },
+            {  0.0f,  0.0f,  0.0f,  0.0f },
+            {  0.0f,  0.0f, -1.0f, +1.0f },
+        },
+    };
+
+    frustum Result;
+    for (u32 PlaneIndex = 0; PlaneIndex < 6; PlaneIndex++)
+    {
+        Result.Planes[PlaneIndex] = ClipSpaceFrustum.Planes[PlaneIndex] * CascadeViewProjection;
+    }
+    return(Result);
+}
+
+internal void SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums, frustum* StaticCascadeFrustums, 
+                                  cascade_shadow_update* CascadeUpdates)
 {
     // Shadow cascade setup
     {
@@ -5655,6 +6688,9 @@ internal void SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums)
             SunZ.X, SunZ.Y, SunZ.Z, 0.0f,
             0.0f, 0.0f, 0.0f, 1.0f);
         m4 CameraToSun = SunView * Frame->CameraTransform;
+
+        cascade_shadow_cache* Cache = &Frame->Renderer->CascadeShadowCache;
+        BeginCascadeShadowCacheFrame(Cache, SunView);
     
         f32 SplitFactor = 0.1f;
         f32 Splits[] = { 8.0f, 16.0f, 32.0f, 64.0f };
@@ -5694,10 +6730,9 @@ internal void SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums)
         f32 s = Frame->Uniforms.AspectRatio;
         f32 g = Frame->Uniforms.FocalLength;
 
-        f32 MinZ0;
-        f32 MaxZ0;
+        f32 DepthRange0;
         v3 CascadeP0;
-        f32 CascadeScale0;
+        f32 Extent0;
         for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
         {
             f32 Nd = NdTable[CascadeIndex];
@@ -5744,35 +6779,27 @@ internal void SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums)
                 };
             }
 
-            f32 TexelSize = CascadeScale / (f32)R_ShadowResolution;
+            // NOTE(boti): Cascades that don't get updated this frame keep their old placement,
+            // so that the uniforms match what's in the shadow map
+            cascade_placement Placement;
+            cascade_shadow_update* Update = CascadeUpdates + CascadeIndex;
+            *Update = ScheduleCascadeShadow(Cache, CascadeIndex, CascadeBoxMin, CascadeBoxMax, CascadeScale, &Placement);
 
-            v3 CascadeP = 
-            {
-                TexelSize * Floor((CascadeBoxMax.X + CascadeBoxMin.X) / (2.0f * TexelSize)),
-                TexelSize * Floor((CascadeBoxMax.Y + CascadeBoxMin.Y) / (2.0f * TexelSize)),
-                CascadeBoxMin.Z,
-            };
+            f32 Extent = Placement.Extent;
+            f32 DepthRange = GetCascadeDepthRange(Extent);
+            v3 CascadeP = GetCascadeP(Placement);
 
-            m4 CascadeView = M4(SunX.X, SunX.Y, SunX.Z, -CascadeP.X,
-                                SunY.X, SunY.Y, SunY.Z, -CascadeP.Y,
-                                SunZ.X, SunZ.Y, SunZ.Z, -CascadeP.Z,
+            m4 CascadeView = M4(SunX.X, SunX.Y, SunX.Z, 0.0f,
+                                SunY.X, SunY.Y, SunY.Z, 0.0f,
+                                SunZ.X, SunZ.Y, SunZ.Z, 0.0f,
                                 0.0f, 0.0f, 0.0f, 1.0f);
-            m4 CascadeProjection = M4(2.0f / CascadeScale, 0.0f, 0.0f, 0.0f,
-                                      0.0f, 2.0f / CascadeScale, 0.0f, 0.0f,
-                                      0.0f, 0.0f, 1.0f / (CascadeBoxMax.Z - CascadeBoxMin.Z), 0.0f,
-                                      0.0f, 0.0f, 0.0f, 1.0f);
-            m4 InverseCascadeView = AffineOrthonormalInverse(CascadeView);
-            m4 InverseCascadeProjection = M4(CascadeScale / 2.0f, 0.0f, 0.0f, 0.0f,
-                                             0.0f, CascadeScale / 2.0f, 0.0f, 0.0f,
-                                             0.0f, 0.0f, (CascadeBoxMax.Z - CascadeBoxMin.Z) / 1.0f, 0.0f,
-                                             0.0f, 0.0f, 0.0f, 1.0f);
+            m4 CascadeProjection = GetCascadeProjection(Placement);
 
             m4 CascadeViewProjection = CascadeProjection * CascadeView;
             Frame->Uniforms.CascadeViewProjections[CascadeIndex] = CascadeViewProjection;
             Frame->Uniforms.CascadeMinDistances[CascadeIndex] = Nd;
             Frame->Uniforms.CascadeMaxDistances[CascadeIndex] = Fd;
 
-            m4 InverseCascadeViewProjection = InverseCascadeView * InverseCascadeProjection;
             frustum ClipSpaceFrustum = GetClipSpaceFrustum();
             ClipSpaceFrustum.Near = {};
             for (u32 PlaneIndex = 0; PlaneIndex < 6; PlaneIndex++)
@@ -5780,26 +6807,38 @@ internal void SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums)
                 CascadeFrustums[CascadeIndex].Planes[PlaneIndex] = ClipSpaceFrustum.Planes[PlaneIndex] * CascadeProjection * CascadeView;
             }
 
+            // NOTE(boti): Static frustums are indexed by 2*CascadeIndex + StripIndex, a rebuild uses the whole cascade
+            if (Update->IsStaticRebuilt)
+            {
+                StaticCascadeFrustums[2*CascadeIndex] = CascadeFrustums[CascadeIndex];
+            }
+            else if (Update->IsScrolled)
+            {
+                for (u32 StripIndex = 0; StripIndex < Update->StripCount; StripIndex++)
+                {
+                    StaticCascadeFrustums[2*CascadeIndex + StripIndex] = GetCascadeStripFrustum(CascadeViewProjection, Update->Strips[StripIndex]);
+                }
+            }
+
             if (CascadeIndex == 0)
             {
-                CascadeScale0 = CascadeScale;
+                Extent0 = Extent;
                 CascadeP0 = CascadeP;
-                MinZ0 = CascadeBoxMin.Z;
-                MaxZ0 = CascadeBoxMax.Z;
+                DepthRange0 = DepthRange;
             }
             else
             {
                 Frame->Uniforms.CascadeScales[CascadeIndex - 1] = 
                 {
-                    CascadeScale0 / CascadeScale,
-                    CascadeScale0 / CascadeScale,
-                    (MaxZ0 - MinZ0) / (CascadeBoxMax.Z - CascadeBoxMin.Z),
+                    Extent0 / Extent,
+                    Extent0 / Extent,
+                    DepthRange0 / DepthRange,
                 };
                 Frame->Uniforms.CascadeOffsets[CascadeIndex - 1] = 
                 {
-                    ((CascadeP0.X - CascadeP.X) / CascadeScale) - (CascadeScale0 / (2.0f * CascadeScale)) + 0.5f,
-                    ((CascadeP0.Y - CascadeP.Y) / CascadeScale) - (CascadeScale0 / (2.0f * CascadeScale)) + 0.5f,
-                    (CascadeP0.Z - CascadeP.Z) / (CascadeBoxMax.Z - CascadeBoxMin.Z),
+                    ((CascadeP0.X - CascadeP.X) / Extent) - (Extent0 / (2.0f * Extent)) + 0.5f,
+                    ((CascadeP0.Y - CascadeP.Y) / Extent) - (Extent0 / (2.0f * Extent)) + 0.5f,
+                    (CascadeP0.Z - CascadeP.Z) / DepthRange,
                 };
             }
         }
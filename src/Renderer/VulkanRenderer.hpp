@@ -98,8 +98,13 @@ inline b32 PushDeletionEntry(gpu_deletion_queue* Queue, u32 FrameID, VkSwapchain
 
 #include "Renderer/RenderDevice.hpp"
 #include "Renderer/RenderTarget.hpp"
+#include "Renderer/GeometryAllocator.hpp"
 #include "Renderer/Geometry.hpp"
+#include "Renderer/TextureCache.hpp"
+#include "Renderer/TextureResidency.hpp"
 #include "Renderer/TextureManager.hpp"
+#include "Renderer/ShadowAtlas.hpp"
+#include "Renderer/ShadowCache.hpp"
 #include "Platform.hpp"
 
 extern vulkan VK;
@@ -179,13 +184,40 @@ struct draw_list
     u32 DrawGroupDrawCounts[DrawGroup_Count];
 };
 
-struct point_shadow_map
+// NOTE(boti): Renderer-side copy of the retained instances.
+// Instance indices are also the instance IDs on the GPU, index 0 is reserved as the null instance.
+// The per-frame (immediate) instances get placed after the retained ones in the instance/draw buffers.
+struct retained_scene
 {
-    VkImage Image;
-    VkImageView CubeView;
-    VkImageView LayerViews[6];
+    static constexpr u32 MaxInstanceCount = R_MaxRetainedInstanceCount;
+    static constexpr u32 InvalidIndex = 0xFFFFFFFFu;
+
+    u32 NextInstanceIndex; // NOTE(boti): High watermark, freed instances are reused first
+    u32 FreeCount;
+    u32 FreeList[MaxInstanceCount];
+
+    draw_group                      Groups[MaxInstanceCount];
+    u32                             GroupSlots[MaxInstanceCount]; // NOTE(boti): Index into GroupInstances, InvalidIndex if not yet updated
+    geometry_buffer_allocation      Geometries[MaxInstanceCount]; // NOTE(boti): For patching the instances when the geometry gets moved
+    mmbox                           BoundingBoxes[MaxInstanceCount];
+    m4                              Transforms[MaxInstanceCount];
+    instance_data                   Instances[MaxInstanceCount];
+    VkDrawIndexedIndirectCommand    IndirectCommands[MaxInstanceCount];
+
+    // NOTE(boti): Densely packed list of the live instances in each group, used for culling
+    u32 GroupInstanceCounts[DrawGroup_Count];
+    u32 GroupInstances[DrawGroup_Count][MaxInstanceCount];
+
+    // NOTE(boti): Instances that need to be uploaded to the GPU, for each copy of the instance buffers (see MarkInstanceDirty())
+    u32 DirtyCounts[R_MaxFramesInFlight];
+    u32 DirtyLists[R_MaxFramesInFlight][MaxInstanceCount];
+    b32 IsDirty[R_MaxFramesInFlight][MaxInstanceCount];
 };
 
+// NOTE(boti): Each frame in flight has its own copy of the instance data on the GPU,
+// so a changed instance needs to be uploaded to all of them
+internal void MarkInstanceDirty(retained_scene* Scene, u32 InstanceIndex);
+
 struct pipeline_with_layout
 {
     VkPipeline Pipeline;
@@ -249,7 +281,17 @@ struct renderer
     VkImage                 CascadeMap;
     VkImageView             CascadeArrayView;
     VkImageView             CascadeViews[R_MaxShadowCascadeCount];
-    point_shadow_map        PointShadowMaps[R_MaxShadowCount];
+    // NOTE(boti): 2 static layers per cascade (indexed by 2*CascadeIndex + StaticLayer), see cascade_shadow_cache
+    VkImage                 CascadeStaticMap;
+    VkImageView             CascadeStaticViews[2 * R_MaxShadowCascadeCount];
+    cascade_shadow_cache    CascadeShadowCache;
+    VkImage                 PointShadowAtlas;
+    VkImageView             PointShadowAtlasView;
+    // NOTE(boti): Retained casters only, same tile layout as the sampled atlas, see point_shadow_cache
+    VkImage                 PointShadowStaticAtlas;
+    VkImageView             PointShadowStaticAtlasView;
+    b32                     IsPointShadowAtlasInitialized; // NOTE(boti): The atlases have been transitioned out of UNDEFINED
+    point_shadow_cache      PointShadowCache;
 
     struct render_debug
     {
@@ -306,6 +348,7 @@ struct renderer
     void*           MipReadbackMapping;
     VkBuffer        MipReadbackBuffers[R_MaxFramesInFlight];
     void*           MipReadbackMappings[R_MaxFramesInFlight];
+    u32             MipReadbackCounts[R_MaxFramesInFlight]; // NOTE(boti): Texture count at the time of the copy
 
     //
     // Persistent
@@ -322,6 +365,17 @@ struct renderer
     u64             PerFrameBufferAddress;
     VkBuffer        PerFrameBuffer;
 
+    // NOTE(boti): Retained instances occupy the first retained_scene::MaxInstanceCount entries,
+    // followed by the immediate instances of the current frame.
+    // There's a copy for each frame in flight, so that the uploads don't overwrite the data the previous frame might still be reading
+    static constexpr u32 MaxInstanceCount = retained_scene::MaxInstanceCount + render_frame::MaxDrawCount;
+    u64             InstanceBufferAddresses[R_MaxFramesInFlight];
+    VkBuffer        InstanceBuffers[R_MaxFramesInFlight];
+    u64             DrawDataBufferAddresses[R_MaxFramesInFlight];
+    VkBuffer        DrawDataBuffers[R_MaxFramesInFlight];
+
+    retained_scene  RetainedScene;
+
     //
     // Pipelines, pipeline layouts and associated descriptor set layouts
     //
@@ -351,8 +405,10 @@ BeginCommandBuffer(renderer* Renderer, u32 FrameID, begin_cb_flags Flags, pipeli
 internal void
 EndCommandBuffer(VkCommandBuffer CB);
 
+// NOTE(boti): Places/schedules the shadow cascades and writes their uniforms and culling frustums
 internal void 
-SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums);
+SetupSceneRendering(render_frame* Frame, frustum* CascadeFrustums, frustum* StaticCascadeFrustums, 
+                    cascade_shadow_update* CascadeUpdates);
 
 //
 // Implementation
@@ -236,6 +236,7 @@ struct screen_tile
 struct point_shadow_data
 {
     m4 ViewProjections[6];
+    v4 AtlasRects[6]; // NOTE(boti): xy: UV offset of the face tile in the atlas, z: UV size
     f32 Near;
     f32 Far;
 };
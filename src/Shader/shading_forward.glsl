@@ -64,7 +64,7 @@ SetBinding(Static, StructureImage) uniform texture2D StructureImage;
 SetBinding(Static, OcclusionImage) uniform texture2D OcclusionImage;
 
 SetBinding(Static, CascadedShadow) uniform texture2DArray CascadedShadow;
-SetBinding(Static, PointShadows) uniform textureCube PointShadows[];
+SetBinding(Static, PointShadows) uniform texture2D PointShadowAtlas;
 
 SetBinding(Sampler, NamedSamplers) uniform sampler Samplers[Sampler_Count];
 SetBinding(Sampler, MaterialSamplers) uniform sampler MatSamplers[R_MaterialSamplerCount];
@@ -175,7 +175,8 @@ void main()
             if (Light.ShadowIndex != 0xFFFFFFFFu)
             {
                 v3 ShadowP = TransformDirection(PerFrame.CameraTransform, -dP);
-                Shadow = CalculatePointShadow(PointShadows[Light.ShadowIndex], Samplers[Sampler_Shadow], 
+                Shadow = CalculatePointShadow(PointShadowAtlas, Samplers[Sampler_Shadow], 
+                                              PerFrame.PointShadows[Light.ShadowIndex].AtlasRects,
                                               ShadowP, 
                                               PerFrame.PointShadows[Light.ShadowIndex].Near, 
                                               PerFrame.PointShadows[Light.ShadowIndex].Far);
@@ -17,6 +17,7 @@ internal const char*        GameDLLFilename     = "build/game.dll";
 internal const char*        GameDLLTempFilename = "build/game-tmp.dll";
 
 internal void Win_DebugPrint(const char* Format, ...);
+internal void Win_CompleteAllWork(work_queue* Queue, thread_context* ThreadContext);
 
 struct game_dll
 {
@@ -68,7 +69,9 @@ internal b32 LoadGameCode(game_dll* DLL)
     return(Result);
 }
 
-internal b32 TryReloadGameCode(game_dll* DLL)
+// NOTE(boti): The background queue is the only one that runs game code across frame boundaries,
+// so it's drained before the old code gets unloaded
+internal b32 TryReloadGameCode(game_dll* DLL, work_queue* BackgroundQueue, thread_context* ThreadContext)
 {
     b32 Result = true;
 
@@ -78,8 +81,7 @@ internal b32 TryReloadGameCode(game_dll* DLL)
         if (Info.ftLastWriteTime.dwLowDateTime != DLL->LastWriteTime.dwLowDateTime || 
             Info.ftLastWriteTime.dwHighDateTime != DLL->LastWriteTime.dwHighDateTime)
         {
-            // NOTE(boti): Currently we don't have any threads running game code that can cross
-            // frame boundaries - otherwise this would crash
+            Win_CompleteAllWork(BackgroundQueue, ThreadContext);
             FreeLibrary(DLL->Module);
             DLL->UpdateAndRender = nullptr;
 
@@ -1233,9 +1235,22 @@ internal DWORD WINAPI Win_MainThread(void* pParams)
         Init->Queue = &WorkQueue;
         Worker->Handle = CreateThread(nullptr, 0, &Win_WorkerThread, Init, 0, &Worker->ThreadID);
     }
+
+    // NOTE(boti): The background worker runs below normal priority so that it doesn't compete with the frame work
+    work_queue BackgroundQueue = {};
+    BackgroundQueue.WorkerSemaphore = CreateSemaphoreA(nullptr, 0, 1, nullptr);
+    worker_info BackgroundWorker;
+    worker_init_info BackgroundWorkerInitInfo;
+    {
+        BackgroundWorkerInitInfo.ThreadContext.ThreadID = WorkerCount + 1;
+        BackgroundWorkerInitInfo.Queue = &BackgroundQueue;
+        BackgroundWorker.Handle = CreateThread(nullptr, 0, &Win_WorkerThread, &BackgroundWorkerInitInfo, 0, &BackgroundWorker.ThreadID);
+        SetThreadPriority(BackgroundWorker.Handle, THREAD_PRIORITY_BELOW_NORMAL);
+    }
     
     GameMemory.PlatformAPI.Profiler             = &GlobalProfiler;
     GameMemory.PlatformAPI.Queue                = &WorkQueue;
+    GameMemory.PlatformAPI.BackgroundQueue      = &BackgroundQueue;
     GameMemory.PlatformAPI.IOQueue              = &IOQueue;
     GameMemory.PlatformAPI.DebugPrint           = &Win_DebugPrint;
     GameMemory.PlatformAPI.GetCounter           = &Win_GetCounter;
@@ -1257,6 +1272,7 @@ internal DWORD WINAPI Win_MainThread(void* pParams)
         GameMemory.PlatformAPI.CreateRenderer       = (create_renderer*)    GetProcAddress(RendererDLL, "CreateRenderer");
         GameMemory.PlatformAPI.AllocateGeometry     = (allocate_geometry*)  GetProcAddress(RendererDLL, "AllocateGeometry");
         GameMemory.PlatformAPI.AllocateTexture      = (allocate_texture*)   GetProcAddress(RendererDLL, "AllocateTexture");
+        GameMemory.PlatformAPI.AllocateInstance     = (allocate_instance*)  GetProcAddress(RendererDLL, "AllocateInstance");
         GameMemory.PlatformAPI.BeginRenderFrame     = (begin_render_frame*) GetProcAddress(RendererDLL, "BeginRenderFrame");
         GameMemory.PlatformAPI.EndRenderFrame       = (end_render_frame*)   GetProcAddress(RendererDLL, "EndRenderFrame");
 
@@ -1345,7 +1361,7 @@ internal DWORD WINAPI Win_MainThread(void* pParams)
             }
         }
 
-        b32 ReloadResult = TryReloadGameCode(&GameDLL);
+        b32 ReloadResult = TryReloadGameCode(&GameDLL, &BackgroundQueue, ThreadContext);
         if (!ReloadResult)
         {
             UnhandledError("Failed to reload Game DLL");
@@ -1372,6 +1388,7 @@ internal DWORD WINAPI Win_MainThread(void* pParams)
     }
 
     Win_CompleteAllWork(&WorkQueue, ThreadContext);
+    Win_CompleteAllWork(&BackgroundQueue, ThreadContext);
 
     // TODO(boti): Wait for the IO thread to finish instead
     SuspendThread(IOThread);
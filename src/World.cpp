@@ -52,160 +52,1774 @@ lbfn m4 GetTransform(const camera* Camera)
     return Result;
 }
 
+//
+// Spatial index
+//
+internal u32 AllocateBVHNode(bvh* BVH)
+{
+    u32 Result = 0;
+    if (BVH->FreeListIndex)
+    {
+        Result = BVH->FreeListIndex;
+        BVH->FreeListIndex = BVH->Nodes[Result].ParentIndex;
+    }
+    else
+    {
+        // NOTE(boti): Node 0 is reserved as the null node
+        if (BVH->NodeCount == 0)
+        {
+            BVH->NodeCount = 1;
+        }
+
+        if (BVH->NodeCount < BVH->MaxNodeCount)
+        {
+            Result = BVH->NodeCount++;
+        }
+    }
+
+    if (Result)
+    {
+        BVH->Nodes[Result] = {};
+    }
+    return(Result);
+}
+
+internal void FreeBVHNode(bvh* BVH, u32 Index)
+{
+    Assert(Index != 0);
+    bvh_node* Node = BVH->Nodes + Index;
+    Node->ParentIndex = BVH->FreeListIndex;
+    Node->Children[0] = Node->Children[1] = 0;
+    BVH->FreeListIndex = Index;
+}
+
+internal void RecalculateBVHNode(bvh* BVH, u32 Index)
+{
+    bvh_node* Node = BVH->Nodes + Index;
+    bvh_node* Child0 = BVH->Nodes + Node->Children[0];
+    bvh_node* Child1 = BVH->Nodes + Node->Children[1];
+    Node->Box = Union(Child0->Box, Child1->Box);
+    Node->Height = 1 + Max(Child0->Height, Child1->Height);
+}
+
+// NOTE(boti): Tries to swap one of the children of the node with one of its grandchildren
+// if that reduces the surface area of the affected child (Catto/Kopta-style tree rotation)
+internal void RotateBVHNode(bvh* BVH, u32 Index)
+{
+    bvh_node* Node = BVH->Nodes + Index;
+
+    f32 BestCostDelta = 0.0f;
+    u32 BestChild = 0; // NOTE(boti): The child that gets swapped down
+    u32 BestGrandchild = 0; // NOTE(boti): Index of the grandchild (within the other child) that gets swapped up
+    for (u32 ChildIndex = 0; ChildIndex < 2; ChildIndex++)
+    {
+        bvh_node* Child = BVH->Nodes + Node->Children[ChildIndex];
+        bvh_node* Other = BVH->Nodes + Node->Children[ChildIndex ^ 1];
+        if (!IsLeaf(Other))
+        {
+            f32 OtherArea = SurfaceArea(Other->Box);
+            for (u32 GrandchildIndex = 0; GrandchildIndex < 2; GrandchildIndex++)
+            {
+                // NOTE(boti): After the swap, Other contains Child and the grandchild we _didn't_ swap
+                bvh_node* Remaining = BVH->Nodes + Other->Children[GrandchildIndex ^ 1];
+                f32 CostDelta = SurfaceArea(Union(Child->Box, Remaining->Box)) - OtherArea;
+                if (CostDelta < BestCostDelta)
+                {
+                    BestCostDelta = CostDelta;
+                    BestChild = ChildIndex;
+                    BestGrandchild = GrandchildIndex;
+                }
+            }
+        }
+    }
+
+    if (BestCostDelta < 0.0f)
+    {
+        u32 ChildNodeIndex = Node->Children[BestChild];
+        u32 OtherNodeIndex = Node->Children[BestChild ^ 1];
+        bvh_node* Other = BVH->Nodes + OtherNodeIndex;
+        u32 GrandchildNodeIndex = Other->Children[BestGrandchild];
+
+        Node->Children[BestChild] = GrandchildNodeIndex;
+        BVH->Nodes[GrandchildNodeIndex].ParentIndex = Index;
+        Other->Children[BestGrandchild] = ChildNodeIndex;
+        BVH->Nodes[ChildNodeIndex].ParentIndex = OtherNodeIndex;
+
+        RecalculateBVHNode(BVH, OtherNodeIndex);
+    }
+}
+
+internal void RefitBVH(bvh* BVH, u32 Index)
+{
+    while (Index)
+    {
+        RotateBVHNode(BVH, Index);
+        RecalculateBVHNode(BVH, Index);
+        Index = BVH->Nodes[Index].ParentIndex;
+    }
+}
+
+internal void InsertBVHLeaf(bvh* BVH, u32 LeafIndex)
+{
+    bvh_node* Leaf = BVH->Nodes + LeafIndex;
+    if (BVH->RootIndex == 0)
+    {
+        BVH->RootIndex = LeafIndex;
+        Leaf->ParentIndex = 0;
+        return;
+    }
+
+    // NOTE(boti): Descend the tree choosing the child with the lower SAH cost,
+    // and stop when creating a new parent at the current node is cheaper than going any deeper
+    mmbox LeafBox = Leaf->Box;
+    u32 SiblingIndex = BVH->RootIndex;
+    while (!IsLeaf(BVH->Nodes + SiblingIndex))
+    {
+        bvh_node* Node = BVH->Nodes + SiblingIndex;
+
+        f32 Area = SurfaceArea(Node->Box);
+        f32 CombinedArea = SurfaceArea(Union(Node->Box, LeafBox));
+        f32 Cost = 2.0f * CombinedArea;
+        f32 InheritanceCost = 2.0f * (CombinedArea - Area);
+
+        f32 ChildCosts[2];
+        for (u32 ChildIndex = 0; ChildIndex < 2; ChildIndex++)
+        {
+            bvh_node* Child = BVH->Nodes + Node->Children[ChildIndex];
+            f32 ChildCombinedArea = SurfaceArea(Union(Child->Box, LeafBox));
+            ChildCosts[ChildIndex] = IsLeaf(Child) ? 
+                ChildCombinedArea + InheritanceCost : 
+                (ChildCombinedArea - SurfaceArea(Child->Box)) + InheritanceCost;
+        }
+
+        if (Cost < ChildCosts[0] && Cost < ChildCosts[1])
+        {
+            break;
+        }
+        SiblingIndex = (ChildCosts[0] < ChildCosts[1]) ? Node->Children[0] : Node->Children[1];
+    }
+
+    u32 ParentIndex = AllocateBVHNode(BVH);
+    // NOTE(boti): The caller checks that there's enough space for both the leaf and the new parent
+    Assert(ParentIndex);
+
+    bvh_node* Sibling = BVH->Nodes + SiblingIndex;
+    u32 OldParentIndex = Sibling->ParentIndex;
+    bvh_node* Parent = BVH->Nodes + ParentIndex;
+    Parent->ParentIndex = OldParentIndex;
+    Parent->Children[0] = SiblingIndex;
+    Parent->Children[1] = LeafIndex;
+    Sibling->ParentIndex = ParentIndex;
+    Leaf->ParentIndex = ParentIndex;
+
+    if (OldParentIndex)
+    {
+        bvh_node* OldParent = BVH->Nodes + OldParentIndex;
+        u32 SlotIndex = (OldParent->Children[0] == SiblingIndex) ? 0 : 1;
+        OldParent->Children[SlotIndex] = ParentIndex;
+    }
+    else
+    {
+        BVH->RootIndex = ParentIndex;
+    }
+
+    RefitBVH(BVH, ParentIndex);
+}
+
+internal void RemoveBVHLeaf(bvh* BVH, u32 LeafIndex)
+{
+    if (BVH->RootIndex == LeafIndex)
+    {
+        BVH->RootIndex = 0;
+        return;
+    }
+
+    u32 ParentIndex = BVH->Nodes[LeafIndex].ParentIndex;
+    bvh_node* Parent = BVH->Nodes + ParentIndex;
+    u32 GrandparentIndex = Parent->ParentIndex;
+    u32 SiblingIndex = (Parent->Children[0] == LeafIndex) ? Parent->Children[1] : Parent->Children[0];
+
+    if (GrandparentIndex)
+    {
+        bvh_node* Grandparent = BVH->Nodes + GrandparentIndex;
+        u32 SlotIndex = (Grandparent->Children[0] == ParentIndex) ? 0 : 1;
+        Grandparent->Children[SlotIndex] = SiblingIndex;
+        BVH->Nodes[SiblingIndex].ParentIndex = GrandparentIndex;
+        FreeBVHNode(BVH, ParentIndex);
+
+        RefitBVH(BVH, GrandparentIndex);
+    }
+    else
+    {
+        BVH->RootIndex = SiblingIndex;
+        BVH->Nodes[SiblingIndex].ParentIndex = 0;
+        FreeBVHNode(BVH, ParentIndex);
+    }
+}
+
+internal mmbox GetFatBox(mmbox Box, v3 Displacement)
+{
+    v3 Margin = { bvh::BoxMargin, bvh::BoxMargin, bvh::BoxMargin };
+    mmbox Result = { Box.Min - Margin, Box.Max + Margin };
+
+    // NOTE(boti): Extend the box in the direction of movement so that moving objects get reinserted less often
+    v3 d = bvh::DisplacementMultiplier * Displacement;
+    for (u32 Axis = 0; Axis < 3; Axis++)
+    {
+        if (d.E[Axis] < 0.0f)   Result.Min.E[Axis] += d.E[Axis];
+        else                    Result.Max.E[Axis] += d.E[Axis];
+    }
+    return(Result);
+}
+
+lbfn u32 CreateBVHProxy(bvh* BVH, mmbox Box, entity_id EntityID, u32 PieceIndex)
+{
+    u32 Result = AllocateBVHNode(BVH);
+    if (Result)
+    {
+        // NOTE(boti): Inserting into a non-empty tree also requires a new parent node,
+        // make sure that allocation can't fail before we touch the tree
+        b32 HasFreeNode = BVH->FreeListIndex || (BVH->NodeCount < BVH->MaxNodeCount);
+        if (BVH->RootIndex && !HasFreeNode)
+        {
+            FreeBVHNode(BVH, Result);
+            Result = 0;
+        }
+        else
+        {
+            bvh_node* Leaf = BVH->Nodes + Result;
+            Leaf->Box = GetFatBox(Box, {});
+            Leaf->EntityID = EntityID;
+            Leaf->PieceIndex = PieceIndex;
+
+            InsertBVHLeaf(BVH, Result);
+            BVH->LeafCount++;
+        }
+    }
+    return(Result);
+}
+
+lbfn void DestroyBVHProxy(bvh* BVH, u32 ProxyID)
+{
+    Assert(ProxyID && ProxyID < BVH->NodeCount);
+    Assert(IsLeaf(BVH->Nodes + ProxyID));
+
+    RemoveBVHLeaf(BVH, ProxyID);
+    FreeBVHNode(BVH, ProxyID);
+    BVH->LeafCount--;
+}
+
+lbfn b32 MoveBVHProxy(bvh* BVH, u32 ProxyID, mmbox Box, v3 Displacement)
+{
+    Assert(ProxyID && ProxyID < BVH->NodeCount);
+    Assert(IsLeaf(BVH->Nodes + ProxyID));
+
+    b32 Result = false;
+    bvh_node* Leaf = BVH->Nodes + ProxyID;
+    if (!Contains(Leaf->Box, Box))
+    {
+        // NOTE(boti): Removing the leaf frees up its parent, so the reinsertion can't run out of nodes
+        RemoveBVHLeaf(BVH, ProxyID);
+        Leaf->Box = GetFatBox(Box, Displacement);
+        InsertBVHLeaf(BVH, ProxyID);
+        Result = true;
+    }
+    return(Result);
+}
+
+internal bvh_query_result BeginBVHQuery(const bvh* BVH, memory_arena* Arena, u32** Stack)
+{
+    bvh_query_result Result = {};
+    Result.ProxyIDs = PushArray(Arena, 0, u32, BVH->LeafCount);
+    // NOTE(boti): A depth-first traversal that pushes both children never needs more than Height+1 entries
+    u32 StackSize = BVH->RootIndex ? BVH->Nodes[BVH->RootIndex].Height + 1 : 1;
+    *Stack = PushArray(Arena, 0, u32, StackSize);
+    return(Result);
+}
+
+lbfn bvh_query_result QueryBVHBox(const bvh* BVH, mmbox Box, memory_arena* Arena)
+{
+    u32* Stack = nullptr;
+    bvh_query_result Result = BeginBVHQuery(BVH, Arena, &Stack);
+
+    u32 StackAt = 0;
+    if (BVH->RootIndex) Stack[StackAt++] = BVH->RootIndex;
+    while (StackAt)
+    {
+        u32 Index = Stack[--StackAt];
+        const bvh_node* Node = BVH->Nodes + Index;
+        if (Intersects(Node->Box, Box))
+        {
+            if (IsLeaf(Node))
+            {
+                Result.ProxyIDs[Result.Count++] = Index;
+            }
+            else
+            {
+                Stack[StackAt++] = Node->Children[0];
+                Stack[StackAt++] = Node->Children[1];
+            }
+        }
+    }
+    return(Result);
+}
+
+lbfn bvh_query_result QueryBVHRay(const bvh* BVH, ray Ray, f32 tMax, memory_arena* Arena)
+{
+    u32* Stack = nullptr;
+    bvh_query_result Result = BeginBVHQuery(BVH, Arena, &Stack);
+
+    // NOTE(boti): Division by zero is intended here, the infinities fall out correctly in the slab test
+    v3 InvV = { 1.0f / Ray.V.X, 1.0f / Ray.V.Y, 1.0f / Ray.V.Z };
+
+    u32 StackAt = 0;
+    if (BVH->RootIndex) Stack[StackAt++] = BVH->RootIndex;
+    while (StackAt)
+    {
+        u32 Index = Stack[--StackAt];
+        const bvh_node* Node = BVH->Nodes + Index;
+
+        f32 tEnter = 0.0f;
+        f32 tExit = tMax;
+        for (u32 Axis = 0; Axis < 3; Axis++)
+        {
+            f32 t0 = (Node->Box.Min.E[Axis] - Ray.P.E[Axis]) * InvV.E[Axis];
+            f32 t1 = (Node->Box.Max.E[Axis] - Ray.P.E[Axis]) * InvV.E[Axis];
+            tEnter = Max(tEnter, Min(t0, t1));
+            tExit = Min(tExit, Max(t0, t1));
+        }
+
+        if (tEnter <= tExit)
+        {
+            if (IsLeaf(Node))
+            {
+                Result.ProxyIDs[Result.Count++] = Index;
+            }
+            else
+            {
+                Stack[StackAt++] = Node->Children[0];
+                Stack[StackAt++] = Node->Children[1];
+            }
+        }
+    }
+    return(Result);
+}
+
+lbfn bvh_query_result QueryBVHFrustum(const bvh* BVH, const frustum* Frustum, memory_arena* Arena)
+{
+    u32* Stack = nullptr;
+    bvh_query_result Result = BeginBVHQuery(BVH, Arena, &Stack);
+
+    u32 StackAt = 0;
+    if (BVH->RootIndex) Stack[StackAt++] = BVH->RootIndex;
+    while (StackAt)
+    {
+        u32 Index = Stack[--StackAt];
+        const bvh_node* Node = BVH->Nodes + Index;
+        if (IntersectFrustumBox(Frustum, Node->Box))
+        {
+            if (IsLeaf(Node))
+            {
+                Result.ProxyIDs[Result.Count++] = Index;
+            }
+            else
+            {
+                Stack[StackAt++] = Node->Children[0];
+                Stack[StackAt++] = Node->Children[1];
+            }
+        }
+    }
+    return(Result);
+}
+
+internal void UpdateEntityProxy(bvh* BVH, u32* ProxyID, mmbox Box, entity_id EntityID, u32 PieceIndex)
+{
+    if (*ProxyID)
+    {
+        // NOTE(boti): We don't track velocities, the drift from the center of the fat box is used as the predicted displacement
+        bvh_node* Leaf = BVH->Nodes + *ProxyID;
+        v3 Displacement = 0.5f * ((Box.Min + Box.Max) - (Leaf->Box.Min + Leaf->Box.Max));
+        MoveBVHProxy(BVH, *ProxyID, Box, Displacement);
+    }
+    else
+    {
+        *ProxyID = CreateBVHProxy(BVH, Box, EntityID, PieceIndex);
+    }
+}
+
+// NOTE(boti): Murmur3
+internal u32 HashNoise(u32 Seed, u32 X, u32 Y)
+{
+    u32 Result = Seed;
+
+    u32 Values[2] = { X, Y };
+    for (u32 Index = 0; Index < 2; Index++)
+    {
+        u32 K = 0xCC9E2D51u * Values[Index];
+        // TODO(boti): Rotate intrinsics
+        K = (K << 15) | (K >> (32 - 15));
+        K *= 0x1B873593u;
+
+        Result ^= K;
+        Result = (Result << 13) | (Result >> (32 - 13));
+        Result = 5u*Result + 0xE6546B64u;
+    }
+
+    // NOTE(boti): Final mix step
+    Result ^= Result >> 16;
+    Result *= 0x85EBCA6Bu;
+    Result ^= Result >> 13;
+    Result *= 0xC2B2AE35u;
+    Result ^= Result >> 16;
+    return(Result);
+}
+
+// NOTE(boti): 8-wide version of HashNoise
+internal __m256i HashNoise8(__m256i Seed, __m256i X, __m256i Y)
+{
+    __m256i Result = Seed;
+
+    __m256i Values[2] = { X, Y };
+    for (u32 Index = 0; Index < 2; Index++)
+    {
+        __m256i K = _mm256_mullo_epi32(_mm256_set1_epi32((s32)0xCC9E2D51u), Values[Index]);
+        K = _mm256_or_si256(_mm256_slli_epi32(K, 15), _mm256_srli_epi32(K, 32 - 15));
+        K = _mm256_mullo_epi32(K, _mm256_set1_epi32(0x1B873593));
+
+        Result = _mm256_xor_si256(Result, K);
+        Result = _mm256_or_si256(_mm256_slli_epi32(Result, 13), _mm256_srli_epi32(Result, 32 - 13));
+        Result = _mm256_add_epi32(_mm256_mullo_epi32(Result, _mm256_set1_epi32(5)), _mm256_set1_epi32((s32)0xE6546B64u));
+    }
+
+    Result = _mm256_xor_si256(Result, _mm256_srli_epi32(Result, 16));
+    Result = _mm256_mullo_epi32(Result, _mm256_set1_epi32((s32)0x85EBCA6Bu));
+    Result = _mm256_xor_si256(Result, _mm256_srli_epi32(Result, 13));
+    Result = _mm256_mullo_epi32(Result, _mm256_set1_epi32((s32)0xC2B2AE35u));
+    Result = _mm256_xor_si256(Result, _mm256_srli_epi32(Result, 16));
+    return(Result);
+}
+
 lbfn f32 SampleNoise(noise2* Noise, v2 P)
 {
-    v2 P0 = { Floor(P.X), Floor(P.Y) };
-    v2 dP = P - P0;
+    v2 P0 = { Floor(P.X), Floor(P.Y) };
+    v2 dP = P - P0;
+
+    u32 X = (u32)(s32)P0.X;
+    u32 Y = (u32)(s32)P0.Y;
+
+    u32 Hash00 = HashNoise(Noise->Seed, X + 0, Y + 0);
+    u32 Hash10 = HashNoise(Noise->Seed, X + 1, Y + 0);
+    u32 Hash01 = HashNoise(Noise->Seed, X + 0, Y + 1);
+    u32 Hash11 = HashNoise(Noise->Seed, X + 1, Y + 1);
+
+    v2 GradTable[4]
+    {
+        { -1.0f, -1.0f },
+        { +1.0f, -1.0f },
+        { -1.0f, +1.0f },
+        { +1.0f, +1.0f },
+
+    };
+    v2 Grad00 = GradTable[Hash00 & 3];
+    v2 Grad10 = GradTable[Hash10 & 3];
+    v2 Grad01 = GradTable[Hash01 & 3];
+    v2 Grad11 = GradTable[Hash11 & 3];
+
+    f32 D00 = Dot(dP, Grad00);
+    f32 D10 = Dot(dP - v2{ 1.0f, 0.0f }, Grad10);
+    f32 D01 = Dot(dP - v2{ 0.0f, 1.0f }, Grad01);
+    f32 D11 = Dot(dP - v2{ 1.0f, 1.0f }, Grad11);
+
+    auto Fade = [](f32 X) -> f32
+    {
+        f32 Result = X*X*X * ((6.0f*X - 15.0f)*X + 10.0f);
+        return(Result);
+    };
+    f32 U = Fade(dP.X);
+    f32 V = Fade(dP.Y);
+    f32 X0 = Lerp(D00, D10, U);
+    f32 X1 = Lerp(D01, D11, U);
+    f32 Result = Lerp(X0, X1, V);
+    return(Result);
+}
+
+// NOTE(boti): 8-wide version of SampleNoise, the operations are kept in the same order as the scalar path.
+// The gradients are all (+-1, +-1), so the dot products are done by flipping the sign bits according to the hash
+internal __m256 
+SampleNoise8(noise2* Noise, __m256 PX, __m256 PY)
+{
+    __m256 P0X = _mm256_floor_ps(PX);
+    __m256 P0Y = _mm256_floor_ps(PY);
+    __m256 dPX = _mm256_sub_ps(PX, P0X);
+    __m256 dPY = _mm256_sub_ps(PY, P0Y);
+
+    __m256i X0 = _mm256_cvttps_epi32(P0X);
+    __m256i Y0 = _mm256_cvttps_epi32(P0Y);
+    __m256i X1 = _mm256_add_epi32(X0, _mm256_set1_epi32(1));
+    __m256i Y1 = _mm256_add_epi32(Y0, _mm256_set1_epi32(1));
+
+    __m256i Seed = _mm256_set1_epi32((s32)Noise->Seed);
+    __m256i Hash00 = HashNoise8(Seed, X0, Y0);
+    __m256i Hash10 = HashNoise8(Seed, X1, Y0);
+    __m256i Hash01 = HashNoise8(Seed, X0, Y1);
+    __m256i Hash11 = HashNoise8(Seed, X1, Y1);
+
+    __m256 One = _mm256_set1_ps(1.0f);
+    __m256 dPX1 = _mm256_sub_ps(dPX, One);
+    __m256 dPY1 = _mm256_sub_ps(dPY, One);
+
+    // NOTE(boti): Bit 0 of the hash is the sign of the X gradient, bit 1 is the sign of the Y gradient (set = positive)
+    auto GradDot = [](__m256i Hash, __m256 X, __m256 Y) -> __m256
+    {
+        __m256i SignX = _mm256_slli_epi32(_mm256_andnot_si256(Hash, _mm256_set1_epi32(1)), 31);
+        __m256i SignY = _mm256_slli_epi32(_mm256_andnot_si256(Hash, _mm256_set1_epi32(2)), 30);
+        __m256 Result = _mm256_add_ps(_mm256_xor_ps(X, _mm256_castsi256_ps(SignX)), 
+                                      _mm256_xor_ps(Y, _mm256_castsi256_ps(SignY)));
+        return(Result);
+    };
+    __m256 D00 = GradDot(Hash00, dPX,  dPY);
+    __m256 D10 = GradDot(Hash10, dPX1, dPY);
+    __m256 D01 = GradDot(Hash01, dPX,  dPY1);
+    __m256 D11 = GradDot(Hash11, dPX1, dPY1);
+
+    auto Fade = [](__m256 X) -> __m256
+    {
+        __m256 Poly = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(6.0f), X), _mm256_set1_ps(15.0f));
+        Poly = _mm256_add_ps(_mm256_mul_ps(Poly, X), _mm256_set1_ps(10.0f));
+        __m256 Result = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(X, X), X), Poly);
+        return(Result);
+    };
+    auto Lerp8 = [](__m256 A, __m256 B, __m256 t) -> __m256
+    {
+        __m256 Result = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), t), A), _mm256_mul_ps(t, B));
+        return(Result);
+    };
+
+    __m256 U = Fade(dPX);
+    __m256 V = Fade(dPY);
+    __m256 R0 = Lerp8(D00, D10, U);
+    __m256 R1 = Lerp8(D01, D11, U);
+    __m256 Result = Lerp8(R0, R1, V);
+    return(Result);
+}
+
+internal void 
+GenerateHeightFieldRows(thread_context* ThreadContext, void* Params)
+{
+    TimedFunctionMT(Platform.Profiler, ThreadContext->ThreadID);
+
+    height_field_job* Job = (height_field_job*)Params;
+    height_field* Field = Job->Field;
+    f32 MetersPerTexel = 1.0f / Field->TexelsPerMeter;
+
+    for (u32 Y = Job->RowBegin; Y < Job->RowEnd; Y++)
+    {
+        f32* Row = Field->HeightData + Y*Field->TexelCountX;
+        f32 PY = MetersPerTexel * (f32)Y;
+
+        u32 X = 0;
+        for (; X + 8 <= Field->TexelCountX; X += 8)
+        {
+            __m256 TexelX = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32((s32)X), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+            __m256 PX8 = _mm256_mul_ps(_mm256_set1_ps(MetersPerTexel), TexelX);
+            __m256 PY8 = _mm256_set1_ps(PY);
+
+            __m256 Height = _mm256_setzero_ps();
+            for (u32 OctaveIndex = 0; OctaveIndex < Job->OctaveCount; OctaveIndex++)
+            {
+                f32 Mul = (f32)(1 << OctaveIndex);
+                __m256 Frequency = _mm256_set1_ps(Job->BaseFrequency * Mul);
+                __m256 Amplitude = _mm256_set1_ps(Job->BaseAmplitude / Mul);
+                __m256 Noise = SampleNoise8(Job->Noise, _mm256_mul_ps(Frequency, PX8), _mm256_mul_ps(Frequency, PY8));
+                Height = _mm256_add_ps(Height, _mm256_mul_ps(Amplitude, Noise));
+            }
+            _mm256_storeu_ps(Row + X, Height);
+        }
+
+        // NOTE(boti): Remainder
+        for (; X < Field->TexelCountX; X++)
+        {
+            v2 P = MetersPerTexel * v2{ (f32)X, (f32)Y };
+            f32 Height = 0.0f;
+            for (u32 OctaveIndex = 0; OctaveIndex < Job->OctaveCount; OctaveIndex++)
+            {
+                f32 Mul = (f32)(1 << OctaveIndex);
+                f32 Frequency = Job->BaseFrequency * Mul;
+                f32 Amplitude = Job->BaseAmplitude / Mul;
+                Height += Amplitude * SampleNoise(Job->Noise, Frequency*P);
+            }
+            Row[X] = Height;
+        }
+    }
+}
+
+lbfn void GenerateHeightField(height_field* Field, noise2* Noise, 
+                              f32 BaseFrequency, f32 BaseAmplitude, u32 OctaveCount,
+                              thread_context* ThreadContext, memory_arena* Scratch)
+{
+    TimedFunction(Platform.Profiler);
+
+    constexpr u32 RowsPerJob = 16;
+    u32 JobCount = CeilDiv(Field->TexelCountY, RowsPerJob);
+
+    memory_arena_checkpoint Checkpoint = ArenaCheckpoint(Scratch);
+    height_field_job* Jobs = PushArray(Scratch, 0, height_field_job, JobCount);
+    for (u32 JobIndex = 0; JobIndex < JobCount; JobIndex++)
+    {
+        height_field_job* Job = Jobs + JobIndex;
+        Job->Field = Field;
+        Job->Noise = Noise;
+        Job->RowBegin = JobIndex * RowsPerJob;
+        Job->RowEnd = Min(Job->RowBegin + RowsPerJob, Field->TexelCountY);
+        Job->BaseFrequency = BaseFrequency;
+        Job->BaseAmplitude = BaseAmplitude;
+        Job->OctaveCount = OctaveCount;
+        Platform.AddWorkEntry(Platform.Queue, GenerateHeightFieldRows, Job);
+    }
+
+    // NOTE(boti): The calling thread helps out with the generation too
+    Platform.CompleteAllWork(Platform.Queue, ThreadContext);
+    RestoreArena(Scratch, Checkpoint);
+}
+
+lbfn void BuildHeightFieldMips(height_field* Field, memory_arena* Arena)
+{
+    TimedFunction(Platform.Profiler);
+
+    Assert((Field->TexelCountX >= 2) && (Field->TexelCountY >= 2));
+
+    height_field_mip* Base = Field->Mips + 0;
+    Base->CountX = Field->TexelCountX - 1;
+    Base->CountY = Field->TexelCountY - 1;
+    Base->MinMax = PushArray(Arena, 0, v2, Base->CountX * Base->CountY);
+    for (u32 Y = 0; Y < Base->CountY; Y++)
+    {
+        for (u32 X = 0; X < Base->CountX; X++)
+        {
+            f32* Texel = Field->HeightData + X + Y*Field->TexelCountX;
+            f32 H00 = Texel[0];
+            f32 H10 = Texel[1];
+            f32 H01 = Texel[Field->TexelCountX + 0];
+            f32 H11 = Texel[Field->TexelCountX + 1];
+            Base->MinMax[X + Y*Base->CountX] = 
+            {
+                Min(Min(H00, H10), Min(H01, H11)),
+                Max(Max(H00, H10), Max(H01, H11)),
+            };
+        }
+    }
+
+    Field->MipCount = 1;
+    while ((Field->Mips[Field->MipCount - 1].CountX > 1) || (Field->Mips[Field->MipCount - 1].CountY > 1))
+    {
+        Assert(Field->MipCount < Field->MaxMipCount);
+        height_field_mip* Src = Field->Mips + Field->MipCount - 1;
+        height_field_mip* Dst = Field->Mips + Field->MipCount++;
+        Dst->CountX = CeilDiv(Src->CountX, 2u);
+        Dst->CountY = CeilDiv(Src->CountY, 2u);
+        Dst->MinMax = PushArray(Arena, 0, v2, Dst->CountX * Dst->CountY);
+        for (u32 Y = 0; Y < Dst->CountY; Y++)
+        {
+            for (u32 X = 0; X < Dst->CountX; X++)
+            {
+                v2 MinMax = { +F32_MAX_NORMAL, -F32_MAX_NORMAL };
+                for (u32 SrcY = 2*Y; SrcY < Min(2*Y + 2, Src->CountY); SrcY++)
+                {
+                    for (u32 SrcX = 2*X; SrcX < Min(2*X + 2, Src->CountX); SrcX++)
+                    {
+                        v2 SrcMinMax = Src->MinMax[SrcX + SrcY*Src->CountX];
+                        MinMax.X = Min(MinMax.X, SrcMinMax.X);
+                        MinMax.Y = Max(MinMax.Y, SrcMinMax.Y);
+                    }
+                }
+                Dst->MinMax[X + Y*Dst->CountX] = MinMax;
+            }
+        }
+    }
+}
+
+// NOTE(boti): Scalar reference for SampleHeightField, also used for the remainder
+internal void 
+SampleHeightField1(height_field* Field, v3 Origin, v2 P, f32* Height, v3* Normal)
+{
+    f32 TexelX = Clamp((P.X - Origin.X) * Field->TexelsPerMeter, 0.0f, (f32)(Field->TexelCountX - 1));
+    f32 TexelY = Clamp((P.Y - Origin.Y) * Field->TexelsPerMeter, 0.0f, (f32)(Field->TexelCountY - 1));
+    s32 X = Min((s32)Floor(TexelX), (s32)Field->TexelCountX - 2);
+    s32 Y = Min((s32)Floor(TexelY), (s32)Field->TexelCountY - 2);
+    f32 FracX = TexelX - (f32)X;
+    f32 FracY = TexelY - (f32)Y;
+
+    f32* Texel = Field->HeightData + X + Y*Field->TexelCountX;
+    f32 H00 = Texel[0];
+    f32 H10 = Texel[1];
+    f32 H01 = Texel[Field->TexelCountX + 0];
+    f32 H11 = Texel[Field->TexelCountX + 1];
+
+    f32 H0 = (1.0f - FracX)*H00 + FracX*H10;
+    f32 H1 = (1.0f - FracX)*H01 + FracX*H11;
+    *Height = (1.0f - FracY)*H0 + FracY*H1 + Origin.Z;
+
+    if (Normal)
+    {
+        f32 dHdX = ((1.0f - FracY)*(H10 - H00) + FracY*(H11 - H01)) * Field->TexelsPerMeter;
+        f32 dHdY = ((1.0f - FracX)*(H01 - H00) + FracX*(H11 - H10)) * Field->TexelsPerMeter;
+        f32 InvLength = 1.0f / Sqrt(dHdX*dHdX + dHdY*dHdY + 1.0f);
+        *Normal = { -dHdX * InvLength, -dHdY * InvLength, InvLength };
+    }
+}
+
+lbfn void SampleHeightField(height_field* Field, v3 Origin, u32 Count, const v2* P, f32* Heights, v3* Normals)
+{
+    __m256 OriginX = _mm256_set1_ps(Origin.X);
+    __m256 OriginY = _mm256_set1_ps(Origin.Y);
+    __m256 OriginZ = _mm256_set1_ps(Origin.Z);
+    __m256 TexelsPerMeter = _mm256_set1_ps(Field->TexelsPerMeter);
+    __m256 MaxTexelX = _mm256_set1_ps((f32)(Field->TexelCountX - 1));
+    __m256 MaxTexelY = _mm256_set1_ps((f32)(Field->TexelCountY - 1));
+    __m256i MaxIndexX = _mm256_set1_epi32((s32)Field->TexelCountX - 2);
+    __m256i MaxIndexY = _mm256_set1_epi32((s32)Field->TexelCountY - 2);
+    __m256i Pitch = _mm256_set1_epi32((s32)Field->TexelCountX);
+    __m256i One = _mm256_set1_epi32(1);
+    __m256 Zero = _mm256_setzero_ps();
+    __m256 OneF = _mm256_set1_ps(1.0f);
+
+    u32 Index = 0;
+    for (; Index + 8 <= Count; Index += 8)
+    {
+        // NOTE(boti): Deinterleave the XY pairs
+        __m256 P0 = _mm256_loadu_ps((const f32*)(P + Index + 0));
+        __m256 P1 = _mm256_loadu_ps((const f32*)(P + Index + 4));
+        __m256 PX = _mm256_shuffle_ps(P0, P1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 PY = _mm256_shuffle_ps(P0, P1, _MM_SHUFFLE(3, 1, 3, 1));
+        PX = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(PX), _MM_SHUFFLE(3, 1, 2, 0)));
+        PY = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(PY), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        __m256 TexelX = _mm256_mul_ps(_mm256_sub_ps(PX, OriginX), TexelsPerMeter);
+        __m256 TexelY = _mm256_mul_ps(_mm256_sub_ps(PY, OriginY), TexelsPerMeter);
+        TexelX = _mm256_min_ps(_mm256_max_ps(TexelX, Zero), MaxTexelX);
+        TexelY = _mm256_min_ps(_mm256_max_ps(TexelY, Zero), MaxTexelY);
+        __m256i X = _mm256_min_epi32(_mm256_cvttps_epi32(TexelX), MaxIndexX);
+        __m256i Y = _mm256_min_epi32(_mm256_cvttps_epi32(TexelY), MaxIndexY);
+        __m256 FracX = _mm256_sub_ps(TexelX, _mm256_cvtepi32_ps(X));
+        __m256 FracY = _mm256_sub_ps(TexelY, _mm256_cvtepi32_ps(Y));
+
+        __m256i Index00 = _mm256_add_epi32(X, _mm256_mullo_epi32(Y, Pitch));
+        __m256i Index01 = _mm256_add_epi32(Index00, Pitch);
+        __m256 H00 = _mm256_i32gather_ps(Field->HeightData, Index00, 4);
+        __m256 H10 = _mm256_i32gather_ps(Field->HeightData, _mm256_add_epi32(Index00, One), 4);
+        __m256 H01 = _mm256_i32gather_ps(Field->HeightData, Index01, 4);
+        __m256 H11 = _mm256_i32gather_ps(Field->HeightData, _mm256_add_epi32(Index01, One), 4);
+
+        __m256 InvFracX = _mm256_sub_ps(OneF, FracX);
+        __m256 InvFracY = _mm256_sub_ps(OneF, FracY);
+        __m256 H0 = _mm256_add_ps(_mm256_mul_ps(InvFracX, H00), _mm256_mul_ps(FracX, H10));
+        __m256 H1 = _mm256_add_ps(_mm256_mul_ps(InvFracX, H01), _mm256_mul_ps(FracX, H11));
+        __m256 Height = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(InvFracY, H0), _mm256_mul_ps(FracY, H1)), OriginZ);
+        _mm256_storeu_ps(Heights + Index, Height);
+
+        if (Normals)
+        {
+            __m256 dHdX = _mm256_add_ps(_mm256_mul_ps(InvFracY, _mm256_sub_ps(H10, H00)), _mm256_mul_ps(FracY, _mm256_sub_ps(H11, H01)));
+            __m256 dHdY = _mm256_add_ps(_mm256_mul_ps(InvFracX, _mm256_sub_ps(H01, H00)), _mm256_mul_ps(FracX, _mm256_sub_ps(H11, H10)));
+            dHdX = _mm256_mul_ps(dHdX, TexelsPerMeter);
+            dHdY = _mm256_mul_ps(dHdY, TexelsPerMeter);
+            __m256 LengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dHdX, dHdX), _mm256_mul_ps(dHdY, dHdY)), OneF);
+            __m256 InvLength = _mm256_div_ps(OneF, _mm256_sqrt_ps(LengthSq));
+
+            alignas(32) f32 NX[8];
+            alignas(32) f32 NY[8];
+            alignas(32) f32 NZ[8];
+            _mm256_store_ps(NX, _mm256_mul_ps(_mm256_sub_ps(Zero, dHdX), InvLength));
+            _mm256_store_ps(NY, _mm256_mul_ps(_mm256_sub_ps(Zero, dHdY), InvLength));
+            _mm256_store_ps(NZ, InvLength);
+            for (u32 Lane = 0; Lane < 8; Lane++)
+            {
+                Normals[Index + Lane] = { NX[Lane], NY[Lane], NZ[Lane] };
+            }
+        }
+    }
+
+    for (; Index < Count; Index++)
+    {
+        SampleHeightField1(Field, Origin, P[Index], Heights + Index, Normals ? Normals + Index : nullptr);
+    }
+}
+
+internal b32 
+IntersectRayTriangle(ray Ray, v3 A, v3 B, v3 C, f32 tMax, f32* tOut)
+{
+    b32 Result = false;
+
+    v3 AB = B - A;
+    v3 AC = C - A;
+    v3 PV = Cross(Ray.V, AC);
+    f32 Det = Dot(AB, PV);
+    if (Abs(Det) > 1e-12f)
+    {
+        f32 InvDet = 1.0f / Det;
+        v3 AP = Ray.P - A;
+        f32 U = Dot(AP, PV) * InvDet;
+        if ((U >= 0.0f) && (U <= 1.0f))
+        {
+            v3 QV = Cross(AP, AB);
+            f32 V = Dot(Ray.V, QV) * InvDet;
+            if ((V >= 0.0f) && (U + V <= 1.0f))
+            {
+                f32 t = Dot(AC, QV) * InvDet;
+                if ((t >= 0.0f) && (t < tMax))
+                {
+                    *tOut = t;
+                    Result = true;
+                }
+            }
+        }
+    }
+    return(Result);
+}
+
+// NOTE(boti): Slab test against the bounds of a mip cell, returns the entry distance
+internal b32 
+IntersectRayHeightFieldCell(height_field* Field, u32 Level, u32 X, u32 Y, ray Ray, v3 InvV, f32 tMax, f32* tEnterOut)
+{
+    height_field_mip* Mip = Field->Mips + Level;
+    v2 MinMax = Mip->MinMax[X + Y*Mip->CountX];
+    f32 dS = 1.0f / Field->TexelsPerMeter;
+    mmbox Box = 
+    {
+        .Min = { dS * (f32)(X << Level), dS * (f32)(Y << Level), MinMax.X },
+        .Max = 
+        { 
+            dS * (f32)Min((X + 1) << Level, Field->TexelCountX - 1), 
+            dS * (f32)Min((Y + 1) << Level, Field->TexelCountY - 1), 
+            MinMax.Y,
+        },
+    };
+
+    f32 tEnter = 0.0f;
+    f32 tExit = tMax;
+    for (u32 Axis = 0; Axis < 3; Axis++)
+    {
+        f32 t0 = (Box.Min.E[Axis] - Ray.P.E[Axis]) * InvV.E[Axis];
+        f32 t1 = (Box.Max.E[Axis] - Ray.P.E[Axis]) * InvV.E[Axis];
+        tEnter = Max(tEnter, Min(t0, t1));
+        tExit = Min(tExit, Max(t0, t1));
+    }
+
+    *tEnterOut = tEnter;
+    b32 Result = (tEnter <= tExit);
+    return(Result);
+}
+
+lbfn b32 RaycastHeightField(height_field* Field, v3 Origin, ray Ray, f32 tMax, f32* tOut)
+{
+    b32 Result = false;
+    Assert(Field->MipCount);
+
+    Ray.P = Ray.P - Origin;
+
+    // NOTE(boti): Division by zero is intended here, the infinities fall out correctly in the slab test
+    v3 InvV = { 1.0f / Ray.V.X, 1.0f / Ray.V.Y, 1.0f / Ray.V.Z };
+
+    struct cell
+    {
+        u32 Level;
+        u32 X, Y;
+    };
+
+    // NOTE(boti): Cells are visited front-to-back (the children are pushed in order of their entry distances),
+    // and the XY projections of the cells are disjoint, so the first hit is the closest one
+    constexpr u32 MaxStackSize = 3 * height_field::MaxMipCount + 1;
+    cell Stack[MaxStackSize];
+    u32 StackAt = 0;
+
+    u32 RootLevel = Field->MipCount - 1;
+    f32 RootEnter;
+    if (IntersectRayHeightFieldCell(Field, RootLevel, 0, 0, Ray, InvV, tMax, &RootEnter))
+    {
+        Stack[StackAt++] = { RootLevel, 0, 0 };
+    }
+
+    while (StackAt && !Result)
+    {
+        cell Cell = Stack[--StackAt];
+        if (Cell.Level == 0)
+        {
+            f32 dS = 1.0f / Field->TexelsPerMeter;
+            f32* Texel = Field->HeightData + Cell.X + Cell.Y*Field->TexelCountX;
+            v3 P00 = { dS * (Cell.X + 0), dS * (Cell.Y + 0), Texel[0] };
+            v3 P10 = { dS * (Cell.X + 1), dS * (Cell.Y + 0), Texel[1] };
+            v3 P01 = { dS * (Cell.X + 0), dS * (Cell.Y + 1), Texel[Field->TexelCountX + 0] };
+            v3 P11 = { dS * (Cell.X + 1), dS * (Cell.Y + 1), Texel[Field->TexelCountX + 1] };
+
+            // NOTE(boti): Same triangulation as the terrain mesh
+            f32 t = tMax;
+            Result |= IntersectRayTriangle(Ray, P00, P10, P01, t, &t);
+            Result |= IntersectRayTriangle(Ray, P10, P11, P01, t, &t);
+            if (Result)
+            {
+                *tOut = t;
+            }
+        }
+        else
+        {
+            u32 ChildLevel = Cell.Level - 1;
+            height_field_mip* ChildMip = Field->Mips + ChildLevel;
+
+            u32 ChildCount = 0;
+            cell Children[4];
+            f32 ChildEnters[4];
+            for (u32 ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+            {
+                u32 ChildX = 2*Cell.X + (ChildIndex & 1);
+                u32 ChildY = 2*Cell.Y + (ChildIndex >> 1);
+                f32 tEnter;
+                if ((ChildX < ChildMip->CountX) && (ChildY < ChildMip->CountY) &&
+                    IntersectRayHeightFieldCell(Field, ChildLevel, ChildX, ChildY, Ray, InvV, tMax, &tEnter))
+                {
+                    // NOTE(boti): Insertion sort, farthest first
+                    u32 InsertAt = ChildCount++;
+                    while ((InsertAt > 0) && (ChildEnters[InsertAt - 1] < tEnter))
+                    {
+                        Children[InsertAt] = Children[InsertAt - 1];
+                        ChildEnters[InsertAt] = ChildEnters[InsertAt - 1];
+                        InsertAt--;
+                    }
+                    Children[InsertAt] = { ChildLevel, ChildX, ChildY };
+                    ChildEnters[InsertAt] = tEnter;
+                }
+            }
+
+            Assert(StackAt + ChildCount <= MaxStackSize);
+            for (u32 ChildIndex = 0; ChildIndex < ChildCount; ChildIndex++)
+            {
+                Stack[StackAt++] = Children[ChildIndex];
+            }
+        }
+    }
+
+    return(Result);
+}
+
+internal renderer_material 
+MakeRendererMaterial(assets* Assets, material* Material)
+{
+    texture* AlbedoTexture              = Assets->Textures + Material->AlbedoID;
+    texture* NormalTexture              = Assets->Textures + Material->NormalID;
+    texture* MetallicRoughnessTexture   = Assets->Textures + Material->MetallicRoughnessID;
+    texture* OcclusionTexture           = Assets->Textures + Material->OcclusionID;
+    texture* HeightTexture              = Assets->Textures + Material->HeightID;
+    texture* TransmissionTexture        = Assets->Textures + Material->TransmissionID;
+
+    renderer_material Result = 
+    {
+        .AlbedoID                   = AlbedoTexture->RendererID,
+        .NormalID                   = NormalTexture->RendererID,
+        .MetallicRoughnessID        = MetallicRoughnessTexture->RendererID,
+        .OcclusionID                = OcclusionTexture->RendererID,
+        .HeightID                   = HeightTexture->RendererID,
+        .TransmissionID             = TransmissionTexture->RendererID,
+        .AlbedoSamplerID            = Material->AlbedoSamplerID,
+        .NormalSamplerID            = Material->NormalSamplerID,
+        .MetallicRoughnessSamplerID = Material->MetallicRoughnessSamplerID,
+        .TransmissionSamplerID      = Material->TransmissionSamplerID,
+        .AlphaThreshold             = Material->AlphaThreshold,
+        .Transmission               = Material->Transmission,
+        .BaseAlbedo                 = Material->Albedo,
+        .BaseMaterial               = Material->MetallicRoughness,
+        .Emissive                   = Material->Emission,
+    };
+    return(Result);
+}
+
+internal draw_group 
+GetDrawGroup(material* Material)
+{
+    draw_group TransparencyToDrawGroupTable[Transparency_Count] =
+    {
+        [Transparency_Opaque] = DrawGroup_Opaque,
+        [Transparency_AlphaTest] = DrawGroup_AlphaTest,
+        [Transparency_AlphaBlend] = DrawGroup_AlphaTest,
+    };
+
+    draw_group Result = TransparencyToDrawGroupTable[Material->Transparency];
+    if (Material->TransmissionEnabled)
+    {
+        Result = DrawGroup_Transparent;
+    }
+    return(Result);
+}
+
+//
+// Terrain
+//
+
+internal f32 
+GetHeightTexel(height_field* Field, s32 X, s32 Y)
+{
+    X = Clamp(X, 0, (s32)Field->TexelCountX - 1);
+    Y = Clamp(Y, 0, (s32)Field->TexelCountY - 1);
+    f32 Result = Field->HeightData[X + Y*Field->TexelCountX];
+    return(Result);
+}
+
+internal vertex 
+GetTerrainVertex(height_field* Field, s32 X, s32 Y, s32 Stride)
+{
+    f32 dS = 1.0f / Field->TexelsPerMeter;
+
+    // NOTE(boti): Vertices outside the height field get collapsed onto the edge
+    s32 ClampedX = Clamp(X, 0, (s32)Field->TexelCountX - 1);
+    s32 ClampedY = Clamp(Y, 0, (s32)Field->TexelCountY - 1);
+    v3 P = { dS*ClampedX, dS*ClampedY, GetHeightTexel(Field, ClampedX, ClampedY) };
+
+    f32 HeightXn = GetHeightTexel(Field, ClampedX - Stride, ClampedY);
+    f32 HeightXp = GetHeightTexel(Field, ClampedX + Stride, ClampedY);
+    f32 HeightYn = GetHeightTexel(Field, ClampedX, ClampedY - Stride);
+    f32 HeightYp = GetHeightTexel(Field, ClampedX, ClampedY + Stride);
+
+    v3 T = NOZ(v3{ 2.0f * dS * Stride, 0.0f, HeightXp - HeightXn });
+    v3 B = NOZ(v3{ 0.0f, 2.0f * dS * Stride, HeightYp - HeightYn });
+    v3 N = NOZ(Cross(T, B));
+
+    vertex Result = 
+    {
+        .P = P,
+        .N = N, 
+        .T = { T.X, T.Y, T.Z, 1.0f },
+        .TexCoord = { 0.5f * P.X, 0.5f * P.Y },
+        .Color = PackRGBA8(0xFF, 0xFF, 0xFF),
+    };
+    return(Result);
+}
+
+// NOTE(boti): Returns the grid coordinates of the Index-th vertex on an edge,
+// edges are walked counter-clockwise (looking down from +Z) so that the skirts face outwards
+internal v2u 
+GetTerrainBorderVertex(u32 Edge, u32 Index)
+{
+    constexpr u32 Q = terrain::ChunkQuadCount;
+    v2u Result = {};
+    switch (Edge)
+    {
+        case 0: Result = { Index, 0 }; break;
+        case 1: Result = { Q, Index }; break;
+        case 2: Result = { Q - Index, Q }; break;
+        case 3: Result = { 0, Q - Index }; break;
+        InvalidDefaultCase;
+    }
+    return(Result);
+}
+
+internal terrain_node* 
+GetTerrainNode(terrain* Terrain, u32 Level, u32 X, u32 Y)
+{
+    u32 CountPerSide = Terrain->LeafCountPerSide >> Level;
+    Assert((X < CountPerSide) && (Y < CountPerSide));
+    terrain_node* Result = Terrain->Nodes + Terrain->LevelNodeOffsets[Level] + X + Y*CountPerSide;
+    return(Result);
+}
+
+internal f32 GetTerrainNodeSize(terrain* Terrain, u32 Level)
+{
+    f32 Result = Terrain->LeafSize * (f32)(1u << Level);
+    return(Result);
+}
+
+internal f32 
+GetTerrainMorphStart(terrain* Terrain, u32 Level)
+{
+    f32 PrevRange = (Level == 0) ? 0.0f : Terrain->LODRanges[Level - 1];
+    f32 Result = PrevRange + Terrain->MorphStartRatio * (Terrain->LODRanges[Level] - PrevRange);
+    return(Result);
+}
+
+// NOTE(boti): Min/max distance between P and the world-space box of a node
+internal v2 
+GetTerrainNodeDistance(terrain* Terrain, terrain_node* Node, v3 P)
+{
+    v3 BoxMin = Terrain->P + Node->Box.Min;
+    v3 BoxMax = Terrain->P + Node->Box.Max;
+    v3 Near = {};
+    v3 Far = {};
+    for (u32 Axis = 0; Axis < 3; Axis++)
+    {
+        Near.E[Axis] = Max(Max(BoxMin.E[Axis] - P.E[Axis], P.E[Axis] - BoxMax.E[Axis]), 0.0f);
+        Far.E[Axis] = Max(Abs(P.E[Axis] - BoxMin.E[Axis]), Abs(P.E[Axis] - BoxMax.E[Axis]));
+    }
+    v2 Result = { VectorLength(Near), VectorLength(Far) };
+    return(Result);
+}
+
+// NOTE(boti): 0 if none of the vertices are morphed, 2 if all of them are fully morphed, 1 otherwise
+internal u32 
+GetTerrainMorphClass(terrain* Terrain, u32 Level, terrain_node* Node, v3 CameraP)
+{
+    u32 Result = 0;
+    if (Level + 1 < Terrain->LevelCount)
+    {
+        v2 Distance = GetTerrainNodeDistance(Terrain, Node, CameraP);
+        if      (Distance.Y <= GetTerrainMorphStart(Terrain, Level)) Result = 0;
+        else if (Distance.X >= Terrain->LODRanges[Level])            Result = 2;
+        else                                                         Result = 1;
+    }
+    return(Result);
+}
+
+lbfn void InitTerrain(terrain* Terrain, height_field* Field, v3 P, u32 MaterialID, memory_arena* Arena)
+{
+    Terrain->Field = Field;
+    Terrain->P = P;
+    Terrain->MaterialID = MaterialID;
+
+    u32 QuadCount = Max(Field->TexelCountX, Field->TexelCountY) - 1;
+    u32 LeafCount = CeilDiv(QuadCount, Terrain->ChunkQuadCount);
+    Terrain->LevelCount = 1;
+    Terrain->LeafCountPerSide = 1;
+    while (Terrain->LeafCountPerSide < LeafCount)
+    {
+        Terrain->LeafCountPerSide <<= 1;
+        Terrain->LevelCount++;
+    }
+    Assert(Terrain->LevelCount <= Terrain->MaxLevelCount);
+    Terrain->LeafSize = Terrain->ChunkQuadCount / Field->TexelsPerMeter;
+
+    Terrain->NodeCount = 0;
+    for (u32 Level = 0; Level < Terrain->LevelCount; Level++)
+    {
+        u32 CountPerSide = Terrain->LeafCountPerSide >> Level;
+        Terrain->LevelNodeOffsets[Level] = Terrain->NodeCount;
+        Terrain->NodeCount += CountPerSide * CountPerSide;
+        Terrain->LODRanges[Level] = Terrain->LODRangeRatio * GetTerrainNodeSize(Terrain, Level);
+    }
+    Terrain->Nodes = PushArray(Arena, 0, terrain_node, Terrain->NodeCount);
+
+    // Leaf bounds
+    f32 dS = 1.0f / Field->TexelsPerMeter;
+    for (u32 Y = 0; Y < Terrain->LeafCountPerSide; Y++)
+    {
+        for (u32 X = 0; X < Terrain->LeafCountPerSide; X++)
+        {
+            terrain_node* Node = GetTerrainNode(Terrain, 0, X, Y);
+            Node->ChunkIndex = U32_MAX;
+
+            u32 TexelX0 = X * Terrain->ChunkQuadCount;
+            u32 TexelY0 = Y * Terrain->ChunkQuadCount;
+            Node->IsEmpty = (TexelX0 + 1 >= Field->TexelCountX) || (TexelY0 + 1 >= Field->TexelCountY);
+            if (!Node->IsEmpty)
+            {
+                u32 TexelX1 = Min(TexelX0 + Terrain->ChunkQuadCount, Field->TexelCountX - 1);
+                u32 TexelY1 = Min(TexelY0 + Terrain->ChunkQuadCount, Field->TexelCountY - 1);
+
+                f32 MinHeight = +F32_MAX_NORMAL;
+                f32 MaxHeight = -F32_MAX_NORMAL;
+                for (u32 TexelY = TexelY0; TexelY <= TexelY1; TexelY++)
+                {
+                    for (u32 TexelX = TexelX0; TexelX <= TexelX1; TexelX++)
+                    {
+                        f32 Height = Field->HeightData[TexelX + TexelY*Field->TexelCountX];
+                        MinHeight = Min(MinHeight, Height);
+                        MaxHeight = Max(MaxHeight, Height);
+                    }
+                }
+
+                f32 SkirtDepth = Terrain->SkirtDepthRatio * GetTerrainNodeSize(Terrain, 0);
+                Node->Box = 
+                {
+                    .Min = { dS * TexelX0, dS * TexelY0, MinHeight - SkirtDepth },
+                    .Max = { dS * TexelX1, dS * TexelY1, MaxHeight },
+                };
+            }
+        }
+    }
+
+    // Inner node bounds
+    for (u32 Level = 1; Level < Terrain->LevelCount; Level++)
+    {
+        u32 CountPerSide = Terrain->LeafCountPerSide >> Level;
+        f32 SkirtDepth = Terrain->SkirtDepthRatio * GetTerrainNodeSize(Terrain, Level);
+        for (u32 Y = 0; Y < CountPerSide; Y++)
+        {
+            for (u32 X = 0; X < CountPerSide; X++)
+            {
+                terrain_node* Node = GetTerrainNode(Terrain, Level, X, Y);
+                Node->ChunkIndex = U32_MAX;
+                Node->IsEmpty = true;
+                for (u32 ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+                {
+                    terrain_node* Child = GetTerrainNode(Terrain, Level - 1, 2*X + (ChildIndex & 1), 2*Y + (ChildIndex >> 1));
+                    if (!Child->IsEmpty)
+                    {
+                        Node->Box = Node->IsEmpty ? Child->Box : Union(Node->Box, Child->Box);
+                        Node->IsEmpty = false;
+                    }
+                }
+                Node->Box.Min.Z -= SkirtDepth;
+            }
+        }
+    }
+
+    // Shared index data
+    {
+        constexpr u32 Q = terrain::ChunkQuadCount;
+        constexpr u32 VertexCountPerSide = terrain::ChunkVertexCountPerSide;
+        Terrain->IndexData = PushArray(Arena, 0, vert_index, Terrain->ChunkIndexCount);
+        vert_index* IndexAt = Terrain->IndexData;
+        for (u32 Y = 0; Y < Q; Y++)
+        {
+            for (u32 X = 0; X < Q; X++)
+            {
+                *IndexAt++ = (X + 0) + (Y + 0)*VertexCountPerSide;
+                *IndexAt++ = (X + 1) + (Y + 0)*VertexCountPerSide;
+                *IndexAt++ = (X + 0) + (Y + 1)*VertexCountPerSide;
+                *IndexAt++ = (X + 1) + (Y + 0)*VertexCountPerSide;
+                *IndexAt++ = (X + 1) + (Y + 1)*VertexCountPerSide;
+                *IndexAt++ = (X + 0) + (Y + 1)*VertexCountPerSide;
+            }
+        }
+
+        for (u32 Edge = 0; Edge < 4; Edge++)
+        {
+            u32 SkirtBase = Terrain->ChunkGridVertexCount + Edge*VertexCountPerSide;
+            for (u32 Index = 0; Index < Q; Index++)
+            {
+                v2u A = GetTerrainBorderVertex(Edge, Index + 0);
+                v2u B = GetTerrainBorderVertex(Edge, Index + 1);
+                u32 TopA = A.X + A.Y*VertexCountPerSide;
+                u32 TopB = B.X + B.Y*VertexCountPerSide;
+                u32 BottomA = SkirtBase + Index + 0;
+                u32 BottomB = SkirtBase + Index + 1;
+
+                *IndexAt++ = BottomA;
+                *IndexAt++ = BottomB;
+                *IndexAt++ = TopB;
+                *IndexAt++ = BottomA;
+                *IndexAt++ = TopB;
+                *IndexAt++ = TopA;
+            }
+        }
+        Assert(IndexAt == Terrain->IndexData + Terrain->ChunkIndexCount);
+    }
+
+    for (u32 ChunkIndex = 0; ChunkIndex < Terrain->MaxChunkCount; ChunkIndex++)
+    {
+        Terrain->Chunks[ChunkIndex] = { .NodeIndex = U32_MAX };
+    }
+
+    Terrain->JobCount = 0;
+    for (u32 JobIndex = 0; JobIndex < Terrain->MaxJobCount; JobIndex++)
+    {
+        Terrain->Jobs[JobIndex] = 
+        {
+            .Terrain = Terrain,
+            .ChunkIndex = U32_MAX,
+            .VertexData = PushArray(Arena, 0, vertex, Terrain->ChunkVertexCount),
+        };
+    }
+}
+
+internal void 
+GenerateTerrainChunk(thread_context* ThreadContext, void* Params)
+{
+    TimedFunctionMT(Platform.Profiler, ThreadContext->ThreadID);
+
+    terrain_job* Job = (terrain_job*)Params;
+    terrain* Terrain = Job->Terrain;
+    terrain_chunk* Chunk = Terrain->Chunks + Job->ChunkIndex;
+    height_field* Field = Terrain->Field;
+
+    u32 Level = Chunk->Level;
+    u32 CountPerSide = Terrain->LeafCountPerSide >> Level;
+    u32 LocalNodeIndex = Chunk->NodeIndex - Terrain->LevelNodeOffsets[Level];
+    s32 Stride = 1 << Level;
+    s32 TexelX0 = (s32)((LocalNodeIndex % CountPerSide) * Terrain->ChunkQuadCount) * Stride;
+    s32 TexelY0 = (s32)((LocalNodeIndex / CountPerSide) * Terrain->ChunkQuadCount) * Stride;
+
+    b32 DoMorph = (Level + 1 < Terrain->LevelCount);
+    f32 MorphStart = GetTerrainMorphStart(Terrain, Level);
+    f32 MorphEnd = Terrain->LODRanges[Level];
+    f32 InvMorphRange = 1.0f / (MorphEnd - MorphStart);
+
+    constexpr u32 VertexCountPerSide = terrain::ChunkVertexCountPerSide;
+    vertex* VertexAt = Job->VertexData;
+    for (u32 Y = 0; Y < VertexCountPerSide; Y++)
+    {
+        for (u32 X = 0; X < VertexCountPerSide; X++)
+        {
+            vertex Vertex = GetTerrainVertex(Field, TexelX0 + X*Stride, TexelY0 + Y*Stride, Stride);
+            if (DoMorph)
+            {
+                // NOTE(boti): Odd vertices collapse onto their even neighbor, which turns the grid into the coarser level's.
+                // The target normal is also evaluated at the coarser level's stride so that the shading matches too.
+                vertex Target = GetTerrainVertex(Field, TexelX0 + (X & ~1u)*Stride, TexelY0 + (Y & ~1u)*Stride, 2*Stride);
+                f32 Distance = VectorLength(Terrain->P + Vertex.P - Job->CameraP);
+                f32 MorphFactor = Clamp((Distance - MorphStart) * InvMorphRange, 0.0f, 1.0f);
+
+                Vertex.P = Lerp(Vertex.P, Target.P, MorphFactor);
+                Vertex.N = NOZ(Lerp(Vertex.N, Target.N, MorphFactor));
+                Vertex.T.XYZ = NOZ(Lerp(Vertex.T.XYZ, Target.T.XYZ, MorphFactor));
+                Vertex.TexCoord = Lerp(Vertex.TexCoord, Target.TexCoord, MorphFactor);
+            }
+            *VertexAt++ = Vertex;
+        }
+    }
+
+    f32 SkirtDepth = Terrain->SkirtDepthRatio * GetTerrainNodeSize(Terrain, Level);
+    for (u32 Edge = 0; Edge < 4; Edge++)
+    {
+        for (u32 Index = 0; Index < VertexCountPerSide; Index++)
+        {
+            v2u GridP = GetTerrainBorderVertex(Edge, Index);
+            vertex Vertex = Job->VertexData[GridP.X + GridP.Y*VertexCountPerSide];
+            Vertex.P.Z -= SkirtDepth;
+            *VertexAt++ = Vertex;
+        }
+    }
+    Assert(VertexAt == Job->VertexData + Terrain->ChunkVertexCount);
+
+    // NOTE(boti): The exchange is a full barrier, so the vertices are visible by the time the main thread sees the flag
+    AtomicExchange(&Job->IsDone, 1);
+}
+
+internal void 
+StartTerrainJob(terrain* Terrain, u32 ChunkIndex, v3 CameraP)
+{
+    terrain_chunk* Chunk = Terrain->Chunks + ChunkIndex;
+    Assert(!Chunk->IsGenerating);
+    Assert(Terrain->JobCount < Terrain->MaxJobCount);
+
+    terrain_job* Job = nullptr;
+    for (u32 JobIndex = 0; JobIndex < Terrain->MaxJobCount; JobIndex++)
+    {
+        if (Terrain->Jobs[JobIndex].ChunkIndex == U32_MAX)
+        {
+            Job = Terrain->Jobs + JobIndex;
+            break;
+        }
+    }
+    Assert(Job);
+    Terrain->JobCount++;
+
+    Job->ChunkIndex = ChunkIndex;
+    Job->CameraP = CameraP;
+    Job->IsDone = 0;
+
+    Chunk->IsGenerating = true;
+    Chunk->MorphP = CameraP;
+    Chunk->MorphClass = GetTerrainMorphClass(Terrain, Chunk->Level, Terrain->Nodes + Chunk->NodeIndex, CameraP);
+
+    Platform.AddWorkEntry(Platform.BackgroundQueue, GenerateTerrainChunk, Job);
+}
+
+internal void 
+RequestTerrainNode(terrain* Terrain, u32 Level, terrain_node* Node, v3 CameraP)
+{
+    if ((Node->ChunkIndex == U32_MAX) && (Terrain->JobCount < Terrain->MaxJobCount))
+    {
+        // NOTE(boti): Chunks that were used in the previous frame aren't evicted,
+        // they might just not have been visited by the selection yet
+        u32 ChunkIndex = U32_MAX;
+        u32 OldestFrameIndex = U32_MAX;
+        for (u32 Index = 0; Index < Terrain->MaxChunkCount; Index++)
+        {
+            terrain_chunk* Chunk = Terrain->Chunks + Index;
+            if (Chunk->NodeIndex == U32_MAX)
+            {
+                ChunkIndex = Index;
+                break;
+            }
+            else if (!Chunk->IsGenerating && 
+                     (Chunk->LastUsedFrameIndex + 1 < Terrain->FrameIndex) && 
+                     (Chunk->LastUsedFrameIndex < OldestFrameIndex))
+            {
+                ChunkIndex = Index;
+                OldestFrameIndex = Chunk->LastUsedFrameIndex;
+            }
+        }
+
+        if (ChunkIndex != U32_MAX)
+        {
+            terrain_chunk* Chunk = Terrain->Chunks + ChunkIndex;
+            if (Chunk->NodeIndex != U32_MAX)
+            {
+                Terrain->Nodes[Chunk->NodeIndex].ChunkIndex = U32_MAX;
+            }
+
+            Chunk->NodeIndex = (u32)(Node - Terrain->Nodes);
+            Chunk->Level = Level;
+            Chunk->IsResident = false;
+            Chunk->LastUsedFrameIndex = Terrain->FrameIndex;
+            Node->ChunkIndex = ChunkIndex;
+            StartTerrainJob(Terrain, ChunkIndex, CameraP);
+        }
+    }
+}
+
+internal b32 
+IsTerrainNodeResident(terrain* Terrain, terrain_node* Node)
+{
+    b32 Result = (Node->ChunkIndex != U32_MAX) && Terrain->Chunks[Node->ChunkIndex].IsResident;
+    return(Result);
+}
+
+internal void 
+AddSelectedTerrainNode(terrain* Terrain, u32 Level, u32 X, u32 Y, v3 CameraP)
+{
+    terrain_node* Node = GetTerrainNode(Terrain, Level, X, Y);
+    if (!Node->IsEmpty)
+    {
+        if (IsTerrainNodeResident(Terrain, Node))
+        {
+            if (Terrain->SelectedNodeCount < Terrain->MaxSelectedNodeCount)
+            {
+                Terrain->SelectedNodes[Terrain->SelectedNodeCount++] = (u32)(Node - Terrain->Nodes);
+                Terrain->Chunks[Node->ChunkIndex].LastUsedFrameIndex = Terrain->FrameIndex;
+            }
+        }
+        else
+        {
+            RequestTerrainNode(Terrain, Level, Node, CameraP);
+
+            // NOTE(boti): Draw the children in the meantime if they're available (e.g. when moving away from a region)
+            if (Level > 0)
+            {
+                b32 AreChildrenResident = true;
+                for (u32 ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+                {
+                    terrain_node* Child = GetTerrainNode(Terrain, Level - 1, 2*X + (ChildIndex & 1), 2*Y + (ChildIndex >> 1));
+                    AreChildrenResident = AreChildrenResident && (Child->IsEmpty || IsTerrainNodeResident(Terrain, Child));
+                }
+
+                if (AreChildrenResident)
+                {
+                    for (u32 ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+                    {
+                        AddSelectedTerrainNode(Terrain, Level - 1, 2*X + (ChildIndex & 1), 2*Y + (ChildIndex >> 1), CameraP);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// NOTE(boti): Returns false if the node is outside its LOD range and should be handled by the parent
+internal b32 
+SelectTerrainNode(terrain* Terrain, u32 Level, u32 X, u32 Y, v3 CameraP)
+{
+    b32 Result = true;
 
-    u32 X = (u32)(s32)P0.X;
-    u32 Y = (u32)(s32)P0.Y;
+    terrain_node* Node = GetTerrainNode(Terrain, Level, X, Y);
+    if (!Node->IsEmpty)
+    {
+        f32 Distance = GetTerrainNodeDistance(Terrain, Node, CameraP).X;
+        if (Distance > Terrain->LODRanges[Level])
+        {
+            Result = false;
+        }
+        else if ((Level == 0) || (Distance > Terrain->LODRanges[Level - 1]))
+        {
+            AddSelectedTerrainNode(Terrain, Level, X, Y, CameraP);
+        }
+        else
+        {
+            // NOTE(boti): The node is only subdivided once all of its children are resident,
+            // children outside their own range are drawn at their level instead of drawing parts of this node
+            b32 AreChildrenResident = true;
+            for (u32 ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+            {
+                terrain_node* Child = GetTerrainNode(Terrain, Level - 1, 2*X + (ChildIndex & 1), 2*Y + (ChildIndex >> 1));
+                if (!Child->IsEmpty && !IsTerrainNodeResident(Terrain, Child))
+                {
+                    RequestTerrainNode(Terrain, Level - 1, Child, CameraP);
+                    AreChildrenResident = false;
+                }
+            }
+
+            if (AreChildrenResident)
+            {
+                for (u32 ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+                {
+                    u32 ChildX = 2*X + (ChildIndex & 1);
+                    u32 ChildY = 2*Y + (ChildIndex >> 1);
+                    if (!SelectTerrainNode(Terrain, Level - 1, ChildX, ChildY, CameraP))
+                    {
+                        AddSelectedTerrainNode(Terrain, Level - 1, ChildX, ChildY, CameraP);
+                    }
+                }
+            }
+            else
+            {
+                AddSelectedTerrainNode(Terrain, Level, X, Y, CameraP);
+            }
+        }
+    }
 
-    // TODO(boti): Pull this out once we have a use for it elsewhere
-    // NOTE(boti): Murmur3
-    auto Hash = [](u32 Seed, u32 X, u32 Y) -> u32
+    return(Result);
+}
+
+lbfn void UpdateAndRenderTerrain(terrain* Terrain, assets* Assets, render_frame* Frame)
+{
+    TimedFunction(Platform.Profiler);
+
+    // NOTE(boti): The index data is the same for every chunk, so it only gets uploaded once
+    if (!Terrain->IsIndexDataResident)
     {
-        u32 Result = Seed;
+        if (!Terrain->IndexAllocation.IndexBlock)
+        {
+            Terrain->IndexAllocation = Platform.AllocateGeometry(Frame->Renderer, 0, Terrain->ChunkIndexCount);
+        }
 
-        u32 Values[2] = { X, Y };
-        for (u32 Index = 0; Index < 2; Index++)
+        if (Terrain->IndexAllocation.IndexBlock && TransferGeometry(Frame, Terrain->IndexAllocation, nullptr, Terrain->IndexData))
         {
-            u32 K = 0xCC9E2D51u * Values[Index];
-            // TODO(boti): Rotate intrinsics
-            K = (K << 15) | (K >> (32 - 15));
-            K *= 0x1B873593u;
+            Terrain->IsIndexDataResident = true;
+        }
+    }
 
-            Result ^= K;
-            Result = (Result << 13) | (Result >> (32 - 13));
-            Result = 5u*Result + 0xE6546B64u;
+    // NOTE(boti): Jobs that haven't finished yet are picked up in a later frame, 
+    // their chunks keep drawing the previous mesh (or their parent) in the meantime
+    for (u32 JobIndex = 0; JobIndex < Terrain->MaxJobCount; JobIndex++)
+    {
+        terrain_job* Job = Terrain->Jobs + JobIndex;
+        if ((Job->ChunkIndex == U32_MAX) || !AtomicLoad(&Job->IsDone))
+        {
+            continue;
         }
 
-        // NOTE(boti): Final mix step
-        Result ^= Result >> 16;
-        Result *= 0x85EBCA6Bu;
-        Result ^= Result >> 13;
-        Result *= 0xC2B2AE35u;
-        Result ^= Result >> 16;
-        return(Result);
-    };
+        terrain_chunk* Chunk = Terrain->Chunks + Job->ChunkIndex;
+        Chunk->IsGenerating = false;
+        Job->ChunkIndex = U32_MAX;
+        Terrain->JobCount--;
 
-    u32 Hash00 = Hash(Noise->Seed, X + 0, Y + 0);
-    u32 Hash10 = Hash(Noise->Seed, X + 1, Y + 0);
-    u32 Hash01 = Hash(Noise->Seed, X + 0, Y + 1);
-    u32 Hash11 = Hash(Noise->Seed, X + 1, Y + 1);
+        // NOTE(boti): The frames in flight may still be drawing the previous mesh of the chunk,
+        // so the new vertices always go to a fresh allocation and the old one gets a deferred free
+        geometry_buffer_allocation Allocation = Platform.AllocateGeometry(Frame->Renderer, Terrain->ChunkVertexCount, 0);
+        b32 IsUploaded = Allocation.VertexBlock && TransferGeometry(Frame, Allocation, Job->VertexData, nullptr);
 
-    v2 GradTable[4]
+        if (Chunk->Allocation.VertexBlock)
+        {
+            FreeGeometry(Frame, Chunk->Allocation);
+            Chunk->Allocation = {};
+        }
+
+        if (IsUploaded)
+        {
+            Chunk->Allocation = Allocation;
+            Chunk->IsResident = true;
+        }
+        else
+        {
+            if (Allocation.VertexBlock)
+            {
+                FreeGeometry(Frame, Allocation);
+            }
+            Terrain->Nodes[Chunk->NodeIndex].ChunkIndex = U32_MAX;
+            Chunk->NodeIndex = U32_MAX;
+            Chunk->IsResident = false;
+        }
+    }
+    Terrain->FrameIndex++;
+
+    v3 CameraP = Frame->CameraTransform.P.XYZ;
+
+    Terrain->SelectedNodeCount = 0;
     {
-        { -1.0f, -1.0f },
-        { +1.0f, -1.0f },
-        { -1.0f, +1.0f },
-        { +1.0f, +1.0f },
+        TimedBlock(Platform.Profiler, "SelectTerrainNodes");
 
-    };
-    v2 Grad00 = GradTable[Hash00 & 3];
-    v2 Grad10 = GradTable[Hash10 & 3];
-    v2 Grad01 = GradTable[Hash01 & 3];
-    v2 Grad11 = GradTable[Hash11 & 3];
+        // NOTE(boti): The root is always drawn, even when it's outside its LOD range
+        u32 RootLevel = Terrain->LevelCount - 1;
+        if (!SelectTerrainNode(Terrain, RootLevel, 0, 0, CameraP))
+        {
+            AddSelectedTerrainNode(Terrain, RootLevel, 0, 0, CameraP);
+        }
+    }
 
-    f32 D00 = Dot(dP, Grad00);
-    f32 D10 = Dot(dP - v2{ 1.0f, 0.0f }, Grad10);
-    f32 D01 = Dot(dP - v2{ 0.0f, 1.0f }, Grad01);
-    f32 D11 = Dot(dP - v2{ 1.0f, 1.0f }, Grad11);
+    material* Material = Assets->Materials + Terrain->MaterialID;
+    renderer_material RenderMaterial = MakeRendererMaterial(Assets, Material);
+    draw_group Group = GetDrawGroup(Material);
+    m4 Transform = M4(1.0f, 0.0f, 0.0f, Terrain->P.X,
+                      0.0f, 1.0f, 0.0f, Terrain->P.Y,
+                      0.0f, 0.0f, 1.0f, Terrain->P.Z,
+                      0.0f, 0.0f, 0.0f, 1.0f);
 
-    auto Fade = [](f32 X) -> f32
+    // NOTE(boti): Regenerating the morph of a chunk is only a quality improvement, 
+    // so it gets deferred while the upload budget of the frame is used up (e.g. while textures are streaming in)
+    umm ChunkByteCount = (umm)Terrain->ChunkVertexCount * sizeof(vertex);
+    b32 CanRegenerateChunks = GetUploadBudget(Frame) >= ChunkByteCount;
+
+    for (u32 SelectedIndex = 0; SelectedIndex < Terrain->SelectedNodeCount; SelectedIndex++)
     {
-        f32 Result = X*X*X * ((6.0f*X - 15.0f)*X + 10.0f);
-        return(Result);
-    };
-    f32 U = Fade(dP.X);
-    f32 V = Fade(dP.Y);
-    f32 X0 = Lerp(D00, D10, U);
-    f32 X1 = Lerp(D01, D11, U);
-    f32 Result = Lerp(X0, X1, V);
+        terrain_node* Node = Terrain->Nodes + Terrain->SelectedNodes[SelectedIndex];
+        terrain_chunk* Chunk = Terrain->Chunks + Node->ChunkIndex;
+
+        // NOTE(boti): The morph is baked into the vertices, so it needs to be regenerated as the camera moves.
+        // The old mesh keeps being drawn until the new one has been uploaded to its own allocation
+        if (CanRegenerateChunks && !Chunk->IsGenerating && (Terrain->JobCount < Terrain->MaxJobCount))
+        {
+            u32 MorphClass = GetTerrainMorphClass(Terrain, Chunk->Level, Node, CameraP);
+            f32 MorphRange = Terrain->LODRanges[Chunk->Level] - GetTerrainMorphStart(Terrain, Chunk->Level);
+            b32 IsOutdated = (MorphClass != Chunk->MorphClass) || 
+                ((MorphClass == 1) && (VectorLength(CameraP - Chunk->MorphP) > Terrain->MorphUpdateRatio * MorphRange));
+            if (IsOutdated)
+            {
+                StartTerrainJob(Terrain, Node->ChunkIndex, CameraP);
+            }
+        }
+
+        if (Terrain->IsIndexDataResident)
+        {
+            geometry_buffer_allocation Geometry = { Chunk->Allocation.VertexBlock, Terrain->IndexAllocation.IndexBlock };
+            DrawMesh(Frame, Group, Geometry, Transform, Node->Box, RenderMaterial, 0, nullptr);
+        }
+    }
+}
+
+lbfn f32 SampleTerrainHeight(game_world* World, v2 P)
+{
+    f32 Result = 0.0f;
+    if (World->HeightField.HeightData)
+    {
+        SampleHeightField1(&World->HeightField, World->Terrain.P, P, &Result, nullptr);
+    }
     return(Result);
 }
 
-internal mesh_data 
-GenerateTerrainChunk(height_field* Field, memory_arena* Arena)
+lbfn v4 SampleTerrain(game_world* World, v2 P)
 {
-    mesh_data Result = {};
+    v4 Result = { 0.0f, 0.0f, 1.0f, 0.0f };
+    if (World->HeightField.HeightData)
+    {
+        f32 Height;
+        v3 N;
+        SampleHeightField1(&World->HeightField, World->Terrain.P, P, &Height, &N);
+        Result = { N.X, N.Y, N.Z, -Dot(N, v3{ P.X, P.Y, Height }) };
+    }
+    return(Result);
+}
 
-    Result.Box = { { +F32_MAX_NORMAL, +F32_MAX_NORMAL, +F32_MAX_NORMAL }, { -F32_MAX_NORMAL, -F32_MAX_NORMAL, -F32_MAX_NORMAL } };
+internal void 
+UpdateAndRenderParticleSystem(thread_context* ThreadContext, void* Params)
+{
+    TimedFunctionMT(Platform.Profiler, ThreadContext->ThreadID);
+
+    particle_system_job* Job = (particle_system_job*)Params;
+    particle_system* System = Job->System;
+
+    __m256 dt = _mm256_set1_ps(Job->dt);
+    __m256 HalfdtSq = _mm256_set1_ps(0.5f * Job->dt * Job->dt);
+    __m256 Zero = _mm256_setzero_ps();
+    __m256 BoundsMin[3] = { _mm256_set1_ps(+F32_MAX_NORMAL), _mm256_set1_ps(+F32_MAX_NORMAL), _mm256_set1_ps(+F32_MAX_NORMAL) };
+    __m256 BoundsMax[3] = { _mm256_set1_ps(-F32_MAX_NORMAL), _mm256_set1_ps(-F32_MAX_NORMAL), _mm256_set1_ps(-F32_MAX_NORMAL) };
+    __m256i LaneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i ParticleCount = _mm256_set1_epi32((s32)System->ParticleCount);
+
+    u32 VisibleCount = 0;
+    u32 SortKeys[particle_system::MaxParticleCount];
+    u32 SortIndices[particle_system::MaxParticleCount];
+    u32 TempKeys[particle_system::MaxParticleCount];
+    u32 TempIndices[particle_system::MaxParticleCount];
+
+    for (u32 BaseIndex = 0; BaseIndex < System->ParticleCount; BaseIndex += 8)
+    {
+        __m256 P[3];
+        __m256 ValidMask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(ParticleCount, _mm256_add_epi32(_mm256_set1_epi32((s32)BaseIndex), LaneIndices)));
+        __m256 CullMask = ValidMask;
+        for (u32 Component = 0; Component < 3; Component++)
+        {
+            // NOTE(boti): Same as AdvanceParticle, the acceleration is constant so this is exact for any dt
+            P[Component] = _mm256_load_ps(System->P[Component] + BaseIndex);
+            __m256 dP = _mm256_load_ps(System->dP[Component] + BaseIndex);
+            __m256 ddP = _mm256_load_ps(System->ddP[Component] + BaseIndex);
+            __m256 Color = _mm256_load_ps(System->Color[Component] + BaseIndex);
+            __m256 dColor = _mm256_load_ps(System->dColor[Component] + BaseIndex);
 
-    Result.VertexCount = Field->TexelCountX*Field->TexelCountY;
-    Result.VertexData = PushArray(Arena, 0, vertex, Result.VertexCount);
+            P[Component] = _mm256_add_ps(P[Component], _mm256_add_ps(_mm256_mul_ps(dt, dP), _mm256_mul_ps(HalfdtSq, ddP)));
+            dP = _mm256_add_ps(dP, _mm256_mul_ps(ddP, dt));
+            Color = _mm256_add_ps(Color, _mm256_mul_ps(dColor, dt));
 
-    auto SampleHeight = [](height_field* Field, s32 X, s32 Y)
-    {
-        X = Clamp(X, 0, (s32)Field->TexelCountX - 1);
-        Y = Clamp(Y, 0, (s32)Field->TexelCountY - 1);
-        f32 Result = Field->HeightData[X + Y*Field->TexelCountX];
-        return(Result);
-    };
+            _mm256_store_ps(System->P[Component] + BaseIndex, P[Component]);
+            _mm256_store_ps(System->dP[Component] + BaseIndex, dP);
+            _mm256_store_ps(System->Color[Component] + BaseIndex, Color);
 
-    f32 dS = 1.0f / Field->TexelsPerMeter;
-    vertex* VertexAt = Result.VertexData;
-    for (s32 Y = 0; Y < (s32)Field->TexelCountY; Y++)
-    {
-        for (s32 X = 0; X < (s32)Field->TexelCountX; X++)
+            BoundsMin[Component] = _mm256_min_ps(BoundsMin[Component], _mm256_blendv_ps(_mm256_set1_ps(+F32_MAX_NORMAL), P[Component], ValidMask));
+            BoundsMax[Component] = _mm256_max_ps(BoundsMax[Component], _mm256_blendv_ps(_mm256_set1_ps(-F32_MAX_NORMAL), P[Component], ValidMask));
+
+            if (System->CullOutOfBoundsParticles)
+            {
+                __m256 Min = _mm256_set1_ps(Job->CullBounds.Min.E[Component]);
+                __m256 Max = _mm256_set1_ps(Job->CullBounds.Max.E[Component]);
+                CullMask = _mm256_and_ps(CullMask, _mm256_cmp_ps(P[Component], Min, _CMP_GE_OQ));
+                CullMask = _mm256_and_ps(CullMask, _mm256_cmp_ps(P[Component], Max, _CMP_LT_OQ));
+            }
+        }
+
+        u32 VisibleMask = (u32)_mm256_movemask_ps(CullMask);
+        if (Job->Output && VisibleMask)
         {
-            v3 P = { dS*X, dS*Y, SampleHeight(Field, X, Y) };
-            Result.Box.Min = 
-            { 
-                Min(Result.Box.Min.X, P.X),
-                Min(Result.Box.Min.Y, P.Y),
-                Min(Result.Box.Min.Z, P.Z),
-            };
-            Result.Box.Max = 
-            { 
-                Max(Result.Box.Max.X, P.X),
-                Max(Result.Box.Max.Y, P.Y),
-                Max(Result.Box.Max.Z, P.Z),
-            };
+            __m256 Depth = Zero;
+            for (u32 Component = 0; Component < 3; Component++)
+            {
+                __m256 RelativeP = _mm256_sub_ps(P[Component], _mm256_set1_ps(Job->CameraP.E[Component]));
+                Depth = _mm256_add_ps(Depth, _mm256_mul_ps(RelativeP, _mm256_set1_ps(Job->CameraForward.E[Component])));
+            }
+            alignas(32) f32 Depths[8];
+            _mm256_store_ps(Depths, Depth);
 
-            v3 PXn = { P.X - dS, P.Y, SampleHeight(Field, X - 1, Y) };
-            v3 PXp = { P.X + dS, P.Y, SampleHeight(Field, X + 1, Y) };
-            v3 PYn = { P.X, P.Y - dS, SampleHeight(Field, X, Y - 1) };
-            v3 PYp = { P.X, P.Y + dS, SampleHeight(Field, X, Y + 1) };
+            u32 Lane = 0;
+            while (BitScanForward(&Lane, VisibleMask))
+            {
+                VisibleMask &= VisibleMask - 1;
+                // NOTE(boti): Inverted for back-to-front order
+                SortKeys[VisibleCount] = ~FloatToSortKey(Depths[Lane]);
+                SortIndices[VisibleCount] = BaseIndex + Lane;
+                VisibleCount++;
+            }
+        }
+    }
 
-            v3 T = NOZ(PXp - PXn);
-            v3 B = NOZ(PYp - PYn);
-            v3 N = NOZ(Cross(T, B));
+    if (Job->Output)
+    {
+        RadixSort32(VisibleCount, SortKeys, SortIndices, TempKeys, TempIndices);
 
-            *VertexAt++ = 
+        // NOTE(boti): The output is write-combined memory, so each particle gets written out in full and in order
+        for (u32 SortedIndex = 0; SortedIndex < VisibleCount; SortedIndex++)
+        {
+            u32 Index = SortIndices[SortedIndex];
+            Job->Output[SortedIndex] = 
             {
-                .P = P,
-                .N = N, 
-                .T = { T.X, T.Y, T.Z, 1.0f },
-                .TexCoord = { 0.5f * P.X, 0.5f * P.Y },
-                .Color = PackRGBA8(0xFF, 0xFF, 0xFF),
+                .P = { System->P[0][Index], System->P[1][Index], System->P[2][Index] },
+                .TextureIndex = System->TextureIndices[Index],
+                .Color = 
+                { 
+                    Max(System->Color[0][Index], 0.0f), 
+                    Max(System->Color[1][Index], 0.0f), 
+                    Max(System->Color[2][Index], 0.0f), 
+                    1.0f,
+                },
+                .HalfExtent = System->ParticleHalfExtent,
             };
         }
     }
 
-    u32 QuadCountX = Field->TexelCountX - 1;
-    u32 QuadCountY = Field->TexelCountY - 1;
-    Result.IndexCount = 6 * QuadCountX*QuadCountY;
-    Result.IndexData = PushArray(Arena, 0, vert_index, Result.IndexCount);
-    auto GetIndex = [=](u32 X, u32 Y) -> u32
+    if (Job->Batch)
     {
-        u32 Result = X + Y*Field->TexelCountX;
-        return(Result);
-    };
+        Job->Batch->Count = VisibleCount;
+    }
 
-    vert_index* IndexAt = Result.IndexData;
-    for (u32 Y = 0; Y < QuadCountY; Y++)
+    mmbox ParticleBounds = {};
+    for (u32 Component = 0; Component < 3; Component++)
     {
-        for (u32 X = 0; X < QuadCountX; X++)
+        alignas(32) f32 Mins[8];
+        alignas(32) f32 Maxs[8];
+        _mm256_store_ps(Mins, BoundsMin[Component]);
+        _mm256_store_ps(Maxs, BoundsMax[Component]);
+        ParticleBounds.Min.E[Component] = Mins[0];
+        ParticleBounds.Max.E[Component] = Maxs[0];
+        for (u32 Lane = 1; Lane < 8; Lane++)
         {
-            *IndexAt++ = GetIndex(X + 0, Y + 0);
-            *IndexAt++ = GetIndex(X + 1, Y + 0);
-            *IndexAt++ = GetIndex(X + 0, Y + 1);
-            *IndexAt++ = GetIndex(X + 1, Y + 0);
-            *IndexAt++ = GetIndex(X + 1, Y + 1);
-            *IndexAt++ = GetIndex(X + 0, Y + 1);
+            ParticleBounds.Min.E[Component] = Min(ParticleBounds.Min.E[Component], Mins[Lane]);
+            ParticleBounds.Max.E[Component] = Max(ParticleBounds.Max.E[Component], Maxs[Lane]);
         }
     }
-    return(Result);
+    System->ParticleBounds = ParticleBounds;
 }
 
 lbfn u32 
@@ -226,7 +1840,16 @@ MakeParticleSystem(game_world* World, entity_id ParentID, particle_system_type T
         ParticleSystem->Type = Type;
         ParticleSystem->EmitterOffset = EmitterOffset;
         ParticleSystem->Bounds = Bounds;
+        ParticleSystem->ParticleBounds = 
+        {
+            .Min = { +F32_MAX_NORMAL, +F32_MAX_NORMAL, +F32_MAX_NORMAL },
+            .Max = { -F32_MAX_NORMAL, -F32_MAX_NORMAL, -F32_MAX_NORMAL },
+        };
         ParticleSystem->Counter = 0.0f;
+        ParticleSystem->PendingTime = 0.0f;
+        ParticleSystem->Entropy = { RandU32(&World->EffectEntropy) };
+        ParticleSystem->NextParticle = 0;
+        ParticleSystem->ParticleCount = 0;
 
         switch (Type)
         {
@@ -240,14 +1863,11 @@ MakeParticleSystem(game_world* World, entity_id ParentID, particle_system_type T
                 ParticleSystem->ParticleHalfExtent = { 0.25f, 0.25f };
                 ParticleSystem->EmissionRate = 1.0f / 144.0f;
                 ParticleSystem->CullOutOfBoundsParticles = true;
-                ParticleSystem->ParticleCount = ParticleSystem->MaxParticleCount;
-                
             } break;
             case ParticleSystem_Fire:
             {
                 ParticleSystem->Mode = Billboard_ViewAligned;
                 ParticleSystem->ParticleHalfExtent = { 0.15f, 0.15f };
-                ParticleSystem->ParticleCount = ParticleSystem->MaxParticleCount;
                 ParticleSystem->CullOutOfBoundsParticles = false;
                 ParticleSystem->EmissionRate = 1.0f / 30.0f;
             } break;
@@ -262,6 +1882,7 @@ DEBUGInitializeWorld(
     game_world* World, 
     assets* Assets, 
     render_frame* Frame, 
+    thread_context* ThreadContext,
     memory_arena* Scratch,
     debug_scene_type Type,
     debug_scene_flags Flags)
@@ -405,66 +2026,40 @@ DEBUGInitializeWorld(
                 u32 TexelCount = World->HeightField.TexelCountX * World->HeightField.TexelCountY;
                 World->HeightField.HeightData = PushArray(World->Arena, 0, f32, TexelCount);
 
-                for (u32 Y = 0; Y < World->HeightField.TexelCountY; Y++)
-                {
-                    for (u32 X = 0; X < World->HeightField.TexelCountX; X++)
-                    {
-                        u32 Index = X + Y*World->HeightField.TexelCountX;
-
-                        f32 BaseFrequency = 1.0f / 256.0f;
-                        f32 BaseAmplitude = 32.0f;
-                        v2 P = (1.0f / World->HeightField.TexelsPerMeter) * v2{ (f32)X, (f32)Y };
-                        f32 Height = 0.0f;
-
-                        for (u32 OctaveIndex = 0; OctaveIndex < 12; OctaveIndex++)
-                        {
-                            f32 Mul = (f32)(1 << OctaveIndex);
-                            f32 Frequency = BaseFrequency * Mul;
-                            f32 Amplitude = BaseAmplitude / Mul;
-                            Height += Amplitude * SampleNoise(&World->TerrainNoise, Frequency*P);
-                            World->HeightField.HeightData[Index] = Height;
-                        }
-                    }
-                }
+                GenerateHeightField(&World->HeightField, &World->TerrainNoise, 
+                                    1.0f / 256.0f, 32.0f, 12, ThreadContext, Scratch);
+                BuildHeightFieldMips(&World->HeightField, World->Arena);
             }
 
-            mesh_data TerrainMesh = GenerateTerrainChunk(&World->HeightField, Scratch);
-
-            u32 ChunkMeshID = Assets->MeshCount++;
-            mesh* Mesh = Assets->Meshes + ChunkMeshID;
-            Mesh->Allocation = Platform.AllocateGeometry(Frame->Renderer, TerrainMesh.VertexCount, TerrainMesh.IndexCount);
-            Mesh->BoundingBox = TerrainMesh.Box;
-            Mesh->MaterialID = World->TerrainMaterialID;
-
-            TransferGeometry(Frame, Mesh->Allocation, TerrainMesh.VertexData, TerrainMesh.IndexData);
-
-            entity* TerrainEntity = MakeEntity(World, nullptr);
-            TerrainEntity->Flags = EntityFlag_Mesh|EntityFlag_Terrain;
             f32 ExtentX = (f32)World->HeightField.TexelCountX / World->HeightField.TexelsPerMeter;
             f32 ExtentY = (f32)World->HeightField.TexelCountY / World->HeightField.TexelsPerMeter;
-            TerrainEntity->Transform = M4(1.0f, 0.0f, 0.0f, -0.5f * ExtentX,
-                                          0.0f, 1.0f, 0.0f, -0.5f * ExtentY,
-                                          0.0f, 0.0f, 1.0f, 0.0f,
-                                          0.0f, 0.0f, 0.0f, 1.0f);
-            TerrainEntity->PieceCount = 1;
-            TerrainEntity->Pieces[0].MeshID = ChunkMeshID;
+            InitTerrain(&World->Terrain, &World->HeightField, v3{ -0.5f * ExtentX, -0.5f * ExtentY, 0.0f }, 
+                        World->TerrainMaterialID, World->Arena);
             
             // Plant trees
             if (Assets->TreeModelCount)
             {
-                v2 MinBounds = 
-                {
-                    TerrainEntity->Transform.P.X + TerrainMesh.Box.Min.X,
-                    TerrainEntity->Transform.P.Y + TerrainMesh.Box.Min.Y,
-                };
-
+                v2 MinBounds = World->Terrain.P.XY;
                 v2 MaxBounds = 
                 {
-                    TerrainEntity->Transform.P.X + TerrainMesh.Box.Max.X,
-                    TerrainEntity->Transform.P.Y + TerrainMesh.Box.Max.Y,
+                    World->Terrain.P.X + (f32)(World->HeightField.TexelCountX - 1) / World->HeightField.TexelsPerMeter,
+                    World->Terrain.P.Y + (f32)(World->HeightField.TexelCountY - 1) / World->HeightField.TexelsPerMeter,
                 };
 
                 u32 TreeCountToGenerate = 2048;
+                v2* TreePs = PushArray(Scratch, 0, v2, TreeCountToGenerate);
+                f32* TreeHeights = PushArray(Scratch, 0, f32, TreeCountToGenerate);
+                for (u32 TreeIndex = 0; TreeIndex < TreeCountToGenerate; TreeIndex++)
+                {
+                    v2 UV = { RandUnilateral(&World->GeneratorEntropy), RandUnilateral(&World->GeneratorEntropy) };
+                    TreePs[TreeIndex] = 
+                    {
+                        UV.X * (MaxBounds.X - MinBounds.X)  + MinBounds.X,
+                        UV.Y * (MaxBounds.Y - MinBounds.Y)  + MinBounds.Y,
+                    };
+                }
+                SampleHeightField(&World->HeightField, World->Terrain.P, TreeCountToGenerate, TreePs, TreeHeights, nullptr);
+
                 for (u32 TreeIndex = 0; TreeIndex < TreeCountToGenerate; TreeIndex++)
                 {
                     u32 ModelIndex = RandU32(&World->GeneratorEntropy) % Assets->TreeModelCount;
@@ -483,13 +2078,7 @@ DEBUGInitializeWorld(
                     {
                         Entity->Flags = EntityFlag_Mesh;
 
-                        v2 UV = { RandUnilateral(&World->GeneratorEntropy), RandUnilateral(&World->GeneratorEntropy) };
-                        v3 P = 
-                        { 
-                            UV.X * (MaxBounds.X - MinBounds.X)  + MinBounds.X,
-                            UV.Y * (MaxBounds.Y - MinBounds.Y)  + MinBounds.Y,
-                            SampleHeight(&World->HeightField, UV) - 0.1f,
-                        };
+                        v3 P = { TreePs[TreeIndex].X, TreePs[TreeIndex].Y, TreeHeights[TreeIndex] - 0.1f };
 
                         f32 Angle = 2.0f * Pi * RandUnilateral(&World->GeneratorEntropy);
                         f32 C = Cos(Angle);
@@ -511,6 +2100,7 @@ DEBUGInitializeWorld(
                                 };
                             }
                         }
+                        Entity->IsPieceDataDirty = true;
                     }
                 }
             }
@@ -621,6 +2211,7 @@ lbfn void UpdateAndRenderWorld(
     game_world* World, 
     assets* Assets, 
     render_frame* Frame, 
+    thread_context* ThreadContext,
     game_io* IO, 
     memory_arena* Scratch, 
     debug_flags DebugFlags)
@@ -648,15 +2239,15 @@ lbfn void UpdateAndRenderWorld(
 
         // Load debug scene
         #if 0
-        DEBUGInitializeWorld(World, Assets, Frame, Scratch,
+        DEBUGInitializeWorld(World, Assets, Frame, ThreadContext, Scratch,
                              DebugScene_Sponza, 
                              DebugSceneFlag_AnimatedFox|DebugSceneFlag_SponzaParticles|DebugSceneFlag_SponzaAdHocLights);
         #elif 0
-        DEBUGInitializeWorld(World, Assets, Frame, Scratch,
+        DEBUGInitializeWorld(World, Assets, Frame, ThreadContext, Scratch,
                              DebugScene_TransmissionTest, 
                              0);
         #elif 0
-        DEBUGInitializeWorld(World, Assets, Frame, Scratch,
+        DEBUGInitializeWorld(World, Assets, Frame, ThreadContext, Scratch,
                              DebugScene_Terrain,
                              DebugSceneFlag_None);
         #endif
@@ -675,6 +2266,7 @@ lbfn void UpdateAndRenderWorld(
             .MeshID = Assets->DefaultMeshIDs[DefaultMesh_Sphere],
             .OffsetP = { 0.0f, 0.0f, 0.0f },
         };
+        IKControl->IsPieceDataDirty = true;
         #endif
 
         World->IsLoaded = true;
@@ -741,155 +2333,65 @@ lbfn void UpdateAndRenderWorld(
         Frame->SunV = World->SunV;
     }
 
+    if (World->Terrain.LevelCount)
+    {
+        UpdateAndRenderTerrain(&World->Terrain, Assets, Frame);
+    }
+
     //
     // Entity update
     //
     {
         TimedBlock(Platform.Profiler, "UpdateAndRenderEntities");
 
-        for (entity_iterator It = MakeEntityIterator(World); IsValid(It); It = Next(It))
+        // NOTE(boti): The animators are evaluated up-front on the work queue, the entity loop only consumes the poses
         {
-            if (It.Entity->Flags & EntityFlag_Mesh)
+            animator** Animators = PushArray(Frame->Arena, 0, animator*, World->AnimatorCount);
+            u32 AnimatorCount = 0;
+            for (entity_iterator It = MakeEntityIterator(World); IsValid(It); It = Next(It))
             {
-                u32 JointCount = 0;
-                m4 Pose[R_MaxJointCount] = {};
-
                 if (It.Entity->Flags & EntityFlag_Skin)
                 {
-                    Assert(It.Entity->SkinID < Assets->SkinCount);
-                    skin* Skin = Assets->Skins + It.Entity->SkinID;
-                    JointCount = Skin->JointCount;
-                    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
-                    {
-                        Pose[JointIndex] = TRSToM4(Skin->BindPose[JointIndex]);
-                    }
+                    animator* Animator = GetAnimator(World, It.Entity->AnimatorID);
+                    Assert(Animator->SkinID < Assets->SkinCount);
+                    skin* Skin = Assets->Skins + Animator->SkinID;
 
-                    Assert(It.Entity->CurrentAnimationID < Assets->AnimationCount);
-                    animation* Animation = Assets->Animations + It.Entity->CurrentAnimationID;
-                    if (It.Entity->DoAnimation)
-                    {
-                        It.Entity->AnimationCounter += dt;
-                        f32 LastKeyFrameTimestamp = Animation->KeyFrameTimestamps[Animation->KeyFrameCount - 1];
-                        It.Entity->AnimationCounter = Modulo0(It.Entity->AnimationCounter, LastKeyFrameTimestamp);
-                    }
-                
-                    u32 KeyFrameIndex = 0;
+                    UpdateAnimator(Animator, Assets, dt);
+
+                    // NOTE(boti): The IK control drives the first chain (the right leg for Mixamo skins)
+                    if (Skin->IKChainCount)
                     {
-                        u32 MinIndex = 0;
-                        u32 MaxIndex = Animation->KeyFrameCount - 1;
-                        while (MinIndex <= MaxIndex)
-                        {
-                            u32 Index = (MinIndex + MaxIndex) / 2;
-                            f32 t = Animation->KeyFrameTimestamps[Index];
-                            if      (It.Entity->AnimationCounter < t) MaxIndex = Index - 1;
-                            else if (It.Entity->AnimationCounter > t) MinIndex = Index + 1;
-                            else break; 
-                        }
-                        KeyFrameIndex = MinIndex == 0 ? 0 : MinIndex - 1;
+                        entity* Control = GetEntity(World, World->IKControlID);
+                        Animator->IKTargets[0] = TransformPoint(AffineInverse(It.Entity->Transform), Control->Transform.P.XYZ);
+                        Animator->IKWeights[0] = 1.0f;
                     }
-                
-                    u32 NextKeyFrameIndex = (KeyFrameIndex + 1) % Animation->KeyFrameCount;
-                    f32 Timestamp0 = Animation->KeyFrameTimestamps[KeyFrameIndex];
-                    f32 Timestamp1 = Animation->KeyFrameTimestamps[NextKeyFrameIndex];
-                    f32 KeyFrameDelta = Timestamp1 - Timestamp0;
-                    f32 BlendStart = It.Entity->AnimationCounter - Timestamp0;
-                    f32 BlendFactor = Ratio0(BlendStart, KeyFrameDelta);
-
-                    animation_key_frame* CurrentFrame = Animation->KeyFrames + KeyFrameIndex;
-                    animation_key_frame* NextFrame = Animation->KeyFrames + NextKeyFrameIndex;
-                    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
-                    {
-                        if (IsJointActive(Animation, JointIndex))
-                        {
-                            trs_transform* CurrentTransform = CurrentFrame->JointTransforms + JointIndex;
-                            trs_transform* NextTransform = NextFrame->JointTransforms + JointIndex;
-                            trs_transform Transform = 
-                            {
-                                .Rotation = QLerp(CurrentTransform->Rotation, NextTransform->Rotation, BlendFactor),
-                                .Position = Lerp(CurrentTransform->Position, NextTransform->Position, BlendFactor),
-                                .Scale = Lerp(CurrentTransform->Scale, NextTransform->Scale, BlendFactor),
-                            };
 
-                            Pose[JointIndex] = TRSToM4(Transform);
-                        }
+                    Animators[AnimatorCount++] = Animator;
+                }
+            }
 
-                        u32 ParentIndex = Skin->JointParents[JointIndex];
-                        if (ParentIndex != JointIndex)
-                        {
-                            Pose[JointIndex] = Pose[ParentIndex] * Pose[JointIndex];
-                        }
+            EvaluateAnimators(Assets, Frame, AnimatorCount, Animators, ThreadContext, Scratch);
+        }
 
-                        #if 1
-                        if (Skin->Type == Armature_Mixamo)
-                        {
-                            if (JointIndex == Mixamo_RightFoot)
-                            {
-                                m4 InvTorso = AffineInverse(Pose[Mixamo_Torso]);
-                                m4 InvHip   = AffineInverse(Pose[Mixamo_RightHip]);
-                                m4 InvKnee  = AffineInverse(Pose[Mixamo_RightKnee]);
-
-                                entity* Control = GetEntity(World, World->IKControlID);
-                                v3 ControlP = Control->Transform.P.XYZ;
-                                v3 TargetP = TransformPoint(AffineInverse(It.Entity->Transform), ControlP);
-                                TargetP = TransformPoint(InvTorso, TargetP);
-
-                                v3 X = v3{ 0.0f, 0.0f, 1.0f }; // NOTE(boti): Forward axis (in 2D)
-                                v3 Y = v3{ 0.0f, 1.0f, 0.0f }; // NOTE(boti): Up axis (in 2D)
-                                v3 RotationAxis = NOZ(Cross(X, Y));
-                                //v3 RotationAxis = NOZ(Cross(AB, A - C));
-
-                                v3 A = { 0.0f, 0.0f, 0.0f };
-                                v3 B = (InvHip * Pose[Mixamo_RightKnee]).P.XYZ;
-                                v3 C = (InvHip * Pose[Mixamo_RightFoot]).P.XYZ;
-
-                                A = Rejection(A, RotationAxis);
-                                B = Rejection(B, RotationAxis);
-                                C = Rejection(C, RotationAxis);
-                                TargetP = Rejection(TargetP, RotationAxis);
-
-                                v3 AB = B - A;
-                                f32 a2 = Dot(AB, AB);
-                                v3 BC = C - B;
-                                f32 b2 = Dot(BC, BC);
-                                v3 AC = TargetP - A;
-                                f32 c2 = Dot(AC, AC);
-
-                                f32 a = Sqrt(a2);
-                                f32 b = Sqrt(b2);
-
-                                f32 CosB = Clamp(0.5f * (a2 + b2 - c2) / (a * b), -1.0f, +1.0f);
-                                f32 BAngle = Pi - ACos(CosB);
-
-                                f32 CosAO = Clamp(0.5f * (a2 + c2 - b2) / (a * Sqrt(c2)), -1.0f, +1.0f);
-                                f32 AO = ACos(CosAO);
-                                f32 AAngle = ATan2(Dot(AC, X), -Dot(AC, Y)) + AO;
-
-                                v4 HipQ = QuatFromAxisAngle(RotationAxis, AAngle);
-                                m4 HipRot = QuaternionToM4(HipQ);
-
-                                v4 KneeQ = QuatFromAxisAngle(RotationAxis, BAngle);
-                                trs_transform KneeTRS = M4ToTRS(InvHip * Pose[Mixamo_RightKnee]);
-                                KneeTRS.Rotation = KneeQ;
-                                m4 KneeTransform = TRSToM4(KneeTRS);
-
-                                Pose[Mixamo_RightHip] = Pose[Mixamo_Torso] * HipRot * InvTorso * Pose[Mixamo_RightHip];
-                                Pose[Mixamo_RightKnee] = Pose[Mixamo_RightHip] * KneeTransform;
-                                Pose[Mixamo_RightFoot] = Pose[Mixamo_RightKnee] * InvKnee * Pose[Mixamo_RightFoot];
-                            }
-                        }
-                        #endif
-                    }
+        for (entity_iterator It = MakeEntityIterator(World); IsValid(It); It = Next(It))
+        {
+            if (It.Entity->Flags & EntityFlag_Mesh)
+            {
+                u32 JointCount = 0;
+                renderer_pose SkinPose = {};
 
-                    // NOTE(boti): This _cannot_ be folded into the above loop, because the parent transforms must not contain
-                    // the inverse bind transform when propagating the transforms down the hierarchy
-                    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
-                    {
-                        Pose[JointIndex] = Pose[JointIndex] * Skin->InverseBindMatrices[JointIndex];
-                    }
+                if (It.Entity->Flags & EntityFlag_Skin)
+                {
+                    animator* Animator = GetAnimator(World, It.Entity->AnimatorID);
+                    skin* Skin = Assets->Skins + Animator->SkinID;
+                    JointCount = Skin->JointCount;
+                    SkinPose = Animator->Pose;
 
                     // Debug draw joints
-                    if (BitTest(DebugFlags, DebugFlag_DrawJoints))
+                    if (BitTest(DebugFlags, DebugFlag_DrawJoints) && SkinPose.Transforms)
                     {
+                        // NOTE(boti): This reads back from the BAR buffer (which is slow), but it's debug-only
+                        m4* Pose = SkinPose.Transforms;
                         mesh* SphereMesh = GetDefaultMesh(Assets, DefaultMesh_Sphere);
                         mesh* ArrowMesh = GetDefaultMesh(Assets, DefaultMesh_Arrow);
                         mesh* PyramidMesh = GetDefaultMesh(Assets, DefaultMesh_Pyramid);
@@ -951,53 +2453,59 @@ lbfn void UpdateAndRenderWorld(
                     }
                 }
 
+                // NOTE(boti): Non-skinned pieces are retained on the renderer side,
+                // they only need to be resubmitted when the entity has moved or one of its pieces has changed
+                b32 IsRetained = (JointCount == 0);
+                b32 NeedsResubmit = !IsRetained || It.Entity->IsPieceDataDirty ||
+                    (memcmp(&It.Entity->Transform, &It.Entity->SubmittedTransform, sizeof(m4)) != 0);
+                b32 AllUpdatesAccepted = true;
+
                 for (u32 PieceIndex = 0; PieceIndex < It.Entity->PieceCount; PieceIndex++)
                 {
                     entity_piece* Piece = It.Entity->Pieces + PieceIndex;
                     mesh* Mesh = Assets->Meshes + Piece->MeshID;
 
-                    material* Material = Assets->Materials + Mesh->MaterialID;
-                    texture* AlbedoTexture              = Assets->Textures + Material->AlbedoID;
-                    texture* NormalTexture              = Assets->Textures + Material->NormalID;
-                    texture* MetallicRoughnessTexture   = Assets->Textures + Material->MetallicRoughnessID;
-                    texture* OcclusionTexture           = Assets->Textures + Material->OcclusionID;
-                    texture* HeightTexture              = Assets->Textures + Material->HeightID;
-                    texture* TransmissionTexture        = Assets->Textures + Material->TransmissionID;
+                    m4 PieceTransform = It.Entity->Transform;
+                    PieceTransform.P.XYZ += Piece->OffsetP;
 
-                    renderer_material RenderMaterial = 
+                    if (!IsRetained && IsValid(Piece->InstanceID))
                     {
-                        .AlbedoID                   = AlbedoTexture->RendererID,
-                        .NormalID                   = NormalTexture->RendererID,
-                        .MetallicRoughnessID        = MetallicRoughnessTexture->RendererID,
-                        .OcclusionID                = OcclusionTexture->RendererID,
-                        .HeightID                   = HeightTexture->RendererID,
-                        .TransmissionID             = TransmissionTexture->RendererID,
-                        .AlbedoSamplerID            = Material->AlbedoSamplerID,
-                        .NormalSamplerID            = Material->NormalSamplerID,
-                        .MetallicRoughnessSamplerID = Material->MetallicRoughnessSamplerID,
-                        .TransmissionSamplerID      = Material->TransmissionSamplerID,
-                        .AlphaThreshold             = Material->AlphaThreshold,
-                        .Transmission               = Material->Transmission,
-                        .BaseAlbedo                 = Material->Albedo,
-                        .BaseMaterial               = Material->MetallicRoughness,
-                        .Emissive                   = Material->Emission,
-                    };
+                        FreeInstance(Frame, Piece->InstanceID);
+                        Piece->InstanceID = {};
+                    }
 
-                    draw_group TransparencyToDrawGroupTable[Transparency_Count] =
+                    if (NeedsResubmit || !IsValid(Piece->InstanceID))
                     {
-                        [Transparency_Opaque] = DrawGroup_Opaque,
-                        [Transparency_AlphaTest] = DrawGroup_AlphaTest,
-                        [Transparency_AlphaBlend] = DrawGroup_AlphaTest,
-                    };
+                        material* Material = Assets->Materials + Mesh->MaterialID;
+                        renderer_material RenderMaterial = MakeRendererMaterial(Assets, Material);
+                        draw_group Group = GetDrawGroup(Material);
+                        UpdateEntityProxy(&World->BVH, &Piece->ProxyID, TransformBox(PieceTransform, Mesh->BoundingBox), It.ID, PieceIndex);
 
-                    draw_group Group = TransparencyToDrawGroupTable[Material->Transparency];
-                    if (Material->TransmissionEnabled)
-                    {
-                        Group = DrawGroup_Transparent;
+                        if (IsRetained && !IsValid(Piece->InstanceID))
+                        {
+                            Piece->InstanceID = Platform.AllocateInstance(Frame->Renderer);
+                        }
+
+                        // NOTE(boti): Skinned pieces (and the ones that didn't fit in the retained scene) are drawn immediately
+                        if (IsValid(Piece->InstanceID))
+                        {
+                            if (!UpdateInstance(Frame, Piece->InstanceID, Group, Mesh->Allocation, PieceTransform, Mesh->BoundingBox, RenderMaterial))
+                            {
+                                AllUpdatesAccepted = false;
+                            }
+                        }
+                        else
+                        {
+                            if (JointCount)
+                            {
+                                DrawSkinnedMesh(Frame, Group, Mesh->Allocation, PieceTransform, Mesh->BoundingBox, RenderMaterial, SkinPose);
+                            }
+                            else
+                            {
+                                DrawMesh(Frame, Group, Mesh->Allocation, PieceTransform, Mesh->BoundingBox, RenderMaterial, 0, nullptr);
+                            }
+                        }
                     }
-                    m4 PieceTransform = It.Entity->Transform;
-                    PieceTransform.P.XYZ += Piece->OffsetP;
-                    DrawMesh(Frame, Group, Mesh->Allocation, PieceTransform, Mesh->BoundingBox, RenderMaterial, JointCount, Pose);
 
                     // Draw bounding box
                     if (BitTest(DebugFlags, DebugFlag_DrawBoundingBoxes) && !(It.Entity->Flags & EntityFlag_Terrain))
@@ -1052,10 +2560,24 @@ lbfn void UpdateAndRenderWorld(
 
                     }
                 }
+
+                // NOTE(boti): If the renderer dropped any of the updates (instance stream full) the entity gets resubmitted next frame
+                if (IsRetained && AllUpdatesAccepted)
+                {
+                    It.Entity->SubmittedTransform = It.Entity->Transform;
+                    It.Entity->IsPieceDataDirty = false;
+                }
             }
 
             if (It.Entity->Flags & EntityFlag_LightSource)
             {
+                mmbox ProxyBox = 
+                {
+                    .Min = { -World->LightProxyScale, -World->LightProxyScale, -World->LightProxyScale },
+                    .Max = { +World->LightProxyScale, +World->LightProxyScale, +World->LightProxyScale },
+                };
+                UpdateEntityProxy(&World->BVH, &It.Entity->LightProxyID, TransformBox(It.Entity->Transform, ProxyBox), It.ID, 0);
+
                 AddLight(Frame, It.Entity->Transform.P.XYZ, It.Entity->LightEmission, LightFlag_ShadowCaster);
                 if (BitTest(DebugFlags, DebugFlag_DrawLights))
                 {
@@ -1077,10 +2599,16 @@ lbfn void UpdateAndRenderWorld(
     {
         TimedBlock(Platform.Profiler, "UpdateAndRenderParticleSystems");
 
+        v3 CameraP = Frame->CameraTransform.P.XYZ;
+        v3 CameraForward = Frame->CameraTransform.Z.XYZ;
+        frustum CameraFrustum = GetCameraFrustum(AffineOrthonormalInverse(Frame->CameraTransform), Frame->CameraFocalLength, 
+                                                 (f32)Frame->RenderExtent.X / (f32)Frame->RenderExtent.Y, Frame->CameraNearPlane);
+
+        u32 JobCount = 0;
+        particle_system_job* Jobs = PushArray(Scratch, 0, particle_system_job, World->ParticleSystemCount);
         for (u32 ParticleSystemIndex = 0; ParticleSystemIndex < World->ParticleSystemCount; ParticleSystemIndex++)
         {
             particle_system* ParticleSystem = World->ParticleSystems + ParticleSystemIndex;
-            v2 ParticleSize = { 1.0f, 1.0f };
 
             // TODO(boti): we should probably just pull in the entire parent transform
             v3 BaseP = { 0.0f, 0.0f, 0.0f };
@@ -1101,17 +2629,64 @@ lbfn void UpdateAndRenderWorld(
                 .Min = Bounds.Min + BaseP,
                 .Max = Bounds.Max + BaseP,
             };
+
+            // NOTE(boti): The particle bounds are from the last update, particles that moved since then could be missed.
+            // The emitter bounds are always included, so at least newly emitted particles get picked up
+            mmbox SystemBounds = ParticleSystem->CullOutOfBoundsParticles ? CullBounds : Union(CullBounds, ParticleSystem->ParticleBounds);
+            v3 ClosestP = Clamp(CameraP, SystemBounds.Min, SystemBounds.Max);
+            f32 Distance = VectorLength(ClosestP - CameraP);
+
+            // NOTE(boti): Every particle gets replaced within MaxParticleCount emissions, so fast-forwarding further than that
+            // would only emit particles that get overwritten in the same step (and the emission loop would be unbounded)
+            ParticleSystem->PendingTime += dt;
+            if (ParticleSystem->EmissionRate > 0.0f)
+            {
+                f32 MaxPendingTime = (f32)ParticleSystem->MaxParticleCount * ParticleSystem->EmissionRate;
+                ParticleSystem->PendingTime = Min(ParticleSystem->PendingTime, MaxPendingTime);
+            }
+            b32 IsVisible = (Distance < ParticleSystem->SleepDistance) && IntersectFrustumBox(&CameraFrustum, SystemBounds);
+            if (!IsVisible)
+            {
+                continue;
+            }
+
+            u32 LODLevel = 0;
+            while ((LODLevel < ParticleSystem->MaxLODLevel) && (Distance >= ParticleSystem->LODDistance * (f32)(1u << LODLevel)))
+            {
+                LODLevel++;
+            }
+            f32 UpdateInterval = LODLevel ? ParticleSystem->BaseUpdateInterval * (f32)(1u << LODLevel) : 0.0f;
+
+            // NOTE(boti): Between updates the system is still drawn in its last state
+            f32 StepTime = 0.0f;
+            if (ParticleSystem->PendingTime >= UpdateInterval)
+            {
+                StepTime = ParticleSystem->PendingTime;
+                ParticleSystem->PendingTime = 0.0f;
+            }
+
             if (ParticleSystem->EmissionRate > 0.0f)
             {
-                ParticleSystem->Counter += dt;
+                ParticleSystem->Counter += StepTime;
                 while (ParticleSystem->Counter > ParticleSystem->EmissionRate)
                 {
                     ParticleSystem->Counter -= ParticleSystem->EmissionRate;
-                    if (++ParticleSystem->NextParticle >= ParticleSystem->ParticleCount)
+
+                    u32 ParticleIndex = 0;
+                    if (ParticleSystem->ParticleCount < ParticleSystem->MaxParticleCount)
                     {
-                        ParticleSystem->NextParticle -= ParticleSystem->ParticleCount;
+                        ParticleIndex = ParticleSystem->ParticleCount++;
+                    }
+                    else
+                    {
+                        ParticleIndex = ParticleSystem->NextParticle++;
+                        if (ParticleSystem->NextParticle >= ParticleSystem->ParticleCount)
+                        {
+                            ParticleSystem->NextParticle -= ParticleSystem->ParticleCount;
+                        }
                     }
 
+                    particle Particle = {};
                     switch (ParticleSystem->Type)
                     {
                         case ParticleSystem_Undefined:
@@ -1120,12 +2695,12 @@ lbfn void UpdateAndRenderWorld(
                         } break;
                         case ParticleSystem_Magic:
                         {
-                            v2 XY = 0.5f * Hadamard((Bounds.Max.XY - Bounds.Min.XY), RandInUnitCircle(&World->EffectEntropy));
+                            v2 XY = 0.5f * Hadamard((Bounds.Max.XY - Bounds.Min.XY), RandInUnitCircle(&ParticleSystem->Entropy));
                             v3 ParticleP = { XY.X, XY.Y, 0.0f };
-                            ParticleSystem->Particles[ParticleSystem->NextParticle] = 
+                            Particle = 
                             {
                                 .P = BaseP + ParticleSystem->EmitterOffset + ParticleP,
-                                .dP = { 0.0f, 0.0f, RandBetween(&World->EffectEntropy, 0.25f, 2.25f) },
+                                .dP = { 0.0f, 0.0f, RandBetween(&ParticleSystem->Entropy, 0.25f, 2.25f) },
                                 .Color = Color,
                                 .dColor = { 0.0f, 0.0f, 0.0f },
                                 .TextureIndex = Particle_Trace02,
@@ -1138,67 +2713,54 @@ lbfn void UpdateAndRenderWorld(
                             u32 TextureCount = OnePastLastTexture - FirstTexture;
 
                             v3 ParticleP = { 0.0f, 0.0f, 0.0f };
-                            ParticleSystem->Particles[ParticleSystem->NextParticle] = 
+                            Particle = 
                             {
                                 .P = ParticleP + ParticleSystem->EmitterOffset + BaseP,
                                 .dP = 
                                 {
-                                    0.3f * RandBilateral(&World->EffectEntropy),
-                                    0.3f * RandBilateral(&World->EffectEntropy),
-                                    RandBetween(&World->EffectEntropy, 0.25f, 1.20f) 
+                                    0.3f * RandBilateral(&ParticleSystem->Entropy),
+                                    0.3f * RandBilateral(&ParticleSystem->Entropy),
+                                    RandBetween(&ParticleSystem->Entropy, 0.25f, 1.20f) 
                                 },
                                 .ddP = { 0.5f, 0.2f, 0.0f },
                                 .Color = Color,
                                 .dColor = 6.0f * v3{ -1.00f, -1.25f, -1.00f },
-                                .TextureIndex = FirstTexture + (RandU32(&World->EffectEntropy) % TextureCount),
+                                .TextureIndex = FirstTexture + (RandU32(&ParticleSystem->Entropy) % TextureCount),
                             };
                         } break;
                         InvalidDefaultCase;
                     }
+
+                    // NOTE(boti): The remaining counter is the age of the particle at the end of the step,
+                    // the particle gets moved back to the beginning of the step so that the update below brings it to the right place.
+                    // This is what makes long steps (i.e. fast-forwarding) equivalent to many short ones
+                    AdvanceParticle(&Particle, ParticleSystem->Counter - StepTime);
+                    SetParticle(ParticleSystem, ParticleIndex, &Particle);
                 }
             }
 
-            render_command* Cmd = MakeParticleBatch(Frame, 0);
-            if (Cmd)
+            // NOTE(boti): Batches can't be allocated from the worker threads, so they're sized to fit the whole system up front
+            particle_batch* Batch = MakeParticleBatch(Frame, ParticleSystem->ParticleCount);
+            if (Batch)
             {
-                Cmd->ParticleBatch.Mode = ParticleSystem->Mode;
+                Batch->Mode = ParticleSystem->Mode;
             }
 
-            for (u32 It = 0; It < ParticleSystem->ParticleCount; It++)
+            particle_system_job* Job = Jobs + JobCount++;
+            *Job = 
             {
-                particle* Particle = ParticleSystem->Particles + It;
-                Particle->P += Particle->dP * dt;
-                Particle->dP += Particle->ddP * dt;
-                Particle->Color += Particle->dColor * dt;
-
-                b32 CullParticle = false;
-                if (ParticleSystem->CullOutOfBoundsParticles)
-                {
-                    CullParticle = 
-                        Particle->P.X < CullBounds.Min.X || Particle->P.X >= CullBounds.Max.X ||
-                        Particle->P.Y < CullBounds.Min.Y || Particle->P.Y >= CullBounds.Max.Y ||
-                        Particle->P.Z < CullBounds.Min.Z || Particle->P.Z >= CullBounds.Max.Z;
-                }
-
-                if (!CullParticle)
-                {
-                    v4 PColor = 
-                    {
-                        Max(Particle->Color.X, 0.0f),
-                        Max(Particle->Color.Y, 0.0f),
-                        Max(Particle->Color.Z, 0.0f),
-                        1.0,
-                    };
-                    Cmd = PushParticle(Frame, Cmd, 
-                                       {
-                                           .P = Particle->P,
-                                           .TextureIndex = Particle->TextureIndex,
-                                           .Color = PColor,
-                                           .HalfExtent = ParticleSystem->ParticleHalfExtent,
-                                       });
-                }
-            }
+                .System = ParticleSystem,
+                .Batch = Batch,
+                .Output = Batch ? (render_particle*)OffsetPtr(Frame->BARBufferBase, Batch->BARBufferAt) : nullptr,
+                .CullBounds = CullBounds,
+                .CameraP = CameraP,
+                .CameraForward = CameraForward,
+                .dt = StepTime,
+            };
+            Platform.AddWorkEntry(Platform.Queue, UpdateAndRenderParticleSystem, Job);
         }
+
+        Platform.CompleteAllWork(Platform.Queue, ThreadContext);
     }
 
     // Ad-hoc lights
@@ -1206,10 +2768,10 @@ lbfn void UpdateAndRenderWorld(
     {
         TimedBlock(Platform.Profiler, "UpdateAndRenderAdHocLights");
 
-        render_command* Cmd = MakeParticleBatch(Frame, World->AdHocLightCount);
-        if (Cmd)
+        particle_batch* Batch = MakeParticleBatch(Frame, World->AdHocLightCount);
+        if (Batch)
         {
-            Cmd->ParticleBatch.Mode = Billboard_ViewAligned;
+            Batch->Mode = Billboard_ViewAligned;
         }
 
         b32 DoVelocityUpdate = false;
@@ -1238,7 +2800,7 @@ lbfn void UpdateAndRenderWorld(
             Light->P.Z = Clamp(Light->P.Z, World->AdHocLightBounds.Min.Z, World->AdHocLightBounds.Max.Z);
 
             AddLight(Frame, Light->P, Light->E, LightFlag_None);
-            Cmd = PushParticle(Frame, Cmd, 
+            Batch = PushParticle(Frame, Batch, 
                                {
                                    .P = Light->P,
                                    .TextureIndex = Particle_Star06,
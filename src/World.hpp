@@ -16,6 +16,8 @@ struct entity_piece
 {
     u32 MeshID;
     v3 OffsetP;
+    u32 ProxyID; // NOTE(boti): Leaf node in the world BVH, 0 if not yet inserted
+    renderer_instance_id InstanceID; // NOTE(boti): Retained renderer instance, invalid for skinned entities
 };
 
 struct entity
@@ -27,15 +29,15 @@ struct entity
     static constexpr u32 MaxPieceCount = 256;
     u32 PieceCount;
     entity_piece Pieces[MaxPieceCount];
+    m4 SubmittedTransform; // NOTE(boti): Transform of the retained instances on the renderer side
+    b32 IsPieceDataDirty; // NOTE(boti): Must be set when the mesh or material of a piece changes so that the retained instances get resubmitted
 
     // EntityFlag_Skin
-    u32 SkinID;
-    u32 CurrentAnimationID;
-    b32 DoAnimation;
-    f32 AnimationCounter;
+    u32 AnimatorID; // NOTE(boti): Index into the animator pool of the world, the skin is owned by the animator
 
     // EntityFlag_LightSource
     v3 LightEmission;
+    u32 LightProxyID;
 };
 
 struct entity_id
@@ -44,6 +46,59 @@ struct entity_id
 };
 inline b32 IsValid(entity_id ID) { return (ID.Value != 0); }
 
+//
+// Spatial index
+//
+
+// NOTE(boti): Dynamic AABB tree over the entity pieces (and light sources).
+// Leaves store a fattened box so that small movements don't require reinsertion,
+// inner nodes always have exactly 2 children. Node 0 is the null node.
+struct bvh_node
+{
+    mmbox Box;
+    u32 ParentIndex; // NOTE(boti): Next free index when on the free list
+    u32 Children[2];
+    u32 Height; // NOTE(boti): 0 for leaves
+
+    // Leaf data
+    entity_id EntityID;
+    u32 PieceIndex;
+};
+
+inline b32 IsLeaf(const bvh_node* Node) { return (Node->Children[0] == 0); }
+
+struct bvh
+{
+    static constexpr f32 BoxMargin = 0.1f;
+    static constexpr f32 DisplacementMultiplier = 4.0f;
+
+    u32 RootIndex;
+    u32 FreeListIndex;
+    u32 LeafCount;
+
+    static constexpr u32 MaxNodeCount = (1u << 20);
+    u32 NodeCount; // NOTE(boti): High watermark, free nodes are reused first
+    bvh_node Nodes[MaxNodeCount];
+};
+
+struct bvh_query_result
+{
+    u32 Count;
+    u32* ProxyIDs;
+};
+
+// NOTE(boti): Returns 0 if the BVH is full
+lbfn u32 CreateBVHProxy(bvh* BVH, mmbox Box, entity_id EntityID, u32 PieceIndex);
+lbfn void DestroyBVHProxy(bvh* BVH, u32 ProxyID);
+// NOTE(boti): Returns true if the proxy had to be reinserted
+lbfn b32 MoveBVHProxy(bvh* BVH, u32 ProxyID, mmbox Box, v3 Displacement);
+
+// NOTE(boti): Queries are conservative (they test against the fat boxes),
+// the caller is expected to do the exact test on the returned candidates
+lbfn bvh_query_result QueryBVHBox(const bvh* BVH, mmbox Box, memory_arena* Arena);
+lbfn bvh_query_result QueryBVHRay(const bvh* BVH, ray Ray, f32 tMax, memory_arena* Arena);
+lbfn bvh_query_result QueryBVHFrustum(const bvh* BVH, const frustum* Frustum, memory_arena* Arena);
+
 //
 // Particle
 //
@@ -79,13 +134,52 @@ struct particle_system
     f32 Counter;
     f32 EmissionRate;
 
+    // NOTE(boti): Systems that are off-screen or too far away aren't simulated, the elapsed time is accumulated instead,
+    // and the system gets fast-forwarded when it's updated again.
+    // Systems closer than LODDistance are updated every frame, beyond that the LOD level goes up every time the distance doubles,
+    // and the update interval doubles with each level
+    static constexpr f32 LODDistance = 16.0f;
+    static constexpr u32 MaxLODLevel = 3;
+    static constexpr f32 BaseUpdateInterval = 1.0f / 60.0f;
+    static constexpr f32 SleepDistance = LODDistance * (1u << MaxLODLevel);
+    f32 PendingTime;
+    entropy32 Entropy; // NOTE(boti): Per-system, so that the emitted particles don't depend on which other systems were updated
+
     mmbox Bounds;
+    mmbox ParticleBounds; // NOTE(boti): World-space, as of the last update
     u32 NextParticle;
 
     static constexpr u32 MaxParticleCount = 512;
-    u32 ParticleCount;
-    particle Particles[MaxParticleCount];
+    u32 ParticleCount; // NOTE(boti): Grows until MaxParticleCount is reached, after which the oldest particles get replaced
+
+    // NOTE(boti): The particles are stored as SoA (indexed by component first) so that they can be integrated 8-wide
+    alignas(32) f32 P[3][MaxParticleCount];
+    alignas(32) f32 dP[3][MaxParticleCount];
+    alignas(32) f32 ddP[3][MaxParticleCount];
+    alignas(32) f32 Color[3][MaxParticleCount];
+    alignas(32) f32 dColor[3][MaxParticleCount];
+    u32 TextureIndices[MaxParticleCount];
 };
+static_assert(particle_system::MaxParticleCount % 8 == 0);
+
+inline void SetParticle(particle_system* System, u32 Index, const particle* Particle);
+
+struct particle_system_job
+{
+    particle_system* System;
+    particle_batch* Batch; // NOTE(boti): Pre-allocated by the main thread to fit all the particles, may be null
+    render_particle* Output;
+    mmbox CullBounds;
+    v3 CameraP;
+    v3 CameraForward;
+    f32 dt;
+
+    u32 Padding[13];
+};
+static_assert(sizeof(particle_system_job) % 64 == 0);
+
+// NOTE(boti): Fast-forwarding a particle by dt (which may be negative)
+inline void AdvanceParticle(particle* Particle, f32 dt);
 
 //
 // Camera
@@ -115,15 +209,139 @@ struct noise2
 
 lbfn f32 SampleNoise(noise2* Noise, v2 P);
 
+// NOTE(boti): Min/max heights of 2^Level x 2^Level quad cells, level 0 is a single quad
+struct height_field_mip
+{
+    u32 CountX;
+    u32 CountY;
+    v2* MinMax;
+};
+
 struct height_field
 {
     u32 TexelCountX;
     u32 TexelCountY;
     f32 TexelsPerMeter;
     f32* HeightData;
+
+    static constexpr u32 MaxMipCount = 16;
+    u32 MipCount;
+    height_field_mip Mips[MaxMipCount];
+};
+
+struct height_field_job
+{
+    height_field* Field;
+    noise2* Noise;
+    u32 RowBegin;
+    u32 RowEnd;
+    f32 BaseFrequency;
+    f32 BaseAmplitude;
+    u32 OctaveCount;
+
+    u32 Padding[7];
+};
+static_assert(sizeof(height_field_job) % 64 == 0);
+
+// NOTE(boti): Fills the height field with fractal noise, the rows are generated in parallel on the work queue
+lbfn void GenerateHeightField(height_field* Field, noise2* Noise, 
+                              f32 BaseFrequency, f32 BaseAmplitude, u32 OctaveCount,
+                              thread_context* ThreadContext, memory_arena* Scratch);
+lbfn void BuildHeightFieldMips(height_field* Field, memory_arena* Arena);
+
+// NOTE(boti): Bilinear height and analytic normal queries for a batch of points, relative to Origin.
+// Points outside the height field get clamped to the edge. Normals may be null.
+// Safe to call from worker threads as long as nothing is writing the height field.
+lbfn void SampleHeightField(height_field* Field, v3 Origin, u32 Count, const v2* P, f32* Heights, v3* Normals);
+// NOTE(boti): Raycast against the triangulated height field, the mips are used to skip empty space
+lbfn b32 RaycastHeightField(height_field* Field, v3 Origin, ray Ray, f32 tMax, f32* tOut);
+
+// NOTE(boti): CDLOD terrain: a quadtree over the height field where every node is drawn with the same vertex grid,
+// so the mesh resolution halves at each level going up. Level 0 is the finest (leaves).
+// Vertices in the outer part of each LOD range get morphed towards the next coarser level to hide the transitions,
+// skirts hide the remaining cracks between chunks of different levels.
+struct terrain_node
+{
+    mmbox Box; // NOTE(boti): Terrain-space
+    u32 ChunkIndex; // NOTE(boti): Resident chunk, U32_MAX if none
+    b32 IsEmpty; // NOTE(boti): Outside the height field
+};
+
+// NOTE(boti): GPU-resident mesh of a node
+struct terrain_chunk
+{
+    geometry_buffer_allocation Allocation; // NOTE(boti): Vertices only, the indices are shared (see terrain::IndexAllocation)
+    u32 NodeIndex; // NOTE(boti): U32_MAX if unused
+    u32 Level;
+    b32 IsResident;
+    b32 IsGenerating;
+    u32 LastUsedFrameIndex;
+
+    // NOTE(boti): Camera state the morph was generated for
+    v3 MorphP;
+    u32 MorphClass;
 };
 
-inline f32 SampleHeight(height_field* Field, v2 Height);
+// NOTE(boti): Runs on the background queue, which never gets drained, 
+// so the job can span any number of frames. IsDone gets set by the worker once VertexData is complete
+struct terrain_job
+{
+    struct terrain* Terrain;
+    u32 ChunkIndex; // NOTE(boti): U32_MAX if the job isn't in use
+    v3 CameraP;
+    vertex* VertexData;
+    u32 IsDone;
+
+    u32 Padding[7];
+};
+static_assert(sizeof(terrain_job) % 64 == 0);
+
+struct terrain
+{
+    static constexpr u32 ChunkQuadCount             = 64;
+    static constexpr u32 ChunkVertexCountPerSide    = ChunkQuadCount + 1;
+    static constexpr u32 ChunkGridVertexCount       = ChunkVertexCountPerSide * ChunkVertexCountPerSide;
+    static constexpr u32 ChunkVertexCount           = ChunkGridVertexCount + 4 * ChunkVertexCountPerSide;
+    static constexpr u32 ChunkIndexCount            = 6 * ChunkQuadCount * ChunkQuadCount + 4 * 6 * ChunkQuadCount;
+
+    static constexpr u32 MaxLevelCount              = 12;
+    static constexpr u32 MaxChunkCount              = 128;
+    static constexpr u32 MaxJobCount                = 8; // NOTE(boti): Max chunk generations in flight
+    static constexpr u32 MaxSelectedNodeCount       = 512;
+
+    static constexpr f32 LODRangeRatio              = 2.0f; // NOTE(boti): LOD range relative to the node size
+    static constexpr f32 MorphStartRatio            = 0.66f;
+    static constexpr f32 MorphUpdateRatio           = 1.0f / 16.0f; // NOTE(boti): Camera movement (relative to the morph range) that triggers regeneration
+    static constexpr f32 SkirtDepthRatio            = 0.05f; // NOTE(boti): Relative to the node size
+
+    height_field* Field;
+    v3 P; // NOTE(boti): World-space position of the height field origin
+    u32 MaterialID;
+
+    u32 LevelCount;
+    u32 LeafCountPerSide;
+    f32 LeafSize; // NOTE(boti): In meters
+    f32 LODRanges[MaxLevelCount];
+    u32 LevelNodeOffsets[MaxLevelCount];
+    u32 NodeCount;
+    terrain_node* Nodes;
+
+    vert_index* IndexData; // NOTE(boti): Shared by all chunks
+    geometry_buffer_allocation IndexAllocation;
+    b32 IsIndexDataResident;
+
+    u32 FrameIndex;
+    terrain_chunk Chunks[MaxChunkCount];
+
+    u32 JobCount; // NOTE(boti): Jobs in flight, the slots aren't compacted because the workers hold pointers to them
+    terrain_job Jobs[MaxJobCount];
+
+    u32 SelectedNodeCount;
+    u32 SelectedNodes[MaxSelectedNodeCount];
+};
+
+lbfn void InitTerrain(terrain* Terrain, height_field* Field, v3 P, u32 MaterialID, memory_arena* Arena);
+lbfn void UpdateAndRenderTerrain(terrain* Terrain, struct assets* Assets, render_frame* Frame);
 
 //
 // World
@@ -144,10 +362,12 @@ struct game_world
     noise2 TerrainNoise;
     u32 TerrainMaterialID;
     height_field HeightField;
-    v2 TerrainP;
+    terrain Terrain;
 
     entity_id IKControlID; // NOTE(boti): Dummy entity for IK testing
 
+    bvh BVH;
+
     static constexpr u32 MaxEntityCount = (1u << 18);
     entity_id NextEntityID;
     entity Entities[MaxEntityCount];
@@ -156,6 +376,10 @@ struct game_world
     u32 ParticleSystemCount;
     particle_system ParticleSystems[MaxParticleSystemCount];
 
+    static constexpr u32 MaxAnimatorCount = 1024u;
+    u32 AnimatorCount;
+    animator Animators[MaxAnimatorCount];
+
     // NOTE(boti): Ad-hoc lights are just for testing the light binning
     f32 AdHocLightUpdateRate;
     f32 AdHocLightCounter;
@@ -185,6 +409,32 @@ inline entity* MakeEntity(game_world* World, entity_id* ID)
     return(Result);
 }
 
+inline animator* MakeAnimator(game_world* World, u32 SkinID, u32* ID)
+{
+    u32 IDValue = 0;
+    animator* Result = nullptr;
+    if (World->AnimatorCount < World->MaxAnimatorCount)
+    {
+        IDValue = World->AnimatorCount++;
+        Result = World->Animators + IDValue;
+        InitAnimator(Result, SkinID);
+    }
+
+    if (ID)
+    {
+        *ID = IDValue;
+    }
+
+    return(Result);
+}
+
+inline animator* GetAnimator(game_world* World, u32 ID)
+{
+    Assert(ID < World->AnimatorCount);
+    animator* Result = World->Animators + ID;
+    return(Result);
+}
+
 inline entity* GetEntity(game_world* World, entity_id ID)
 {
     Assert(ID.Value < World->NextEntityID.Value);
@@ -231,13 +481,11 @@ lbfn void UpdateAndRenderWorld(
     game_world* World, 
     struct assets* Assets, 
     render_frame* Frame, 
+    thread_context* ThreadContext,
     game_io* IO, 
     memory_arena* Scratch, 
     debug_flags DebugFlags);
 
-internal mesh_data 
-GenerateTerrainChunk(height_field* Field, memory_arena* Arena);
-
 enum debug_scene_type
 {
     DebugScene_None = 0,
@@ -261,6 +509,7 @@ DEBUGInitializeWorld(
     game_world* World, 
     assets* Assets, 
     render_frame* Frame, 
+    thread_context* ThreadContext,
     memory_arena* Scratch,
     debug_scene_type Type,
     debug_scene_flags Flags);
@@ -268,36 +517,23 @@ DEBUGInitializeWorld(
 //
 // Implementation
 //
-inline f32 SampleHeight(height_field* Field, v2 UV)
+inline void SetParticle(particle_system* System, u32 Index, const particle* Particle)
 {
-    v2u Coord = 
+    Assert(Index < System->MaxParticleCount);
+    for (u32 Component = 0; Component < 3; Component++)
     {
-        (u32)Floor(Field->TexelCountX * UV.X),
-        (u32)Floor(Field->TexelCountY * UV.Y),
-    };
-
-    f32 Result = Field->HeightData[Coord.X + Coord.Y * Field->TexelCountX];
-    return(Result);
+        System->P[Component][Index]         = Particle->P.E[Component];
+        System->dP[Component][Index]        = Particle->dP.E[Component];
+        System->ddP[Component][Index]       = Particle->ddP.E[Component];
+        System->Color[Component][Index]     = Particle->Color.E[Component];
+        System->dColor[Component][Index]    = Particle->dColor.E[Component];
+    }
+    System->TextureIndices[Index] = Particle->TextureIndex;
 }
 
-lbfn v4 SampleTerrain(game_world* World, v2 P)
+inline void AdvanceParticle(particle* Particle, f32 dt)
 {
-    v4 Result = {};
-    #if 0
-    v2 BaseP = P + World->TerrainP;
-
-    v2 UV = P; // TODO
-    f32 Height = SampleHeight(&World->HeightField, UV);
-    v3 PX0 = SampleHeight(&World->HeightField, { P.X - 1.0f, P.Y });
-    v3 PX1 = SampleHeight(&World->HeightField, { P.X + 1.0f, P.Y });
-    v3 PY0 = SampleHeight(&World->HeightField, { P.X, P.Y - 1.0f });
-    v3 PY1 = SampleHeight(&World->HeightField, { P.X, P.Y + 1.0f });
-
-    v3 T = NOZ(PX1 - PX0);
-    v3 B = NOZ(PY1 - PY0);
-    v3 N = NOZ(Cross(T, B));
-    v4 Result = { N.X, N.Y, N.Z, -Dot(N, v3{ P.X, P.Y, Height }) };
-    #endif
-
-    return(Result);
-}
\ No newline at end of file
+    Particle->P += dt * Particle->dP + (0.5f * dt * dt) * Particle->ddP;
+    Particle->dP += dt * Particle->ddP;
+    Particle->Color += dt * Particle->dColor;
+}
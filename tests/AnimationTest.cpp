@@ -0,0 +1,1798 @@
+// NOTE(boti): The threading headers pull in <ios>, which has a member named internal
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Test.hpp"
+
+#include <LadybugEngine.hpp>
+#include <Animation.cpp>
+#include <profiler.cpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <sys/mman.h>
+
+platform_api Platform;
+
+//
+// Test data
+//
+
+// NOTE(boti): Analytic joint motion, the source clips are sampled from this
+// so that the compressed curves can be checked against the uncompressed source
+struct joint_motion
+{
+    b32 HasCurves; // NOTE(boti): Joints without curves keep the bind pose
+    v4 BaseRotation;
+    v3 Axis;
+    f32 Spin; // NOTE(boti): Radians per second, spinning joints cross the quaternion hemisphere
+    f32 Amplitude;
+    f32 Frequency;
+    f32 Phase;
+    v3 BasePosition;
+    v3 PositionAmplitude;
+    f32 ScaleAmplitude;
+};
+
+// NOTE(boti): Uncompressed clip with a key for every joint and channel at every frame,
+// this is what the importer gets from glTF (and what animations were stored as before the compression)
+struct source_clip
+{
+    u32 JointCount;
+    u32 FrameCount;
+    f32 MaxTimestamp;
+    std::vector<joint_motion> Motions;
+    std::vector<f32> Times;
+    std::vector<trs_transform> Transforms; // NOTE(boti): FrameCount * JointCount
+};
+
+struct test_clip
+{
+    animation Animation;
+    std::vector<animation_curve> Curves;
+    std::vector<animation_key> Keys;
+};
+
+internal v4 RandomRotation(entropy32* Entropy)
+{
+    v4 Result;
+    do
+    {
+        Result = { RandBilateral(Entropy), RandBilateral(Entropy), RandBilateral(Entropy), RandBilateral(Entropy) };
+    } while (Dot(Result, Result) < 1e-2f || Dot(Result, Result) > 1.0f);
+    Result = Normalize(Result);
+    return(Result);
+}
+
+internal v3 RandomDirection(entropy32* Entropy)
+{
+    v4 Q = RandomRotation(Entropy);
+    v3 Result = Normalize(Q.XYZ);
+    return(Result);
+}
+
+internal trs_transform EvaluateJointMotion(const joint_motion* Motion, f32 Time)
+{
+    f32 Wave = Sin(Motion->Frequency * Time + Motion->Phase);
+    f32 Angle = Motion->Spin * Time + Motion->Amplitude * Wave;
+
+    trs_transform Result;
+    Result.Rotation = QMul(QuatFromAxisAngle(Motion->Axis, Angle), Motion->BaseRotation);
+    Result.Position = Motion->BasePosition + Motion->PositionAmplitude * Wave;
+    Result.Scale = { 1.0f + Motion->ScaleAmplitude * Wave, 1.0f + Motion->ScaleAmplitude * Wave, 1.0f };
+    return(Result);
+}
+
+// NOTE(boti): Rough mix of a mocap clip: most joints (fingers, toes, face) barely move,
+// a few of them move a lot, only the root translates and hardly anything scales
+internal void InitJointMotions(std::vector<joint_motion>& Motions, u32 JointCount, entropy32* Entropy)
+{
+    Motions.resize(JointCount);
+    for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+    {
+        joint_motion* Motion = &Motions[JointIndex];
+        *Motion = {};
+        Motion->HasCurves = (JointIndex + 3 < JointCount); // NOTE(boti): End joints don't get curves
+        Motion->BaseRotation = RandomRotation(Entropy);
+        Motion->Axis = RandomDirection(Entropy);
+        Motion->Phase = RandBetween(Entropy, 0.0f, 2.0f * Pi);
+        Motion->BasePosition = { RandBetween(Entropy, -0.1f, 0.1f), RandBetween(Entropy, 0.1f, 0.3f), RandBetween(Entropy, -0.1f, 0.1f) };
+
+        u32 Kind = RandU32(Entropy) % 10;
+        if (Kind < 5)
+        {
+            // NOTE(boti): Static
+        }
+        else if (Kind < 8)
+        {
+            Motion->Amplitude = RandBetween(Entropy, 0.05f, 0.2f);
+            Motion->Frequency = RandBetween(Entropy, 0.5f, 1.5f);
+        }
+        else if (Kind < 9)
+        {
+            Motion->Amplitude = RandBetween(Entropy, 0.3f, 0.8f);
+            Motion->Frequency = RandBetween(Entropy, 2.0f, 4.0f);
+        }
+        else
+        {
+            Motion->Spin = RandBetween(Entropy, 1.0f, 3.0f);
+        }
+    }
+
+    Motions[0].HasCurves = true;
+    Motions[0].PositionAmplitude = { 0.05f, 0.02f, 0.3f };
+    Motions[0].Frequency = Max(Motions[0].Frequency, 1.0f);
+    if (JointCount > 1)
+    {
+        Motions[1].ScaleAmplitude = 0.1f;
+        Motions[1].Frequency = Max(Motions[1].Frequency, 1.0f);
+    }
+}
+
+internal source_clip* CreateSourceClip(const std::vector<joint_motion>& Motions, u32 FrameCount, f32 Duration, entropy32* Entropy)
+{
+    source_clip* Clip = new source_clip;
+    Clip->JointCount = (u32)Motions.size();
+    Clip->FrameCount = FrameCount;
+    Clip->MaxTimestamp = Duration;
+    Clip->Motions = Motions;
+    Clip->Times.resize(FrameCount);
+    Clip->Transforms.resize(FrameCount * Clip->JointCount);
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        f32 Time = Duration * (f32)FrameIndex / (f32)(FrameCount - 1);
+        Clip->Times[FrameIndex] = Time;
+        for (u32 JointIndex = 0; JointIndex < Clip->JointCount; JointIndex++)
+        {
+            trs_transform Transform = EvaluateJointMotion(&Motions[JointIndex], Time);
+            // NOTE(boti): Exporters don't keep the quaternions in one hemisphere
+            if ((RandU32(Entropy) % 4) == 0)
+            {
+                Transform.Rotation = -Transform.Rotation;
+            }
+            Clip->Transforms[FrameIndex * Clip->JointCount + JointIndex] = Transform;
+        }
+    }
+    return(Clip);
+}
+
+// NOTE(boti): Same as the glTF import in Asset.cpp
+internal test_clip* CompressClip(source_clip* Source)
+{
+    test_clip* Clip = new test_clip;
+    animation* Animation = &Clip->Animation;
+    *Animation = {};
+    Animation->JointCount = Source->JointCount;
+    Animation->MinTimestamp = 0.0f;
+    Animation->MaxTimestamp = Source->MaxTimestamp;
+
+    Clip->Curves.resize(Source->JointCount * AnimationChannel_Count, animation_curve{});
+    Clip->Keys.resize(Source->JointCount * AnimationChannel_Count * Source->FrameCount);
+    Animation->Curves = Clip->Curves.data();
+
+    std::vector<v4> SourceValues(Source->FrameCount);
+    std::vector<animation_key> Scratch(Source->FrameCount);
+    u32 KeyCount = 0;
+    for (u32 JointIndex = 0; JointIndex < Source->JointCount; JointIndex++)
+    {
+        if (!Source->Motions[JointIndex].HasCurves) continue;
+
+        Animation->ActiveJoints.Bits[JointIndex / 64] |= 1llu << (JointIndex % 64);
+        for (u32 Channel = 0; Channel < AnimationChannel_Count; Channel++)
+        {
+            for (u32 FrameIndex = 0; FrameIndex < Source->FrameCount; FrameIndex++)
+            {
+                trs_transform Transform = Source->Transforms[FrameIndex * Source->JointCount + JointIndex];
+                switch (Channel)
+                {
+                    case AnimationChannel_Rotation: SourceValues[FrameIndex] = Transform.Rotation; break;
+                    case AnimationChannel_Position: SourceValues[FrameIndex] = { Transform.Position.X, Transform.Position.Y, Transform.Position.Z, 0.0f }; break;
+                    case AnimationChannel_Scale:    SourceValues[FrameIndex] = { Transform.Scale.X, Transform.Scale.Y, Transform.Scale.Z, 0.0f }; break;
+                }
+            }
+
+            animation_curve* Curve = GetAnimationCurve(Animation, JointIndex, (animation_channel)Channel);
+            Curve->FirstKey = KeyCount;
+            Curve->KeyCount = CompressAnimationCurve((animation_channel)Channel, Source->FrameCount, Source->Times.data(), SourceValues.data(),
+                                                     Source->MaxTimestamp, Curve, Clip->Keys.data() + KeyCount, Scratch.data());
+            KeyCount += Curve->KeyCount;
+        }
+    }
+    Clip->Keys.resize(KeyCount);
+    Animation->KeyCount = KeyCount;
+    Animation->Keys = Clip->Keys.data();
+    return(Clip);
+}
+
+// NOTE(boti): Joints are parented to one of the few joints before them, so the hierarchy has long chains
+internal void InitTestSkin(skin* Skin, const std::vector<joint_motion>& Motions, u32 JointCount, entropy32* Entropy)
+{
+    memset(Skin, 0, sizeof(*Skin));
+    Skin->JointCount = JointCount;
+
+    m4 ModelBindTransforms[R_MaxJointCount];
+    for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+    {
+        u32 ParentIndex = JointIndex;
+        if (JointIndex > 0)
+        {
+            ParentIndex = JointIndex - 1 - (RandU32(Entropy) % Min(JointIndex, 4u));
+        }
+        Skin->JointParents[JointIndex] = ParentIndex;
+
+        trs_transform Bind;
+        if (JointIndex < Motions.size())
+        {
+            Bind.Rotation = Motions[JointIndex].BaseRotation;
+            Bind.Position = Motions[JointIndex].BasePosition;
+        }
+        else
+        {
+            Bind.Rotation = RandomRotation(Entropy);
+            Bind.Position = { 0.0f, 0.2f, 0.0f };
+        }
+        Bind.Scale = { 1.0f, 1.0f, 1.0f };
+        SetJointTransform(&Skin->BindPose, JointIndex, Bind);
+
+        m4 Local = TRSToM4(Bind);
+        ModelBindTransforms[JointIndex] = (ParentIndex == JointIndex) ? Local : ModelBindTransforms[ParentIndex] * Local;
+        Skin->InverseBindMatrices[JointIndex] = AffineInverse(ModelBindTransforms[JointIndex]);
+    }
+}
+
+// NOTE(boti): Only the skins and animations get used, the rest of the (huge) struct is never touched.
+// The skins need to be 32-byte aligned for the 8-wide loads, so the memory comes straight from the OS.
+internal assets* CreateTestAssets()
+{
+    assets* Assets = (assets*)mmap(nullptr, sizeof(assets), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    Assert(Assets != MAP_FAILED);
+    return(Assets);
+}
+
+internal void DestroyTestAssets(assets* Assets)
+{
+    munmap(Assets, sizeof(assets));
+}
+
+internal u32 AddTestSkin(assets* Assets, const skin* Skin)
+{
+    u32 Result = Assets->SkinCount++;
+    Assets->Skins[Result] = *Skin;
+    return(Result);
+}
+
+internal u32 AddTestAnimation(assets* Assets, test_clip* Clip, u32 SkinID)
+{
+    u32 Result = Assets->AnimationCount++;
+    Assets->Animations[Result] = Clip->Animation;
+    Assets->Animations[Result].SkinID = SkinID;
+    return(Result);
+}
+
+//
+// Reference (scalar) sampling
+//
+
+// NOTE(boti): |A - B| along the short arc, q and -q are the same rotation
+internal f32 GetRotationError(v4 A, v4 B)
+{
+    v4 D0 = A - B;
+    v4 D1 = A + B;
+    f32 Result = Sqrt(Min(Dot(D0, D0), Dot(D1, D1)));
+    return(Result);
+}
+
+internal f32 GetVectorError(v3 A, v3 B)
+{
+    f32 Result = Max(Max(Abs(A.X - B.X), Abs(A.Y - B.Y)), Abs(A.Z - B.Z));
+    return(Result);
+}
+
+// NOTE(boti): Scalar version of SampleAnimation for a single joint and channel (without cursors),
+// returns false if the joint doesn't have a curve for the channel
+internal b32 SampleCurveScalar(animation* Animation, u32 JointIndex, animation_channel Channel, f32 Time, v4* Value)
+{
+    b32 Result = false;
+    animation_curve* Curve = (JointIndex < Animation->JointCount) ? GetAnimationCurve(Animation, JointIndex, Channel) : nullptr;
+    if (Curve && Curve->KeyCount)
+    {
+        f32 KeyTime = 65535.0f * Clamp(Ratio0(Time, Animation->MaxTimestamp), 0.0f, 1.0f);
+        const animation_key* Keys = Animation->Keys + Curve->FirstKey;
+        u32 KeyIndex = FindAnimationKey(Keys, Curve->KeyCount, KeyTime);
+        const animation_key* Key0 = Keys + KeyIndex;
+        const animation_key* Key1 = Keys + Min(KeyIndex + 1, Curve->KeyCount - 1);
+        f32 t = Clamp(Ratio0(KeyTime - Key0->Time, (f32)(Key1->Time - Key0->Time)), 0.0f, 1.0f);
+        if (Channel == AnimationChannel_Rotation)
+        {
+            *Value = QLerp(DecodeRotationKey(Key0), DecodeRotationKey(Key1), t);
+        }
+        else
+        {
+            v3 V = Lerp(DecodeVectorKey(Curve, Key0), DecodeVectorKey(Curve, Key1), t);
+            *Value = { V.X, V.Y, V.Z, 0.0f };
+        }
+        Result = true;
+    }
+    return(Result);
+}
+
+internal void SamplePoseScalar(skin* Skin, animation* Animation, f32 Time, joint_pose* Pose)
+{
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        trs_transform Transform = GetJointTransform(&Skin->BindPose, JointIndex);
+        v4 Value;
+        if (SampleCurveScalar(Animation, JointIndex, AnimationChannel_Rotation, Time, &Value)) Transform.Rotation = Value;
+        if (SampleCurveScalar(Animation, JointIndex, AnimationChannel_Position, Time, &Value)) Transform.Position = Value.XYZ;
+        if (SampleCurveScalar(Animation, JointIndex, AnimationChannel_Scale, Time, &Value)) Transform.Scale = Value.XYZ;
+        SetJointTransform(Pose, JointIndex, Transform);
+    }
+}
+
+// NOTE(boti): How the animations used to be sampled: binary search in the dense keyframes, then QLerp/Lerp every joint
+internal trs_transform SampleSourceClip(source_clip* Clip, u32 JointIndex, f32 Time)
+{
+    u32 FrameIndex = (u32)(std::upper_bound(Clip->Times.begin(), Clip->Times.end(), Time) - Clip->Times.begin());
+    FrameIndex = (FrameIndex > 0) ? FrameIndex - 1 : 0;
+    u32 NextFrameIndex = Min(FrameIndex + 1, Clip->FrameCount - 1);
+    f32 t = Clamp(Ratio0(Time - Clip->Times[FrameIndex], Clip->Times[NextFrameIndex] - Clip->Times[FrameIndex]), 0.0f, 1.0f);
+
+    trs_transform A = Clip->Transforms[FrameIndex * Clip->JointCount + JointIndex];
+    trs_transform B = Clip->Transforms[NextFrameIndex * Clip->JointCount + JointIndex];
+    trs_transform Result;
+    Result.Rotation = QLerp(A.Rotation, B.Rotation, t);
+    Result.Position = Lerp(A.Position, B.Position, t);
+    Result.Scale = Lerp(A.Scale, B.Scale, t);
+    return(Result);
+}
+
+internal f32 GetMatrixError(const m4& A, const m4& B)
+{
+    f32 Result = 0.0f;
+    for (u32 Index = 0; Index < 16; Index++)
+    {
+        Result = Max(Result, Abs(A.EE[Index] - B.EE[Index]));
+    }
+    return(Result);
+}
+
+// NOTE(boti): How the skinning transforms used to be computed: TRSToM4, then a parent multiply for every joint
+internal void GetSkinningTransformsScalar(skin* Skin, const joint_pose* Pose, m4* Transforms)
+{
+    m4 ModelTransforms[R_MaxJointCount];
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        m4 Local = TRSToM4(GetJointTransform(Pose, JointIndex));
+        u32 ParentIndex = Skin->JointParents[JointIndex];
+        ModelTransforms[JointIndex] = (ParentIndex == JointIndex) ? Local : ModelTransforms[ParentIndex] * Local;
+        Transforms[JointIndex] = ModelTransforms[JointIndex] * Skin->InverseBindMatrices[JointIndex];
+    }
+}
+
+//
+// Compression
+//
+
+internal void TestRotationKeys()
+{
+    constexpr f32 Bound = 0.70710678f;
+    // NOTE(boti): Half a quantization step for each of the 3 stored components,
+    // the dropped component is reconstructed from them (and it's the largest, so its error is at most the sum of theirs)
+    constexpr f32 MaxComponentError = 0.5f * (2.0f * Bound / 32767.0f);
+    constexpr f32 MaxError = 2.0f * (3.0f * MaxComponentError) + 1e-6f;
+
+    v4 SpecialRotations[] =
+    {
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, 0.0f, -1.0f },
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, -1.0f, 0.0f, 0.0f },
+        { 0.5f, 0.5f, 0.5f, 0.5f },
+        { -0.5f, 0.5f, -0.5f, 0.5f },
+        { Bound, Bound, 0.0f, 0.0f }, // NOTE(boti): Ties between the largest components
+        { 0.0f, -Bound, 0.0f, Bound },
+        { 0.0f, 0.0f, Bound, -Bound },
+        { 2.0f, 0.0f, 0.0f, 2.0f }, // NOTE(boti): Not normalized
+    };
+
+    entropy32 Entropy = { 0x0707u };
+    f32 WorstError = 0.0f;
+    b32 IsSignInvariant = true;
+    b32 IsLargestPositive = true;
+    b32 IsWithinBound = true;
+    for (u32 Index = 0; Index < 100000 + CountOf(SpecialRotations); Index++)
+    {
+        v4 Q = (Index < CountOf(SpecialRotations)) ? Normalize(SpecialRotations[Index]) : RandomRotation(&Entropy);
+        if (Index >= CountOf(SpecialRotations) && (Index % 3) == 0)
+        {
+            // NOTE(boti): Close to the boundary between two largest components
+            Q.E[Index % 4] = Q.E[(Index + 1) % 4] * ((Index % 2) ? 1.0f : -1.0f);
+            Q = Normalize(Q);
+        }
+
+        animation_key Key = EncodeRotationKey(Q);
+        animation_key FlippedKey = EncodeRotationKey(-Q);
+        IsSignInvariant &= (memcmp(Key.Values, FlippedKey.Values, sizeof(Key.Values)) == 0);
+
+        v4 Decoded = DecodeRotationKey(&Key);
+        u32 LargestIndex = (Key.Values[0] >> 15) | ((Key.Values[1] >> 15) << 1);
+        IsLargestPositive &= (Decoded.E[LargestIndex] >= 0.0f);
+
+        f32 Error = GetRotationError(Decoded, (Index < CountOf(SpecialRotations)) ? Normalize(SpecialRotations[Index]) : Q);
+        IsWithinBound &= (Error <= MaxError);
+        WorstError = Max(WorstError, Error);
+    }
+    Expect(IsSignInvariant);
+    Expect(IsLargestPositive);
+    Expect(IsWithinBound);
+    // NOTE(boti): The quantization alone has to stay well inside the reduction tolerance
+    Expect(WorstError < 0.25f * (0.5f * animation::RotationTolerance));
+}
+
+internal void TestVectorKeys()
+{
+    entropy32 Entropy = { 0x7EC7u };
+    b32 IsWithinBound = true;
+    b32 IsClamped = true;
+    for (u32 Index = 0; Index < 100000; Index++)
+    {
+        animation_curve Curve = {};
+        Curve.Min = { RandBetween(&Entropy, -10.0f, 10.0f), RandBetween(&Entropy, -10.0f, 10.0f), RandBetween(&Entropy, -10.0f, 10.0f) };
+        Curve.Extent = { RandBetween(&Entropy, 0.0f, 5.0f), RandBetween(&Entropy, 0.0f, 5.0f), RandBetween(&Entropy, 0.0f, 5.0f) };
+        if ((Index % 8) == 0)
+        {
+            Curve.Extent.Y = 0.0f; // NOTE(boti): Flat axis
+        }
+
+        v3 V =
+        {
+            Curve.Min.X + Curve.Extent.X * RandUnilateral(&Entropy),
+            Curve.Min.Y + Curve.Extent.Y * RandUnilateral(&Entropy),
+            Curve.Min.Z + Curve.Extent.Z * RandUnilateral(&Entropy),
+        };
+        animation_key Key = EncodeVectorKey(&Curve, V);
+        v3 Decoded = DecodeVectorKey(&Curve, &Key);
+        for (u32 Component = 0; Component < 3; Component++)
+        {
+            // NOTE(boti): Half a step, plus the rounding of the float math around Min
+            f32 MaxError = 0.5f * Curve.Extent.E[Component] / 65535.0f + 4e-6f;
+            IsWithinBound &= (Abs(Decoded.E[Component] - V.E[Component]) <= MaxError);
+        }
+
+        // NOTE(boti): Values outside the box clamp to it
+        v3 Outside = Curve.Min - v3{ 1.0f, 1.0f, 1.0f };
+        animation_key OutsideKey = EncodeVectorKey(&Curve, Outside);
+        IsClamped &= (OutsideKey.Values[0] == 0) && (OutsideKey.Values[1] == 0) && (OutsideKey.Values[2] == 0);
+    }
+    Expect(IsWithinBound);
+    Expect(IsClamped);
+
+    Expect(QuantizeAnimationTime(0.0f, 2.0f) == 0);
+    Expect(QuantizeAnimationTime(2.0f, 2.0f) == 65535);
+    Expect(QuantizeAnimationTime(3.0f, 2.0f) == 65535);
+    Expect(QuantizeAnimationTime(-1.0f, 2.0f) == 0);
+    Expect(QuantizeAnimationTime(1.0f, 0.0f) == 0);
+}
+
+struct clip_error
+{
+    f32 Rotation;
+    f32 Position;
+    f32 Scale;
+};
+
+// NOTE(boti): Max. error of the compressed curves (decoded by the scalar path) at the source keys
+internal clip_error GetClipError(source_clip* Source, test_clip* Clip)
+{
+    clip_error Result = {};
+    for (u32 FrameIndex = 0; FrameIndex < Source->FrameCount; FrameIndex++)
+    {
+        for (u32 JointIndex = 0; JointIndex < Source->JointCount; JointIndex++)
+        {
+            if (!Source->Motions[JointIndex].HasCurves) continue;
+
+            trs_transform Expected = Source->Transforms[FrameIndex * Source->JointCount + JointIndex];
+            f32 Time = Source->Times[FrameIndex];
+            v4 Rotation, Position, Scale;
+            SampleCurveScalar(&Clip->Animation, JointIndex, AnimationChannel_Rotation, Time, &Rotation);
+            SampleCurveScalar(&Clip->Animation, JointIndex, AnimationChannel_Position, Time, &Position);
+            SampleCurveScalar(&Clip->Animation, JointIndex, AnimationChannel_Scale, Time, &Scale);
+            Result.Rotation = Max(Result.Rotation, GetRotationError(Rotation, Normalize(Expected.Rotation)));
+            Result.Position = Max(Result.Position, GetVectorError(Position.XYZ, Expected.Position));
+            Result.Scale = Max(Result.Scale, GetVectorError(Scale.XYZ, Expected.Scale));
+        }
+    }
+    return(Result);
+}
+
+internal void TestCurveCompression()
+{
+    entropy32 Entropy = { 0xC0C0u };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, 65, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 121, 4.0f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+
+    // NOTE(boti): The compression is error-bounded against the source (the positions are well above the quantization step)
+    clip_error Error = GetClipError(Source, Clip);
+    constexpr f32 Slack = 1e-5f; // NOTE(boti): Float rounding between the compressor and the sampler
+    Expect(Error.Rotation <= 0.5f * animation::RotationTolerance + Slack);
+    Expect(Error.Position <= animation::PositionTolerance + Slack);
+    Expect(Error.Scale <= animation::ScaleTolerance + Slack);
+
+    // NOTE(boti): Static channels collapse to a single key, moving ones keep their endpoints
+    b32 AreStaticCurvesCollapsed = true;
+    b32 AreMovingCurvesKept = true;
+    for (u32 JointIndex = 0; JointIndex < Source->JointCount; JointIndex++)
+    {
+        joint_motion* Motion = &Source->Motions[JointIndex];
+        animation_curve* Rotation = GetAnimationCurve(&Clip->Animation, JointIndex, AnimationChannel_Rotation);
+        animation_curve* Scale = GetAnimationCurve(&Clip->Animation, JointIndex, AnimationChannel_Scale);
+        if (!Motion->HasCurves)
+        {
+            AreStaticCurvesCollapsed &= (Rotation->KeyCount == 0);
+        }
+        else if (Motion->Amplitude == 0.0f && Motion->Spin == 0.0f)
+        {
+            AreStaticCurvesCollapsed &= (Rotation->KeyCount == 1);
+        }
+        else
+        {
+            const animation_key* Keys = Clip->Animation.Keys + Rotation->FirstKey;
+            AreMovingCurvesKept &= (Rotation->KeyCount >= 2) && (Keys[0].Time == 0) && (Keys[Rotation->KeyCount - 1].Time == 65535);
+        }
+
+        if (Motion->HasCurves && Motion->ScaleAmplitude == 0.0f)
+        {
+            AreStaticCurvesCollapsed &= (Scale->KeyCount == 1);
+        }
+    }
+    Expect(AreStaticCurvesCollapsed);
+    Expect(AreMovingCurvesKept);
+
+    // NOTE(boti): A linear curve only needs its endpoints
+    {
+        f32 Times[64];
+        v4 Values[64];
+        for (u32 Index = 0; Index < CountOf(Times); Index++)
+        {
+            Times[Index] = (f32)Index / 30.0f;
+            Values[Index] = { 1.0f + 0.5f * Times[Index], -2.0f * Times[Index], 0.25f, 0.0f };
+        }
+        animation_curve Curve = {};
+        animation_key Keys[64], Scratch[64];
+        u32 KeyCount = CompressAnimationCurve(AnimationChannel_Position, CountOf(Times), Times, Values, Times[CountOf(Times) - 1],
+                                              &Curve, Keys, Scratch);
+        Expect(KeyCount == 2);
+    }
+
+    // NOTE(boti): The dense layout stored a TRS transform for every joint at every frame
+    umm DenseSize = (umm)Source->FrameCount * Source->JointCount * sizeof(trs_transform);
+    umm CompressedSize = Clip->Curves.size() * sizeof(animation_curve) + Clip->Keys.size() * sizeof(animation_key);
+    Expect(10 * CompressedSize <= DenseSize);
+
+    delete Clip;
+    delete Source;
+}
+
+// NOTE(boti): The SIMD sampler against the scalar decode of the same curves,
+// including joints without curves and skins with more joints than the animation
+internal void TestSampleAnimation()
+{
+    entropy32 Entropy = { 0x5A3Eu };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, 61, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 97, 3.2f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, 67, &Entropy);
+
+    joint_pose* Pose = new joint_pose;
+    joint_pose* Expected = new joint_pose;
+    f32 WorstRotationError = 0.0f;
+    f32 WorstVectorError = 0.0f;
+    b32 IsBindPoseKept = true;
+    for (u32 Step = 0; Step < 1000; Step++)
+    {
+        f32 Time = RandBetween(&Entropy, -0.1f, Source->MaxTimestamp + 0.1f);
+        SampleAnimation(Skin, &Clip->Animation, Time, false, nullptr, Pose);
+        SamplePoseScalar(Skin, &Clip->Animation, Time, Expected);
+
+        for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+        {
+            trs_transform A = GetJointTransform(Pose, JointIndex);
+            trs_transform B = GetJointTransform(Expected, JointIndex);
+            WorstRotationError = Max(WorstRotationError, GetRotationError(A.Rotation, B.Rotation));
+            WorstVectorError = Max(WorstVectorError, Max(GetVectorError(A.Position, B.Position), GetVectorError(A.Scale, B.Scale)));
+
+            if (JointIndex >= Clip->Animation.JointCount || !Motions[JointIndex].HasCurves)
+            {
+                IsBindPoseKept &= (memcmp(&A, &B, sizeof(A)) == 0);
+            }
+        }
+    }
+    Expect(WorstRotationError <= 1e-6f);
+    Expect(WorstVectorError <= 1e-6f);
+    Expect(IsBindPoseKept);
+
+    delete Expected;
+    delete Pose;
+    delete Skin;
+    delete Clip;
+    delete Source;
+}
+
+//
+// Cursors and transforms
+//
+
+// NOTE(boti): Returns whether sampling with the cursors gives the exact same pose as the binary search
+internal b32 IsSameWithCursors(skin* Skin, animation* Animation, f32 Time, b32 IsAdditive, u16* Cursors, joint_pose* Pose, joint_pose* Expected)
+{
+    SampleAnimation(Skin, Animation, Time, IsAdditive, Cursors, Pose);
+    SampleAnimation(Skin, Animation, Time, IsAdditive, nullptr, Expected);
+    b32 Result = (memcmp(Pose, Expected, sizeof(*Pose)) == 0);
+    return(Result);
+}
+
+internal void TestAnimationCursors()
+{
+    entropy32 Entropy = { 0xC425u };
+
+    // NOTE(boti): Any cursor gives the same key as the binary search, including stale ones and keys at the same time
+    b32 IsSameAsSearch = true;
+    for (u32 Iteration = 0; Iteration < 2000; Iteration++)
+    {
+        animation_key Keys[40] = {};
+        u32 KeyCount = 1 + (RandU32(&Entropy) % CountOf(Keys));
+        u32 Time = RandU32(&Entropy) % 1000;
+        for (u32 KeyIndex = 0; KeyIndex < KeyCount; KeyIndex++)
+        {
+            Keys[KeyIndex].Time = (u16)Time;
+            Time += ((RandU32(&Entropy) % 4) == 0) ? 0 : RandU32(&Entropy) % 1500;
+        }
+
+        for (u32 SampleIndex = 0; SampleIndex < 64; SampleIndex++)
+        {
+            f32 KeyTime;
+            switch (RandU32(&Entropy) % 3)
+            {
+                case 0: KeyTime = (f32)Keys[RandU32(&Entropy) % KeyCount].Time; break;
+                case 1: KeyTime = (f32)Keys[RandU32(&Entropy) % KeyCount].Time - 0.5f; break;
+                default: KeyTime = RandBetween(&Entropy, 0.0f, (f32)Time + 1000.0f); break;
+            }
+
+            u32 Expected = FindAnimationKey(Keys, KeyCount, KeyTime);
+            for (u32 Cursor = 0; Cursor < KeyCount + 2; Cursor++)
+            {
+                IsSameAsSearch &= (AdvanceAnimationCursor(Keys, KeyCount, Cursor, KeyTime) == Expected);
+            }
+            IsSameAsSearch &= (AdvanceAnimationCursor(Keys, KeyCount, 0xFFFFu, KeyTime) == Expected);
+        }
+    }
+    Expect(IsSameAsSearch);
+
+    std::vector<joint_motion> Motions, OtherMotions;
+    InitJointMotions(Motions, 53, &Entropy);
+    InitJointMotions(OtherMotions, 53, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 91, 3.0f, &Entropy);
+    source_clip* OtherSource = CreateSourceClip(OtherMotions, 241, 8.0f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+    test_clip* OtherClip = CompressClip(OtherSource);
+    animation* Animation = &Clip->Animation;
+
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, 53, &Entropy);
+    joint_pose* Pose = new joint_pose {};
+    joint_pose* Expected = new joint_pose {};
+    u16 Cursors[R_MaxJointCount * AnimationChannel_Count] = {};
+
+    // NOTE(boti): Forward playback, looping back to the start a few times
+    b32 IsForwardSame = true;
+    f32 Time = 0.0f;
+    for (u32 Step = 0; Step < 450; Step++)
+    {
+        IsForwardSame &= IsSameWithCursors(Skin, Animation, Time, false, Cursors, Pose, Expected);
+        Time = Modulo0(Time + 1.0f / 60.0f, Animation->MaxTimestamp);
+    }
+    Expect(IsForwardSame);
+
+    // NOTE(boti): Slow motion (the cursors mostly stay on the same key)
+    b32 IsSlowMotionSame = true;
+    for (u32 Step = 0; Step < 200; Step++)
+    {
+        IsSlowMotionSame &= IsSameWithCursors(Skin, Animation, Time, false, Cursors, Pose, Expected);
+        Time = Modulo0(Time + 1.0f / 600.0f, Animation->MaxTimestamp);
+    }
+    Expect(IsSlowMotionSame);
+
+    // NOTE(boti): Scrubbing backwards, wrapping around the start
+    b32 IsBackwardSame = true;
+    for (u32 Step = 0; Step < 300; Step++)
+    {
+        IsBackwardSame &= IsSameWithCursors(Skin, Animation, Time, false, Cursors, Pose, Expected);
+        Time -= 1.0f / 45.0f;
+        if (Time < 0.0f)
+        {
+            Time += Animation->MaxTimestamp;
+        }
+    }
+    Expect(IsBackwardSame);
+
+    // NOTE(boti): Random jumps, additive sampling and times outside the clip
+    b32 IsJumpSame = true;
+    for (u32 Step = 0; Step < 500; Step++)
+    {
+        Time = RandBetween(&Entropy, -0.5f, Animation->MaxTimestamp + 0.5f);
+        IsJumpSame &= IsSameWithCursors(Skin, Animation, Time, (Step % 4) == 0, Cursors, Pose, Expected);
+    }
+    Expect(IsJumpSame);
+
+    // NOTE(boti): The cursors aren't reset when the animation changes, neither when they're garbage
+    b32 IsStaleSame = true;
+    for (u32 Step = 0; Step < 100; Step++)
+    {
+        IsStaleSame &= IsSameWithCursors(Skin, &OtherClip->Animation, RandBetween(&Entropy, 0.0f, 8.0f), false, Cursors, Pose, Expected);
+        IsStaleSame &= IsSameWithCursors(Skin, Animation, RandBetween(&Entropy, 0.0f, 3.0f), false, Cursors, Pose, Expected);
+    }
+    memset(Cursors, 0xFF, sizeof(Cursors));
+    IsStaleSame &= IsSameWithCursors(Skin, Animation, 1.0f, false, Cursors, Pose, Expected);
+    for (u16& Cursor : Cursors)
+    {
+        Cursor = (u16)RandU32(&Entropy);
+    }
+    IsStaleSame &= IsSameWithCursors(Skin, Animation, 2.0f, false, Cursors, Pose, Expected);
+    Expect(IsStaleSame);
+
+    delete Expected;
+    delete Pose;
+    delete Skin;
+    delete OtherClip;
+    delete Clip;
+    delete OtherSource;
+    delete Source;
+}
+
+internal void TestJointTransforms()
+{
+    entropy32 Entropy = { 0x7A45u };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, 67, &Entropy);
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, 67, &Entropy);
+
+    joint_pose* Pose = new joint_pose {};
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        trs_transform Transform;
+        Transform.Rotation = RandomRotation(&Entropy);
+        Transform.Position = { RandBilateral(&Entropy), RandBilateral(&Entropy), RandBilateral(&Entropy) };
+        Transform.Scale = { RandBetween(&Entropy, 0.8f, 1.25f), RandBetween(&Entropy, 0.8f, 1.25f), RandBetween(&Entropy, 0.8f, 1.25f) };
+        SetJointTransform(Pose, JointIndex, Transform);
+    }
+
+    // NOTE(boti): 8-wide local transforms against TRSToM4
+    m4 LocalTransforms[R_MaxJointCount];
+    GetLocalJointTransforms(Pose, Skin->JointCount, LocalTransforms);
+    f32 LocalError = 0.0f;
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        LocalError = Max(LocalError, GetMatrixError(LocalTransforms[JointIndex], TRSToM4(GetJointTransform(Pose, JointIndex))));
+    }
+    Expect(LocalError <= 1e-6f);
+
+    // NOTE(boti): Hierarchy pass against the scalar parent multiply
+    m4 ModelTransforms[R_MaxJointCount];
+    m4 ExpectedModelTransforms[R_MaxJointCount];
+    GetModelJointTransforms(Skin, LocalTransforms, 0, ModelTransforms);
+    f32 ModelError = 0.0f;
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        u32 ParentIndex = Skin->JointParents[JointIndex];
+        m4 Local = LocalTransforms[JointIndex];
+        ExpectedModelTransforms[JointIndex] = (ParentIndex == JointIndex) ? Local : ExpectedModelTransforms[ParentIndex] * Local;
+        ModelError = Max(ModelError, GetMatrixError(ModelTransforms[JointIndex], ExpectedModelTransforms[JointIndex]));
+    }
+    Expect(ModelError <= 1e-5f);
+
+    // NOTE(boti): Updating from a joint doesn't touch the joints before it, and it matches a full update
+    u32 FirstJoint = Skin->JointCount / 2;
+    LocalTransforms[FirstJoint] = TRSToM4({ RandomRotation(&Entropy), { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } });
+    m4 PartialTransforms[R_MaxJointCount];
+    memcpy(PartialTransforms, ModelTransforms, sizeof(ModelTransforms));
+    GetModelJointTransforms(Skin, LocalTransforms, FirstJoint, PartialTransforms);
+    GetModelJointTransforms(Skin, LocalTransforms, 0, ModelTransforms);
+    Expect(memcmp(PartialTransforms, ModelTransforms, Skin->JointCount * sizeof(m4)) == 0);
+
+    delete Pose;
+    delete Skin;
+}
+
+// NOTE(boti): EvaluateAnimator against the scalar path (scalar decode, TRSToM4, parent multiply) for a single base layer
+internal void TestEvaluateAnimator()
+{
+    entropy32 Entropy = { 0xE7A1u };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, 65, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 121, 4.0f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, 65, &Entropy);
+
+    assets* Assets = CreateTestAssets();
+    u32 SkinID = AddTestSkin(Assets, Skin);
+    u32 AnimationID = AddTestAnimation(Assets, Clip, SkinID);
+
+    animator* Animator = new animator;
+    InitAnimator(Animator, SkinID);
+    PlayAnimation(Animator, AnimationID, 0.0f);
+    Animator->IsPlaying = true;
+
+    m4 Transforms[R_MaxJointCount];
+    m4 ExpectedTransforms[R_MaxJointCount];
+    joint_pose* Pose = new joint_pose;
+    Animator->Pose = { .JointCount = Skin->JointCount, .Transforms = Transforms };
+    f32 Error = 0.0f;
+    for (u32 Step = 0; Step < 200; Step++)
+    {
+        UpdateAnimator(Animator, Assets, 1.0f / 30.0f);
+        EvaluateAnimator(Animator, Assets);
+
+        SamplePoseScalar(Skin, &Clip->Animation, Animator->BaseLayers[0].Time, Pose);
+        GetSkinningTransformsScalar(Skin, Pose, ExpectedTransforms);
+        for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+        {
+            Error = Max(Error, GetMatrixError(Transforms[JointIndex], ExpectedTransforms[JointIndex]));
+        }
+    }
+    Expect(Error <= 1e-5f);
+
+    delete Pose;
+    delete Animator;
+    DestroyTestAssets(Assets);
+    delete Skin;
+    delete Clip;
+    delete Source;
+}
+
+//
+// Blending and IK
+//
+
+internal b32 IsJointInMask(const joint_mask* Mask, u32 JointIndex)
+{
+    b32 Result = !Mask || ((Mask->Bits[JointIndex / 64] >> (JointIndex % 64)) & 1);
+    return(Result);
+}
+
+// NOTE(boti): Scalar versions of BlendPose and AddPose
+internal void BlendPoseScalar(joint_pose* Dst, const joint_pose* Src, u32 JointCount, f32 Weight, const joint_mask* Mask)
+{
+    for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+    {
+        if (Weight > 0.0f && IsJointInMask(Mask, JointIndex))
+        {
+            trs_transform A = GetJointTransform(Dst, JointIndex);
+            trs_transform B = GetJointTransform(Src, JointIndex);
+            A.Rotation = QLerp(A.Rotation, B.Rotation, Weight);
+            A.Position = Lerp(A.Position, B.Position, Weight);
+            A.Scale = Lerp(A.Scale, B.Scale, Weight);
+            SetJointTransform(Dst, JointIndex, A);
+        }
+    }
+}
+
+internal void AddPoseScalar(joint_pose* Dst, const joint_pose* Delta, u32 JointCount, f32 Weight, const joint_mask* Mask)
+{
+    for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+    {
+        if (Weight > 0.0f && IsJointInMask(Mask, JointIndex))
+        {
+            trs_transform A = GetJointTransform(Dst, JointIndex);
+            trs_transform D = GetJointTransform(Delta, JointIndex);
+            A.Rotation = QMul(A.Rotation, QLerp({ 0.0f, 0.0f, 0.0f, 1.0f }, D.Rotation, Weight));
+            A.Position = A.Position + Weight * D.Position;
+            A.Scale = 
+            {
+                A.Scale.X * (1.0f + Weight * (D.Scale.X - 1.0f)),
+                A.Scale.Y * (1.0f + Weight * (D.Scale.Y - 1.0f)),
+                A.Scale.Z * (1.0f + Weight * (D.Scale.Z - 1.0f)),
+            };
+            SetJointTransform(Dst, JointIndex, A);
+        }
+    }
+}
+
+// NOTE(boti): Scalar additive sample, relative to the first key of each curve
+internal void SamplePoseAdditiveScalar(skin* Skin, animation* Animation, f32 Time, joint_pose* Pose)
+{
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        trs_transform Transform = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+        v4 Value;
+        if (SampleCurveScalar(Animation, JointIndex, AnimationChannel_Rotation, Time, &Value))
+        {
+            v4 Reference = DecodeRotationKey(Animation->Keys + GetAnimationCurve(Animation, JointIndex, AnimationChannel_Rotation)->FirstKey);
+            Transform.Rotation = QMul({ -Reference.X, -Reference.Y, -Reference.Z, Reference.W }, Value);
+        }
+        if (SampleCurveScalar(Animation, JointIndex, AnimationChannel_Position, Time, &Value))
+        {
+            animation_curve* Curve = GetAnimationCurve(Animation, JointIndex, AnimationChannel_Position);
+            Transform.Position = Value.XYZ - DecodeVectorKey(Curve, Animation->Keys + Curve->FirstKey);
+        }
+        if (SampleCurveScalar(Animation, JointIndex, AnimationChannel_Scale, Time, &Value))
+        {
+            animation_curve* Curve = GetAnimationCurve(Animation, JointIndex, AnimationChannel_Scale);
+            v3 Reference = DecodeVectorKey(Curve, Animation->Keys + Curve->FirstKey);
+            Transform.Scale = { Value.X / Reference.X, Value.Y / Reference.Y, Value.Z / Reference.Z };
+        }
+        SetJointTransform(Pose, JointIndex, Transform);
+    }
+}
+
+internal void InitRandomPose(joint_pose* Pose, u32 JointCount, entropy32* Entropy)
+{
+    for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+    {
+        trs_transform Transform;
+        Transform.Rotation = RandomRotation(Entropy);
+        Transform.Position = { RandBilateral(Entropy), RandBilateral(Entropy), RandBilateral(Entropy) };
+        Transform.Scale = { RandBetween(Entropy, 0.5f, 2.0f), RandBetween(Entropy, 0.5f, 2.0f), RandBetween(Entropy, 0.5f, 2.0f) };
+        SetJointTransform(Pose, JointIndex, Transform);
+    }
+}
+
+struct pose_error
+{
+    f32 Rotation;
+    f32 Vector;
+    b32 AreMaskedOutJointsKept; // NOTE(boti): Positions and scales are bit-identical, rotations only get renormalized
+};
+
+internal pose_error ComparePoses(const joint_pose* Pose, const joint_pose* Expected, const joint_pose* Original, u32 JointCount, const joint_mask* Mask)
+{
+    pose_error Result = { .AreMaskedOutJointsKept = true };
+    for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+    {
+        trs_transform A = GetJointTransform(Pose, JointIndex);
+        trs_transform B = GetJointTransform(Expected, JointIndex);
+        Result.Rotation = Max(Result.Rotation, GetRotationError(A.Rotation, B.Rotation));
+        Result.Vector = Max(Result.Vector, Max(GetVectorError(A.Position, B.Position), GetVectorError(A.Scale, B.Scale)));
+
+        if (!IsJointInMask(Mask, JointIndex))
+        {
+            trs_transform Before = GetJointTransform(Original, JointIndex);
+            Result.AreMaskedOutJointsKept &= 
+                (memcmp(&A.Position, &Before.Position, sizeof(v3)) == 0) &&
+                (memcmp(&A.Scale, &Before.Scale, sizeof(v3)) == 0) &&
+                (GetRotationError(A.Rotation, Before.Rotation) <= 3e-7f);
+        }
+    }
+    return(Result);
+}
+
+internal void TestBlendPose()
+{
+    constexpr u32 JointCount = 75;
+    entropy32 Entropy = { 0xB1E4u };
+    joint_pose* Dst = new joint_pose {};
+    joint_pose* Src = new joint_pose {};
+    joint_pose* Pose = new joint_pose {};
+    joint_pose* Expected = new joint_pose {};
+
+    pose_error BlendError = {}, AddError = {};
+    b32 AreMaskedOutJointsKept = true;
+    b32 IsZeroWeightIgnored = true;
+    for (u32 Iteration = 0; Iteration < 200; Iteration++)
+    {
+        InitRandomPose(Dst, JointCount, &Entropy);
+        InitRandomPose(Src, JointCount, &Entropy);
+
+        joint_mask Mask;
+        for (u64& Bits : Mask.Bits)
+        {
+            Bits = ((u64)RandU32(&Entropy) << 32) | RandU32(&Entropy);
+        }
+        const joint_mask* UsedMask = (Iteration % 4) ? &Mask : nullptr;
+        f32 Weight = (Iteration % 5) ? RandUnilateral(&Entropy) : 1.0f;
+
+        *Pose = *Dst;
+        *Expected = *Dst;
+        BlendPose(Pose, Src, JointCount, Weight, UsedMask);
+        BlendPoseScalar(Expected, Src, JointCount, Weight, UsedMask);
+        pose_error Error = ComparePoses(Pose, Expected, Dst, JointCount, UsedMask);
+        BlendError.Rotation = Max(BlendError.Rotation, Error.Rotation);
+        BlendError.Vector = Max(BlendError.Vector, Error.Vector);
+        AreMaskedOutJointsKept &= Error.AreMaskedOutJointsKept;
+
+        // NOTE(boti): The source is used as the delta for the additive test, scales are positive
+        *Pose = *Dst;
+        *Expected = *Dst;
+        AddPose(Pose, Src, JointCount, Weight, UsedMask);
+        AddPoseScalar(Expected, Src, JointCount, Weight, UsedMask);
+        Error = ComparePoses(Pose, Expected, Dst, JointCount, UsedMask);
+        AddError.Rotation = Max(AddError.Rotation, Error.Rotation);
+        AddError.Vector = Max(AddError.Vector, Error.Vector);
+        AreMaskedOutJointsKept &= Error.AreMaskedOutJointsKept;
+
+        *Pose = *Dst;
+        BlendPose(Pose, Src, JointCount, 0.0f, UsedMask);
+        AddPose(Pose, Src, JointCount, 0.0f, UsedMask);
+        IsZeroWeightIgnored &= (memcmp(Pose, Dst, sizeof(*Pose)) == 0);
+    }
+    Expect(BlendError.Rotation <= 1e-6f);
+    Expect(BlendError.Vector <= 1e-6f);
+    Expect(AddError.Rotation <= 1e-6f);
+    Expect(AddError.Vector <= 1e-6f);
+    Expect(AreMaskedOutJointsKept);
+    Expect(IsZeroWeightIgnored);
+
+    delete Expected;
+    delete Pose;
+    delete Src;
+    delete Dst;
+}
+
+internal void TestAdditiveSampling()
+{
+    entropy32 Entropy = { 0xADD1u };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, 53, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 91, 3.0f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+    animation* Animation = &Clip->Animation;
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, 56, &Entropy);
+
+    joint_pose* Reference = new joint_pose {};
+    joint_pose* Delta = new joint_pose {};
+    joint_pose* Expected = new joint_pose {};
+    joint_pose* Pose = new joint_pose {};
+
+    // NOTE(boti): The first frame is the identity (exactly for the joints without curves)
+    SampleAnimation(Skin, Animation, 0.0f, true, nullptr, Delta);
+    f32 IdentityError = 0.0f;
+    b32 IsExactIdentity = true;
+    trs_transform Identity = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        trs_transform Transform = GetJointTransform(Delta, JointIndex);
+        IdentityError = Max(IdentityError, GetRotationError(Transform.Rotation, Identity.Rotation));
+        IdentityError = Max(IdentityError, Max(GetVectorError(Transform.Position, Identity.Position), GetVectorError(Transform.Scale, Identity.Scale)));
+        if (JointIndex >= Animation->JointCount || !Motions[JointIndex].HasCurves)
+        {
+            IsExactIdentity &= (memcmp(&Transform, &Identity, sizeof(Transform)) == 0);
+        }
+    }
+    Expect(IdentityError <= 1e-6f);
+    Expect(IsExactIdentity);
+
+    // NOTE(boti): The 8-wide additive sample matches the scalar one, 
+    // and adding it on top of the first frame gives back the regular sample
+    SampleAnimation(Skin, Animation, 0.0f, false, nullptr, Reference);
+    pose_error DeltaError = {};
+    pose_error RoundTripError = {};
+    for (u32 Step = 0; Step < 200; Step++)
+    {
+        f32 Time = RandBetween(&Entropy, 0.0f, Animation->MaxTimestamp);
+        SampleAnimation(Skin, Animation, Time, true, nullptr, Delta);
+        SamplePoseAdditiveScalar(Skin, Animation, Time, Expected);
+        pose_error Error = ComparePoses(Delta, Expected, Expected, Skin->JointCount, nullptr);
+        DeltaError.Rotation = Max(DeltaError.Rotation, Error.Rotation);
+        DeltaError.Vector = Max(DeltaError.Vector, Error.Vector);
+
+        *Pose = *Reference;
+        AddPose(Pose, Delta, Skin->JointCount, 1.0f, nullptr);
+        SampleAnimation(Skin, Animation, Time, false, nullptr, Expected);
+        Error = ComparePoses(Pose, Expected, Expected, Skin->JointCount, nullptr);
+        RoundTripError.Rotation = Max(RoundTripError.Rotation, Error.Rotation);
+        RoundTripError.Vector = Max(RoundTripError.Vector, Error.Vector);
+    }
+    Expect(DeltaError.Rotation <= 1e-6f);
+    Expect(DeltaError.Vector <= 1e-6f);
+    Expect(RoundTripError.Rotation <= 1e-5f);
+    Expect(RoundTripError.Vector <= 1e-5f);
+
+    delete Pose;
+    delete Expected;
+    delete Delta;
+    delete Reference;
+    delete Skin;
+    delete Clip;
+    delete Source;
+}
+
+internal void TestJointMask()
+{
+    entropy32 Entropy = { 0x3A5Cu };
+    std::vector<joint_motion> Motions;
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, 150, &Entropy);
+
+    b32 IsSubtree = true;
+    for (u32 RootJoint = 0; RootJoint < Skin->JointCount + 1; RootJoint++)
+    {
+        joint_mask Mask = MakeJointMask(Skin, RootJoint);
+        for (u32 JointIndex = 0; JointIndex < R_MaxJointCount; JointIndex++)
+        {
+            b32 IsInSubtree = false;
+            if (JointIndex < Skin->JointCount)
+            {
+                for (u32 Joint = JointIndex; ; Joint = Skin->JointParents[Joint])
+                {
+                    if (Joint == RootJoint)
+                    {
+                        IsInSubtree = true;
+                        break;
+                    }
+                    if (Skin->JointParents[Joint] == Joint) break;
+                }
+            }
+            IsSubtree &= (IsJointInMask(&Mask, JointIndex) == IsInSubtree);
+        }
+    }
+    Expect(IsSubtree);
+
+    delete Skin;
+}
+
+// NOTE(boti): Cross-fading base layers with a masked override and a masked additive layer on top,
+// against the same layers evaluated with the scalar reference math
+internal void TestLayeredAnimator()
+{
+    constexpr u32 JointCount = 60;
+    entropy32 Entropy = { 0x1A7Eu };
+    assets* Assets = CreateTestAssets();
+    std::vector<joint_motion> Motions[4];
+    source_clip* Sources[4];
+    test_clip* Clips[4];
+    u32 AnimationIDs[4];
+    for (u32 Index = 0; Index < 4; Index++)
+    {
+        InitJointMotions(Motions[Index], JointCount, &Entropy);
+        Sources[Index] = CreateSourceClip(Motions[Index], 61 + 30 * Index, 2.0f + Index, &Entropy);
+        Clips[Index] = CompressClip(Sources[Index]);
+    }
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions[0], JointCount, &Entropy);
+    u32 SkinID = AddTestSkin(Assets, Skin);
+    for (u32 Index = 0; Index < 4; Index++)
+    {
+        AnimationIDs[Index] = AddTestAnimation(Assets, Clips[Index], SkinID);
+    }
+
+    animator* Animator = new animator;
+    InitAnimator(Animator, SkinID);
+    Animator->IsPlaying = true;
+    PlayAnimation(Animator, AnimationIDs[0], 0.0f);
+    UpdateAnimator(Animator, Assets, 0.3f);
+    PlayAnimation(Animator, AnimationIDs[1], 0.5f);
+
+    joint_mask UpperBody = MakeJointMask(Skin, 5);
+    joint_mask LowerBody = MakeJointMask(Skin, 1);
+    u32 OverrideLayer = AddAnimationLayer(Animator, AnimationIDs[2], AnimationLayer_Override, 0.7f, &UpperBody);
+    u32 AdditiveLayer = AddAnimationLayer(Animator, AnimationIDs[3], AnimationLayer_Additive, 0.0f, &LowerBody);
+    SetAnimationLayerWeight(Animator, AdditiveLayer, 0.6f, 0.4f);
+    Expect(OverrideLayer == 0 && AdditiveLayer == 1);
+
+    m4 Transforms[R_MaxJointCount];
+    m4 ExpectedTransforms[R_MaxJointCount];
+    joint_pose* Pose = new joint_pose {};
+    joint_pose* Sample = new joint_pose {};
+    Animator->Pose = { .JointCount = JointCount, .Transforms = Transforms };
+    f32 Error = 0.0f;
+    b32 WasCrossFading = false;
+    for (u32 Step = 0; Step < 40; Step++)
+    {
+        UpdateAnimator(Animator, Assets, 1.0f / 30.0f);
+        EvaluateAnimator(Animator, Assets);
+        WasCrossFading |= (Animator->BaseLayerCount == 2);
+
+        animation_layer* Base = Animator->BaseLayers;
+        SamplePoseScalar(Skin, Assets->Animations + Base[0].AnimationID, Base[0].Time, Pose);
+        if (Animator->BaseLayerCount == 2)
+        {
+            SamplePoseScalar(Skin, Assets->Animations + Base[1].AnimationID, Base[1].Time, Sample);
+            BlendPoseScalar(Pose, Sample, JointCount, Base[1].Weight, nullptr);
+        }
+        animation_layer* Override = Animator->Layers + OverrideLayer;
+        SamplePoseScalar(Skin, Assets->Animations + Override->AnimationID, Override->Time, Sample);
+        BlendPoseScalar(Pose, Sample, JointCount, Override->Weight, &Override->Mask);
+        animation_layer* Additive = Animator->Layers + AdditiveLayer;
+        SamplePoseAdditiveScalar(Skin, Assets->Animations + Additive->AnimationID, Additive->Time, Sample);
+        AddPoseScalar(Pose, Sample, JointCount, Additive->Weight, &Additive->Mask);
+        GetSkinningTransformsScalar(Skin, Pose, ExpectedTransforms);
+
+        for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+        {
+            Error = Max(Error, GetMatrixError(Transforms[JointIndex], ExpectedTransforms[JointIndex]));
+        }
+    }
+    Expect(Error <= 1e-5f);
+    Expect(WasCrossFading);
+    // NOTE(boti): The old base layer gets dropped once the new one fully faded in
+    Expect(Animator->BaseLayerCount == 1 && Animator->BaseLayers[0].AnimationID == AnimationIDs[1]);
+    Expect(Animator->Layers[AdditiveLayer].Weight == 0.6f);
+
+    delete Sample;
+    delete Pose;
+    delete Animator;
+    DestroyTestAssets(Assets);
+    delete Skin;
+    for (u32 Index = 0; Index < 4; Index++)
+    {
+        delete Clips[Index];
+        delete Sources[Index];
+    }
+}
+
+internal void TestTwoBoneIK()
+{
+    // NOTE(boti): Pelvis, hip, knee, foot and toe
+    skin* Skin = new skin;
+    memset(Skin, 0, sizeof(*Skin));
+    Skin->JointCount = 5;
+    u32 Parents[] = { 0, 0, 1, 2, 3 };
+    v3 Positions[] = { { 0.0f, 1.0f, 0.0f }, { 0.1f, -0.05f, 0.0f }, { 0.0f, -0.45f, 0.02f }, { 0.0f, -0.42f, -0.01f }, { 0.0f, -0.05f, 0.12f } };
+    for (u32 JointIndex = 0; JointIndex < Skin->JointCount; JointIndex++)
+    {
+        Skin->JointParents[JointIndex] = Parents[JointIndex];
+        SetJointTransform(&Skin->BindPose, JointIndex, { { 0.0f, 0.0f, 0.0f, 1.0f }, Positions[JointIndex], { 1.0f, 1.0f, 1.0f } });
+    }
+    ik_chain Chain = { .RootJoint = 1, .MiddleJoint = 2, .EndJoint = 3, .BendHint = { 0.0f, 0.0f, 1.0f } };
+
+    entropy32 Entropy = { 0x1C1Cu };
+    joint_pose* Pose = new joint_pose {};
+    m4 LocalTransforms[R_MaxJointCount];
+    m4 ModelTransforms[R_MaxJointCount];
+    f32 ReachError = 0.0f;
+    f32 LengthError = 0.0f;
+    f32 DirectionError = 0.0f;
+    b32 IsParentKept = true;
+    for (u32 Iteration = 0; Iteration < 1000; Iteration++)
+    {
+        *Pose = Skin->BindPose;
+        for (u32 JointIndex = 1; JointIndex < Skin->JointCount; JointIndex++)
+        {
+            SetJointTransform(Pose, JointIndex, { QuatFromAxisAngle(RandomDirection(&Entropy), RandBetween(&Entropy, 0.0f, 0.6f)), 
+                                                  Positions[JointIndex], { 1.0f, 1.0f, 1.0f } });
+        }
+        GetLocalJointTransforms(Pose, Skin->JointCount, LocalTransforms);
+        GetModelJointTransforms(Skin, LocalTransforms, 0, ModelTransforms);
+
+        v3 A = ModelTransforms[Chain.RootJoint].P.XYZ;
+        f32 LengthAB = VectorLength(ModelTransforms[Chain.MiddleJoint].P.XYZ - A);
+        f32 LengthBC = VectorLength(ModelTransforms[Chain.EndJoint].P.XYZ - ModelTransforms[Chain.MiddleJoint].P.XYZ);
+        f32 LengthCD = VectorLength(ModelTransforms[4].P.XYZ - ModelTransforms[Chain.EndJoint].P.XYZ);
+        m4 Pelvis = ModelTransforms[0];
+
+        f32 Distance = RandBetween(&Entropy, 0.0f, 1.3f) * (LengthAB + LengthBC);
+        v3 Target = A + Distance * RandomDirection(&Entropy);
+        SolveTwoBoneIK(Skin, &Chain, Target, 1.0f, LocalTransforms, ModelTransforms);
+
+        v3 B = ModelTransforms[Chain.MiddleJoint].P.XYZ;
+        v3 C = ModelTransforms[Chain.EndJoint].P.XYZ;
+        v3 D = ModelTransforms[4].P.XYZ;
+        LengthError = Max(LengthError, Abs(VectorLength(B - A) - LengthAB));
+        LengthError = Max(LengthError, Abs(VectorLength(C - B) - LengthBC));
+        LengthError = Max(LengthError, Abs(VectorLength(D - C) - LengthCD));
+        IsParentKept &= (memcmp(&Pelvis, ModelTransforms + 0, sizeof(m4)) == 0);
+        IsParentKept &= (GetVectorError(ModelTransforms[Chain.RootJoint].P.XYZ, A) <= 1e-6f);
+
+        // NOTE(boti): Reachable targets get reached, the rest get pointed at
+        constexpr f32 Margin = 1e-3f;
+        if (Distance > Abs(LengthAB - LengthBC) + Margin && Distance < LengthAB + LengthBC - Margin)
+        {
+            ReachError = Max(ReachError, VectorLength(C - Target));
+        }
+        else if (Distance > LengthAB + LengthBC)
+        {
+            DirectionError = Max(DirectionError, 1.0f - Dot(Normalize(C - A), Normalize(Target - A)));
+        }
+    }
+    Expect(ReachError <= 1e-4f);
+    Expect(LengthError <= 1e-5f);
+    Expect(DirectionError <= 1e-5f);
+    Expect(IsParentKept);
+
+    delete Pose;
+    delete Skin;
+}
+
+//
+// Parallel evaluation
+//
+
+struct work_entry
+{
+    work_procedure* Proc;
+    void* Data;
+};
+
+// NOTE(boti): Same behavior as the Win32 work queue: the workers start on the entries as soon as they're added,
+// CompleteAllWork helps out on the calling thread, then waits for the entries that are still in flight
+struct work_queue
+{
+    std::mutex Mutex;
+    std::condition_variable WorkAvailable;
+    std::vector<work_entry> Entries;
+    u32 ReadAt;
+    u32 CompletionCount;
+    b32 IsStopping;
+    std::vector<std::thread> Workers;
+};
+
+internal void TestAddWorkEntry(work_queue* Queue, work_procedure* Proc, void* Data)
+{
+    std::lock_guard<std::mutex> Lock(Queue->Mutex);
+    Queue->Entries.push_back({ Proc, Data });
+    Queue->WorkAvailable.notify_one();
+}
+
+internal void RunWorkEntry(work_queue* Queue, work_entry Entry, thread_context* ThreadContext)
+{
+    Entry.Proc(ThreadContext, Entry.Data);
+    std::lock_guard<std::mutex> Lock(Queue->Mutex);
+    Queue->CompletionCount++;
+}
+
+internal void TestCompleteAllWork(work_queue* Queue, thread_context* ThreadContext)
+{
+    for (;;)
+    {
+        work_entry Entry = {};
+        {
+            std::lock_guard<std::mutex> Lock(Queue->Mutex);
+            if (Queue->ReadAt < Queue->Entries.size())
+            {
+                Entry = Queue->Entries[Queue->ReadAt++];
+            }
+        }
+
+        if (Entry.Proc)
+        {
+            RunWorkEntry(Queue, Entry, ThreadContext);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    for (;;)
+    {
+        std::lock_guard<std::mutex> Lock(Queue->Mutex);
+        if (Queue->CompletionCount == Queue->Entries.size())
+        {
+            Queue->Entries.clear();
+            Queue->ReadAt = 0;
+            Queue->CompletionCount = 0;
+            break;
+        }
+        std::this_thread::yield();
+    }
+}
+
+internal void TestWorkerThread(work_queue* Queue, u32 ThreadID)
+{
+    thread_context ThreadContext = { ThreadID };
+    for (;;)
+    {
+        work_entry Entry;
+        {
+            std::unique_lock<std::mutex> Lock(Queue->Mutex);
+            Queue->WorkAvailable.wait(Lock, [Queue]() { return Queue->IsStopping || (Queue->ReadAt < Queue->Entries.size()); });
+            if (Queue->IsStopping) break;
+            Entry = Queue->Entries[Queue->ReadAt++];
+        }
+        RunWorkEntry(Queue, Entry, &ThreadContext);
+    }
+}
+
+// NOTE(boti): The calling thread counts too, it's thread 0
+internal work_queue* CreateWorkQueue(u32 ThreadCount)
+{
+    Assert(ThreadCount >= 1 && ThreadCount <= profiler::MaxThreadCount);
+    work_queue* Queue = new work_queue;
+    Queue->ReadAt = 0;
+    Queue->CompletionCount = 0;
+    Queue->IsStopping = false;
+    for (u32 ThreadID = 1; ThreadID < ThreadCount; ThreadID++)
+    {
+        Queue->Workers.emplace_back(TestWorkerThread, Queue, ThreadID);
+    }
+    return(Queue);
+}
+
+internal void DestroyWorkQueue(work_queue* Queue)
+{
+    {
+        std::lock_guard<std::mutex> Lock(Queue->Mutex);
+        Queue->IsStopping = true;
+        Queue->WorkAvailable.notify_all();
+    }
+    for (std::thread& Worker : Queue->Workers)
+    {
+        Worker.join();
+    }
+    delete Queue;
+}
+
+internal void AddTestAnimator(std::vector<animator>& Animators, std::vector<u32>& SharedGroups, 
+                              u32 SkinID, u32 AnimationID, f32 Time, u32 SharedGroup)
+{
+    Animators.emplace_back();
+    animator* Animator = &Animators.back();
+    InitAnimator(Animator, SkinID);
+    PlayAnimation(Animator, AnimationID, 0.0f);
+    Animator->IsPlaying = true;
+    Animator->BaseLayers[0].Time = Time;
+    SharedGroups.push_back(SharedGroup);
+}
+
+// NOTE(boti): The poses have to be bit-identical to evaluating every animator on its own, 
+// no matter how many threads there are and how the animators share the poses
+internal void TestEvaluateAnimators()
+{
+    entropy32 Entropy = { 0x7A11u };
+    assets* Assets = CreateTestAssets();
+
+    // NOTE(boti): Skin 2 has the same joint count as skin 0 and plays its clips
+    constexpr u32 SkinCount = 3;
+    constexpr u32 ClipCount = 4;
+    u32 JointCounts[SkinCount] = { 65, 41, 65 };
+    skin* Skins[SkinCount];
+    u32 SkinIDs[SkinCount];
+    for (u32 SkinIndex = 0; SkinIndex < SkinCount; SkinIndex++)
+    {
+        std::vector<joint_motion> Motions;
+        InitJointMotions(Motions, JointCounts[SkinIndex], &Entropy);
+        Skins[SkinIndex] = new skin;
+        InitTestSkin(Skins[SkinIndex], Motions, JointCounts[SkinIndex], &Entropy);
+    }
+    {
+        skin* Skin = Skins[0];
+        u32 EndJoint = 20;
+        u32 MiddleJoint = Skin->JointParents[EndJoint];
+        u32 RootJoint = Skin->JointParents[MiddleJoint];
+        Assert(RootJoint < MiddleJoint);
+        Skin->IKChains[Skin->IKChainCount++] = { RootJoint, MiddleJoint, EndJoint, { 0.0f, 0.0f, 1.0f } };
+    }
+    for (u32 SkinIndex = 0; SkinIndex < SkinCount; SkinIndex++)
+    {
+        SkinIDs[SkinIndex] = AddTestSkin(Assets, Skins[SkinIndex]);
+    }
+
+    source_clip* Sources[ClipCount];
+    test_clip* Clips[ClipCount];
+    u32 AnimationIDs[ClipCount];
+    for (u32 ClipIndex = 0; ClipIndex < ClipCount; ClipIndex++)
+    {
+        u32 SkinIndex = ClipIndex / 2;
+        std::vector<joint_motion> Motions;
+        InitJointMotions(Motions, JointCounts[SkinIndex], &Entropy);
+        Sources[ClipIndex] = CreateSourceClip(Motions, 61 + 20 * ClipIndex, 2.0f + ClipIndex, &Entropy);
+        Clips[ClipIndex] = CompressClip(Sources[ClipIndex]);
+        AnimationIDs[ClipIndex] = AddTestAnimation(Assets, Clips[ClipIndex], SkinIDs[SkinIndex]);
+    }
+
+    std::vector<animator> Animators;
+    std::vector<u32> SharedGroups; // NOTE(boti): Animators in the same group have to share a pose, U32_MAX means unique
+    u32 SharedGroupCount = 0;
+    for (u32 GroupIndex = 0; GroupIndex < 24; GroupIndex++)
+    {
+        u32 ClipIndex = GroupIndex % ClipCount;
+        u32 SkinID = SkinIDs[ClipIndex / 2];
+        f32 Time = RandBetween(&Entropy, 0.0f, Sources[ClipIndex]->MaxTimestamp);
+        u32 SharedGroup = SharedGroupCount++;
+        for (u32 Index = 0; Index < 1 + (GroupIndex % 7); Index++)
+        {
+            AddTestAnimator(Animators, SharedGroups, SkinID, AnimationIDs[ClipIndex], Time, SharedGroup);
+            if (Index == 1)
+            {
+                // NOTE(boti): Overlays without weight don't change the pose
+                AddAnimationLayer(&Animators.back(), AnimationIDs[ClipIndex ^ 1], AnimationLayer_Additive, 0.0f, nullptr);
+            }
+        }
+
+        // NOTE(boti): Same clip and time, but the pose is different
+        if (ClipIndex < 2)
+        {
+            // NOTE(boti): Different skin
+            AddTestAnimator(Animators, SharedGroups, SkinIDs[2], AnimationIDs[ClipIndex], Time, SharedGroupCount++);
+            AddTestAnimator(Animators, SharedGroups, SkinIDs[2], AnimationIDs[ClipIndex], Time, SharedGroupCount - 1);
+
+            // NOTE(boti): IK
+            AddTestAnimator(Animators, SharedGroups, SkinID, AnimationIDs[ClipIndex], Time, U32_MAX);
+            Animators.back().IKTargets[0] = { 0.1f, 0.5f, 0.2f };
+            Animators.back().IKWeights[0] = 0.8f;
+        }
+        // NOTE(boti): Overlay layer
+        AddTestAnimator(Animators, SharedGroups, SkinID, AnimationIDs[ClipIndex], Time, U32_MAX);
+        joint_mask Mask = MakeJointMask(Skins[ClipIndex / 2], 3);
+        AddAnimationLayer(&Animators.back(), AnimationIDs[ClipIndex ^ 1], AnimationLayer_Override, 0.5f, &Mask);
+        // NOTE(boti): Cross-fade
+        AddTestAnimator(Animators, SharedGroups, SkinID, AnimationIDs[ClipIndex], Time, U32_MAX);
+        PlayAnimation(&Animators.back(), AnimationIDs[ClipIndex ^ 1], 0.5f);
+        UpdateAnimator(&Animators.back(), Assets, 0.2f);
+        // NOTE(boti): Slightly different time
+        AddTestAnimator(Animators, SharedGroups, SkinID, AnimationIDs[ClipIndex], Time + 1e-3f, U32_MAX);
+    }
+
+    // NOTE(boti): Spread the animators that share a pose across the jobs
+    u32 AnimatorCount = (u32)Animators.size();
+    for (u32 Index = AnimatorCount - 1; Index > 0; Index--)
+    {
+        u32 Other = RandU32(&Entropy) % (Index + 1);
+        std::swap(Animators[Index], Animators[Other]);
+        std::swap(SharedGroups[Index], SharedGroups[Other]);
+    }
+
+    // NOTE(boti): Reference, every animator evaluated on its own
+    std::vector<std::vector<m4>> ExpectedPoses(AnimatorCount);
+    for (u32 Index = 0; Index < AnimatorCount; Index++)
+    {
+        animator Animator = Animators[Index];
+        ExpectedPoses[Index].resize(Skins[Animator.SkinID]->JointCount);
+        Animator.Pose = { .JointCount = Skins[Animator.SkinID]->JointCount, .Transforms = ExpectedPoses[Index].data() };
+        EvaluateAnimator(&Animator, Assets);
+    }
+
+    profiler* Profiler = new profiler;
+    BeginProfiler(Profiler);
+    Platform.Profiler = Profiler;
+    Platform.AddWorkEntry = &TestAddWorkEntry;
+    Platform.CompleteAllWork = &TestCompleteAllWork;
+
+    constexpr umm BARSize = MiB(8);
+    std::vector<u8> BARMemory(BARSize);
+    std::vector<u8> FirstBAR;
+    std::vector<animator> FirstAnimators;
+    render_frame* Frame = new render_frame {};
+    Frame->BARBufferBase = BARMemory.data();
+    Frame->BARBufferSize = BARSize;
+    std::vector<u8> ArenaMemory(MiB(1));
+    memory_arena Arena = InitializeArena(ArenaMemory.size(), ArenaMemory.data());
+    thread_context ThreadContext = { 0 };
+
+    b32 IsSameAsReference = true;
+    b32 IsSameAcrossThreadCounts = true;
+    b32 IsSharingCorrect = true;
+    b32 IsArenaRestored = true;
+    u32 ThreadCounts[] = { 1, 2, 3, 4, 8, 16 };
+    for (u32 ThreadCount : ThreadCounts)
+    {
+        Platform.Queue = CreateWorkQueue(ThreadCount);
+        for (u32 Run = 0; Run < 4; Run++)
+        {
+            std::vector<animator> RunAnimators = Animators;
+            std::vector<animator*> AnimatorPointers(AnimatorCount);
+            for (u32 Index = 0; Index < AnimatorCount; Index++)
+            {
+                AnimatorPointers[Index] = &RunAnimators[Index];
+            }
+            memset(BARMemory.data(), 0xCD, BARSize);
+            Frame->BARBufferAt = 0;
+
+            EvaluateAnimators(Assets, Frame, AnimatorCount, AnimatorPointers.data(), &ThreadContext, &Arena);
+            IsArenaRestored &= (Arena.Used == 0);
+
+            for (u32 Index = 0; Index < AnimatorCount; Index++)
+            {
+                renderer_pose* Pose = &RunAnimators[Index].Pose;
+                IsSameAsReference &= (Pose->JointCount == ExpectedPoses[Index].size()) &&
+                    (memcmp(Pose->Transforms, ExpectedPoses[Index].data(), Pose->JointCount * sizeof(m4)) == 0);
+                IsSameAsReference &= (Pose->Transforms == (m4*)OffsetPtr(Frame->BARBufferBase, Pose->BARBufferAt));
+            }
+
+            if (FirstBAR.empty())
+            {
+                FirstBAR.assign(BARMemory.begin(), BARMemory.begin() + Frame->BARBufferAt);
+                FirstAnimators = RunAnimators;
+
+                // NOTE(boti): Every group gets exactly one pose
+                std::vector<umm> GroupPoses(SharedGroupCount, U64_MAX);
+                std::vector<umm> PoseOffsets;
+                u32 ExpectedPoseCount = 0;
+                umm ExpectedBARSize = 0;
+                for (u32 Index = 0; Index < AnimatorCount; Index++)
+                {
+                    renderer_pose* Pose = &RunAnimators[Index].Pose;
+                    u32 Group = SharedGroups[Index];
+                    if (Group == U32_MAX || GroupPoses[Group] == U64_MAX)
+                    {
+                        ExpectedPoseCount++;
+                        ExpectedBARSize += Pose->JointCount * sizeof(m4);
+                        PoseOffsets.push_back(Pose->BARBufferAt);
+                    }
+                    if (Group != U32_MAX)
+                    {
+                        if (GroupPoses[Group] == U64_MAX)
+                        {
+                            GroupPoses[Group] = Pose->BARBufferAt;
+                        }
+                        IsSharingCorrect &= (GroupPoses[Group] == Pose->BARBufferAt);
+                    }
+                }
+                std::sort(PoseOffsets.begin(), PoseOffsets.end());
+                IsSharingCorrect &= (std::unique(PoseOffsets.begin(), PoseOffsets.end()) == PoseOffsets.end());
+                IsSharingCorrect &= (PoseOffsets.size() == ExpectedPoseCount);
+                IsSharingCorrect &= (Frame->BARBufferAt == ExpectedBARSize);
+                IsSharingCorrect &= (ExpectedPoseCount < AnimatorCount);
+            }
+            else
+            {
+                IsSameAcrossThreadCounts &= (Frame->BARBufferAt == FirstBAR.size());
+                IsSameAcrossThreadCounts &= (memcmp(BARMemory.data(), FirstBAR.data(), FirstBAR.size()) == 0);
+                for (u32 Index = 0; Index < AnimatorCount; Index++)
+                {
+                    IsSameAcrossThreadCounts &= (RunAnimators[Index].Pose.BARBufferAt == FirstAnimators[Index].Pose.BARBufferAt);
+                }
+            }
+        }
+        DestroyWorkQueue(Platform.Queue);
+        Platform.Queue = nullptr;
+    }
+    Expect(IsSameAsReference);
+    Expect(IsSameAcrossThreadCounts);
+    Expect(IsSharingCorrect);
+    Expect(IsArenaRestored);
+
+    delete Frame;
+    delete Profiler;
+    DestroyTestAssets(Assets);
+    for (u32 ClipIndex = 0; ClipIndex < ClipCount; ClipIndex++)
+    {
+        delete Clips[ClipIndex];
+        delete Sources[ClipIndex];
+    }
+    for (u32 SkinIndex = 0; SkinIndex < SkinCount; SkinIndex++)
+    {
+        delete Skins[SkinIndex];
+    }
+}
+
+internal void BenchmarkSampling()
+{
+    constexpr u32 JointCount = 65;
+    constexpr u32 CharacterCount = 1000;
+    entropy32 Entropy = { 0xBE4Cu };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, JointCount, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 30 * 8 + 1, 8.0f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, JointCount, &Entropy);
+
+    std::vector<f32> Times(CharacterCount);
+    for (f32& Time : Times)
+    {
+        Time = RandBetween(&Entropy, 0.0f, Source->MaxTimestamp);
+    }
+
+    joint_pose* Pose = new joint_pose;
+    f64 Begin = GetSeconds();
+    f32 Checksum = 0.0f;
+    for (u32 Index = 0; Index < CharacterCount; Index++)
+    {
+        SampleAnimation(Skin, &Clip->Animation, Times[Index], false, nullptr, Pose);
+        Checksum += Pose->Rotation[3][Index % JointCount];
+    }
+    f64 Middle = GetSeconds();
+    for (u32 Index = 0; Index < CharacterCount; Index++)
+    {
+        for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+        {
+            trs_transform Transform = SampleSourceClip(Source, JointIndex, Times[Index]);
+            Checksum += Transform.Rotation.W;
+        }
+    }
+    f64 End = GetSeconds();
+
+    umm DenseSize = (umm)Source->FrameCount * Source->JointCount * sizeof(trs_transform);
+    umm CompressedSize = Clip->Curves.size() * sizeof(animation_curve) + Clip->Keys.size() * sizeof(animation_key);
+    printf("Animation sampling (%u joints, %u frames, %u characters, checksum %f):\n", JointCount, Source->FrameCount, CharacterCount, Checksum);
+    printf("  compressed %8.1fKiB %8.1fns per joint\n", (f64)CompressedSize / 1024.0, 1e9 * (Middle - Begin) / (CharacterCount * JointCount));
+    printf("  dense      %8.1fKiB %8.1fns per joint\n", (f64)DenseSize / 1024.0, 1e9 * (End - Middle) / (CharacterCount * JointCount));
+
+    delete Pose;
+    delete Skin;
+    delete Clip;
+    delete Source;
+}
+
+// NOTE(boti): A crowd playing the same clip at different times, the way UpdateAndRenderWorld evaluates the animators
+internal void BenchmarkCrowd()
+{
+    constexpr u32 JointCount = 65;
+    constexpr u32 CharacterCount = 500;
+    constexpr u32 FrameCount = 120;
+    constexpr f32 dt = 1.0f / 60.0f;
+    entropy32 Entropy = { 0xC40Du };
+    std::vector<joint_motion> Motions;
+    InitJointMotions(Motions, JointCount, &Entropy);
+    source_clip* Source = CreateSourceClip(Motions, 30 * 8 + 1, 8.0f, &Entropy);
+    test_clip* Clip = CompressClip(Source);
+    skin* Skin = new skin;
+    InitTestSkin(Skin, Motions, JointCount, &Entropy);
+
+    assets* Assets = CreateTestAssets();
+    u32 SkinID = AddTestSkin(Assets, Skin);
+    u32 AnimationID = AddTestAnimation(Assets, Clip, SkinID);
+
+    std::vector<animator> Animators(CharacterCount);
+    std::vector<m4> Transforms(CharacterCount * JointCount);
+    for (u32 Index = 0; Index < CharacterCount; Index++)
+    {
+        animator* Animator = &Animators[Index];
+        InitAnimator(Animator, SkinID);
+        PlayAnimation(Animator, AnimationID, 0.0f);
+        Animator->IsPlaying = true;
+        Animator->BaseLayers[0].Time = RandBetween(&Entropy, 0.0f, Source->MaxTimestamp);
+        Animator->Pose = { .JointCount = JointCount, .Transforms = Transforms.data() + Index * JointCount };
+    }
+
+    f64 Begin = GetSeconds();
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        for (animator& Animator : Animators)
+        {
+            UpdateAnimator(&Animator, Assets, dt);
+            EvaluateAnimator(&Animator, Assets);
+        }
+    }
+    f64 Middle = GetSeconds();
+    m4 ModelTransforms[R_MaxJointCount];
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        for (u32 Index = 0; Index < CharacterCount; Index++)
+        {
+            f32 Time = Modulo0(Animators[Index].BaseLayers[0].Time + dt * FrameIndex, Source->MaxTimestamp);
+            m4* Out = Transforms.data() + Index * JointCount;
+            for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+            {
+                m4 Local = TRSToM4(SampleSourceClip(Source, JointIndex, Time));
+                u32 ParentIndex = Skin->JointParents[JointIndex];
+                ModelTransforms[JointIndex] = (ParentIndex == JointIndex) ? Local : ModelTransforms[ParentIndex] * Local;
+                Out[JointIndex] = ModelTransforms[JointIndex] * Skin->InverseBindMatrices[JointIndex];
+            }
+        }
+    }
+    f64 End = GetSeconds();
+
+    printf("Crowd animation (%u characters, %u joints, single thread):\n", CharacterCount, JointCount);
+    printf("  cursors + 8-wide %8.1fus per frame (%6.2fus per character)\n", 1e6 * (Middle - Begin) / FrameCount, 1e6 * (Middle - Begin) / (FrameCount * CharacterCount));
+    printf("  scalar (dense)   %8.1fus per frame (%6.2fus per character)\n", 1e6 * (End - Middle) / FrameCount, 1e6 * (End - Middle) / (FrameCount * CharacterCount));
+
+    DestroyTestAssets(Assets);
+    delete Skin;
+    delete Clip;
+    delete Source;
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestRotationKeys);
+    RunTest(TestVectorKeys);
+    RunTest(TestCurveCompression);
+    RunTest(TestSampleAnimation);
+    RunTest(TestAnimationCursors);
+    RunTest(TestJointTransforms);
+    RunTest(TestEvaluateAnimator);
+    RunTest(TestBlendPose);
+    RunTest(TestAdditiveSampling);
+    RunTest(TestJointMask);
+    RunTest(TestLayeredAnimator);
+    RunTest(TestTwoBoneIK);
+    RunTest(TestEvaluateAnimators);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkSampling();
+        BenchmarkCrowd();
+    }
+    return(EndTests("AnimationTest"));
+}
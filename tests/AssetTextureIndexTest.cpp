@@ -0,0 +1,163 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+#include <AssetTextureIndex.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// NOTE(boti): The renderer IDs of the asset textures, in asset texture order
+struct test_textures
+{
+    asset_texture_index* Index;
+    std::vector<renderer_texture_id> RendererIDs;
+    std::vector<renderer_texture_id> ForeignIDs; // NOTE(boti): Renderer textures the assets don't own
+};
+
+// NOTE(boti): How ProcessTextureRequests found the asset texture of a request before the reverse index.
+// This is the best case for the scan, the asset textures are a lot larger than their renderer IDs.
+internal u32 FindAssetTextureIndex(test_textures* Textures, renderer_texture_id ID)
+{
+    u32 Result = U32_MAX;
+    for (u32 TextureIndex = 0; TextureIndex < (u32)Textures->RendererIDs.size(); TextureIndex++)
+    {
+        if (Textures->RendererIDs[TextureIndex].Value == ID.Value)
+        {
+            Result = TextureIndex;
+            break;
+        }
+    }
+    return(Result);
+}
+
+// NOTE(boti): Registers the textures the way InitializeAssets and AllocateAssetTexture do,
+// with the renderer IDs interleaved with textures the assets don't own (e.g. render targets and debug textures)
+internal test_textures* CreateTestTextures(u32 TextureCount, entropy32* Entropy)
+{
+    test_textures* Textures = new test_textures;
+    Textures->Index = new asset_texture_index;
+    InitAssetTextureIndex(Textures->Index);
+
+    u32 NextRendererID = 1;
+    for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+    {
+        while ((RandU32(Entropy) % 16) == 0)
+        {
+            Textures->ForeignIDs.push_back({ NextRendererID++ });
+        }
+
+        renderer_texture_id ID = { NextRendererID++ };
+        Textures->RendererIDs.push_back(ID);
+        SetAssetTextureIndex(Textures->Index, ID, TextureIndex);
+    }
+    return(Textures);
+}
+
+internal void DestroyTestTextures(test_textures* Textures)
+{
+    delete Textures->Index;
+    delete Textures;
+}
+
+internal void TestAssetTextureIndex()
+{
+    constexpr u32 TextureCount = 100000;
+    entropy32 Entropy = { 0xA55E7u };
+    test_textures* Textures = CreateTestTextures(TextureCount, &Entropy);
+    asset_texture_index* Index = Textures->Index;
+    Expect(!Textures->ForeignIDs.empty());
+
+    b32 IsSameAsScan = true;
+    for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+    {
+        renderer_texture_id ID = Textures->RendererIDs[TextureIndex];
+        u32 Found = GetAssetTextureIndex(Index, ID, TextureCount);
+        IsSameAsScan &= (Found == TextureIndex);
+        // NOTE(boti): The scan is slow, only some of the textures are checked against it
+        if ((TextureIndex % 97) == 0)
+        {
+            IsSameAsScan &= (Found == FindAssetTextureIndex(Textures, ID));
+        }
+    }
+    Expect(IsSameAsScan);
+
+    // NOTE(boti): Textures the assets don't own, the null texture and out of range IDs don't map to anything
+    b32 AreForeignIDsUnmapped = true;
+    for (renderer_texture_id ID : Textures->ForeignIDs)
+    {
+        AreForeignIDsUnmapped &= (GetAssetTextureIndex(Index, ID, TextureCount) == U32_MAX);
+    }
+    Expect(AreForeignIDsUnmapped);
+    Expect(GetAssetTextureIndex(Index, { 0 }, TextureCount) == U32_MAX);
+    Expect(GetAssetTextureIndex(Index, { R_MaxTextureCount - 1 }, TextureCount) == U32_MAX);
+    Expect(GetAssetTextureIndex(Index, { R_MaxTextureCount }, TextureCount) == U32_MAX);
+    Expect(GetAssetTextureIndex(Index, { U32_MAX }, TextureCount) == U32_MAX);
+
+    // NOTE(boti): Entries past the asset texture count are ignored
+    renderer_texture_id LastID = Textures->RendererIDs.back();
+    Expect(GetAssetTextureIndex(Index, LastID, TextureCount) == TextureCount - 1);
+    Expect(GetAssetTextureIndex(Index, LastID, TextureCount - 1) == U32_MAX);
+
+    DestroyTestTextures(Textures);
+}
+
+internal void BenchmarkAssetTextureIndex()
+{
+    constexpr u32 TextureCount = 100000;
+    constexpr u32 RequestCount = 4096;
+    constexpr u32 FrameCount = 16;
+    entropy32 Entropy = { 0xB3AC4u };
+    test_textures* Textures = CreateTestTextures(TextureCount, &Entropy);
+
+    // NOTE(boti): Requests come in renderer ID order (the feedback is processed in texture order),
+    // and every frame requests a different set of textures
+    std::vector<renderer_texture_id> Requests(RequestCount);
+    std::vector<u32> Found(RequestCount), ScanFound(RequestCount);
+    std::vector<f64> Times, ScanTimes;
+    b32 IsSameAsScan = true;
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        for (renderer_texture_id& ID : Requests)
+        {
+            ID = Textures->RendererIDs[RandU32(&Entropy) % TextureCount];
+        }
+        std::sort(Requests.begin(), Requests.end(), [](renderer_texture_id A, renderer_texture_id B) { return A.Value < B.Value; });
+
+        f64 Begin = GetSeconds();
+        for (u32 RequestIndex = 0; RequestIndex < RequestCount; RequestIndex++)
+        {
+            Found[RequestIndex] = GetAssetTextureIndex(Textures->Index, Requests[RequestIndex], TextureCount);
+        }
+        f64 Middle = GetSeconds();
+        for (u32 RequestIndex = 0; RequestIndex < RequestCount; RequestIndex++)
+        {
+            ScanFound[RequestIndex] = FindAssetTextureIndex(Textures, Requests[RequestIndex]);
+        }
+        f64 End = GetSeconds();
+
+        IsSameAsScan &= (Found == ScanFound);
+        Times.push_back(Middle - Begin);
+        ScanTimes.push_back(End - Middle);
+    }
+    Expect(IsSameAsScan);
+
+    std::sort(Times.begin(), Times.end());
+    std::sort(ScanTimes.begin(), ScanTimes.end());
+    f64 Time = Times[FrameCount / 2];
+    f64 ScanTime = ScanTimes[FrameCount / 2];
+    printf("Asset texture lookup (%u textures, %u requests per frame, median of %u frames):\n", TextureCount, RequestCount, FrameCount);
+    printf("  reverse index %10.1fus per frame (%8.1fns per request)\n", 1e6 * Time, 1e9 * Time / RequestCount);
+    printf("  linear scan   %10.1fus per frame (%8.1fns per request)\n", 1e6 * ScanTime, 1e9 * ScanTime / RequestCount);
+
+    DestroyTestTextures(Textures);
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestAssetTextureIndex);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkAssetTextureIndex();
+    }
+    return(EndTests("AssetTextureIndexTest"));
+}
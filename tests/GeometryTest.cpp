@@ -0,0 +1,402 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+#include <Renderer/GeometryAllocator.hpp>
+
+#include <Renderer/GeometryAllocator.cpp>
+
+#include <algorithm>
+#include <vector>
+
+// NOTE(boti): Same as AllocateSubBuffer(), with the GPU allocations only existing in the bookkeeping
+internal geometry_buffer_block* AllocateBlock(geometry_allocator* Allocator, u32 Count, geometry_buffer_block*& BlockPool)
+{
+    geometry_buffer_block* Result = nullptr;
+    geometry_buffer_block* FreeBlock = FindFreeBlock(Allocator, Count);
+    while (!FreeBlock && (Allocator->AllocationCount < Allocator->MaxGPUAllocationCount))
+    {
+        AddGeometryAllocatorBlock(Allocator, BlockPool);
+        FreeBlock = FindFreeBlock(Allocator, Count);
+    }
+
+    if (FreeBlock)
+    {
+        Result = AllocateFromFreeBlock(Allocator, FreeBlock, Count, BlockPool);
+    }
+    return(Result);
+}
+
+struct free_stats
+{
+    u64 FreeCount;
+    u64 LargestFreeCount;
+    u32 FreeBlockCount;
+};
+
+internal free_stats GetFreeStats(geometry_allocator* Allocator)
+{
+    free_stats Result = {};
+    for (u32 GPUBlockIndex = 0; GPUBlockIndex < Allocator->AllocationCount; GPUBlockIndex++)
+    {
+        for (geometry_buffer_block* Block = Allocator->FirstBlocks[GPUBlockIndex]; Block; Block = Block->NextPhysical)
+        {
+            if (Block->State == GeometryBlock_Free)
+            {
+                Result.FreeCount += Block->Count;
+                Result.LargestFreeCount = Max(Result.LargestFreeCount, (u64)Block->Count);
+                Result.FreeBlockCount++;
+            }
+        }
+    }
+    return(Result);
+}
+
+// NOTE(boti): 0 if the largest free block is as large as it could be (free blocks can't span GPU allocations),
+// approaching 1 as the free space gets split into many small blocks
+internal f64 GetFragmentation(geometry_allocator* Allocator, free_stats Stats)
+{
+    u64 MaxLargestFreeCount = Min(Stats.FreeCount, (u64)GetGPUBlockElementCount(Allocator, 0));
+    f64 Result = (MaxLargestFreeCount > 0) ? 1.0 - (f64)Stats.LargestFreeCount / (f64)MaxLargestFreeCount : 0.0;
+    return(Result);
+}
+
+// NOTE(boti): Log-uniform sizes, mostly small meshes with the occasional large one
+internal u32 GetRandomCount(entropy32* Entropy, u32 MaxCount)
+{
+    f32 Log2Count = RandBetween(Entropy, 0.0f, Log2((f32)MaxCount));
+    u32 Result = Max((u32)Exp2(Log2Count), 1u);
+    return(Result);
+}
+
+struct geometry_trace_state
+{
+    geometry_allocator Allocator;
+    geometry_buffer_block* BlockPool;
+    std::vector<geometry_buffer_block> Blocks;
+
+    std::vector<geometry_buffer_block*> Live;
+    // NOTE(boti): What's been written to each live block, keyed by the (stable) block descriptor
+    std::vector<u32> ExpectedOffsets;
+};
+
+internal void InitTraceState(geometry_trace_state* State, u32 Stride, u32 MaxBlockCount)
+{
+    State->Allocator = {};
+    State->Allocator.Stride = Stride;
+    State->Blocks.resize(MaxBlockCount);
+    State->BlockPool = InitGeometryBlockPool(State->Blocks.data(), MaxBlockCount);
+    State->ExpectedOffsets.assign(MaxBlockCount, U32_MAX);
+}
+
+internal u32 GetBlockIndex(geometry_trace_state* State, geometry_buffer_block* Block)
+{
+    u32 Result = (u32)(Block - State->Blocks.data());
+    return(Result);
+}
+
+// NOTE(boti): Live and pending blocks can't overlap, and neither can cross GPU allocation boundaries
+internal b32 CheckNoOverlap(geometry_trace_state* State)
+{
+    struct range { u64 Begin, End; };
+    std::vector<range> Ranges;
+    geometry_allocator* Allocator = &State->Allocator;
+    for (u32 GPUBlockIndex = 0; GPUBlockIndex < Allocator->AllocationCount; GPUBlockIndex++)
+    {
+        for (geometry_buffer_block* Block = Allocator->FirstBlocks[GPUBlockIndex]; Block; Block = Block->NextPhysical)
+        {
+            if (Block->State != GeometryBlock_Free)
+            {
+                Ranges.push_back({ (u64)Block->Offset * Allocator->Stride, (u64)(Block->Offset + Block->Count) * Allocator->Stride });
+            }
+        }
+    }
+    std::sort(Ranges.begin(), Ranges.end(), [](const range& A, const range& B) { return A.Begin < B.Begin; });
+
+    b32 Result = true;
+    for (size_t Index = 0; Index < Ranges.size(); Index++)
+    {
+        Result &= (Ranges[Index].Begin / geometry_allocator::GPUBlockSize) == ((Ranges[Index].End - 1) / geometry_allocator::GPUBlockSize);
+        if (Index > 0)
+        {
+            Result &= (Ranges[Index - 1].End <= Ranges[Index].Begin);
+        }
+    }
+    return(Result);
+}
+
+// NOTE(boti): Replays a random alloc/free trace the way the renderer drives the allocator:
+// frees are deferred by the frames in flight, and every frame ends with a defragmentation pass.
+// The integrity of the allocator is verified after every operation.
+internal void TestGeometryTraceReplay(u32 Stride, u32 MaxCount, u32 TargetLiveCount, u32 Seed)
+{
+    geometry_trace_state* State = new geometry_trace_state;
+    InitTraceState(State, Stride, 1u << 16);
+    geometry_allocator* Allocator = &State->Allocator;
+
+    entropy32 Entropy = { Seed };
+    constexpr u32 FrameCount = 400;
+    constexpr u32 OpsPerFrame = 50;
+
+    b32 IsIntact = true;
+    b32 AreMovesValid = true;
+    b32 IsDisjoint = true;
+    u32 TotalMoveCount = 0;
+    f64 FragmentationBeforeDefrag = 0.0;
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        u32 FrameID = FrameIndex % R_MaxFramesInFlight;
+
+        // NOTE(boti): The frame that used the same ID last time has finished
+        ReleasePendingBlocks(Allocator, FrameID, State->BlockPool);
+        IsIntact &= VerifyMemoryIntegrity(Allocator);
+
+        for (u32 OpIndex = 0; OpIndex < OpsPerFrame; OpIndex++)
+        {
+            // NOTE(boti): Random walk around the target live count, with bursts of frees
+            u32 LiveCount = (u32)State->Live.size();
+            b32 ShouldAllocate = (LiveCount == 0) || ((RandU32(&Entropy) % (2 * TargetLiveCount)) > LiveCount);
+            if ((FrameIndex % 50) >= 45)
+            {
+                ShouldAllocate = false;
+            }
+
+            if (ShouldAllocate)
+            {
+                u32 Count = GetRandomCount(&Entropy, MaxCount);
+                geometry_buffer_block* Block = AllocateBlock(Allocator, Count, State->BlockPool);
+                if (Block)
+                {
+                    Expect((Block->Count == Count) && (Block->State == GeometryBlock_Allocated));
+                    State->Live.push_back(Block);
+                    State->ExpectedOffsets[GetBlockIndex(State, Block)] = Block->Offset;
+                }
+            }
+            else if (LiveCount > 0)
+            {
+                u32 Index = RandU32(&Entropy) % LiveCount;
+                geometry_buffer_block* Block = State->Live[Index];
+                State->Live[Index] = State->Live.back();
+                State->Live.pop_back();
+                State->ExpectedOffsets[GetBlockIndex(State, Block)] = U32_MAX;
+                PushPendingFree(Allocator, Block, FrameID);
+            }
+            IsIntact &= VerifyMemoryIntegrity(Allocator);
+        }
+
+        FragmentationBeforeDefrag = GetFragmentation(Allocator, GetFreeStats(Allocator));
+        IsDisjoint &= CheckNoOverlap(State);
+
+        // NOTE(boti): Every move has to start where the block's data was, and end where the block is now
+        geometry_move Moves[geometry_allocator::DefragMaxVisitCount];
+        u32 DefragGeneration = FrameIndex + 1;
+        u32 MoveCount = DefragmentGeometryAllocator(Allocator, DefragGeneration, FrameID, State->BlockPool, Moves);
+        IsIntact &= VerifyMemoryIntegrity(Allocator);
+        IsDisjoint &= CheckNoOverlap(State);
+        TotalMoveCount += MoveCount;
+
+        umm MovedByteCount = 0;
+        for (u32 MoveIndex = 0; MoveIndex < MoveCount; MoveIndex++)
+        {
+            geometry_move* Move = Moves + MoveIndex;
+            AreMovesValid &= (Move->DstByteOffset < Move->SrcByteOffset);
+            AreMovesValid &= ((Move->SrcByteOffset % geometry_allocator::GPUBlockSize) + Move->ByteCount) <= geometry_allocator::GPUBlockSize;
+            AreMovesValid &= ((Move->DstByteOffset % geometry_allocator::GPUBlockSize) + Move->ByteCount) <= geometry_allocator::GPUBlockSize;
+            MovedByteCount += Move->ByteCount;
+
+            geometry_buffer_block* Moved = nullptr;
+            for (geometry_buffer_block* Block : State->Live)
+            {
+                if ((umm)State->ExpectedOffsets[GetBlockIndex(State, Block)] * Stride == Move->SrcByteOffset)
+                {
+                    Moved = Block;
+                }
+            }
+            AreMovesValid &= (Moved != nullptr);
+            if (Moved)
+            {
+                AreMovesValid &= ((umm)Moved->Count * Stride == Move->ByteCount);
+                State->ExpectedOffsets[GetBlockIndex(State, Moved)] = (u32)(Move->DstByteOffset / Stride);
+            }
+        }
+        // NOTE(boti): The budget can only be exceeded by the last move
+        AreMovesValid &= (MoveCount == 0) || (MovedByteCount - Moves[MoveCount - 1].ByteCount < geometry_allocator::DefragByteBudget);
+
+        // NOTE(boti): Live blocks are where the moves put them, and only the moved ones have the new generation
+        for (geometry_buffer_block* Block : State->Live)
+        {
+            AreMovesValid &= (Block->State == GeometryBlock_Allocated);
+            AreMovesValid &= (State->ExpectedOffsets[GetBlockIndex(State, Block)] == Block->Offset);
+        }
+    }
+    Expect(IsIntact);
+    Expect(AreMovesValid);
+    Expect(IsDisjoint);
+    Expect(TotalMoveCount > 0);
+
+    // NOTE(boti): Freeing everything merges all the space back into one block per GPU allocation
+    u32 LiveCountAtEnd = (u32)State->Live.size();
+    for (geometry_buffer_block* Block : State->Live)
+    {
+        PushPendingFree(Allocator, Block, 0);
+    }
+    for (u32 FrameID = 0; FrameID < R_MaxFramesInFlight; FrameID++)
+    {
+        ReleasePendingBlocks(Allocator, FrameID, State->BlockPool);
+    }
+    Expect(VerifyMemoryIntegrity(Allocator));
+    free_stats Stats = GetFreeStats(Allocator);
+    Expect(Stats.FreeBlockCount == Allocator->AllocationCount);
+    Expect(Stats.FreeCount == Allocator->MaxCount);
+    Expect((Allocator->CountInUse == 0) && (Allocator->BlocksInUse == 0));
+
+    printf("  stride %u: %u GPU blocks, %u live at the end, %u moves, fragmentation before the last defrag: %.3f\n",
+           Stride, Allocator->AllocationCount, LiveCountAtEnd, TotalMoveCount, FragmentationBeforeDefrag);
+    delete State;
+}
+
+internal void TestGeometryTraces()
+{
+    TestGeometryTraceReplay(sizeof(vertex), 1u << 20, 300, 0x1111u);
+    TestGeometryTraceReplay(sizeof(vert_index), 1u << 24, 300, 0x2222u);
+    // NOTE(boti): Small allocations only, lots of blocks per GPU allocation
+    TestGeometryTraceReplay(sizeof(vertex), 64, 2000, 0x3333u);
+}
+
+internal void TestGeometrySizeClasses()
+{
+    // NOTE(boti): Every block in a list is at least the lower bound of the list,
+    // and FindFreeBlock() never returns a block that's too small
+    b32 IsMonotonic = true;
+    u32 PrevFL = 0, PrevSL = 0;
+    for (u32 Count = 1; Count < (1u << 20); Count++)
+    {
+        u32 FL, SL;
+        GetGeometrySizeClass(Count, &FL, &SL);
+        IsMonotonic &= (FL > PrevFL) || ((FL == PrevFL) && (SL >= PrevSL));
+        IsMonotonic &= (FL < geometry_allocator::FLCount) && (SL < geometry_allocator::SLCount);
+        PrevFL = FL;
+        PrevSL = SL;
+    }
+    Expect(IsMonotonic);
+
+    geometry_trace_state* State = new geometry_trace_state;
+    InitTraceState(State, 4, 1024);
+    geometry_allocator* Allocator = &State->Allocator;
+    AddGeometryAllocatorBlock(Allocator, State->BlockPool);
+
+    // NOTE(boti): Carve out free blocks of every size between used ones
+    std::vector<geometry_buffer_block*> Separators, Holes;
+    u32 HoleSizes[] = { 1, 15, 16, 17, 31, 33, 100, 1000, 1023, 1025, 4096, 5000 };
+    for (u32 Index = 0; Index < CountOf(HoleSizes); Index++)
+    {
+        Holes.push_back(AllocateBlock(Allocator, HoleSizes[Index], State->BlockPool));
+        Separators.push_back(AllocateBlock(Allocator, 1, State->BlockPool));
+    }
+    for (geometry_buffer_block* Hole : Holes)
+    {
+        PushPendingFree(Allocator, Hole, 0);
+    }
+    ReleasePendingBlocks(Allocator, 0, State->BlockPool);
+    Expect(VerifyMemoryIntegrity(Allocator));
+
+    b32 IsLargeEnough = true;
+    for (u32 Count = 1; Count <= 6000; Count++)
+    {
+        geometry_buffer_block* Block = FindFreeBlock(Allocator, Count);
+        IsLargeEnough &= (Block != nullptr) && (Block->Count >= Count);
+    }
+    Expect(IsLargeEnough);
+    delete State;
+}
+
+internal void BenchmarkGeometryAllocator(b32 IsDefragEnabled)
+{
+    geometry_trace_state* State = new geometry_trace_state;
+    InitTraceState(State, sizeof(vertex), 1u << 18);
+    geometry_allocator* Allocator = &State->Allocator;
+
+    entropy32 Entropy = { 0xBEEFu };
+    constexpr u32 FrameCount = 2000;
+    constexpr u32 OpsPerFrame = 500;
+    constexpr u32 TargetLiveCount = 8000;
+
+    std::vector<f64> AllocTimes, FreeTimes, DefragTimes;
+    f64 FragmentationSum = 0.0;
+    f64 MaxFragmentation = 0.0;
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        u32 FrameID = FrameIndex % R_MaxFramesInFlight;
+        f64 ReleaseBegin = GetSeconds();
+        ReleasePendingBlocks(Allocator, FrameID, State->BlockPool);
+        FreeTimes.push_back(GetSeconds() - ReleaseBegin);
+
+        for (u32 OpIndex = 0; OpIndex < OpsPerFrame; OpIndex++)
+        {
+            u32 LiveCount = (u32)State->Live.size();
+            if ((LiveCount == 0) || ((RandU32(&Entropy) % (2 * TargetLiveCount)) > LiveCount))
+            {
+                u32 Count = GetRandomCount(&Entropy, 1u << 14);
+                f64 Begin = GetSeconds();
+                geometry_buffer_block* Block = AllocateBlock(Allocator, Count, State->BlockPool);
+                AllocTimes.push_back(GetSeconds() - Begin);
+                if (Block)
+                {
+                    State->Live.push_back(Block);
+                }
+            }
+            else
+            {
+                u32 Index = RandU32(&Entropy) % LiveCount;
+                geometry_buffer_block* Block = State->Live[Index];
+                State->Live[Index] = State->Live.back();
+                State->Live.pop_back();
+                PushPendingFree(Allocator, Block, FrameID);
+            }
+        }
+
+        if (IsDefragEnabled)
+        {
+            geometry_move Moves[geometry_allocator::DefragMaxVisitCount];
+            f64 DefragBegin = GetSeconds();
+            DefragmentGeometryAllocator(Allocator, FrameIndex + 1, FrameID, State->BlockPool, Moves);
+            DefragTimes.push_back(GetSeconds() - DefragBegin);
+        }
+
+        f64 Fragmentation = GetFragmentation(Allocator, GetFreeStats(Allocator));
+        FragmentationSum += Fragmentation;
+        MaxFragmentation = Max(MaxFragmentation, Fragmentation);
+    }
+
+    auto Report = [](const char* Name, std::vector<f64>& Times)
+    {
+        std::sort(Times.begin(), Times.end());
+        f64 Sum = 0.0;
+        for (f64 Time : Times) Sum += Time;
+        printf("  %-24s mean %8.1fns, p50 %8.1fns, p99 %8.1fns, max %8.1fns\n", Name,
+               1e9 * Sum / (f64)Times.size(), 1e9 * Times[Times.size() / 2],
+               1e9 * Times[(Times.size() * 99) / 100], 1e9 * Times.back());
+    };
+    printf("Geometry allocator, defrag %s (%u frames, %u ops/frame, ~%u live blocks, %u GPU blocks):\n",
+           IsDefragEnabled ? "on" : "off", FrameCount, OpsPerFrame, TargetLiveCount, Allocator->AllocationCount);
+    Report("Allocate", AllocTimes);
+    Report("ReleasePendingBlocks", FreeTimes);
+    if (IsDefragEnabled)
+    {
+        Report("Defragment", DefragTimes);
+    }
+    printf("  fragmentation at the end of the frame: mean %.3f, max %.3f, %.1f%% of the space in use\n",
+           FragmentationSum / FrameCount, MaxFragmentation, 100.0 * (f64)Allocator->CountInUse / (f64)Allocator->MaxCount);
+    delete State;
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestGeometrySizeClasses);
+    RunTest(TestGeometryTraces);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkGeometryAllocator(false);
+        BenchmarkGeometryAllocator(true);
+    }
+    return(EndTests("GeometryTest"));
+}
@@ -0,0 +1,630 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// NOTE(boti): A render_frame with the command streams and the staging/BAR buffers set up the way BeginRenderFrame leaves them,
+// every stream has a few guard elements past its cap that must never get written
+struct frame_test_state
+{
+    static constexpr u32 GuardCount = 4;
+    static constexpr u8 GuardByte = 0xCC;
+
+    render_frame Frame;
+    std::vector<u8> StagingMemory;
+    std::vector<u8> BARMemory;
+
+    struct stream
+    {
+        std::vector<u8> Memory;
+        umm ByteCount; // NOTE(boti): Up to the guard
+    };
+    std::vector<stream> Streams;
+};
+
+template<typename type>
+internal type* AllocateStream(frame_test_state* State, u32 MaxCount)
+{
+    frame_test_state::stream Stream;
+    Stream.ByteCount = MaxCount * sizeof(type);
+    Stream.Memory.resize(Stream.ByteCount + frame_test_state::GuardCount * sizeof(type), frame_test_state::GuardByte);
+    State->Streams.push_back(std::move(Stream));
+    type* Result = (type*)State->Streams.back().Memory.data();
+    return(Result);
+}
+
+internal frame_test_state* CreateFrameTestState(umm StagingSize, umm BARSize = MiB(1))
+{
+    frame_test_state* State = new frame_test_state;
+    State->Frame = {};
+    State->StagingMemory.resize(StagingSize);
+    State->BARMemory.resize(BARSize);
+    State->Streams.reserve(16);
+
+    render_frame* Frame = &State->Frame;
+    Frame->StagingBuffer = { StagingSize, 0, State->StagingMemory.data() };
+    Frame->BARBufferSize = BARSize;
+    Frame->BARBufferBase = State->BARMemory.data();
+    Frame->Transfers        = AllocateStream<transfer_command>(State, Frame->MaxTransferCount);
+    Frame->Draws            = AllocateStream<draw_command>(State, Frame->MaxDrawCount);
+    Frame->InstanceUpdates  = AllocateStream<update_instance_cmd>(State, Frame->MaxInstanceUpdateCount);
+    Frame->InstanceFrees    = AllocateStream<renderer_instance_id>(State, Frame->MaxInstanceFreeCount);
+    Frame->GeometryFrees    = AllocateStream<geometry_buffer_allocation>(State, Frame->MaxGeometryFreeCount);
+    Frame->Lights           = AllocateStream<light>(State, Frame->MaxLightCount);
+    Frame->ParticleBatches  = AllocateStream<particle_batch>(State, Frame->MaxParticleBatchCount);
+    Frame->Widget3Ds        = AllocateStream<draw_widget3d_cmd>(State, Frame->MaxWidget3DCount);
+    Frame->Batch2Ds         = AllocateStream<draw_batch_2d>(State, Frame->MaxBatch2DCount);
+    return(State);
+}
+
+internal void ResetFrame(frame_test_state* State)
+{
+    render_frame* Frame = &State->Frame;
+    Frame->StagingBuffer.At = 0;
+    Frame->UploadByteCount = 0;
+    Frame->BARBufferAt = 0;
+    Frame->TransferCount = 0;
+    Frame->DrawCount = 0;
+    Frame->InstanceUpdateCount = 0;
+    Frame->InstanceFreeCount = 0;
+    Frame->GeometryFreeCount = 0;
+    Frame->LightCount = 0;
+    Frame->ParticleBatchCount = 0;
+    Frame->Widget3DCount = 0;
+    Frame->Batch2DCount = 0;
+    for (u32 GroupIndex = 0; GroupIndex < DrawGroup_Count; GroupIndex++)
+    {
+        Frame->DrawGroupDrawCounts[GroupIndex] = 0;
+    }
+    Frame->ShadowCount = 0;
+}
+
+internal b32 AreGuardsIntact(frame_test_state* State)
+{
+    b32 Result = true;
+    for (frame_test_state::stream& Stream : State->Streams)
+    {
+        for (umm At = Stream.ByteCount; At < Stream.Memory.size(); At++)
+        {
+            Result &= (Stream.Memory[At] == frame_test_state::GuardByte);
+        }
+    }
+    return(Result);
+}
+
+internal texture_info MakeTextureInfo(u32 Log2Extent, u32 MipCount)
+{
+    texture_info Result =
+    {
+        .Extent = { 1u << Log2Extent, 1u << Log2Extent, 1 },
+        .MipCount = MipCount,
+        .ArrayCount = 1,
+        .Format = Format_R8G8B8A8_SRGB,
+    };
+    return(Result);
+}
+
+internal umm GetTextureByteCount(texture_info Info)
+{
+    umm Result = GetMipChainSize(Info.Extent.X, Info.Extent.Y, Info.MipCount, Info.ArrayCount, FormatInfoTable[Info.Format]);
+    return(Result);
+}
+
+internal void TestUploadBudget()
+{
+    // NOTE(boti): 1024x1024 RGBA8 with the full chain is a little over 4MiB
+    texture_info Info = MakeTextureInfo(10, 11);
+    umm ByteCount = GetTextureByteCount(Info);
+    std::vector<u8> Data(ByteCount, 0xCD);
+
+    frame_test_state* State = CreateFrameTestState(MiB(64));
+    render_frame* Frame = &State->Frame;
+    Expect(GetUploadBudget(Frame) == R_MaxUploadBytesPerFrame);
+    Expect(CanUpload(Frame, R_MaxUploadBytesPerFrame));
+
+    // NOTE(boti): Uploads come out of the budget until it runs out
+    u32 UploadCount = 0;
+    while (CanUpload(Frame, ByteCount))
+    {
+        umm BudgetBefore = GetUploadBudget(Frame);
+        Expect(TransferTexture(Frame, { UploadCount + 1 }, Info, AllTextureSubresourceRange(), Data.data()));
+        Expect(GetUploadBudget(Frame) <= BudgetBefore - ByteCount);
+        UploadCount++;
+    }
+    Expect(UploadCount == R_MaxUploadBytesPerFrame / ByteCount);
+    Expect(Frame->UploadByteCount == UploadCount * ByteCount);
+    Expect(Frame->UploadByteCount <= R_MaxUploadBytesPerFrame);
+    Expect(GetUploadBudget(Frame) < ByteCount);
+    // NOTE(boti): Smaller uploads can still go through
+    Expect(CanUpload(Frame, GetUploadBudget(Frame)));
+
+    // NOTE(boti): The budget is reset with the frame
+    ResetFrame(State);
+    Expect(GetUploadBudget(Frame) == R_MaxUploadBytesPerFrame);
+
+    // NOTE(boti): Staging memory used by other things (e.g. the light and draw data) limits the budget too,
+    // with room left for the alignment of the upload
+    Frame->StagingBuffer.At = MiB(64) - MiB(3) + 1;
+    Expect(GetUploadBudget(Frame) == MiB(3) - 64);
+    Expect(CanUpload(Frame, MiB(3) - 64));
+    Expect(!CanUpload(Frame, MiB(3) - 63));
+    Frame->StagingBuffer.At = MiB(64);
+    Expect(GetUploadBudget(Frame) == 0);
+    Expect(!CanUpload(Frame, 1));
+
+    // NOTE(boti): Going over the budget some other way (e.g. geometry uploads) doesn't wrap around
+    ResetFrame(State);
+    Frame->UploadByteCount = R_MaxUploadBytesPerFrame + 1;
+    Expect(GetUploadBudget(Frame) == 0);
+    Expect(!CanUpload(Frame, 1));
+
+    delete State;
+}
+
+internal void TestCanUploadFirstUpload()
+{
+    // NOTE(boti): 4096x4096 RGBA8 is 64MiB for the top mip alone, twice the budget
+    texture_info Info = MakeTextureInfo(12, 1);
+    umm ByteCount = GetTextureByteCount(Info);
+    Expect(ByteCount > R_MaxUploadBytesPerFrame);
+    std::vector<u8> Data(ByteCount, 0xAB);
+
+    frame_test_state* State = CreateFrameTestState(MiB(80));
+    render_frame* Frame = &State->Frame;
+
+    // NOTE(boti): The first upload of the frame goes through even when it's larger than the budget...
+    Expect(CanUpload(Frame, ByteCount));
+    Expect(TransferTexture(Frame, { 1 }, Info, AllTextureSubresourceRange(), Data.data()));
+    // NOTE(boti): ...but nothing else after it
+    Expect(!CanUpload(Frame, ByteCount));
+    Expect(!CanUpload(Frame, 1));
+
+    // NOTE(boti): The first upload still has to fit into the staging buffer
+    ResetFrame(State);
+    Frame->StagingBuffer.At = MiB(20);
+    Expect(!CanUpload(Frame, ByteCount));
+    Frame->StagingBuffer.At = MiB(16);
+    Expect(CanUpload(Frame, ByteCount));
+    Frame->StagingBuffer.At = MiB(16) + 1;
+    Expect(!CanUpload(Frame, ByteCount));
+
+    delete State;
+}
+
+// NOTE(boti): Streams a queue of textures the same way ProcessTextureRequests does:
+// in queue order, stopping at the first texture that can't be uploaded in the frame,
+// and falling back to the less detailed part of the chain when the whole one doesn't fit.
+internal void TestUploadStream()
+{
+    constexpr u32 TextureCount = 400;
+    entropy32 Entropy = { 0x5EEDu };
+
+    struct streamed_texture
+    {
+        texture_info Info;
+        u32 BaseMip; // NOTE(boti): The most detailed mip uploaded so far, MipCount when nothing is
+    };
+    std::vector<streamed_texture> Textures(TextureCount);
+    umm MaxByteCount = 0;
+    umm TotalByteCount = 0;
+    for (streamed_texture& Texture : Textures)
+    {
+        // NOTE(boti): Mostly small and medium textures with the occasional huge one
+        u32 Log2Extent = ((RandU32(&Entropy) % 16) == 0) ? 12 : 6 + RandU32(&Entropy) % 6;
+        Texture.Info = MakeTextureInfo(Log2Extent, Log2Extent + 1);
+        Texture.BaseMip = Texture.Info.MipCount;
+        MaxByteCount = Max(MaxByteCount, GetTextureByteCount(Texture.Info));
+        TotalByteCount += GetTextureByteCount(Texture.Info);
+    }
+    std::vector<u8> Data(MaxByteCount);
+    for (umm Index = 0; Index < MaxByteCount; Index++)
+    {
+        Data[Index] = (u8)(Index * 31);
+    }
+
+    frame_test_state* State = CreateFrameTestState(MiB(96));
+    render_frame* Frame = &State->Frame;
+
+    u32 FrameCount = 0;
+    u32 NextTextureIndex = 0;
+    u32 PartialUploadCount = 0;
+    b32 IsEveryFrameInBudget = true;
+    b32 IsEveryFrameMakingProgress = true;
+    b32 IsEveryTransferValid = true;
+    while ((NextTextureIndex < TextureCount) && (FrameCount < 10000))
+    {
+        ResetFrame(State);
+        // NOTE(boti): Some of the staging memory is already taken by the time the game streams textures
+        Frame->StagingBuffer.At = RandU32(&Entropy) % MiB(4);
+        FrameCount++;
+
+        u32 UploadCount = 0;
+        while (NextTextureIndex < TextureCount)
+        {
+            streamed_texture* Texture = &Textures[NextTextureIndex];
+            texture_info Info = Texture->Info;
+
+            u32 BaseMip = 0;
+            umm ByteCount = 0;
+            for (;;)
+            {
+                u32 Extent = Max(Info.Extent.X >> BaseMip, 1u);
+                ByteCount = GetMipChainSize(Extent, Extent, Info.MipCount - BaseMip, 1, FormatInfoTable[Info.Format]);
+                if ((BaseMip + 1 >= Texture->BaseMip) || CanUpload(Frame, ByteCount))
+                {
+                    break;
+                }
+                BaseMip++;
+            }
+
+            if (CanUpload(Frame, ByteCount))
+            {
+                u32 Extent = Max(Info.Extent.X >> BaseMip, 1u);
+                texture_info CopyInfo = MakeTextureInfo(0, Info.MipCount - BaseMip);
+                CopyInfo.Extent = { Extent, Extent, 1 };
+                umm StagingAtBefore = Frame->StagingBuffer.At;
+                IsEveryTransferValid &= TransferTexture(Frame, { NextTextureIndex + 1 }, CopyInfo, AllTextureSubresourceRange(), Data.data());
+
+                // NOTE(boti): The upload has to land aligned after everything else in the staging buffer, with the data intact
+                transfer_command* Command = Frame->Transfers + Frame->TransferCount - 1;
+                IsEveryTransferValid &= (Command->StagingBufferSize == ByteCount);
+                IsEveryTransferValid &= (Command->StagingBufferAt >= StagingAtBefore) && ((Command->StagingBufferAt % 64) == 0);
+                IsEveryTransferValid &= (Command->StagingBufferAt + ByteCount <= Frame->StagingBuffer.Size);
+                IsEveryTransferValid &= (memcmp(OffsetPtr(Frame->StagingBuffer.Base, Command->StagingBufferAt), Data.data(), ByteCount) == 0);
+
+                UploadCount++;
+                Texture->BaseMip = BaseMip;
+                if (BaseMip == 0)
+                {
+                    NextTextureIndex++;
+                }
+                else
+                {
+                    PartialUploadCount++;
+                    break;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        IsEveryFrameInBudget &= (Frame->UploadByteCount <= R_MaxUploadBytesPerFrame) || (UploadCount == 1);
+        IsEveryFrameMakingProgress &= (UploadCount > 0);
+    }
+
+    Expect(NextTextureIndex == TextureCount);
+    Expect(IsEveryTransferValid);
+    Expect(IsEveryFrameInBudget);
+    Expect(IsEveryFrameMakingProgress);
+    Expect(PartialUploadCount > 0);
+    // NOTE(boti): The stream shouldn't leave much of the budget unused
+    // (the huge textures can go over it, they're the first upload of their frame)
+    u32 BudgetFrameCount = (u32)CeilDiv(TotalByteCount, R_MaxUploadBytesPerFrame);
+    Expect(FrameCount <= 2 * BudgetFrameCount);
+    printf("  %u textures (%.1f MiB) streamed in %u frames (%u at the full budget), %u partial uploads\n",
+           TextureCount, (f64)TotalByteCount / (f64)MiB(1), FrameCount, BudgetFrameCount, PartialUploadCount);
+
+    delete State;
+}
+
+internal void TestStreamCaps()
+{
+    // NOTE(boti): Enough BAR memory for the 2D and particle batches to run into their caps first (16KiB each)
+    frame_test_state* State = CreateFrameTestState(MiB(8), MiB(96));
+    render_frame* Frame = &State->Frame;
+
+    geometry_buffer_block VertexBlock = { .Count = 24, .Offset = 0 };
+    geometry_buffer_block IndexBlock = { .Count = 36, .Offset = 0 };
+    geometry_buffer_allocation Allocation = { &VertexBlock, &IndexBlock };
+    mmbox Box = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+    renderer_material Material = {};
+    constexpr u32 ExtraCount = 100;
+
+    // NOTE(boti): Every stream takes exactly its cap, and rejects everything past it without writing anything
+    {
+        renderer_pose Pose = AllocatePose(Frame, 64);
+        Expect(Pose.Transforms != nullptr);
+
+        b32 AreAllAccepted = true;
+        u32 RejectedCount = 0;
+        for (u32 DrawIndex = 0; DrawIndex < render_frame::MaxDrawCount + ExtraCount; DrawIndex++)
+        {
+            draw_group Group = DrawIndex % DrawGroup_Count;
+            m4 Transform = Identity4();
+            Transform.P.X = (f32)DrawIndex;
+            b32 IsAccepted = (DrawIndex % 8) ?
+                DrawMesh(Frame, Group, Allocation, Transform, Box, Material, 0, nullptr) :
+                DrawSkinnedMesh(Frame, Group, Allocation, Transform, Box, Material, Pose);
+            if (DrawIndex < render_frame::MaxDrawCount)
+            {
+                AreAllAccepted &= IsAccepted;
+            }
+            else
+            {
+                RejectedCount += !IsAccepted;
+            }
+        }
+        Expect(AreAllAccepted);
+        Expect(RejectedCount == ExtraCount);
+        Expect(Frame->DrawCount == render_frame::MaxDrawCount);
+        Expect(Frame->DrawGroupDrawCounts[0] + Frame->DrawGroupDrawCounts[1] + Frame->DrawGroupDrawCounts[2] == render_frame::MaxDrawCount);
+        Expect(Frame->Draws[render_frame::MaxDrawCount - 1].Transform.P.X == (f32)(render_frame::MaxDrawCount - 1));
+
+        // NOTE(boti): Skinned draws with their own pose don't take any BAR memory when they're rejected
+        umm BARAt = Frame->BARBufferAt;
+        m4 Joints[4] = {};
+        Expect(!DrawMesh(Frame, DrawGroup_Opaque, Allocation, Identity4(), Box, Material, 4, Joints));
+        Expect(Frame->BARBufferAt == BARAt);
+    }
+
+    {
+        u32 AcceptedCount = 0;
+        for (u32 Index = 0; Index < render_frame::MaxInstanceUpdateCount + ExtraCount; Index++)
+        {
+            AcceptedCount += UpdateInstance(Frame, { Index + 1 }, DrawGroup_Opaque, Allocation, Identity4(), Box, Material);
+        }
+        Expect(AcceptedCount == render_frame::MaxInstanceUpdateCount);
+        Expect(Frame->InstanceUpdateCount == render_frame::MaxInstanceUpdateCount);
+        Expect(Frame->InstanceUpdates[render_frame::MaxInstanceUpdateCount - 1].ID.Value == render_frame::MaxInstanceUpdateCount);
+
+        AcceptedCount = 0;
+        for (u32 Index = 0; Index < render_frame::MaxInstanceFreeCount + ExtraCount; Index++)
+        {
+            AcceptedCount += FreeInstance(Frame, { Index + 1 });
+        }
+        Expect(AcceptedCount == render_frame::MaxInstanceFreeCount);
+        Expect(Frame->InstanceFreeCount == render_frame::MaxInstanceFreeCount);
+
+        AcceptedCount = 0;
+        for (u32 Index = 0; Index < render_frame::MaxGeometryFreeCount + ExtraCount; Index++)
+        {
+            AcceptedCount += FreeGeometry(Frame, Allocation);
+        }
+        Expect(AcceptedCount == render_frame::MaxGeometryFreeCount);
+        Expect(Frame->GeometryFreeCount == render_frame::MaxGeometryFreeCount);
+
+        AcceptedCount = 0;
+        for (u32 Index = 0; Index < render_frame::MaxWidget3DCount + ExtraCount; Index++)
+        {
+            AcceptedCount += DrawWidget3D(Frame, Allocation, Identity4(), PackRGBA8(255, 0, 0));
+        }
+        Expect(AcceptedCount == render_frame::MaxWidget3DCount);
+        Expect(Frame->Widget3DCount == render_frame::MaxWidget3DCount);
+
+        // NOTE(boti): Rejected lights don't get a shadow either
+        AcceptedCount = 0;
+        for (u32 Index = 0; Index < render_frame::MaxLightCount + ExtraCount; Index++)
+        {
+            AcceptedCount += AddLight(Frame, { (f32)Index, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, LightFlag_ShadowCaster);
+        }
+        Expect(AcceptedCount == render_frame::MaxLightCount);
+        Expect(Frame->LightCount == render_frame::MaxLightCount);
+        Expect(Frame->ShadowCount == render_frame::MaxLightCount);
+    }
+
+    // NOTE(boti): The 2D batches only get a new element when the vertices don't fit into the last one and it can't be stretched,
+    // each list here fills most of a 16KiB batch, and the particle batches in between keep the 2D ones from stretching
+    {
+        ResetFrame(State);
+        static vertex_2d Vertices[816] = {};
+        u32 AcceptedCount = 0;
+        u32 BatchCount = 0;
+        for (u32 Index = 0; Index < render_frame::MaxBatch2DCount + ExtraCount; Index++)
+        {
+            AcceptedCount += DrawTriangleList2D(Frame, CountOf(Vertices), Vertices);
+            BatchCount += (MakeParticleBatch(Frame, 1) != nullptr);
+        }
+        Expect(AcceptedCount == render_frame::MaxBatch2DCount);
+        Expect(Frame->Batch2DCount == render_frame::MaxBatch2DCount);
+        Expect(BatchCount == render_frame::MaxBatch2DCount + ExtraCount);
+
+        particle_batch* Batch = nullptr;
+        for (u32 Index = BatchCount; Index < render_frame::MaxParticleBatchCount; Index++)
+        {
+            Batch = MakeParticleBatch(Frame, 1);
+        }
+        Expect(Batch != nullptr);
+        Expect(MakeParticleBatch(Frame, 1) == nullptr);
+
+        // NOTE(boti): A full batch can't continue in a new one once the stream is full
+        render_particle Particle = {};
+        u32 PushCount = 0;
+        while (Batch && (PushCount < 2 * Batch->MaxCount))
+        {
+            Batch = PushParticle(Frame, Batch, Particle);
+            PushCount += (Batch != nullptr);
+        }
+        Expect(Batch == nullptr);
+        Expect(Frame->ParticleBatchCount == render_frame::MaxParticleBatchCount);
+    }
+
+    // NOTE(boti): Going past MaxTransferCount is an UnhandledError, the transfers are only checked up to the cap
+    {
+        geometry_buffer_block SmallVertexBlock = { .Count = 1, .Offset = 0 };
+        geometry_buffer_allocation SmallAllocation = { &SmallVertexBlock, nullptr };
+        vertex Vertex = {};
+        b32 AreAllAccepted = true;
+        for (u32 Index = 0; Index < render_frame::MaxTransferCount; Index++)
+        {
+            AreAllAccepted &= TransferGeometry(Frame, SmallAllocation, &Vertex, &Vertex);
+        }
+        Expect(AreAllAccepted);
+        Expect(Frame->TransferCount == render_frame::MaxTransferCount);
+    }
+
+    Expect(AreGuardsIntact(State));
+    delete State;
+}
+
+// NOTE(boti): The part of ProcessDraws in EndRenderFrame that doesn't touch Vulkan:
+// the draws get scattered into their groups, with the skinned ones pointing at their pose in the BAR buffer
+struct replayed_draw
+{
+    u32 IndexCount;
+    u32 FirstIndex;
+    u64 VertexBufferAddress;
+    renderer_material Material;
+};
+
+internal u64 ReplayDraws(render_frame* Frame, mmbox* BoundingBoxes, m4* Transforms, replayed_draw* Draws)
+{
+    u64 Result = 0;
+
+    u32 DrawGroupOffsets[DrawGroup_Count] = {};
+    for (u32 GroupIndex = 1; GroupIndex < DrawGroup_Count; GroupIndex++)
+    {
+        DrawGroupOffsets[GroupIndex] = DrawGroupOffsets[GroupIndex - 1] + Frame->DrawGroupDrawCounts[GroupIndex - 1];
+    }
+
+    for (u32 DrawIndex = 0; DrawIndex < Frame->DrawCount; DrawIndex++)
+    {
+        draw_command* Draw = Frame->Draws + DrawIndex;
+
+        u32 ID = DrawGroupOffsets[Draw->Group]++;
+        BoundingBoxes[ID] = Draw->BoundingBox;
+        Transforms[ID] = Draw->Transform;
+        u64 VertexBufferAddress = Draw->Geometry.VertexBlock->Offset * sizeof(vertex);
+        if (Draw->Flags & Draw_Skinned)
+        {
+            // NOTE(boti): Stands in for the skinning dispatch, which reads the pose from the BAR buffer
+            Result += Draw->PoseBARBufferAt;
+        }
+        Draws[ID] =
+        {
+            .IndexCount = Draw->Geometry.IndexBlock->Count,
+            .FirstIndex = Draw->Geometry.IndexBlock->Offset,
+            .VertexBufferAddress = VertexBufferAddress,
+            .Material = Draw->Material,
+        };
+    }
+    return(Result);
+}
+
+internal void BenchmarkDrawStream()
+{
+    constexpr u32 DrawCount = 100000;
+    constexpr u32 MeshCount = 512;
+    constexpr u32 PoseCount = 64;
+    constexpr u32 JointCount = 64;
+    constexpr u32 FrameCount = 32;
+
+    frame_test_state* State = CreateFrameTestState(MiB(1), MiB(64));
+    render_frame* Frame = &State->Frame;
+
+    entropy32 Entropy = { 0xD4A3u };
+    std::vector<geometry_buffer_block> Blocks(2 * MeshCount);
+    for (u32 MeshIndex = 0; MeshIndex < MeshCount; MeshIndex++)
+    {
+        Blocks[2 * MeshIndex + 0] = { .Count = 1000 + RandU32(&Entropy) % 10000, .Offset = RandU32(&Entropy) % (1u << 24) };
+        Blocks[2 * MeshIndex + 1] = { .Count = 3000 + RandU32(&Entropy) % 30000, .Offset = RandU32(&Entropy) % (1u << 26) };
+    }
+    struct scene_object
+    {
+        u32 MeshIndex;
+        draw_group Group;
+        b32 IsSkinned;
+        m4 Transform;
+        mmbox Box;
+        renderer_material Material;
+    };
+    std::vector<scene_object> Objects(DrawCount);
+    for (u32 ObjectIndex = 0; ObjectIndex < DrawCount; ObjectIndex++)
+    {
+        scene_object* Object = &Objects[ObjectIndex];
+        Object->MeshIndex = RandU32(&Entropy) % MeshCount;
+        Object->Group = (RandU32(&Entropy) % 8 == 0) ? DrawGroup_AlphaTest : DrawGroup_Opaque;
+        Object->IsSkinned = (RandU32(&Entropy) % 32) == 0;
+        Object->Transform = Identity4();
+        Object->Transform.P = { (f32)(ObjectIndex % 317), (f32)(ObjectIndex / 317), 0.0f, 1.0f };
+        Object->Box = { { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 2.0f } };
+        Object->Material = {};
+        Object->Material.AlbedoID = { ObjectIndex % 4096 };
+    }
+
+    std::vector<mmbox> BoundingBoxes(DrawCount);
+    std::vector<m4> Transforms(DrawCount);
+    std::vector<replayed_draw> ReplayedDraws(DrawCount);
+    std::vector<f64> RecordTimes, ReplayTimes;
+    u64 Checksum = 0;
+    for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        ResetFrame(State);
+
+        f64 RecordBegin = GetSeconds();
+        // NOTE(boti): Every skinned draw shares one of the poses (e.g. crowds of the same animation)
+        renderer_pose Poses[PoseCount];
+        for (u32 PoseIndex = 0; PoseIndex < PoseCount; PoseIndex++)
+        {
+            Poses[PoseIndex] = AllocatePose(Frame, JointCount);
+            for (u32 JointIndex = 0; JointIndex < JointCount; JointIndex++)
+            {
+                Poses[PoseIndex].Transforms[JointIndex] = Identity4();
+            }
+        }
+        u32 RecordedCount = 0;
+        for (u32 ObjectIndex = 0; ObjectIndex < DrawCount; ObjectIndex++)
+        {
+            scene_object* Object = &Objects[ObjectIndex];
+            geometry_buffer_allocation Allocation = { &Blocks[2 * Object->MeshIndex + 0], &Blocks[2 * Object->MeshIndex + 1] };
+            if (Object->IsSkinned)
+            {
+                RecordedCount += DrawSkinnedMesh(Frame, Object->Group, Allocation, Object->Transform, Object->Box, Object->Material,
+                                                 Poses[ObjectIndex % PoseCount]);
+            }
+            else
+            {
+                RecordedCount += DrawMesh(Frame, Object->Group, Allocation, Object->Transform, Object->Box, Object->Material, 0, nullptr);
+            }
+        }
+        f64 RecordEnd = GetSeconds();
+        Expect(RecordedCount == DrawCount);
+
+        Checksum += ReplayDraws(Frame, BoundingBoxes.data(), Transforms.data(), ReplayedDraws.data());
+        f64 ReplayEnd = GetSeconds();
+
+        RecordTimes.push_back(RecordEnd - RecordBegin);
+        ReplayTimes.push_back(ReplayEnd - RecordEnd);
+    }
+
+    // NOTE(boti): The opaque draws come first, in submission order
+    b32 IsReplayInOrder = true;
+    u32 OpaqueIndex = 0;
+    for (u32 ObjectIndex = 0; ObjectIndex < DrawCount; ObjectIndex++)
+    {
+        if (Objects[ObjectIndex].Group == DrawGroup_Opaque)
+        {
+            IsReplayInOrder &= (Transforms[OpaqueIndex++].P.X == Objects[ObjectIndex].Transform.P.X);
+        }
+    }
+    Expect(IsReplayInOrder);
+    Expect(OpaqueIndex == Frame->DrawGroupDrawCounts[DrawGroup_Opaque]);
+    Expect(Checksum != 0);
+
+    std::sort(RecordTimes.begin(), RecordTimes.end());
+    std::sort(ReplayTimes.begin(), ReplayTimes.end());
+    f64 RecordTime = RecordTimes[RecordTimes.size() / 2];
+    f64 ReplayTime = ReplayTimes[ReplayTimes.size() / 2];
+    printf("Draw stream (%u draws, %u shared poses, %u frames, median):\n", DrawCount, PoseCount, FrameCount);
+    printf("  record %8.1fus (%5.1fns per draw), replay %8.1fus (%5.1fns per draw), %zu bytes per draw, %.1f MiB of BAR\n",
+           1e6 * RecordTime, 1e9 * RecordTime / DrawCount, 1e6 * ReplayTime, 1e9 * ReplayTime / DrawCount,
+           sizeof(draw_command), (f64)Frame->BARBufferAt / (f64)MiB(1));
+
+    delete State;
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestUploadBudget);
+    RunTest(TestCanUploadFirstUpload);
+    RunTest(TestUploadStream);
+    RunTest(TestStreamCaps);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkDrawStream();
+    }
+    return(EndTests("RenderFrameTest"));
+}
@@ -0,0 +1,382 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+#include <Renderer/ShadowAtlas.hpp>
+#include <Renderer/ShadowCache.hpp>
+
+#include <Renderer/ShadowAtlas.cpp>
+#include <Renderer/ShadowCache.cpp>
+
+#include <vector>
+
+// NOTE(boti): Occupancy of the atlas at the granularity of the smallest tiles, used to check for overlaps
+struct atlas_occupancy
+{
+    static constexpr u32 Size = shadow_atlas::Resolution / shadow_atlas::MinTileSize;
+    u32 Owners[Size][Size];
+};
+
+internal b32 MarkTile(atlas_occupancy* Occupancy, u32 Node, u32 Owner)
+{
+    shadow_atlas_tile Tile = GetShadowAtlasTile(Node);
+    b32 Result = ((Tile.X + Tile.Size) <= shadow_atlas::Resolution) && ((Tile.Y + Tile.Size) <= shadow_atlas::Resolution);
+    for (u32 Y = Tile.Y / shadow_atlas::MinTileSize; Result && (Y < (Tile.Y + Tile.Size) / shadow_atlas::MinTileSize); Y++)
+    {
+        for (u32 X = Tile.X / shadow_atlas::MinTileSize; X < (Tile.X + Tile.Size) / shadow_atlas::MinTileSize; X++)
+        {
+            Result &= (Occupancy->Owners[Y][X] == 0) || (Owner == 0);
+            Occupancy->Owners[Y][X] = Owner;
+        }
+    }
+    return(Result);
+}
+
+internal void TestAtlasSiblingMerge()
+{
+    shadow_atlas Atlas = {};
+
+    // NOTE(boti): The 4 tiles end up in the same quadrant, since split nodes are tried first
+    u32 Nodes[4];
+    for (u32 Index = 0; Index < 4; Index++)
+    {
+        Nodes[Index] = AllocateShadowAtlasTile(&Atlas, 1024);
+        Expect(Nodes[Index] != shadow_atlas::InvalidNode);
+        Expect(GetShadowAtlasTile(Nodes[Index]).Size == 1024);
+        Expect(GetShadowAtlasLevel(Nodes[Index]) == 2);
+        Expect((Nodes[Index] - 1) / 4 == (Nodes[0] - 1) / 4);
+    }
+    Expect(Atlas.AllocatedTexelCount == 4 * 1024 * 1024);
+
+    u32 Parent = (Nodes[0] - 1) / 4;
+    Expect(Atlas.NodeStates[Parent] == AtlasNode_Split);
+    Expect(Atlas.NodeStates[0] == AtlasNode_Split);
+
+    // NOTE(boti): The parent only gets merged once the last sibling is freed
+    for (u32 Index = 0; Index < 3; Index++)
+    {
+        FreeShadowAtlasTile(&Atlas, Nodes[Index]);
+        Expect(Atlas.NodeStates[Nodes[Index]] == AtlasNode_Free);
+        Expect(Atlas.NodeStates[Parent] == AtlasNode_Split);
+    }
+    FreeShadowAtlasTile(&Atlas, Nodes[3]);
+    Expect(Atlas.NodeStates[Parent] == AtlasNode_Free);
+    Expect(Atlas.NodeStates[0] == AtlasNode_Free);
+    Expect(Atlas.AllocatedTexelCount == 0);
+
+    // NOTE(boti): Merging all the way up means that the largest tiles are available again
+    for (u32 Index = 0; Index < 4; Index++)
+    {
+        Expect(AllocateShadowAtlasTile(&Atlas, shadow_atlas::Resolution / 2) != shadow_atlas::InvalidNode);
+    }
+    Expect(AllocateShadowAtlasTile(&Atlas, shadow_atlas::MinTileSize) == shadow_atlas::InvalidNode);
+
+    // NOTE(boti): Deep merge: a single small tile keeps its whole chain split, freeing it frees the chain
+    Atlas = {};
+    u32 Small = AllocateShadowAtlasTile(&Atlas, shadow_atlas::MinTileSize);
+    Expect(GetShadowAtlasLevel(Small) == shadow_atlas::LevelCount - 1);
+    FreeShadowAtlasTile(&Atlas, Small);
+    b32 IsAllFree = true;
+    for (u32 Node = 0; Node < shadow_atlas::NodeCount; Node++)
+    {
+        IsAllFree &= (Atlas.NodeStates[Node] == AtlasNode_Free);
+    }
+    Expect(IsAllFree);
+}
+
+internal void TestAtlasFillToCapacity()
+{
+    u32 Sizes[] = { 64, 128, 256, 512, 1024, 2048 };
+    for (u32 SizeIndex = 0; SizeIndex < CountOf(Sizes); SizeIndex++)
+    {
+        u32 Size = Sizes[SizeIndex];
+        u32 Capacity = (shadow_atlas::Resolution / Size) * (shadow_atlas::Resolution / Size);
+
+        shadow_atlas Atlas = {};
+        atlas_occupancy* Occupancy = new atlas_occupancy{};
+        std::vector<u32> Nodes;
+        b32 IsDisjoint = true;
+        for (u32 Index = 0; Index < Capacity; Index++)
+        {
+            u32 Node = AllocateShadowAtlasTile(&Atlas, Size);
+            Expect(Node != shadow_atlas::InvalidNode);
+            IsDisjoint &= MarkTile(Occupancy, Node, Index + 1);
+            Nodes.push_back(Node);
+        }
+        Expect(IsDisjoint);
+        Expect(Atlas.AllocatedTexelCount == shadow_atlas::Resolution * shadow_atlas::Resolution);
+
+        // NOTE(boti): Full, nothing fits anymore
+        Expect(AllocateShadowAtlasTile(&Atlas, Size) == shadow_atlas::InvalidNode);
+        Expect(AllocateShadowAtlasTile(&Atlas, shadow_atlas::MinTileSize) == shadow_atlas::InvalidNode);
+
+        // NOTE(boti): A single free tile only fits tiles up to its own size
+        FreeShadowAtlasTile(&Atlas, Nodes[Capacity / 2]);
+        if (Size < shadow_atlas::Resolution / 2)
+        {
+            Expect(AllocateShadowAtlasTile(&Atlas, 2 * Size) == shadow_atlas::InvalidNode);
+        }
+        u32 Node = AllocateShadowAtlasTile(&Atlas, Size);
+        Expect(Node == Nodes[Capacity / 2]);
+        delete Occupancy;
+    }
+}
+
+internal void TestAtlasRandom()
+{
+    entropy32 Entropy = { 0x1337u };
+    shadow_atlas Atlas = {};
+    atlas_occupancy* Occupancy = new atlas_occupancy{};
+
+    std::vector<u32> Nodes;
+    u32 ExpectedTexelCount = 0;
+    b32 IsConsistent = true;
+    for (u32 Iteration = 0; Iteration < 20000; Iteration++)
+    {
+        if (Nodes.empty() || (RandU32(&Entropy) % 3) != 0)
+        {
+            u32 Size = shadow_atlas::MinTileSize << (RandU32(&Entropy) % 5);
+            u32 Node = AllocateShadowAtlasTile(&Atlas, Size);
+            if (Node != shadow_atlas::InvalidNode)
+            {
+                IsConsistent &= (GetShadowAtlasTile(Node).Size == Size);
+                IsConsistent &= MarkTile(Occupancy, Node, 1);
+                ExpectedTexelCount += Size * Size;
+                Nodes.push_back(Node);
+            }
+        }
+        else
+        {
+            u32 Index = RandU32(&Entropy) % (u32)Nodes.size();
+            u32 Node = Nodes[Index];
+            Nodes[Index] = Nodes.back();
+            Nodes.pop_back();
+
+            u32 Size = GetShadowAtlasTile(Node).Size;
+            FreeShadowAtlasTile(&Atlas, Node);
+            MarkTile(Occupancy, Node, 0);
+            ExpectedTexelCount -= Size * Size;
+        }
+        IsConsistent &= (Atlas.AllocatedTexelCount == ExpectedTexelCount);
+    }
+    Expect(IsConsistent);
+
+    for (u32 Node : Nodes)
+    {
+        FreeShadowAtlasTile(&Atlas, Node);
+    }
+    Expect(Atlas.AllocatedTexelCount == 0);
+    Expect(Atlas.NodeStates[0] == AtlasNode_Free);
+    delete Occupancy;
+}
+
+internal u32 AcquireAndAllocate(point_shadow_cache* Cache, f32 X, const u32* FaceSizes)
+{
+    u32 Result = AcquirePointShadow(Cache, { X, 0.0f, 0.0f }, 1.0f);
+    if ((Result != U32_MAX) && !AllocatePointShadowTiles(Cache, Result, FaceSizes))
+    {
+        Result = U32_MAX;
+    }
+    return(Result);
+}
+
+internal u32 AcquireAndAllocate(point_shadow_cache* Cache, f32 X, u32 Size)
+{
+    u32 FaceSizes[CubeLayer_Count];
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        FaceSizes[Face] = Size;
+    }
+    u32 Result = AcquireAndAllocate(Cache, X, FaceSizes);
+    return(Result);
+}
+
+internal u32 GetFaceSize(point_shadow_cache* Cache, u32 Slot, u32 Face)
+{
+    u32 Node = Cache->Entries[Slot].AtlasNodes[Face];
+    u32 Result = (Node != shadow_atlas::InvalidNode) ? GetShadowAtlasTile(Node).Size : 0;
+    return(Result);
+}
+
+internal b32 HasTiles(point_shadow_cache* Cache, u32 Slot)
+{
+    b32 Result = false;
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        Result |= (Cache->Entries[Slot].AtlasNodes[Face] != shadow_atlas::InvalidNode);
+    }
+    return(Result);
+}
+
+internal void TestPointShadowEviction()
+{
+    point_shadow_cache* Cache = new point_shadow_cache{};
+
+    // NOTE(boti): 2 lights with 1024 faces fill 3/4 of the atlas, the 3rd one evicts the least recently used one
+    u32 Slots[4];
+    for (u32 Index = 0; Index < 3; Index++)
+    {
+        BeginPointShadowCacheFrame(Cache);
+        Slots[Index] = AcquireAndAllocate(Cache, (f32)Index, 1024);
+        Expect(Slots[Index] != U32_MAX);
+        UpdatePointShadow(Cache, Slots[Index], true, false);
+    }
+    Expect(!HasTiles(Cache, Slots[0]) && !Cache->Entries[Slots[0]].IsStaticValid);
+    Expect(HasTiles(Cache, Slots[1]) && Cache->Entries[Slots[1]].IsStaticValid);
+    Expect(HasTiles(Cache, Slots[2]));
+
+    // NOTE(boti): Lights acquired in the current frame are never evicted, even if they're older
+    BeginPointShadowCacheFrame(Cache);
+    Expect(AcquireAndAllocate(Cache, 1.0f, 1024) == Slots[1]);
+    Slots[3] = AcquireAndAllocate(Cache, 3.0f, 1024);
+    Expect(Slots[3] != U32_MAX);
+    Expect(HasTiles(Cache, Slots[1]) && Cache->Entries[Slots[1]].IsStaticValid);
+    Expect(!HasTiles(Cache, Slots[2]));
+
+    // NOTE(boti): Nothing left to evict and no room: the light doesn't get a shadow, and doesn't keep any tiles
+    u32 TexelCount = Cache->Atlas.AllocatedTexelCount;
+    u32 Failed = AcquireAndAllocate(Cache, 4.0f, 1024);
+    Expect(Failed == U32_MAX);
+    Expect(Cache->Atlas.AllocatedTexelCount == TexelCount);
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        if (Cache->Entries[Slot].P.X == 4.0f)
+        {
+            Expect(!Cache->IsAcquired[Slot] && !HasTiles(Cache, Slot));
+        }
+    }
+    delete Cache;
+
+    // NOTE(boti): When there's nothing to evict, the faces get downsized to whatever fits
+    Cache = new point_shadow_cache{};
+    BeginPointShadowCacheFrame(Cache);
+    u32 Slot0 = AcquireAndAllocate(Cache, 0.0f, 1024);
+    u32 Slot1 = AcquireAndAllocate(Cache, 1.0f, 1024);
+    u32 Slot2 = AcquireAndAllocate(Cache, 2.0f, 256);
+    u32 Slot3 = AcquireAndAllocate(Cache, 3.0f, 1024);
+    Expect((Slot0 != U32_MAX) && (Slot1 != U32_MAX) && (Slot2 != U32_MAX) && (Slot3 != U32_MAX));
+    u32 ExpectedSizes[CubeLayer_Count] = { 1024, 1024, 1024, 512, 512, 256 };
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        Expect(GetFaceSize(Cache, Slot3, Face) == ExpectedSizes[Face]);
+    }
+    // NOTE(boti): Each face got the largest tile that was left
+    Expect(AllocateShadowAtlasTile(&Cache->Atlas, 512) == shadow_atlas::InvalidNode);
+
+    // NOTE(boti): Growing the small face in the next frame evicts the first of the equally old lights
+    BeginPointShadowCacheFrame(Cache);
+    Expect(AcquireAndAllocate(Cache, 3.0f, 1024) == Slot3);
+    Expect(!HasTiles(Cache, Slot0));
+    Expect(HasTiles(Cache, Slot1) && HasTiles(Cache, Slot2));
+    Expect(GetFaceSize(Cache, Slot3, 5) == 1024);
+    // NOTE(boti): The 512 faces are within a factor of 2, so they stay as they are
+    Expect(GetFaceSize(Cache, Slot3, 3) == 512);
+    delete Cache;
+}
+
+internal void TestPointShadowHysteresis()
+{
+    point_shadow_cache* Cache = new point_shadow_cache{};
+
+    BeginPointShadowCacheFrame(Cache);
+    u32 Slot = AcquireAndAllocate(Cache, 0.0f, 512);
+    Expect(Slot != U32_MAX);
+    UpdatePointShadow(Cache, Slot, true, false);
+
+    // NOTE(boti): Within a factor of 2 in either direction nothing changes
+    u32 InRange[] = { 1024, 256, 512 };
+    for (u32 Index = 0; Index < CountOf(InRange); Index++)
+    {
+        BeginPointShadowCacheFrame(Cache);
+        Expect(AcquireAndAllocate(Cache, 0.0f, InRange[Index]) == Slot);
+        Expect(GetFaceSize(Cache, Slot, 0) == 512);
+        Expect(Cache->Entries[Slot].IsStaticValid);
+    }
+
+    // NOTE(boti): Shrinking has to be requested for R_PointShadowShrinkDelay consecutive frames,
+    // any frame in between at the current size restarts the count
+    for (u32 Frame = 0; Frame < R_PointShadowShrinkDelay - 1; Frame++)
+    {
+        BeginPointShadowCacheFrame(Cache);
+        AcquireAndAllocate(Cache, 0.0f, 128);
+    }
+    Expect(GetFaceSize(Cache, Slot, 0) == 512);
+    Expect(Cache->Entries[Slot].ShrinkFrameCounts[0] == R_PointShadowShrinkDelay - 1);
+
+    BeginPointShadowCacheFrame(Cache);
+    AcquireAndAllocate(Cache, 0.0f, 512);
+    Expect(Cache->Entries[Slot].ShrinkFrameCounts[0] == 0);
+
+    for (u32 Frame = 0; Frame < R_PointShadowShrinkDelay - 1; Frame++)
+    {
+        BeginPointShadowCacheFrame(Cache);
+        AcquireAndAllocate(Cache, 0.0f, 128);
+    }
+    Expect(GetFaceSize(Cache, Slot, 0) == 512);
+    Expect(Cache->Entries[Slot].IsStaticValid);
+
+    BeginPointShadowCacheFrame(Cache);
+    AcquireAndAllocate(Cache, 0.0f, 128);
+    Expect(GetFaceSize(Cache, Slot, 0) == 128);
+    Expect(!Cache->Entries[Slot].IsStaticValid);
+    Expect(Cache->Atlas.AllocatedTexelCount == CubeLayer_Count * 128 * 128);
+    UpdatePointShadow(Cache, Slot, true, false);
+
+    // NOTE(boti): Growing happens right away
+    BeginPointShadowCacheFrame(Cache);
+    AcquireAndAllocate(Cache, 0.0f, 256);
+    Expect(GetFaceSize(Cache, Slot, 0) == 128);
+    BeginPointShadowCacheFrame(Cache);
+    AcquireAndAllocate(Cache, 0.0f, 1024);
+    Expect(GetFaceSize(Cache, Slot, 0) == 1024);
+    Expect(!Cache->Entries[Slot].IsStaticValid);
+
+    // NOTE(boti): Faces are tracked separately
+    UpdatePointShadow(Cache, Slot, true, false);
+    u32 FaceSizes[CubeLayer_Count] = { 1024, 1024, 1024, 1024, 1024, 64 };
+    for (u32 Frame = 0; Frame < R_PointShadowShrinkDelay; Frame++)
+    {
+        BeginPointShadowCacheFrame(Cache);
+        AcquireAndAllocate(Cache, 0.0f, FaceSizes);
+    }
+    Expect(GetFaceSize(Cache, Slot, 0) == 1024);
+    Expect(GetFaceSize(Cache, Slot, 5) == 64);
+    delete Cache;
+}
+
+internal void TestPointShadowFaceSize()
+{
+    Expect(GetPointShadowFaceSize(-10.0f) == R_PointShadowMinResolution);
+    Expect(GetPointShadowFaceSize(0.0f) == R_PointShadowMinResolution);
+    Expect(GetPointShadowFaceSize(1.0f) == R_PointShadowMinResolution);
+    Expect(GetPointShadowFaceSize(127.0f) == 64);
+    Expect(GetPointShadowFaceSize(128.0f) == 128);
+    Expect(GetPointShadowFaceSize(255.0f) == 128);
+    Expect(GetPointShadowFaceSize(256.0f) == 256);
+    Expect(GetPointShadowFaceSize(1024.0f) == R_PointShadowMaxResolution);
+    Expect(GetPointShadowFaceSize(5000.0f) == R_PointShadowMaxResolution);
+    Expect(GetPointShadowFaceSize(F32_MAX_NORMAL) == R_PointShadowMaxResolution);
+
+    // NOTE(boti): Monotonic, powers of 2, and always a valid atlas tile size
+    u32 PrevSize = 0;
+    b32 IsValid = true;
+    for (f32 Radius = 0.0f; Radius < 4096.0f; Radius += 0.75f)
+    {
+        u32 Size = GetPointShadowFaceSize(Radius);
+        IsValid &= (Size >= PrevSize);
+        IsValid &= ((Size & (Size - 1)) == 0);
+        IsValid &= (Size >= R_PointShadowMinResolution) && (Size <= R_PointShadowMaxResolution);
+        PrevSize = Size;
+    }
+    Expect(IsValid);
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestAtlasSiblingMerge);
+    RunTest(TestAtlasFillToCapacity);
+    RunTest(TestAtlasRandom);
+    RunTest(TestPointShadowEviction);
+    RunTest(TestPointShadowHysteresis);
+    RunTest(TestPointShadowFaceSize);
+    return(EndTests("ShadowAtlasTest"));
+}
@@ -0,0 +1,525 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+#include <Renderer/ShadowAtlas.hpp>
+#include <Renderer/ShadowCache.hpp>
+
+#include <Renderer/ShadowAtlas.cpp>
+#include <Renderer/ShadowCache.cpp>
+
+internal void SetFaceSizes(u32* FaceSizes, u32 Size)
+{
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        FaceSizes[Face] = Size;
+    }
+}
+
+// NOTE(boti): Acquires the light and gives it tiles, the same way the renderer does it for a visible light
+internal u32 AcquireAndAllocate(point_shadow_cache* Cache, v3 P, f32 Radius, u32 Size)
+{
+    u32 FaceSizes[CubeLayer_Count];
+    SetFaceSizes(FaceSizes, Size);
+
+    u32 Result = AcquirePointShadow(Cache, P, Radius);
+    if ((Result != U32_MAX) && !AllocatePointShadowTiles(Cache, Result, FaceSizes))
+    {
+        Result = U32_MAX;
+    }
+    return(Result);
+}
+
+internal b32 HasAllTiles(const point_shadow_cache_entry* Entry)
+{
+    b32 Result = true;
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        Result &= (Entry->AtlasNodes[Face] != shadow_atlas::InvalidNode);
+    }
+    return(Result);
+}
+
+internal b32 HasNoTiles(const point_shadow_cache_entry* Entry)
+{
+    b32 Result = true;
+    for (u32 Face = 0; Face < CubeLayer_Count; Face++)
+    {
+        Result &= (Entry->AtlasNodes[Face] == shadow_atlas::InvalidNode);
+    }
+    return(Result);
+}
+
+internal void TestPointShadowLightMoves()
+{
+    point_shadow_cache Cache = {};
+
+    v3 P = { 1.0f, 2.0f, 3.0f };
+    f32 Radius = 5.0f;
+
+    BeginPointShadowCacheFrame(&Cache);
+    u32 Slot = AcquireAndAllocate(&Cache, P, Radius, 256);
+    Expect(Slot != U32_MAX);
+    Expect(!Cache.Entries[Slot].IsStaticValid);
+    Expect(UpdatePointShadow(&Cache, Slot, true, false));
+    Expect(Cache.Entries[Slot].IsStaticValid);
+
+    u32 Nodes[CubeLayer_Count];
+    memcpy(Nodes, Cache.Entries[Slot].AtlasNodes, sizeof(Nodes));
+
+    // NOTE(boti): A light that stays in place (up to float noise) keeps its slot, tiles and static layer
+    BeginPointShadowCacheFrame(&Cache);
+    Expect(AcquireAndAllocate(&Cache, P + v3{ 1e-5f, 0.0f, 0.0f }, Radius, 256) == Slot);
+    Expect(Cache.Entries[Slot].IsStaticValid);
+    Expect(memcmp(Nodes, Cache.Entries[Slot].AtlasNodes, sizeof(Nodes)) == 0);
+    Expect(!UpdatePointShadow(&Cache, Slot, false, false));
+
+    // NOTE(boti): A moved light is a different light as far as the cache is concerned,
+    // it gets a new slot with an invalid static layer, and the old one is left intact
+    v3 MovedP = P + v3{ 0.5f, 0.0f, 0.0f };
+    BeginPointShadowCacheFrame(&Cache);
+    u32 MovedSlot = AcquireAndAllocate(&Cache, MovedP, Radius, 256);
+    Expect(MovedSlot != U32_MAX);
+    Expect(MovedSlot != Slot);
+    Expect(!Cache.Entries[MovedSlot].IsStaticValid);
+    Expect(Cache.Entries[Slot].IsStaticValid);
+    Expect(memcmp(Nodes, Cache.Entries[Slot].AtlasNodes, sizeof(Nodes)) == 0);
+    Expect(UpdatePointShadow(&Cache, MovedSlot, true, false));
+
+    // NOTE(boti): Moving back finds the old slot with its static layer still valid
+    BeginPointShadowCacheFrame(&Cache);
+    Expect(AcquireAndAllocate(&Cache, P, Radius, 256) == Slot);
+    Expect(Cache.Entries[Slot].IsStaticValid);
+
+    // NOTE(boti): Same for a change in radius
+    BeginPointShadowCacheFrame(&Cache);
+    u32 ResizedSlot = AcquireAndAllocate(&Cache, P, 2.0f * Radius, 256);
+    Expect((ResizedSlot != Slot) && (ResizedSlot != MovedSlot));
+    Expect(!Cache.Entries[ResizedSlot].IsStaticValid);
+    Expect(Cache.Entries[Slot].IsStaticValid);
+}
+
+internal void TestPointShadowInvalidation()
+{
+    point_shadow_cache Cache = {};
+
+    v3 P0 = { 0.0f, 0.0f, 0.0f };
+    v3 P1 = { 100.0f, 0.0f, 0.0f };
+    f32 Radius = 10.0f;
+
+    BeginPointShadowCacheFrame(&Cache);
+    u32 Slot0 = AcquireAndAllocate(&Cache, P0, Radius, 128);
+    u32 Slot1 = AcquireAndAllocate(&Cache, P1, Radius, 128);
+    Expect((Slot0 != U32_MAX) && (Slot1 != U32_MAX) && (Slot0 != Slot1));
+
+    auto Rebuild = [&]()
+    {
+        UpdatePointShadow(&Cache, Slot0, true, false);
+        UpdatePointShadow(&Cache, Slot1, true, false);
+    };
+
+    // NOTE(boti): Casters outside of both radii
+    Rebuild();
+    InvalidatePointShadows(&Cache, { { 50.0f, -1.0f, -1.0f }, { 52.0f, 1.0f, 1.0f } });
+    Expect(Cache.Entries[Slot0].IsStaticValid && Cache.Entries[Slot1].IsStaticValid);
+
+    // NOTE(boti): Inside the bounding cube of the sphere, but outside of the sphere
+    InvalidatePointShadows(&Cache, { { 8.0f, 8.0f, 8.0f }, { 9.0f, 9.0f, 9.0f } });
+    Expect(Cache.Entries[Slot0].IsStaticValid && Cache.Entries[Slot1].IsStaticValid);
+
+    // NOTE(boti): Partially overlapping the radius of the first light only
+    InvalidatePointShadows(&Cache, { { 9.0f, -1.0f, -1.0f }, { 12.0f, 1.0f, 1.0f } });
+    Expect(!Cache.Entries[Slot0].IsStaticValid && Cache.Entries[Slot1].IsStaticValid);
+
+    // NOTE(boti): Containing the second light
+    Rebuild();
+    InvalidatePointShadows(&Cache, { { 99.0f, -1.0f, -1.0f }, { 101.0f, 1.0f, 1.0f } });
+    Expect(Cache.Entries[Slot0].IsStaticValid && !Cache.Entries[Slot1].IsStaticValid);
+
+    // NOTE(boti): Spanning both of them
+    Rebuild();
+    InvalidatePointShadows(&Cache, { { -1.0f, -1.0f, -1.0f }, { 101.0f, 1.0f, 1.0f } });
+    Expect(!Cache.Entries[Slot0].IsStaticValid && !Cache.Entries[Slot1].IsStaticValid);
+
+    // NOTE(boti): A caster moving from outside to inside the radius (the renderer invalidates both the old and the new box)
+    Rebuild();
+    mmbox OldBox = { { -30.0f, -1.0f, -1.0f }, { -28.0f, 1.0f, 1.0f } };
+    mmbox NewBox = { { -10.5f, -1.0f, -1.0f }, { -9.5f, 1.0f, 1.0f } };
+    InvalidatePointShadows(&Cache, OldBox);
+    Expect(Cache.Entries[Slot0].IsStaticValid);
+    InvalidatePointShadows(&Cache, NewBox);
+    Expect(!Cache.Entries[Slot0].IsStaticValid && Cache.Entries[Slot1].IsStaticValid);
+
+    // NOTE(boti): The invalidated slot keeps its tiles, only the static layer needs to be rebuilt
+    BeginPointShadowCacheFrame(&Cache);
+    Expect(AcquirePointShadow(&Cache, P0, Radius) == Slot0);
+    Expect(HasAllTiles(Cache.Entries + Slot0));
+    Expect(UpdatePointShadow(&Cache, Slot0, !Cache.Entries[Slot0].IsStaticValid, false));
+    Expect(Cache.Entries[Slot0].IsStaticValid);
+
+    InvalidateAllPointShadows(&Cache);
+    Expect(!Cache.Entries[Slot0].IsStaticValid && !Cache.Entries[Slot1].IsStaticValid);
+}
+
+internal void TestPointShadowLRUReuse()
+{
+    point_shadow_cache Cache = {};
+
+    // NOTE(boti): Fill every slot, light N is last used in frame N+1
+    for (u32 LightIndex = 0; LightIndex < R_MaxShadowCount; LightIndex++)
+    {
+        BeginPointShadowCacheFrame(&Cache);
+        u32 Slot = AcquireAndAllocate(&Cache, { (f32)LightIndex, 0.0f, 0.0f }, 1.0f, R_PointShadowMinResolution);
+        Expect(Slot != U32_MAX);
+        UpdatePointShadow(&Cache, Slot, true, false);
+    }
+
+    // NOTE(boti): Touch the oldest light, so that light 1 becomes the least recently used one
+    BeginPointShadowCacheFrame(&Cache);
+    u32 Slot0 = AcquirePointShadow(&Cache, { 0.0f, 0.0f, 0.0f }, 1.0f);
+    u32 Slot1 = U32_MAX;
+    for (u32 Slot = 0; Slot < R_MaxShadowCount; Slot++)
+    {
+        if (Cache.Entries[Slot].P.X == 1.0f)
+        {
+            Slot1 = Slot;
+        }
+    }
+    Expect(Slot1 != U32_MAX);
+
+    u32 NewSlot = AcquirePointShadow(&Cache, { -1.0f, 0.0f, 0.0f }, 1.0f);
+    Expect(NewSlot == Slot1);
+    Expect(!Cache.Entries[NewSlot].IsStaticValid);
+    // NOTE(boti): The tiles stay with the slot, they only get resized if needed
+    Expect(HasAllTiles(Cache.Entries + NewSlot));
+
+    // NOTE(boti): Slots acquired this frame are never taken over, even if they're older
+    u32 NextSlot = AcquirePointShadow(&Cache, { -2.0f, 0.0f, 0.0f }, 1.0f);
+    Expect((NextSlot != U32_MAX) && (NextSlot != Slot0) && (NextSlot != Slot1));
+
+    // NOTE(boti): Once all the slots have been acquired, there's nothing left to hand out
+    BeginPointShadowCacheFrame(&Cache);
+    for (u32 LightIndex = 0; LightIndex < R_MaxShadowCount; LightIndex++)
+    {
+        Expect(AcquirePointShadow(&Cache, { 1000.0f + (f32)LightIndex, 0.0f, 0.0f }, 1.0f) != U32_MAX);
+    }
+    Expect(AcquirePointShadow(&Cache, { 2000.0f, 0.0f, 0.0f }, 1.0f) == U32_MAX);
+}
+
+internal void TestPointShadowDynamicOverlay()
+{
+    point_shadow_cache Cache = {};
+
+    BeginPointShadowCacheFrame(&Cache);
+    u32 Slot = AcquireAndAllocate(&Cache, { 0.0f, 0.0f, 0.0f }, 1.0f, 256);
+    point_shadow_cache_entry* Entry = Cache.Entries + Slot;
+
+    // NOTE(boti): The static rebuild always updates the sampled map
+    Expect(UpdatePointShadow(&Cache, Slot, true, false));
+    Expect(!Entry->HasDynamicOverlay);
+
+    // NOTE(boti): Nothing changed
+    Expect(!UpdatePointShadow(&Cache, Slot, false, false));
+
+    // NOTE(boti): Dynamic casters get rendered on top every frame they're in range
+    Expect(UpdatePointShadow(&Cache, Slot, false, true));
+    Expect(Entry->HasDynamicOverlay);
+    Expect(UpdatePointShadow(&Cache, Slot, false, true));
+    Expect(Entry->HasDynamicOverlay);
+
+    // NOTE(boti): on -> off: the sampled map still has the old dynamic casters in it, so it gets reset to the static layer once
+    Expect(UpdatePointShadow(&Cache, Slot, false, false));
+    Expect(!Entry->HasDynamicOverlay);
+    Expect(!UpdatePointShadow(&Cache, Slot, false, false));
+
+    // NOTE(boti): A static rebuild with dynamic casters leaves the overlay on
+    Expect(UpdatePointShadow(&Cache, Slot, true, true));
+    Expect(Entry->HasDynamicOverlay && Entry->IsStaticValid);
+    Expect(UpdatePointShadow(&Cache, Slot, false, false));
+    Expect(!Entry->HasDynamicOverlay && Entry->IsStaticValid);
+}
+
+// NOTE(boti): Slice of the given size centered at P (the rotation of the frustum doesn't matter, only its bounds)
+internal void GetSliceBounds(v3 P, f32 SliceScale, v3* SliceMin, v3* SliceMax)
+{
+    v3 HalfSize = { 0.35f * SliceScale, 0.3f * SliceScale, 0.4f * SliceScale };
+    *SliceMin = P - HalfSize;
+    *SliceMax = P + HalfSize;
+}
+
+internal void TestCascadeSnapping()
+{
+    entropy32 Entropy = { 0x4242u };
+    for (u32 Iteration = 0; Iteration < 1000; Iteration++)
+    {
+        f32 SliceScale = RandBetween(&Entropy, 4.0f, 400.0f);
+        v3 P = { RandBilateral(&Entropy) * 1000.0f, RandBilateral(&Entropy) * 1000.0f, RandBilateral(&Entropy) * 1000.0f };
+
+        v3 SliceMin, SliceMax;
+        GetSliceBounds(P, SliceScale, &SliceMin, &SliceMax);
+        cascade_placement Placement = PlaceCascade(SliceMin, SliceMax, SliceScale);
+        Expect(DoesCascadeCover(Placement, SliceMin, SliceMax));
+
+        // NOTE(boti): Move the slice around inside the same texel/depth step, the placement can't change
+        f32 TexelSize = GetCascadeTexelSize(Placement.Extent);
+        f32 DepthStep = GetCascadeDepthStep(Placement.Extent);
+        f32 DepthRange = GetCascadeDepthRange(Placement.Extent);
+        v3 SnappedP = 
+        {
+            ((f32)Placement.TexelX + 0.5f) * TexelSize,
+            ((f32)Placement.TexelY + 0.5f) * TexelSize,
+            ((f32)Placement.DepthSlice + 0.5f) * DepthStep + 0.5f * DepthRange,
+        };
+        for (u32 Step = 0; Step < 8; Step++)
+        {
+            v3 Jitter = 
+            {
+                0.4f * TexelSize * RandBilateral(&Entropy),
+                0.4f * TexelSize * RandBilateral(&Entropy),
+                0.4f * DepthStep * RandBilateral(&Entropy),
+            };
+            GetSliceBounds(SnappedP + Jitter, SliceScale, &SliceMin, &SliceMax);
+            cascade_placement Jittered = PlaceCascade(SliceMin, SliceMax, SliceScale);
+            Expect((Jittered.TexelX == Placement.TexelX) && (Jittered.TexelY == Placement.TexelY) &&
+                   (Jittered.DepthSlice == Placement.DepthSlice) && (Jittered.Extent == Placement.Extent));
+        }
+
+        // NOTE(boti): Moving by whole texels moves the placement by the same amount
+        s32 dX = (s32)RandBetween(&Entropy, -20.0f, 20.0f);
+        s32 dY = (s32)RandBetween(&Entropy, -20.0f, 20.0f);
+        GetSliceBounds(SnappedP + v3{ (f32)dX * TexelSize, (f32)dY * TexelSize, 0.0f }, SliceScale, &SliceMin, &SliceMax);
+        cascade_placement Moved = PlaceCascade(SliceMin, SliceMax, SliceScale);
+        Expect((Moved.TexelX == Placement.TexelX + dX) && (Moved.TexelY == Placement.TexelY + dY) &&
+               (Moved.DepthSlice == Placement.DepthSlice));
+
+        // NOTE(boti): The extent only depends on the size of the slice, not on its position
+        GetSliceBounds(-P, SliceScale, &SliceMin, &SliceMax);
+        Expect(PlaceCascade(SliceMin, SliceMax, SliceScale).Extent == Placement.Extent);
+    }
+}
+
+// NOTE(boti): Texel coordinates of a sun-space point, through the same transform and viewport as the shadow pass
+internal v2 GetCascadeTexelCoords(cascade_placement Placement, v3 SunP)
+{
+    v3 ClipP = TransformPoint(GetCascadeProjection(Placement), SunP);
+    v2 Result = 
+    {
+        0.5f * (ClipP.X + 1.0f) * (f32)R_ShadowResolution,
+        0.5f * (ClipP.Y + 1.0f) * (f32)R_ShadowResolution,
+    };
+    return(Result);
+}
+
+internal b32 IsInRect(u32 X, u32 Y, u32 RectX, u32 RectY, u32 Width, u32 Height)
+{
+    b32 Result = (X >= RectX) && (X < RectX + Width) && (Y >= RectY) && (Y < RectY + Height);
+    return(Result);
+}
+
+internal void TestCascadeScroll()
+{
+    constexpr u32 Resolution = R_ShadowResolution;
+
+    cascade_placement Old = { .TexelX = 1000, .TexelY = -300, .DepthSlice = 7, .Extent = 64.0f };
+    s32 Scrolls[] = { -700, -3, -1, 0, 1, 5, 1200 };
+    for (u32 IndexX = 0; IndexX < CountOf(Scrolls); IndexX++)
+    {
+        for (u32 IndexY = 0; IndexY < CountOf(Scrolls); IndexY++)
+        {
+            s32 ScrollX = Scrolls[IndexX];
+            s32 ScrollY = Scrolls[IndexY];
+            cascade_placement New = Old;
+            New.TexelX += ScrollX;
+            New.TexelY += ScrollY;
+
+            cascade_shadow_update Update = {};
+            Expect(GetCascadeScroll(Old, New, &Update));
+            Expect((Update.ScrollX == ScrollX) && (Update.ScrollY == ScrollY));
+            Expect(Update.StripCount == (u32)(ScrollX != 0) + (u32)(ScrollY != 0));
+
+            // NOTE(boti): ±X scrolls expose a full height column on the side the cascade moved towards, ±Y a full width row
+            for (u32 StripIndex = 0; StripIndex < Update.StripCount; StripIndex++)
+            {
+                cascade_strip Strip = Update.Strips[StripIndex];
+                b32 IsX = (StripIndex == 0) && (ScrollX != 0);
+                if (IsX)
+                {
+                    u32 Width = (u32)(ScrollX > 0 ? ScrollX : -ScrollX);
+                    Expect((Strip.Y == 0) && (Strip.Height == Resolution) && (Strip.Width == Width));
+                    Expect(Strip.X == ((ScrollX > 0) ? Resolution - Width : 0));
+                }
+                else
+                {
+                    u32 Height = (u32)(ScrollY > 0 ? ScrollY : -ScrollY);
+                    Expect((Strip.X == 0) && (Strip.Width == Resolution) && (Strip.Height == Height));
+                    Expect(Strip.Y == ((ScrollY > 0) ? Resolution - Height : 0));
+                }
+            }
+
+            Update.IsScrolled = true;
+            cascade_scroll_copy Copy = GetCascadeScrollCopy(&Update);
+            Expect((Copy.SrcX + Copy.Width <= Resolution) && (Copy.SrcY + Copy.Height <= Resolution));
+            Expect((Copy.DstX + Copy.Width <= Resolution) && (Copy.DstY + Copy.Height <= Resolution));
+            Expect(((s32)Copy.SrcX - (s32)Copy.DstX == ScrollX) && ((s32)Copy.SrcY - (s32)Copy.DstY == ScrollY));
+
+            // NOTE(boti): Every texel of the new layer is either copied or inside a strip, but never both
+            b32 IsPartitioned = true;
+            for (u32 Y = 0; Y < Resolution; Y += (Y < 8 || Y > Resolution - 8) ? 1 : 7)
+            {
+                for (u32 X = 0; X < Resolution; X += (X < 8 || X > Resolution - 8) ? 1 : 7)
+                {
+                    b32 IsCopied = IsInRect(X, Y, Copy.DstX, Copy.DstY, Copy.Width, Copy.Height);
+                    b32 IsInStrip = false;
+                    for (u32 StripIndex = 0; StripIndex < Update.StripCount; StripIndex++)
+                    {
+                        cascade_strip Strip = Update.Strips[StripIndex];
+                        IsInStrip |= IsInRect(X, Y, Strip.X, Strip.Y, Strip.Width, Strip.Height);
+                    }
+                    IsPartitioned &= (IsCopied != IsInStrip);
+                }
+            }
+            Expect(IsPartitioned);
+
+            // NOTE(boti): The sign convention: a sun-space point lands on texel (x, y) in the new placement 
+            // and (x + ScrollX, y + ScrollY) in the old one, which is what gets copied to (x, y)
+            entropy32 Entropy = { 0x77u };
+            f32 TexelSize = GetCascadeTexelSize(New.Extent);
+            v3 NewP = GetCascadeP(New);
+            for (u32 PointIndex = 0; PointIndex < 64; PointIndex++)
+            {
+                v3 SunP = NewP + v3{ 0.5f * New.Extent * RandBilateral(&Entropy), 0.5f * New.Extent * RandBilateral(&Entropy), 1.0f };
+                v2 NewTexel = GetCascadeTexelCoords(New, SunP);
+                v2 OldTexel = GetCascadeTexelCoords(Old, SunP);
+                Expect(Abs(OldTexel.X - (NewTexel.X + (f32)ScrollX)) < 0.01f);
+                Expect(Abs(OldTexel.Y - (NewTexel.Y + (f32)ScrollY)) < 0.01f);
+
+                u32 X = (u32)NewTexel.X;
+                u32 Y = (u32)NewTexel.Y;
+                if (IsInRect(X, Y, Copy.DstX, Copy.DstY, Copy.Width, Copy.Height))
+                {
+                    f32 SrcX = (f32)Copy.SrcX + (NewTexel.X - (f32)Copy.DstX);
+                    f32 SrcY = (f32)Copy.SrcY + (NewTexel.Y - (f32)Copy.DstY);
+                    Expect((Abs(SrcX - OldTexel.X) < 0.01f) && (Abs(SrcY - OldTexel.Y) < 0.01f));
+                }
+                else
+                {
+                    // NOTE(boti): Texels in the strips weren't covered by the old placement
+                    b32 IsInOld = 
+                        (OldTexel.X >= 0.0f) && (OldTexel.X < (f32)Resolution) &&
+                        (OldTexel.Y >= 0.0f) && (OldTexel.Y < (f32)Resolution);
+                    Expect(!IsInOld || (Abs(OldTexel.X) < 0.01f) || (Abs(OldTexel.Y) < 0.01f) ||
+                           (Abs(OldTexel.X - (f32)Resolution) < 0.01f) || (Abs(OldTexel.Y - (f32)Resolution) < 0.01f));
+                }
+            }
+        }
+    }
+
+    // NOTE(boti): No overlap, or a different depth range, means that the static layer has to be rebuilt
+    cascade_shadow_update Update = {};
+    cascade_placement New = Old;
+    New.TexelX += (s32)Resolution;
+    Expect(!GetCascadeScroll(Old, New, &Update));
+    New = Old;
+    New.TexelY -= (s32)Resolution;
+    Expect(!GetCascadeScroll(Old, New, &Update));
+    New = Old;
+    New.DepthSlice++;
+    Expect(!GetCascadeScroll(Old, New, &Update));
+    New = Old;
+    New.Extent *= 2.0f;
+    Expect(!GetCascadeScroll(Old, New, &Update));
+}
+
+internal void TestCascadeSchedule()
+{
+    // NOTE(boti): At most 2 cascades per frame, each one at its own rate
+    u32 UpdateCounts[R_MaxShadowCascadeCount] = {};
+    constexpr u32 FrameCount = 64;
+    for (u64 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+    {
+        u32 ScheduledCount = 0;
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            if (IsCascadeScheduled(FrameIndex, CascadeIndex))
+            {
+                ScheduledCount++;
+                UpdateCounts[CascadeIndex]++;
+            }
+        }
+        Expect(ScheduledCount <= 2);
+        Expect(IsCascadeScheduled(FrameIndex, 0));
+    }
+    Expect(UpdateCounts[1] == FrameCount / 2);
+    Expect(UpdateCounts[2] == FrameCount / 4);
+    Expect(UpdateCounts[3] == FrameCount / 4);
+
+    cascade_shadow_cache Cache = {};
+    m4 SunView = Identity4();
+    f32 SliceScales[R_MaxShadowCascadeCount] = { 8.0f, 24.0f, 80.0f, 250.0f };
+
+    // NOTE(boti): The camera drifts slowly, so the cascades only get updated on schedule (apart from the first frame)
+    v3 CameraP = { 10.0f, 20.0f, 30.0f };
+    for (u32 Frame = 0; Frame < FrameCount; Frame++)
+    {
+        BeginCascadeShadowCacheFrame(&Cache, SunView);
+        u32 ScheduledCount = 0;
+        for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+        {
+            v3 SliceMin, SliceMax;
+            GetSliceBounds(CameraP, SliceScales[CascadeIndex], &SliceMin, &SliceMax);
+            cascade_placement Placement;
+            cascade_shadow_update Update = ScheduleCascadeShadow(&Cache, CascadeIndex, SliceMin, SliceMax, SliceScales[CascadeIndex], &Placement);
+            ScheduledCount += Update.IsScheduled ? 1 : 0;
+            Expect(DoesCascadeCover(Placement, SliceMin, SliceMax));
+            Expect(Update.IsScheduled == ((Frame == 0) || IsCascadeScheduled(Cache.FrameIndex, CascadeIndex)));
+            Expect(!Update.IsStaticRebuilt || (Frame == 0));
+            UpdateCascadeShadow(&Cache, CascadeIndex, &Update, false);
+        }
+        Expect((Frame == 0) || (ScheduledCount <= 2));
+        CameraP.X += 0.01f;
+    }
+
+    // NOTE(boti): Leaving the guard band forces an out-of-schedule update
+    u32 FarCascade = 3;
+    while (IsCascadeScheduled(Cache.FrameIndex + 1, FarCascade))
+    {
+        BeginCascadeShadowCacheFrame(&Cache, SunView);
+    }
+    BeginCascadeShadowCacheFrame(&Cache, SunView);
+    {
+        CameraP.X += 0.3f * SliceScales[FarCascade];
+        v3 SliceMin, SliceMax;
+        GetSliceBounds(CameraP, SliceScales[FarCascade], &SliceMin, &SliceMax);
+        cascade_placement OldPlacement = Cache.Entries[FarCascade].Placement;
+        u32 OldLayer = Cache.Entries[FarCascade].StaticLayer;
+        cascade_placement Placement;
+        cascade_shadow_update Update = ScheduleCascadeShadow(&Cache, FarCascade, SliceMin, SliceMax, SliceScales[FarCascade], &Placement);
+        Expect(Update.IsScheduled && Update.IsScrolled && !Update.IsStaticRebuilt);
+        Expect(Update.ScrollX == Placement.TexelX - OldPlacement.TexelX);
+        Expect((Update.SrcStaticLayer == OldLayer) && (Update.DstStaticLayer == (OldLayer ^ 1)));
+        Expect(DoesCascadeCover(Placement, SliceMin, SliceMax));
+    }
+
+    // NOTE(boti): Changing the sun direction invalidates everything
+    SunView.P.X = 1.0f;
+    BeginCascadeShadowCacheFrame(&Cache, SunView);
+    for (u32 CascadeIndex = 0; CascadeIndex < R_MaxShadowCascadeCount; CascadeIndex++)
+    {
+        v3 SliceMin, SliceMax;
+        GetSliceBounds(CameraP, SliceScales[CascadeIndex], &SliceMin, &SliceMax);
+        cascade_placement Placement;
+        cascade_shadow_update Update = ScheduleCascadeShadow(&Cache, CascadeIndex, SliceMin, SliceMax, SliceScales[CascadeIndex], &Placement);
+        Expect(Update.IsScheduled && Update.IsStaticRebuilt);
+    }
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestPointShadowLightMoves);
+    RunTest(TestPointShadowInvalidation);
+    RunTest(TestPointShadowLRUReuse);
+    RunTest(TestPointShadowDynamicOverlay);
+    RunTest(TestCascadeSnapping);
+    RunTest(TestCascadeScroll);
+    RunTest(TestCascadeSchedule);
+    return(EndTests("ShadowCacheTest"));
+}
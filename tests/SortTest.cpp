@@ -0,0 +1,214 @@
+#include "Test.hpp"
+
+#include <LadybugLib/Sort.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// NOTE(boti): The reference is std::stable_sort on (key, original index) pairs,
+// the radix sorts get the original index as the value so that stability is checked too
+template<typename key_type>
+internal std::vector<u32> GetReferenceOrder(const std::vector<key_type>& Keys)
+{
+    std::vector<u32> Result(Keys.size());
+    for (u32 Index = 0; Index < (u32)Keys.size(); Index++)
+    {
+        Result[Index] = Index;
+    }
+    std::stable_sort(Result.begin(), Result.end(), [&](u32 A, u32 B) { return Keys[A] < Keys[B]; });
+    return(Result);
+}
+
+template<typename key_type>
+internal void CheckSorted(const std::vector<key_type>& SourceKeys, const key_type* Keys, const u32* Values)
+{
+    std::vector<u32> Reference = GetReferenceOrder(SourceKeys);
+    b32 IsSame = true;
+    for (u32 Index = 0; Index < (u32)SourceKeys.size(); Index++)
+    {
+        IsSame &= (Values[Index] == Reference[Index]);
+        IsSame &= (Keys[Index] == SourceKeys[Reference[Index]]);
+    }
+    Expect(IsSame);
+}
+
+// NOTE(boti): KeyMask limits the number of distinct keys, so that there are plenty of equal ones
+internal std::vector<u64> MakeKeys(entropy32* Entropy, u32 Count, u64 KeyMask)
+{
+    std::vector<u64> Result(Count);
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        u64 Key = ((u64)RandU32(Entropy) << 32) | RandU32(Entropy);
+        Result[Index] = Key & KeyMask;
+    }
+    return(Result);
+}
+
+internal void TestRadixSort32(u32 Count, u64 KeyMask, entropy32* Entropy)
+{
+    std::vector<u64> WideKeys = MakeKeys(Entropy, Count, KeyMask);
+    std::vector<u32> SourceKeys(Count);
+    std::vector<u32> Keys(Count), Values(Count), TempKeys(Count), TempValues(Count);
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        SourceKeys[Index] = (u32)WideKeys[Index];
+        Keys[Index] = SourceKeys[Index];
+        Values[Index] = Index;
+    }
+
+    RadixSort32(Count, Keys.data(), Values.data(), TempKeys.data(), TempValues.data());
+    CheckSorted(SourceKeys, Keys.data(), Values.data());
+}
+
+internal void TestRadixSort64(u32 Count, u64 KeyMask, entropy32* Entropy)
+{
+    std::vector<u64> SourceKeys = MakeKeys(Entropy, Count, KeyMask);
+    std::vector<u64> Keys = SourceKeys, TempKeys(Count);
+    std::vector<u32> Values(Count), TempValues(Count);
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        Values[Index] = Index;
+    }
+
+    RadixSort64(Count, Keys.data(), Values.data(), TempKeys.data(), TempValues.data());
+    CheckSorted(SourceKeys, Keys.data(), Values.data());
+}
+
+// NOTE(boti): Same as a threaded sort, except that the chunks get processed serially in reverse order,
+// which would break the stability if the scatter offsets depended on the processing order
+internal void TestChunkedRadixSort64(u32 Count, u32 ChunkCount, u64 KeyMask, entropy32* Entropy)
+{
+    std::vector<u64> SourceKeys = MakeKeys(Entropy, Count, KeyMask);
+    std::vector<u64> Keys = SourceKeys, TempKeys(Count);
+    std::vector<u32> Values(Count), TempValues(Count);
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        Values[Index] = Index;
+    }
+
+    std::vector<u32> ChunkOffsetStorage(ChunkCount * radix_sort64::DigitCount);
+    u32 (*ChunkOffsets)[radix_sort64::DigitCount] = (u32 (*)[radix_sort64::DigitCount])ChunkOffsetStorage.data();
+    radix_sort64 Sort = BeginRadixSort64(Count, Keys.data(), Values.data(), TempKeys.data(), TempValues.data(), ChunkCount, ChunkOffsets);
+    for (u32 Pass = 0; Pass < radix_sort64::PassCount; Pass++)
+    {
+        for (u32 ChunkIndex = ChunkCount; ChunkIndex > 0; ChunkIndex--)
+        {
+            CountRadixSortChunk(&Sort, ChunkIndex - 1);
+        }
+        if (PrefixRadixSortPass(&Sort))
+        {
+            for (u32 ChunkIndex = ChunkCount; ChunkIndex > 0; ChunkIndex--)
+            {
+                ScatterRadixSortChunk(&Sort, ChunkIndex - 1);
+            }
+        }
+        EndRadixSortPass(&Sort);
+    }
+    EndRadixSort64(&Sort);
+
+    CheckSorted(SourceKeys, Keys.data(), Values.data());
+}
+
+internal void TestRadixSorts()
+{
+    entropy32 Entropy = { 0x1234u };
+
+    u32 Counts[] = { 0, 1, 2, 3, 255, 256, 257, 1000, 65536, 100000 };
+    u64 KeyMasks[] =
+    {
+        U64_MAX,                // NOTE(boti): Every pass has to scatter
+        0xFFllu,                // NOTE(boti): Only the first pass scatters, the rest are skipped
+        0xF0F0000000000F00llu,  // NOTE(boti): Skipped passes between the scattering ones
+        0,                      // NOTE(boti): All keys equal, every pass is skipped
+    };
+    for (u32 CountIndex = 0; CountIndex < CountOf(Counts); CountIndex++)
+    {
+        for (u32 MaskIndex = 0; MaskIndex < CountOf(KeyMasks); MaskIndex++)
+        {
+            u32 Count = Counts[CountIndex];
+            u64 KeyMask = KeyMasks[MaskIndex];
+            TestRadixSort32(Count, KeyMask, &Entropy);
+            TestRadixSort64(Count, KeyMask, &Entropy);
+
+            // NOTE(boti): More chunks than keys means that some of the chunks are empty
+            u32 ChunkCounts[] = { 1, 2, 7, 64, 300 };
+            for (u32 ChunkIndex = 0; ChunkIndex < CountOf(ChunkCounts); ChunkIndex++)
+            {
+                TestChunkedRadixSort64(Count, ChunkCounts[ChunkIndex], KeyMask, &Entropy);
+            }
+        }
+    }
+}
+
+internal void TestFloatToSortKey()
+{
+    f32 Values[] =
+    {
+        -F32_MAX_NORMAL, -1e20f, -2.0f, -1.0f, -0.5f, -1e-30f, -FLT_TRUE_MIN, -0.0f,
+        +0.0f, FLT_TRUE_MIN, 1e-30f, 0.5f, 1.0f, 2.0f, 1e20f, F32_MAX_NORMAL,
+    };
+
+    // NOTE(boti): The keys are strictly increasing, -0 is ordered right before +0
+    for (u32 Index = 1; Index < CountOf(Values); Index++)
+    {
+        Expect(FloatToSortKey(Values[Index - 1]) < FloatToSortKey(Values[Index]));
+    }
+    Expect(FloatToSortKey(-0.0f) + 1 == FloatToSortKey(+0.0f));
+
+    // NOTE(boti): Sorting random floats by key gives the same order as sorting the floats
+    entropy32 Entropy = { 0x5678u };
+    constexpr u32 Count = 10000;
+    std::vector<f32> Floats(Count);
+    std::vector<u32> Keys(Count), Values_(Count), TempKeys(Count), TempValues(Count);
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        f32 Value = RandBilateral(&Entropy) * 1000.0f;
+        if ((Index % 17) == 0) Value = 0.0f;
+        if ((Index % 19) == 0) Value = -0.0f;
+        Floats[Index] = Value;
+        Keys[Index] = FloatToSortKey(Value);
+        Values_[Index] = Index;
+    }
+    RadixSort32(Count, Keys.data(), Values_.data(), TempKeys.data(), TempValues.data());
+
+    b32 IsOrdered = true;
+    for (u32 Index = 1; Index < Count; Index++)
+    {
+        IsOrdered &= (Floats[Values_[Index - 1]] <= Floats[Values_[Index]]);
+    }
+    Expect(IsOrdered);
+}
+
+internal void BenchmarkRadixSort64()
+{
+    entropy32 Entropy = { 0x9ABCu };
+    constexpr u32 Count = 1u << 20;
+    std::vector<u64> SourceKeys = MakeKeys(&Entropy, Count, U64_MAX);
+    std::vector<u64> Keys = SourceKeys, TempKeys(Count);
+    std::vector<u32> Values(Count), TempValues(Count);
+    for (u32 Index = 0; Index < Count; Index++)
+    {
+        Values[Index] = Index;
+    }
+
+    f64 RadixBegin = GetSeconds();
+    RadixSort64(Count, Keys.data(), Values.data(), TempKeys.data(), TempValues.data());
+    f64 RadixTime = GetSeconds() - RadixBegin;
+
+    f64 ReferenceBegin = GetSeconds();
+    std::vector<u32> Reference = GetReferenceOrder(SourceKeys);
+    f64 ReferenceTime = GetSeconds() - ReferenceBegin;
+
+    printf("RadixSort64 (%u keys): %.2fms, std::stable_sort: %.2fms\n", Count, 1000.0 * RadixTime, 1000.0 * ReferenceTime);
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestRadixSorts);
+    RunTest(TestFloatToSortKey);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkRadixSort64();
+    }
+    return(EndTests("SortTest"));
+}
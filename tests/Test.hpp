@@ -0,0 +1,65 @@
+#pragma once
+
+// NOTE(boti): Minimal harness for the headless tests of the platform-independent code (see Makefile).
+// Each test is a separate executable that returns non-zero if any of its checks failed.
+
+#include <LadybugLib/Core.hpp>
+#include <LadybugLib/Intrinsics.hpp>
+
+#include <cstdio>
+#include <ctime>
+
+struct test_context
+{
+    const char* CurrentTest;
+    u32 CheckCount;
+    u32 FailCount;
+};
+
+static test_context TestContext;
+
+#define Expect(...) ExpectImpl_((b32)(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+#define RunTest(Function) (TestContext.CurrentTest = #Function, Function())
+
+inline b32 ExpectImpl_(b32 Condition, const char* Expression, const char* File, int Line)
+{
+    TestContext.CheckCount++;
+    if (!Condition)
+    {
+        // NOTE(boti): Only the first few failures get printed, loops tend to fail the same check many times
+        if (TestContext.FailCount++ < 32)
+        {
+            fprintf(stderr, "%s:%d: %s: Expected %s\n", File, Line, TestContext.CurrentTest, Expression);
+        }
+    }
+    return(Condition);
+}
+
+inline int EndTests(const char* Name)
+{
+    printf("%s: %u/%u checks passed\n", Name, TestContext.CheckCount - TestContext.FailCount, TestContext.CheckCount);
+    int Result = (TestContext.FailCount == 0) ? 0 : 1;
+    return(Result);
+}
+
+inline f64 GetSeconds()
+{
+    timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    f64 Result = (f64)Time.tv_sec + 1e-9 * (f64)Time.tv_nsec;
+    return(Result);
+}
+
+// NOTE(boti): Benchmarks only run when the test is started with --bench (see the bench target in the Makefile)
+inline b32 IsBenchmarkRun(int ArgCount, char** Args)
+{
+    b32 Result = false;
+    for (int ArgIndex = 1; ArgIndex < ArgCount; ArgIndex++)
+    {
+        if (strcmp(Args[ArgIndex], "--bench") == 0)
+        {
+            Result = true;
+        }
+    }
+    return(Result);
+}
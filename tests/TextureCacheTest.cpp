@@ -0,0 +1,402 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+#include <Renderer/TextureCache.hpp>
+
+#include <Renderer/TextureCache.cpp>
+
+#include <algorithm>
+#include <vector>
+
+// NOTE(boti): The reference is a page at a time first-fit search over a plain array
+struct reference_cache
+{
+    std::vector<u8> IsUsed;
+};
+
+internal umm FindReferenceRange(reference_cache* Reference, umm PageCount)
+{
+    umm Result = U64_MAX;
+    umm RunLength = 0;
+    for (umm PageIndex = 0; PageIndex < Reference->IsUsed.size(); PageIndex++)
+    {
+        RunLength = Reference->IsUsed[PageIndex] ? 0 : RunLength + 1;
+        if (PageCount && (RunLength == PageCount))
+        {
+            Result = PageIndex + 1 - PageCount;
+            break;
+        }
+    }
+    return(Result);
+}
+
+internal void SetReferenceUsage(reference_cache* Reference, umm FirstPage, umm PageCount, b32 IsUsed)
+{
+    for (umm PageIndex = FirstPage; PageIndex < FirstPage + PageCount; PageIndex++)
+    {
+        Reference->IsUsed[PageIndex] = (u8)IsUsed;
+    }
+}
+
+// NOTE(boti): The page usage, the free run stats and the region summaries all have to match the reference
+internal b32 IsSameAsReference(texture_cache* Cache, reference_cache* Reference)
+{
+    b32 Result = true;
+
+    umm UsedPageCount = 0;
+    umm LargestFreeRange = 0;
+    umm FreeRangeCount = 0;
+    umm RunLength = 0;
+    for (umm PageIndex = 0; PageIndex < Reference->IsUsed.size(); PageIndex++)
+    {
+        b32 IsUsed = Reference->IsUsed[PageIndex];
+        Result &= (((Cache->PageUsage[PageIndex / 64] >> (PageIndex % 64)) & 1) == (u64)IsUsed);
+
+        UsedPageCount += IsUsed;
+        FreeRangeCount += (!IsUsed && (RunLength == 0));
+        RunLength = IsUsed ? 0 : RunLength + 1;
+        LargestFreeRange = Max(LargestFreeRange, RunLength);
+    }
+    Result &= (Cache->UsedPageCount == UsedPageCount);
+    Result &= (Cache->LargestFreeRange == LargestFreeRange);
+    Result &= (Cache->FreeRangeCount == FreeRangeCount);
+
+    for (umm RegionIndex = 0; RegionIndex < Cache->RegionCount; RegionIndex++)
+    {
+        texture_page_region* Region = Cache->Regions + RegionIndex;
+        umm FreeCount = 0;
+        for (umm PageIndex = 0; PageIndex < texture_cache::RegionPageCount; PageIndex++)
+        {
+            FreeCount += ((Cache->PageUsage[RegionIndex * texture_cache::RegionWordCount + PageIndex / 64] >> (PageIndex % 64)) & 1) == 0;
+        }
+        Result &= (Region->FreeCount == FreeCount);
+        Result &= (Region->MaxFreeRun <= Region->FreeCount);
+        Result &= (Region->LeadingFreeCount <= Region->MaxFreeRun) && (Region->TrailingFreeCount <= Region->MaxFreeRun);
+    }
+    return(Result);
+}
+
+struct cache_test_state
+{
+    texture_cache Cache;
+    reference_cache Reference;
+    memory_arena Arena;
+    void* Memory;
+};
+
+internal cache_test_state* CreateCacheTestState(umm PageCount, umm BudgetPageCount)
+{
+    cache_test_state* State = new cache_test_state;
+    umm MemorySize = MiB(1);
+    State->Memory = malloc(MemorySize);
+    State->Arena = InitializeArena(MemorySize, State->Memory);
+    State->Cache = {};
+    InitTextureCache(&State->Cache, &State->Arena, PageCount, BudgetPageCount);
+    State->Reference.IsUsed.assign(PageCount, 0);
+    return(State);
+}
+
+internal void DestroyCacheTestState(cache_test_state* State)
+{
+    free(State->Memory);
+    delete State;
+}
+
+internal void UsePages(cache_test_state* State, umm FirstPage, umm PageCount)
+{
+    MarkPagesAsUsed(&State->Cache, FirstPage, PageCount);
+    SetReferenceUsage(&State->Reference, FirstPage, PageCount, true);
+}
+
+internal void FreePages(cache_test_state* State, umm FirstPage, umm PageCount)
+{
+    MarkPagesAsFree(&State->Cache, FirstPage, PageCount);
+    SetReferenceUsage(&State->Reference, FirstPage, PageCount, false);
+}
+
+internal void TestTextureCacheRegionCrossing()
+{
+    constexpr umm RegionPageCount = texture_cache::RegionPageCount;
+    // NOTE(boti): The last region is only partially backed by pages
+    constexpr umm PageCount = 5 * RegionPageCount + 100;
+    cache_test_state* State = CreateCacheTestState(PageCount, PageCount);
+    texture_cache* Cache = &State->Cache;
+    Expect(Cache->RegionCount == 6);
+    Expect(Cache->LargestFreeRange == PageCount);
+    Expect(Cache->FreeRangeCount == 1);
+    Expect(FindFreePageRange(Cache, PageCount) == 0);
+    Expect(FindFreePageRange(Cache, PageCount + 1) == U64_MAX);
+
+    UsePages(State, 0, PageCount);
+    Expect(IsSameAsReference(Cache, &State->Reference));
+    Expect(FindFreePageRange(Cache, 1) == U64_MAX);
+
+    // NOTE(boti): A run crossing from region 0 into region 1,
+    // one spanning the end of region 1, all of region 2 and the start of region 3,
+    // a short run inside region 3 (after the long one), and a run at the very end of the pages
+    constexpr umm ShortCrossBegin = RegionPageCount - 10;
+    constexpr umm ShortCrossCount = 20;
+    constexpr umm LongCrossBegin = 2 * RegionPageCount - 30;
+    constexpr umm LongCrossCount = 30 + RegionPageCount + 40;
+    constexpr umm InnerBegin = 3 * RegionPageCount + 100;
+    constexpr umm InnerCount = 25;
+    constexpr umm EndCount = 50;
+    FreePages(State, ShortCrossBegin, ShortCrossCount);
+    FreePages(State, LongCrossBegin, LongCrossCount);
+    FreePages(State, InnerBegin, InnerCount);
+    FreePages(State, PageCount - EndCount, EndCount);
+    Expect(IsSameAsReference(Cache, &State->Reference));
+    Expect(Cache->LargestFreeRange == LongCrossCount);
+    Expect(Cache->FreeRangeCount == 4);
+
+    Expect(FindFreePageRange(Cache, 1) == ShortCrossBegin);
+    Expect(FindFreePageRange(Cache, ShortCrossCount) == ShortCrossBegin);
+    Expect(FindFreePageRange(Cache, ShortCrossCount + 1) == LongCrossBegin);
+    Expect(FindFreePageRange(Cache, LongCrossCount) == LongCrossBegin);
+    Expect(FindFreePageRange(Cache, LongCrossCount + 1) == U64_MAX);
+
+    // NOTE(boti): With the long run gone the inner run comes before the end one, and the padding is never handed out
+    UsePages(State, LongCrossBegin, LongCrossCount);
+    Expect(IsSameAsReference(Cache, &State->Reference));
+    Expect(Cache->LargestFreeRange == EndCount);
+    Expect(FindFreePageRange(Cache, ShortCrossCount + 1) == InnerBegin);
+    Expect(FindFreePageRange(Cache, InnerCount + 1) == PageCount - EndCount);
+    Expect(FindFreePageRange(Cache, EndCount + 1) == U64_MAX);
+
+    // NOTE(boti): Freeing the pages between the runs merges them
+    FreePages(State, ShortCrossBegin + ShortCrossCount, InnerBegin - (ShortCrossBegin + ShortCrossCount));
+    Expect(IsSameAsReference(Cache, &State->Reference));
+    Expect(Cache->LargestFreeRange == InnerBegin + InnerCount - ShortCrossBegin);
+    Expect(Cache->FreeRangeCount == 2);
+    Expect(FindFreePageRange(Cache, Cache->LargestFreeRange) == ShortCrossBegin);
+
+    DestroyCacheTestState(State);
+}
+
+internal void TestTextureCacheEarlyOut()
+{
+    constexpr umm PageCount = 8192;
+    cache_test_state* State = CreateCacheTestState(PageCount, PageCount);
+    texture_cache* Cache = &State->Cache;
+    Expect(FindFreePageRange(Cache, 0) == U64_MAX);
+
+    // NOTE(boti): Every other page used, the largest free range is a single page everywhere
+    for (umm PageIndex = 0; PageIndex < PageCount; PageIndex += 2)
+    {
+        UsePages(State, PageIndex, 1);
+    }
+    Expect(IsSameAsReference(Cache, &State->Reference));
+    Expect(Cache->LargestFreeRange == 1);
+    Expect(Cache->FreeRangeCount == PageCount / 2);
+    Expect(FindFreePageRange(Cache, 1) == 1);
+    Expect(FindFreePageRange(Cache, 2) == U64_MAX);
+    Expect(GetTextureCacheFragmentation(Cache) > 0.99f);
+
+    // NOTE(boti): A single longer run at the end still has to be found
+    FreePages(State, PageCount - 2, 1);
+    Expect(IsSameAsReference(Cache, &State->Reference));
+    Expect(Cache->LargestFreeRange == 3);
+    Expect(FindFreePageRange(Cache, 2) == PageCount - 3);
+    Expect(FindFreePageRange(Cache, 4) == U64_MAX);
+
+    DestroyCacheTestState(State);
+}
+
+// NOTE(boti): Texture sizes in pages, mostly small mips with the occasional full 4K chain
+internal umm GetRandomPageCount(entropy32* Entropy)
+{
+    f32 Log2Count = RandBetween(Entropy, 0.0f, 8.5f);
+    umm Result = Max((umm)Exp2(Log2Count), (umm)1);
+    return(Result);
+}
+
+struct live_range
+{
+    umm PageIndex;
+    umm PageCount;
+};
+
+internal void TestTextureCacheRandom()
+{
+    // NOTE(boti): Not a multiple of the region size, so that the padding is exercised too
+    constexpr umm PageCount = 4000;
+    cache_test_state* State = CreateCacheTestState(PageCount, PageCount);
+    texture_cache* Cache = &State->Cache;
+
+    entropy32 Entropy = { 0x7777u };
+    std::vector<live_range> Live;
+    std::vector<live_range> Pending[R_MaxFramesInFlight];
+    b32 IsSame = true;
+    b32 IsFirstFit = true;
+    u32 FailCount = 0;
+    for (u32 FrameIndex = 0; FrameIndex < 600; FrameIndex++)
+    {
+        u32 FrameID = FrameIndex % R_MaxFramesInFlight;
+        ReleasePendingTexturePages(Cache, FrameID);
+        for (live_range Range : Pending[FrameID])
+        {
+            SetReferenceUsage(&State->Reference, Range.PageIndex, Range.PageCount, false);
+        }
+        Pending[FrameID].clear();
+        IsSame &= IsSameAsReference(Cache, &State->Reference);
+
+        for (u32 OpIndex = 0; OpIndex < 20; OpIndex++)
+        {
+            // NOTE(boti): Keep the cache mostly full, so that the searches fail regularly
+            b32 ShouldAllocate = Live.empty() || ((RandU32(&Entropy) % 100) < 55);
+            if (ShouldAllocate)
+            {
+                umm Count = GetRandomPageCount(&Entropy);
+                umm PageIndex = FindFreePageRange(Cache, Count);
+                IsFirstFit &= (PageIndex == FindReferenceRange(&State->Reference, Count));
+                if (PageIndex != U64_MAX)
+                {
+                    UsePages(State, PageIndex, Count);
+                    Live.push_back({ PageIndex, Count });
+                }
+                else
+                {
+                    FailCount++;
+                }
+            }
+            else
+            {
+                u32 Index = RandU32(&Entropy) % (u32)Live.size();
+                live_range Range = Live[Index];
+                Live[Index] = Live.back();
+                Live.pop_back();
+                PushPendingPageFree(Cache, FrameID, Range.PageIndex, Range.PageCount);
+                Pending[FrameID].push_back(Range);
+            }
+            IsSame &= IsSameAsReference(Cache, &State->Reference);
+        }
+
+        // NOTE(boti): Every size has to give the same answer as the reference
+        for (umm Count = 1; Count <= 400; Count += 7)
+        {
+            IsFirstFit &= (FindFreePageRange(Cache, Count) == FindReferenceRange(&State->Reference, Count));
+        }
+    }
+    Expect(IsSame);
+    Expect(IsFirstFit);
+    Expect(FailCount > 0);
+
+    // NOTE(boti): The pending pages are still used, but they're not resident
+    umm PendingPageCount = 0;
+    for (u32 FrameID = 0; FrameID < R_MaxFramesInFlight; FrameID++)
+    {
+        for (live_range Range : Pending[FrameID]) PendingPageCount += Range.PageCount;
+    }
+    Expect(Cache->PendingFreePageCount == PendingPageCount);
+    Expect(GetResidentPageCount(Cache) == Cache->UsedPageCount - PendingPageCount);
+
+    for (live_range Range : Live)
+    {
+        FreePages(State, Range.PageIndex, Range.PageCount);
+    }
+    for (u32 FrameID = 0; FrameID < R_MaxFramesInFlight; FrameID++)
+    {
+        ReleasePendingTexturePages(Cache, FrameID);
+    }
+    Expect(Cache->UsedPageCount == 0);
+    Expect(Cache->LargestFreeRange == PageCount);
+    Expect(Cache->FreeRangeCount == 1);
+    Expect(GetTextureCacheFragmentation(Cache) == 0.0f);
+
+    DestroyCacheTestState(State);
+}
+
+// NOTE(boti): Replays a streaming trace at high occupancy: textures get allocated until the cache is full,
+// then the oldest ones are replaced. Compared against the page at a time search the cache used to do.
+internal void BenchmarkTextureCache()
+{
+    constexpr umm PageCount = R_TextureMemorySize / TexturePageSize;
+    cache_test_state* State = CreateCacheTestState(PageCount, PageCount);
+    texture_cache* Cache = &State->Cache;
+
+    entropy32 Entropy = { 0xC0FFEEu };
+    std::vector<live_range> Live;
+    std::vector<f64> HitTimes, MissTimes, ReferenceHitTimes, ReferenceMissTimes;
+    f64 FragmentationSum = 0.0;
+    f64 OccupancySum = 0.0;
+    u32 SampleCount = 0;
+    constexpr u32 RequestCount = 200000;
+    for (u32 RequestIndex = 0; RequestIndex < RequestCount; RequestIndex++)
+    {
+        umm Count = GetRandomPageCount(&Entropy);
+
+        f64 Begin = GetSeconds();
+        umm PageIndex = FindFreePageRange(Cache, Count);
+        f64 Time = GetSeconds() - Begin;
+
+        // NOTE(boti): Only a fraction of the reference searches are timed, they're slow
+        if ((RequestIndex % 16) == 0)
+        {
+            f64 ReferenceBegin = GetSeconds();
+            umm ReferencePageIndex = FindReferenceRange(&State->Reference, Count);
+            f64 ReferenceTime = GetSeconds() - ReferenceBegin;
+            Expect(ReferencePageIndex == PageIndex);
+            ((ReferencePageIndex != U64_MAX) ? ReferenceHitTimes : ReferenceMissTimes).push_back(ReferenceTime);
+        }
+
+        if (PageIndex != U64_MAX)
+        {
+            HitTimes.push_back(Time);
+            UsePages(State, PageIndex, Count);
+            Live.push_back({ PageIndex, Count });
+        }
+        else
+        {
+            MissTimes.push_back(Time);
+            // NOTE(boti): Evict random textures until this one would fit by page count
+            while (!Live.empty() && (Cache->PageCount - Cache->UsedPageCount < Count + PageCount / 32))
+            {
+                u32 Index = RandU32(&Entropy) % (u32)Live.size();
+                FreePages(State, Live[Index].PageIndex, Live[Index].PageCount);
+                Live[Index] = Live.back();
+                Live.pop_back();
+            }
+        }
+
+        if (Cache->UsedPageCount > PageCount / 2)
+        {
+            FragmentationSum += GetTextureCacheFragmentation(Cache);
+            OccupancySum += (f64)Cache->UsedPageCount / (f64)PageCount;
+            SampleCount++;
+        }
+    }
+
+    auto Report = [](const char* Name, std::vector<f64>& Times)
+    {
+        if (!Times.empty())
+        {
+            std::sort(Times.begin(), Times.end());
+            f64 Sum = 0.0;
+            for (f64 Time : Times) Sum += Time;
+            printf("  %-28s %7zu, mean %8.1fns, p50 %8.1fns, p99 %8.1fns, max %8.1fns\n", Name, Times.size(),
+                   1e9 * Sum / (f64)Times.size(), 1e9 * Times[Times.size() / 2],
+                   1e9 * Times[(Times.size() * 99) / 100], 1e9 * Times.back());
+        }
+    };
+    printf("Texture cache (%zu pages, %u requests):\n", (size_t)PageCount, RequestCount);
+    Report("FindFreePageRange hit", HitTimes);
+    Report("FindFreePageRange miss", MissTimes);
+    Report("Page at a time hit", ReferenceHitTimes);
+    Report("Page at a time miss", ReferenceMissTimes);
+    printf("  mean occupancy %.1f%%, mean fragmentation %.3f (when more than half full)\n",
+           100.0 * OccupancySum / (f64)SampleCount, FragmentationSum / (f64)SampleCount);
+
+    DestroyCacheTestState(State);
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestTextureCacheRegionCrossing);
+    RunTest(TestTextureCacheEarlyOut);
+    RunTest(TestTextureCacheRandom);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkTextureCache();
+    }
+    return(EndTests("TextureCacheTest"));
+}
@@ -0,0 +1,651 @@
+#include "Test.hpp"
+
+#include <Renderer/Renderer.hpp>
+#include <Renderer/TextureCache.hpp>
+#include <Renderer/TextureResidency.hpp>
+
+#include <Renderer/TextureCache.cpp>
+#include <Renderer/TextureResidency.cpp>
+
+#include <LadybugLib/Sort.hpp>
+
+#include <vector>
+
+struct residency_test_state
+{
+    texture_cache Cache;
+    memory_arena Arena;
+    void* Memory;
+};
+
+internal residency_test_state* CreateResidencyTestState(umm PageCount, umm BudgetPageCount)
+{
+    residency_test_state* State = new residency_test_state;
+    umm MemorySize = MiB(16);
+    State->Memory = malloc(MemorySize);
+    State->Arena = InitializeArena(MemorySize, State->Memory);
+    State->Cache = {};
+    InitTextureCache(&State->Cache, &State->Arena, PageCount, BudgetPageCount);
+    return(State);
+}
+
+internal void DestroyResidencyTestState(residency_test_state* State)
+{
+    free(State->Memory);
+    delete State;
+}
+
+internal void TestTextureBudgetHysteresis()
+{
+    residency_test_state* State = CreateResidencyTestState(4096, 1600);
+    texture_cache* Cache = &State->Cache;
+    Expect(Cache->BudgetPageCount == 1600);
+    Expect(Cache->LowWaterPageCount == 1500);
+
+    // NOTE(boti): Only going over the budget starts the eviction...
+    MarkPagesAsUsed(Cache, 0, 1600);
+    Expect(!UpdateTextureBudget(Cache));
+    MarkPagesAsUsed(Cache, 1600, 1);
+    Expect(UpdateTextureBudget(Cache));
+
+    // NOTE(boti): ... which keeps going until the resident pages get below the low water mark
+    MarkPagesAsFree(Cache, 1500, 100);
+    Expect(UpdateTextureBudget(Cache));
+    MarkPagesAsFree(Cache, 1600, 1);
+    Expect(!UpdateTextureBudget(Cache));
+    Expect(GetResidentPageCount(Cache) == 1500);
+    MarkPagesAsUsed(Cache, 1500, 100);
+    Expect(!UpdateTextureBudget(Cache));
+    MarkPagesAsFree(Cache, 1500, 100);
+
+    // NOTE(boti): Pages waiting for the frames in flight are still used, but they don't count towards the budget
+    MarkPagesAsUsed(Cache, 1500, 600);
+    Expect(UpdateTextureBudget(Cache));
+    PushPendingPageFree(Cache, 0, 1500, 600);
+    Expect(Cache->UsedPageCount == 2100);
+    Expect(GetResidentPageCount(Cache) == 1500);
+    Expect(!UpdateTextureBudget(Cache));
+    Expect(FindFreePageRange(Cache, 1) == 2100);
+    ReleasePendingTexturePages(Cache, 0);
+    Expect(Cache->UsedPageCount == 1500);
+    Expect(GetResidentPageCount(Cache) == 1500);
+    Expect(FindFreePageRange(Cache, 1) == 1500);
+
+    // NOTE(boti): The budget can't be larger than the cache
+    residency_test_state* Small = CreateResidencyTestState(100, 1000);
+    Expect(Small->Cache.BudgetPageCount == 100);
+
+    DestroyResidencyTestState(Small);
+    DestroyResidencyTestState(State);
+}
+
+internal renderer_texture MakeTexture(u32 Log2Extent, u32 ResidentMips, u32 LastMipAccess, u32 LastUsedFrame, umm PageCount)
+{
+    renderer_texture Result = {};
+    Result.Flags = TextureFlag_None;
+    Result.Info.Extent = { 1u << Log2Extent, 1u << Log2Extent, 1 };
+    Result.Info.MipCount = Log2Extent + 1;
+    Result.Info.ArrayCount = 1;
+    Result.Info.Format = Format_R8G8B8A8_SRGB;
+    Result.MipResidencyMask = ResidentMips;
+    Result.LastMipAccess = LastMipAccess;
+    Result.LastUsedFrame = LastUsedFrame;
+    Result.PageIndex = 0;
+    Result.PageCount = PageCount;
+    return(Result);
+}
+
+internal void TestTextureMipsToEvict()
+{
+    // NOTE(boti): Bit i is the mip with 2^i texels on its larger side, the low resolution mips are never evicted
+    renderer_texture Texture = MakeTexture(12, 0x1FFFu, 0, 0, 100);
+    Expect(GetMipsToEvict(&Texture) == 0x1F00u);
+    Texture.LastMipAccess = 1u << 10;
+    Expect(GetMipsToEvict(&Texture) == 0x1800u);
+    Texture.LastMipAccess = (1u << 12) | (1u << 11);
+    Expect(GetMipsToEvict(&Texture) == 0);
+    Texture.LastMipAccess = 1u << 3;
+    Expect(GetMipsToEvict(&Texture) == 0x1F00u);
+
+    Texture = MakeTexture(7, 0xFFu, 0, 0, 1);
+    Expect(GetMipsToEvict(&Texture) == 0);
+
+    // NOTE(boti): Sampling the highest resident mip restarts the eviction clock, sampling lower ones doesn't
+    Texture = MakeTexture(10, 0x3FFu, 0, 5, 20);
+    UpdateTextureAccess(&Texture, 1u << 8, 100);
+    Expect((Texture.LastUsedFrame == 5) && (Texture.LastMipAccess == (1u << 8)));
+    UpdateTextureAccess(&Texture, (1u << 9) | (1u << 8), 101);
+    Expect(Texture.LastUsedFrame == 101);
+    UpdateTextureAccess(&Texture, 0, 102);
+    Expect((Texture.LastUsedFrame == 101) && (Texture.LastMipAccess == 0));
+    // NOTE(boti): Textures with nothing resident aren't used (the placeholder is shown instead)
+    Texture.MipResidencyMask = 0;
+    UpdateTextureAccess(&Texture, 1u << 9, 103);
+    Expect(Texture.LastUsedFrame == 101);
+}
+
+internal void TestTextureEvictionCandidates()
+{
+    constexpr u32 FrameIndex = 1000;
+    constexpr u32 OldFrame = FrameIndex - renderer_texture::MinEvictionAge;
+    std::vector<renderer_texture> Textures;
+    Textures.push_back(MakeTexture(11, 0xFFFu, 0, OldFrame, 300));      // 0: Old
+    Textures.push_back(MakeTexture(11, 0xFFFu, 0, OldFrame + 1, 300));  // 1: Too young
+    Textures.push_back(MakeTexture(11, 0xFFFu, 0, OldFrame - 10, 100)); // 2: Oldest
+    Textures.push_back(MakeTexture(11, 0xFFFu, 0, OldFrame, 500));      // 3: As old as 0, but larger
+    Textures.push_back(MakeTexture(7, 0xFFu, 0, 0, 2));                 // 4: Nothing to evict
+    Textures.push_back(MakeTexture(11, 0xFFFu, 1u << 11, 0, 300));      // 5: Still sampled at full resolution
+    Textures.push_back(MakeTexture(11, 0, 0, 0, 0));                    // 6: No image
+    Textures.push_back(MakeTexture(11, 0xFFFu, 0, 0, 300));             // 7: Persistent
+    Textures.back().Flags = TextureFlag_PersistentMemory;
+    Textures.push_back(MakeTexture(11, 0xFFFu, 0, 0, 300));             // 8: Array
+    Textures.back().Info.ArrayCount = 4;
+    Textures.push_back(MakeTexture(11, 0xFFFu, 1u << 9, OldFrame, 50)); // 9: Only the top mips are evictable
+
+    void* Memory = malloc(MiB(1));
+    memory_arena Arena = InitializeArena(MiB(1), Memory);
+    u32* Indices = nullptr;
+    u32 Count = GetTextureEvictionCandidates(Textures.data(), (u32)Textures.size(), FrameIndex, &Arena, &Indices);
+    Expect(Count == 4);
+    if (Count == 4)
+    {
+        Expect(Indices[0] == 2);
+        Expect(Indices[1] == 3);
+        Expect(Indices[2] == 0);
+        Expect(Indices[3] == 9);
+    }
+
+    // NOTE(boti): The age is computed with wrap-around, so the frame counter can overflow
+    std::vector<renderer_texture> Wrapped;
+    Wrapped.push_back(MakeTexture(11, 0xFFFu, 0, U32_MAX - 10, 300));
+    Count = GetTextureEvictionCandidates(Wrapped.data(), (u32)Wrapped.size(), renderer_texture::MinEvictionAge - 11, &Arena, &Indices);
+    Expect(Count == 1);
+    Count = GetTextureEvictionCandidates(Wrapped.data(), (u32)Wrapped.size(), renderer_texture::MinEvictionAge - 12, &Arena, &Indices);
+    Expect(Count == 0);
+    free(Memory);
+}
+
+// NOTE(boti): Visits every texture in the feedback, the textures that weren't sampled just get their LastMipAccess cleared
+internal u32 ProcessMipFeedbackReference(renderer_texture* Textures, const u32* MipFeedbacks, u32 FeedbackCount, u32 FrameIndex,
+                                         u32* OutTextureIndices, u32* OutMips)
+{
+    u32 Result = 0;
+    for (u32 TextureIndex = 0; TextureIndex < FeedbackCount; TextureIndex++)
+    {
+        renderer_texture* Texture = Textures + TextureIndex;
+        if (!(Texture->Flags & TextureFlag_PersistentMemory))
+        {
+            UpdateTextureAccess(Texture, MipFeedbacks[TextureIndex], FrameIndex);
+            if (MipFeedbacks[TextureIndex])
+            {
+                OutTextureIndices[Result] = TextureIndex;
+                OutMips[Result] = MipFeedbacks[TextureIndex];
+                Result++;
+            }
+        }
+    }
+    return(Result);
+}
+
+// NOTE(boti): Random feedback where Density/(256 + Density) of the textures end up getting sampled,
+// mostly the same ones as in the previous frame (the camera doesn't jump around)
+internal void GenerateMipFeedback(entropy32* Entropy, std::vector<u32>& Feedback, u32 Density)
+{
+    for (u32& MipFeedback : Feedback)
+    {
+        b32 WasSampled = (MipFeedback != 0);
+        b32 IsSampled = WasSampled ? (RandU32(Entropy) % 8) != 0 : (RandU32(Entropy) % 2048) < Density;
+        MipFeedback = IsSampled ? (1u << (RandU32(Entropy) % 13)) : 0;
+    }
+}
+
+internal void TestMipFeedback()
+{
+    constexpr u32 TextureCount = 5000;
+    entropy32 Entropy = { 0xFEEDu };
+
+    std::vector<renderer_texture> Textures(TextureCount), ReferenceTextures;
+    for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+    {
+        Textures[TextureIndex] = MakeTexture(12, (RandU32(&Entropy) % 4) ? 0x1FFFu : 0, 0, 0, 16);
+        // NOTE(boti): Persistent textures never get streamed, their feedback is ignored
+        if ((RandU32(&Entropy) % 16) == 0)
+        {
+            Textures[TextureIndex].Flags = TextureFlag_PersistentMemory;
+        }
+    }
+    ReferenceTextures = Textures;
+
+    std::vector<u64> SampledTextureBits(CeilDiv(TextureCount, 64u), 0);
+    std::vector<u32> Feedback(TextureCount, 0);
+    std::vector<u32> Indices(TextureCount), Mips(TextureCount), ReferenceIndices(TextureCount), ReferenceMips(TextureCount);
+    b32 IsSame = true;
+    for (u32 FrameIndex = 1; FrameIndex <= 400; FrameIndex++)
+    {
+        // NOTE(boti): Mostly sparse feedback with the occasional dense or empty frame,
+        // and the texture count changes so that the blocks get cut at every possible position
+        u32 Density = 16;
+        switch (FrameIndex % 50)
+        {
+            case 10: Density = 256; break;
+            case 20: Density = 0; std::fill(Feedback.begin(), Feedback.end(), 0u); break;
+        }
+        GenerateMipFeedback(&Entropy, Feedback, Density);
+        u32 FeedbackCount = (FrameIndex % 3) ? TextureCount - (RandU32(&Entropy) % 130) : TextureCount;
+        for (u32 TextureIndex = FeedbackCount; TextureIndex < TextureCount; TextureIndex++)
+        {
+            Feedback[TextureIndex] = 0;
+        }
+
+        u32 Count = ProcessMipFeedback(Textures.data(), SampledTextureBits.data(), Feedback.data(), FeedbackCount, FrameIndex,
+                                       Indices.data(), Mips.data());
+        u32 ReferenceCount = ProcessMipFeedbackReference(ReferenceTextures.data(), Feedback.data(), FeedbackCount, FrameIndex,
+                                                         ReferenceIndices.data(), ReferenceMips.data());
+        IsSame &= (Count == ReferenceCount);
+        for (u32 Index = 0; Index < Min(Count, ReferenceCount); Index++)
+        {
+            IsSame &= (Indices[Index] == ReferenceIndices[Index]);
+            IsSame &= (Mips[Index] == ReferenceMips[Index]);
+        }
+        for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+        {
+            renderer_texture* Texture = &Textures[TextureIndex];
+            renderer_texture* Reference = &ReferenceTextures[TextureIndex];
+            IsSame &= (Texture->LastMipAccess == Reference->LastMipAccess);
+            IsSame &= (Texture->LastUsedFrame == Reference->LastUsedFrame);
+
+            // NOTE(boti): The sampled bits have to track the textures with a non-zero LastMipAccess exactly
+            b32 IsBitSet = (SampledTextureBits[TextureIndex / 64] >> (TextureIndex % 64)) & 1;
+            IsSame &= (IsBitSet == (Texture->LastMipAccess != 0));
+        }
+    }
+    Expect(IsSame);
+}
+
+internal void TestTextureRequestPriority()
+{
+    // NOTE(boti): Nothing sampled means nothing to request
+    Expect(GetTextureRequestPriority(0, 0) == 0);
+    Expect(GetTextureRequestPriority(0, 0xFFu) == 0);
+
+    // NOTE(boti): Textures showing the placeholder are missing all of their mips
+    Expect(GetTextureRequestPriority(0x3FFu, 0) == ((10u << 8) | 9));
+    Expect(GetTextureRequestPriority(0x3FFu, 0xFFu) == ((2u << 8) | 9));
+    Expect(GetTextureRequestPriority(0x3FFu, 0x3FFu) == 9);
+    Expect(GetTextureRequestPriority(0xFFu, 0x3FFu) == 7);
+    // NOTE(boti): Only the highest mips matter, the requests are always padded with the lower mips anyway
+    Expect(GetTextureRequestPriority(1u << 9, 1u << 6) == GetTextureRequestPriority(0x3FFu, 0x7Fu));
+
+    // NOTE(boti): Exhaustively over the padded masks, the priority has to order the textures by
+    // the missing mip count first and the highest sampled mip second
+    struct priority_case
+    {
+        u32 MissingMipCount;
+        u32 HighestSampledMip;
+        u32 Priority;
+    };
+    std::vector<priority_case> Cases;
+    for (u32 SampledMip = 0; SampledMip < 16; SampledMip++)
+    {
+        for (u32 ResidentMip = 0; ResidentMip <= 16; ResidentMip++)
+        {
+            // NOTE(boti): ResidentMip == 16 stands for nothing resident
+            u32 SampledMips = SetBitsBelowHighInclusive(1u << SampledMip);
+            u32 ResidentMips = (ResidentMip == 16) ? 0 : SetBitsBelowHighInclusive(1u << ResidentMip);
+            u32 MissingMipCount = (ResidentMip == 16) ? SampledMip + 1 : (SampledMip > ResidentMip ? SampledMip - ResidentMip : 0);
+            Cases.push_back({ MissingMipCount, SampledMip, GetTextureRequestPriority(SampledMips, ResidentMips) });
+        }
+    }
+    b32 IsOrdered = true;
+    for (const priority_case& A : Cases)
+    {
+        for (const priority_case& B : Cases)
+        {
+            b32 IsAHigher = (A.MissingMipCount > B.MissingMipCount) ||
+                ((A.MissingMipCount == B.MissingMipCount) && (A.HighestSampledMip > B.HighestSampledMip));
+            b32 IsSame = (A.MissingMipCount == B.MissingMipCount) && (A.HighestSampledMip == B.HighestSampledMip);
+            IsOrdered &= (IsAHigher == (A.Priority > B.Priority));
+            IsOrdered &= (IsSame == (A.Priority == B.Priority));
+        }
+    }
+    Expect(IsOrdered);
+}
+
+// NOTE(boti): RGBA8 texture with the mips in ResidentMips (bit i = 2^i texels on a side)
+internal umm GetMipPageCount(u32 ResidentMips)
+{
+    umm ByteCount = 0;
+    for (u32 Mip = 0; Mip < 32; Mip++)
+    {
+        if (ResidentMips & (1u << Mip))
+        {
+            ByteCount += 4llu << (2 * Mip);
+        }
+    }
+    umm Result = CeilDiv(ByteCount, TexturePageSize);
+    return(Result);
+}
+
+struct residency_sim_config
+{
+    b32 IsHysteresisEnabled;
+    // NOTE(boti): Requests are serviced in priority order like ProcessTextureRequests does, or in texture order otherwise
+    b32 IsPrioritized;
+    umm MaxUploadPageCountPerFrame;
+};
+
+struct residency_sim_stats
+{
+    // NOTE(boti): Frames that evicted anything, the hysteresis is supposed to batch the evictions into fewer frames
+    u32 EvictionFrameCount;
+    u32 EvictionCount;
+    u32 UploadCount;
+    // NOTE(boti): Evicted mips that had to be streamed back within MinEvictionAge frames
+    u32 ThrashCount;
+    f64 MeanResidentPageCount;
+    umm MaxResidentPageCount;
+    // NOTE(boti): Summed over the visible textures of every frame
+    u32 PlaceholderCount;
+    u32 MissingMipCount;
+    b32 IsPolicyRespected;
+};
+
+// NOTE(boti): Drives the cache and the eviction the same way BeginRenderFrame/EndRenderFrame do,
+// with synthetic feedback: the camera moves along a row of textures, the ones close to it get sampled at high resolution.
+internal residency_sim_stats SimulateResidency(residency_sim_config Config)
+{
+    constexpr u32 TextureCount = 2000;
+    constexpr u32 FrameCount = 3000;
+    constexpr u32 VisibleCount = 60;
+    constexpr u32 MaxEvictionCountPerFrame = 32;
+
+    residency_test_state* State = CreateResidencyTestState(16384, 12000);
+    texture_cache* Cache = &State->Cache;
+    if (!Config.IsHysteresisEnabled)
+    {
+        Cache->LowWaterPageCount = Cache->BudgetPageCount;
+    }
+
+    entropy32 Entropy = { 0xABCDu };
+    std::vector<renderer_texture> Textures(TextureCount);
+    std::vector<u32> EvictedFrames(TextureCount, U32_MAX);
+    for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+    {
+        Textures[TextureIndex] = MakeTexture(7 + RandU32(&Entropy) % 4, 0, 0, 0, 0);
+    }
+
+    residency_sim_stats Stats = {};
+    Stats.IsPolicyRespected = true;
+    f64 ResidentPageSum = 0.0;
+    std::vector<u32> Feedback(TextureCount);
+    std::vector<u32> RequestIndices(TextureCount), RequestMips(TextureCount), RequestKeys(TextureCount), RequestOrder(TextureCount);
+    std::vector<u32> TempKeys(TextureCount), TempValues(TextureCount);
+    for (u32 FrameIndex = 1; FrameIndex <= FrameCount; FrameIndex++)
+    {
+        u32 FrameID = FrameIndex % R_MaxFramesInFlight;
+        ReleasePendingTexturePages(Cache, FrameID);
+
+        // NOTE(boti): Feedback, textures in the middle of the view are sampled at their full resolution,
+        // the ones further away at up to 3 mips lower
+        u32 ViewBegin = (FrameIndex * 2) % TextureCount;
+        for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+        {
+            u32 Offset = (TextureIndex + TextureCount - ViewBegin) % TextureCount;
+            u32 MipFeedback = 0;
+            if (Offset < VisibleCount)
+            {
+                u32 Distance = (u32)Abs((s32)Offset - (s32)(VisibleCount / 2));
+                u32 HighestMip = Textures[TextureIndex].Info.MipCount - 1;
+                u32 SampledMip = HighestMip - Min(Distance / (VisibleCount / 8), 3u);
+                MipFeedback = (1u << SampledMip) | (1u << (SampledMip - 1));
+            }
+            Feedback[TextureIndex] = MipFeedback;
+            UpdateTextureAccess(&Textures[TextureIndex], MipFeedback, FrameIndex);
+        }
+
+        // NOTE(boti): Requests, only the low resolution mips while over budget
+        b32 IsOverBudget = GetResidentPageCount(Cache) > Cache->BudgetPageCount;
+        u32 RequestCount = 0;
+        for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+        {
+            renderer_texture* Texture = &Textures[TextureIndex];
+            u32 SampledMips = SetBitsBelowHighInclusive(Feedback[TextureIndex]);
+            u32 RequestedMips = SampledMips & (~Texture->MipResidencyMask);
+            if (IsOverBudget)
+            {
+                RequestedMips &= renderer_texture::AlwaysResidentMips;
+            }
+            if (RequestedMips)
+            {
+                RequestIndices[RequestCount] = TextureIndex;
+                RequestMips[RequestCount] = RequestedMips;
+                RequestKeys[RequestCount] = U32_MAX - GetTextureRequestPriority(SampledMips, Texture->MipResidencyMask);
+                RequestOrder[RequestCount] = RequestCount;
+                RequestCount++;
+            }
+        }
+        if (Config.IsPrioritized)
+        {
+            RadixSort32(RequestCount, RequestKeys.data(), RequestOrder.data(), TempKeys.data(), TempValues.data());
+        }
+
+        // NOTE(boti): Streaming, once a texture doesn't fit into the upload budget the rest wait for the next frame
+        umm UploadPageCount = 0;
+        for (u32 OrderIndex = 0; OrderIndex < RequestCount; OrderIndex++)
+        {
+            u32 RequestIndex = RequestOrder[OrderIndex];
+            u32 TextureIndex = RequestIndices[RequestIndex];
+            renderer_texture* Texture = &Textures[TextureIndex];
+            u32 RequestedMips = RequestMips[RequestIndex];
+
+            umm RequestPageCount = GetMipPageCount(RequestedMips);
+            if ((UploadPageCount != 0) && (UploadPageCount + RequestPageCount > Config.MaxUploadPageCountPerFrame))
+            {
+                break;
+            }
+
+            u32 NewMips = Texture->MipResidencyMask | RequestedMips;
+            umm PageCount = GetMipPageCount(NewMips);
+            umm PageIndex = FindFreePageRange(Cache, PageCount);
+            if (PageIndex != U64_MAX)
+            {
+                MarkPagesAsUsed(Cache, PageIndex, PageCount);
+                PushPendingPageFree(Cache, FrameID, Texture->PageIndex, Texture->PageCount);
+                Texture->PageIndex = PageIndex;
+                Texture->PageCount = PageCount;
+                Texture->MipResidencyMask = NewMips;
+                Texture->LastUsedFrame = FrameIndex;
+                if (FrameIndex - EvictedFrames[TextureIndex] < renderer_texture::MinEvictionAge)
+                {
+                    Stats.ThrashCount++;
+                }
+                UploadPageCount += RequestPageCount;
+                Stats.UploadCount++;
+            }
+        }
+
+        for (u32 TextureIndex = 0; TextureIndex < TextureCount; TextureIndex++)
+        {
+            u32 HighestSampledMip, HighestResidentMip;
+            if (BitScanReverse(&HighestSampledMip, Feedback[TextureIndex]))
+            {
+                if (BitScanReverse(&HighestResidentMip, Textures[TextureIndex].MipResidencyMask))
+                {
+                    Stats.MissingMipCount += (HighestSampledMip > HighestResidentMip) ? HighestSampledMip - HighestResidentMip : 0;
+                }
+                else
+                {
+                    Stats.PlaceholderCount++;
+                    Stats.MissingMipCount += HighestSampledMip + 1;
+                }
+            }
+        }
+
+        // NOTE(boti): Eviction
+        if (UpdateTextureBudget(Cache))
+        {
+            u32* Candidates = nullptr;
+            memory_arena_checkpoint Checkpoint = ArenaCheckpoint(&State->Arena);
+            u32 CandidateCount = GetTextureEvictionCandidates(Textures.data(), TextureCount, FrameIndex, &State->Arena, &Candidates);
+            u32 EvictionCount = 0;
+            u64 PrevKey = 0;
+            for (u32 CandidateIndex = 0; CandidateIndex < CandidateCount; CandidateIndex++)
+            {
+                if (!Cache->IsOverBudget || (EvictionCount == MaxEvictionCountPerFrame))
+                {
+                    break;
+                }
+
+                u32 TextureIndex = Candidates[CandidateIndex];
+                renderer_texture* Texture = &Textures[TextureIndex];
+                u32 DiscardMips = GetMipsToEvict(Texture);
+                u32 Age = FrameIndex - Texture->LastUsedFrame;
+
+                // NOTE(boti): Least recently used first, larger first within the same frame,
+                // and nothing that's needed by the last feedback
+                u64 Key = ((u64)(U32_MAX - Age) << 32) | (U32_MAX - (u32)Texture->PageCount);
+                Stats.IsPolicyRespected &= (Key >= PrevKey);
+                Stats.IsPolicyRespected &= (Age >= renderer_texture::MinEvictionAge);
+                Stats.IsPolicyRespected &= (DiscardMips != 0);
+                Stats.IsPolicyRespected &= (DiscardMips & (renderer_texture::AlwaysResidentMips | SetBitsBelowHighInclusive(Feedback[TextureIndex]))) == 0;
+                PrevKey = Key;
+
+                u32 KeptMips = Texture->MipResidencyMask & (~DiscardMips);
+                umm PageCount = GetMipPageCount(KeptMips);
+                umm PageIndex = FindFreePageRange(Cache, PageCount);
+                if (PageIndex != U64_MAX)
+                {
+                    MarkPagesAsUsed(Cache, PageIndex, PageCount);
+                    PushPendingPageFree(Cache, FrameID, Texture->PageIndex, Texture->PageCount);
+                    Texture->PageIndex = PageIndex;
+                    Texture->PageCount = PageCount;
+                    Texture->MipResidencyMask = KeptMips;
+                    Texture->LastUsedFrame = FrameIndex;
+                    EvictedFrames[TextureIndex] = FrameIndex;
+
+                    EvictionCount++;
+                    Stats.EvictionCount++;
+                    UpdateTextureBudget(Cache);
+                }
+            }
+            Stats.EvictionFrameCount += (EvictionCount > 0);
+            RestoreArena(&State->Arena, Checkpoint);
+        }
+
+        ResidentPageSum += (f64)GetResidentPageCount(Cache);
+        Stats.MaxResidentPageCount = Max(Stats.MaxResidentPageCount, GetResidentPageCount(Cache));
+    }
+    Stats.MeanResidentPageCount = ResidentPageSum / FrameCount;
+
+    DestroyResidencyTestState(State);
+    return(Stats);
+}
+
+internal void PrintResidencyStats(const char* Name, residency_sim_stats* Sim)
+{
+    printf("  %-14s %5u uploads, %5u evictions in %4u frames, %4u re-streamed within %u frames, resident pages mean %.0f, max %zu\n",
+           Name, Sim->UploadCount, Sim->EvictionCount, Sim->EvictionFrameCount, Sim->ThrashCount, renderer_texture::MinEvictionAge,
+           Sim->MeanResidentPageCount, (size_t)Sim->MaxResidentPageCount);
+}
+
+internal void TestTextureResidencyTrace()
+{
+    umm MaxUploadPageCount = R_MaxUploadBytesPerFrame / TexturePageSize;
+    residency_sim_stats Stats = SimulateResidency({ true, true, MaxUploadPageCount });
+    residency_sim_stats NoHysteresis = SimulateResidency({ false, true, MaxUploadPageCount });
+    Expect(Stats.IsPolicyRespected);
+    Expect(NoHysteresis.IsPolicyRespected);
+    Expect(Stats.EvictionCount > 0);
+
+    // NOTE(boti): Streaming only goes over the budget by the uploads of a single frame,
+    // and the hysteresis batches the evictions into fewer frames
+    Expect(Stats.MeanResidentPageCount <= 12000.0);
+    Expect(Stats.EvictionFrameCount < NoHysteresis.EvictionFrameCount / 2);
+
+    PrintResidencyStats("hysteresis", &Stats);
+    PrintResidencyStats("no hysteresis", &NoHysteresis);
+}
+
+internal void TestTextureRequestOrderTrace()
+{
+    // NOTE(boti): Same trace with the uploads limited enough that the requests have to queue up,
+    // servicing them in priority order should cut down on the time the placeholders and the blurry mips are shown
+    umm MaxUploadPageCount = 24;
+    residency_sim_stats Prioritized = SimulateResidency({ true, true, MaxUploadPageCount });
+    residency_sim_stats Unordered = SimulateResidency({ true, false, MaxUploadPageCount });
+    Expect(Prioritized.IsPolicyRespected);
+    Expect(Unordered.IsPolicyRespected);
+    Expect(Prioritized.PlaceholderCount < Unordered.PlaceholderCount);
+    Expect(Prioritized.MissingMipCount < Unordered.MissingMipCount);
+
+    auto Print = [](const char* Name, residency_sim_stats* Sim)
+    {
+        printf("  %-14s %5u uploads, %6u visible placeholders, %6u missing visible mips\n",
+               Name, Sim->UploadCount, Sim->PlaceholderCount, Sim->MissingMipCount);
+    };
+    Print("prioritized", &Prioritized);
+    Print("texture order", &Unordered);
+}
+
+internal void BenchmarkMipFeedback()
+{
+    constexpr u32 TextureCount = R_MaxTextureCount;
+    constexpr u32 FrameCount = 64;
+    entropy32 Entropy = { 0xBE7Cu };
+
+    printf("Mip feedback (%u textures, %u frames):\n", TextureCount, FrameCount);
+    for (u32 Density : { 0u, 4u, 32u, 256u })
+    {
+        std::vector<renderer_texture> Textures(TextureCount, MakeTexture(12, 0x1FFFu, 0, 0, 16));
+        std::vector<renderer_texture> ReferenceTextures = Textures;
+        std::vector<u64> SampledTextureBits(TextureCount / 64, 0);
+        std::vector<u32> Indices(TextureCount), Mips(TextureCount);
+
+        std::vector<std::vector<u32>> Feedbacks(FrameCount, std::vector<u32>(TextureCount, 0));
+        for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+        {
+            if (FrameIndex > 0)
+            {
+                Feedbacks[FrameIndex] = Feedbacks[FrameIndex - 1];
+            }
+            GenerateMipFeedback(&Entropy, Feedbacks[FrameIndex], Density);
+        }
+
+        f64 Time = 0.0, ReferenceTime = 0.0;
+        u64 SampledCount = 0;
+        for (u32 FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+        {
+            const u32* Feedback = Feedbacks[FrameIndex].data();
+            f64 Begin = GetSeconds();
+            u32 Count = ProcessMipFeedback(Textures.data(), SampledTextureBits.data(), Feedback, TextureCount, FrameIndex + 1,
+                                           Indices.data(), Mips.data());
+            f64 Middle = GetSeconds();
+            u32 ReferenceCount = ProcessMipFeedbackReference(ReferenceTextures.data(), Feedback, TextureCount, FrameIndex + 1,
+                                                             Indices.data(), Mips.data());
+            f64 End = GetSeconds();
+            Expect(Count == ReferenceCount);
+            Time += Middle - Begin;
+            ReferenceTime += End - Middle;
+            SampledCount += Count;
+        }
+        printf("  %6.2f%% sampled: %8.1fus per frame, every texture %8.1fus per frame\n",
+               100.0 * (f64)SampledCount / ((f64)TextureCount * FrameCount),
+               1e6 * Time / FrameCount, 1e6 * ReferenceTime / FrameCount);
+    }
+}
+
+int main(int ArgCount, char** Args)
+{
+    RunTest(TestTextureBudgetHysteresis);
+    RunTest(TestTextureMipsToEvict);
+    RunTest(TestTextureEvictionCandidates);
+    RunTest(TestTextureRequestPriority);
+    RunTest(TestTextureResidencyTrace);
+    RunTest(TestTextureRequestOrderTrace);
+    RunTest(TestMipFeedback);
+    if (IsBenchmarkRun(ArgCount, Args))
+    {
+        BenchmarkMipFeedback();
+    }
+    return(EndTests("TextureResidencyTest"));
+}